@@ -0,0 +1,178 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Checksum throughput: every chimera_checksum algorithm, hardware and
+ * portable, plus the 64-bit FNV-1a the NFSv3 DRC used before, over buffer
+ * sizes from a small RPC header to a large extent.  Prints one line per
+ * (algorithm, size) with the per-call time and GB/s.
+ *
+ *   checksum_bench [-t SECONDS_PER_CASE]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "common/checksum.h"
+
+#define BENCH_BUF_MAX (1024 * 1024)
+
+typedef uint64_t (*bench_fn_t)(
+    const void *data,
+    size_t      len);
+
+static uint64_t
+bench_crc32(
+    const void *data,
+    size_t      len)
+{
+    return chimera_crc32(0, data, len);
+} /* bench_crc32 */
+
+static uint64_t
+bench_crc32c(
+    const void *data,
+    size_t      len)
+{
+    return chimera_crc32c(0, data, len);
+} /* bench_crc32c */
+
+static uint64_t
+bench_xxh3_64(
+    const void *data,
+    size_t      len)
+{
+    return chimera_xxh3_64(data, len);
+} /* bench_xxh3_64 */
+
+static uint64_t
+bench_xxh3_128(
+    const void *data,
+    size_t      len)
+{
+    XXH128_hash_t h = chimera_xxh3_128(data, len);
+
+    return h.low64 ^ h.high64;
+} /* bench_xxh3_128 */
+
+static uint64_t
+bench_fnv1a(
+    const void *data,
+    size_t      len)
+{
+    const uint8_t *p = data;
+    uint64_t       h = 1469598103934665603ULL;
+    size_t         i;
+
+    for (i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+} /* bench_fnv1a */
+
+static uint64_t
+bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+} /* bench_now_ns */
+
+/* Calls `fn` on `len` bytes for at least `budget_ns`; returns ns per call. */
+static double
+bench_case(
+    bench_fn_t     fn,
+    const uint8_t *buf,
+    size_t         len,
+    uint64_t       budget_ns)
+{
+    volatile uint64_t sink = 0;
+    uint64_t          start, elapsed, calls = 0, batch = 1;
+    uint64_t          i;
+
+    start = bench_now_ns();
+    do {
+        for (i = 0; i < batch; i++) {
+            sink += fn(buf, len);
+        }
+        calls  += batch;
+        batch  *= 2;
+        elapsed = bench_now_ns() - start;
+    } while (elapsed < budget_ns);
+
+    (void) sink;
+    return (double) elapsed / calls;
+} /* bench_case */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    static const size_t sizes[] = { 64, 512, 4096, 65536, BENCH_BUF_MAX };
+    struct {
+        const char                *name;
+        bench_fn_t                 fn;
+        enum chimera_checksum_impl impl;
+    } algos[] = {
+        { "crc32",    bench_crc32,    CHIMERA_CHECKSUM_IMPL_PORTABLE },
+        { "crc32",    bench_crc32,    CHIMERA_CHECKSUM_IMPL_AUTO     },
+        { "crc32c",   bench_crc32c,   CHIMERA_CHECKSUM_IMPL_PORTABLE },
+        { "crc32c",   bench_crc32c,   CHIMERA_CHECKSUM_IMPL_AUTO     },
+        { "xxh3_64",  bench_xxh3_64,  CHIMERA_CHECKSUM_IMPL_AUTO     },
+        { "xxh3_128", bench_xxh3_128, CHIMERA_CHECKSUM_IMPL_AUTO     },
+        { "fnv1a_64", bench_fnv1a,    CHIMERA_CHECKSUM_IMPL_AUTO     },
+    };
+    const char         *crc32_name, *crc32c_name, *impl;
+    uint8_t            *buf;
+    uint64_t            budget_ns = 200000000ULL;
+    double              ns;
+    unsigned int        a, s;
+    int                 opt;
+
+    while ((opt = getopt(argc, argv, "t:h")) != -1) {
+        switch (opt) {
+            case 't':
+                budget_ns = (uint64_t) (strtod(optarg, NULL) * 1e9);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-t seconds_per_case]\n", argv[0]);
+                return opt == 'h' ? 0 : 1;
+        } /* switch */
+    }
+
+    buf = malloc(BENCH_BUF_MAX);
+    for (s = 0; s < BENCH_BUF_MAX; s++) {
+        buf[s] = (uint8_t) (s * 2654435761u >> 24);
+    }
+
+    printf("%-10s %-10s %10s %12s %10s\n", "algorithm", "impl", "bytes", "ns/call", "GB/s");
+
+    for (a = 0; a < sizeof(algos) / sizeof(algos[0]); a++) {
+        chimera_checksum_select(algos[a].impl, &crc32_name, &crc32c_name);
+        if (algos[a].fn == bench_crc32) {
+            impl = crc32_name;
+        } else if (algos[a].fn == bench_crc32c) {
+            impl = crc32c_name;
+        } else {
+            impl = "-";
+        }
+
+        for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            ns = bench_case(algos[a].fn, buf, sizes[s], budget_ns);
+            printf("%-10s %-10s %10zu %12.1f %10.2f\n", algos[a].name, impl,
+                   sizes[s], ns, sizes[s] / ns);
+        }
+    }
+
+    chimera_checksum_select(CHIMERA_CHECKSUM_IMPL_AUTO, NULL, NULL);
+    free(buf);
+    return 0;
+} /* main */
@@ -0,0 +1,423 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#include <smmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif /* if defined(__x86_64__) */
+
+#include "common/checksum.h"
+#include "common/macros.h"
+
+/* Reflected polynomials. */
+#define CHIMERA_CRC32_POLY  0xEDB88320u
+#define CHIMERA_CRC32C_POLY 0x82F63B78u
+
+/* Every implementation works on the raw (un-inverted) register; the public
+ * entry points do the pre- and post-inversion. */
+typedef uint32_t (*chimera_crc_fn_t)(
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len);
+
+struct chimera_crc_impl {
+    chimera_crc_fn_t fn;
+    const char      *name;
+};
+
+static uint32_t                chimera_crc32_table[8][256];
+static uint32_t                chimera_crc32c_table[8][256];
+static struct chimera_crc_impl chimera_crc32_impl;
+static struct chimera_crc_impl chimera_crc32c_impl;
+static pthread_once_t          chimera_checksum_once = PTHREAD_ONCE_INIT;
+
+static void
+chimera_crc_table_init(
+    uint32_t table[8][256],
+    uint32_t poly)
+{
+    uint32_t c;
+    int      i, k;
+
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (k = 0; k < 8; k++) {
+            c = (c >> 1) ^ (poly & (uint32_t) (-(int32_t) (c & 1)));
+        }
+        table[0][i] = c;
+    }
+    for (i = 0; i < 256; i++) {
+        for (k = 1; k < 8; k++) {
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+        }
+    }
+} /* chimera_crc_table_init */
+
+/* Slicing-by-8: eight table lookups per 8 input bytes. */
+static inline uint32_t
+chimera_crc_slice8(
+    uint32_t       table[8][256],
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len)
+{
+    uint64_t v;
+    uint32_t lo, hi;
+
+    while (len && ((uintptr_t) p & 7)) {
+        crc = table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        len--;
+    }
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (len >= 8) {
+        memcpy(&v, p, sizeof(v));
+        lo  = (uint32_t) v ^ crc;
+        hi  = (uint32_t) (v >> 32);
+        crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^
+            table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24] ^
+            table[3][hi & 0xff] ^ table[2][(hi >> 8) & 0xff] ^
+            table[1][(hi >> 16) & 0xff] ^ table[0][hi >> 24];
+        p   += 8;
+        len -= 8;
+    }
+#else /* if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ */
+    (void) v;
+    (void) lo;
+    (void) hi;
+#endif /* if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ */
+
+    while (len--) {
+        crc = table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+} /* chimera_crc_slice8 */
+
+static uint32_t
+chimera_crc32_portable(
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len)
+{
+    return chimera_crc_slice8(chimera_crc32_table, crc, p, len);
+} /* chimera_crc32_portable */
+
+static uint32_t
+chimera_crc32c_portable(
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len)
+{
+    return chimera_crc_slice8(chimera_crc32c_table, crc, p, len);
+} /* chimera_crc32c_portable */
+
+#if defined(__x86_64__)
+
+/* CRC-32C with the SSE4.2 crc32 instruction, 8 bytes at a time. */
+__attribute__((target("sse4.2")))
+static uint32_t
+chimera_crc32c_sse42(
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len)
+{
+    uint64_t c = crc, v;
+
+    while (len && ((uintptr_t) p & 7)) {
+        c = _mm_crc32_u8((uint32_t) c, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        memcpy(&v, p, sizeof(v));
+        c    = _mm_crc32_u64(c, v);
+        p   += 8;
+        len -= 8;
+    }
+    while (len--) {
+        c = _mm_crc32_u8((uint32_t) c, *p++);
+    }
+    return (uint32_t) c;
+} /* chimera_crc32c_sse42 */
+
+/*
+ * CRC-32 by carry-less multiplication: fold four 128-bit lanes across the
+ * buffer 64 bytes at a time, fold them into one, then Barrett-reduce to 32
+ * bits.  Gopal, Ozturk et al., "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction" (Intel, 2009); the constants are the
+ * bit-reflected k1..k5, P(x) and mu for the IEEE polynomial.  `len` is at
+ * least 64 and a multiple of 16.
+ */
+__attribute__((target("sse4.1,pclmul")))
+static uint32_t
+chimera_crc32_pclmul_fold(
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len)
+{
+    static const uint64_t k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4, 0x01c6e41596 };
+    static const uint64_t k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0, 0x00ccaa009e };
+    static const uint64_t k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124, 0x0000000000 };
+    static const uint64_t poly[2] __attribute__((aligned(16))) = { 0x01db710641, 0x01f7011641 };
+    __m128i               x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i *) (p + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *) (p + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *) (p + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *) (p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+    x0 = _mm_load_si128((const __m128i *) k1k2);
+
+    p   += 64;
+    len -= 64;
+
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128((const __m128i *) (p + 0x00));
+        y6 = _mm_loadu_si128((const __m128i *) (p + 0x10));
+        y7 = _mm_loadu_si128((const __m128i *) (p + 0x20));
+        y8 = _mm_loadu_si128((const __m128i *) (p + 0x30));
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+        p   += 64;
+        len -= 64;
+    }
+
+    /* Four lanes into one. */
+    x0 = _mm_load_si128((const __m128i *) k3k4);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i *) p);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        p   += 16;
+        len -= 16;
+    }
+
+    /* 128 -> 64 bits. */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64((const __m128i *) k5k0);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits. */
+    x0 = _mm_load_si128((const __m128i *) poly);
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t) _mm_extract_epi32(x1, 1);
+} /* chimera_crc32_pclmul_fold */
+
+static uint32_t
+chimera_crc32_pclmul(
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len)
+{
+    size_t bulk;
+
+    if (len >= 64) {
+        bulk = len & ~(size_t) 15;
+        crc  = chimera_crc32_pclmul_fold(crc, p, bulk);
+        p   += bulk;
+        len -= bulk;
+    }
+    return chimera_crc_slice8(chimera_crc32_table, crc, p, len);
+} /* chimera_crc32_pclmul */
+
+#elif defined(__aarch64__)
+
+#if defined(__clang__)
+#define CHIMERA_CRC_TARGET __attribute__((target("crc")))
+#else /* if defined(__clang__) */
+#define CHIMERA_CRC_TARGET __attribute__((target("+crc")))
+#endif /* if defined(__clang__) */
+
+CHIMERA_CRC_TARGET
+static uint32_t
+chimera_crc32_armv8(
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len)
+{
+    uint64_t v;
+
+    while (len && ((uintptr_t) p & 7)) {
+        crc = __crc32b(crc, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        memcpy(&v, p, sizeof(v));
+        crc  = __crc32d(crc, v);
+        p   += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32b(crc, *p++);
+    }
+    return crc;
+} /* chimera_crc32_armv8 */
+
+CHIMERA_CRC_TARGET
+static uint32_t
+chimera_crc32c_armv8(
+    uint32_t       crc,
+    const uint8_t *p,
+    size_t         len)
+{
+    uint64_t v;
+
+    while (len && ((uintptr_t) p & 7)) {
+        crc = __crc32cb(crc, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        memcpy(&v, p, sizeof(v));
+        crc  = __crc32cd(crc, v);
+        p   += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+} /* chimera_crc32c_armv8 */
+
+#endif /* if defined(__x86_64__) */
+
+static void
+chimera_checksum_pick(enum chimera_checksum_impl impl)
+{
+    struct chimera_crc_impl crc32  = { chimera_crc32_portable, "slice8" };
+    struct chimera_crc_impl crc32c = { chimera_crc32c_portable, "slice8" };
+
+    if (impl == CHIMERA_CHECKSUM_IMPL_AUTO) {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2")) {
+            crc32c.fn   = chimera_crc32c_sse42;
+            crc32c.name = "sse4.2";
+        }
+        if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+            crc32.fn   = chimera_crc32_pclmul;
+            crc32.name = "pclmul";
+        }
+#elif defined(__aarch64__)
+        if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+            crc32.fn    = chimera_crc32_armv8;
+            crc32.name  = "armv8-crc";
+            crc32c.fn   = chimera_crc32c_armv8;
+            crc32c.name = "armv8-crc";
+        }
+#endif /* if defined(__x86_64__) */
+    }
+
+    __atomic_store_n(&chimera_crc32_impl.name, crc32.name, __ATOMIC_RELAXED);
+    __atomic_store_n(&chimera_crc32c_impl.name, crc32c.name, __ATOMIC_RELAXED);
+    __atomic_store_n(&chimera_crc32_impl.fn, crc32.fn, __ATOMIC_RELEASE);
+    __atomic_store_n(&chimera_crc32c_impl.fn, crc32c.fn, __ATOMIC_RELEASE);
+} /* chimera_checksum_pick */
+
+static void
+chimera_checksum_init(void)
+{
+    chimera_crc_table_init(chimera_crc32_table, CHIMERA_CRC32_POLY);
+    chimera_crc_table_init(chimera_crc32c_table, CHIMERA_CRC32C_POLY);
+    chimera_checksum_pick(CHIMERA_CHECKSUM_IMPL_AUTO);
+} /* chimera_checksum_init */
+
+static inline chimera_crc_fn_t
+chimera_crc_resolve(struct chimera_crc_impl *impl)
+{
+    chimera_crc_fn_t fn = __atomic_load_n(&impl->fn, __ATOMIC_ACQUIRE);
+
+    if (__builtin_expect(fn == NULL, 0)) {
+        pthread_once(&chimera_checksum_once, chimera_checksum_init);
+        fn = __atomic_load_n(&impl->fn, __ATOMIC_ACQUIRE);
+    }
+    return fn;
+} /* chimera_crc_resolve */
+
+SYMBOL_EXPORT uint32_t
+chimera_crc32(
+    uint32_t    crc,
+    const void *data,
+    size_t      len)
+{
+    return ~chimera_crc_resolve(&chimera_crc32_impl)(~crc, data, len);
+} /* chimera_crc32 */
+
+SYMBOL_EXPORT uint32_t
+chimera_crc32c(
+    uint32_t    crc,
+    const void *data,
+    size_t      len)
+{
+    return ~chimera_crc_resolve(&chimera_crc32c_impl)(~crc, data, len);
+} /* chimera_crc32c */
+
+SYMBOL_EXPORT void
+chimera_checksum_select(
+    enum chimera_checksum_impl impl,
+    const char               **crc32_name,
+    const char               **crc32c_name)
+{
+    pthread_once(&chimera_checksum_once, chimera_checksum_init);
+    chimera_checksum_pick(impl);
+
+    if (crc32_name) {
+        *crc32_name = chimera_crc32_impl.name;
+    }
+    if (crc32c_name) {
+        *crc32c_name = chimera_crc32c_impl.name;
+    }
+} /* chimera_checksum_select */
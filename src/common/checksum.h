@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* XXH3_state_t is only a complete type with the static-linking API. */
+#ifndef XXH_STATIC_LINKING_ONLY
+#define XXH_STATIC_LINKING_ONLY
+#endif /* ifndef XXH_STATIC_LINKING_ONLY */
+#include <xxhash.h>
+
+/*
+ * Common checksums.
+ *
+ *   chimera_crc32   IEEE 802.3 CRC-32 (zlib's crc32), for on-disk formats that
+ *                   already use it (the diskfs superblock)
+ *   chimera_crc32c  Castagnoli CRC-32C (iSCSI, ext4, btrfs)
+ *   chimera_xxh3_*  XXH3, for hash keys and integrity where no fixed
+ *                   polynomial is required; fastest on every CPU we run on
+ *
+ * Both CRCs take the previous result as `crc` (0 to start) and may be chained
+ * across buffers: crc(crc(0, a), b) == crc(0, a || b).  The implementation is
+ * picked at first use from the running CPU -- SSE4.2 crc32 and PCLMULQDQ
+ * folding on x86-64, the ARMv8 CRC32 instructions on aarch64 -- with a
+ * slicing-by-8 table fallback that produces identical results everywhere.
+ */
+
+enum chimera_checksum_impl {
+    CHIMERA_CHECKSUM_IMPL_AUTO,     /* best the CPU supports */
+    CHIMERA_CHECKSUM_IMPL_PORTABLE, /* table-driven fallback */
+};
+
+uint32_t
+chimera_crc32(
+    uint32_t    crc,
+    const void *data,
+    size_t      len);
+
+uint32_t
+chimera_crc32c(
+    uint32_t    crc,
+    const void *data,
+    size_t      len);
+
+/* Force an implementation (tests and benchmarks compare the two); returns
+ * the name of the implementation now in use for each CRC. */
+void
+chimera_checksum_select(
+    enum chimera_checksum_impl impl,
+    const char               **crc32_name,
+    const char               **crc32c_name);
+
+static inline uint64_t
+chimera_xxh3_64(
+    const void *data,
+    size_t      len)
+{
+    return XXH3_64bits(data, len);
+} /* chimera_xxh3_64 */
+
+static inline XXH128_hash_t
+chimera_xxh3_128(
+    const void *data,
+    size_t      len)
+{
+    return XXH3_128bits(data, len);
+} /* chimera_xxh3_128 */
+
+/* Streaming XXH3-64 over discontiguous buffers (an RPC's iovecs); same
+ * result as chimera_xxh3_64 over the concatenation. */
+static inline void
+chimera_xxh3_64_init(XXH3_state_t *state)
+{
+    XXH3_64bits_reset(state);
+} /* chimera_xxh3_64_init */
+
+static inline void
+chimera_xxh3_64_update(
+    XXH3_state_t *state,
+    const void   *data,
+    size_t        len)
+{
+    XXH3_64bits_update(state, data, len);
+} /* chimera_xxh3_64_update */
+
+static inline uint64_t
+chimera_xxh3_64_final(const XXH3_state_t *state)
+{
+    return XXH3_64bits_digest(state);
+} /* chimera_xxh3_64_final */
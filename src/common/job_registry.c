@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <string.h>
+#include <pthread.h>
+
+#include "common/job_registry.h"
+#include "common/macros.h"
+
+static struct chimera_job *chimera_jobs;
+static pthread_mutex_t     chimera_jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+SYMBOL_EXPORT void
+chimera_job_register(struct chimera_job *job)
+{
+    pthread_mutex_lock(&chimera_jobs_mutex);
+    job->next    = chimera_jobs;
+    chimera_jobs = job;
+    pthread_mutex_unlock(&chimera_jobs_mutex);
+} /* chimera_job_register */
+
+SYMBOL_EXPORT void
+chimera_job_unregister(struct chimera_job *job)
+{
+    struct chimera_job **pp;
+
+    pthread_mutex_lock(&chimera_jobs_mutex);
+
+    for (pp = &chimera_jobs; *pp; pp = &(*pp)->next) {
+        if (*pp == job) {
+            *pp = job->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&chimera_jobs_mutex);
+
+    job->next = NULL;
+} /* chimera_job_unregister */
+
+SYMBOL_EXPORT void
+chimera_job_foreach(
+    void (*fn)(struct chimera_job *job, void *arg),
+    void *arg)
+{
+    struct chimera_job *job;
+
+    pthread_mutex_lock(&chimera_jobs_mutex);
+
+    for (job = chimera_jobs; job; job = job->next) {
+        fn(job, arg);
+    }
+
+    pthread_mutex_unlock(&chimera_jobs_mutex);
+} /* chimera_job_foreach */
+
+SYMBOL_EXPORT int
+chimera_job_find(
+    const char *name,
+    void (*fn)(struct chimera_job *job, void *arg),
+    void *arg)
+{
+    struct chimera_job *job;
+
+    pthread_mutex_lock(&chimera_jobs_mutex);
+
+    for (job = chimera_jobs; job; job = job->next) {
+        if (strcmp(job->name, name) == 0) {
+            fn(job, arg);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&chimera_jobs_mutex);
+
+    return job ? 0 : -1;
+} /* chimera_job_find */
@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#pragma once
+
+#include <stdint.h>
+
+#include "common/misc.h"
+
+/*
+ * Background job registry.
+ *
+ * Long-running maintenance work owned by a module (diskfs online
+ * defragmentation, for one) registers a job here so the REST API can list
+ * it and steer it without knowing the module.  The owner embeds the entry,
+ * publishes its state and named progress counters in it with relaxed
+ * atomics, and receives control requests through its ops.
+ *
+ * Only start is required; a job that leaves set_enabled or set_rate NULL
+ * does not report or accept that setting.
+ *
+ * Ops are invoked with the registry lock held, so they never race
+ * chimera_job_unregister; they must only flag the request for the owning
+ * thread (or otherwise be quick) and must not call back into the registry.
+ */
+
+#define CHIMERA_JOB_NAME_MAX     48
+#define CHIMERA_JOB_COUNTERS_MAX 16
+
+struct chimera_job;
+
+struct chimera_job_ops {
+    /* Allow or stop background scheduling; NULL for a job that only runs
+     * when started. */
+    void (*set_enabled)(
+        struct chimera_job *job,
+        int                 enabled);
+    /* I/O budget in bytes per second; 0 = unlimited.  NULL for a job with
+     * no budget. */
+    void (*set_rate)(
+        struct chimera_job *job,
+        uint64_t            bytes_per_sec);
+    /* Run one pass now, even while disabled. */
+    void (*start)(
+        struct chimera_job *job);
+};
+
+struct chimera_job {
+    struct chimera_job           *next;
+    char                          name[CHIMERA_JOB_NAME_MAX];
+    const struct chimera_job_ops *ops;
+    void                         *private_data;
+
+    /* Written by the owner, read by the REST API */
+    int                           enabled;
+    int                           running;
+    uint64_t                      rate;
+    int                           ncounters;
+    const char                   *counter_names[CHIMERA_JOB_COUNTERS_MAX];
+    uint64_t                      counters[CHIMERA_JOB_COUNTERS_MAX];
+};
+
+/* Publish `job`; its name, ops and counter names must already be set. */
+void
+chimera_job_register(
+    struct chimera_job *job);
+
+/* Withdraw `job`; once this returns no op is running or will run on it. */
+void
+chimera_job_unregister(
+    struct chimera_job *job);
+
+/* Call `fn` on every registered job, with the registry lock held. */
+void
+chimera_job_foreach(
+    void (*fn)(struct chimera_job *job, void *arg),
+    void *arg);
+
+/*
+ * Call `fn` on the job called `name`, with the registry lock held.
+ * Returns 0, or -1 if no such job is registered.
+ */
+int
+chimera_job_find(
+    const char *name,
+    void (*fn)(struct chimera_job *job, void *arg),
+    void *arg);
+
+static inline void
+chimera_job_counter_add(
+    struct chimera_job *job,
+    int                 idx,
+    uint64_t            delta)
+{
+    __atomic_fetch_add(&job->counters[idx], delta, __ATOMIC_RELAXED);
+} /* chimera_job_counter_add */
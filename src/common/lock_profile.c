@@ -0,0 +1,169 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/lock_profile.h"
+#include "common/logging.h"
+#include "common/macros.h"
+
+SYMBOL_EXPORT int                 chimera_lock_profile_enabled;
+
+static struct chimera_lock_class *chimera_lock_classes;
+static pthread_mutex_t            chimera_lock_classes_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+SYMBOL_EXPORT void
+chimera_lock_profile_enable(int enabled)
+{
+    __atomic_store_n(&chimera_lock_profile_enabled, !!enabled, __ATOMIC_RELAXED);
+} /* chimera_lock_profile_enable */
+
+SYMBOL_EXPORT int
+chimera_lock_profile_is_enabled(void)
+{
+    return __atomic_load_n(&chimera_lock_profile_enabled, __ATOMIC_RELAXED);
+} /* chimera_lock_profile_is_enabled */
+
+SYMBOL_EXPORT void
+chimera_lock_profile_reset(void)
+{
+    struct chimera_lock_class *cls;
+    int                        i;
+
+    for (cls = chimera_lock_class_first(); cls; cls = cls->next) {
+        __atomic_store_n(&cls->acquisitions, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&cls->contended, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&cls->wait_ns, 0, __ATOMIC_RELAXED);
+
+        for (i = 0; i < CHIMERA_LOCK_WAIT_BUCKETS; i++) {
+            __atomic_store_n(&cls->wait_buckets[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+} /* chimera_lock_profile_reset */
+
+SYMBOL_EXPORT struct chimera_lock_class *
+chimera_lock_class_get(const char *name)
+{
+    struct chimera_lock_class *cls;
+
+    pthread_mutex_lock(&chimera_lock_classes_mutex);
+
+    for (cls = chimera_lock_classes; cls; cls = cls->next) {
+        if (strcmp(cls->name, name) == 0) {
+            break;
+        }
+    }
+
+    if (!cls) {
+        cls = calloc(1, sizeof(*cls));
+
+        chimera_abort_if(!cls, "common", __FILE__, __LINE__,
+                         "Failed to allocate lock class %s", name);
+
+        snprintf(cls->name, sizeof(cls->name), "%s", name);
+
+        cls->next = chimera_lock_classes;
+
+        /* Publish fully initialized; readers walk the list without the mutex */
+        __atomic_store_n(&chimera_lock_classes, cls, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&chimera_lock_classes_mutex);
+
+    return cls;
+} /* chimera_lock_class_get */
+
+SYMBOL_EXPORT struct chimera_lock_class *
+chimera_lock_class_first(void)
+{
+    return __atomic_load_n(&chimera_lock_classes, __ATOMIC_ACQUIRE);
+} /* chimera_lock_class_first */
+
+SYMBOL_EXPORT void
+chimera_lock_profile_record_wait(
+    struct chimera_lock_class *cls,
+    uint64_t                   wait_ns)
+{
+    /* Smallest b with wait_ns <= 2^b, matching the scraped le labels */
+    int bucket = wait_ns > 1 ? 64 - __builtin_clzll(wait_ns - 1) : 0;
+
+    if (bucket >= CHIMERA_LOCK_WAIT_BUCKETS) {
+        bucket = CHIMERA_LOCK_WAIT_BUCKETS - 1;
+    }
+
+    __atomic_fetch_add(&cls->contended, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cls->wait_ns, wait_ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cls->wait_buckets[bucket], 1, __ATOMIC_RELAXED);
+} /* chimera_lock_profile_record_wait */
+
+#define LOCK_PROFILE_APPEND(...)                                      \
+        do {                                                          \
+            int n_ = snprintf(buf + len, cap - len, __VA_ARGS__);     \
+            if (n_ < 0 || n_ >= cap - len) {                          \
+                return -1;                                            \
+            }                                                         \
+            len += n_;                                                \
+        } while (0)
+
+SYMBOL_EXPORT int
+chimera_lock_profile_scrape(
+    char *buf,
+    int   cap,
+    void *private_data)
+{
+    struct chimera_lock_class *cls;
+    uint64_t                   cumulative;
+    int                        len = 0, i;
+
+    LOCK_PROFILE_APPEND("# HELP chimera_lock_profile_enabled Whether lock contention profiling is enabled\n"
+                        "# TYPE chimera_lock_profile_enabled gauge\n"
+                        "chimera_lock_profile_enabled %d\n",
+                        chimera_lock_profile_is_enabled());
+
+    if (!chimera_lock_class_first()) {
+        return len;
+    }
+
+    LOCK_PROFILE_APPEND("# HELP chimera_lock_acquisitions_total Profiled mutex acquisitions\n"
+                        "# TYPE chimera_lock_acquisitions_total counter\n");
+
+    for (cls = chimera_lock_class_first(); cls; cls = cls->next) {
+        LOCK_PROFILE_APPEND("chimera_lock_acquisitions_total{class=\"%s\"} %lu\n", cls->name,
+                            __atomic_load_n(&cls->acquisitions, __ATOMIC_RELAXED));
+    }
+
+    LOCK_PROFILE_APPEND("# HELP chimera_lock_contended_total Profiled mutex acquisitions that had to wait\n"
+                        "# TYPE chimera_lock_contended_total counter\n");
+
+    for (cls = chimera_lock_class_first(); cls; cls = cls->next) {
+        LOCK_PROFILE_APPEND("chimera_lock_contended_total{class=\"%s\"} %lu\n", cls->name,
+                            __atomic_load_n(&cls->contended, __ATOMIC_RELAXED));
+    }
+
+    LOCK_PROFILE_APPEND("# HELP chimera_lock_wait_nanoseconds Time spent waiting for contended mutexes\n"
+                        "# TYPE chimera_lock_wait_nanoseconds histogram\n");
+
+    for (cls = chimera_lock_class_first(); cls; cls = cls->next) {
+        cumulative = 0;
+
+        for (i = 0; i < CHIMERA_LOCK_WAIT_BUCKETS - 1; i++) {
+            cumulative += __atomic_load_n(&cls->wait_buckets[i], __ATOMIC_RELAXED);
+            LOCK_PROFILE_APPEND("chimera_lock_wait_nanoseconds_bucket{class=\"%s\",le=\"%lu\"} %lu\n",
+                                cls->name, 1UL << i, cumulative);
+        }
+
+        cumulative += __atomic_load_n(&cls->wait_buckets[i], __ATOMIC_RELAXED);
+
+        LOCK_PROFILE_APPEND("chimera_lock_wait_nanoseconds_bucket{class=\"%s\",le=\"+Inf\"} %lu\n"
+                            "chimera_lock_wait_nanoseconds_sum{class=\"%s\"} %lu\n"
+                            "chimera_lock_wait_nanoseconds_count{class=\"%s\"} %lu\n",
+                            cls->name, cumulative,
+                            cls->name, __atomic_load_n(&cls->wait_ns, __ATOMIC_RELAXED),
+                            cls->name, cumulative);
+    }
+
+    return len;
+} /* chimera_lock_profile_scrape */
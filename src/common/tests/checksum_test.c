@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "common/checksum.h"
+
+/* Bit-at-a-time reference (the loop space_map.h used for the superblock). */
+static uint32_t
+crc_reference(
+    uint32_t       poly,
+    const uint8_t *p,
+    size_t         len)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t   i;
+    int      k;
+
+    for (i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (poly & (uint32_t) (-(int32_t) (crc & 1)));
+        }
+    }
+    return ~crc;
+} /* crc_reference */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    static const enum chimera_checksum_impl impls[] = {
+        CHIMERA_CHECKSUM_IMPL_PORTABLE,
+        CHIMERA_CHECKSUM_IMPL_AUTO,
+    };
+    const char                             *name32, *name32c;
+    uint8_t                                *buf;
+    XXH3_state_t                            state;
+    size_t                                  len, off, split;
+    unsigned int                            i;
+
+    buf = malloc(4096 + 64);
+    srand(1);
+    for (len = 0; len < 4096 + 64; len++) {
+        buf[len] = (uint8_t) rand();
+    }
+
+    for (i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+        chimera_checksum_select(impls[i], &name32, &name32c);
+        fprintf(stderr, "crc32 %s, crc32c %s\n", name32, name32c);
+
+        // Standard check values
+        assert(chimera_crc32(0, "123456789", 9) == 0xCBF43926u);
+        assert(chimera_crc32c(0, "123456789", 9) == 0xE3069283u);
+        assert(chimera_crc32(0, NULL, 0) == 0);
+        assert(chimera_crc32c(0, NULL, 0) == 0);
+
+        // Every length and alignment around the vector paths' edges
+        for (off = 0; off < 16; off++) {
+            for (len = 0; len <= 300; len++) {
+                assert(chimera_crc32(0, buf + off, len) ==
+                       crc_reference(0xEDB88320u, buf + off, len));
+                assert(chimera_crc32c(0, buf + off, len) ==
+                       crc_reference(0x82F63B78u, buf + off, len));
+            }
+        }
+        assert(chimera_crc32(0, buf, 4096) == crc_reference(0xEDB88320u, buf, 4096));
+        assert(chimera_crc32c(0, buf + 3, 4093) == crc_reference(0x82F63B78u, buf + 3, 4093));
+
+        // Chaining across buffers matches one pass
+        for (split = 0; split <= 4096; split += 129) {
+            assert(chimera_crc32(chimera_crc32(0, buf, split), buf + split, 4096 - split) ==
+                   chimera_crc32(0, buf, 4096));
+            assert(chimera_crc32c(chimera_crc32c(0, buf, split), buf + split, 4096 - split) ==
+                   chimera_crc32c(0, buf, 4096));
+        }
+    }
+
+    // Streaming XXH3 matches one-shot over the concatenation
+    chimera_xxh3_64_init(&state);
+    chimera_xxh3_64_update(&state, buf, 1000);
+    chimera_xxh3_64_update(&state, buf + 1000, 3096);
+    assert(chimera_xxh3_64_final(&state) == chimera_xxh3_64(buf, 4096));
+
+    free(buf);
+    return 0;
+} /* main */
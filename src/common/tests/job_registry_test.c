@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "common/job_registry.h"
+
+static void
+test_set_enabled(
+    struct chimera_job *job,
+    int                 enabled)
+{
+    job->enabled = enabled;
+} /* test_set_enabled */
+
+static void
+test_set_rate(
+    struct chimera_job *job,
+    uint64_t            bytes_per_sec)
+{
+    job->rate = bytes_per_sec;
+} /* test_set_rate */
+
+static void
+test_start(struct chimera_job *job)
+{
+    chimera_job_counter_add(job, 0, 1);
+} /* test_start */
+
+static const struct chimera_job_ops test_ops = {
+    .set_enabled = test_set_enabled,
+    .set_rate    = test_set_rate,
+    .start       = test_start,
+};
+
+static void
+count_jobs(
+    struct chimera_job *job,
+    void               *arg)
+{
+    (void) job;
+    (*(int *) arg)++;
+} /* count_jobs */
+
+static void
+enable_and_start(
+    struct chimera_job *job,
+    void               *arg)
+{
+    job->ops->set_enabled(job, 1);
+    job->ops->set_rate(job, *(uint64_t *) arg);
+    job->ops->start(job);
+} /* enable_and_start */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct chimera_job a = { .ops = &test_ops, .ncounters = 1 };
+    struct chimera_job b = { .ops = &test_ops, .ncounters = 1 };
+    uint64_t           rate = 1 << 20;
+    int                n;
+
+    snprintf(a.name, sizeof(a.name), "job_a");
+    snprintf(b.name, sizeof(b.name), "job_b");
+    a.counter_names[0] = "starts";
+    b.counter_names[0] = "starts";
+
+    // Empty registry
+    n = 0;
+    chimera_job_foreach(count_jobs, &n);
+    assert(n == 0);
+    assert(chimera_job_find("job_a", enable_and_start, &rate) == -1);
+
+    chimera_job_register(&a);
+    chimera_job_register(&b);
+
+    n = 0;
+    chimera_job_foreach(count_jobs, &n);
+    assert(n == 2);
+
+    // Lookup by name reaches only that job's ops
+    assert(chimera_job_find("job_b", enable_and_start, &rate) == 0);
+    assert(b.enabled && b.rate == rate && b.counters[0] == 1);
+    assert(!a.enabled && a.rate == 0 && a.counters[0] == 0);
+
+    // Unregistered jobs are no longer visible
+    chimera_job_unregister(&b);
+    assert(chimera_job_find("job_b", enable_and_start, &rate) == -1);
+    n = 0;
+    chimera_job_foreach(count_jobs, &n);
+    assert(n == 1);
+
+    chimera_job_unregister(&a);
+    n = 0;
+    chimera_job_foreach(count_jobs, &n);
+    assert(n == 0);
+
+    printf("All tests passed!\n");
+    return 0;
+} /* main */
@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include "common/thread_stats.h"
+
+static void
+spin_us(int us)
+{
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000L +
+             (now.tv_nsec - start.tv_nsec) / 1000 < us);
+} /* spin_us */
+
+static void *
+worker(void *arg)
+{
+    struct chimera_thread_stats **out = arg;
+
+    *out = chimera_thread_stats_register("test_pool");
+    chimera_thread_stats_work(5);
+    chimera_thread_stats_iteration_end();
+    chimera_thread_stats_unregister();
+
+    return NULL;
+} /* worker */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct chimera_thread_stats *stats, *other, *reused;
+    pthread_t                    thread;
+    char                        *buf;
+    int                          len, rc;
+
+    // Nothing registered: nothing scraped, work on an unregistered thread is ignored
+    assert(chimera_thread_stats_first() == NULL);
+    chimera_thread_stats_work(1);
+    assert(chimera_thread_stats_scrape(NULL, 0, NULL) == 0);
+
+    stats = chimera_thread_stats_register("test_pool");
+    assert(stats->index == 0);
+    assert(chimera_thread_stats_current == stats);
+
+    // Nested registration shares the entry regardless of the pool asked for
+    assert(chimera_thread_stats_register("other_pool") == stats);
+    chimera_thread_stats_unregister();
+    assert(chimera_thread_stats_current == stats);
+
+    // Iterations with work are charged busy, those without poll; the clock
+    // is read at state changes, so each boundary is one iteration late
+    chimera_thread_stats_work(1);
+    chimera_thread_stats_iteration_end();
+    spin_us(2000);
+    chimera_thread_stats_work(2);
+    chimera_thread_stats_iteration_end();
+    assert(stats->busy_ns == 0);
+    spin_us(2000);
+    chimera_thread_stats_iteration_end();
+    assert(stats->busy_ns >= 4000000);
+    spin_us(2000);
+    chimera_thread_stats_iteration_end();
+    chimera_thread_stats_pre_wait();
+    assert(stats->processed == 3);
+    assert(stats->poll_ns >= 2000000);
+
+    // Time between pre_wait and post_wait is idle
+    spin_us(2000);
+    chimera_thread_stats_post_wait();
+    assert(stats->idle_ns >= 2000000);
+
+    // Queue depth is adjusted by producers and consumers
+    chimera_thread_stats_queue(stats, 4);
+    chimera_thread_stats_queue(stats, -1);
+    assert(stats->queue_depth == 3);
+
+    // A second thread in the same pool gets the next index
+    rc = pthread_create(&thread, NULL, worker, &other);
+    assert(rc == 0);
+    pthread_join(thread, NULL);
+    assert(other != stats && other->index == 1 && !other->active);
+    assert(other->processed == 5);
+
+    // ... and its entry is reused, counters intact, by the next one
+    rc = pthread_create(&thread, NULL, worker, &reused);
+    assert(rc == 0);
+    pthread_join(thread, NULL);
+    assert(reused == other && reused->index == 1);
+    assert(reused->processed == 10);
+
+    // Scrape covers live threads only
+    buf = malloc(64 * 1024);
+    len = chimera_thread_stats_scrape(buf, 64 * 1024, NULL);
+    assert(len > 0);
+    buf[len] = '\0';
+    assert(strstr(buf, "chimera_thread_requests_total{pool=\"test_pool\",thread=\"0\"} 3\n"));
+    assert(strstr(buf, "chimera_thread_queue_depth{pool=\"test_pool\",thread=\"0\"} 3\n"));
+    assert(strstr(buf, "chimera_thread_busy_seconds_total{pool=\"test_pool\",thread=\"0\"} "));
+    assert(!strstr(buf, "thread=\"1\""));
+
+    // A buffer too small to hold the page is reported, not truncated
+    assert(chimera_thread_stats_scrape(buf, 64, NULL) == -1);
+    free(buf);
+
+    chimera_thread_stats_unregister();
+    assert(chimera_thread_stats_current == NULL);
+    assert(!stats->active);
+
+    printf("All tests passed!\n");
+    return 0;
+} /* main */
@@ -0,0 +1,297 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "evpl/evpl.h"
+#include "common/thread_stats.h"
+#include "common/logging.h"
+#include "common/macros.h"
+
+SYMBOL_EXPORT __thread struct chimera_thread_stats *chimera_thread_stats_current;
+
+static struct chimera_thread_stats                 *chimera_thread_stats_list;
+static pthread_mutex_t                              chimera_thread_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline uint64_t
+chimera_thread_stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+} /* chimera_thread_stats_now */
+
+static inline void
+chimera_thread_stats_add(
+    uint64_t *counter,
+    uint64_t  value)
+{
+    /* Single writer: a relaxed load/store pair, no locked instruction */
+    __atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+} /* chimera_thread_stats_add */
+
+/* Charge the time since the last mark to the current awake state. */
+static inline void
+chimera_thread_stats_charge(
+    struct chimera_thread_stats *stats,
+    uint64_t                     now)
+{
+    chimera_thread_stats_add(stats->busy ? &stats->busy_ns : &stats->poll_ns,
+                             now - stats->mark_ns);
+    stats->mark_ns    = now;
+    stats->iterations = 0;
+} /* chimera_thread_stats_charge */
+
+SYMBOL_EXPORT struct chimera_thread_stats *
+chimera_thread_stats_register(const char *pool)
+{
+    struct chimera_thread_stats *stats = chimera_thread_stats_current;
+    int                          index = 0;
+
+    if (stats) {
+        stats->refs++;
+        return stats;
+    }
+
+    pthread_mutex_lock(&chimera_thread_stats_mutex);
+
+    for (stats = chimera_thread_stats_list; stats; stats = stats->next) {
+        if (strcmp(stats->pool, pool) != 0) {
+            continue;
+        }
+
+        if (!stats->active) {
+            break;
+        }
+
+        index++;
+    }
+
+    if (stats) {
+        __atomic_store_n(&stats->queue_depth, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->active, 1, __ATOMIC_RELAXED);
+    } else {
+        stats = calloc(1, sizeof(*stats));
+
+        chimera_abort_if(!stats, "common", __FILE__, __LINE__,
+                         "Failed to allocate thread stats for pool %s", pool);
+
+        snprintf(stats->pool, sizeof(stats->pool), "%s", pool);
+        stats->index  = index;
+        stats->active = 1;
+        stats->next   = chimera_thread_stats_list;
+
+        /* Publish fully initialized; readers walk the list without the mutex */
+        __atomic_store_n(&chimera_thread_stats_list, stats, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&chimera_thread_stats_mutex);
+
+    stats->refs    = 1;
+    stats->busy    = 0;
+    stats->seen    = stats->processed;
+    stats->mark_ns = chimera_thread_stats_now();
+
+    chimera_thread_stats_current = stats;
+
+    return stats;
+} /* chimera_thread_stats_register */
+
+SYMBOL_EXPORT void
+chimera_thread_stats_unregister(void)
+{
+    struct chimera_thread_stats *stats = chimera_thread_stats_current;
+
+    if (!stats || --stats->refs > 0) {
+        return;
+    }
+
+    chimera_thread_stats_charge(stats, chimera_thread_stats_now());
+
+    chimera_thread_stats_current = NULL;
+
+    pthread_mutex_lock(&chimera_thread_stats_mutex);
+    __atomic_store_n(&stats->active, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&chimera_thread_stats_mutex);
+} /* chimera_thread_stats_unregister */
+
+SYMBOL_EXPORT struct chimera_thread_stats *
+chimera_thread_stats_first(void)
+{
+    return __atomic_load_n(&chimera_thread_stats_list, __ATOMIC_ACQUIRE);
+} /* chimera_thread_stats_first */
+
+SYMBOL_EXPORT void
+chimera_thread_stats_iteration_end(void)
+{
+    struct chimera_thread_stats *stats = chimera_thread_stats_current;
+    int                          busy;
+
+    if (unlikely(!stats)) {
+        return;
+    }
+
+    busy        = stats->processed != stats->seen;
+    stats->seen = stats->processed;
+
+    /* Close the running segment when the loop changes state, and now and
+     * then regardless so a thread that stays busy (or stays polling) is
+     * still visible to scrapes. */
+    if (busy != stats->busy || ++stats->iterations >= CHIMERA_THREAD_STATS_FLUSH) {
+        chimera_thread_stats_charge(stats, chimera_thread_stats_now());
+        stats->busy = busy;
+    }
+} /* chimera_thread_stats_iteration_end */
+
+SYMBOL_EXPORT void
+chimera_thread_stats_pre_wait(void)
+{
+    struct chimera_thread_stats *stats = chimera_thread_stats_current;
+
+    if (unlikely(!stats)) {
+        return;
+    }
+
+    chimera_thread_stats_charge(stats, chimera_thread_stats_now());
+} /* chimera_thread_stats_pre_wait */
+
+SYMBOL_EXPORT void
+chimera_thread_stats_post_wait(void)
+{
+    struct chimera_thread_stats *stats = chimera_thread_stats_current;
+    uint64_t                     now;
+
+    if (unlikely(!stats)) {
+        return;
+    }
+
+    now = chimera_thread_stats_now();
+
+    chimera_thread_stats_add(&stats->idle_ns, now - stats->mark_ns);
+
+    stats->mark_ns = now;
+    stats->busy    = 0;
+} /* chimera_thread_stats_post_wait */
+
+static void
+chimera_thread_stats_hook_iteration_end(
+    struct evpl *evpl,
+    void        *private_data)
+{
+    chimera_thread_stats_iteration_end();
+} /* chimera_thread_stats_hook_iteration_end */
+
+static void
+chimera_thread_stats_hook_pre_wait(
+    struct evpl *evpl,
+    void        *private_data)
+{
+    chimera_thread_stats_pre_wait();
+} /* chimera_thread_stats_hook_pre_wait */
+
+static void
+chimera_thread_stats_hook_post_wait(
+    struct evpl *evpl,
+    void        *private_data)
+{
+    chimera_thread_stats_post_wait();
+} /* chimera_thread_stats_hook_post_wait */
+
+SYMBOL_EXPORT const struct evpl_loop_hooks chimera_thread_stats_loop_hooks = {
+    .iteration_end = chimera_thread_stats_hook_iteration_end,
+    .pre_wait      = chimera_thread_stats_hook_pre_wait,
+    .post_wait     = chimera_thread_stats_hook_post_wait,
+};
+
+#define THREAD_STATS_APPEND(...)                                      \
+        do {                                                          \
+            int n_ = snprintf(buf + len, cap - len, __VA_ARGS__);     \
+            if (n_ < 0 || n_ >= cap - len) {                          \
+                return -1;                                            \
+            }                                                         \
+            len += n_;                                                \
+        } while (0)
+
+SYMBOL_EXPORT int
+chimera_thread_stats_scrape(
+    char *buf,
+    int   cap,
+    void *private_data)
+{
+    static const struct {
+        const char *name;
+        const char *help;
+        size_t      offset;
+    } times[] = {
+        { "busy", "Event loop time spent handling work",
+          offsetof(struct chimera_thread_stats, busy_ns) },
+        { "poll", "Event loop time spent awake with nothing to do",
+          offsetof(struct chimera_thread_stats, poll_ns) },
+        { "idle", "Event loop time spent blocked waiting for events",
+          offsetof(struct chimera_thread_stats, idle_ns) },
+    };
+    struct chimera_thread_stats *stats;
+    uint64_t                     ns;
+    int64_t                      depth;
+    int                          len = 0, i;
+
+    if (!chimera_thread_stats_first()) {
+        return 0;
+    }
+
+    for (i = 0; i < (int) (sizeof(times) / sizeof(times[0])); i++) {
+        THREAD_STATS_APPEND("# HELP chimera_thread_%s_seconds_total %s\n"
+                            "# TYPE chimera_thread_%s_seconds_total counter\n",
+                            times[i].name, times[i].help, times[i].name);
+
+        for (stats = chimera_thread_stats_first(); stats; stats = stats->next) {
+            if (!__atomic_load_n(&stats->active, __ATOMIC_RELAXED)) {
+                continue;
+            }
+
+            ns = __atomic_load_n((uint64_t *) ((char *) stats + times[i].offset), __ATOMIC_RELAXED);
+
+            THREAD_STATS_APPEND("chimera_thread_%s_seconds_total{pool=\"%s\",thread=\"%d\"} %lu.%09lu\n",
+                                times[i].name, stats->pool, stats->index,
+                                ns / 1000000000UL, ns % 1000000000UL);
+        }
+    }
+
+    THREAD_STATS_APPEND("# HELP chimera_thread_requests_total Work items handled by the thread\n"
+                        "# TYPE chimera_thread_requests_total counter\n");
+
+    for (stats = chimera_thread_stats_first(); stats; stats = stats->next) {
+        if (!__atomic_load_n(&stats->active, __ATOMIC_RELAXED)) {
+            continue;
+        }
+
+        THREAD_STATS_APPEND("chimera_thread_requests_total{pool=\"%s\",thread=\"%d\"} %lu\n",
+                            stats->pool, stats->index,
+                            __atomic_load_n(&stats->processed, __ATOMIC_RELAXED));
+    }
+
+    THREAD_STATS_APPEND("# HELP chimera_thread_queue_depth Work items queued for the thread\n"
+                        "# TYPE chimera_thread_queue_depth gauge\n");
+
+    for (stats = chimera_thread_stats_first(); stats; stats = stats->next) {
+        if (!__atomic_load_n(&stats->active, __ATOMIC_RELAXED)) {
+            continue;
+        }
+
+        /* A producer racing thread start-up can leave it briefly negative */
+        depth = __atomic_load_n(&stats->queue_depth, __ATOMIC_RELAXED);
+
+        THREAD_STATS_APPEND("chimera_thread_queue_depth{pool=\"%s\",thread=\"%d\"} %ld\n",
+                            stats->pool, stats->index, depth > 0 ? depth : 0);
+    }
+
+    return len;
+} /* chimera_thread_stats_scrape */
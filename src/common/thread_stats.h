@@ -0,0 +1,129 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#pragma once
+
+#include <stdint.h>
+
+#include "common/misc.h"
+
+/*
+ * Per-thread event loop utilisation.
+ *
+ * Every event loop thread worth sizing (server workers, delegation threads,
+ * the close thread, diskfs log and reclaim threads) registers itself under a
+ * pool name and is given a stable index within that pool.  From then on its
+ * loop hooks split wall time three ways:
+ *
+ *   busy  iterations that handled at least one work item
+ *   poll  iterations spent awake that found nothing to do
+ *   idle  time blocked in the kernel waiting for an event
+ *
+ * Code that does work on the thread reports it with chimera_thread_stats_work
+ * (one TLS load and a store), which also feeds the requests-processed count.
+ * Producers that hand work to another thread report it against that thread's
+ * stats with chimera_thread_stats_queue, giving an inbox depth gauge.
+ *
+ * The clock is read only when the loop changes between busy and poll, around
+ * waits, and every CHIMERA_THREAD_STATS_FLUSH iterations so long steady runs
+ * stay current; attribution is therefore accurate to one loop iteration.
+ *
+ * Entries live until process exit and are reused by the next thread that
+ * registers in the same pool, so the registry can be walked without locking.
+ * Scrapes skip entries whose thread has exited.
+ */
+
+#define CHIMERA_THREAD_STATS_POOL_MAX 32
+#define CHIMERA_THREAD_STATS_FLUSH    1024
+
+struct evpl;
+struct evpl_loop_hooks;
+
+struct chimera_thread_stats {
+    struct chimera_thread_stats *next;
+    char                         pool[CHIMERA_THREAD_STATS_POOL_MAX];
+    int                          index;
+    int                          active;
+
+    /* Owner thread only */
+    int                          refs;
+    int                          busy;
+    uint32_t                     iterations;
+    uint64_t                     mark_ns;
+    uint64_t                     seen;
+
+    /* Written by the owner, read by scrapers */
+    uint64_t                     busy_ns;
+    uint64_t                     poll_ns;
+    uint64_t                     idle_ns;
+    uint64_t                     processed;
+
+    /* Written by any thread */
+    int64_t                      queue_depth;
+};
+
+extern __thread struct chimera_thread_stats *chimera_thread_stats_current;
+
+/* evpl loop hooks for threads that have no hooks of their own. */
+extern const struct evpl_loop_hooks          chimera_thread_stats_loop_hooks;
+
+/*
+ * Register the calling thread in `pool` and make it current.  Nested calls on
+ * the same thread return the existing entry (whatever pool it was registered
+ * under) and must be balanced by chimera_thread_stats_unregister.
+ */
+struct chimera_thread_stats *
+chimera_thread_stats_register(
+    const char *pool);
+
+void
+chimera_thread_stats_unregister(void);
+
+/* Head of the registry; follow ->next.  Entries are never freed. */
+struct chimera_thread_stats *
+chimera_thread_stats_first(void);
+
+/* Loop hook bodies, for threads that install hooks of their own. */
+void
+chimera_thread_stats_iteration_end(void);
+
+void
+chimera_thread_stats_pre_wait(void);
+
+void
+chimera_thread_stats_post_wait(void);
+
+/*
+ * Write every registered thread as Prometheus text exposition
+ * (chimera_thread_* series labelled by pool and thread) into `buf`.
+ * Returns the number of bytes written, or -1 if `cap` was too small.
+ * Shaped as a chimera_metrics scraper (private_data unused).
+ */
+int
+chimera_thread_stats_scrape(
+    char *buf,
+    int   cap,
+    void *private_data);
+
+/* Account `count` work items to the calling thread. */
+static inline void
+chimera_thread_stats_work(uint64_t count)
+{
+    struct chimera_thread_stats *stats = chimera_thread_stats_current;
+
+    if (likely(stats)) {
+        __atomic_store_n(&stats->processed, stats->processed + count, __ATOMIC_RELAXED);
+    }
+} /* chimera_thread_stats_work */
+
+/* Adjust the inbox depth of `stats` (another thread's, usually). */
+static inline void
+chimera_thread_stats_queue(
+    struct chimera_thread_stats *stats,
+    int64_t                      delta)
+{
+    if (likely(stats)) {
+        __atomic_fetch_add(&stats->queue_depth, delta, __ATOMIC_RELAXED);
+    }
+} /* chimera_thread_stats_queue */
@@ -23,10 +23,13 @@
 #include "server/server_internal.h"
 #include "common/logging.h"
 #include "common/common_config.h"
+#include "common/lock_profile.h"
+#include "common/thread_stats.h"
 #include "metrics/metrics.h"
 #include "daemon.h"
 
-int SigInt = 0;
+int                   SigInt  = 0;
+volatile sig_atomic_t SigUsr2 = 0;
 
 void
 signal_handler(int sig)
@@ -34,6 +37,12 @@ signal_handler(int sig)
     SigInt = sig;
 } /* signal_handler */
 
+static void
+signal_usr2_handler(int sig)
+{
+    SigUsr2 = 1;
+} /* signal_usr2_handler */
+
 static int
 generate_self_signed_cert(
     const char *cert_path,
@@ -331,6 +340,7 @@ main(
 
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR2, signal_usr2_handler);
 
     chimera_server_info("Initializing server...");
 
@@ -731,6 +741,31 @@ main(
         chimera_server_config_set_rest_debug_fsops(server_config, 1);
     }
 
+    /* Sample one VFS request in every N for the latency trace (0 = off). */
+    json_value = json_object_get(server_params, "trace_sample_interval");
+    if (json_is_integer(json_value)) {
+        chimera_server_config_set_trace_sample_interval(server_config, json_integer_value(json_value));
+    }
+
+    /* Record VFS ops slower than this many microseconds in the slow-op
+     * flight recorder (0 = off). */
+    json_value = json_object_get(server_params, "slow_op_threshold_us");
+    if (json_is_integer(json_value)) {
+        chimera_server_config_set_slow_op_threshold_us(server_config, json_integer_value(json_value));
+    }
+
+    /* Track the heaviest clients, exports, files and directories. */
+    json_value = json_object_get(server_params, "heavy_hitters");
+    if (json_is_boolean(json_value)) {
+        chimera_server_config_set_heavy_hitters(server_config, json_is_true(json_value));
+    }
+
+    /* Count acquisitions and contended waits on the profiled hot mutexes. */
+    json_value = json_object_get(server_params, "lock_profiling");
+    if (json_is_boolean(json_value)) {
+        chimera_server_config_set_lock_profiling(server_config, json_is_true(json_value));
+    }
+
     /* REST API authentication is enabled by default; it can be turned off
      * explicitly with "rest_auth_enabled": false. */
     json_t *rest_auth_enabled_value = json_object_get(server_params, "rest_auth_enabled");
@@ -836,6 +871,10 @@ main(
 
     server = chimera_server_init(server_config, chimera_metrics_get(metrics));
 
+    chimera_metrics_add_scraper(metrics, chimera_server_metrics_scrape, server);
+    chimera_metrics_add_scraper(metrics, chimera_lock_profile_scrape, NULL);
+    chimera_metrics_add_scraper(metrics, chimera_thread_stats_scrape, NULL);
+
     json_t *users = json_object_get(config, "users");
     if (users && json_is_array(users)) {
         json_t *user_entry;
@@ -1046,22 +1085,33 @@ main(
 
     while (!SigInt) {
         sleep(1);
+
+        /* SIGUSR2: dump the slow-op flight recorder to the log */
+        if (SigUsr2) {
+            SigUsr2 = 0;
+            chimera_server_dump_slow_ops(server);
+        }
     }
 
     chimera_server_info("Shutting down server (signal=%d)...", SigInt);
 
-    chimera_server_destroy(server);
-
-    /* Optionally persist a final metrics scrape (common.metrics_file) before
-     * tearing down the registry, so short-lived runs keep their metrics. */
+    /* Optionally persist a final metrics scrape (common.metrics_file) so
+     * short-lived runs keep their metrics.  Taken while the server is still
+     * up: its scraper (heavy hitters) reads live VFS state. */
     {
         const char *metrics_file = chimera_common_metrics_file(config);
 
         if (metrics_file) {
-            chimera_metrics_dump_file(chimera_metrics_get(metrics), metrics_file);
+            chimera_metrics_dump_file(metrics, metrics_file);
         }
     }
 
+    chimera_metrics_remove_scraper(metrics, chimera_thread_stats_scrape, NULL);
+    chimera_metrics_remove_scraper(metrics, chimera_lock_profile_scrape, NULL);
+    chimera_metrics_remove_scraper(metrics, chimera_server_metrics_scrape, server);
+
+    chimera_server_destroy(server);
+
     chimera_metrics_destroy(metrics);
 
     chimera_server_info("Server shutdown complete.");
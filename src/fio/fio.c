@@ -21,6 +21,7 @@
 
 #include "common/macros.h"
 #include "common/common_config.h"
+#include "common/thread_stats.h"
 
 
 #define chimera_fio_debug(...) chimera_debug("fio", __FILE__, __LINE__, __VA_ARGS__)
@@ -38,7 +39,7 @@
 
 pthread_mutex_t               ChimeraClientMutex  = PTHREAD_MUTEX_INITIALIZER;
 int                           ChimeraNumClients   = 0;
-struct prometheus_metrics    *ChimeraMetrics      = NULL;
+struct chimera_metrics       *ChimeraMetrics      = NULL;
 struct chimera_client_config *ChimeraClientConfig = NULL;
 struct chimera_client        *ChimeraClient       = NULL;
 char                         *ChimeraMetricsFile  = NULL;
@@ -257,7 +258,7 @@ fio_chimera_atexit(void)
         }
 
         chimera_destroy(ChimeraClient);
-        prometheus_metrics_destroy(ChimeraMetrics);
+        chimera_metrics_destroy(ChimeraMetrics);
 
         free(ChimeraMetricsFile);
         ChimeraMetricsFile = NULL;
@@ -326,7 +327,9 @@ fio_chimera_init(struct thread_data *td)
         evpl_set_log_fn(chimera_vlog, chimera_log_flush);
 
 
-        ChimeraMetrics = prometheus_metrics_create(NULL, NULL, 0);
+        /* No HTTP endpoint: the registry is only dumped at exit. */
+        ChimeraMetrics = chimera_metrics_init(0);
+        chimera_metrics_add_scraper(ChimeraMetrics, chimera_thread_stats_scrape, NULL);
 
         ChimeraClientConfig = chimera_client_config_init();
 
@@ -456,7 +459,8 @@ fio_chimera_init(struct thread_data *td)
             }
         }
 
-        ChimeraClient = chimera_client_init(ChimeraClientConfig, &root_cred, ChimeraMetrics);
+        ChimeraClient = chimera_client_init(ChimeraClientConfig, &root_cred,
+                                            chimera_metrics_get(ChimeraMetrics));
 
         evpl          = evpl_create(NULL);
         client_thread = chimera_client_thread_init(evpl, ChimeraClient);
@@ -5,10 +5,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "evpl/evpl.h"
 #include "evpl/evpl_http.h"
 #include "common/logging.h"
 #include "common/macros.h"
+#include "metrics.h"
 #include "prometheus-c.h"
 
 #define chimera_metrics_debug(...) chimera_debug("metrics", __FILE__, __LINE__, __VA_ARGS__)
@@ -23,17 +25,91 @@
 #define chimera_metrics_fatal_if(cond, ...) \
         chimera_fatal_if(cond, "metrics", __FILE__, __LINE__, __VA_ARGS__)
 
+struct chimera_metrics_scraper {
+    chimera_metrics_scrape_cb       callback;
+    void                           *private_data;
+    struct chimera_metrics_scraper *next;
+};
+
 struct chimera_metrics {
-    int                        port;
-    struct prometheus_metrics *metrics;
-    struct evpl               *evpl;
-    struct evpl_thread        *thread;
-    struct evpl_endpoint      *endpoint;
-    struct evpl_listener      *listener;
-    struct evpl_http_agent    *agent;
-    struct evpl_http_server   *server;
+    int                             port;
+    struct prometheus_metrics      *metrics;
+    struct evpl                    *evpl;
+    struct evpl_thread             *thread;
+    struct evpl_endpoint           *endpoint;
+    struct evpl_listener           *listener;
+    struct evpl_http_agent         *agent;
+    struct evpl_http_server        *server;
+    pthread_mutex_t                 scrapers_lock;
+    struct chimera_metrics_scraper *scrapers;
 };
 
+static int
+chimera_metrics_run_scrapers(
+    struct chimera_metrics *metrics,
+    char                   *buf,
+    int                     cap)
+{
+    struct chimera_metrics_scraper *scraper;
+    int                             len = 0, n;
+
+    pthread_mutex_lock(&metrics->scrapers_lock);
+
+    for (scraper = metrics->scrapers; scraper; scraper = scraper->next) {
+        n = scraper->callback(buf + len, cap - len, scraper->private_data);
+
+        if (n < 0) {
+            len = -1;
+            break;
+        }
+
+        len += n;
+    }
+
+    pthread_mutex_unlock(&metrics->scrapers_lock);
+
+    return len;
+} /* chimera_metrics_run_scrapers */
+
+/*
+ * The full exposition page: chimera's own registry first, then libevpl's
+ * metrics and every registered scraper appended into the remaining space.
+ * All emit Prometheus text format with distinct metric names (evpl_* only
+ * from libevpl, each scraper its own prefix), so the concatenation is a
+ * valid single page.  Returns the bytes written, or -1 if `cap` was too
+ * small.
+ */
+static int
+chimera_metrics_scrape_all(
+    struct chimera_metrics *metrics,
+    char                   *buf,
+    int                     cap)
+{
+    int len, n;
+
+    len = prometheus_metrics_scrape(metrics->metrics, buf, cap);
+
+    if (len < 0) {
+        return -1;
+    }
+
+    n = evpl_metrics_scrape(buf + len, cap - len);
+
+    if (n < 0) {
+        return -1;
+    }
+
+    len += n;
+
+    n = chimera_metrics_run_scrapers(metrics, buf + len, cap - len);
+
+    if (n < 0) {
+        return -1;
+    }
+
+    return len + n;
+} /* chimera_metrics_scrape_all */
+
 static void
 chimera_metrics_notify(
     struct evpl                *evpl,
@@ -49,8 +125,7 @@ chimera_metrics_notify(
     struct evpl_iovec       iov;
     char                   *buf;
     int                     cap;
-    ssize_t                 len;
-    int                     evpl_len;
+    int                     len;
     int                     n;
 
     switch (notify_type) {
@@ -73,12 +148,7 @@ chimera_metrics_notify(
             buf = (char *) evpl_iovec_data(&iov);
             cap = evpl_iovec_length(&iov);
 
-            /* Chimera's own metrics first, then libevpl's appended into
-             * the remaining space.  Both emit Prometheus text format and
-             * use disjoint name prefixes (chimera_* vs evpl_*), so the
-             * concatenation is a valid single exposition page.
-             */
-            len = prometheus_metrics_scrape(metrics->metrics, buf, cap);
+            len = chimera_metrics_scrape_all(metrics, buf, cap);
 
             if (len < 0) {
                 evpl_iovec_release(evpl, &iov);
@@ -87,17 +157,6 @@ chimera_metrics_notify(
                 break;
             }
 
-            evpl_len = evpl_metrics_scrape(buf + len, cap - len);
-
-            if (evpl_len < 0) {
-                evpl_iovec_release(evpl, &iov);
-                evpl_http_server_set_response_length(request, 0);
-                evpl_http_server_dispatch_default(request, 500);
-                break;
-            }
-
-            len += evpl_len;
-
             evpl_iovec_set_length(&iov, len);
 
             evpl_http_server_set_response_length(request, len);
@@ -132,8 +191,6 @@ chimera_metrics_thread_init(
 {
     struct chimera_metrics *metrics = private_data;
 
-    metrics->metrics = prometheus_metrics_create(NULL, NULL, 0);
-
     metrics->endpoint = evpl_endpoint_create("0.0.0.0", metrics->port);
 
     metrics->agent = evpl_http_init(evpl);
@@ -157,8 +214,6 @@ chimera_metrics_thread_shutdown(
 {
     struct chimera_metrics *metrics = private_data;
 
-    prometheus_metrics_destroy(metrics->metrics);
-
     evpl_http_server_destroy(metrics->agent, metrics->server);
     evpl_listener_destroy(metrics->listener);
     evpl_http_destroy(metrics->agent);
@@ -170,12 +225,17 @@ chimera_metrics_init(int port)
 {
     struct chimera_metrics *metrics = calloc(1, sizeof(*metrics));
 
-    metrics->port = port;
+    metrics->port    = port;
+    metrics->metrics = prometheus_metrics_create(NULL, NULL, 0);
+
+    pthread_mutex_init(&metrics->scrapers_lock, NULL);
 
-    metrics->thread = evpl_thread_create(NULL,
-                                         chimera_metrics_thread_init,
-                                         chimera_metrics_thread_shutdown,
-                                         metrics);
+    if (port > 0) {
+        metrics->thread = evpl_thread_create(NULL,
+                                             chimera_metrics_thread_init,
+                                             chimera_metrics_thread_shutdown,
+                                             metrics);
+    }
 
     return metrics;
 } /* chimera_metrics_init */
@@ -183,7 +243,21 @@ chimera_metrics_init(int port)
 SYMBOL_EXPORT void
 chimera_metrics_destroy(struct chimera_metrics *metrics)
 {
-    evpl_thread_destroy(metrics->thread);
+    struct chimera_metrics_scraper *scraper;
+
+    if (metrics->thread) {
+        evpl_thread_destroy(metrics->thread);
+    }
+
+    while (metrics->scrapers) {
+        scraper           = metrics->scrapers;
+        metrics->scrapers = scraper->next;
+        free(scraper);
+    }
+
+    pthread_mutex_destroy(&metrics->scrapers_lock);
+
+    prometheus_metrics_destroy(metrics->metrics);
 
     free(metrics);
 } /* chimera_metrics_destroy */
@@ -194,15 +268,57 @@ chimera_metrics_get(struct chimera_metrics *metrics)
     return metrics->metrics;
 } /* chimera_metrics_get */
 
+SYMBOL_EXPORT void
+chimera_metrics_add_scraper(
+    struct chimera_metrics   *metrics,
+    chimera_metrics_scrape_cb callback,
+    void                     *private_data)
+{
+    struct chimera_metrics_scraper *scraper = calloc(1, sizeof(*scraper));
+
+    chimera_metrics_abort_if(!scraper, "Failed to allocate metrics scraper");
+
+    scraper->callback     = callback;
+    scraper->private_data = private_data;
+
+    pthread_mutex_lock(&metrics->scrapers_lock);
+    scraper->next     = metrics->scrapers;
+    metrics->scrapers = scraper;
+    pthread_mutex_unlock(&metrics->scrapers_lock);
+} /* chimera_metrics_add_scraper */
+
+SYMBOL_EXPORT void
+chimera_metrics_remove_scraper(
+    struct chimera_metrics   *metrics,
+    chimera_metrics_scrape_cb callback,
+    void                     *private_data)
+{
+    struct chimera_metrics_scraper **pp, *scraper;
+
+    pthread_mutex_lock(&metrics->scrapers_lock);
+
+    for (pp = &metrics->scrapers; *pp; pp = &(*pp)->next) {
+        scraper = *pp;
+
+        if (scraper->callback == callback && scraper->private_data == private_data) {
+            *pp = scraper->next;
+            free(scraper);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&metrics->scrapers_lock);
+} /* chimera_metrics_remove_scraper */
+
 SYMBOL_EXPORT int
 chimera_metrics_dump_file(
-    struct prometheus_metrics *metrics,
-    const char                *path)
+    struct chimera_metrics *metrics,
+    const char             *path)
 {
     FILE  *fp;
     char  *buf;
     int    cap = 4 * 1024 * 1024;
-    int    len, evpl_len;
+    int    len;
     size_t written;
 
     if (!path) {
@@ -216,25 +332,15 @@ chimera_metrics_dump_file(
         return -1;
     }
 
-    /* Same concatenation the live /metrics endpoint produces: chimera's own
-     * registry first, then libevpl's appended into the remaining space.  Both
-     * emit Prometheus text format with disjoint name prefixes (chimera_* vs
-     * evpl_*), so the result is a single valid exposition page.
-     */
-    len = prometheus_metrics_scrape(metrics, buf, cap);
+    /* Same page the live /metrics endpoint serves, scrapers included. */
+    len = chimera_metrics_scrape_all(metrics, buf, cap);
 
     if (len < 0) {
-        chimera_metrics_error("Failed to scrape chimera metrics for %s", path);
+        chimera_metrics_error("Failed to scrape metrics for %s", path);
         free(buf);
         return -1;
     }
 
-    evpl_len = evpl_metrics_scrape(buf + len, cap - len);
-
-    if (evpl_len > 0) {
-        len += evpl_len;
-    }
-
     fp = fopen(path, "w");
 
     if (!fp) {
@@ -8,6 +8,11 @@
 
 struct chimera_metrics;
 
+/*
+ * Create the prometheus registry and serve it on GET :PORT/metrics.  With
+ * `port` 0 nothing is served: the registry and scrapers exist only for
+ * chimera_metrics_dump_file (in-process tools such as the fio engine).
+ */
 struct chimera_metrics * chimera_metrics_init(
     int port);
 
@@ -18,12 +23,35 @@ struct prometheus_metrics * chimera_metrics_get(
     struct chimera_metrics *metrics);
 
 /*
- * Scrape chimera's prometheus registry plus libevpl's metrics and write the
- * combined Prometheus text exposition (identical to GET :PORT/metrics) to
- * `path`, truncating it.  Intended to be called once at shutdown so that very
- * short-lived processes can retain their metrics after exiting.  No-op when
- * `path` is NULL.  Returns 0 on success, -1 on error.
+ * Extra exposition appended to every GET :PORT/metrics response, for series
+ * whose label sets are only known at scrape time.  The callback writes
+ * Prometheus text into `buf` and returns the bytes written, or -1 if `cap`
+ * was too small.  It runs on the metrics thread; remove it before whatever
+ * it reads is torn down.
+ */
+typedef int (*chimera_metrics_scrape_cb)(
+    char *buf,
+    int   cap,
+    void *private_data);
+
+void chimera_metrics_add_scraper(
+    struct chimera_metrics   *metrics,
+    chimera_metrics_scrape_cb callback,
+    void                     *private_data);
+
+void chimera_metrics_remove_scraper(
+    struct chimera_metrics   *metrics,
+    chimera_metrics_scrape_cb callback,
+    void                     *private_data);
+
+/*
+ * Scrape chimera's prometheus registry, libevpl's metrics and every
+ * registered scraper and write the combined Prometheus text exposition
+ * (identical to GET :PORT/metrics) to `path`, truncating it.  Intended to be
+ * called once at shutdown, before the scrapers' sources are torn down, so
+ * that very short-lived processes can retain their metrics after exiting.
+ * No-op when `path` is NULL.  Returns 0 on success, -1 on error.
  */
 int chimera_metrics_dump_file(
-    struct prometheus_metrics *metrics,
-    const char                *path);
\ No newline at end of file
+    struct chimera_metrics *metrics,
+    const char             *path);
\ No newline at end of file
@@ -60,6 +60,8 @@ chimera_vfs_error_to_nfsstat3(enum chimera_vfs_error err)
             return NFS3ERR_TOOSMALL;
         case CHIMERA_VFS_EMFILE:
             return NFS3ERR_SERVERFAULT;
+        case CHIMERA_VFS_ENOMEM:
+            return NFS3ERR_JUKEBOX;
         default:
             return NFS3ERR_SERVERFAULT;
     } /* switch */
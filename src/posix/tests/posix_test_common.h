@@ -171,11 +171,86 @@ posix_test_parse_nfs_backend(struct posix_test_env *env)
     return 0;
 } // posix_test_parse_nfs_backend
 
+/*
+ * diskfs feature variants: "diskfs_io_uring_<name>" / "diskfs_aio_<name>" run
+ * the same tests with `cfg` (a JSON object) merged into the generated diskfs
+ * config, so optional on-disk and background features see the whole posix
+ * matrix.  Also usable behind NFS ("nfs3_diskfs_io_uring_<name>").  With
+ * `weighted` the test devices get unequal placement weights (1..4).
+ */
+struct posix_test_diskfs_variant {
+    const char *name;
+    const char *cfg;
+    int         weighted;
+};
+
+static const struct posix_test_diskfs_variant posix_test_diskfs_variants[] = {
+    { "streams", "{\"intent_log_streams\":4}" },
+    /* Group commit is off by default; hold batches open over the streams */
+    { "gcommit", "{\"intent_log_streams\":4,\"group_commit_us\":500}" },
+    /* Unthrottled and never paused for load, so files the tests fragment
+     * are rewritten while the tests still run */
+    { "defrag",  "{\"defrag\":true,\"defrag_rate\":0,\"defrag_busy_pct\":100}" },
+    { "discard", "{\"discard\":true,\"discard_rate\":0}" },
+    /* Smallest compression unit, so the tests' modest writes compress */
+    { "lz4",     "{\"compression\":\"lz4\",\"compression_unit\":8192}" },
+    { "zstd",    "{\"compression\":\"zstd\",\"compression_unit\":8192}" },
+    /* Every read verified while an unthrottled scrub re-reads underneath */
+    { "csum",    "{\"data_checksums\":true,\"scrub\":true,\"scrub_rate\":0}" },
+    /* Smallest stripe unit over a mixed-weight pool */
+    { "stripe",  "{\"stripe_chunk\":1048576}", 1 },
+};
+
+// Helper to split a diskfs backend name into its base and variant.
+// Returns 1 for any diskfs backend, setting *r_variant (NULL for none).
+static inline int
+posix_test_diskfs_parse(
+    const char                              *backend,
+    const struct posix_test_diskfs_variant **r_variant)
+{
+    static const char *bases[] = { "diskfs_io_uring", "diskfs_aio", "diskfs" };
+    const char        *rest;
+    size_t             len;
+    unsigned int       i, v;
+
+    for (i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+        len = strlen(bases[i]);
+
+        if (strncmp(backend, bases[i], len) != 0) {
+            continue;
+        }
+
+        rest = backend + len;
+
+        if (*rest == '\0') {
+            if (r_variant) {
+                *r_variant = NULL;
+            }
+            return 1;
+        }
+
+        if (*rest != '_') {
+            continue;
+        }
+
+        for (v = 0; v < sizeof(posix_test_diskfs_variants) / sizeof(posix_test_diskfs_variants[0]); v++) {
+            if (strcmp(rest + 1, posix_test_diskfs_variants[v].name) == 0) {
+                if (r_variant) {
+                    *r_variant = &posix_test_diskfs_variants[v];
+                }
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+} // posix_test_diskfs_parse
+
 // Helper to get device type for a diskfs variant backend name
 static inline const char *
 posix_test_diskfs_device_type(const char *backend)
 {
-    if (strcmp(backend, "diskfs_aio") == 0) {
+    if (strncmp(backend, "diskfs_aio", 10) == 0) {
         return "libaio";
     }
     return "io_uring";
@@ -185,9 +260,7 @@ posix_test_diskfs_device_type(const char *backend)
 static inline int
 posix_test_is_diskfs(const char *backend)
 {
-    return strcmp(backend, "diskfs") == 0 ||
-           strcmp(backend, "diskfs_io_uring") == 0 ||
-           strcmp(backend, "diskfs_aio") == 0;
+    return posix_test_diskfs_parse(backend, NULL);
 } // posix_test_is_diskfs
 
 /* Optional diskfs-config overrides for tests that need a non-default setup.
@@ -199,6 +272,12 @@ posix_test_is_diskfs(const char *backend)
 static const char *posix_test_diskfs_extra_cfg = NULL;
 static int         posix_test_diskfs_reuse_devices __attribute__ ((unused)) = 0;
 
+/* Optional posix-client config overrides: a JSON object (text) merged into the
+ * client's "config" section, e.g. {"cache_ttl":0} so every lookup and getattr
+ * reaches the backend rather than the VFS name/attribute caches.  Set before
+ * posix_test_init; the diskfs remount applies it too. */
+static const char *posix_test_client_extra_cfg __attribute__ ((unused)) = NULL;
+
 /* When non-zero (set before posix_test_init), posix_test_start_nfs_server also
  * mounts the SAME NFS backend a second time, read-only, under a subdirectory
  * and exposes it via a second export "/share_ro".  The read-write export
@@ -215,18 +294,37 @@ static int posix_test_ro_export __attribute__ ((unused)) = 0;
  * export is mounted at; the read-write export sees it as "/share/ro". */
 #define POSIX_TEST_RO_SUBDIR "ro"
 
+static inline void
+posix_test_diskfs_merge_cfg(
+    json_t     *cfg,
+    const char *text)
+{
+    json_t *extra = json_loads(text, 0, NULL);
+
+    if (!extra) {
+        fprintf(stderr, "Bad config override JSON: %s\n", text);
+        exit(EXIT_FAILURE);
+    }
+    json_object_update(cfg, extra);
+    json_decref(extra);
+} // posix_test_diskfs_merge_cfg
+
 // Helper to configure diskfs backend
 static inline void
 posix_test_configure_diskfs(
     const char *session_dir,
-    const char *device_type,
+    const char *backend,
     char       *diskfs_cfg,
     size_t      diskfs_cfg_size)
 {
-    char    device_path[300];
-    json_t *cfg, *devices, *device;
-    int     rc;
-    char   *json_str;
+    const char                             *device_type = posix_test_diskfs_device_type(backend);
+    const struct posix_test_diskfs_variant *variant     = NULL;
+    char                                    device_path[300];
+    json_t                                 *cfg, *devices, *device;
+    int                                     rc;
+    char                                   *json_str;
+
+    posix_test_diskfs_parse(backend, &variant);
 
     cfg     = json_object();
     devices = json_array();
@@ -237,6 +335,9 @@ posix_test_configure_diskfs(
         json_object_set_new(device, "type", json_string(device_type));
         json_object_set_new(device, "size", json_integer(1));
         json_object_set_new(device, "path", json_string(device_path));
+        if (variant && variant->weighted) {
+            json_object_set_new(device, "weight", json_integer(1 + i % 4));
+        }
         json_array_append_new(devices, device);
 
         if (posix_test_diskfs_reuse_devices) {
@@ -270,16 +371,12 @@ posix_test_configure_diskfs(
      * 1 GiB log would not fit the AG-0 metadata reservation (and would eagerly
      * preallocate a multi-GiB block cache). */
     json_object_set_new(cfg, "intent_log_size", json_integer(64 * 1024 * 1024));
+    /* The variant first, so a test's own overrides win */
+    if (variant) {
+        posix_test_diskfs_merge_cfg(cfg, variant->cfg);
+    }
     if (posix_test_diskfs_extra_cfg) {
-        json_t *extra = json_loads(posix_test_diskfs_extra_cfg, 0, NULL);
-
-        if (!extra) {
-            fprintf(stderr, "Bad posix_test_diskfs_extra_cfg JSON: %s\n",
-                    posix_test_diskfs_extra_cfg);
-            exit(EXIT_FAILURE);
-        }
-        json_object_update(cfg, extra);
-        json_decref(extra);
+        posix_test_diskfs_merge_cfg(cfg, posix_test_diskfs_extra_cfg);
     }
     json_str = json_dumps(cfg, JSON_COMPACT);
     snprintf(diskfs_cfg, diskfs_cfg_size, "%s", json_str);
@@ -319,8 +416,7 @@ posix_test_start_nfs_server(struct posix_test_env *env)
     chimera_server_config_set_state_dir(server_config, env->session_dir);
 
     if (posix_test_is_diskfs(nfs_backend_name)) {
-        posix_test_configure_diskfs(env->session_dir,
-                                    posix_test_diskfs_device_type(nfs_backend_name),
+        posix_test_configure_diskfs(env->session_dir, nfs_backend_name,
                                     config_data, sizeof(config_data));
         chimera_server_config_add_module(server_config, "diskfs", NULL, config_data);
     } else if (strcmp(nfs_backend_name, "cairn") == 0) {
@@ -498,8 +594,7 @@ posix_test_init(
             if (posix_test_is_diskfs(backend)) {
                 char    diskfs_cfg[4096];
                 json_t *vfs, *vfs_entry;
-                posix_test_configure_diskfs(env->session_dir,
-                                            posix_test_diskfs_device_type(backend),
+                posix_test_configure_diskfs(env->session_dir, backend,
                                             diskfs_cfg, sizeof(diskfs_cfg));
                 vfs       = json_object();
                 vfs_entry = json_object();
@@ -520,6 +615,10 @@ posix_test_init(
             }
         }
 
+        if (posix_test_client_extra_cfg) {
+            posix_test_diskfs_merge_cfg(posix_json_config, posix_test_client_extra_cfg);
+        }
+
         json_object_set_new(posix_json_root, "config", posix_json_config);
         chimera_test_write_users_json(posix_json_root);
 
@@ -560,7 +659,10 @@ posix_test_cleanup(
         }
     }
 
-    prometheus_metrics_destroy(env->metrics);
+    /* NULL between posix_test_diskfs_stop and posix_test_diskfs_start */
+    if (env->metrics) {
+        prometheus_metrics_destroy(env->metrics);
+    }
 } /* posix_test_cleanup */
 
 __attribute__((noreturn)) static inline void
@@ -617,3 +719,127 @@ posix_test_umount(void)
 {
     return chimera_posix_umount("/test");
 } /* posix_test_umount */
+
+/*
+ * Cold remount for the diskfs-only tests, in two halves so a test can work on
+ * the device images in between: posix_test_diskfs_stop unmounts /test and
+ * tears the client (and the in-process diskfs) down; posix_test_diskfs_start
+ * brings it back up on the same device images without re-initializing and
+ * mounts /test again.  Every cache starts empty, and a dirty filesystem goes
+ * through crash recovery.
+ */
+static inline void
+posix_test_diskfs_stop(struct posix_test_env *env)
+{
+    if (posix_test_umount() != 0) {
+        fprintf(stderr, "Failed to unmount /test: %s\n", strerror(errno));
+        posix_test_fail(env);
+    }
+
+    chimera_posix_shutdown();
+
+    prometheus_metrics_destroy(env->metrics);
+    env->metrics = NULL;
+} /* posix_test_diskfs_stop */
+
+static inline void
+posix_test_diskfs_start(struct posix_test_env *env)
+{
+    char    diskfs_cfg[4096];
+    char    posix_json_path[300];
+    json_t *root, *config, *vfs, *vfs_entry;
+
+    posix_test_diskfs_reuse_devices = 1;
+    posix_test_configure_diskfs(env->session_dir, env->backend,
+                                diskfs_cfg, sizeof(diskfs_cfg));
+
+    root      = json_object();
+    config    = json_object();
+    vfs       = json_object();
+    vfs_entry = json_object();
+    json_object_set_new(vfs_entry, "path", json_string("/build/test/diskfs"));
+    json_object_set_new(vfs_entry, "config", json_string(diskfs_cfg));
+    json_object_set_new(vfs, "diskfs", vfs_entry);
+    json_object_set_new(config, "vfs", vfs);
+    if (posix_test_client_extra_cfg) {
+        posix_test_diskfs_merge_cfg(config, posix_test_client_extra_cfg);
+    }
+    json_object_set_new(root, "config", config);
+    chimera_test_write_users_json(root);
+
+    snprintf(posix_json_path, sizeof(posix_json_path),
+             "%s/posix_remount.json", env->session_dir);
+    json_dump_file(root, posix_json_path, 0);
+    json_decref(root);
+
+    env->metrics = prometheus_metrics_create(NULL, NULL, 0);
+    env->posix   = chimera_posix_init_json(posix_json_path, &env->cred, env->metrics);
+    if (!env->posix) {
+        fprintf(stderr, "Failed to re-initialize POSIX client\n");
+        posix_test_fail(env);
+    }
+
+    if (posix_test_mount(env) != 0) {
+        fprintf(stderr, "Failed to re-mount test module: %s\n", strerror(errno));
+        posix_test_fail(env);
+    }
+} /* posix_test_diskfs_start */
+
+static inline void
+posix_test_diskfs_remount(struct posix_test_env *env)
+{
+    posix_test_diskfs_stop(env);
+    posix_test_diskfs_start(env);
+} /* posix_test_diskfs_remount */
+
+/*
+ * Current value of counter `name` for op="<op>", summed over every sample
+ * (the per-thread instances) in a scrape of env->metrics.  For the diskfs
+ * cache tests, which assert on the deltas around a workload; a remount
+ * replaces the registry, so take both ends of a delta within one mount.
+ */
+static inline uint64_t
+posix_test_metric(
+    struct posix_test_env *env,
+    const char            *name,
+    const char            *op)
+{
+    static char buf[4 * 1024 * 1024];
+    char        label[64], line[1024];
+    const char *p, *eol, *v;
+    size_t      name_len = strlen(name), len;
+    uint64_t    total    = 0;
+    int         n;
+
+    n = prometheus_metrics_scrape(env->metrics, buf, sizeof(buf) - 1);
+    if (n < 0) {
+        fprintf(stderr, "metrics scrape overran %zu bytes\n", sizeof(buf));
+        posix_test_fail(env);
+    }
+    buf[n] = '\0';
+
+    snprintf(label, sizeof(label), "op=\"%s\"", op);
+
+    for (p = buf; *p; p = *eol ? eol + 1 : eol) {
+        eol = strchr(p, '\n');
+        if (!eol) {
+            eol = p + strlen(p);
+        }
+        len = (size_t) (eol - p) < sizeof(line) - 1 ? (size_t) (eol - p) : sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = '\0';
+
+        if (strncmp(line, name, name_len) != 0 ||
+            (line[name_len] != '{' && line[name_len] != ' ') ||
+            !strstr(line, label)) {
+            continue;
+        }
+
+        v = strrchr(line, ' ');
+        if (v) {
+            total += strtoull(v + 1, NULL, 10);
+        }
+    }
+
+    return total;
+} /* posix_test_metric */
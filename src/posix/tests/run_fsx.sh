@@ -23,6 +23,7 @@ usage() {
     echo "Usage: $0 -b <backend> [options]"
     echo ""
     echo "Direct backends:    memfs, diskfs_io_uring, diskfs_aio, cairn, linux, io_uring"
+    echo "diskfs variants:    diskfs_io_uring_<variant>, diskfs_aio_<variant> (lz4, zstd, stripe)"
     echo "NFS3 backends:      nfs3_memfs, nfs3_diskfs_io_uring, nfs3_diskfs_aio, nfs3_cairn, nfs3_linux, nfs3_io_uring"
     echo "NFS3 RDMA backends: nfs3rdma_memfs, nfs3rdma_diskfs_io_uring, nfs3rdma_diskfs_aio, nfs3rdma_cairn, nfs3rdma_linux, nfs3rdma_io_uring"
     echo "NFS4 backends:      nfs4_memfs, nfs4_diskfs_io_uring, nfs4_diskfs_aio, nfs4_cairn, nfs4_linux, nfs4_io_uring"
@@ -55,10 +56,26 @@ shift $((OPTIND-1))
 # Remaining arguments passed to fsx
 EXTRA_ARGS="$@"
 
+# diskfs feature variants: config keys appended to the generated diskfs
+# config (the fsx counterparts of posix_test_diskfs_variants)
+diskfs_variant_cfg() {
+    case "$1" in
+        lz4)    echo ',"compression":"lz4","compression_unit":8192' ;;
+        zstd)   echo ',"compression":"zstd","compression_unit":8192' ;;
+        stripe) echo ',"stripe_chunk":1048576' ;;
+        *)      return 1 ;;
+    esac
+}
+
 # Validate backend and check if NFS
 IS_NFS=0
+DISKFS_VARIANT_CFG=""
 case "$BACKEND" in
     memfs|diskfs_io_uring|diskfs_aio|cairn|linux|io_uring) ;;
+    diskfs_io_uring_*|diskfs_aio_*)
+        DISKFS_VARIANT_CFG=$(diskfs_variant_cfg "${BACKEND##*_}") ||
+            { echo "Error: Unknown diskfs variant in '$BACKEND'"; usage; }
+        ;;
     nfs3_memfs|nfs3_diskfs_io_uring|nfs3_diskfs_aio|nfs3_cairn|nfs3_linux|nfs3_io_uring) IS_NFS=1 ;;
     nfs3rdma_memfs|nfs3rdma_diskfs_io_uring|nfs3rdma_diskfs_aio|nfs3rdma_cairn|nfs3rdma_linux|nfs3rdma_io_uring) IS_NFS=1 ;;
     nfs4_memfs|nfs4_diskfs_io_uring|nfs4_diskfs_aio|nfs4_cairn|nfs4_linux|nfs4_io_uring) IS_NFS=1 ;;
@@ -93,9 +110,9 @@ generate_config() {
             # memfs uses "/" as mount path, no special config needed
             mount_path="/"
             ;;
-        diskfs_io_uring|diskfs_aio)
+        diskfs_io_uring|diskfs_aio|diskfs_io_uring_*|diskfs_aio_*)
             # Create diskfs devices and build inline config
-            if [ "$BACKEND" = "diskfs_aio" ]; then
+            if [ "${BACKEND#diskfs_aio}" != "$BACKEND" ]; then
                 DEVICE_TYPE="libaio"
             else
                 DEVICE_TYPE="io_uring"
@@ -107,13 +124,18 @@ generate_config() {
                 if [ $i -gt 0 ]; then
                     DEVICES_JSON="${DEVICES_JSON},"
                 fi
-                DEVICES_JSON="${DEVICES_JSON}{\"type\":\"$DEVICE_TYPE\",\"size\":1,\"path\":\"$DEVICE_PATH\"}"
+                DEVICE_WEIGHT=""
+                if [ "${BACKEND##*_}" = "stripe" ]; then
+                    # Mixed-weight pool, as in the posix stripe variant
+                    DEVICE_WEIGHT=",\"weight\":$((1 + i % 4))"
+                fi
+                DEVICES_JSON="${DEVICES_JSON}{\"type\":\"$DEVICE_TYPE\",\"size\":1,\"path\":\"$DEVICE_PATH\"${DEVICE_WEIGHT}}"
             done
             mount_path="/"
             modules_section="\"modules\": {
         \"diskfs\": {
             \"path\": \"/build/test/diskfs\",
-            \"config\": {\"initialize\":true,\"devices\":[$DEVICES_JSON],\"unsafe_async\":true,\"intent_log_size\":67108864}
+            \"config\": {\"initialize\":true,\"devices\":[$DEVICES_JSON],\"unsafe_async\":true,\"intent_log_size\":67108864${DISKFS_VARIANT_CFG}}
         }
     },"
             BACKEND="diskfs"
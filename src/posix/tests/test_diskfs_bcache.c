@@ -0,0 +1,197 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * diskfs block cache 2Q test.
+ *
+ * A small working set (one inode block per file in /test/hot) is stat'ed
+ * between sweeps of a scan set twice the block cache's size, each sweep
+ * long enough to push every cold block out but short enough that the
+ * working set's keys are still on the ghost ring when it comes round
+ * again.  Under LRU every sweep would flush the working set; under 2Q its
+ * re-reference after eviction is a ghost hit that admits it hot, and from
+ * then on the scan churns only the cold list: the hot list (the working
+ * set, the directories' interior nodes) is almost never recycled and the
+ * last pass over the working set is served from the cache.
+ */
+
+#include "posix_test_common.h"
+
+#define BCACHE_NHOT   512
+#define BCACHE_CHUNK  4096
+#define BCACHE_NSCAN  (2 * BCACHE_CHUNK)
+#define BCACHE_ROUNDS 8
+
+struct bcache_counts {
+    uint64_t miss;
+    uint64_t recycle;
+    uint64_t ghost_hit;
+    uint64_t hot_recycle;
+};
+
+static void
+bcache_counts(
+    struct posix_test_env *env,
+    struct bcache_counts  *c)
+{
+    c->miss        = posix_test_metric(env, "chimera_diskfs_block_cache", "miss");
+    c->recycle     = posix_test_metric(env, "chimera_diskfs_block_cache", "recycle");
+    c->ghost_hit   = posix_test_metric(env, "chimera_diskfs_block_cache", "ghost_hit");
+    c->hot_recycle = posix_test_metric(env, "chimera_diskfs_block_cache", "hot_recycle");
+} /* bcache_counts */
+
+static void
+bcache_create(
+    struct posix_test_env *env,
+    const char            *dir,
+    int                    n)
+{
+    char path[128];
+    int  i, fd;
+
+    if (chimera_posix_mkdir(dir, 0755) != 0) {
+        fprintf(stderr, "mkdir %s failed: %s\n", dir, strerror(errno));
+        posix_test_fail(env);
+    }
+
+    for (i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), "%s/f%06d", dir, i);
+        fd = chimera_posix_open(path, O_CREAT | O_WRONLY, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "create %s failed: %s\n", path, strerror(errno));
+            posix_test_fail(env);
+        }
+        chimera_posix_close(fd);
+    }
+} /* bcache_create */
+
+static void
+bcache_stat(
+    struct posix_test_env *env,
+    const char            *dir,
+    int                    first,
+    int                    n)
+{
+    char        path[128];
+    struct stat st;
+    int         i;
+
+    for (i = first; i < first + n; i++) {
+        snprintf(path, sizeof(path), "%s/f%06d", dir, i);
+        if (chimera_posix_stat(path, &st) != 0) {
+            fprintf(stderr, "stat %s failed: %s\n", path, strerror(errno));
+            posix_test_fail(env);
+        }
+    }
+} /* bcache_stat */
+
+/* Block cache misses taken by one pass over the working set. */
+static uint64_t
+bcache_hot_pass(struct posix_test_env *env)
+{
+    uint64_t miss = posix_test_metric(env, "chimera_diskfs_block_cache", "miss");
+
+    bcache_stat(env, "/test/hot", 0, BCACHE_NHOT);
+
+    return posix_test_metric(env, "chimera_diskfs_block_cache", "miss") - miss;
+} /* bcache_hot_pass */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    struct posix_test_env env;
+    struct bcache_counts  before, after;
+    uint64_t              miss_first, miss_last, recycle, hot_recycle, ghost_hit;
+    int                   rc, round;
+
+    /* 4096 cache blocks (16 a shard: 4 cold target, 8 ghosts) over an 8 MiB
+     * log, whose floor (1.5x the log) the cache clears.  The inode cache is
+     * far smaller than a sweep and the VFS caches are off, so every stat
+     * below goes to the inode's block. */
+    posix_test_diskfs_extra_cfg =
+        "{\"intent_log_size\":8388608,\"block_cache_blocks\":4096,"
+        "\"inode_cache_inodes\":1024}";
+    posix_test_client_extra_cfg = "{\"cache_ttl\":0}";
+
+    posix_test_init(&env, argv, argc);
+
+    if (!posix_test_is_diskfs(env.backend)) {
+        fprintf(stderr, "diskfs-only test, nothing to do for %s\n", env.backend);
+        posix_test_success(&env);
+        return 0;
+    }
+
+    rc = posix_test_mount(&env);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to mount test module: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    bcache_create(&env, "/test/hot", BCACHE_NHOT);
+    bcache_create(&env, "/test/scan", BCACHE_NSCAN);
+
+    /* Start from an empty cache with everything clean on disk. */
+    posix_test_diskfs_remount(&env);
+
+    miss_first = bcache_hot_pass(&env);
+
+    bcache_counts(&env, &before);
+    for (round = 0; round < BCACHE_ROUNDS; round++) {
+        bcache_stat(&env, "/test/scan", (round & 1) * BCACHE_CHUNK, BCACHE_CHUNK);
+        bcache_hot_pass(&env);
+    }
+    bcache_counts(&env, &after);
+
+    bcache_stat(&env, "/test/scan", 0, BCACHE_CHUNK);
+    miss_last = bcache_hot_pass(&env);
+
+    recycle     = after.recycle - before.recycle;
+    hot_recycle = after.hot_recycle - before.hot_recycle;
+    ghost_hit   = after.ghost_hit - before.ghost_hit;
+
+    fprintf(stderr, "2q: %d rounds, miss %lu recycle %lu hot_recycle %lu ghost_hit %lu, "
+            "working set misses %lu first / %lu last\n",
+            BCACHE_ROUNDS, (unsigned long) (after.miss - before.miss),
+            (unsigned long) recycle, (unsigned long) hot_recycle,
+            (unsigned long) ghost_hit, (unsigned long) miss_first,
+            (unsigned long) miss_last);
+
+    /* The sweeps did overrun the cache. */
+    if (recycle < (uint64_t) BCACHE_ROUNDS * BCACHE_CHUNK / 2) {
+        fprintf(stderr, "scan recycled only %lu blocks\n", (unsigned long) recycle);
+        posix_test_fail(&env);
+    }
+
+    /* The working set came back off the ghost ring... */
+    if (ghost_hit < BCACHE_NHOT / 2) {
+        fprintf(stderr, "only %lu ghost hits for a %d-block working set\n",
+                (unsigned long) ghost_hit, BCACHE_NHOT);
+        posix_test_fail(&env);
+    }
+
+    /* ...and the scan was paid for out of the cold list alone. */
+    if (hot_recycle * 20 > recycle) {
+        fprintf(stderr, "%lu of %lu recycles came off the hot list\n",
+                (unsigned long) hot_recycle, (unsigned long) recycle);
+        posix_test_fail(&env);
+    }
+
+    if (miss_first < BCACHE_NHOT || miss_last > BCACHE_NHOT / 4) {
+        fprintf(stderr, "working set not retained: %lu misses cold, %lu after the scans\n",
+                (unsigned long) miss_first, (unsigned long) miss_last);
+        posix_test_fail(&env);
+    }
+
+    rc = posix_test_umount();
+    if (rc != 0) {
+        fprintf(stderr, "Failed to unmount /test: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    posix_test_success(&env);
+
+    return 0;
+} /* main */
@@ -0,0 +1,311 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * diskfs data checksum / scrub test.
+ *
+ * Formats with data_checksums, writes a file whose 4 KiB blocks each start
+ * with a findable marker, and with the filesystem stopped flips a byte of one
+ * block directly in the device image.  After a cold start:
+ *
+ *   - reading the file fails with EIO, while blocks the read never touches
+ *     stay readable;
+ *   - a scrub pass (started through the job registry, as REST would) counts
+ *     the bad block;
+ *   - rewriting the block repairs it (there is only one copy of the data, so
+ *     rewriting is the repair): the file reads back whole and the next scrub
+ *     pass, and one after a further cold remount, find nothing.
+ */
+
+#define _GNU_SOURCE
+#include "posix_test_common.h"
+#include "common/job_registry.h"
+
+#define CSUM_BLOCK   4096
+#define CSUM_NBLOCKS 16
+#define CSUM_BAD     5
+#define CSUM_SCAN    (1024 * 1024)
+
+static void
+csum_block_fill(
+    char *buf,
+    int   block)
+{
+    int i;
+
+    for (i = 0; i < CSUM_BLOCK; i++) {
+        buf[i] = (char) (block * 131 + i * 7 + 1);
+    }
+    snprintf(buf, 32, "csum-test-block-%04d", block);
+} /* csum_block_fill */
+
+static void
+csum_file_expect(char *buf)
+{
+    int b;
+
+    for (b = 0; b < CSUM_NBLOCKS; b++) {
+        csum_block_fill(buf + b * CSUM_BLOCK, b);
+    }
+} /* csum_file_expect */
+
+/* Flip a byte of every on-disk copy of block `block` in the stopped
+ * filesystem's device images.  Returns the number of copies hit. */
+static int
+csum_corrupt(
+    struct posix_test_env *env,
+    int                    block)
+{
+    static char buf[CSUM_SCAN];
+    char        marker[32], path[300];
+    off_t       data, hole, off;
+    ssize_t     n, i;
+    int         dev, fd, hits = 0;
+
+    snprintf(marker, sizeof(marker), "csum-test-block-%04d", block);
+
+    for (dev = 0; dev < 10; dev++) {
+        snprintf(path, sizeof(path), "%s/device-%d.img", env->session_dir, dev);
+        fd = open(path, O_RDWR);
+        if (fd < 0) {
+            fprintf(stderr, "open %s failed: %s\n", path, strerror(errno));
+            posix_test_fail(env);
+        }
+
+        /* Walk only the allocated parts of the sparse image. */
+        data = lseek(fd, 0, SEEK_DATA);
+        while (data >= 0) {
+            hole = lseek(fd, data, SEEK_HOLE);
+            for (off = data & ~(off_t) (CSUM_BLOCK - 1); off < hole; off += n) {
+                n = pread(fd, buf, CSUM_SCAN, off);
+                if (n <= 0) {
+                    break;
+                }
+                for (i = 0; i + CSUM_BLOCK <= n; i += CSUM_BLOCK) {
+                    if (memcmp(buf + i, marker, strlen(marker) + 1) != 0) {
+                        continue;
+                    }
+                    buf[i + 100] ^= 0x5a;
+                    if (pwrite(fd, buf + i + 100, 1, off + i + 100) != 1) {
+                        fprintf(stderr, "pwrite %s failed: %s\n", path, strerror(errno));
+                        posix_test_fail(env);
+                    }
+                    hits++;
+                }
+            }
+            data = lseek(fd, hole, SEEK_DATA);
+        }
+        close(fd);
+    }
+
+    return hits;
+} /* csum_corrupt */
+
+struct csum_counter {
+    const char *name;
+    uint64_t    value;
+};
+
+static void
+csum_job_counter(
+    struct chimera_job *job,
+    void               *arg)
+{
+    struct csum_counter *c = arg;
+    int                  i;
+
+    for (i = 0; i < job->ncounters; i++) {
+        if (strcmp(job->counter_names[i], c->name) == 0) {
+            c->value = __atomic_load_n(&job->counters[i], __ATOMIC_RELAXED);
+        }
+    }
+} /* csum_job_counter */
+
+static void
+csum_job_start(
+    struct chimera_job *job,
+    void               *arg)
+{
+    (void) arg;
+    job->ops->start(job);
+} /* csum_job_start */
+
+static uint64_t
+csum_scrub_counter(
+    struct posix_test_env *env,
+    const char            *name)
+{
+    struct csum_counter c = { name, 0 };
+
+    if (chimera_job_find("diskfs_scrub", csum_job_counter, &c) != 0) {
+        fprintf(stderr, "no diskfs_scrub job registered\n");
+        posix_test_fail(env);
+    }
+    return c.value;
+} /* csum_scrub_counter */
+
+/* Run one whole scrub pass; returns the failures it counted. */
+static uint64_t
+csum_scrub_pass(struct posix_test_env *env)
+{
+    uint64_t passes   = csum_scrub_counter(env, "passes");
+    uint64_t failures = csum_scrub_counter(env, "failures");
+    int      waited;
+
+    chimera_job_find("diskfs_scrub", csum_job_start, NULL);
+
+    for (waited = 0; csum_scrub_counter(env, "passes") == passes; waited++) {
+        if (waited == 1200) {
+            fprintf(stderr, "scrub pass did not finish\n");
+            posix_test_fail(env);
+        }
+        usleep(100000);
+    }
+
+    return csum_scrub_counter(env, "failures") - failures;
+} /* csum_scrub_pass */
+
+static void
+csum_check_file(
+    struct posix_test_env *env,
+    const char            *path)
+{
+    static char expect[CSUM_BLOCK * CSUM_NBLOCKS], got[CSUM_BLOCK * CSUM_NBLOCKS];
+    int         fd;
+
+    csum_file_expect(expect);
+
+    fd = chimera_posix_open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "open %s failed: %s\n", path, strerror(errno));
+        posix_test_fail(env);
+    }
+    if (chimera_posix_pread(fd, got, sizeof(got), 0) != (ssize_t) sizeof(got) ||
+        memcmp(got, expect, sizeof(got)) != 0) {
+        fprintf(stderr, "%s: read back wrong: %s\n", path, strerror(errno));
+        posix_test_fail(env);
+    }
+    chimera_posix_close(fd);
+} /* csum_check_file */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    static char           buf[CSUM_BLOCK * CSUM_NBLOCKS];
+    struct posix_test_env env;
+    uint64_t              failures;
+    ssize_t               n;
+    int                   fd, rc, hits;
+
+    posix_test_diskfs_extra_cfg = "{\"data_checksums\":true,\"scrub\":false,\"scrub_rate\":0}";
+
+    posix_test_init(&env, argv, argc);
+    ChimeraLogLevel = CHIMERA_LOG_INFO;
+
+    if (!posix_test_is_diskfs(env.backend)) {
+        fprintf(stderr, "diskfs-only test, nothing to do for %s\n", env.backend);
+        posix_test_success(&env);
+        return 0;
+    }
+
+    rc = posix_test_mount(&env);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to mount test module: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    csum_file_expect(buf);
+    fd = chimera_posix_open("/test/data", O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0 || chimera_posix_write(fd, buf, sizeof(buf)) != (ssize_t) sizeof(buf) ||
+        chimera_posix_fsync(fd) != 0) {
+        fprintf(stderr, "writing /test/data failed: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+    chimera_posix_close(fd);
+
+    /* A clean pass first: everything written verifies. */
+    failures = csum_scrub_pass(&env);
+    if (failures != 0 || csum_scrub_counter(&env, "verified") < CSUM_NBLOCKS) {
+        fprintf(stderr, "clean scrub: %lu failures, %lu verified\n",
+                (unsigned long) failures,
+                (unsigned long) csum_scrub_counter(&env, "verified"));
+        posix_test_fail(&env);
+    }
+
+    posix_test_diskfs_stop(&env);
+    hits = csum_corrupt(&env, CSUM_BAD);
+    if (hits == 0) {
+        fprintf(stderr, "block %d not found in the device images\n", CSUM_BAD);
+        posix_test_fail(&env);
+    }
+    fprintf(stderr, "corrupted %d on-disk cop%s of block %d\n", hits,
+            hits == 1 ? "y" : "ies", CSUM_BAD);
+    posix_test_diskfs_start(&env);
+
+    /* Detection on the read path. */
+    fd = chimera_posix_open("/test/data", O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "open /test/data failed: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+    n = chimera_posix_pread(fd, buf, sizeof(buf), 0);
+    if (n >= 0 || errno != EIO) {
+        fprintf(stderr, "read of corrupt file: rc=%zd errno=%d, expected EIO\n", n, errno);
+        posix_test_fail(&env);
+    }
+    n = chimera_posix_pread(fd, buf, CSUM_BLOCK, (CSUM_NBLOCKS - 1) * CSUM_BLOCK);
+    if (n != CSUM_BLOCK) {
+        fprintf(stderr, "read of an intact block failed: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+    chimera_posix_close(fd);
+
+    /* Detection by the scrub. */
+    failures = csum_scrub_pass(&env);
+    if (failures == 0) {
+        fprintf(stderr, "scrub missed the corrupt block\n");
+        posix_test_fail(&env);
+    }
+    fprintf(stderr, "scrub counted %lu failure(s)\n", (unsigned long) failures);
+
+    /* Repair: a whole-block rewrite replaces data and checksum without
+     * reading the bad block. */
+    csum_block_fill(buf, CSUM_BAD);
+    fd = chimera_posix_open("/test/data", O_RDWR, 0);
+    if (fd < 0 ||
+        chimera_posix_pwrite(fd, buf, CSUM_BLOCK, CSUM_BAD * CSUM_BLOCK) != CSUM_BLOCK ||
+        chimera_posix_fsync(fd) != 0) {
+        fprintf(stderr, "rewriting block %d failed: %s\n", CSUM_BAD, strerror(errno));
+        posix_test_fail(&env);
+    }
+    chimera_posix_close(fd);
+
+    csum_check_file(&env, "/test/data");
+    failures = csum_scrub_pass(&env);
+    if (failures != 0) {
+        fprintf(stderr, "scrub after repair: %lu failures\n", (unsigned long) failures);
+        posix_test_fail(&env);
+    }
+
+    posix_test_diskfs_remount(&env);
+
+    csum_check_file(&env, "/test/data");
+    failures = csum_scrub_pass(&env);
+    if (failures != 0) {
+        fprintf(stderr, "scrub after remount: %lu failures\n", (unsigned long) failures);
+        posix_test_fail(&env);
+    }
+
+    rc = posix_test_umount();
+    if (rc != 0) {
+        fprintf(stderr, "Failed to unmount /test: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    posix_test_success(&env);
+
+    return 0;
+} /* main */
@@ -0,0 +1,338 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * diskfs data cache test.
+ *
+ * A file is read twice (the second pass served wholly from the cache), then
+ * partly overwritten, truncated and extended; every reread must return the
+ * current contents, and the hit/miss/invalidate counters must show the
+ * cached blocks being dropped and refilled.  Last, a reader thread keeps
+ * reading while the main thread rewrites the file: every read the reader
+ * has in flight reserves its blocks before the write lands, and a read
+ * issued after each write must never see a fill of the older data.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "posix_test_common.h"
+
+#define DCACHE_NBLOCKS 64
+#define DCACHE_SIZE    (DCACHE_NBLOCKS * 4096)
+#define DCACHE_ROUNDS  200
+
+struct dcache_counts {
+    uint64_t hit;
+    uint64_t miss;
+    uint64_t invalidate;
+};
+
+struct dcache_reader {
+    int        fd;
+    atomic_int stop;
+    atomic_int gen;
+    atomic_int reads;
+    atomic_int errors;
+};
+
+/* Every 8-byte word of block b at generation gen is (gen << 32 | b). */
+static void
+dcache_fill(
+    char    *buf,
+    int      first,
+    int      nblocks,
+    uint32_t gen)
+{
+    uint64_t *w = (uint64_t *) buf;
+    int       b, i;
+
+    for (b = 0; b < nblocks; b++) {
+        for (i = 0; i < 4096 / 8; i++) {
+            *w++ = ((uint64_t) gen << 32) | (uint32_t) (first + b);
+        }
+    }
+} /* dcache_fill */
+
+/* The generation block b holds, or -1 if the block is torn or misplaced. */
+static int64_t
+dcache_block_gen(
+    const char *buf,
+    int         b)
+{
+    const uint64_t *w = (const uint64_t *) (buf + (size_t) b * 4096);
+    int             i;
+
+    for (i = 1; i < 4096 / 8; i++) {
+        if (w[i] != w[0]) {
+            return -1;
+        }
+    }
+    if ((uint32_t) w[0] != (uint32_t) b) {
+        return -1;
+    }
+    return (int64_t) (w[0] >> 32);
+} /* dcache_block_gen */
+
+static void
+dcache_counts(
+    struct posix_test_env *env,
+    struct dcache_counts  *c)
+{
+    c->hit        = posix_test_metric(env, "chimera_diskfs_data_cache", "hit");
+    c->miss       = posix_test_metric(env, "chimera_diskfs_data_cache", "miss");
+    c->invalidate = posix_test_metric(env, "chimera_diskfs_data_cache", "invalidate");
+} /* dcache_counts */
+
+static void
+dcache_pread(
+    struct posix_test_env *env,
+    int                    fd,
+    char                  *buf)
+{
+    if (chimera_posix_pread(fd, buf, DCACHE_SIZE, 0) != DCACHE_SIZE) {
+        fprintf(stderr, "pread failed: %s\n", strerror(errno));
+        posix_test_fail(env);
+    }
+} /* dcache_pread */
+
+static void
+dcache_pwrite(
+    struct posix_test_env *env,
+    int                    fd,
+    const char            *buf,
+    size_t                 len,
+    off_t                  offset)
+{
+    if (chimera_posix_pwrite(fd, buf, len, offset) != (ssize_t) len) {
+        fprintf(stderr, "pwrite failed: %s\n", strerror(errno));
+        posix_test_fail(env);
+    }
+} /* dcache_pwrite */
+
+/* Blocks [0, zero_from) hold gen (gen2 over [lo, hi)), the rest zeros. */
+static void
+dcache_check(
+    struct posix_test_env *env,
+    const char            *what,
+    const char            *buf,
+    uint32_t               gen,
+    uint32_t               gen2,
+    int                    lo,
+    int                    hi,
+    int                    zero_from)
+{
+    static const char zero[4096];
+    int               b;
+    int64_t           expect;
+
+    for (b = 0; b < DCACHE_NBLOCKS; b++) {
+        if (b >= zero_from) {
+            if (memcmp(buf + (size_t) b * 4096, zero, 4096) != 0) {
+                fprintf(stderr, "%s: block %d not zero past the truncate\n", what, b);
+                posix_test_fail(env);
+            }
+            continue;
+        }
+        expect = (b >= lo && b < hi) ? gen2 : gen;
+        if (dcache_block_gen(buf, b) != expect) {
+            fprintf(stderr, "%s: block %d holds gen %lld, expected %lld\n",
+                    what, b, (long long) dcache_block_gen(buf, b), (long long) expect);
+            posix_test_fail(env);
+        }
+    }
+} /* dcache_check */
+
+static void
+dcache_expect(
+    struct posix_test_env      *env,
+    const char                 *what,
+    const struct dcache_counts *before,
+    int64_t                     hit_min,
+    int64_t                     hit_max,
+    int64_t                     miss_min,
+    int64_t                     miss_max,
+    int64_t                     inval_min)
+{
+    struct dcache_counts now;
+    int64_t              hit, miss, inval;
+
+    dcache_counts(env, &now);
+    hit   = (int64_t) (now.hit - before->hit);
+    miss  = (int64_t) (now.miss - before->miss);
+    inval = (int64_t) (now.invalidate - before->invalidate);
+
+    fprintf(stderr, "%s: hit %lld miss %lld invalidate %lld\n",
+            what, (long long) hit, (long long) miss, (long long) inval);
+
+    if (hit < hit_min || hit > hit_max || miss < miss_min || miss > miss_max ||
+        inval < inval_min) {
+        fprintf(stderr, "%s: expected hit [%lld,%lld] miss [%lld,%lld] invalidate >= %lld\n",
+                what, (long long) hit_min, (long long) hit_max,
+                (long long) miss_min, (long long) miss_max, (long long) inval_min);
+        posix_test_fail(env);
+    }
+} /* dcache_expect */
+
+static void *
+dcache_reader_main(void *arg)
+{
+    struct dcache_reader *r = arg;
+    static char           buf[DCACHE_SIZE];
+    int64_t               g;
+    int                   b, gen;
+
+    while (!atomic_load(&r->stop)) {
+        if (chimera_posix_pread(r->fd, buf, DCACHE_SIZE, 0) != DCACHE_SIZE) {
+            fprintf(stderr, "reader: pread failed: %s\n", strerror(errno));
+            atomic_fetch_add(&r->errors, 1);
+            return NULL;
+        }
+        /* Each block is whole and no newer than the last write begun. */
+        gen = atomic_load(&r->gen);
+        for (b = 0; b < DCACHE_NBLOCKS; b++) {
+            g = dcache_block_gen(buf, b);
+            if (g < 0 || g > gen) {
+                fprintf(stderr, "reader: block %d holds gen %lld with gen %d begun\n",
+                        b, (long long) g, gen);
+                atomic_fetch_add(&r->errors, 1);
+                return NULL;
+            }
+        }
+        atomic_fetch_add(&r->reads, 1);
+    }
+    return NULL;
+} /* dcache_reader_main */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    struct posix_test_env env;
+    struct dcache_counts  before;
+    struct dcache_reader  reader;
+    static char           buf[DCACHE_SIZE], got[DCACHE_SIZE];
+    pthread_t             thread;
+    int                   fd, rc, round;
+
+    /* Room for the whole file many times over, so nothing below is evicted
+     * and the counters are exact. */
+    posix_test_diskfs_extra_cfg = "{\"data_cache_blocks\":4096}";
+
+    posix_test_init(&env, argv, argc);
+
+    if (!posix_test_is_diskfs(env.backend)) {
+        fprintf(stderr, "diskfs-only test, nothing to do for %s\n", env.backend);
+        posix_test_success(&env);
+        return 0;
+    }
+
+    rc = posix_test_mount(&env);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to mount test module: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    fd = chimera_posix_open("/test/dcache", O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "create failed: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+    dcache_fill(buf, 0, DCACHE_NBLOCKS, 1);
+    dcache_pwrite(&env, fd, buf, DCACHE_SIZE, 0);
+    if (chimera_posix_fsync(fd) != 0) {
+        fprintf(stderr, "fsync failed: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    /* Writes never fill: the first read misses throughout, the second hits
+     * throughout. */
+    dcache_counts(&env, &before);
+    dcache_pread(&env, fd, got);
+    dcache_check(&env, "cold read", got, 1, 1, 0, 0, DCACHE_NBLOCKS);
+    dcache_expect(&env, "cold read", &before, 0, 0, DCACHE_NBLOCKS, DCACHE_NBLOCKS, 0);
+
+    dcache_counts(&env, &before);
+    dcache_pread(&env, fd, got);
+    dcache_check(&env, "warm read", got, 1, 1, 0, 0, DCACHE_NBLOCKS);
+    dcache_expect(&env, "warm read", &before, DCACHE_NBLOCKS, DCACHE_NBLOCKS, 0, 0, 0);
+
+    /* Overwrite blocks [16, 32): whether rewritten in place or moved, the
+     * cached copies of the old blocks go, and the reread fetches only what
+     * is no longer resident (at least the rewritten blocks). */
+    dcache_counts(&env, &before);
+    dcache_fill(buf, 16, 16, 2);
+    dcache_pwrite(&env, fd, buf, 16 * 4096, 16 * 4096);
+    dcache_pread(&env, fd, got);
+    dcache_check(&env, "overwrite", got, 1, 2, 16, 32, DCACHE_NBLOCKS);
+    dcache_expect(&env, "overwrite", &before, 16, DCACHE_NBLOCKS - 16,
+                  16, DCACHE_NBLOCKS - 16, 16);
+
+    /* Truncate to half and extend back: the freed half leaves the cache and
+     * reads back as a hole; the kept half is all resident again. */
+    dcache_counts(&env, &before);
+    if (chimera_posix_ftruncate(fd, DCACHE_SIZE / 2) != 0 ||
+        chimera_posix_ftruncate(fd, DCACHE_SIZE) != 0) {
+        fprintf(stderr, "ftruncate failed: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+    dcache_pread(&env, fd, got);
+    dcache_check(&env, "truncate", got, 1, 2, 16, 32, DCACHE_NBLOCKS / 2);
+    dcache_expect(&env, "truncate", &before, DCACHE_NBLOCKS / 2, DCACHE_NBLOCKS / 2,
+                  0, 0, DCACHE_NBLOCKS / 2);
+
+    /* Refill the whole file, then race a reader against rewrites of it.
+     * Each write invalidates what the reader has cached or reserved, so a
+     * read right after it must see the write, never a late fill. */
+    dcache_fill(buf, 0, DCACHE_NBLOCKS, 3);
+    dcache_pwrite(&env, fd, buf, DCACHE_SIZE, 0);
+
+    memset(&reader, 0, sizeof(reader));
+    reader.fd = fd;
+    atomic_store(&reader.gen, 3);
+
+    dcache_counts(&env, &before);
+    if (pthread_create(&thread, NULL, dcache_reader_main, &reader) != 0) {
+        fprintf(stderr, "pthread_create failed\n");
+        posix_test_fail(&env);
+    }
+
+    for (round = 4; round < 4 + DCACHE_ROUNDS && !atomic_load(&reader.errors); round++) {
+        atomic_store(&reader.gen, round);
+        dcache_fill(buf, 0, DCACHE_NBLOCKS, round);
+        dcache_pwrite(&env, fd, buf, DCACHE_SIZE, 0);
+        dcache_pread(&env, fd, got);
+        dcache_check(&env, "racing read", got, round, round, 0, 0, DCACHE_NBLOCKS);
+    }
+
+    atomic_store(&reader.stop, 1);
+    pthread_join(thread, NULL);
+
+    if (atomic_load(&reader.errors)) {
+        posix_test_fail(&env);
+    }
+    fprintf(stderr, "race: %d rounds against %d reads\n",
+            DCACHE_ROUNDS, atomic_load(&reader.reads));
+    dcache_expect(&env, "race", &before, 0, INT64_MAX, 1, INT64_MAX, DCACHE_ROUNDS);
+
+    /* Settled: one more read fills, the next is served whole. */
+    dcache_pread(&env, fd, got);
+    dcache_counts(&env, &before);
+    dcache_pread(&env, fd, got);
+    dcache_check(&env, "settled", got, 3 + DCACHE_ROUNDS, 3 + DCACHE_ROUNDS, 0, 0,
+                 DCACHE_NBLOCKS);
+    dcache_expect(&env, "settled", &before, DCACHE_NBLOCKS, DCACHE_NBLOCKS, 0, 0, 0);
+
+    chimera_posix_close(fd);
+
+    rc = posix_test_umount();
+    if (rc != 0) {
+        fprintf(stderr, "Failed to unmount /test: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    posix_test_success(&env);
+
+    return 0;
+} /* main */
@@ -0,0 +1,245 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * diskfs inline data test.
+ *
+ * Files up to inline_data_max (3072) bytes live in their inode block.  This
+ * walks the edges of that: small and sparse inline writes, a write that
+ * crosses the threshold by one byte and promotes the file to an extent,
+ * truncate growing an inline file past the threshold and shrinking an
+ * extent file back under it, and a remount that rereads everything from
+ * disk rather than from the inode cache.
+ */
+
+#include "posix_test_common.h"
+
+#define INLINE_MAX 3072
+
+static void
+inline_pattern(
+    char  *buf,
+    size_t len,
+    int    seed)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = (char) (seed * 131 + i * 7 + 1);
+    }
+} /* inline_pattern */
+
+static void
+inline_write_at(
+    struct posix_test_env *env,
+    const char            *path,
+    off_t                  offset,
+    size_t                 len,
+    int                    seed)
+{
+    char buf[INLINE_MAX * 2];
+    int  fd;
+
+    inline_pattern(buf, len, seed);
+
+    fd = chimera_posix_open(path, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "open %s failed: %s\n", path, strerror(errno));
+        posix_test_fail(env);
+    }
+    if (chimera_posix_pwrite(fd, buf, len, offset) != (ssize_t) len) {
+        fprintf(stderr, "pwrite %s failed: %s\n", path, strerror(errno));
+        posix_test_fail(env);
+    }
+    chimera_posix_close(fd);
+} /* inline_write_at */
+
+static void
+inline_truncate(
+    struct posix_test_env *env,
+    const char            *path,
+    off_t                  size)
+{
+    int fd;
+
+    fd = chimera_posix_open(path, O_RDWR, 0);
+    if (fd < 0) {
+        fprintf(stderr, "open %s failed: %s\n", path, strerror(errno));
+        posix_test_fail(env);
+    }
+    if (chimera_posix_ftruncate(fd, size) != 0) {
+        fprintf(stderr, "ftruncate %s to %ld failed: %s\n", path, (long) size,
+                strerror(errno));
+        posix_test_fail(env);
+    }
+    chimera_posix_close(fd);
+} /* inline_truncate */
+
+/* Compares the whole file against `expect` of `len` bytes. */
+static void
+inline_check(
+    struct posix_test_env *env,
+    const char            *path,
+    const char            *expect,
+    size_t                 len)
+{
+    char        got[INLINE_MAX * 2 + 1];
+    struct stat st;
+    ssize_t     n;
+    int         fd;
+
+    if (chimera_posix_stat(path, &st) != 0) {
+        fprintf(stderr, "stat %s failed: %s\n", path, strerror(errno));
+        posix_test_fail(env);
+    }
+    if ((size_t) st.st_size != len) {
+        fprintf(stderr, "%s: size %ld, expected %zu\n", path, (long) st.st_size, len);
+        posix_test_fail(env);
+    }
+
+    fd = chimera_posix_open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "open %s failed: %s\n", path, strerror(errno));
+        posix_test_fail(env);
+    }
+    /* Ask for one byte more than the file holds: the read must stop at EOF. */
+    n = chimera_posix_pread(fd, got, len + 1, 0);
+    if (n != (ssize_t) len || memcmp(got, expect, len) != 0) {
+        fprintf(stderr, "%s: read %zd bytes, contents %s\n", path, n,
+                n == (ssize_t) len ? "differ" : "short");
+        posix_test_fail(env);
+    }
+    chimera_posix_close(fd);
+} /* inline_check */
+
+struct inline_case {
+    const char *path;
+    char        expect[INLINE_MAX * 2];
+    size_t      len;
+};
+
+static void
+inline_check_all(
+    struct posix_test_env    *env,
+    const struct inline_case *cases,
+    int                       ncases)
+{
+    int i;
+
+    for (i = 0; i < ncases; i++) {
+        inline_check(env, cases[i].path, cases[i].expect, cases[i].len);
+    }
+    fprintf(stderr, "inline check ok\n");
+} /* inline_check_all */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    static struct inline_case cases[6];
+    struct posix_test_env     env;
+    struct inline_case       *c;
+    int                       rc;
+
+    /* Pin the threshold so the test keeps covering the edge if the
+     * default moves. */
+    posix_test_diskfs_extra_cfg = "{\"inline_data_max\":3072}";
+
+    posix_test_init(&env, argv, argc);
+    ChimeraLogLevel = CHIMERA_LOG_INFO;
+
+    if (!posix_test_is_diskfs(env.backend)) {
+        fprintf(stderr, "diskfs-only test, nothing to do for %s\n", env.backend);
+        posix_test_success(&env);
+        return 0;
+    }
+
+    rc = posix_test_mount(&env);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to mount test module: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    /* Small inline write. */
+    c       = &cases[0];
+    c->path = "/test/small";
+    c->len  = 100;
+    inline_pattern(c->expect, c->len, 1);
+    inline_write_at(&env, c->path, 0, c->len, 1);
+
+    /* Exactly at the threshold: still inline. */
+    c       = &cases[1];
+    c->path = "/test/full";
+    c->len  = INLINE_MAX;
+    inline_pattern(c->expect, c->len, 2);
+    inline_write_at(&env, c->path, 0, c->len, 2);
+
+    /* Fill to the threshold, then one more byte promotes to an extent. */
+    c       = &cases[2];
+    c->path = "/test/promote";
+    c->len  = INLINE_MAX + 1;
+    inline_pattern(c->expect, INLINE_MAX, 3);
+    inline_pattern(c->expect + INLINE_MAX, 1, 4);
+    inline_write_at(&env, c->path, 0, INLINE_MAX, 3);
+    inline_write_at(&env, c->path, INLINE_MAX, 1, 4);
+
+    /* Sparse inline: the hole between the writes reads back as zeros. */
+    c       = &cases[3];
+    c->path = "/test/sparse";
+    c->len  = 2000;
+    memset(c->expect, 0, c->len);
+    inline_pattern(c->expect + 10, 50, 5);
+    inline_pattern(c->expect + 1900, 100, 6);
+    inline_write_at(&env, c->path, 1900, 100, 6);
+    inline_write_at(&env, c->path, 10, 50, 5);
+
+    /* Truncate an inline file past the threshold: the old bytes survive
+     * promotion and the grown tail is zero. */
+    c       = &cases[4];
+    c->path = "/test/grow";
+    c->len  = INLINE_MAX + 1000;
+    memset(c->expect, 0, c->len);
+    inline_pattern(c->expect, 1500, 7);
+    inline_write_at(&env, c->path, 0, 1500, 7);
+    inline_truncate(&env, c->path, 1000);
+    inline_truncate(&env, c->path, c->len);
+    memset(c->expect + 1000, 0, 500);
+
+    /* Shrink an extent file back under the threshold, then grow it again
+     * within the inline range: the cut bytes must not reappear. */
+    c       = &cases[5];
+    c->path = "/test/shrink";
+    c->len  = 2500;
+    memset(c->expect, 0, c->len);
+    inline_pattern(c->expect, 2000, 8);
+    inline_write_at(&env, c->path, 0, INLINE_MAX * 2, 8);
+    inline_truncate(&env, c->path, 2000);
+    inline_truncate(&env, c->path, c->len);
+
+    inline_check_all(&env, cases, 6);
+
+    /* Everything again from disk. */
+    posix_test_diskfs_remount(&env);
+    inline_check_all(&env, cases, 6);
+
+    /* Rewrite inside the inline range after remount, then remount again. */
+    c = &cases[0];
+    inline_pattern(c->expect + 50, 100, 9);
+    c->len = 150;
+    inline_write_at(&env, c->path, 50, 100, 9);
+
+    posix_test_diskfs_remount(&env);
+    inline_check_all(&env, cases, 6);
+
+    rc = posix_test_umount();
+    if (rc != 0) {
+        fprintf(stderr, "Failed to unmount /test: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    posix_test_success(&env);
+
+    return 0;
+} /* main */
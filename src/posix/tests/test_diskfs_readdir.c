@@ -0,0 +1,303 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * diskfs readdir child-inode prefetch test.
+ *
+ * A directory far larger than the inode cache is listed cold, with a wide
+ * prefetch window, so every walk below has inode loads outstanding ahead of
+ * the entry being returned.  Against that:
+ *
+ *   - a cold listing returns every entry exactly once and faults the
+ *     children in through the prefetch path;
+ *   - files are unlinked and subdirectories removed from another thread
+ *     while a walk is under way: survivors are still listed exactly once,
+ *     removed entries at most once, and the removed names are gone after;
+ *   - the filesystem is unmounted straight after walks that leave prefetches
+ *     in flight, and the next mount lists the same entries;
+ *   - with the window configured off, a cold listing issues no prefetches
+ *     and returns the same entries.
+ */
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "posix_test_common.h"
+
+#define READDIR_NFILES  10000
+#define READDIR_NDIRS   64
+#define READDIR_REMOVE  3       /* every 3rd file is unlinked */
+#define READDIR_UMOUNTS 8
+
+struct readdir_churn {
+    atomic_int start;
+    atomic_int errors;
+};
+
+/* Times each name was returned by one walk. */
+static uint8_t file_seen[READDIR_NFILES];
+static uint8_t dir_seen[READDIR_NDIRS];
+
+static inline int
+readdir_removed(int i)
+{
+    return i % READDIR_REMOVE == 0;
+} /* readdir_removed */
+
+static uint64_t
+readdir_prefetches(struct posix_test_env *env)
+{
+    return posix_test_metric(env, "chimera_diskfs_inode_cache", "prefetch");
+} /* readdir_prefetches */
+
+/*
+ * List /test/big, counting each name; with `stop_after` non-zero, stop (and
+ * close the directory) after that many entries.  Calls `started` once the
+ * first entry is back.  Returns the number of entries returned.
+ */
+static int
+readdir_walk(
+    struct posix_test_env *env,
+    int                    stop_after,
+    struct readdir_churn  *started)
+{
+    CHIMERA_DIR   *dir;
+    struct dirent *dp;
+    int            n = 0, i;
+
+    memset(file_seen, 0, sizeof(file_seen));
+    memset(dir_seen, 0, sizeof(dir_seen));
+
+    dir = chimera_posix_opendir("/test/big");
+    if (!dir) {
+        fprintf(stderr, "opendir /test/big failed: %s\n", strerror(errno));
+        posix_test_fail(env);
+    }
+
+    while ((dp = chimera_posix_readdir(dir)) != NULL) {
+        if (strcmp(dp->d_name, ".") == 0 || strcmp(dp->d_name, "..") == 0) {
+            continue;
+        }
+        if (sscanf(dp->d_name, "f%06d", &i) == 1 && i >= 0 && i < READDIR_NFILES) {
+            file_seen[i]++;
+        } else if (sscanf(dp->d_name, "d%04d", &i) == 1 && i >= 0 && i < READDIR_NDIRS) {
+            dir_seen[i]++;
+        } else {
+            fprintf(stderr, "readdir returned unknown entry '%s'\n", dp->d_name);
+            posix_test_fail(env);
+        }
+        if (++n == 1 && started) {
+            atomic_store(&started->start, 1);
+        }
+        if (stop_after && n == stop_after) {
+            break;
+        }
+    }
+
+    chimera_posix_closedir(dir);
+    return n;
+} /* readdir_walk */
+
+/* The last walk listed exactly the entries that exist: every file except
+ * the removed ones if `removed`, and the subdirectories unless `removed`. */
+static void
+readdir_check(
+    struct posix_test_env *env,
+    const char            *what,
+    int                    removed)
+{
+    int i, expect;
+
+    for (i = 0; i < READDIR_NFILES; i++) {
+        expect = !(removed && readdir_removed(i));
+        if (file_seen[i] != expect) {
+            fprintf(stderr, "%s: f%06d listed %d times, expected %d\n",
+                    what, i, file_seen[i], expect);
+            posix_test_fail(env);
+        }
+    }
+    for (i = 0; i < READDIR_NDIRS; i++) {
+        if (dir_seen[i] != !removed) {
+            fprintf(stderr, "%s: d%04d listed %d times, expected %d\n",
+                    what, i, dir_seen[i], !removed);
+            posix_test_fail(env);
+        }
+    }
+} /* readdir_check */
+
+/* Remove every 3rd file and every subdirectory once the walk is under way. */
+static void *
+readdir_churn_main(void *arg)
+{
+    struct readdir_churn *c = arg;
+    char                  path[128];
+    int                   i;
+
+    while (!atomic_load(&c->start)) {
+        usleep(100);
+    }
+
+    for (i = 0; i < READDIR_NFILES || i < READDIR_NDIRS; i++) {
+        if (i < READDIR_NFILES && readdir_removed(i)) {
+            snprintf(path, sizeof(path), "/test/big/f%06d", i);
+            if (chimera_posix_unlink(path) != 0) {
+                fprintf(stderr, "unlink %s failed: %s\n", path, strerror(errno));
+                atomic_fetch_add(&c->errors, 1);
+            }
+        }
+        if (i < READDIR_NDIRS) {
+            snprintf(path, sizeof(path), "/test/big/d%04d", i);
+            if (chimera_posix_rmdir(path) != 0) {
+                fprintf(stderr, "rmdir %s failed: %s\n", path, strerror(errno));
+                atomic_fetch_add(&c->errors, 1);
+            }
+        }
+    }
+    return NULL;
+} /* readdir_churn_main */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    struct posix_test_env env;
+    struct readdir_churn  churn;
+    struct stat           st;
+    pthread_t             thread;
+    char                  path[128];
+    uint64_t              before, prefetches;
+    int                   rc, i, fd, n;
+
+    /* The widest window over an inode cache a tenth of the directory, so
+     * each walk is cold and keeps hundreds of loads in flight. */
+    posix_test_diskfs_extra_cfg =
+        "{\"readdir_prefetch\":256,\"inode_cache_inodes\":1024}";
+
+    posix_test_init(&env, argv, argc);
+
+    if (!posix_test_is_diskfs(env.backend)) {
+        fprintf(stderr, "diskfs-only test, nothing to do for %s\n", env.backend);
+        posix_test_success(&env);
+        return 0;
+    }
+
+    rc = posix_test_mount(&env);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to mount test module: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    if (chimera_posix_mkdir("/test/big", 0755) != 0) {
+        fprintf(stderr, "mkdir /test/big failed: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+    for (i = 0; i < READDIR_NFILES; i++) {
+        snprintf(path, sizeof(path), "/test/big/f%06d", i);
+        fd = chimera_posix_open(path, O_CREAT | O_WRONLY, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "create %s failed: %s\n", path, strerror(errno));
+            posix_test_fail(&env);
+        }
+        chimera_posix_close(fd);
+    }
+    for (i = 0; i < READDIR_NDIRS; i++) {
+        snprintf(path, sizeof(path), "/test/big/d%04d", i);
+        if (chimera_posix_mkdir(path, 0755) != 0) {
+            fprintf(stderr, "mkdir %s failed: %s\n", path, strerror(errno));
+            posix_test_fail(&env);
+        }
+    }
+
+    /* Cold listing: every entry once, the children loaded ahead. */
+    posix_test_diskfs_remount(&env);
+    before = readdir_prefetches(&env);
+    n      = readdir_walk(&env, 0, NULL);
+    readdir_check(&env, "cold listing", 0);
+    prefetches = readdir_prefetches(&env) - before;
+    fprintf(stderr, "cold listing: %d entries, %lu prefetches\n", n,
+            (unsigned long) prefetches);
+    if (prefetches < READDIR_NFILES / 2) {
+        fprintf(stderr, "only %lu prefetches for a cold %d-entry directory\n",
+                (unsigned long) prefetches, n);
+        posix_test_fail(&env);
+    }
+
+    /* Unlink and rmdir under a walk, cold again so the removed entries'
+     * inodes are being faulted in as they go. */
+    posix_test_diskfs_remount(&env);
+    memset(&churn, 0, sizeof(churn));
+    if (pthread_create(&thread, NULL, readdir_churn_main, &churn) != 0) {
+        fprintf(stderr, "pthread_create failed\n");
+        posix_test_fail(&env);
+    }
+    n = readdir_walk(&env, 0, &churn);
+    pthread_join(thread, NULL);
+    if (atomic_load(&churn.errors)) {
+        posix_test_fail(&env);
+    }
+
+    for (i = 0; i < READDIR_NFILES; i++) {
+        if (file_seen[i] > 1 || (!readdir_removed(i) && file_seen[i] != 1)) {
+            fprintf(stderr, "walk under removal: f%06d listed %d times\n", i, file_seen[i]);
+            posix_test_fail(&env);
+        }
+    }
+    for (i = 0; i < READDIR_NDIRS; i++) {
+        if (dir_seen[i] > 1) {
+            fprintf(stderr, "walk under removal: d%04d listed %d times\n", i, dir_seen[i]);
+            posix_test_fail(&env);
+        }
+    }
+    fprintf(stderr, "walk under removal: %d entries\n", n);
+
+    readdir_walk(&env, 0, NULL);
+    readdir_check(&env, "after removal", 1);
+    for (i = 0; i < READDIR_NFILES; i += READDIR_REMOVE) {
+        snprintf(path, sizeof(path), "/test/big/f%06d", i);
+        if (chimera_posix_stat(path, &st) == 0 || errno != ENOENT) {
+            fprintf(stderr, "stat %s: expected ENOENT\n", path);
+            posix_test_fail(&env);
+        }
+    }
+
+    /* Unmount with prefetches in flight: each walk stops a few entries in,
+     * leaving the window's loads to land during teardown. */
+    for (i = 0; i < READDIR_UMOUNTS; i++) {
+        posix_test_diskfs_remount(&env);
+        before = readdir_prefetches(&env);
+        readdir_walk(&env, 1 + i * 7, NULL);
+        if (readdir_prefetches(&env) == before) {
+            fprintf(stderr, "partial walk %d issued no prefetches\n", i);
+            posix_test_fail(&env);
+        }
+    }
+
+    posix_test_diskfs_remount(&env);
+    readdir_walk(&env, 0, NULL);
+    readdir_check(&env, "after unmounts", 1);
+
+    /* Window off: no prefetches, same listing. */
+    posix_test_diskfs_extra_cfg =
+        "{\"readdir_prefetch\":0,\"inode_cache_inodes\":1024}";
+    posix_test_diskfs_remount(&env);
+    before = readdir_prefetches(&env);
+    readdir_walk(&env, 0, NULL);
+    readdir_check(&env, "prefetch off", 1);
+    if (readdir_prefetches(&env) != before) {
+        fprintf(stderr, "prefetch off but %lu prefetches issued\n",
+                (unsigned long) (readdir_prefetches(&env) - before));
+        posix_test_fail(&env);
+    }
+
+    rc = posix_test_umount();
+    if (rc != 0) {
+        fprintf(stderr, "Failed to unmount /test: %s\n", strerror(errno));
+        posix_test_fail(&env);
+    }
+
+    posix_test_success(&env);
+
+    return 0;
+} /* main */
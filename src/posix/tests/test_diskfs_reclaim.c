@@ -226,8 +226,7 @@ main(
         struct prometheus_metrics *metrics2;
 
         posix_test_diskfs_reuse_devices = 1;
-        posix_test_configure_diskfs(env.session_dir,
-                                    posix_test_diskfs_device_type(env.backend),
+        posix_test_configure_diskfs(env.session_dir, env.backend,
                                     diskfs_cfg, sizeof(diskfs_cfg));
 
         root      = json_object();
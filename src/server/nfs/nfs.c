@@ -51,6 +51,76 @@ chimera_nfs_init_metrics(
     }
 } /* chimera_nfs_init_metrics */
 
+/* Stamp the request tracer's RECEIVE stage around the generated dispatcher so
+ * VFS requests allocated while decoding the call inherit it.  Requests issued
+ * later from completion callbacks (e.g. subsequent ops in a COMPOUND) take
+ * their allocation time instead. */
+static int
+chimera_nfs_trace_dispatch_v3(
+    struct evpl               *evpl,
+    struct evpl_rpc2_conn     *conn,
+    struct evpl_rpc2_encoding *encoding,
+    uint32_t                   proc,
+    void                      *program_data,
+    struct evpl_rpc2_cred     *cred,
+    xdr_iovec                 *iov,
+    int                        niov,
+    int                        length,
+    void                      *private_data)
+{
+    struct chimera_server_nfs_thread *thread = private_data;
+    char                              client[80];
+    int                               rc;
+
+    if (unlikely(chimera_vfs_trace_enabled(thread->vfs))) {
+        evpl_rpc2_conn_get_remote_address(conn, client, sizeof(client));
+        chimera_vfs_trace_receive(thread->vfs_thread, CHIMERA_VFS_TRACE_PROTO_NFS3, client);
+    }
+    rc = thread->shared->trace_nfs3_dispatch(evpl, conn, encoding, proc, program_data,
+                                             cred, iov, niov, length, private_data);
+    chimera_vfs_trace_receive_done(thread->vfs_thread);
+
+    return rc;
+} /* chimera_nfs_trace_dispatch_v3 */
+
+static int
+chimera_nfs_trace_dispatch_v4(
+    struct evpl               *evpl,
+    struct evpl_rpc2_conn     *conn,
+    struct evpl_rpc2_encoding *encoding,
+    uint32_t                   proc,
+    void                      *program_data,
+    struct evpl_rpc2_cred     *cred,
+    xdr_iovec                 *iov,
+    int                        niov,
+    int                        length,
+    void                      *private_data)
+{
+    struct chimera_server_nfs_thread *thread = private_data;
+    char                              client[80];
+    int                               rc;
+
+    if (unlikely(chimera_vfs_trace_enabled(thread->vfs))) {
+        evpl_rpc2_conn_get_remote_address(conn, client, sizeof(client));
+        chimera_vfs_trace_receive(thread->vfs_thread, CHIMERA_VFS_TRACE_PROTO_NFS4, client);
+    }
+    rc = thread->shared->trace_nfs4_dispatch(evpl, conn, encoding, proc, program_data,
+                                             cred, iov, niov, length, private_data);
+    chimera_vfs_trace_receive_done(thread->vfs_thread);
+
+    return rc;
+} /* chimera_nfs_trace_dispatch_v4 */
+
+static void
+chimera_nfs_trace_install(struct chimera_server_nfs_shared *shared)
+{
+    shared->trace_nfs3_dispatch            = shared->nfs_v3.rpc2.recv_call_dispatch;
+    shared->nfs_v3.rpc2.recv_call_dispatch = chimera_nfs_trace_dispatch_v3;
+
+    shared->trace_nfs4_dispatch            = shared->nfs_v4.rpc2.recv_call_dispatch;
+    shared->nfs_v4.rpc2.recv_call_dispatch = chimera_nfs_trace_dispatch_v4;
+} /* chimera_nfs_trace_install */
+
 static void *
 nfs_server_init(
     const struct chimera_server_config *config,
@@ -293,6 +363,9 @@ nfs_server_init(
      * replay across a client's reconnect regardless of persistence); KV
      * persistence is gated by nfs4_drc inside the install. */
     nfs4_v40_drc_install(shared, chimera_server_config_get_nfs4_drc(config));
+    /* Installed unconditionally (the wrapper is a relaxed load when tracing
+     * is off) so tracing can be switched on at runtime via REST. */
+    chimera_nfs_trace_install(shared);
     pthread_mutex_init(&shared->nfs4_pnfs_devcache.lock, NULL);
     shared->nfs4_pnfs_devcache.count = 0;
 
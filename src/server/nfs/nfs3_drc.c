@@ -12,6 +12,7 @@
 #include "nfs_kv_keys.h"
 #include "nfs_drc_reply.h"
 #include "nfs4_lease.h"
+#include "common/checksum.h"
 #include "vfs/vfs.h"
 #include "vfs/vfs_procs.h"
 #include "evpl/evpl.h"
@@ -63,30 +64,12 @@ nfs3_drc_proc_cacheable(uint32_t proc)
     } /* switch */
 } /* nfs3_drc_proc_cacheable */
 
-#define NFS3_DRC_FNV_OFFSET 1469598103934665603ULL
-#define NFS3_DRC_FNV_PRIME  1099511628211ULL
-
-static inline uint64_t
-nfs3_drc_fnv_accum(
-    uint64_t       h,
-    const uint8_t *p,
-    uint32_t       len)
-{
-    uint32_t i;
-
-    for (i = 0; i < len; i++) {
-        h ^= p[i];
-        h *= NFS3_DRC_FNV_PRIME;
-    }
-    return h;
-} /* nfs3_drc_fnv_accum */
-
 uint64_t
 nfs3_drc_checksum(
     const void *data,
     uint32_t    len)
 {
-    return nfs3_drc_fnv_accum(NFS3_DRC_FNV_OFFSET, data, len);
+    return chimera_xxh3_64(data, len);
 } /* nfs3_drc_checksum */
 
 uint64_t
@@ -94,13 +77,18 @@ nfs3_drc_checksum_iov(
     const xdr_iovec *iov,
     int              niov)
 {
-    uint64_t h = NFS3_DRC_FNV_OFFSET;
-    int      i;
+    XXH3_state_t state;
+    int          i;
+
+    if (niov == 1) {
+        return chimera_xxh3_64(xdr_iovec_data(&iov[0]), xdr_iovec_len(&iov[0]));
+    }
 
+    chimera_xxh3_64_init(&state);
     for (i = 0; i < niov; i++) {
-        h = nfs3_drc_fnv_accum(h, xdr_iovec_data(&iov[i]), xdr_iovec_len(&iov[i]));
+        chimera_xxh3_64_update(&state, xdr_iovec_data(&iov[i]), xdr_iovec_len(&iov[i]));
     }
-    return h;
+    return chimera_xxh3_64_final(&state);
 } /* nfs3_drc_checksum_iov */
 
 /* Source IP with the ephemeral port stripped (stable across the reconnect a
@@ -144,7 +144,7 @@ nfs3_drc_serve(
     int                           length,
     void                         *private_data);
 
-/* 64-bit FNV-1a over a request's iovecs -- the key's checksum field. */
+/* XXH3-64 over a request's iovecs -- the key's checksum field. */
 uint64_t
 nfs3_drc_checksum_iov(
     const xdr_iovec *iov,
@@ -160,7 +160,7 @@ nfs3_drc_client_addr(
 *  Exposed for unit tests (test_nfs_persist).                             *
 * ----------------------------------------------------------------------- */
 
-/* 64-bit FNV-1a over a request body -- the key's checksum field. */
+/* XXH3-64 over a request body -- the key's checksum field. */
 uint64_t
 nfs3_drc_checksum(
     const void *data,
@@ -14,6 +14,7 @@
 #include "nfs_kv_keys.h"
 #include "vfs/vfs.h"
 #include "vfs/vfs_procs.h"
+#include "common/lock_profile.h"
 
 #define NFS4_DRC_SESSION_MAGIC   0x3153534Eu /* "NSS1" */
 #define NFS4_DRC_REPLY_MAGIC     0x3150524Eu /* "NRP1" */
@@ -419,7 +420,7 @@ nfs4_drc_ensure_client(
 {
     struct nfs4_client *client;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), client);
@@ -14,6 +14,7 @@
 #include "nfs_common.h"
 #include "nfs_internal.h"
 #include "common/misc.h"
+#include "common/lock_profile.h"
 #include "evpl/evpl.h"
 
 #define NFS_LEASE_SWEEP_INTERVAL_US 1000000   /* 1 Hz */
@@ -71,7 +72,7 @@ nfs_lease_sweep_once(struct chimera_server_nfs_thread *thread)
     lease_ns    = (uint64_t) shared->nfs_lease_time_s * 1000000000ULL;
     courtesy_ns = (uint64_t) shared->nfs_courtesy_time_s * 1000000000ULL;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_ITER(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id, cur, tmp)
     {
@@ -6,6 +6,7 @@
 #include "nfs4_session.h"
 #include "nfs4_recovery.h"
 #include "evpl/evpl_rpc2.h"
+#include "common/lock_profile.h"
 
 void
 chimera_nfs4_destroy_clientid(
@@ -40,7 +41,7 @@ chimera_nfs4_destroy_clientid(
     {
         struct nfs4_client *c;
 
-        pthread_mutex_lock(&shared->nfs4_shared_clients.nfs4_ct_lock);
+        chimera_mutex_lock(&shared->nfs4_shared_clients.nfs4_ct_lock, "nfs4_client_table");
         HASH_FIND(nfs4_client_hh_by_id,
                   shared->nfs4_shared_clients.nfs4_ct_clients_by_id,
                   &args->dca_clientid, sizeof(args->dca_clientid), c);
@@ -9,6 +9,7 @@
 #include "nfs4_session.h"
 #include "nfs4_state.h"
 #include "evpl/evpl_rpc2.h"
+#include "common/lock_profile.h"
 
 /* Flag bits a client is permitted to set in eia_flags (RFC 8881 §18.35.3).
  * EXCHGID4_FLAG_CONFIRMED_R is result-only; any other bit is undefined. */
@@ -263,7 +264,7 @@ chimera_nfs4_exchange_id(
     {
         struct nfs4_client *c  = NULL;
         struct nfs_client  *uc = NULL;
-        pthread_mutex_lock(&thread->shared->nfs4_shared_clients.nfs4_ct_lock);
+        chimera_mutex_lock(&thread->shared->nfs4_shared_clients.nfs4_ct_lock, "nfs4_client_table");
         HASH_FIND(nfs4_client_hh_by_id,
                   thread->shared->nfs4_shared_clients.nfs4_ct_clients_by_id,
                   &eid.clientid, sizeof(eid.clientid), c);
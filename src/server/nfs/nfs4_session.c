@@ -16,6 +16,7 @@
 #include "nfs_common.h"
 #include "evpl/evpl_rpc2.h"
 #include "vfs/vfs_release.h"
+#include "common/lock_profile.h"
 
 /* Bump a replay-cache counter on the shared struct.  Safe when the
  * thread/shared are not set up (e.g. in the unit test). */
@@ -138,7 +139,7 @@ nfs4_client_register(
     struct nfs4_client *client;
     uint64_t            id;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_owner, table->nfs4_ct_clients_by_owner,
               owner, owner_len, client);
@@ -325,7 +326,7 @@ nfs4_client_exchange_id(
     out->confirmed       = 0;
     out->destroy_unified = NULL;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_owner, table->nfs4_ct_clients_by_owner,
               owner, owner_len, existing);
@@ -460,7 +461,7 @@ nfs4_client_setclientid(
     out->destroy_unified = NULL;
     memset(out->confirm, 0, NFS4_VERIFIER_SIZE);
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_owner, table->nfs4_ct_clients_by_owner,
               owner, owner_len, existing);
@@ -552,7 +553,7 @@ nfs4_client_setclientid_confirm(
 
     *destroy_unified = NULL;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &clientid, sizeof(clientid), r);
@@ -632,7 +633,7 @@ nfs4_client_create_session_classify(
 
     memset(out, 0, sizeof(*out));
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), c);
@@ -704,7 +705,7 @@ nfs4_client_create_session_cache(
 {
     struct nfs4_client *c;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), c);
@@ -740,7 +741,7 @@ nfs4_client_mark_reclaim_complete(
     struct nfs4_client *c;
     bool                already = false;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), c);
@@ -763,7 +764,7 @@ nfs4_client_reclaim_complete(
     struct nfs4_client *c;
     bool                complete = false;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), c);
@@ -787,7 +788,7 @@ nfs4_client_destroy_clientid(
     struct nfs4_client *c;
     struct nfs_client  *unified;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), c);
@@ -825,7 +826,7 @@ nfs4_client_confirm(
 
     *destroy_unified = NULL;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), c);
@@ -884,7 +885,7 @@ nfs4_client_unregister(
     struct nfs4_client *client;
     struct nfs_client  *unified = NULL;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), client);
@@ -926,7 +927,7 @@ nfs4_create_session(
     struct nfs4_session *session = NULL;
     char                 session_id_str[80];
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), client);
@@ -1012,7 +1013,7 @@ nfs4_session_lookup(
 {
     struct nfs4_session *session = NULL;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_session_hh, table->nfs4_ct_sessions,
               sessionid, NFS4_SESSIONID_SIZE, session);
@@ -1037,7 +1038,7 @@ nfs4_session_find_by_clientid(
     struct nfs4_session *session = NULL;
     struct nfs4_session *cur, *tmp;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_ITER(nfs4_session_hh, table->nfs4_ct_sessions, cur, tmp)
     {
@@ -1070,7 +1071,7 @@ nfs4_destroy_session(
 
     chimera_nfs_info("NFS4 Destroying session %s", session_id_str);
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_session_hh, table->nfs4_ct_sessions, session_id,
               NFS4_SESSIONID_SIZE, session);
@@ -1101,7 +1102,7 @@ nfs4_client_table_destroy_unified(
 #ifndef __clang_analyzer__
     struct nfs4_client *cur, *tmp;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_ITER(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id, cur, tmp)
     {
@@ -1536,7 +1537,7 @@ nfs4_client_set_cb_path(
     struct nfs_client   *u;
     struct nfs4_cb_path *cb;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), c);
@@ -1611,7 +1612,7 @@ nfs4_client_set_cb_sec(
     struct nfs4_client *c;
     struct nfs_client  *u;
 
-    pthread_mutex_lock(&table->nfs4_ct_lock);
+    chimera_mutex_lock(&table->nfs4_ct_lock, "nfs4_client_table");
 
     HASH_FIND(nfs4_client_hh_by_id, table->nfs4_ct_clients_by_id,
               &client_id, sizeof(client_id), c);
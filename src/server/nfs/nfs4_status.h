@@ -65,6 +65,8 @@ chimera_nfs4_errno_to_nfsstat4(enum chimera_vfs_error err)
             return NFS4ERR_SERVERFAULT;
         case CHIMERA_VFS_ESYMLINK:
             return NFS4ERR_SYMLINK;
+        case CHIMERA_VFS_ENOMEM:
+            return NFS4ERR_DELAY;
         case CHIMERA_VFS_ELOOP:
             return NFS4ERR_SERVERFAULT;
         default:
@@ -289,6 +289,31 @@ struct chimera_server_nfs_shared {
     struct nfs3_drc                     v40_drc;
     struct nfs3_drc                     nfs3_drc;
 
+    /* Call dispatchers wrapped by the request tracer (outermost, so the
+     * RECEIVE stamp precedes DRC lookup); see chimera_nfs_trace_install. */
+    int                                 (*trace_nfs3_dispatch)(
+        struct evpl               *evpl,
+        struct evpl_rpc2_conn     *conn,
+        struct evpl_rpc2_encoding *encoding,
+        uint32_t                   proc,
+        void                      *program_data,
+        struct evpl_rpc2_cred     *cred,
+        xdr_iovec                 *iov,
+        int                        niov,
+        int                        length,
+        void                      *private_data);
+    int                                 (*trace_nfs4_dispatch)(
+        struct evpl               *evpl,
+        struct evpl_rpc2_conn     *conn,
+        struct evpl_rpc2_encoding *encoding,
+        uint32_t                   proc,
+        void                      *program_data,
+        struct evpl_rpc2_cred     *cred,
+        xdr_iovec                 *iov,
+        int                        niov,
+        int                        length,
+        void                      *private_data);
+
     /* Dedup / negative-cache for in-flight lazy 4.1 session hydrates, keyed by
      * sessionid (see nfs4_drc_session_hydrate). */
     pthread_mutex_t                     nfs4_drc_hydra_lock;
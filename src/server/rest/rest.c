@@ -152,6 +152,70 @@ void chimera_rest_handle_debug_fsop(
     const char *,
     int);
 
+/* External handlers from rest_trace.c */
+void chimera_rest_handle_debug_trace_get(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *);
+void chimera_rest_handle_debug_trace_set(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *,
+    const char *,
+    int);
+void chimera_rest_handle_debug_slow_ops_get(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *);
+void chimera_rest_handle_debug_slow_ops_set(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *,
+    const char *,
+    int);
+
+/* External handlers from rest_top.c */
+void chimera_rest_handle_debug_top_get(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *);
+void chimera_rest_handle_debug_top_set(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *,
+    const char *,
+    int);
+
+/* External handlers from rest_locks.c */
+void chimera_rest_handle_debug_locks_get(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *);
+void chimera_rest_handle_debug_locks_set(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *,
+    const char *,
+    int);
+
+/* External handlers from rest_jobs.c */
+void chimera_rest_handle_jobs_list(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *);
+void chimera_rest_handle_jobs_get(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *,
+    const char *);
+void chimera_rest_handle_jobs_set(
+    struct evpl *,
+    struct evpl_http_request *,
+    struct chimera_rest_thread *,
+    const char *,
+    const char *,
+    int);
+
 /* Deferred POST handler types */
 enum chimera_rest_post_handler {
     REST_POST_USERS_CREATE,
@@ -160,6 +224,11 @@ enum chimera_rest_post_handler {
     REST_POST_BUCKETS_CREATE,
     REST_POST_MOUNTS_CREATE,
     REST_POST_DEBUG_FSOP,
+    REST_POST_DEBUG_TRACE,
+    REST_POST_DEBUG_SLOW_OPS,
+    REST_POST_DEBUG_LOCKS,
+    REST_POST_DEBUG_TOP,
+    REST_POST_JOBS_SET,
     REST_POST_AUTH_LOGIN,
 };
 
@@ -167,6 +236,7 @@ enum chimera_rest_post_handler {
 
 struct chimera_rest_post_ctx {
     enum chimera_rest_post_handler handler;
+    char                           param[256];  /* path parameter, if any */
 };
 
 static void
@@ -241,6 +311,26 @@ chimera_rest_notify(
             chimera_rest_handle_debug_fsop(evpl, request, thread,
                                            body, body_len);
             break;
+        case REST_POST_DEBUG_TRACE:
+            chimera_rest_handle_debug_trace_set(evpl, request, thread,
+                                                body, body_len);
+            break;
+        case REST_POST_DEBUG_SLOW_OPS:
+            chimera_rest_handle_debug_slow_ops_set(evpl, request, thread,
+                                                   body, body_len);
+            break;
+        case REST_POST_DEBUG_LOCKS:
+            chimera_rest_handle_debug_locks_set(evpl, request, thread,
+                                                body, body_len);
+            break;
+        case REST_POST_DEBUG_TOP:
+            chimera_rest_handle_debug_top_set(evpl, request, thread,
+                                              body, body_len);
+            break;
+        case REST_POST_JOBS_SET:
+            chimera_rest_handle_jobs_set(evpl, request, thread, ctx->param,
+                                         body, body_len);
+            break;
         case REST_POST_AUTH_LOGIN:
             chimera_rest_handle_auth_login(evpl, request, thread,
                                            body, body_len);
@@ -674,6 +764,94 @@ chimera_rest_dispatch(
         return;
     }
 
+    /* Sampled request latency trace: GET dumps, POST sets the interval */
+    if (url_len == 19 && strncmp(url, "/api/v1/debug/trace", 19) == 0) {
+        if (req_type == EVPL_HTTP_REQUEST_TYPE_GET) {
+            chimera_rest_handle_debug_trace_get(evpl, request, thread);
+        } else if (req_type == EVPL_HTTP_REQUEST_TYPE_POST) {
+            struct chimera_rest_post_ctx *ctx;
+            ctx          = calloc(1, sizeof(*ctx));
+            ctx->handler = REST_POST_DEBUG_TRACE;
+            *notify_data = ctx;
+        } else {
+            chimera_rest_handle_method_not_allowed(evpl, request);
+        }
+        return;
+    }
+
+    /* Slow-op flight recorder: GET dumps, POST sets the threshold */
+    if (url_len == 22 && strncmp(url, "/api/v1/debug/slow_ops", 22) == 0) {
+        if (req_type == EVPL_HTTP_REQUEST_TYPE_GET) {
+            chimera_rest_handle_debug_slow_ops_get(evpl, request, thread);
+        } else if (req_type == EVPL_HTTP_REQUEST_TYPE_POST) {
+            struct chimera_rest_post_ctx *ctx;
+            ctx          = calloc(1, sizeof(*ctx));
+            ctx->handler = REST_POST_DEBUG_SLOW_OPS;
+            *notify_data = ctx;
+        } else {
+            chimera_rest_handle_method_not_allowed(evpl, request);
+        }
+        return;
+    }
+
+    /* Heavy hitters: GET dumps, POST toggles or resets */
+    if (url_len == 17 && strncmp(url, "/api/v1/debug/top", 17) == 0) {
+        if (req_type == EVPL_HTTP_REQUEST_TYPE_GET) {
+            chimera_rest_handle_debug_top_get(evpl, request, thread);
+        } else if (req_type == EVPL_HTTP_REQUEST_TYPE_POST) {
+            struct chimera_rest_post_ctx *ctx;
+            ctx          = calloc(1, sizeof(*ctx));
+            ctx->handler = REST_POST_DEBUG_TOP;
+            *notify_data = ctx;
+        } else {
+            chimera_rest_handle_method_not_allowed(evpl, request);
+        }
+        return;
+    }
+
+    /* Lock contention profiler: GET dumps, POST toggles or resets */
+    if (url_len == 19 && strncmp(url, "/api/v1/debug/locks", 19) == 0) {
+        if (req_type == EVPL_HTTP_REQUEST_TYPE_GET) {
+            chimera_rest_handle_debug_locks_get(evpl, request, thread);
+        } else if (req_type == EVPL_HTTP_REQUEST_TYPE_POST) {
+            struct chimera_rest_post_ctx *ctx;
+            ctx          = calloc(1, sizeof(*ctx));
+            ctx->handler = REST_POST_DEBUG_LOCKS;
+            *notify_data = ctx;
+        } else {
+            chimera_rest_handle_method_not_allowed(evpl, request);
+        }
+        return;
+    }
+
+    /* Background jobs: GET lists, POST /api/v1/jobs/{name} steers one */
+    if (url_len == 12 && strncmp(url, "/api/v1/jobs", 12) == 0) {
+        if (req_type == EVPL_HTTP_REQUEST_TYPE_GET) {
+            chimera_rest_handle_jobs_list(evpl, request, thread);
+        } else {
+            chimera_rest_handle_method_not_allowed(evpl, request);
+        }
+        return;
+    }
+
+    if (chimera_rest_url_starts_with(url, url_len, "/api/v1/jobs/", 13)) {
+        chimera_rest_extract_path_param(url, url_len, 13, param, sizeof(param));
+        if (param[0] != '\0') {
+            if (req_type == EVPL_HTTP_REQUEST_TYPE_GET) {
+                chimera_rest_handle_jobs_get(evpl, request, thread, param);
+            } else if (req_type == EVPL_HTTP_REQUEST_TYPE_POST) {
+                struct chimera_rest_post_ctx *ctx;
+                ctx          = calloc(1, sizeof(*ctx));
+                ctx->handler = REST_POST_JOBS_SET;
+                memcpy(ctx->param, param, sizeof(ctx->param));
+                *notify_data = ctx;
+            } else {
+                chimera_rest_handle_method_not_allowed(evpl, request);
+            }
+            return;
+        }
+    }
+
     chimera_rest_handle_not_found(evpl, request);
 } /* chimera_rest_dispatch */
 
@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Background jobs: /api/v1/jobs
+ *
+ *   GET  /api/v1/jobs         lists every registered background job with
+ *                             its state, I/O budget and progress counters.
+ *   GET  /api/v1/jobs/{name}  returns one job.
+ *   POST /api/v1/jobs/{name}  {"enabled": bool, "rate": int, "start": bool}
+ *                             enables or disables scheduling, sets the
+ *                             budget in bytes/second (0 = unlimited) and/or
+ *                             runs a pass now; all keys are optional.
+ *                             A job without a schedule or budget omits
+ *                             enabled/rate and rejects setting them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jansson.h>
+
+#include "evpl/evpl.h"
+#include "evpl/evpl_http.h"
+#include "common/job_registry.h"
+#include "rest_internal.h"
+
+struct rest_job_set {
+    int      enabled;     /* -1 = unchanged */
+    int      start;
+    int      set_rate;
+    uint64_t rate;
+    json_t  *out;         /* NULL: the job has no such setting */
+};
+
+static json_t *
+rest_job_json(struct chimera_job *job)
+{
+    json_t *obj, *counters;
+    int     i;
+
+    obj      = json_object();
+    counters = json_object();
+
+    if (job->ops->set_enabled) {
+        json_object_set_new(obj, "enabled",
+                            json_boolean(__atomic_load_n(&job->enabled, __ATOMIC_RELAXED)));
+    }
+    json_object_set_new(obj, "running",
+                        json_boolean(__atomic_load_n(&job->running, __ATOMIC_RELAXED)));
+    if (job->ops->set_rate) {
+        json_object_set_new(obj, "rate",
+                            json_integer(__atomic_load_n(&job->rate, __ATOMIC_RELAXED)));
+    }
+
+    for (i = 0; i < job->ncounters; i++) {
+        json_object_set_new(counters, job->counter_names[i],
+                            json_integer(__atomic_load_n(&job->counters[i], __ATOMIC_RELAXED)));
+    }
+
+    json_object_set_new(obj, "counters", counters);
+
+    return obj;
+} /* rest_job_json */
+
+static void
+rest_jobs_add(
+    struct chimera_job *job,
+    void               *arg)
+{
+    json_object_set_new(arg, job->name, rest_job_json(job));
+} /* rest_jobs_add */
+
+static void
+rest_job_get(
+    struct chimera_job *job,
+    void               *arg)
+{
+    *(json_t **) arg = rest_job_json(job);
+} /* rest_job_get */
+
+static void
+rest_job_set(
+    struct chimera_job *job,
+    void               *arg)
+{
+    struct rest_job_set *set = arg;
+
+    /* Refuse the whole request before applying any of it. */
+    if ((set->set_rate && !job->ops->set_rate) ||
+        (set->enabled >= 0 && !job->ops->set_enabled)) {
+        return;
+    }
+
+    if (set->set_rate) {
+        job->ops->set_rate(job, set->rate);
+    }
+
+    if (set->enabled >= 0) {
+        job->ops->set_enabled(job, set->enabled);
+    }
+
+    if (set->start) {
+        job->ops->start(job);
+    }
+
+    set->out = rest_job_json(job);
+} /* rest_job_set */
+
+void
+chimera_rest_handle_jobs_list(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread)
+{
+    json_t *root, *jobs;
+
+    root = json_object();
+    jobs = json_object();
+
+    chimera_job_foreach(rest_jobs_add, jobs);
+
+    json_object_set_new(root, "jobs", jobs);
+
+    chimera_rest_send_json(evpl, request, 200, root);
+} /* chimera_rest_handle_jobs_list */
+
+void
+chimera_rest_handle_jobs_get(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread,
+    const char                 *name)
+{
+    json_t *obj = NULL;
+
+    if (chimera_job_find(name, rest_job_get, &obj) != 0) {
+        chimera_rest_send_error(evpl, request, 404, "Not Found", "No such job");
+        return;
+    }
+
+    chimera_rest_send_json(evpl, request, 200, obj);
+} /* chimera_rest_handle_jobs_get */
+
+void
+chimera_rest_handle_jobs_set(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread,
+    const char                 *name,
+    const char                 *body,
+    int                         body_len)
+{
+    struct rest_job_set set = { .enabled = -1 };
+    json_t             *root, *enabled, *rate, *start;
+    json_error_t        error;
+
+    root = json_loadb(body, body_len, 0, &error);
+
+    if (!root) {
+        chimera_rest_send_error(evpl, request, 400, "Bad Request", "Invalid JSON");
+        return;
+    }
+
+    enabled = json_object_get(root, "enabled");
+    rate    = json_object_get(root, "rate");
+    start   = json_object_get(root, "start");
+
+    if ((enabled && !json_is_boolean(enabled)) ||
+        (start && !json_is_boolean(start)) ||
+        (rate && (!json_is_integer(rate) || json_integer_value(rate) < 0))) {
+        json_decref(root);
+        chimera_rest_send_error(evpl, request, 400, "Bad Request",
+                                "enabled and start must be booleans, rate a non-negative integer");
+        return;
+    }
+
+    if (enabled) {
+        set.enabled = json_is_true(enabled);
+    }
+
+    if (rate) {
+        set.set_rate = 1;
+        set.rate     = json_integer_value(rate);
+    }
+
+    set.start = json_is_true(start);
+
+    json_decref(root);
+
+    if (chimera_job_find(name, rest_job_set, &set) != 0) {
+        chimera_rest_send_error(evpl, request, 404, "Not Found", "No such job");
+        return;
+    }
+
+    if (!set.out) {
+        chimera_rest_send_error(evpl, request, 400, "Bad Request",
+                                "This job has no enabled or rate setting");
+        return;
+    }
+
+    chimera_rest_info("Job %s updated%s%s%s", name,
+                      set.enabled < 0 ? "" : (set.enabled ? " (enabled)" : " (disabled)"),
+                      set.set_rate ? " (rate set)" : "",
+                      set.start ? " (started)" : "");
+
+    chimera_rest_send_json(evpl, request, 200, set.out);
+} /* chimera_rest_handle_jobs_set */
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Lock contention profiler: /api/v1/debug/locks
+ *
+ *   GET  returns whether profiling is enabled and, for every profiled lock
+ *        class, its acquisitions, contended acquisitions, total wait and
+ *        wait-time histogram (log2 nanosecond buckets).
+ *   POST {"enabled": bool, "reset": bool} toggles profiling at runtime
+ *        and/or zeroes the counters; both keys are optional.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jansson.h>
+
+#include "evpl/evpl.h"
+#include "evpl/evpl_http.h"
+#include "common/lock_profile.h"
+#include "rest_internal.h"
+
+static json_t *
+rest_locks_json(void)
+{
+    struct chimera_lock_class *cls;
+    json_t                    *root, *classes, *obj, *buckets;
+    uint64_t                   count;
+    char                       le[24];
+    int                        i;
+
+    root    = json_object();
+    classes = json_object();
+
+    json_object_set_new(root, "enabled", json_boolean(chimera_lock_profile_is_enabled()));
+
+    for (cls = chimera_lock_class_first(); cls; cls = cls->next) {
+        obj     = json_object();
+        buckets = json_object();
+
+        json_object_set_new(obj, "acquisitions",
+                            json_integer(__atomic_load_n(&cls->acquisitions, __ATOMIC_RELAXED)));
+        json_object_set_new(obj, "contended",
+                            json_integer(__atomic_load_n(&cls->contended, __ATOMIC_RELAXED)));
+        json_object_set_new(obj, "wait_ns",
+                            json_integer(__atomic_load_n(&cls->wait_ns, __ATOMIC_RELAXED)));
+
+        /* Non-cumulative; key is the bucket's inclusive upper bound in ns */
+        for (i = 0; i < CHIMERA_LOCK_WAIT_BUCKETS; i++) {
+            count = __atomic_load_n(&cls->wait_buckets[i], __ATOMIC_RELAXED);
+
+            if (!count) {
+                continue;
+            }
+
+            if (i == CHIMERA_LOCK_WAIT_BUCKETS - 1) {
+                snprintf(le, sizeof(le), "+Inf");
+            } else {
+                snprintf(le, sizeof(le), "%lu", 1UL << i);
+            }
+
+            json_object_set_new(buckets, le, json_integer(count));
+        }
+
+        json_object_set_new(obj, "wait_histogram", buckets);
+        json_object_set_new(classes, cls->name, obj);
+    }
+
+    json_object_set_new(root, "classes", classes);
+
+    return root;
+} /* rest_locks_json */
+
+void
+chimera_rest_handle_debug_locks_get(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread)
+{
+    chimera_rest_send_json(evpl, request, 200, rest_locks_json());
+} /* chimera_rest_handle_debug_locks_get */
+
+void
+chimera_rest_handle_debug_locks_set(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread,
+    const char                 *body,
+    int                         body_len)
+{
+    json_t      *root, *enabled, *reset;
+    json_error_t error;
+
+    root = json_loadb(body, body_len, 0, &error);
+
+    if (!root) {
+        chimera_rest_send_error(evpl, request, 400, "Bad Request", "Invalid JSON");
+        return;
+    }
+
+    enabled = json_object_get(root, "enabled");
+    reset   = json_object_get(root, "reset");
+
+    if ((enabled && !json_is_boolean(enabled)) ||
+        (reset && !json_is_boolean(reset))) {
+        json_decref(root);
+        chimera_rest_send_error(evpl, request, 400, "Bad Request",
+                                "enabled and reset must be booleans");
+        return;
+    }
+
+    if (json_is_true(reset)) {
+        chimera_lock_profile_reset();
+        chimera_rest_info("Lock profile counters reset");
+    }
+
+    if (enabled) {
+        chimera_lock_profile_enable(json_is_true(enabled));
+        chimera_rest_info("Lock profiling %s", json_is_true(enabled) ? "enabled" : "disabled");
+    }
+
+    json_decref(root);
+
+    chimera_rest_send_json(evpl, request, 200, rest_locks_json());
+} /* chimera_rest_handle_debug_locks_set */
@@ -0,0 +1,129 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Heavy hitters: /api/v1/debug/top
+ *
+ *   GET  returns, for each dimension (client, export, file, directory),
+ *        the heaviest keys by ops and by bytes, merged across all VFS
+ *        threads, with file and directory handles resolved to paths where
+ *        the reverse path lookup cache allows.
+ *   POST {"enabled": bool, "reset": bool} toggles tracking at runtime
+ *        and/or clears the sketches; both keys are optional.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jansson.h>
+
+#include "evpl/evpl.h"
+#include "evpl/evpl_http.h"
+#include "vfs/vfs.h"
+#include "common/format.h"
+#include "rest_internal.h"
+
+static json_t *
+rest_top_json(struct chimera_vfs *vfs)
+{
+    struct chimera_vfs_hh_entry top[CHIMERA_VFS_HH_TOPK];
+    json_t                     *root, *dims, *dim_obj, *array, *obj;
+    char                        name[CHIMERA_VFS_PATH_MAX];
+    char                        fh[CHIMERA_VFS_HH_KEY_MAX * 2 + 1];
+    int                         dim, metric, n, i;
+
+    root = json_object();
+
+    json_object_set_new(root, "enabled", json_boolean(chimera_vfs_get_heavy_hitters(vfs)));
+    json_object_set_new(root, "decay_secs", json_integer(CHIMERA_VFS_HH_DECAY_SECS));
+
+    dims = json_object();
+
+    for (dim = 0; dim < CHIMERA_VFS_HH_DIM_NUM; dim++) {
+        dim_obj = json_object();
+
+        for (metric = 0; metric < CHIMERA_VFS_HH_METRIC_NUM; metric++) {
+            array = json_array();
+            n     = chimera_vfs_hh_top(vfs, dim, metric, top, CHIMERA_VFS_HH_TOPK);
+
+            for (i = 0; i < n; i++) {
+                chimera_vfs_hh_key_name(vfs, dim, &top[i], name, sizeof(name));
+
+                obj = json_object();
+                json_object_set_new(obj, "key", json_string(name));
+                json_object_set_new(obj, "count", json_integer(top[i].count));
+
+                /* Raw handle alongside the best-effort path */
+                if (dim == CHIMERA_VFS_HH_FILE || dim == CHIMERA_VFS_HH_DIRECTORY) {
+                    format_hex(fh, sizeof(fh), top[i].key, top[i].key_len);
+                    json_object_set_new(obj, "fh", json_string(fh));
+                }
+
+                json_array_append_new(array, obj);
+            }
+
+            json_object_set_new(dim_obj, chimera_vfs_hh_metric_name(metric), array);
+        }
+
+        json_object_set_new(dims, chimera_vfs_hh_dim_name(dim), dim_obj);
+    }
+
+    json_object_set_new(root, "dimensions", dims);
+
+    return root;
+} /* rest_top_json */
+
+void
+chimera_rest_handle_debug_top_get(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread)
+{
+    chimera_rest_send_json(evpl, request, 200, rest_top_json(thread->vfs_thread->vfs));
+} /* chimera_rest_handle_debug_top_get */
+
+void
+chimera_rest_handle_debug_top_set(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread,
+    const char                 *body,
+    int                         body_len)
+{
+    struct chimera_vfs *vfs = thread->vfs_thread->vfs;
+    json_t             *root, *enabled, *reset;
+    json_error_t        error;
+
+    root = json_loadb(body, body_len, 0, &error);
+
+    if (!root) {
+        chimera_rest_send_error(evpl, request, 400, "Bad Request", "Invalid JSON");
+        return;
+    }
+
+    enabled = json_object_get(root, "enabled");
+    reset   = json_object_get(root, "reset");
+
+    if ((enabled && !json_is_boolean(enabled)) ||
+        (reset && !json_is_boolean(reset))) {
+        json_decref(root);
+        chimera_rest_send_error(evpl, request, 400, "Bad Request",
+                                "enabled and reset must be booleans");
+        return;
+    }
+
+    if (json_is_true(reset)) {
+        chimera_vfs_hh_reset(vfs);
+        chimera_rest_info("Heavy-hitter sketches reset");
+    }
+
+    if (enabled) {
+        chimera_vfs_set_heavy_hitters(vfs, json_is_true(enabled));
+        chimera_rest_info("Heavy-hitter tracking %s", json_is_true(enabled) ? "enabled" : "disabled");
+    }
+
+    json_decref(root);
+
+    chimera_rest_send_json(evpl, request, 200, rest_top_json(vfs));
+} /* chimera_rest_handle_debug_top_set */
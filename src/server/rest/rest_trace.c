@@ -0,0 +1,255 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Sampled request latency tracing: /api/v1/debug/trace
+ *
+ *   GET  returns the current sample interval and the most recent sampled
+ *        requests across all threads (newest first, at most
+ *        REST_TRACE_MAX_RECORDS) with their per-stage timings.
+ *   POST {"sample_interval": N} changes the sample interval at runtime;
+ *        0 disables tracing.
+ *
+ * Slow-op flight recorder: /api/v1/debug/slow_ops
+ *
+ *   GET  returns the threshold and every recorded slow op with its full
+ *        context (fh, mount, client, backend, per-stage timings).
+ *   POST {"threshold_us": N} changes the threshold; 0 disables recording.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jansson.h>
+
+#include "evpl/evpl.h"
+#include "evpl/evpl_http.h"
+#include "vfs/vfs.h"
+#include "vfs/vfs_dump.h"
+#include "common/format.h"
+#include "rest_internal.h"
+
+#define REST_TRACE_MAX_RECORDS 1024
+
+static json_t *
+rest_trace_interval_json(struct chimera_vfs *vfs)
+{
+    json_t *root = json_object();
+
+    json_object_set_new(root, "sample_interval",
+                        json_integer(chimera_vfs_get_trace_sample_interval(vfs)));
+
+    return root;
+} /* rest_trace_interval_json */
+
+void
+chimera_rest_handle_debug_trace_get(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread)
+{
+    struct chimera_vfs              *vfs = thread->vfs_thread->vfs;
+    struct chimera_vfs_trace_record *records, *rec;
+    json_t                          *root, *array, *obj, *stages;
+    char                             fh_hash[20];
+    int                              n, i, stage;
+
+    records = calloc(REST_TRACE_MAX_RECORDS, sizeof(*records));
+
+    if (!records) {
+        chimera_rest_send_error(evpl, request, 500, "Internal Server Error",
+                                "Failed to allocate trace buffer");
+        return;
+    }
+
+    n = chimera_vfs_trace_snapshot(vfs, records, REST_TRACE_MAX_RECORDS);
+
+    root  = rest_trace_interval_json(vfs);
+    array = json_array();
+
+    for (i = 0; i < n; i++) {
+        rec = &records[i];
+
+        snprintf(fh_hash, sizeof(fh_hash), "%016llx", (unsigned long long) rec->fh_hash);
+
+        obj = json_object();
+        json_object_set_new(obj, "seq", json_integer(rec->seq));
+        json_object_set_new(obj, "thread", json_integer(rec->thread_id));
+        json_object_set_new(obj, "time_ns", json_integer(rec->wall_ns));
+        json_object_set_new(obj, "protocol", json_string(chimera_vfs_trace_proto_name(rec->proto)));
+        json_object_set_new(obj, "op", json_string(chimera_vfs_op_name(rec->opcode)));
+        json_object_set_new(obj, "status", json_integer(rec->status));
+        json_object_set_new(obj, "fh_hash", json_string(fh_hash));
+
+        /* Offsets from RECEIVE for each stage the request passed through */
+        stages = json_object();
+        for (stage = 0; stage < CHIMERA_VFS_TRACE_STAGE_NUM; stage++) {
+            if (rec->stage_mask & (1 << stage)) {
+                json_object_set_new(stages, chimera_vfs_trace_stage_name(stage),
+                                    json_integer(rec->stage_ns[stage]));
+            }
+        }
+        json_object_set_new(obj, "stages_ns", stages);
+
+        json_array_append_new(array, obj);
+    }
+
+    json_object_set_new(root, "records", array);
+
+    free(records);
+
+    chimera_rest_send_json(evpl, request, 200, root);
+} /* chimera_rest_handle_debug_trace_get */
+
+void
+chimera_rest_handle_debug_trace_set(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread,
+    const char                 *body,
+    int                         body_len)
+{
+    struct chimera_vfs *vfs = thread->vfs_thread->vfs;
+    json_t             *root, *interval;
+    json_error_t        error;
+
+    root = json_loadb(body, body_len, 0, &error);
+
+    if (!root) {
+        chimera_rest_send_error(evpl, request, 400, "Bad Request", "Invalid JSON");
+        return;
+    }
+
+    interval = json_object_get(root, "sample_interval");
+
+    if (!json_is_integer(interval) ||
+        json_integer_value(interval) < 0 ||
+        json_integer_value(interval) > UINT32_MAX) {
+        json_decref(root);
+        chimera_rest_send_error(evpl, request, 400, "Bad Request",
+                                "sample_interval must be a non-negative integer");
+        return;
+    }
+
+    chimera_vfs_set_trace_sample_interval(vfs, json_integer_value(interval));
+
+    chimera_rest_info("Trace sample interval set to %lld",
+                      (long long) json_integer_value(interval));
+
+    json_decref(root);
+
+    chimera_rest_send_json(evpl, request, 200, rest_trace_interval_json(vfs));
+} /* chimera_rest_handle_debug_trace_set */
+
+static json_t *
+rest_slow_ops_threshold_json(struct chimera_vfs *vfs)
+{
+    json_t *root = json_object();
+
+    json_object_set_new(root, "threshold_us",
+                        json_integer(chimera_vfs_get_slow_op_threshold(vfs) / 1000));
+
+    return root;
+} /* rest_slow_ops_threshold_json */
+
+void
+chimera_rest_handle_debug_slow_ops_get(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread)
+{
+    struct chimera_vfs                *vfs = thread->vfs_thread->vfs;
+    struct chimera_vfs_slow_op_record *records, *rec;
+    json_t                            *root, *array, *obj, *stages;
+    char                               fh[CHIMERA_VFS_FH_SIZE * 2 + 1];
+    int                                n, i, stage;
+
+    records = calloc(REST_TRACE_MAX_RECORDS, sizeof(*records));
+
+    if (!records) {
+        chimera_rest_send_error(evpl, request, 500, "Internal Server Error",
+                                "Failed to allocate slow-op buffer");
+        return;
+    }
+
+    n = chimera_vfs_slow_op_snapshot(vfs, records, REST_TRACE_MAX_RECORDS);
+
+    root  = rest_slow_ops_threshold_json(vfs);
+    array = json_array();
+
+    for (i = 0; i < n; i++) {
+        rec = &records[i];
+
+        format_hex(fh, sizeof(fh), rec->fh, rec->fh_len);
+
+        obj = json_object();
+        json_object_set_new(obj, "thread", json_integer(rec->thread_id));
+        json_object_set_new(obj, "time_ns", json_integer(rec->wall_ns));
+        json_object_set_new(obj, "elapsed_ns", json_integer(rec->elapsed_ns));
+        json_object_set_new(obj, "protocol", json_string(chimera_vfs_trace_proto_name(rec->proto)));
+        json_object_set_new(obj, "client", json_string(rec->client));
+        json_object_set_new(obj, "op", json_string(chimera_vfs_op_name(rec->opcode)));
+        json_object_set_new(obj, "status", json_integer(rec->status));
+        json_object_set_new(obj, "backend", json_string(rec->backend));
+        json_object_set_new(obj, "mount", json_string(rec->mount));
+        json_object_set_new(obj, "fh", json_string(fh));
+
+        stages = json_object();
+        for (stage = 0; stage < CHIMERA_VFS_TRACE_STAGE_NUM; stage++) {
+            if (rec->stage_mask & (1 << stage)) {
+                json_object_set_new(stages, chimera_vfs_trace_stage_name(stage),
+                                    json_integer(rec->stage_ns[stage]));
+            }
+        }
+        json_object_set_new(obj, "stages_ns", stages);
+
+        json_array_append_new(array, obj);
+    }
+
+    json_object_set_new(root, "records", array);
+
+    free(records);
+
+    chimera_rest_send_json(evpl, request, 200, root);
+} /* chimera_rest_handle_debug_slow_ops_get */
+
+void
+chimera_rest_handle_debug_slow_ops_set(
+    struct evpl                *evpl,
+    struct evpl_http_request   *request,
+    struct chimera_rest_thread *thread,
+    const char                 *body,
+    int                         body_len)
+{
+    struct chimera_vfs *vfs = thread->vfs_thread->vfs;
+    json_t             *root, *threshold;
+    json_error_t        error;
+
+    root = json_loadb(body, body_len, 0, &error);
+
+    if (!root) {
+        chimera_rest_send_error(evpl, request, 400, "Bad Request", "Invalid JSON");
+        return;
+    }
+
+    threshold = json_object_get(root, "threshold_us");
+
+    if (!json_is_integer(threshold) ||
+        json_integer_value(threshold) < 0 ||
+        json_integer_value(threshold) > UINT32_MAX) {
+        json_decref(root);
+        chimera_rest_send_error(evpl, request, 400, "Bad Request",
+                                "threshold_us must be a non-negative integer");
+        return;
+    }
+
+    chimera_vfs_set_slow_op_threshold(vfs, (uint64_t) json_integer_value(threshold) * 1000);
+
+    chimera_rest_info("Slow-op threshold set to %lld us",
+                      (long long) json_integer_value(threshold));
+
+    json_decref(root);
+
+    chimera_rest_send_json(evpl, request, 200, rest_slow_ops_threshold_json(vfs));
+} /* chimera_rest_handle_debug_slow_ops_set */
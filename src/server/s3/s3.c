@@ -413,7 +413,7 @@ chimera_s3_dispatch_callback(
 } /* chimera_s3_dispatch_callback */
 
 static void
-s3_server_dispatch(
+s3_server_dispatch_request(
     struct evpl                 *evpl,
     struct evpl_http_agent      *agent,
     struct evpl_http_request    *request,
@@ -919,6 +919,24 @@ s3_server_dispatch(
         s3_bucket_map_release(shared->bucket_map);
     }
 
+} /* s3_server_dispatch_request */
+
+static void
+s3_server_dispatch(
+    struct evpl                 *evpl,
+    struct evpl_http_agent      *agent,
+    struct evpl_http_request    *request,
+    evpl_http_notify_callback_t *notify_callback,
+    void                       **notify_data,
+    void                        *private_data)
+{
+    struct chimera_server_s3_thread *thread = private_data;
+
+    /* The bucket/key lookup is issued from here, so it carries the request
+     * tracer's RECEIVE stamp; body-driven VFS ops start later from notify. */
+    chimera_vfs_trace_receive(thread->vfs, CHIMERA_VFS_TRACE_PROTO_S3, NULL);
+    s3_server_dispatch_request(evpl, agent, request, notify_callback, notify_data, private_data);
+    chimera_vfs_trace_receive_done(thread->vfs);
 } /* s3_server_dispatch */
 
 SYMBOL_EXPORT void
@@ -28,6 +28,8 @@
 #include "vfs/vfs_cred.h"
 #include "vfs/vfs_release.h"
 #include "common/macros.h"
+#include "common/lock_profile.h"
+#include "common/thread_stats.h"
 #include "server/server.h"
 #include "smb/smb2.h"
 #include "rest/rest.h"
@@ -77,6 +79,10 @@ struct chimera_server_config {
     int                                   rest_https_port;
     int                                   rest_debug_fsops;
     int                                   rest_auth_enabled;
+    uint32_t                              trace_sample_interval;
+    uint32_t                              slow_op_threshold_us;
+    int                                   lock_profiling;
+    int                                   heavy_hitters;
     int                                   smb_num_dialects;
     uint32_t                              smb_dialects[16];
     int                                   smb_persistent_handles;
@@ -157,6 +163,10 @@ chimera_server_config_init(void)
     config->soft_fail_bad_req        = 0;
     config->rest_debug_fsops         = 0;
     config->rest_auth_enabled        = 1;
+    config->trace_sample_interval    = 0;
+    config->slow_op_threshold_us     = 0;
+    config->lock_profiling           = 0;
+    config->heavy_hitters            = 0;
     config->tcp_flavor               = CHIMERA_TCP_FLAVOR_PLAIN;
 
     config->smb_num_dialects = 5;
@@ -1020,6 +1030,62 @@ chimera_server_config_get_rest_debug_fsops(const struct chimera_server_config *c
     return config->rest_debug_fsops;
 } /* chimera_server_config_get_rest_debug_fsops */
 
+SYMBOL_EXPORT void
+chimera_server_config_set_trace_sample_interval(
+    struct chimera_server_config *config,
+    uint32_t                      interval)
+{
+    config->trace_sample_interval = interval;
+} /* chimera_server_config_set_trace_sample_interval */
+
+SYMBOL_EXPORT uint32_t
+chimera_server_config_get_trace_sample_interval(const struct chimera_server_config *config)
+{
+    return config->trace_sample_interval;
+} /* chimera_server_config_get_trace_sample_interval */
+
+SYMBOL_EXPORT void
+chimera_server_config_set_slow_op_threshold_us(
+    struct chimera_server_config *config,
+    uint32_t                      threshold_us)
+{
+    config->slow_op_threshold_us = threshold_us;
+} /* chimera_server_config_set_slow_op_threshold_us */
+
+SYMBOL_EXPORT uint32_t
+chimera_server_config_get_slow_op_threshold_us(const struct chimera_server_config *config)
+{
+    return config->slow_op_threshold_us;
+} /* chimera_server_config_get_slow_op_threshold_us */
+
+SYMBOL_EXPORT void
+chimera_server_config_set_lock_profiling(
+    struct chimera_server_config *config,
+    int                           enable)
+{
+    config->lock_profiling = enable;
+} /* chimera_server_config_set_lock_profiling */
+
+SYMBOL_EXPORT int
+chimera_server_config_get_lock_profiling(const struct chimera_server_config *config)
+{
+    return config->lock_profiling;
+} /* chimera_server_config_get_lock_profiling */
+
+SYMBOL_EXPORT void
+chimera_server_config_set_heavy_hitters(
+    struct chimera_server_config *config,
+    int                           enable)
+{
+    config->heavy_hitters = enable;
+} /* chimera_server_config_set_heavy_hitters */
+
+SYMBOL_EXPORT int
+chimera_server_config_get_heavy_hitters(const struct chimera_server_config *config)
+{
+    return config->heavy_hitters;
+} /* chimera_server_config_get_heavy_hitters */
+
 SYMBOL_EXPORT void
 chimera_server_config_set_rest_auth_enabled(
     struct chimera_server_config *config,
@@ -1230,6 +1296,8 @@ chimera_server_thread_init(
 
     thread->server = server;
 
+    chimera_thread_stats_register("server");
+
     thread->vfs_thread = chimera_vfs_thread_init(evpl, server->vfs);
 
     for (int i = 0; i < server->num_protocols; i++) {
@@ -2016,6 +2084,7 @@ chimera_server_thread_shutdown(
 
     evpl_remove_timer(evpl, &thread->watchdog);
     chimera_vfs_thread_destroy(thread->vfs_thread);
+    chimera_thread_stats_unregister();
     free(thread);
 } /* chimera_server_thread_shutdown */
 
@@ -2075,6 +2144,16 @@ chimera_server_init(
      * open outbound connections with the same transport. */
     chimera_vfs_set_tcp_flavor(server->vfs, config->tcp_flavor);
 
+    /* Sampled request latency tracing; adjustable at runtime via REST. */
+    chimera_vfs_set_trace_sample_interval(server->vfs, config->trace_sample_interval);
+    chimera_vfs_set_slow_op_threshold(server->vfs, (uint64_t) config->slow_op_threshold_us * 1000);
+
+    /* Lock contention profiling; also toggled at runtime via REST. */
+    chimera_lock_profile_enable(config->lock_profiling);
+
+    /* Heavy-hitter sketches; also toggled at runtime via REST. */
+    chimera_vfs_set_heavy_hitters(server->vfs, config->heavy_hitters);
+
     /* Enable the pNFS feature whenever configured.  Orchestrated flex-files
      * needs a data-server table (below); a layout-sourcing backend (e.g. diskfs
      * block mode) produces its own layouts and needs no data servers, so the
@@ -2147,6 +2226,23 @@ chimera_server_start(struct chimera_server *server)
     chimera_server_info("Server is ready.");
 } /* chimera_server_start */
 
+SYMBOL_EXPORT void
+chimera_server_dump_slow_ops(struct chimera_server *server)
+{
+    chimera_vfs_slow_op_dump(server->vfs);
+} /* chimera_server_dump_slow_ops */
+
+SYMBOL_EXPORT int
+chimera_server_metrics_scrape(
+    char *buf,
+    int   cap,
+    void *private_data)
+{
+    struct chimera_server *server = private_data;
+
+    return chimera_vfs_hh_scrape(server->vfs, buf, cap);
+} /* chimera_server_metrics_scrape */
+
 SYMBOL_EXPORT void
 chimera_server_destroy(struct chimera_server *server)
 {
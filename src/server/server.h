@@ -476,6 +476,42 @@ int
 chimera_server_config_get_rest_debug_fsops(
     const struct chimera_server_config *config);
 
+void
+chimera_server_config_set_trace_sample_interval(
+    struct chimera_server_config *config,
+    uint32_t                      interval);
+
+uint32_t
+chimera_server_config_get_trace_sample_interval(
+    const struct chimera_server_config *config);
+
+void
+chimera_server_config_set_slow_op_threshold_us(
+    struct chimera_server_config *config,
+    uint32_t                      threshold_us);
+
+uint32_t
+chimera_server_config_get_slow_op_threshold_us(
+    const struct chimera_server_config *config);
+
+void
+chimera_server_config_set_lock_profiling(
+    struct chimera_server_config *config,
+    int                           enable);
+
+int
+chimera_server_config_get_lock_profiling(
+    const struct chimera_server_config *config);
+
+void
+chimera_server_config_set_heavy_hitters(
+    struct chimera_server_config *config,
+    int                           enable);
+
+int
+chimera_server_config_get_heavy_hitters(
+    const struct chimera_server_config *config);
+
 void
 chimera_server_config_set_rest_auth_enabled(
     struct chimera_server_config *config,
@@ -648,6 +684,19 @@ void
 chimera_server_start(
     struct chimera_server *server);
 
+/* Log the slow-op flight recorder contents (the daemon's SIGUSR2 action). */
+void
+chimera_server_dump_slow_ops(
+    struct chimera_server *server);
+
+/* Scrape-time Prometheus series (heavy hitters); a chimera_metrics_scrape_cb
+ * taking the server as private_data. */
+int
+chimera_server_metrics_scrape(
+    char *buf,
+    int   cap,
+    void *private_data);
+
 void
 chimera_server_destroy(
     struct chimera_server *server);
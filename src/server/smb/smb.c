@@ -2270,6 +2270,8 @@ chimera_smb_server_notify(
         case EVPL_NOTIFY_RECV_MSG:
             conn->requests_completed++;
 
+            chimera_vfs_trace_receive(thread->vfs_thread, CHIMERA_VFS_TRACE_PROTO_SMB, conn->remote_addr);
+
             if (conn->protocol == EVPL_DATAGRAM_RDMACM_RC) {
                 chimera_smb_server_handle_rdma(evpl, thread, conn,
                                                notify->recv_msg.iovec,
@@ -2282,6 +2284,8 @@ chimera_smb_server_notify(
                                               notify->recv_msg.length);
             }
 
+            chimera_vfs_trace_receive_done(thread->vfs_thread);
+
             for (int i = 0; i < notify->recv_msg.niov; i++) {
                 evpl_iovec_release(evpl, &notify->recv_msg.iovec[i]);
             }
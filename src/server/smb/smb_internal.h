@@ -18,6 +18,7 @@
 #include "common/logging.h"
 #include "common/macros.h"
 #include "common/misc.h"
+#include "common/lock_profile.h"
 #include "smb2.h"
 #include "smb_encrypt.h"
 #include "smb1.h"
@@ -999,6 +1000,21 @@ chimera_smb_parse_reject(
     return 0;
 } /* chimera_smb_parse_reject */
 
+/*
+ * SMB2 status for a failed write or set-info.  Errors there are reported as
+ * STATUS_INTERNAL_ERROR, except an allocation failure (diskfs inline data),
+ * which is transient and reported as STATUS_INSUFFICIENT_RESOURCES.
+ */
+static inline uint32_t
+chimera_smb_vfs_io_status(enum chimera_vfs_error error_code)
+{
+    switch (error_code) {
+        case CHIMERA_VFS_OK:     return SMB2_STATUS_SUCCESS;
+        case CHIMERA_VFS_ENOMEM: return SMB2_STATUS_INSUFFICIENT_RESOURCES;
+        default:                 return SMB2_STATUS_INTERNAL_ERROR;
+    } /* switch */
+} /* chimera_smb_vfs_io_status */
+
 /*
  * Advance the cursor to a client-supplied absolute offset (measured, like all
  * SMB2 *Offset fields, from the start of this request's SMB2 header, which is
@@ -1749,7 +1765,7 @@ chimera_smb_session_alloc(struct chimera_server_smb_shared *shared)
 {
     struct chimera_smb_session *session;
 
-    pthread_mutex_lock(&shared->sessions_lock);
+    chimera_mutex_lock(&shared->sessions_lock, "smb_sessions");
 
     session = shared->free_sessions;
 
@@ -1783,7 +1799,7 @@ chimera_smb_session_authorize(
     struct chimera_server_smb_shared *shared,
     struct chimera_smb_session       *session)
 {
-    pthread_mutex_lock(&shared->sessions_lock);
+    chimera_mutex_lock(&shared->sessions_lock, "smb_sessions");
 
     session->flags |= CHIMERA_SMB_SESSION_AUTHORIZED;
 
@@ -1801,7 +1817,7 @@ chimera_smb_session_lookup(
 {
     struct chimera_smb_session *session;
 
-    pthread_mutex_lock(&shared->sessions_lock);
+    chimera_mutex_lock(&shared->sessions_lock, "smb_sessions");
     HASH_FIND(hh, shared->sessions, &session_id, sizeof(uint64_t), session);
 
     if (session) {
@@ -1829,7 +1845,7 @@ chimera_smb_session_release(
      * set, increment, or HASH_ADD.  Releasing under session->lock instead would
      * race the lookup refcnt++ (lost update -> premature free) and modify the
      * shared hash unprotected (double HASH_DEL on an emptied table crashes). */
-    pthread_mutex_lock(&shared->sessions_lock);
+    chimera_mutex_lock(&shared->sessions_lock, "smb_sessions");
 
     chimera_smb_abort_if(session->refcnt == 0, "session refcnt is 0 at release");
 
@@ -1855,7 +1871,7 @@ chimera_smb_session_release(
             }
         }
 
-        pthread_mutex_lock(&shared->sessions_lock);
+        chimera_mutex_lock(&shared->sessions_lock, "smb_sessions");
 
         LL_PREPEND(shared->free_sessions, session);
 
@@ -2025,7 +2041,7 @@ chimera_smb_session_invalidate_previous(
         return 0;
     }
 
-    pthread_mutex_lock(&shared->sessions_lock);
+    chimera_mutex_lock(&shared->sessions_lock, "smb_sessions");
 
     HASH_FIND(hh, shared->sessions, &prev_session_id, sizeof(uint64_t), prev);
 
@@ -2227,7 +2243,7 @@ chimera_smb_conn_free(
             /* A bound additional channel is going away; free its slot so the
              * session can accept another channel later (MS-SMB2 §3.3.5.5.3). */
             if (session_handle->bound_channel) {
-                pthread_mutex_lock(&thread->shared->sessions_lock);
+                chimera_mutex_lock(&thread->shared->sessions_lock, "smb_sessions");
                 if (session_handle->session->num_channels > 0) {
                     session_handle->session->num_channels--;
                 }
@@ -2292,7 +2308,7 @@ chimera_smb_tree_alloc(struct chimera_server_smb_shared *shared)
 {
     struct chimera_smb_tree *tree;
 
-    pthread_mutex_lock(&shared->trees_lock);
+    chimera_mutex_lock(&shared->trees_lock, "smb_trees");
 
     tree = shared->free_trees;
 
@@ -2487,7 +2503,7 @@ chimera_smb_tree_free(
         chimera_smb_create_resume_parked_broadcast(thread);
     }
 
-    pthread_mutex_lock(&shared->trees_lock);
+    chimera_mutex_lock(&shared->trees_lock, "smb_trees");
 
     LL_PREPEND(shared->free_trees, tree);
 
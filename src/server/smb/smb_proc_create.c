@@ -97,6 +97,7 @@ chimera_smb_create_error_status(enum chimera_vfs_error error_code)
         case CHIMERA_VFS_ENAMETOOLONG: return SMB2_STATUS_NAME_TOO_LONG;
         case CHIMERA_VFS_EROFS:        return SMB2_STATUS_MEDIA_WRITE_PROTECTED;
         case CHIMERA_VFS_ELOOP:        return SMB2_STATUS_STOPPED_ON_SYMLINK;
+        case CHIMERA_VFS_ENOMEM:       return SMB2_STATUS_INSUFFICIENT_RESOURCES;
         default:                       return SMB2_STATUS_OBJECT_NAME_NOT_FOUND;
     } /* switch */
 } /* chimera_smb_create_error_status */
@@ -356,7 +356,7 @@ chimera_smb_session_setup(struct chimera_smb_request *request)
                 return;
             }
 
-            pthread_mutex_lock(&shared->sessions_lock);
+            chimera_mutex_lock(&shared->sessions_lock, "smb_sessions");
             if (session->num_channels >= SMB2_MAX_CHANNELS) {
                 over_limit = 1;
             } else {
@@ -625,7 +625,7 @@ chimera_smb_session_setup(struct chimera_smb_request *request)
              * invalid credentials and expects both channels dead).  Clearing
              * AUTHORIZED keeps the refcnt-driven release below from HASH_DELing
              * a second time. */
-            pthread_mutex_lock(&shared->sessions_lock);
+            chimera_mutex_lock(&shared->sessions_lock, "smb_sessions");
             if (failed_session->flags & CHIMERA_SMB_SESSION_AUTHORIZED) {
                 failed_session->flags |= CHIMERA_SMB_SESSION_DELETED;
                 failed_session->flags &= ~CHIMERA_SMB_SESSION_AUTHORIZED;
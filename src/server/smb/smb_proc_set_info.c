@@ -44,7 +44,7 @@ chimera_smb_set_info_callback(
 
     chimera_smb_open_file_release(request, request->set_info.open_file);
 
-    chimera_smb_complete_request(request, error_code ? SMB2_STATUS_INTERNAL_ERROR : SMB2_STATUS_SUCCESS);
+    chimera_smb_complete_request(request, chimera_smb_vfs_io_status(error_code));
 } /* chimera_smb_set_info_callback */
 
 static void
@@ -108,7 +108,7 @@ chimera_smb_write_callback(
     }
 
     chimera_smb_open_file_release(private_data, request->write.open_file);
-    chimera_smb_complete_request(private_data, error_code ? SMB2_STATUS_INTERNAL_ERROR : SMB2_STATUS_SUCCESS);
+    chimera_smb_complete_request(private_data, chimera_smb_vfs_io_status(error_code));
 } /* chimera_smb_write_callback */
 
 static void
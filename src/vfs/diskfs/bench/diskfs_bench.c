@@ -0,0 +1,1386 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * diskfs microbenchmarks.
+ *
+ * Formats a diskfs filesystem on a file-backed device (by default a file on
+ * /dev/shm, i.e. memory-backed) and drives it through the VFS API from this
+ * process, so the numbers measure diskfs rather than a protocol stack:
+ *
+ *   btree      xattr insert / lookup / scan on one inode's b+tree; the value
+ *              size sets how many records a leaf holds (the fanout)
+ *   log        intent-log commit latency and throughput: xattr replaces whose
+ *              redo payload is the value size, at queue depth 1 and 16 (one
+ *              file per slot, so commits from different slots can share a
+ *              log write)
+ *   spacemap   space-map allocate / free on aged (fragmented) AGs, driven
+ *              in-process with no journal or I/O
+ *   cache      hit-path cost: a resident xattr lookup and a 4 KiB read of
+ *              cached file data
+ *   namespace  create / readdir / unlink rates at 1, 2, 4, ... threads, each
+ *              thread in its own directory
+ *
+ * Results go to stdout (or -o FILE) as one JSON document: per benchmark the
+ * parameters, op count, elapsed time, ops/s and a latency summary, so runs can
+ * be diffed across commits.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <jansson.h>
+
+#include "evpl/evpl.h"
+#include "vfs/vfs.h"
+#include "vfs/vfs_procs.h"
+#include "vfs/vfs_release.h"
+#include "vfs/vfs_attrs.h"
+#include "vfs/vfs_cred.h"
+#include "vfs/vfs_error.h"
+#include "vfs/diskfs/space_map.h"
+#include "common/logging.h"
+#include "prometheus-c.h"
+
+#define BENCH_MOUNT        "bench"
+#define BENCH_QD_MAX       16
+#define BENCH_NAME_MAX     32
+#define BENCH_VALUE_MAX    2048
+#define BENCH_LIST_BUF     (64 * 1024)
+#define BENCH_CACHE_FILE   (1024 * 1024)
+#define BENCH_READ_IOV     8
+#define BENCH_PERMUTE      1000003ULL  /* prime above any op count: i*P mod N permutes */
+
+#define BENCH_ALL          "btree,log,spacemap,cache,namespace"
+
+struct bench_opts {
+    const char *device;
+    const char *device_type;
+    uint64_t    device_size;
+    uint32_t    ops;
+    uint32_t    max_threads;
+    const char *output;
+    const char *only;
+    const char *label;
+    int         keep_device;
+};
+
+struct bench_thread;
+
+struct bench_slot {
+    struct bench_thread            *t;
+    uint32_t                        id;
+    uint64_t                        index;
+    uint64_t                        start_ns;
+    char                            name[BENCH_NAME_MAX];
+    struct evpl_iovec               iov[BENCH_READ_IOV];
+};
+
+typedef void (*bench_issue_t)(
+    struct bench_slot *slot);
+
+/* A pipelined run: `total` ops, at most `qd` in flight.  Completions only park
+ * their slot on the ready list; bench_run_drive reissues from the top, so an
+ * op that completes inline cannot recurse. */
+struct bench_run {
+    bench_issue_t      issue;
+    uint64_t           total;
+    uint64_t           next;
+    uint64_t           completed;
+    uint32_t           errors;
+    uint32_t           nready;
+    uint64_t          *lat;
+    uint64_t           start_ns;
+    uint64_t           end_ns;
+    struct bench_slot *ready[BENCH_QD_MAX];
+    struct bench_slot  slots[BENCH_QD_MAX];
+};
+
+struct bench_thread {
+    struct evpl                    *evpl;
+    struct chimera_vfs_thread      *vfs_thread;
+    struct chimera_vfs_cred         cred;
+
+    /* Synchronous helpers (bench_wait). */
+    int                             done;
+    enum chimera_vfs_error          status;
+    struct chimera_vfs_open_handle *handle;
+    uint8_t                         fh[CHIMERA_VFS_FH_SIZE];
+    uint32_t                        fh_len;
+    uint64_t                        cookie;
+    uint64_t                        verifier;
+    uint32_t                        eof;
+    uint64_t                        entries;
+
+    /* Benchmark state. */
+    struct bench_run                run;
+    struct chimera_vfs_open_handle *dir;
+    struct chimera_vfs_open_handle *file;
+    struct chimera_vfs_open_handle *files[BENCH_QD_MAX];
+    const char                     *value;
+    uint32_t                        value_len;
+    uint64_t                        span;
+};
+
+/* Namespace worker: one OS thread, its own event loop and directory. */
+struct bench_worker {
+    pthread_t           tid;
+    uint32_t            index;
+    uint32_t            nthreads;
+    uint64_t            ops;
+    pthread_barrier_t  *barrier;
+    uint64_t            start_ns[3];
+    uint64_t            end_ns[3];
+    uint64_t           *lat[3];
+    uint32_t            errors[3];
+};
+
+static struct bench_opts   g_opts;
+static struct chimera_vfs *g_vfs;
+static uint8_t             g_root_fh[CHIMERA_VFS_FH_SIZE];
+static uint32_t            g_root_fh_len;
+static json_t             *g_results;
+static char                g_value[BENCH_VALUE_MAX];
+
+static uint64_t
+bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+} /* bench_now_ns */
+
+static int
+bench_enabled(const char *group)
+{
+    const char *p   = g_opts.only;
+    size_t      len = strlen(group);
+
+    while (p && *p) {
+        if (strncmp(p, group, len) == 0 && (p[len] == ',' || p[len] == '\0')) {
+            return 1;
+        }
+        p = strchr(p, ',');
+        p = p ? p + 1 : NULL;
+    }
+    return 0;
+} /* bench_enabled */
+
+static int
+bench_u64_cmp(
+    const void *a,
+    const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+    return x < y ? -1 : x > y;
+} /* bench_u64_cmp */
+
+/* Append one result record; sorts `lat` in place. */
+static void
+bench_report(
+    const char *name,
+    json_t     *params,
+    uint64_t    ops,
+    uint64_t    elapsed_ns,
+    uint64_t   *lat,
+    uint64_t    nlat,
+    uint32_t    errors)
+{
+    json_t  *res = json_object();
+    json_t  *lj  = json_object();
+    uint64_t sum = 0, i;
+
+    json_object_set_new(res, "name", json_string(name));
+    json_object_set_new(res, "params", params ? params : json_object());
+    json_object_set_new(res, "ops", json_integer(ops));
+    json_object_set_new(res, "errors", json_integer(errors));
+    json_object_set_new(res, "elapsed_ns", json_integer(elapsed_ns));
+    json_object_set_new(res, "ops_per_sec",
+                        json_real(elapsed_ns ? (double) ops * 1e9 / elapsed_ns : 0));
+
+    if (lat && nlat) {
+        qsort(lat, nlat, sizeof(*lat), bench_u64_cmp);
+        for (i = 0; i < nlat; i++) {
+            sum += lat[i];
+        }
+        json_object_set_new(lj, "mean", json_integer(sum / nlat));
+        json_object_set_new(lj, "p50", json_integer(lat[nlat / 2]));
+        json_object_set_new(lj, "p90", json_integer(lat[nlat * 90 / 100]));
+        json_object_set_new(lj, "p99", json_integer(lat[nlat * 99 / 100]));
+        json_object_set_new(lj, "p999", json_integer(lat[nlat * 999 / 1000]));
+        json_object_set_new(lj, "max", json_integer(lat[nlat - 1]));
+    }
+    json_object_set_new(res, "latency_ns", lj);
+
+    json_array_append_new(g_results, res);
+
+    fprintf(stderr, "  %-24s %10lu ops %12.0f ops/s\n", name, ops,
+            elapsed_ns ? (double) ops * 1e9 / elapsed_ns : 0);
+} /* bench_report */
+
+/* ------------------------------------------------------------------ */
+/* VFS plumbing                                                        */
+/* ------------------------------------------------------------------ */
+
+static void
+bench_wait(struct bench_thread *t)
+{
+    while (!t->done) {
+        evpl_continue(t->evpl);
+    }
+    t->done = 0;
+} /* bench_wait */
+
+static void
+bench_mount_cb(
+    struct chimera_vfs_thread *thread,
+    enum chimera_vfs_error     status,
+    void                      *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status = status;
+    t->done   = 1;
+} /* bench_mount_cb */
+
+static void
+bench_lookup_cb(
+    enum chimera_vfs_error    error_code,
+    struct chimera_vfs_attrs *attr,
+    void                     *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status = error_code;
+    if (error_code == CHIMERA_VFS_OK) {
+        memcpy(t->fh, attr->va_fh, attr->va_fh_len);
+        t->fh_len = attr->va_fh_len;
+    }
+    t->done = 1;
+} /* bench_lookup_cb */
+
+static void
+bench_open_fh_cb(
+    enum chimera_vfs_error          error_code,
+    struct chimera_vfs_open_handle *oh,
+    void                           *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status = error_code;
+    t->handle = oh;
+    t->done   = 1;
+} /* bench_open_fh_cb */
+
+static void
+bench_open_at_cb(
+    enum chimera_vfs_error          error_code,
+    struct chimera_vfs_open_handle *oh,
+    struct chimera_vfs_attrs       *set_attr,
+    struct chimera_vfs_attrs       *attr,
+    struct chimera_vfs_attrs       *dir_pre,
+    struct chimera_vfs_attrs       *dir_post,
+    void                           *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status = error_code;
+    t->handle = oh;
+    t->done   = 1;
+} /* bench_open_at_cb */
+
+static void
+bench_mkdir_at_cb(
+    enum chimera_vfs_error    error_code,
+    struct chimera_vfs_attrs *set_attr,
+    struct chimera_vfs_attrs *attr,
+    struct chimera_vfs_attrs *dir_pre_attr,
+    struct chimera_vfs_attrs *dir_post_attr,
+    void                     *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status = error_code;
+    if (error_code == CHIMERA_VFS_OK) {
+        memcpy(t->fh, attr->va_fh, attr->va_fh_len);
+        t->fh_len = attr->va_fh_len;
+    }
+    t->done = 1;
+} /* bench_mkdir_at_cb */
+
+static void
+bench_remove_at_cb(
+    enum chimera_vfs_error    error_code,
+    struct chimera_vfs_attrs *pre_attr,
+    struct chimera_vfs_attrs *post_attr,
+    void                     *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status = error_code;
+    t->done   = 1;
+} /* bench_remove_at_cb */
+
+static void
+bench_write_cb(
+    enum chimera_vfs_error    error_code,
+    uint32_t                  length,
+    uint32_t                  sync,
+    struct chimera_vfs_attrs *pre_attr,
+    struct chimera_vfs_attrs *post_attr,
+    void                     *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status = error_code;
+    t->done   = 1;
+} /* bench_write_cb */
+
+static void
+bench_set_xattr_sync_cb(
+    enum chimera_vfs_error          error_code,
+    const struct chimera_vfs_attrs *pre_attr,
+    const struct chimera_vfs_attrs *post_attr,
+    void                           *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status = error_code;
+    t->done   = 1;
+} /* bench_set_xattr_sync_cb */
+
+static struct chimera_vfs_open_handle *
+bench_open_fh(
+    struct bench_thread *t,
+    const uint8_t       *fh,
+    uint32_t             fh_len)
+{
+    chimera_vfs_open_fh(t->vfs_thread, &t->cred, fh, fh_len,
+                        CHIMERA_VFS_OPEN_INFERRED, bench_open_fh_cb, t);
+    bench_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "bench", __FILE__, __LINE__,
+                     "open_fh failed: %d", t->status);
+    return t->handle;
+} /* bench_open_fh */
+
+static struct chimera_vfs_open_handle *
+bench_create(
+    struct bench_thread            *t,
+    struct chimera_vfs_open_handle *dir,
+    const char                     *name)
+{
+    struct chimera_vfs_attrs sattr;
+
+    memset(&sattr, 0, sizeof(sattr));
+    sattr.va_set_mask = CHIMERA_VFS_ATTR_MODE;
+    sattr.va_mode     = 0644;
+
+    chimera_vfs_open_at(t->vfs_thread, &t->cred, dir, name, strlen(name),
+                        CHIMERA_VFS_OPEN_CREATE, &sattr, CHIMERA_VFS_ATTR_FH,
+                        0, 0, bench_open_at_cb, t);
+    bench_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "bench", __FILE__, __LINE__,
+                     "create %s failed: %d", name, t->status);
+    return t->handle;
+} /* bench_create */
+
+static struct chimera_vfs_open_handle *
+bench_mkdir(
+    struct bench_thread            *t,
+    struct chimera_vfs_open_handle *dir,
+    const char                     *name)
+{
+    struct chimera_vfs_attrs sattr;
+
+    memset(&sattr, 0, sizeof(sattr));
+    sattr.va_set_mask = CHIMERA_VFS_ATTR_MODE;
+    sattr.va_mode     = 0755;
+
+    chimera_vfs_mkdir_at(t->vfs_thread, &t->cred, dir, name, strlen(name),
+                         &sattr, CHIMERA_VFS_ATTR_FH, 0, 0, bench_mkdir_at_cb, t);
+    bench_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "bench", __FILE__, __LINE__,
+                     "mkdir %s failed: %d", name, t->status);
+    return bench_open_fh(t, t->fh, t->fh_len);
+} /* bench_mkdir */
+
+static void
+bench_remove(
+    struct bench_thread            *t,
+    struct chimera_vfs_open_handle *dir,
+    const char                     *name)
+{
+    chimera_vfs_remove_at(t->vfs_thread, &t->cred, dir, name, strlen(name),
+                          NULL, 0, 0, 0, NULL, bench_remove_at_cb, t);
+    bench_wait(t);
+} /* bench_remove */
+
+static void
+bench_set_xattr(
+    struct bench_thread            *t,
+    struct chimera_vfs_open_handle *h,
+    const char                     *name,
+    uint32_t                        value_len)
+{
+    chimera_vfs_set_xattr(t->vfs_thread, &t->cred, h, CHIMERA_VFS_XATTR_EITHER,
+                          name, strlen(name), g_value, value_len,
+                          bench_set_xattr_sync_cb, t);
+    bench_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "bench", __FILE__, __LINE__,
+                     "set_xattr %s failed: %d", name, t->status);
+} /* bench_set_xattr */
+
+static void
+bench_thread_init(struct bench_thread *t)
+{
+    memset(t, 0, sizeof(*t));
+    chimera_vfs_cred_init_unix(&t->cred, 0, 0, 0, NULL);
+    t->evpl       = evpl_create(NULL);
+    t->vfs_thread = chimera_vfs_thread_init(t->evpl, g_vfs);
+} /* bench_thread_init */
+
+static void
+bench_thread_destroy(struct bench_thread *t)
+{
+    chimera_vfs_thread_destroy(t->vfs_thread);
+    evpl_destroy(t->evpl);
+} /* bench_thread_destroy */
+
+/* Open the mounted filesystem's root directory on `t`. */
+static struct chimera_vfs_open_handle *
+bench_open_root(struct bench_thread *t)
+{
+    return bench_open_fh(t, g_root_fh, g_root_fh_len);
+} /* bench_open_root */
+
+/* ------------------------------------------------------------------ */
+/* Pipelined runs                                                      */
+/* ------------------------------------------------------------------ */
+
+static void
+bench_slot_done(
+    struct bench_slot     *slot,
+    enum chimera_vfs_error status)
+{
+    struct bench_run *r = &slot->t->run;
+
+    r->lat[slot->index] = bench_now_ns() - slot->start_ns;
+    if (status != CHIMERA_VFS_OK) {
+        r->errors++;
+    }
+    r->completed++;
+    r->ready[r->nready++] = slot;
+} /* bench_slot_done */
+
+static void
+bench_run_drive(
+    struct bench_thread *t,
+    bench_issue_t        issue,
+    uint64_t             total,
+    uint32_t             qd)
+{
+    struct bench_run  *r = &t->run;
+    struct bench_slot *slot;
+    uint32_t           i;
+
+    r->issue     = issue;
+    r->total     = total;
+    r->next      = 0;
+    r->completed = 0;
+    r->errors    = 0;
+    r->nready    = 0;
+    r->lat       = calloc(total ? total : 1, sizeof(*r->lat));
+
+    for (i = 0; i < qd && i < BENCH_QD_MAX; i++) {
+        r->slots[i].t         = t;
+        r->slots[i].id        = i;
+        r->ready[r->nready++] = &r->slots[i];
+    }
+
+    r->start_ns = bench_now_ns();
+    while (r->completed < r->total) {
+        while (r->nready && r->next < r->total) {
+            slot           = r->ready[--r->nready];
+            slot->index    = r->next++;
+            slot->start_ns = bench_now_ns();
+            r->issue(slot);
+        }
+        if (r->completed < r->total && (r->nready == 0 || r->next >= r->total)) {
+            evpl_continue(t->evpl);
+        }
+    }
+    r->end_ns = bench_now_ns();
+} /* bench_run_drive */
+
+/* Run, report and free the latency array. */
+static void
+bench_run_report(
+    struct bench_thread *t,
+    const char          *name,
+    json_t              *params,
+    bench_issue_t        issue,
+    uint64_t             total,
+    uint32_t             qd)
+{
+    bench_run_drive(t, issue, total, qd);
+    bench_report(name, params, total, t->run.end_ns - t->run.start_ns,
+                 t->run.lat, total, t->run.errors);
+    free(t->run.lat);
+    t->run.lat = NULL;
+} /* bench_run_report */
+
+static void
+bench_key(
+    char    *buf,
+    uint64_t index)
+{
+    snprintf(buf, BENCH_NAME_MAX, "user.b%08lu", index);
+} /* bench_key */
+
+static void
+bench_xattr_set_cb(
+    enum chimera_vfs_error          error_code,
+    const struct chimera_vfs_attrs *pre_attr,
+    const struct chimera_vfs_attrs *post_attr,
+    void                           *private_data)
+{
+    bench_slot_done(private_data, error_code);
+} /* bench_xattr_set_cb */
+
+static void
+bench_xattr_get_cb(
+    enum chimera_vfs_error error_code,
+    uint32_t               value_len,
+    void                  *private_data)
+{
+    bench_slot_done(private_data, error_code);
+} /* bench_xattr_get_cb */
+
+static char g_get_buf[BENCH_QD_MAX][BENCH_VALUE_MAX];
+
+static void
+bench_issue_xattr_insert(struct bench_slot *slot)
+{
+    struct bench_thread *t = slot->t;
+
+    bench_key(slot->name, slot->index);
+    chimera_vfs_set_xattr(t->vfs_thread, &t->cred, t->file, CHIMERA_VFS_XATTR_CREATE,
+                          slot->name, strlen(slot->name), t->value, t->value_len,
+                          bench_xattr_set_cb, slot);
+} /* bench_issue_xattr_insert */
+
+static void
+bench_issue_xattr_lookup(struct bench_slot *slot)
+{
+    struct bench_thread *t = slot->t;
+
+    bench_key(slot->name, (slot->index * BENCH_PERMUTE) % t->span);
+    chimera_vfs_get_xattr(t->vfs_thread, &t->cred, t->file, slot->name,
+                          strlen(slot->name), g_get_buf[slot->id], BENCH_VALUE_MAX,
+                          bench_xattr_get_cb, slot);
+} /* bench_issue_xattr_lookup */
+
+static void
+bench_issue_xattr_hit(struct bench_slot *slot)
+{
+    struct bench_thread *t = slot->t;
+
+    chimera_vfs_get_xattr(t->vfs_thread, &t->cred, t->file, "user.b00000000",
+                          14, g_get_buf[slot->id], BENCH_VALUE_MAX,
+                          bench_xattr_get_cb, slot);
+} /* bench_issue_xattr_hit */
+
+static void
+bench_issue_xattr_replace(struct bench_slot *slot)
+{
+    struct bench_thread *t = slot->t;
+
+    chimera_vfs_set_xattr(t->vfs_thread, &t->cred, t->files[slot->id],
+                          CHIMERA_VFS_XATTR_REPLACE, "user.log", 8,
+                          t->value, t->value_len, bench_xattr_set_cb, slot);
+} /* bench_issue_xattr_replace */
+
+static void
+bench_read_cb(
+    enum chimera_vfs_error    error_code,
+    uint32_t                  count,
+    uint32_t                  eof,
+    struct evpl_iovec        *iov,
+    int                       niov,
+    struct chimera_vfs_attrs *attr,
+    void                     *private_data)
+{
+    struct bench_slot *slot = private_data;
+
+    if (error_code == CHIMERA_VFS_OK && niov) {
+        evpl_iovecs_release(slot->t->evpl, iov, niov);
+    }
+    bench_slot_done(slot, error_code);
+} /* bench_read_cb */
+
+static void
+bench_issue_read_hit(struct bench_slot *slot)
+{
+    struct bench_thread *t = slot->t;
+
+    chimera_vfs_read(t->vfs_thread, &t->cred, t->file,
+                     ((slot->index * BENCH_PERMUTE) % (BENCH_CACHE_FILE / 4096)) * 4096,
+                     4096, slot->iov, BENCH_READ_IOV, 0, bench_read_cb, slot);
+} /* bench_issue_read_hit */
+
+static void
+bench_create_cb(
+    enum chimera_vfs_error          error_code,
+    struct chimera_vfs_open_handle *oh,
+    struct chimera_vfs_attrs       *set_attr,
+    struct chimera_vfs_attrs       *attr,
+    struct chimera_vfs_attrs       *dir_pre,
+    struct chimera_vfs_attrs       *dir_post,
+    void                           *private_data)
+{
+    struct bench_slot *slot = private_data;
+
+    if (error_code == CHIMERA_VFS_OK) {
+        chimera_vfs_release(slot->t->vfs_thread, oh);
+    }
+    bench_slot_done(slot, error_code);
+} /* bench_create_cb */
+
+static void
+bench_unlink_cb(
+    enum chimera_vfs_error    error_code,
+    struct chimera_vfs_attrs *pre_attr,
+    struct chimera_vfs_attrs *post_attr,
+    void                     *private_data)
+{
+    bench_slot_done(private_data, error_code);
+} /* bench_unlink_cb */
+
+static void
+bench_issue_create(struct bench_slot *slot)
+{
+    struct bench_thread     *t = slot->t;
+    struct chimera_vfs_attrs sattr;
+
+    memset(&sattr, 0, sizeof(sattr));
+    sattr.va_set_mask = CHIMERA_VFS_ATTR_MODE;
+    sattr.va_mode     = 0644;
+
+    snprintf(slot->name, sizeof(slot->name), "f%08lu", slot->index);
+    chimera_vfs_open_at(t->vfs_thread, &t->cred, t->dir, slot->name,
+                        strlen(slot->name), CHIMERA_VFS_OPEN_CREATE, &sattr,
+                        CHIMERA_VFS_ATTR_FH, 0, 0, bench_create_cb, slot);
+} /* bench_issue_create */
+
+static void
+bench_issue_unlink(struct bench_slot *slot)
+{
+    struct bench_thread *t = slot->t;
+
+    snprintf(slot->name, sizeof(slot->name), "f%08lu", slot->index);
+    chimera_vfs_remove_at(t->vfs_thread, &t->cred, t->dir, slot->name,
+                          strlen(slot->name), NULL, 0, 0, 0, NULL,
+                          bench_unlink_cb, slot);
+} /* bench_issue_unlink */
+
+/* ------------------------------------------------------------------ */
+/* Sequential scans                                                    */
+/* ------------------------------------------------------------------ */
+
+static void
+bench_list_xattrs_cb(
+    enum chimera_vfs_error error_code,
+    const char            *names,
+    uint32_t               names_len,
+    uint32_t               count,
+    uint32_t               eof,
+    uint64_t               cookie,
+    void                  *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status   = error_code;
+    t->entries += count;
+    t->eof      = eof || error_code != CHIMERA_VFS_OK;
+    t->cookie   = cookie;
+    t->done     = 1;
+} /* bench_list_xattrs_cb */
+
+static int
+bench_readdir_entry_cb(
+    uint64_t                        inum,
+    uint64_t                        cookie,
+    const char                     *name,
+    int                             namelen,
+    const struct chimera_vfs_attrs *attrs,
+    void                           *arg)
+{
+    struct bench_thread *t = arg;
+
+    t->entries++;
+    return 0;
+} /* bench_readdir_entry_cb */
+
+static void
+bench_readdir_complete_cb(
+    enum chimera_vfs_error          error_code,
+    struct chimera_vfs_open_handle *handle,
+    uint64_t                        cookie,
+    uint64_t                        verifier,
+    uint32_t                        eof,
+    struct chimera_vfs_attrs       *attr,
+    void                           *private_data)
+{
+    struct bench_thread *t = private_data;
+
+    t->status   = error_code;
+    t->cookie   = cookie;
+    t->verifier = verifier;
+    t->eof      = eof || error_code != CHIMERA_VFS_OK;
+    t->done     = 1;
+} /* bench_readdir_complete_cb */
+
+/* Page through every xattr of t->file; returns entries seen, per-page
+ * latencies in *r_lat (caller frees). */
+static uint64_t
+bench_scan_xattrs(
+    struct bench_thread *t,
+    uint64_t           **r_lat,
+    uint64_t            *r_nlat)
+{
+    static char buf[BENCH_LIST_BUF];
+    uint64_t    cap = 64, n = 0, start;
+    uint64_t   *lat = malloc(cap * sizeof(*lat));
+
+    t->entries = 0;
+    t->cookie  = 0;
+    t->eof     = 0;
+    while (!t->eof) {
+        start = bench_now_ns();
+        chimera_vfs_list_xattrs(t->vfs_thread, &t->cred, t->file, t->cookie,
+                                buf, sizeof(buf), bench_list_xattrs_cb, t);
+        bench_wait(t);
+        if (n == cap) {
+            cap *= 2;
+            lat  = realloc(lat, cap * sizeof(*lat));
+        }
+        lat[n++] = bench_now_ns() - start;
+    }
+    *r_lat  = lat;
+    *r_nlat = n;
+    return t->entries;
+} /* bench_scan_xattrs */
+
+static uint64_t
+bench_scan_dir(
+    struct bench_thread *t,
+    uint64_t           **r_lat,
+    uint64_t            *r_nlat)
+{
+    uint64_t  cap = 64, n = 0, start;
+    uint64_t *lat = malloc(cap * sizeof(*lat));
+
+    t->entries  = 0;
+    t->cookie   = 0;
+    t->verifier = 0;
+    t->eof      = 0;
+    while (!t->eof) {
+        start = bench_now_ns();
+        chimera_vfs_readdir(t->vfs_thread, &t->cred, t->dir, 0, 0, t->cookie,
+                            t->verifier, 0, bench_readdir_entry_cb,
+                            bench_readdir_complete_cb, t);
+        bench_wait(t);
+        if (n == cap) {
+            cap *= 2;
+            lat  = realloc(lat, cap * sizeof(*lat));
+        }
+        lat[n++] = bench_now_ns() - start;
+    }
+    *r_lat  = lat;
+    *r_nlat = n;
+    return t->entries;
+} /* bench_scan_dir */
+
+/* ------------------------------------------------------------------ */
+/* Benchmarks                                                          */
+/* ------------------------------------------------------------------ */
+
+/* Rough records per leaf for an xattr of `value_len`: the record (name +
+ * value) plus its slot and key, out of a 4 KiB node. */
+static uint32_t
+bench_est_fanout(uint32_t value_len)
+{
+    return 4096 / (value_len + 14 + 24);
+} /* bench_est_fanout */
+
+static json_t *
+bench_btree_params(uint32_t value_len)
+{
+    return json_pack("{s:i, s:i, s:i}", "value_bytes", value_len,
+                     "est_leaf_fanout", bench_est_fanout(value_len),
+                     "records", g_opts.ops);
+} /* bench_btree_params */
+
+static void
+bench_btree(
+    struct bench_thread            *t,
+    struct chimera_vfs_open_handle *root)
+{
+    static const uint32_t           sizes[] = { 32, 256, 1024 };
+    struct chimera_vfs_open_handle *keep    = NULL;
+    char                            name[BENCH_NAME_MAX];
+    uint64_t                       *lat, nlat, entries, start, elapsed;
+    unsigned int                    i;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        snprintf(name, sizeof(name), "btree.%u", sizes[i]);
+        t->file      = bench_create(t, root, name);
+        t->value     = g_value;
+        t->value_len = sizes[i];
+        t->span      = g_opts.ops;
+
+        bench_run_report(t, "btree.insert", bench_btree_params(sizes[i]),
+                         bench_issue_xattr_insert, g_opts.ops, 1);
+        bench_run_report(t, "btree.lookup", bench_btree_params(sizes[i]),
+                         bench_issue_xattr_lookup, g_opts.ops, 1);
+
+        start   = bench_now_ns();
+        entries = bench_scan_xattrs(t, &lat, &nlat);
+        elapsed = bench_now_ns() - start;
+        bench_report("btree.scan", bench_btree_params(sizes[i]), entries, elapsed,
+                     lat, nlat, entries != g_opts.ops);
+        free(lat);
+
+        /* Keep the 32-byte tree resident for the cache benchmark. */
+        if (i == 0) {
+            keep = t->file;
+            continue;
+        }
+        chimera_vfs_release(t->vfs_thread, t->file);
+        bench_remove(t, root, name);
+    }
+    t->file = keep;
+} /* bench_btree */
+
+static void
+bench_log(
+    struct bench_thread            *t,
+    struct chimera_vfs_open_handle *root)
+{
+    static const uint32_t sizes[] = { 64, 512, 2048 };
+    static const uint32_t depths[] = { 1, BENCH_QD_MAX };
+    char                  name[BENCH_NAME_MAX];
+    unsigned int          i, d, f;
+
+    for (f = 0; f < BENCH_QD_MAX; f++) {
+        snprintf(name, sizeof(name), "log.%u", f);
+        t->files[f] = bench_create(t, root, name);
+        bench_set_xattr(t, t->files[f], "user.log", sizes[0]);
+    }
+
+    t->value = g_value;
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+            t->value_len = sizes[i];
+            bench_run_report(t, "log.commit",
+                             json_pack("{s:i, s:i}", "redo_bytes", sizes[i],
+                                       "queue_depth", depths[d]),
+                             bench_issue_xattr_replace, g_opts.ops, depths[d]);
+        }
+    }
+
+    for (f = 0; f < BENCH_QD_MAX; f++) {
+        snprintf(name, sizeof(name), "log.%u", f);
+        chimera_vfs_release(t->vfs_thread, t->files[f]);
+        bench_remove(t, root, name);
+    }
+} /* bench_log */
+
+static void
+bench_cache(
+    struct bench_thread            *t,
+    struct chimera_vfs_open_handle *root)
+{
+    struct evpl_iovec iov;
+    uint64_t          off;
+
+    /* The 32-byte xattr tree from bench_btree, or a one-record stand-in. */
+    if (!t->file) {
+        t->file = bench_create(t, root, "btree.32");
+        bench_set_xattr(t, t->file, "user.b00000000", 32);
+    }
+    bench_run_report(t, "cache.xattr_lookup", NULL, bench_issue_xattr_hit,
+                     g_opts.ops, 1);
+    chimera_vfs_release(t->vfs_thread, t->file);
+    bench_remove(t, root, "btree.32");
+
+    t->file = bench_create(t, root, "cache.dat");
+    for (off = 0; off < BENCH_CACHE_FILE; off += 65536) {
+        evpl_iovec_alloc(t->evpl, 65536, 4096, 1, 0, &iov);
+        memset(iov.data, (int) (off >> 16), 65536);
+        chimera_vfs_write(t->vfs_thread, &t->cred, t->file, off, 65536, 1, 0, 0,
+                          &iov, 1, bench_write_cb, t);
+        bench_wait(t);
+        evpl_iovec_release(t->evpl, &iov);
+    }
+
+    /* One untimed pass faults the file into the data cache. */
+    bench_run_drive(t, bench_issue_read_hit, BENCH_CACHE_FILE / 4096, 1);
+    free(t->run.lat);
+    bench_run_report(t, "cache.read_4k",
+                     json_pack("{s:i}", "file_bytes", BENCH_CACHE_FILE),
+                     bench_issue_read_hit, g_opts.ops, 1);
+
+    chimera_vfs_release(t->vfs_thread, t->file);
+    t->file = NULL;
+    bench_remove(t, root, "cache.dat");
+} /* bench_cache */
+
+/* ------------------------------------------------------------------ */
+/* Space map (in-process, no journal)                                  */
+/* ------------------------------------------------------------------ */
+
+struct bench_extent {
+    uint32_t device_id;
+    uint64_t offset;
+    uint64_t length;
+};
+
+static uint64_t
+bench_rand(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+} /* bench_rand */
+
+static void
+bench_spacemap(void)
+{
+    static const uint64_t  sizes[] = { 4096, 65536, 1048576 };
+    struct sm_device_cfg   cfg;
+    struct sm_thread_cache cache = { 0 };
+    struct space_map      *sm;
+    struct bench_extent   *aged, *ext, tmp;
+    uint64_t               naged = 0, used = 0, seed = 0x9E3779B97F4A7C15ULL;
+    uint64_t               i, j, n, ok, start, t0, total, *lat;
+    double                 used_fraction;
+    unsigned int           s;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.size = 16ULL << 30;
+    cfg.role = SM_DEV_LOCAL;
+    sm       = space_map_create(&cfg, 1, 64ULL << 20, 0, 0, 0);
+    total    = space_map_free_bytes(sm);
+
+    /* Age: fill to 80% with 4 KiB..256 KiB extents, then free a random half,
+     * leaving ~40% used with the free space scattered across every AG. */
+    aged = malloc(total / 4096 * sizeof(*aged));
+    while (used < total / 10 * 8) {
+        ext         = &aged[naged];
+        ext->length = (1 + bench_rand(&seed) % 64) * 4096;
+        if (space_map_alloc(sm, &cache, NULL, SM_DEV_LOCAL, ext->length, 0,
+                            SM_DEVICE_ANY, &ext->device_id, &ext->offset) != 0) {
+            break;
+        }
+        used += ext->length;
+        naged++;
+    }
+    for (i = naged; i > 1; i--) {
+        j           = bench_rand(&seed) % i;
+        tmp         = aged[i - 1];
+        aged[i - 1] = aged[j];
+        aged[j]     = tmp;
+    }
+    for (i = 0; i < naged / 2; i++) {
+        space_map_free(sm, NULL, aged[i].device_id, aged[i].offset, aged[i].length);
+    }
+
+    used_fraction = 1.0 - (double) space_map_free_bytes(sm) / total;
+    ext           = malloc(g_opts.ops * sizeof(*ext));
+    lat           = malloc(g_opts.ops * sizeof(*lat));
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        /* Never take more than half the remaining space, so every size sees
+         * the same aged layout rather than a full device. */
+        n = space_map_free_bytes(sm) / 2 / sizes[s];
+        n = n < g_opts.ops ? n : g_opts.ops;
+
+        ok    = 0;
+        start = bench_now_ns();
+        for (i = 0; i < n; i++) {
+            t0 = bench_now_ns();
+            if (space_map_alloc(sm, &cache, NULL, SM_DEV_LOCAL, sizes[s], 0,
+                                SM_DEVICE_ANY, &ext[ok].device_id,
+                                &ext[ok].offset) == 0) {
+                ext[ok++].length = sizes[s];
+            }
+            lat[i] = bench_now_ns() - t0;
+        }
+        bench_report("spacemap.alloc",
+                     json_pack("{s:I, s:f}", "alloc_bytes", (json_int_t) sizes[s],
+                               "used_fraction", used_fraction),
+                     n, bench_now_ns() - start, lat, n, n - ok);
+
+        start = bench_now_ns();
+        for (i = 0; i < ok; i++) {
+            t0 = bench_now_ns();
+            space_map_free(sm, NULL, ext[i].device_id, ext[i].offset, ext[i].length);
+            lat[i] = bench_now_ns() - t0;
+        }
+        bench_report("spacemap.free",
+                     json_pack("{s:I, s:f}", "alloc_bytes", (json_int_t) sizes[s],
+                               "used_fraction", used_fraction),
+                     ok, bench_now_ns() - start, lat, ok, 0);
+    }
+
+    free(lat);
+    free(ext);
+    free(aged);
+    space_map_destroy(sm);
+} /* bench_spacemap */
+
+/* ------------------------------------------------------------------ */
+/* Namespace scaling                                                   */
+/* ------------------------------------------------------------------ */
+
+static void *
+bench_worker_main(void *arg)
+{
+    struct bench_worker            *w = arg;
+    struct bench_thread             t;
+    struct chimera_vfs_open_handle *root;
+    char                            name[BENCH_NAME_MAX];
+    uint64_t                        nlat;
+
+    bench_thread_init(&t);
+    root = bench_open_root(&t);
+    snprintf(name, sizeof(name), "ns.%u.%u", w->nthreads, w->index);
+    t.dir = bench_mkdir(&t, root, name);
+
+    pthread_barrier_wait(w->barrier);
+    bench_run_drive(&t, bench_issue_create, w->ops, 1);
+    w->start_ns[0] = t.run.start_ns;
+    w->end_ns[0]   = t.run.end_ns;
+    w->lat[0]      = t.run.lat;
+    w->errors[0]   = t.run.errors;
+
+    pthread_barrier_wait(w->barrier);
+    w->start_ns[1] = bench_now_ns();
+    w->errors[1]   = bench_scan_dir(&t, &w->lat[1], &nlat) < w->ops;
+    w->end_ns[1]   = bench_now_ns();
+    free(w->lat[1]);
+    w->lat[1] = NULL;
+
+    pthread_barrier_wait(w->barrier);
+    bench_run_drive(&t, bench_issue_unlink, w->ops, 1);
+    w->start_ns[2] = t.run.start_ns;
+    w->end_ns[2]   = t.run.end_ns;
+    w->lat[2]      = t.run.lat;
+    w->errors[2]   = t.run.errors;
+
+    chimera_vfs_release(t.vfs_thread, t.dir);
+    bench_remove(&t, root, name);
+    chimera_vfs_release(t.vfs_thread, root);
+    bench_thread_destroy(&t);
+    return NULL;
+} /* bench_worker_main */
+
+static void
+bench_namespace(void)
+{
+    static const char   *phases[] = { "namespace.create", "namespace.readdir",
+                                      "namespace.unlink" };
+    struct bench_worker *w;
+    pthread_barrier_t    barrier;
+    uint32_t             nthreads, i, p, errors;
+    uint64_t             per, first, last, n, *lat;
+
+    for (nthreads = 1; nthreads <= g_opts.max_threads; nthreads *= 2) {
+        per = g_opts.ops / nthreads ? g_opts.ops / nthreads : 1;
+        w   = calloc(nthreads, sizeof(*w));
+        pthread_barrier_init(&barrier, NULL, nthreads);
+
+        for (i = 0; i < nthreads; i++) {
+            w[i].index    = i;
+            w[i].nthreads = nthreads;
+            w[i].ops      = per;
+            w[i].barrier  = &barrier;
+            pthread_create(&w[i].tid, NULL, bench_worker_main, &w[i]);
+        }
+        for (i = 0; i < nthreads; i++) {
+            pthread_join(w[i].tid, NULL);
+        }
+
+        /* Aggregate: total ops over the span from the first start to the last
+         * finish; latencies pooled across threads (readdir reports rate only). */
+        for (p = 0; p < 3; p++) {
+            first  = UINT64_MAX;
+            last   = 0;
+            errors = 0;
+            lat    = p == 1 ? NULL : malloc(per * nthreads * sizeof(*lat));
+            for (i = 0, n = 0; i < nthreads; i++) {
+                first   = w[i].start_ns[p] < first ? w[i].start_ns[p] : first;
+                last    = w[i].end_ns[p] > last ? w[i].end_ns[p] : last;
+                errors += w[i].errors[p];
+                if (lat) {
+                    memcpy(lat + n, w[i].lat[p], per * sizeof(*lat));
+                    n += per;
+                    free(w[i].lat[p]);
+                }
+            }
+            bench_report(phases[p],
+                         json_pack("{s:i, s:I}", "threads", nthreads,
+                                   "entries_per_thread", (json_int_t) per),
+                         per * nthreads, last - first, lat, n, errors);
+            free(lat);
+        }
+
+        pthread_barrier_destroy(&barrier);
+        free(w);
+    }
+} /* bench_namespace */
+
+/* ------------------------------------------------------------------ */
+/* Setup                                                               */
+/* ------------------------------------------------------------------ */
+
+static void
+bench_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -d PATH   device file (default /dev/shm/diskfs_bench.<pid>.img, removed at exit)\n"
+            "  -t TYPE   block backend: io_uring (default) or libaio\n"
+            "  -s GIB    device size in GiB (default 4)\n"
+            "  -n OPS    operations per benchmark (default 20000, max 1000000)\n"
+            "  -j N      highest namespace thread count (default 8)\n"
+            "  -b LIST   benchmarks to run (default %s)\n"
+            "  -l LABEL  free-form label recorded in the output (e.g. a commit id)\n"
+            "  -o FILE   write the JSON results to FILE instead of stdout\n"
+            "  -k        keep the device file\n",
+            prog, BENCH_ALL);
+} /* bench_usage */
+
+/* diskfs takes its configuration as module config data at vfs init. */
+static void
+bench_config(
+    const char *device,
+    char       *buf,
+    size_t      size)
+{
+    json_t *cfg, *devices, *dev;
+    char   *text;
+
+    cfg     = json_object();
+    devices = json_array();
+    dev     = json_object();
+    json_object_set_new(dev, "type", json_string(g_opts.device_type));
+    json_object_set_new(dev, "path", json_string(device));
+    json_object_set_new(dev, "size", json_integer(g_opts.device_size));
+    json_array_append_new(devices, dev);
+    json_object_set_new(cfg, "devices", devices);
+    json_object_set_new(cfg, "initialize", json_true());
+    json_object_set_new(cfg, "intent_log_size", json_integer(64 * 1024 * 1024));
+    text = json_dumps(cfg, JSON_COMPACT);
+    json_decref(cfg);
+
+    snprintf(buf, size, "%s", text);
+    free(text);
+} /* bench_config */
+
+static void
+bench_mount(struct bench_thread *t)
+{
+    chimera_vfs_mount(t->vfs_thread, &t->cred, "/" BENCH_MOUNT, "diskfs", "/",
+                      NULL, bench_mount_cb, t);
+    bench_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "bench", __FILE__, __LINE__,
+                     "mount failed: %d", t->status);
+
+    chimera_vfs_get_root_fh(g_root_fh, &g_root_fh_len);
+    chimera_vfs_lookup(t->vfs_thread, &t->cred, g_root_fh, g_root_fh_len,
+                       BENCH_MOUNT, strlen(BENCH_MOUNT),
+                       CHIMERA_VFS_ATTR_FH | CHIMERA_VFS_ATTR_MASK_STAT, 0,
+                       bench_lookup_cb, t);
+    bench_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "bench", __FILE__, __LINE__,
+                     "lookup of the mount failed: %d", t->status);
+    memcpy(g_root_fh, t->fh, t->fh_len);
+    g_root_fh_len = t->fh_len;
+} /* bench_mount */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    struct chimera_vfs_module_cfg   module_cfgs[2];
+    struct prometheus_metrics      *metrics;
+    struct bench_thread             t;
+    struct chimera_vfs_open_handle *root;
+    char                            device[256];
+    json_t                         *doc, *cfg;
+    FILE                           *out;
+    int                             opt, fd, created = 0;
+    long                            ncpu;
+
+    g_opts.device_type = "io_uring";
+    g_opts.device_size = 4ULL << 30;
+    g_opts.ops         = 20000;
+    g_opts.max_threads = 8;
+    g_opts.only        = BENCH_ALL;
+
+    while ((opt = getopt(argc, argv, "d:t:s:n:j:b:l:o:kh")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_opts.device = optarg;
+                break;
+            case 't':
+                g_opts.device_type = optarg;
+                break;
+            case 's':
+                g_opts.device_size = strtoull(optarg, NULL, 0) << 30;
+                break;
+            case 'n':
+                g_opts.ops = strtoul(optarg, NULL, 0);
+                break;
+            case 'j':
+                g_opts.max_threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                g_opts.only = optarg;
+                break;
+            case 'l':
+                g_opts.label = optarg;
+                break;
+            case 'o':
+                g_opts.output = optarg;
+                break;
+            case 'k':
+                g_opts.keep_device = 1;
+                break;
+            default:
+                bench_usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        } /* switch */
+    }
+
+    if (g_opts.ops == 0 || g_opts.ops > 1000000 || g_opts.max_threads == 0 ||
+        g_opts.device_size < (1ULL << 30)) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu > 0 && g_opts.max_threads > (uint32_t) ncpu) {
+        g_opts.max_threads = ncpu;
+    }
+
+    if (g_opts.device) {
+        snprintf(device, sizeof(device), "%s", g_opts.device);
+    } else {
+        snprintf(device, sizeof(device), "/dev/shm/diskfs_bench.%d.img", getpid());
+    }
+    fd = open(device, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd >= 0) {
+        created = 1;
+        if (ftruncate(fd, g_opts.device_size) < 0) {
+            fprintf(stderr, "Failed to size %s: %s\n", device, strerror(errno));
+            close(fd);
+            unlink(device);
+            return 1;
+        }
+        close(fd);
+    } else if (errno != EEXIST) {
+        fprintf(stderr, "Failed to create %s: %s\n", device, strerror(errno));
+        return 1;
+    }
+
+    memset(g_value, 'v', sizeof(g_value));
+    g_results = json_array();
+
+    chimera_log_init();
+    metrics = prometheus_metrics_create(NULL, NULL, 0);
+
+    memset(module_cfgs, 0, sizeof(module_cfgs));
+    strncpy(module_cfgs[0].module_name, "diskfs", sizeof(module_cfgs[0].module_name) - 1);
+    strncpy(module_cfgs[1].module_name, "memkv", sizeof(module_cfgs[1].module_name) - 1);
+    bench_config(device, module_cfgs[0].config_data, sizeof(module_cfgs[0].config_data));
+
+    g_vfs = chimera_vfs_init(0, 0, module_cfgs, 2, "memkv", 60, 0, metrics);
+
+    bench_thread_init(&t);
+    bench_mount(&t);
+    root = bench_open_root(&t);
+
+    fprintf(stderr, "diskfs_bench: %s (%s, %lu GiB), %u ops\n", device,
+            g_opts.device_type, g_opts.device_size >> 30, g_opts.ops);
+
+    if (bench_enabled("btree")) {
+        bench_btree(&t, root);
+    }
+    if (bench_enabled("log")) {
+        bench_log(&t, root);
+    }
+    if (bench_enabled("cache")) {
+        bench_cache(&t, root);
+    } else if (t.file) {
+        chimera_vfs_release(t.vfs_thread, t.file);
+        bench_remove(&t, root, "btree.32");
+    }
+    if (bench_enabled("spacemap")) {
+        bench_spacemap();
+    }
+    if (bench_enabled("namespace")) {
+        bench_namespace();
+    }
+
+    chimera_vfs_release(t.vfs_thread, root);
+    bench_thread_destroy(&t);
+    chimera_vfs_destroy(g_vfs);
+    prometheus_metrics_destroy(metrics);
+
+    if (created && !g_opts.keep_device) {
+        unlink(device);
+    }
+
+    cfg = json_pack("{s:s, s:s, s:I, s:i, s:i}",
+                    "device", device,
+                    "device_type", g_opts.device_type,
+                    "device_bytes", (json_int_t) g_opts.device_size,
+                    "ops", g_opts.ops,
+                    "max_threads", g_opts.max_threads);
+    doc = json_pack("{s:s, s:i, s:s?, s:I, s:o, s:o}",
+                    "suite", "diskfs_bench",
+                    "format", 1,
+                    "label", g_opts.label,
+                    "timestamp", (json_int_t) time(NULL),
+                    "config", cfg,
+                    "results", g_results);
+
+    out = g_opts.output ? fopen(g_opts.output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Failed to open %s: %s\n", g_opts.output, strerror(errno));
+        json_decref(doc);
+        return 1;
+    }
+    json_dumpf(doc, out, JSON_INDENT(2));
+    fputc('\n', out);
+    if (out != stdout) {
+        fclose(out);
+    }
+    json_decref(doc);
+    return 0;
+} /* main */
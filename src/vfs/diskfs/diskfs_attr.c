@@ -91,12 +91,20 @@ diskfs_setattr_acl_removed_cb(
     int                  result,
     void                *private_data);
 
+static void
+diskfs_setattr_inline_resize(
+    struct chimera_vfs_request *request);
+
 static void
 diskfs_setattr_inode_cb(
     struct diskfs_inode *inode,
     int                  status,
     void                *private_data);
 
+static void
+diskfs_setattr_apply(
+    struct chimera_vfs_request *request);
+
 static void
 diskfs_mount_walk_dirent_cb(
     struct diskfs_bt_op *op,
@@ -126,6 +134,26 @@ diskfs_xattr_rec_matches(
     const char                    *name,
     uint32_t                       name_len);
 
+static inline int
+diskfs_xattr_is_extsize(
+    const char *name,
+    uint32_t    name_len);
+
+static void
+diskfs_get_xattr_extsize(
+    struct chimera_vfs_request *request,
+    struct diskfs_inode        *inode);
+
+static void
+diskfs_set_xattr_extsize(
+    struct chimera_vfs_request *request,
+    struct diskfs_inode        *inode);
+
+static void
+diskfs_remove_xattr_extsize(
+    struct chimera_vfs_request *request,
+    struct diskfs_inode        *inode);
+
 static void
 diskfs_get_xattr_lookup_cb(
     struct diskfs_bt_op *op,
@@ -641,13 +669,16 @@ diskfs_setattr_trunc_process(struct chimera_vfs_request *request)
     if (extent_start >= new_size) {
         diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
                                  p->ext_iter.device_offset,
-                                 SM_ALIGN_UP(p->ext_iter.length));
+                                 diskfs_ext_phys_len(p->ext_iter.length,
+                                                     p->ext_iter.flags));
     } else if (extent_end > new_size) {
         uint64_t old_aligned = SM_ALIGN_UP(p->ext_iter.length);
         uint64_t new_logical = new_size - extent_start;
         uint64_t new_aligned = SM_ALIGN_UP(new_logical);
 
-        if (old_aligned > new_aligned) {
+        /* A compressed head keeps its whole blob: nothing to free. */
+        if (old_aligned > new_aligned &&
+            !(p->ext_iter.flags & DISKFS_EXT_COMPRESSED)) {
             diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
                                      p->ext_iter.device_offset + new_aligned,
                                      old_aligned - new_aligned);
@@ -828,6 +859,46 @@ diskfs_setattr_acl_removed_cb(
 } /* diskfs_setattr_acl_removed_cb */
 
 
+/*
+ * A size change on an inline file resizes the inline copy (zero-filling any
+ * growth) and rewrites its record; truncating to 0 drops the record, and
+ * growing past inline_data_max promotes the file to an extent first.  The
+ * inode's size itself is set by diskfs_apply_attrs in diskfs_setattr_apply.
+ */
+static void
+diskfs_setattr_inline_resize(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p        = request->plugin_data;
+    struct diskfs_inode           *inode    = p->inode_stash[0];
+    uint64_t                       new_size = request->setattr.set_attr->va_size;
+    uint8_t                       *data;
+
+    if (new_size > p->thread->shared->inline_data_max) {
+        diskfs_inline_promote(request, diskfs_setattr_apply);
+        return;
+    }
+
+    if (new_size == 0) {
+        free(inode->inline_data);
+        inode->inline_data = NULL;
+    } else {
+        data = realloc(inode->inline_data, new_size);
+        if (unlikely(!data)) {
+            diskfs_op_fail(request, p->txn, CHIMERA_VFS_ENOMEM);
+            return;
+        }
+        inode->inline_data = data;
+        if (new_size > inode->inline_len) {
+            memset(inode->inline_data + inode->inline_len, 0,
+                   new_size - inode->inline_len);
+        }
+    }
+    inode->inline_len = (uint32_t) new_size;
+
+    diskfs_inline_store(request, 1, diskfs_setattr_apply);
+} /* diskfs_setattr_inline_resize */
+
+
 static void
 diskfs_setattr_inode_cb(
     struct diskfs_inode *inode,
@@ -837,11 +908,6 @@ diskfs_setattr_inode_cb(
     struct chimera_vfs_request    *request = private_data;
     struct diskfs_request_private *p       = request->plugin_data;
     struct diskfs_thread          *thread  = p->thread;
-    struct diskfs_bt_op           *op;
-    /* diskfs_apply_attrs() rewrites set_attr->va_set_mask (resets to ATOMIC,
-     * re-adds only the scalar bits), dropping the ACL bit -- capture the
-     * caller's original mask first. */
-    uint64_t                       orig_mask = request->setattr.set_attr->va_set_mask;
 
     if (unlikely(status != CHIMERA_VFS_OK)) {
         diskfs_op_fail(request, p->txn, status);
@@ -858,13 +924,37 @@ diskfs_setattr_inode_cb(
 
     diskfs_map_attrs(thread, &request->setattr.r_pre_attr, inode);
 
+    p->inode_stash[0] = inode;
+
+    if ((request->setattr.set_attr->va_set_mask & CHIMERA_VFS_ATTR_SIZE) &&
+        inode->inline_data &&
+        request->setattr.set_attr->va_size != inode->inline_len) {
+        diskfs_setattr_inline_resize(request);
+        return;
+    }
+
+    diskfs_setattr_apply(request);
+} /* diskfs_setattr_inode_cb */
+
+
+static void
+diskfs_setattr_apply(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p       = request->plugin_data;
+    struct diskfs_thread          *thread  = p->thread;
+    struct diskfs_inode           *inode   = p->inode_stash[0];
+    struct diskfs_bt_op           *op;
+    /* diskfs_apply_attrs() rewrites set_attr->va_set_mask (resets to ATOMIC,
+     * re-adds only the scalar bits), dropping the ACL bit -- capture the
+     * caller's original mask first. */
+    uint64_t                       orig_mask = request->setattr.set_attr->va_set_mask;
+
     /* Handle truncation: remove/trim extents past new EOF. */
     if ((request->setattr.set_attr->va_set_mask & CHIMERA_VFS_ATTR_SIZE) &&
         S_ISREG(inode->mode) &&
         request->setattr.set_attr->va_size < inode->size) {
 
-        p->inode_stash[0] = inode;
-        p->loop_off       = request->setattr.set_attr->va_size;
+        p->loop_off = request->setattr.set_attr->va_size;
 
         op = diskfs_bt_op_alloc(thread);
         if (diskfs_ext_floor_async(op, thread, inode, p->loop_off, p->rec_scratch,
@@ -877,8 +967,6 @@ diskfs_setattr_inode_cb(
 
     diskfs_apply_attrs(inode, request->setattr.set_attr);
 
-    p->inode_stash[0] = inode;
-
     /* Persist the opaque pNFS layout blob as this inode's single PNFS record,
      * replacing any previous one (the insert aborts on a duplicate key).  The
      * in-memory mirror is installed up front; the chain replays it into the
@@ -981,7 +1069,7 @@ diskfs_setattr_inode_cb(
     }
 
     diskfs_setattr_finish(request);
-} /* diskfs_setattr_inode_cb */
+} /* diskfs_setattr_apply */
 
 
 void
@@ -1090,6 +1178,35 @@ diskfs_mount_walk_acquired_cb(
 } /* diskfs_mount_walk_acquired_cb */
 
 
+/* Is `path` (leading slashes stripped) the snapshot directory or below it? */
+static inline int
+diskfs_mount_is_snapshot(
+    const char *path,
+    int         pathlen)
+{
+    int len = sizeof(".snapshot") - 1;
+
+    return pathlen >= len && memcmp(path, ".snapshot", len) == 0 &&
+           (pathlen == len || path[len] == '/');
+} /* diskfs_mount_is_snapshot */
+
+
+static inline int
+diskfs_mount_readonly(const struct chimera_vfs_request *request)
+{
+    const char *key;
+    int         i;
+
+    for (i = 0; i < request->mount.options.num_options; i++) {
+        key = request->mount.options.options[i].key;
+        if (key && (strcmp(key, "ro") == 0 || strcmp(key, "readonly") == 0)) {
+            return 1;
+        }
+    }
+    return 0;
+} /* diskfs_mount_readonly */
+
+
 void
 diskfs_mount(
     struct diskfs_thread       *thread,
@@ -1110,9 +1227,36 @@ diskfs_mount(
         diskfs_orphan_scan(thread);
     }
     p->thread     = thread;
-    p->txn        = diskfs_txn_begin(thread, DISKFS_TXN_READ);
     p->op_scratch = 0;
 
+    /* ".snapshot[/...]" resolves from the snapshot directory instead.  Its
+     * inodes share one mount id, which the VFS must treat as read-only. */
+    while (p->op_scratch < request->mount.pathlen &&
+           request->mount.path[p->op_scratch] == '/') {
+        p->op_scratch++;
+    }
+    if (diskfs_mount_is_snapshot(request->mount.path + p->op_scratch,
+                                 (int) (request->mount.pathlen - p->op_scratch))) {
+        if (!shared->snapshots) {
+            diskfs_op_fail(request, NULL, CHIMERA_VFS_ENOENT);
+            return;
+        }
+        if (!diskfs_mount_readonly(request)) {
+            chimera_diskfs_info("Snapshot mount of %.*s refused: it must be mounted \"ro\"",
+                                (int) request->mount.pathlen, request->mount.path);
+            diskfs_op_fail(request, NULL, CHIMERA_VFS_EROFS);
+            return;
+        }
+        p->op_scratch += sizeof(".snapshot") - 1;
+        p->txn         = diskfs_txn_begin(thread, DISKFS_TXN_READ);
+        diskfs_inode_get_inum_async(thread, p->txn, DISKFS_SNAP_INUM, DISKFS_SNAP_GEN,
+                                    diskfs_mount_walk_acquired_cb, request);
+        return;
+    }
+
+    p->op_scratch = 0;
+    p->txn        = diskfs_txn_begin(thread, DISKFS_TXN_READ);
+
     /* Resolve the mount path asynchronously starting from the root inode. */
     diskfs_fh_to_inum(&inum, &gen, shared->root_fh, shared->root_fhlen);
     diskfs_inode_get_inum_async(thread, p->txn, inum, gen,
@@ -1476,6 +1620,120 @@ diskfs_xattr_rec_matches(
 } /* diskfs_xattr_rec_matches */
 
 
+/*
+ * DISKFS_XATTR_EXTSIZE is virtual: get/set/remove act on inode->extsize (the
+ * dinode's extent-size hint) and never touch the b+tree.
+ */
+static inline int
+diskfs_xattr_is_extsize(
+    const char *name,
+    uint32_t    name_len)
+{
+    return name_len == sizeof(DISKFS_XATTR_EXTSIZE) - 1 &&
+           memcmp(name, DISKFS_XATTR_EXTSIZE, name_len) == 0;
+} /* diskfs_xattr_is_extsize */
+
+
+static void
+diskfs_get_xattr_extsize(
+    struct chimera_vfs_request *request,
+    struct diskfs_inode        *inode)
+{
+    struct diskfs_request_private *p = request->plugin_data;
+    char                           buf[24];
+    int                            len;
+
+    if (!inode->extsize) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_ENODATA);
+        return;
+    }
+
+    len = snprintf(buf, sizeof(buf), "%lu", inode->extsize);
+    if ((uint32_t) len > request->get_xattr.value_maxlen) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_ERANGE);
+        return;
+    }
+
+    memcpy(request->get_xattr.value, buf, len);
+    request->get_xattr.r_value_len = len;
+    diskfs_op_ok(request, p->txn);
+} /* diskfs_get_xattr_extsize */
+
+
+static void
+diskfs_set_xattr_extsize(
+    struct chimera_vfs_request *request,
+    struct diskfs_inode        *inode)
+{
+    struct diskfs_request_private *p       = request->plugin_data;
+    const char                    *value   = request->set_xattr.value;
+    uint64_t                       extsize = 0;
+    uint32_t                       i;
+    struct timespec                now;
+
+    /* Decimal bytes, block-aligned; 0 clears the hint. */
+    if (request->set_xattr.value_len == 0 || request->set_xattr.value_len > 20) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_EINVAL);
+        return;
+    }
+    for (i = 0; i < request->set_xattr.value_len; i++) {
+        if (value[i] < '0' || value[i] > '9') {
+            diskfs_op_fail(request, p->txn, CHIMERA_VFS_EINVAL);
+            return;
+        }
+        extsize = extsize * 10 + (uint64_t) (value[i] - '0');
+        if (extsize > DISKFS_EXTSIZE_MAX) {
+            diskfs_op_fail(request, p->txn, CHIMERA_VFS_EINVAL);
+            return;
+        }
+    }
+    if (extsize & (DISKFS_BLOCK_SIZE - 1)) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_EINVAL);
+        return;
+    }
+
+    if (request->set_xattr.option == CHIMERA_VFS_XATTR_CREATE && inode->extsize) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_EEXIST);
+        return;
+    }
+    if (request->set_xattr.option == CHIMERA_VFS_XATTR_REPLACE && !inode->extsize) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_ENODATA);
+        return;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    inode->extsize    = extsize;
+    inode->ctime_sec  = now.tv_sec;
+    inode->ctime_nsec = now.tv_nsec;
+
+    diskfs_map_attrs(p->thread, &request->set_xattr.r_post_attr, inode);
+    diskfs_op_ok(request, p->txn);
+} /* diskfs_set_xattr_extsize */
+
+
+static void
+diskfs_remove_xattr_extsize(
+    struct chimera_vfs_request *request,
+    struct diskfs_inode        *inode)
+{
+    struct diskfs_request_private *p = request->plugin_data;
+    struct timespec                now;
+
+    if (!inode->extsize) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_ENODATA);
+        return;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    inode->extsize    = 0;
+    inode->ctime_sec  = now.tv_sec;
+    inode->ctime_nsec = now.tv_nsec;
+
+    diskfs_map_attrs(p->thread, &request->remove_xattr.r_post_attr, inode);
+    diskfs_op_ok(request, p->txn);
+} /* diskfs_remove_xattr_extsize */
+
+
 static void
 diskfs_get_xattr_lookup_cb(
     struct diskfs_bt_op *op,
@@ -1526,6 +1784,11 @@ diskfs_get_xattr_inode_cb(
         return;
     }
 
+    if (diskfs_xattr_is_extsize(request->get_xattr.name, request->get_xattr.namelen)) {
+        diskfs_get_xattr_extsize(request, inode);
+        return;
+    }
+
     key.type   = DISKFS_REC_XATTR;
     key.subkey = chimera_vfs_hash(request->get_xattr.name,
                                   request->get_xattr.namelen);
@@ -1722,6 +1985,11 @@ diskfs_set_xattr_inode_cb(
 
     diskfs_map_attrs(p->thread, &request->set_xattr.r_pre_attr, inode);
 
+    if (diskfs_xattr_is_extsize(request->set_xattr.name, request->set_xattr.namelen)) {
+        diskfs_set_xattr_extsize(request, inode);
+        return;
+    }
+
     p->inode_stash[0] = inode;
 
     key          = diskfs_set_xattr_key(request);
@@ -1983,6 +2251,11 @@ diskfs_remove_xattr_inode_cb(
 
     diskfs_map_attrs(p->thread, &request->remove_xattr.r_pre_attr, inode);
 
+    if (diskfs_xattr_is_extsize(request->remove_xattr.name, request->remove_xattr.namelen)) {
+        diskfs_remove_xattr_extsize(request, inode);
+        return;
+    }
+
     p->inode_stash[0] = inode;
 
     p->xattr_rec = malloc(DISKFS_BT_NODE_CAP);
@@ -2176,6 +2449,7 @@ diskfs_get_layout_do_alloc(
     int                            rc;
 
     rc = diskfs_inode_alloc_space(thread, p->txn, p->inode_stash[0],
+                                  p->loop_off,
                                   (int64_t) p->rmw_aligned_length,
                                   0 /* exact, no retained tail */,
                                   &dev_id, &dev_off,
@@ -22,6 +22,23 @@ diskfs_block_recycle(
     struct diskfs_thread      *thread,
     struct diskfs_block_shard *shard);
 
+static void
+diskfs_block_ghost_add_locked(
+    struct diskfs_block_shard *shard,
+    uint32_t                   device_id,
+    uint64_t                   device_offset);
+
+static void
+diskfs_block_ghost_unlink_locked(
+    struct diskfs_block_shard *shard,
+    uint32_t                   idx);
+
+static void
+diskfs_block_admit_locked(
+    struct diskfs_thread      *thread,
+    struct diskfs_block_shard *shard,
+    struct diskfs_block       *blk);
+
 static void
 diskfs_block_drain_returned_locked(
     struct diskfs_block_shard *shard);
@@ -52,11 +69,12 @@ diskfs_bt_op_pin(
     struct diskfs_block       *blk);
 
 static struct diskfs_block *
-diskfs_block_claim_async(
+diskfs_block_pin_async(
     struct diskfs_thread *thread,
     uint32_t device_id,
     uint64_t device_offset,
     int is_new,
+    int cow,
     void ( *resume )(struct diskfs_thread *, void *),
     void *arg);
 
@@ -65,27 +83,80 @@ diskfs_pin_cont_resume(
     struct diskfs_thread *thread,
     void                 *arg);
 
+static inline void
+diskfs_block_base_drop_locked(
+    struct diskfs_block_shard *shard,
+    struct diskfs_block       *blk);
+
+static inline void
+diskfs_block_base_set_locked(
+    struct diskfs_block_shard *shard,
+    struct diskfs_block       *blk,
+    struct diskfs_block_buf   *old);
+
+
+/* Forget a block's delta base (shard lock held). */
+static inline void
+diskfs_block_base_drop_locked(
+    struct diskfs_block_shard *shard,
+    struct diskfs_block       *blk)
+{
+    if (blk->base) {
+        diskfs_block_buf_release_locked(shard, blk->base);
+        blk->base = NULL;
+    }
+} /* diskfs_block_base_drop_locked */
+
+
+/*
+ * A COW fork retired `old`, the image the intent log last took of this block:
+ * keep our reference as the delta base for the next snapshot rather than
+ * dropping it.  blk->seq is the record that logged it, which is durable -- a
+ * block only goes LOGGED once its record is.
+ */
+static inline void
+diskfs_block_base_set_locked(
+    struct diskfs_block_shard *shard,
+    struct diskfs_block       *blk,
+    struct diskfs_block_buf   *old)
+{
+    diskfs_block_base_drop_locked(shard, blk);
+    blk->base     = old;
+    blk->base_seq = __atomic_load_n(&blk->seq, __ATOMIC_ACQUIRE);
+} /* diskfs_block_base_set_locked */
+
 
 static inline void
 diskfs_block_lru_unlink(
     struct diskfs_block_shard *shard,
     struct diskfs_block       *blk)
 {
+    struct diskfs_block **head, **tail;
+
     if (!blk->on_lru) {
         return;
     }
+    if (blk->on_lru == DISKFS_BLOCK_LRU_HOT) {
+        head = &shard->hot_head;
+        tail = &shard->hot_tail;
+        shard->nhot--;
+    } else {
+        head = &shard->cold_head;
+        tail = &shard->cold_tail;
+        shard->ncold--;
+    }
     if (blk->lru_prev) {
         blk->lru_prev->lru_next = blk->lru_next;
     } else {
-        shard->lru_head = blk->lru_next;
+        *head = blk->lru_next;
     }
     if (blk->lru_next) {
         blk->lru_next->lru_prev = blk->lru_prev;
     } else {
-        shard->lru_tail = blk->lru_prev;
+        *tail = blk->lru_prev;
     }
     blk->lru_prev = blk->lru_next = NULL;
-    blk->on_lru   = 0;
+    blk->on_lru   = DISKFS_BLOCK_LRU_NONE;
 } /* diskfs_block_lru_unlink */
 
 
@@ -130,16 +201,18 @@ diskfs_block_drain_clean_locked(struct diskfs_block_shard *shard)
 
 
 /*
- * Recycle the least-recently-used CLEAN, unpinned buffer for reuse at a new
- * key.  Caller holds the shard lock.  Returns a buffer with pin_count 0,
- * unlinked from the LRU and removed from its old bucket (a no-op for a free,
- * never-keyed buffer); the caller sets the new key/state and links it into the
- * new bucket.
+ * Recycle a CLEAN, unpinned buffer for reuse at a new key: the cold head while
+ * the cold list is over its target (or nothing is hot), else the hot head.
+ * Caller holds the shard lock.  Returns a buffer with pin_count 0, unlinked
+ * from its list and removed from its old bucket (a no-op for a free,
+ * never-keyed buffer); the caller sets the new key/state, links it into the
+ * new bucket and admits it (diskfs_block_admit_locked).  A keyed cold victim
+ * leaves its key on the ghost ring.
  *
  * The pool is fixed and never grows or blocks: the cache is provisioned larger
  * than the maximum pinnable set (bounded by the intent log -- see the cache
- * sizing constants), so by the pigeonhole principle the LRU is never empty.
- * An empty LRU means every buffer in this shard is pinned -- a provisioning
+ * sizing constants), so by the pigeonhole principle the lists are never both
+ * empty.  Empty lists mean every buffer in this shard is pinned -- a provisioning
  * violation or a leaked pin (and, since the descent that called us holds pins
  * in this shard, the precise self-deadlock condition).  Abort loudly rather
  * than block and hang.
@@ -152,10 +225,16 @@ diskfs_block_recycle(
     struct diskfs_block *blk;
     struct diskfs_block *cur, *prev;
     uint32_t             ob;
+    int                  cold;
 
     diskfs_block_drain_returned_locked(shard);
     diskfs_block_drain_clean_locked(shard);
-    blk = shard->lru_head;
+
+    if (shard->cold_head && (shard->ncold > shard->cold_target || !shard->hot_head)) {
+        blk = shard->cold_head;
+    } else {
+        blk = shard->hot_head ? shard->hot_head : shard->cold_head;
+    }
 
     chimera_diskfs_abort_if(!blk,
                             "block cache shard exhausted: every buffer pinned "
@@ -163,7 +242,13 @@ diskfs_block_recycle(
                             "or a pin was leaked)");
     diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_RECYCLE);
 
+    cold = blk->on_lru == DISKFS_BLOCK_LRU_COLD;
+    if (!cold) {
+        diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_HOT_RECYCLE);
+    }
+
     diskfs_block_lru_unlink(shard, blk);
+    diskfs_block_base_drop_locked(shard, blk);
 
     /* Unhook from its current bucket (no-op for a never-keyed free buffer:
      * it is in no chain, so the pointer search simply finds nothing). */
@@ -179,11 +264,99 @@ diskfs_block_recycle(
             break;
         }
     }
+    if (cur && cold) {
+        diskfs_block_ghost_add_locked(shard, blk->device_id, blk->device_offset);
+    }
     blk->hash_next = NULL;
+    blk->hot       = 0;
+    __atomic_store_n(&blk->interior, 0, __ATOMIC_RELAXED);
     return blk;
 } /* diskfs_block_recycle */
 
 
+/* Remember a cold victim's key, overwriting the oldest ghost. */
+static void
+diskfs_block_ghost_add_locked(
+    struct diskfs_block_shard *shard,
+    uint32_t                   device_id,
+    uint64_t                   device_offset)
+{
+    struct diskfs_block_ghost *g;
+    uint32_t                   idx = shard->ghost_next, *pp;
+
+    if (shard->nghosts == 0) {
+        return;
+    }
+
+    g = &shard->ghosts[idx];
+    if (g->valid) {
+        diskfs_block_ghost_unlink_locked(shard, idx);
+    }
+
+    pp               = &shard->ghost_buckets[(diskfs_block_hash(device_id, device_offset) >> 8) &
+                                             shard->ghost_mask];
+    g->device_id     = device_id;
+    g->device_offset = device_offset;
+    g->valid         = 1;
+    g->next          = *pp;
+    *pp              = idx;
+
+    shard->ghost_next = (shard->ghost_next + 1) % shard->nghosts;
+} /* diskfs_block_ghost_add_locked */
+
+
+static void
+diskfs_block_ghost_unlink_locked(
+    struct diskfs_block_shard *shard,
+    uint32_t                   idx)
+{
+    struct diskfs_block_ghost *g = &shard->ghosts[idx];
+    uint32_t                  *pp;
+
+    pp = &shard->ghost_buckets[(diskfs_block_hash(g->device_id, g->device_offset) >> 8) &
+                               shard->ghost_mask];
+    while (*pp != idx) {
+        pp = &shard->ghosts[*pp].next;
+    }
+    *pp      = g->next;
+    g->next  = DISKFS_BLOCK_GHOST_NONE;
+    g->valid = 0;
+} /* diskfs_block_ghost_unlink_locked */
+
+
+/*
+ * Admit a block just keyed by a miss.  A key still on the ghost ring was
+ * recycled off the cold list and wanted again -- the reuse 2Q looks for -- so
+ * the block goes hot (and the ghost is consumed); anything else starts cold.
+ */
+static void
+diskfs_block_admit_locked(
+    struct diskfs_thread      *thread,
+    struct diskfs_block_shard *shard,
+    struct diskfs_block       *blk)
+{
+    uint32_t idx;
+
+    if (shard->nghosts == 0) {
+        return;
+    }
+
+    idx = shard->ghost_buckets[(diskfs_block_hash(blk->device_id, blk->device_offset) >> 8) &
+                               shard->ghost_mask];
+    while (idx != DISKFS_BLOCK_GHOST_NONE) {
+        struct diskfs_block_ghost *g = &shard->ghosts[idx];
+
+        if (g->device_offset == blk->device_offset && g->device_id == blk->device_id) {
+            diskfs_block_ghost_unlink_locked(shard, idx);
+            blk->hot = 1;
+            diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_GHOST_HIT);
+            return;
+        }
+        idx = g->next;
+    }
+} /* diskfs_block_admit_locked */
+
+
 void
 diskfs_block_unpin(
     struct diskfs_thread   *thread,
@@ -193,7 +366,7 @@ diskfs_block_unpin(
     struct diskfs_block_shard *shard = diskfs_block_shard(thread->shared->block_cache,
                                                           blk->device_id, blk->device_offset);
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_block_shard");
     diskfs_block_drain_clean_locked(shard);
     __atomic_store_n(&blk->state, new_state, __ATOMIC_RELEASE);
     if (__atomic_sub_fetch(&blk->pin_count, 1, __ATOMIC_ACQ_REL) == 0 &&
@@ -213,7 +386,7 @@ diskfs_block_release(
     struct diskfs_block_shard *shard = diskfs_block_shard(thread->shared->block_cache,
                                                           blk->device_id, blk->device_offset);
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_block_shard");
     diskfs_block_drain_clean_locked(shard);
     if (__atomic_sub_fetch(&blk->pin_count, 1, __ATOMIC_ACQ_REL) == 0 &&
         __atomic_load_n(&blk->state, __ATOMIC_ACQUIRE) == DISKFS_BLOCK_CLEAN && !blk->on_lru) {
@@ -259,6 +432,27 @@ diskfs_block_cache_create(struct diskfs_shared *shared)
                                 sizeof(struct diskfs_block *));
         shard->pool = calloc(cache->shard_cap, sizeof(struct diskfs_block));
 
+        /* 2Q sizing: the cold target and the ghost ring, with a power-of-two
+         * index over the ring. */
+        shard->cold_target = cache->shard_cap * DISKFS_BLOCK_CACHE_COLD_PCT / 100;
+        shard->nghosts     = cache->shard_cap * DISKFS_BLOCK_CACHE_GHOST_PCT / 100;
+        if (shard->nghosts) {
+            uint32_t nbuckets = 1;
+
+            while (nbuckets < shard->nghosts) {
+                nbuckets <<= 1;
+            }
+            shard->ghost_mask    = nbuckets - 1;
+            shard->ghosts        = calloc(shard->nghosts, sizeof(*shard->ghosts));
+            shard->ghost_buckets = malloc(nbuckets * sizeof(*shard->ghost_buckets));
+            for (j = 0; j < nbuckets; j++) {
+                shard->ghost_buckets[j] = DISKFS_BLOCK_GHOST_NONE;
+            }
+            for (j = 0; j < shard->nghosts; j++) {
+                shard->ghosts[j].next = DISKFS_BLOCK_GHOST_NONE;
+            }
+        }
+
         /* Pre-populate the struct pool: every block starts free (unkeyed, in
          * no bucket) and CLEAN on the LRU, with no buffer yet (iov.data NULL);
          * the iovec is allocated on first use and reused thereafter. */
@@ -347,6 +541,8 @@ diskfs_block_cache_destroy(struct diskfs_shared *shared)
         }
         free(shard->buffers);
         free(shard->pool);
+        free(shard->ghosts);
+        free(shard->ghost_buckets);
         free(shard->buckets);
         pthread_mutex_destroy(&shard->lock);
     }
@@ -421,7 +617,7 @@ diskfs_block_claim(
     struct diskfs_block_shard *shard  = &cache->shards[sidx];
     struct diskfs_block       *blk;
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_block_shard");
 
     diskfs_block_drain_returned_locked(shard);
     diskfs_block_drain_clean_locked(shard);
@@ -454,6 +650,7 @@ diskfs_block_claim(
 
         blk->hash_next         = shard->buckets[bucket];
         shard->buckets[bucket] = blk;
+        diskfs_block_admit_locked(thread, shard, blk);
     } else if (blk->on_lru) {
         diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_HIT);
         diskfs_block_lru_unlink(shard, blk);
@@ -462,20 +659,27 @@ diskfs_block_claim(
          * the tail-pusher will write it home), so it must stay immutable.  Fork
          * a private writable copy; the old buffer rides the record to its home
          * and is freed when the pusher releases it.  Done under the shard lock
-         * so it serializes against the pusher's LOGGED->CLEAN transition. */
+         * so it serializes against the pusher's LOGGED->CLEAN transition.
+         * The old buffer is also the delta base for this writer's redo. */
         struct diskfs_block_buf *old = blk->buf;
         struct diskfs_block_buf *new = diskfs_block_buf_alloc_locked(shard);
 
         memcpy(new->iov.data, old->iov.data, DISKFS_BLOCK_SIZE);
         blk->buf = new;
         blk->iov = new->iov;
-        diskfs_block_buf_release_locked(shard, old);
+        diskfs_block_base_set_locked(shard, blk, old);
         __atomic_store_n(&blk->state, DISKFS_BLOCK_CLEAN, __ATOMIC_RELEASE);
         diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_COW);
     } else {
         diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_HIT);
     }
 
+    /* A freshly allocated block's home holds whatever last used the space,
+     * not the image we would diff against: its first redo is a full image. */
+    if (is_new) {
+        diskfs_block_base_drop_locked(shard, blk);
+    }
+
     __atomic_add_fetch(&blk->pin_count, 1, __ATOMIC_ACQ_REL);
     pthread_mutex_unlock(&shard->lock);
 
@@ -504,6 +708,10 @@ diskfs_sm_claim_block(
     }
 
     diskfs_txn_add_block(c->txn, blk);
+
+    /* AG-log blocks are appended to by many transactions at once, so no one
+     * transaction's redo can describe them as a change from a known image. */
+    c->txn->blocks->journal = 1;
     return blk->iov.data;
 } /* diskfs_sm_claim_block */
 
@@ -556,6 +764,10 @@ diskfs_txn_free_space(
     f->device_offset   = device_offset;
     f->length          = length;
     f->journaled       = 0;
+    f->cleared         = 0;
+    f->refchecked      = 0;
+    f->ref_split       = 0;
+    f->ref_done        = 0;
     f->next            = txn->pending_frees;
     txn->pending_frees = f;
 } /* diskfs_txn_free_space */
@@ -595,18 +807,21 @@ diskfs_txn_flush_free_journals(
 } /* diskfs_txn_flush_free_journals */
 
 
-/* Commit a txn's pending frees -- the ranges become reusable.  Runs on the
- * intent-log thread once the redo record is durable, after the txn's blocks
- * have been unpinned (so a freed metadata block is LOGGED, not DIRTY-pinned). */
+/* Commit a txn's pending frees -- the ranges become reusable, and are queued
+ * for device discard when that is enabled.  Runs on the intent-log thread once
+ * the redo record is durable, after the txn's blocks have been unpinned (so a
+ * freed metadata block is LOGGED, not DIRTY-pinned). */
 void
 diskfs_txn_apply_frees(struct diskfs_txn *txn)
 {
-    struct space_map       *sm = txn->thread->shared->space_map;
+    struct diskfs_shared   *shared = txn->thread->shared;
+    struct space_map       *sm     = shared->space_map;
     struct diskfs_txn_free *f, *n;
 
     for (f = txn->pending_frees; f; f = n) {
         n = f->next;
         space_map_free_apply(sm, f->device_id, f->device_offset, f->length);
+        diskfs_discard_queue(shared, f->device_id, f->device_offset, f->length);
         free(f);
     }
     txn->pending_frees = NULL;
@@ -758,7 +973,7 @@ diskfs_block_load_complete(
     chimera_diskfs_abort_if(status != 0, "block read failed off=%lu status=%d",
                             blk->device_offset, status);
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_block_shard");
     __atomic_store_n(&blk->state, DISKFS_BLOCK_CLEAN, __ATOMIC_RELEASE);
     waiters        = blk->wait_head;
     blk->wait_head = NULL;
@@ -817,7 +1032,7 @@ diskfs_bt_block_get(
     struct diskfs_block_load  *ld;
     int                        issue = 0;
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_block_shard");
     blk = diskfs_block_lookup_locked(shard, bucket, device_id, device_offset);
     if (blk && blk->state != DISKFS_BLOCK_LOADING) {
         diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_HIT);
@@ -838,6 +1053,7 @@ diskfs_bt_block_get(
         blk->hash_next         = shard->buckets[bucket];
         shard->buckets[bucket] = blk;
         issue                  = 1;
+        diskfs_block_admit_locked(thread, shard, blk);
     } else {
         diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_WAIT);
     }
@@ -880,20 +1096,21 @@ diskfs_bt_block_get(
 
 
 /*
- * Async, COW-aware block claim for non-bt_op callers.  Behaves like
- * diskfs_block_claim (returns the block pinned; is_new starts from a zeroed
- * buffer; a resident LOGGED buffer is COW-forked) but never reads
- * synchronously: on a miss (or a read already in flight) it parks
+ * Async block pin for non-bt_op callers.  Behaves like diskfs_block_claim
+ * (returns the block pinned; is_new starts from a zeroed buffer; with `cow` a
+ * resident LOGGED buffer is COW-forked so the caller may write it) but never
+ * reads synchronously: on a miss (or a read already in flight) it parks
  * resume(thread, arg) on the block and returns NULL, and the read is driven on
  * the async evpl_block path.  The caller's continuation re-invokes this once
  * the block has loaded, when it returns the now-resident block inline.
  */
 static struct diskfs_block *
-diskfs_block_claim_async(
+diskfs_block_pin_async(
     struct diskfs_thread *thread,
     uint32_t device_id,
     uint64_t device_offset,
     int is_new,
+    int cow,
     void ( *resume )(struct diskfs_thread *, void *),
     void *arg)
 {
@@ -907,7 +1124,7 @@ diskfs_block_claim_async(
     struct diskfs_block_load   *ld;
     int                         issue = 0;
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_block_shard");
 
     diskfs_block_drain_returned_locked(shard);
     diskfs_block_drain_clean_locked(shard);
@@ -946,6 +1163,7 @@ diskfs_block_claim_async(
             memset(blk->iov.data, 0, DISKFS_BLOCK_SIZE);
             blk->hash_next         = shard->buckets[bucket];
             shard->buckets[bucket] = blk;
+            diskfs_block_admit_locked(thread, shard, blk);
             __atomic_add_fetch(&blk->pin_count, 1, __ATOMIC_ACQ_REL);
             pthread_mutex_unlock(&shard->lock);
             return blk;
@@ -962,10 +1180,11 @@ diskfs_block_claim_async(
         blk->wait_head         = w;
         blk->wait_tail         = w;
         issue                  = 1;
+        diskfs_block_admit_locked(thread, shard, blk);
     } else if (blk->on_lru) {
         diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_HIT);
         diskfs_block_lru_unlink(shard, blk);
-    } else if (__atomic_load_n(&blk->state, __ATOMIC_ACQUIRE) == DISKFS_BLOCK_LOGGED) {
+    } else if (cow && __atomic_load_n(&blk->state, __ATOMIC_ACQUIRE) == DISKFS_BLOCK_LOGGED) {
         /* COW (see diskfs_block_claim): fork a private writable copy. */
         struct diskfs_block_buf *old = blk->buf;
         struct diskfs_block_buf *new = diskfs_block_buf_alloc_locked(shard);
@@ -973,7 +1192,7 @@ diskfs_block_claim_async(
         memcpy(new->iov.data, old->iov.data, DISKFS_BLOCK_SIZE);
         blk->buf = new;
         blk->iov = new->iov;
-        diskfs_block_buf_release_locked(shard, old);
+        diskfs_block_base_set_locked(shard, blk, old);
         __atomic_store_n(&blk->state, DISKFS_BLOCK_CLEAN, __ATOMIC_RELEASE);
         diskfs_metric_block_cache(thread, DISKFS_METRIC_BLOCK_CACHE_COW);
     } else {
@@ -996,12 +1215,47 @@ diskfs_block_claim_async(
         return NULL;
     }
 
+    if (is_new) {
+        diskfs_block_base_drop_locked(shard, blk);
+    }
+
     __atomic_add_fetch(&blk->pin_count, 1, __ATOMIC_ACQ_REL);
     pthread_mutex_unlock(&shard->lock);
     return blk;
+} /* diskfs_block_pin_async */
+
+
+/* Async claim of a block the caller is about to modify (see
+ * diskfs_block_pin_async). */
+struct diskfs_block *
+diskfs_block_claim_async(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    int is_new,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg)
+{
+    return diskfs_block_pin_async(thread, device_id, device_offset, is_new, 1,
+                                  resume, arg);
 } /* diskfs_block_claim_async */
 
 
+/* Async read-only pin: a LOGGED block is shared as it is, not forked.  Drop
+ * it with diskfs_block_release. */
+struct diskfs_block *
+diskfs_block_get_async(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg)
+{
+    return diskfs_block_pin_async(thread, device_id, device_offset, 0, 0,
+                                  resume, arg);
+} /* diskfs_block_get_async */
+
+
 void
 diskfs_inode_finish_write_pin(
     struct diskfs_thread *thread,
@@ -1153,6 +1407,8 @@ diskfs_inode_flush(struct diskfs_inode *inode)
     di->ctime_nsec     = inode->ctime_nsec;
     di->btime_nsec     = inode->btime_nsec;
     di->dos_attributes = inode->dos_attributes;
+    di->extsize        = inode->extsize;
+    di->flags          = inode->flags;
     if (S_ISDIR(inode->mode)) {
         di->parent_inum = inode->parent_inum;
         di->parent_gen  = inode->parent_gen;
@@ -1208,6 +1464,7 @@ diskfs_txn_unpin_blocks(
 
         n = tb->next;
         diskfs_block_unpin(thread, blk, new_state);
+        free(tb->delta);    /* normally consumed by diskfs_il_write_redo */
         free(tb);
         tb = n;
     }
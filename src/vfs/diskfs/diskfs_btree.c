@@ -41,6 +41,31 @@ diskfs_bt_leaf_append(
     const void                 *rec,
     uint32_t                    reclen);
 
+static uint32_t
+diskfs_bt_leaf_format(
+    const struct diskfs_bt_key *keys,
+    int                         n,
+    int                         compact,
+    uint64_t                   *r_prefix);
+
+static uint32_t
+diskfs_bt_leaf_need(
+    const struct diskfs_bt_key *keys,
+    int                         n,
+    uint32_t                    recbytes,
+    int                         compact);
+
+static void
+diskfs_bt_leaf_fill(
+    void                       *buf,
+    uint32_t                    base,
+    uint32_t                    cap,
+    const struct diskfs_bt_key *keys,
+    const uint32_t             *lens,
+    const char                 *scratch,
+    int                         n,
+    int                         compact);
+
 static struct diskfs_block *
 diskfs_bt_alloc_node(
     struct diskfs_thread *thread,
@@ -48,7 +73,7 @@ diskfs_bt_alloc_node(
     uint16_t              level,
     uint64_t             *r_bptr);
 
-static void
+static int
 diskfs_bt_leaf_split(
     struct diskfs_thread       *thread,
     struct diskfs_txn          *txn,
@@ -56,6 +81,7 @@ diskfs_bt_leaf_split(
     uint32_t                    base,
     uint32_t                    cap,
     uint64_t                    self_bptr,
+    int                         right_edge,
     int                         insert_idx,
     const struct diskfs_bt_key *nkey,
     const void                 *nrec,
@@ -71,6 +97,7 @@ diskfs_bt_leaf_insert(
     uint32_t                    base,
     uint32_t                    cap,
     uint64_t                    self_bptr,
+    int                         right_edge,
     const struct diskfs_bt_key *key,
     const void                 *rec,
     uint32_t                    reclen,
@@ -84,6 +111,7 @@ diskfs_bt_interior_insert(
     void                       *buf,
     uint32_t                    base,
     uint32_t                    cap,
+    int                         right_edge,
     const struct diskfs_bt_key *key,
     uint64_t                    child,
     struct diskfs_bt_key       *sep_key,
@@ -97,6 +125,7 @@ diskfs_bt_insert_rec(
     uint32_t                    base,
     uint32_t                    cap,
     uint64_t                    self_bptr,
+    int                         right_edge,
     const struct diskfs_bt_key *key,
     const void                 *rec,
     uint32_t                    reclen,
@@ -132,6 +161,17 @@ diskfs_bt_op_emit(
     int                  idx);
 
 
+const char *diskfs_bt_counter_names[DISKFS_METRIC_BTREE_NUM] = {
+    "descents",
+    "levels",
+    "fanout",
+    "leaf_items",
+    "splits",
+    "append_splits",
+    "reencoded",
+};
+
+
 /* ------------------------------------------------------------------ */
 /* Per-inode b+tree                                                    */
 /* ------------------------------------------------------------------ */
@@ -158,7 +198,8 @@ diskfs_bt_leaf_free(
     uint32_t base)
 {
     struct diskfs_bt_node_hdr *h          = diskfs_bt_hdr(buf, base);
-    uint32_t                   free_start = sizeof(*h) + h->nitems * sizeof(struct diskfs_bt_lslot);
+    uint32_t                   free_start = diskfs_bt_leaf_slots_start(h) +
+        h->nitems * diskfs_bt_leaf_stride(h);
 
     return h->free_end - free_start;
 } /* diskfs_bt_leaf_free */
@@ -187,14 +228,14 @@ diskfs_bt_leaf_search(
     const struct diskfs_bt_key *key,
     int                        *exact)
 {
-    struct diskfs_bt_lslot *sl = diskfs_bt_lslots(buf, base);
-    int                     n  = diskfs_bt_hdr(buf, base)->nitems;
-    int                     lo = 0, hi = n;
+    int n  = diskfs_bt_hdr(buf, base)->nitems;
+    int lo = 0, hi = n;
 
     *exact = 0;
     while (lo < hi) {
-        int mid = (lo + hi) >> 1;
-        int c   = diskfs_bt_key_cmp(&sl[mid].key, key);
+        int                  mid = (lo + hi) >> 1;
+        struct diskfs_bt_key mk  = diskfs_bt_leaf_key(buf, base, mid);
+        int                  c   = diskfs_bt_key_cmp(&mk, key);
 
         if (c < 0) {
             lo = mid + 1;
@@ -275,21 +316,18 @@ diskfs_bt_lookup_pump(
         }
 
         {
-            int                     exact = 0;
-            int                     idx   = h->nitems ? diskfs_bt_leaf_search(buf, base, key,
-                                                                              &exact) : 0;
-            struct diskfs_bt_lslot *sl = diskfs_bt_lslots(buf, base);
-            uint32_t                len;
+            int      exact = 0;
+            int      idx   = h->nitems ? diskfs_bt_leaf_search(buf, base, key,
+                                                               &exact) : 0;
+            uint32_t reclen, len;
 
             if (!exact) {
                 return -1;
             }
-            len = sl[idx].len;
-            if (len > cap) {
-                len = cap;
-            }
-            memcpy(out, (char *) buf + base + sl[idx].off, len);
-            return (int) sl[idx].len;
+            reclen = diskfs_bt_leaf_rec_len(buf, base, idx);
+            len    = reclen < cap ? reclen : cap;
+            memcpy(out, diskfs_bt_leaf_rec(buf, base, idx), len);
+            return (int) reclen;
         }
     }
 } /* diskfs_bt_lookup_pump */
@@ -303,12 +341,13 @@ diskfs_bt_node_min_key(
     struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
 
     chimera_diskfs_abort_if(h->nitems == 0, "b+tree empty node has no minimum key");
-    return h->level == 0 ? diskfs_bt_lslots(buf, base)[0].key :
+    return h->level == 0 ? diskfs_bt_leaf_key(buf, base, 0) :
            diskfs_bt_islots(buf, base)[0].key;
 } /* diskfs_bt_node_min_key */
 
 
-/* Append a leaf record at the end (caller guarantees sorted order + room). */
+/* Append a leaf record at the end (caller guarantees sorted order, room,
+ * and a key that fits the leaf's slot format). */
 static void
 diskfs_bt_leaf_append(
     void                       *buf,
@@ -317,18 +356,102 @@ diskfs_bt_leaf_append(
     const void                 *rec,
     uint32_t                    reclen)
 {
-    struct diskfs_bt_node_hdr *h  = diskfs_bt_hdr(buf, base);
-    struct diskfs_bt_lslot    *sl = diskfs_bt_lslots(buf, base);
+    struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
 
     h->free_end -= reclen;
     memcpy((char *) buf + base + h->free_end, rec, reclen);
-    sl[h->nitems].key = *key;
-    sl[h->nitems].off = h->free_end;
-    sl[h->nitems].len = reclen;
+    diskfs_bt_leaf_set_slot(buf, base, h->nitems, key, h->free_end, reclen);
     h->nitems++;
 } /* diskfs_bt_leaf_append */
 
 
+/*
+ * Slot format for a leaf holding the sorted keys[0..n): compact when the
+ * filesystem allows it and they share a type, with just enough subkey bytes
+ * per slot to cover where the first and last keys differ (every key between
+ * them shares the rest).  Returns the key_format (0 = wide) and sets
+ * *r_prefix to the shared high bytes.
+ */
+static uint32_t
+diskfs_bt_leaf_format(
+    const struct diskfs_bt_key *keys,
+    int                         n,
+    int                         compact,
+    uint64_t                   *r_prefix)
+{
+    uint64_t diff;
+    uint32_t w = 1;
+
+    *r_prefix = 0;
+    if (!compact || n == 0 || keys[0].type != keys[n - 1].type) {
+        return 0;
+    }
+
+    diff = keys[0].subkey ^ keys[n - 1].subkey;
+    while (w < sizeof(uint64_t) && (diff >> (8 * w)) != 0) {
+        w++;
+    }
+    if (w < sizeof(uint64_t)) {
+        *r_prefix = keys[0].subkey & ~((UINT64_C(1) << (8 * w)) - 1);
+    }
+    return DISKFS_BT_KFMT(keys[0].type, w);
+} /* diskfs_bt_leaf_format */
+
+
+/* Node bytes a leaf of keys[0..n) and recbytes of records occupies. */
+static uint32_t
+diskfs_bt_leaf_need(
+    const struct diskfs_bt_key *keys,
+    int                         n,
+    uint32_t                    recbytes,
+    int                         compact)
+{
+    uint64_t prefix;
+    uint32_t fmt = diskfs_bt_leaf_format(keys, n, compact, &prefix);
+
+    if (!fmt) {
+        return sizeof(struct diskfs_bt_node_hdr) +
+               n * sizeof(struct diskfs_bt_lslot) + recbytes;
+    }
+    return sizeof(struct diskfs_bt_node_hdr) + sizeof(uint64_t) +
+           n * (DISKFS_BT_KFMT_WIDTH(fmt) + 2 * sizeof(uint16_t)) + recbytes;
+} /* diskfs_bt_leaf_need */
+
+
+/*
+ * Rebuild a leaf from keys[0..n) / lens with the records packed back to back
+ * in scratch, in the narrowest slot format.  Like node_init this clears the
+ * leaf-chain links; callers restore them.
+ */
+static void
+diskfs_bt_leaf_fill(
+    void                       *buf,
+    uint32_t                    base,
+    uint32_t                    cap,
+    const struct diskfs_bt_key *keys,
+    const uint32_t             *lens,
+    const char                 *scratch,
+    int                         n,
+    int                         compact)
+{
+    struct diskfs_bt_node_hdr *h;
+    uint64_t                   prefix;
+    uint32_t                   o = 0;
+    int                        i;
+
+    diskfs_bt_node_init(buf, base, cap, 0);
+    h             = diskfs_bt_hdr(buf, base);
+    h->key_format = diskfs_bt_leaf_format(keys, n, compact, &prefix);
+    if (h->key_format) {
+        memcpy((char *) buf + base + sizeof(*h), &prefix, sizeof(prefix));
+    }
+    for (i = 0; i < n; i++) {
+        diskfs_bt_leaf_append(buf, base, &keys[i], scratch + o, lens[i]);
+        o += lens[i];
+    }
+} /* diskfs_bt_leaf_fill */
+
+
 /* Allocate a fresh b+tree node block; returns the (pinned, txn-attached)
  * block and its bptr.  Buffer is zeroed and initialized as an empty node. */
 static struct diskfs_block *
@@ -350,7 +473,7 @@ diskfs_bt_alloc_node(
     DISKFS_SM_JNL(jnl, thread, txn, diskfs_sm_no_suspend, NULL);
     rc = space_map_alloc(shared->space_map, &thread->space_cache, &jnl,
                          SM_DEV_LOCAL, DISKFS_BLOCK_SIZE, SM_RESERVATION_MIN,
-                         &device_id, &device_offset);
+                         SM_DEVICE_ANY, &device_id, &device_offset);
     chimera_diskfs_abort_if(rc != 0, "b+tree node allocation failed (ENOSPC)");
 
     blk = diskfs_block_claim(thread, device_id, device_offset, 1);
@@ -382,11 +505,17 @@ diskfs_bt_node_for_write(
 
 
 /*
- * Split a full leaf (current node at buf/base/cap) while inserting
- * (nkey,nrec).  The lower half stays in place; the upper half plus the new
- * right sibling's bptr are returned via *sep_key / *sep_bptr.
+ * Make room in a full leaf (current node at buf/base/cap) for (nkey,nrec).
+ * When re-encoding the leaf -- repacking its heap in the narrowest slot
+ * format for the combined keys -- fits everything, that is done in place and
+ * 0 returned.  Otherwise it splits: the lower half stays in place, the upper
+ * half plus the new right sibling's bptr are returned via *sep_key /
+ * *sep_bptr, and 1 is returned.  An append at the right edge of the tree (a
+ * file written sequentially, any run of ascending keys) keeps every existing
+ * record in place and starts the sibling with just the new one, so such bulk
+ * loads leave full leaves behind rather than half-empty ones.
  */
-static void
+static int
 diskfs_bt_leaf_split(
     struct diskfs_thread       *thread,
     struct diskfs_txn          *txn,
@@ -394,6 +523,7 @@ diskfs_bt_leaf_split(
     uint32_t                    base,
     uint32_t                    cap,
     uint64_t                    self_bptr,
+    int                         right_edge,
     int                         insert_idx,
     const struct diskfs_bt_key *nkey,
     const void                 *nrec,
@@ -401,76 +531,88 @@ diskfs_bt_leaf_split(
     struct diskfs_bt_key       *sep_key,
     uint64_t                   *sep_bptr)
 {
-    struct diskfs_bt_node_hdr *h     = diskfs_bt_hdr(buf, base);
-    struct diskfs_bt_lslot    *sl    = diskfs_bt_lslots(buf, base);
-    int                        n     = h->nitems;
-    int                        total = n + 1;
-
-    struct {
-        struct diskfs_bt_key key;
-        uint32_t             len;
-        uint32_t             scratch_off;
-    } *items;
+    struct diskfs_bt_node_hdr *h       = diskfs_bt_hdr(buf, base);
+    int                        n       = h->nitems;
+    int                        total   = n + 1;
+    int                        compact = thread->shared->bt_compact;
+    struct diskfs_bt_key      *keys;
+    uint32_t                  *lens;
     char                      *scratch;
-    uint32_t                   sp = 0, total_bytes = 0, half, acc = 0;
+    uint32_t                   sp = 0, half, acc = 0, loff = 0;
     int                        i, oi, split_i;
     struct diskfs_block       *right;
     void                      *rbuf;
     uint64_t                   old_next, old_prev;
 
-    items   = malloc(total * sizeof(*items));
+    keys    = malloc(total * sizeof(*keys));
+    lens    = malloc(total * sizeof(*lens));
     scratch = malloc(cap + nreclen);
 
     for (i = 0, oi = 0; i < total; i++) {
         if (i == insert_idx) {
             memcpy(scratch + sp, nrec, nreclen);
-            items[i].key = *nkey;
-            items[i].len = nreclen;
+            keys[i] = *nkey;
+            lens[i] = nreclen;
         } else {
-            memcpy(scratch + sp, (char *) buf + base + sl[oi].off, sl[oi].len);
-            items[i].key = sl[oi].key;
-            items[i].len = sl[oi].len;
+            keys[i] = diskfs_bt_leaf_key(buf, base, oi);
+            lens[i] = diskfs_bt_leaf_rec_len(buf, base, oi);
+            memcpy(scratch + sp, diskfs_bt_leaf_rec(buf, base, oi), lens[i]);
             oi++;
         }
-        items[i].scratch_off = sp;
-        sp                  += items[i].len;
-        total_bytes         += items[i].len;
+        sp += lens[i];
     }
 
-    half    = total_bytes / 2;
-    split_i = 1;
-    for (i = 0; i < total; i++) {
-        if (acc >= half && i > 0) {
-            split_i = i;
-            break;
-        }
-        acc    += items[i].len;
-        split_i = i + 1;
+    old_next = h->next_leaf;
+    old_prev = h->prev_leaf;
+
+    if (diskfs_bt_leaf_need(keys, total, sp, compact) <= cap) {
+        /* The key only fell outside the leaf's slot format (or the heap
+         * had dead space): re-encode in place, no split. */
+        diskfs_bt_leaf_fill(buf, base, cap, keys, lens, scratch, total, compact);
+        h->next_leaf = old_next;
+        h->prev_leaf = old_prev;
+        diskfs_metric_btree(thread, DISKFS_METRIC_BTREE_REENCODED, 1);
+
+        free(keys);
+        free(lens);
+        free(scratch);
+        return 0;
     }
-    if (split_i < 1) {
+
+    if (right_edge && insert_idx == n && n > 0) {
+        split_i = n;
+        diskfs_metric_btree(thread, DISKFS_METRIC_BTREE_APPEND_SPLITS, 1);
+    } else {
+        half    = sp / 2;
         split_i = 1;
+        for (i = 0; i < total; i++) {
+            if (acc >= half && i > 0) {
+                split_i = i;
+                break;
+            }
+            acc    += lens[i];
+            split_i = i + 1;
+        }
+        if (split_i < 1) {
+            split_i = 1;
+        }
+        if (split_i > total - 1) {
+            split_i = total - 1;
+        }
     }
-    if (split_i > total - 1) {
-        split_i = total - 1;
-    }
-
-    old_next = h->next_leaf;
-    old_prev = h->prev_leaf;
+    diskfs_metric_btree(thread, DISKFS_METRIC_BTREE_SPLITS, 1);
 
     right = diskfs_bt_alloc_node(thread, txn, 0, sep_bptr);
     rbuf  = right->iov.data;
 
-    /* Rebuild the left node in place from scratch (no aliasing).  node_init
+    /* Rebuild the left node in place from scratch (no aliasing).  leaf_fill
      * clears the leaf links, so they are restored explicitly below. */
-    diskfs_bt_node_init(buf, base, cap, 0);
     for (i = 0; i < split_i; i++) {
-        diskfs_bt_leaf_append(buf, base, &items[i].key,
-                              scratch + items[i].scratch_off, items[i].len);
-    }
-    for (i = split_i; i < total; i++) {
-        diskfs_bt_leaf_append(rbuf, 0, &items[i].key,
-                              scratch + items[i].scratch_off, items[i].len);
+        loff += lens[i];
     }
+    diskfs_bt_leaf_fill(buf, base, cap, keys, lens, scratch, split_i, compact);
+    diskfs_bt_leaf_fill(rbuf, 0, DISKFS_BT_NODE_CAP, keys + split_i, lens + split_i,
+                        scratch + loff, total - split_i, compact);
 
     /* Splice the new right sibling into the doubly-linked leaf chain:
      *   self <-> right <-> old_next
@@ -486,14 +628,16 @@ diskfs_bt_leaf_split(
         diskfs_bt_hdr(nbuf, 0)->prev_leaf = *sep_bptr;
     }
 
-    *sep_key = items[split_i].key;
+    *sep_key = keys[split_i];
 
     chimera_diskfs_abort_if(diskfs_bt_leaf_free(buf, base) > cap ||
                             diskfs_bt_leaf_free(rbuf, 0) > DISKFS_BT_NODE_CAP,
                             "b+tree leaf split overflow");
 
-    free(items);
+    free(keys);
+    free(lens);
     free(scratch);
+    return 1;
 } /* diskfs_bt_leaf_split */
 
 
@@ -506,36 +650,35 @@ diskfs_bt_leaf_insert(
     uint32_t                    base,
     uint32_t                    cap,
     uint64_t                    self_bptr,
+    int                         right_edge,
     const struct diskfs_bt_key *key,
     const void                 *rec,
     uint32_t                    reclen,
     struct diskfs_bt_key       *sep_key,
     uint64_t                   *sep_bptr)
 {
-    struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
-    struct diskfs_bt_lslot    *sl;
-    int                        idx, exact, j;
+    struct diskfs_bt_node_hdr *h      = diskfs_bt_hdr(buf, base);
+    uint32_t                   stride = diskfs_bt_leaf_stride(h);
+    uint8_t                   *s;
+    int                        idx, exact;
 
     idx = diskfs_bt_leaf_search(buf, base, key, &exact);
     chimera_diskfs_abort_if(exact, "b+tree duplicate key insert");
 
-    if (diskfs_bt_leaf_free(buf, base) >= sizeof(struct diskfs_bt_lslot) + reclen) {
-        sl = diskfs_bt_lslots(buf, base);
-        for (j = h->nitems; j > idx; j--) {
-            sl[j] = sl[j - 1];
-        }
+    if (diskfs_bt_leaf_key_fits(buf, base, key) &&
+        diskfs_bt_leaf_free(buf, base) >= stride + reclen) {
+        s = diskfs_bt_leaf_slot(buf, base, idx);
+        memmove(s + stride, s, (h->nitems - idx) * stride);
         h->free_end -= reclen;
         memcpy((char *) buf + base + h->free_end, rec, reclen);
-        sl[idx].key = *key;
-        sl[idx].off = h->free_end;
-        sl[idx].len = reclen;
+        diskfs_bt_leaf_set_slot(buf, base, idx, key, h->free_end, reclen);
         h->nitems++;
         return 0;
     }
 
-    diskfs_bt_leaf_split(thread, txn, buf, base, cap, self_bptr, idx, key, rec,
-                         reclen, sep_key, sep_bptr);
-    return 1;
+    return diskfs_bt_leaf_split(thread, txn, buf, base, cap, self_bptr,
+                                right_edge, idx, key, rec, reclen, sep_key,
+                                sep_bptr);
 } /* diskfs_bt_leaf_insert */
 
 
@@ -547,6 +690,7 @@ diskfs_bt_interior_insert(
     void                       *buf,
     uint32_t                    base,
     uint32_t                    cap,
+    int                         right_edge,
     const struct diskfs_bt_key *key,
     uint64_t                    child,
     struct diskfs_bt_key       *sep_key,
@@ -592,7 +736,8 @@ diskfs_bt_interior_insert(
             all[p].key = *key; all[p].child = child; p++;
         }
 
-        split_i = total / 2;
+        /* A right-edge append keeps this node full, as for leaves. */
+        split_i = (right_edge && idx == n) ? n : total / 2;
 
         right = diskfs_bt_alloc_node(thread, txn, h->level, sep_bptr);
         rsl   = diskfs_bt_islots(right->iov.data, 0);
@@ -621,6 +766,7 @@ diskfs_bt_insert_rec(
     uint32_t                    base,
     uint32_t                    cap,
     uint64_t                    self_bptr,
+    int                         right_edge,
     const struct diskfs_bt_key *key,
     const void                 *rec,
     uint32_t                    reclen,
@@ -636,8 +782,9 @@ diskfs_bt_insert_rec(
     uint64_t                   cbptr;
 
     if (h->level == 0) {
-        return diskfs_bt_leaf_insert(thread, txn, buf, base, cap, self_bptr, key,
-                                     rec, reclen, sep_key, sep_bptr);
+        return diskfs_bt_leaf_insert(thread, txn, buf, base, cap, self_bptr,
+                                     right_edge, key, rec, reclen, sep_key,
+                                     sep_bptr);
     }
 
     ci         = diskfs_bt_interior_search(buf, base, key);
@@ -646,14 +793,15 @@ diskfs_bt_insert_rec(
     child_buf  = diskfs_bt_node_for_write(thread, txn, child_bptr);
 
     csplit = diskfs_bt_insert_rec(thread, txn, child_buf, 0, DISKFS_BT_NODE_CAP,
-                                  child_bptr, key, rec, reclen, &csep, &cbptr);
+                                  child_bptr, right_edge && ci == h->nitems - 1,
+                                  key, rec, reclen, &csep, &cbptr);
     sl[ci].key = diskfs_bt_node_min_key(child_buf, 0);
     if (!csplit) {
         return 0;
     }
 
-    return diskfs_bt_interior_insert(thread, txn, buf, base, cap, &csep, cbptr,
-                                     sep_key, sep_bptr);
+    return diskfs_bt_interior_insert(thread, txn, buf, base, cap, right_edge,
+                                     &csep, cbptr, sep_key, sep_bptr);
 } /* diskfs_bt_insert_rec */
 
 
@@ -677,8 +825,8 @@ diskfs_bt_insert_locked(
     int                  split;
 
     split = diskfs_bt_insert_rec(thread, txn, root, DISKFS_BT_ROOT_BASE,
-                                 DISKFS_BT_ROOT_CAP, inode->inum, key, rec, reclen,
-                                 &sep, &sep_bptr);
+                                 DISKFS_BT_ROOT_CAP, inode->inum, 1, key, rec,
+                                 reclen, &sep, &sep_bptr);
     if (!split) {
         return;
     }
@@ -702,7 +850,7 @@ diskfs_bt_insert_locked(
         diskfs_bt_hdr(left->iov.data, 0)->capacity = DISKFS_BT_NODE_CAP;
 
         if (old_level == 0) {
-            left_min = diskfs_bt_lslots(left->iov.data, 0)[0].key;
+            left_min = diskfs_bt_leaf_key(left->iov.data, 0, 0);
         } else {
             left_min = diskfs_bt_islots(left->iov.data, 0)[0].key;
         }
@@ -729,35 +877,32 @@ diskfs_bt_insert_locked(
 
 
 /* Repack a leaf's live records into a fresh heap, reclaiming the dead space
- * left by prior slot removals.  Leaf-chain links are preserved. */
+ * left by prior slot removals (and narrowing its slot format to the keys
+ * that remain).  Leaf-chain links are preserved. */
 void
 diskfs_bt_leaf_compact(
-    void    *buf,
-    uint32_t base,
-    uint32_t cap)
+    struct diskfs_thread *thread,
+    void                 *buf,
+    uint32_t              base,
+    uint32_t              cap)
 {
-    struct diskfs_bt_node_hdr *h  = diskfs_bt_hdr(buf, base);
-    struct diskfs_bt_lslot    *sl = diskfs_bt_lslots(buf, base);
-    int                        n    = h->nitems, i;
-    uint64_t                   next = h->next_leaf, prev = h->prev_leaf;
+    struct diskfs_bt_node_hdr *h       = diskfs_bt_hdr(buf, base);
+    int                        n       = h->nitems, i;
+    uint64_t                   next    = h->next_leaf, prev = h->prev_leaf;
     struct diskfs_bt_key      *keys    = malloc(n * sizeof(*keys) + 1);
     uint32_t                  *lens    = malloc(n * sizeof(uint32_t) + 1);
     char                      *scratch = malloc(cap);
     uint32_t                   o       = 0;
 
     for (i = 0; i < n; i++) {
-        keys[i] = sl[i].key;
-        lens[i] = sl[i].len;
-        memcpy(scratch + o, (char *) buf + base + sl[i].off, sl[i].len);
-        o += sl[i].len;
-    }
-
-    diskfs_bt_node_init(buf, base, cap, 0);
-    o = 0;
-    for (i = 0; i < n; i++) {
-        diskfs_bt_leaf_append(buf, base, &keys[i], scratch + o, lens[i]);
+        keys[i] = diskfs_bt_leaf_key(buf, base, i);
+        lens[i] = diskfs_bt_leaf_rec_len(buf, base, i);
+        memcpy(scratch + o, diskfs_bt_leaf_rec(buf, base, i), lens[i]);
         o += lens[i];
     }
+
+    diskfs_bt_leaf_fill(buf, base, cap, keys, lens, scratch, n,
+                        thread->shared->bt_compact);
     h            = diskfs_bt_hdr(buf, base);
     h->next_leaf = next;
     h->prev_leaf = prev;
@@ -783,8 +928,9 @@ diskfs_bt_rebalance_leaf(
     uint32_t              pbase,
     int                   ci)
 {
-    struct diskfs_bt_islot    *psl = diskfs_bt_islots(pbuf, pbase);
-    int                        pn  = diskfs_bt_hdr(pbuf, pbase)->nitems;
+    struct diskfs_bt_islot    *psl     = diskfs_bt_islots(pbuf, pbase);
+    int                        pn      = diskfs_bt_hdr(pbuf, pbase)->nitems;
+    int                        compact = thread->shared->bt_compact;
     int                        lidx, ridx, ln, rn, total, i, merged;
     uint64_t                   l_bptr, r_bptr, l_prev, r_next;
     void                      *lbuf, *rbuf;
@@ -824,32 +970,24 @@ diskfs_bt_rebalance_leaf(
 
     o = 0;
     for (i = 0; i < ln; i++) {
-        struct diskfs_bt_lslot *s = diskfs_bt_lslots(lbuf, 0);
-        keys[i] = s[i].key;
-        lens[i] = s[i].len;
-        memcpy(scratch + o, (char *) lbuf + s[i].off, s[i].len);
-        o += s[i].len;
+        keys[i] = diskfs_bt_leaf_key(lbuf, 0, i);
+        lens[i] = diskfs_bt_leaf_rec_len(lbuf, 0, i);
+        memcpy(scratch + o, diskfs_bt_leaf_rec(lbuf, 0, i), lens[i]);
+        o += lens[i];
     }
     for (i = 0; i < rn; i++) {
-        struct diskfs_bt_lslot *s = diskfs_bt_lslots(rbuf, 0);
-        keys[ln + i] = s[i].key;
-        lens[ln + i] = s[i].len;
-        memcpy(scratch + o, (char *) rbuf + s[i].off, s[i].len);
-        o += s[i].len;
+        keys[ln + i] = diskfs_bt_leaf_key(rbuf, 0, i);
+        lens[ln + i] = diskfs_bt_leaf_rec_len(rbuf, 0, i);
+        memcpy(scratch + o, diskfs_bt_leaf_rec(rbuf, 0, i), lens[ln + i]);
+        o += lens[ln + i];
     }
 
-    need = sizeof(struct diskfs_bt_node_hdr) +
-        total * sizeof(struct diskfs_bt_lslot) + o;
+    need = diskfs_bt_leaf_need(keys, total, o, compact);
 
     if (need <= DISKFS_BT_NODE_CAP) {
         /* Merge everything into L; orphan R and unlink it from the chain. */
-        uint32_t off = 0;
-
-        diskfs_bt_node_init(lbuf, 0, DISKFS_BT_NODE_CAP, 0);
-        for (i = 0; i < total; i++) {
-            diskfs_bt_leaf_append(lbuf, 0, &keys[i], scratch + off, lens[i]);
-            off += lens[i];
-        }
+        diskfs_bt_leaf_fill(lbuf, 0, DISKFS_BT_NODE_CAP, keys, lens, scratch,
+                            total, compact);
         lh            = diskfs_bt_hdr(lbuf, 0);
         lh->prev_leaf = l_prev;
         lh->next_leaf = r_next;
@@ -863,7 +1001,7 @@ diskfs_bt_rebalance_leaf(
         }
         diskfs_bt_hdr(pbuf, pbase)->nitems = pn - 1;
         if (total > 0) {
-            psl[lidx].key = diskfs_bt_lslots(lbuf, 0)[0].key;
+            psl[lidx].key = diskfs_bt_leaf_key(lbuf, 0, 0);
         }
         merged = 1;
 
@@ -878,7 +1016,7 @@ diskfs_bt_rebalance_leaf(
         }
     } else {
         /* Redistribute evenly across L and R. */
-        uint32_t half = o / 2, acc = 0, off = 0;
+        uint32_t half = o / 2, acc = 0;
         int      split = 1;
 
         for (i = 0; i < total; i++) {
@@ -896,16 +1034,13 @@ diskfs_bt_rebalance_leaf(
             split = total - 1;
         }
 
-        diskfs_bt_node_init(lbuf, 0, DISKFS_BT_NODE_CAP, 0);
-        for (i = 0; i < split; i++) {
-            diskfs_bt_leaf_append(lbuf, 0, &keys[i], scratch + off, lens[i]);
-            off += lens[i];
-        }
-        diskfs_bt_node_init(rbuf, 0, DISKFS_BT_NODE_CAP, 0);
-        for (i = split; i < total; i++) {
-            diskfs_bt_leaf_append(rbuf, 0, &keys[i], scratch + off, lens[i]);
-            off += lens[i];
+        for (i = 0, acc = 0; i < split; i++) {
+            acc += lens[i];
         }
+        diskfs_bt_leaf_fill(lbuf, 0, DISKFS_BT_NODE_CAP, keys, lens, scratch,
+                            split, compact);
+        diskfs_bt_leaf_fill(rbuf, 0, DISKFS_BT_NODE_CAP, keys + split, lens + split,
+                            scratch + acc, total - split, compact);
 
         lh            = diskfs_bt_hdr(lbuf, 0);
         rh            = diskfs_bt_hdr(rbuf, 0);
@@ -914,8 +1049,8 @@ diskfs_bt_rebalance_leaf(
         rh->prev_leaf = l_bptr;
         rh->next_leaf = r_next;
 
-        psl[lidx].key = diskfs_bt_lslots(lbuf, 0)[0].key;
-        psl[ridx].key = diskfs_bt_lslots(rbuf, 0)[0].key;
+        psl[lidx].key = diskfs_bt_leaf_key(lbuf, 0, 0);
+        psl[ridx].key = diskfs_bt_leaf_key(rbuf, 0, 0);
         merged        = 0;
     }
 
@@ -1050,8 +1185,7 @@ diskfs_bt_collapse_root(
         n     = ch->nitems;
 
         if (ch->level == 0) {
-            need = sizeof(struct diskfs_bt_node_hdr) +
-                n * sizeof(struct diskfs_bt_lslot) +
+            need = diskfs_bt_leaf_slots_start(ch) + n * diskfs_bt_leaf_stride(ch) +
                 (DISKFS_BT_NODE_CAP - ch->free_end);
         } else {
             need = sizeof(struct diskfs_bt_node_hdr) +
@@ -1063,25 +1197,20 @@ diskfs_bt_collapse_root(
         }
 
         if (ch->level == 0) {
-            struct diskfs_bt_lslot *cs = diskfs_bt_lslots(cbuf, 0);
-            uint64_t                cnext = ch->next_leaf, cprev = ch->prev_leaf;
-            struct diskfs_bt_key   *keys    = malloc((n + 1) * sizeof(*keys));
-            uint32_t               *lens    = malloc((n + 1) * sizeof(uint32_t));
-            char                   *scratch = malloc(DISKFS_BT_NODE_CAP);
-            uint32_t                o       = 0;
+            uint64_t              cnext   = ch->next_leaf, cprev = ch->prev_leaf;
+            struct diskfs_bt_key *keys    = malloc((n + 1) * sizeof(*keys));
+            uint32_t             *lens    = malloc((n + 1) * sizeof(uint32_t));
+            char                 *scratch = malloc(DISKFS_BT_NODE_CAP);
+            uint32_t              o       = 0;
 
             for (i = 0; i < n; i++) {
-                keys[i] = cs[i].key;
-                lens[i] = cs[i].len;
-                memcpy(scratch + o, (char *) cbuf + cs[i].off, cs[i].len);
-                o += cs[i].len;
-            }
-            diskfs_bt_node_init(root, base, DISKFS_BT_ROOT_CAP, 0);
-            o = 0;
-            for (i = 0; i < n; i++) {
-                diskfs_bt_leaf_append(root, base, &keys[i], scratch + o, lens[i]);
+                keys[i] = diskfs_bt_leaf_key(cbuf, 0, i);
+                lens[i] = diskfs_bt_leaf_rec_len(cbuf, 0, i);
+                memcpy(scratch + o, diskfs_bt_leaf_rec(cbuf, 0, i), lens[i]);
                 o += lens[i];
             }
+            diskfs_bt_leaf_fill(root, base, DISKFS_BT_ROOT_CAP, keys, lens, scratch,
+                                n, thread->shared->bt_compact);
             rh            = diskfs_bt_hdr(root, base);
             rh->next_leaf = cnext;
             rh->prev_leaf = cprev;
@@ -1199,19 +1328,19 @@ diskfs_bt_op_emit(
     uint32_t             base,
     int                  idx)
 {
-    struct diskfs_bt_lslot *sl  = diskfs_bt_lslots(buf, base);
-    uint32_t                len = sl[idx].len;
+    uint32_t reclen = diskfs_bt_leaf_rec_len(buf, base, idx);
+    uint32_t len    = reclen;
 
     if (op->r_key) {
-        *op->r_key = sl[idx].key;
+        *op->r_key = diskfs_bt_leaf_key(buf, base, idx);
     }
     if (len > op->out_cap) {
         len = op->out_cap;
     }
     if (op->out) {
-        memcpy(op->out, (char *) buf + base + sl[idx].off, len);
+        memcpy(op->out, diskfs_bt_leaf_rec(buf, base, idx), len);
     }
-    return (int) sl[idx].len;
+    return (int) reclen;
 } /* diskfs_bt_op_emit */
 
 
@@ -1251,7 +1380,7 @@ diskfs_bt_run(struct diskfs_bt_op *op)
             int rrc = space_map_reserve(thread->shared->space_map,
                                         &thread->space_cache, &jnl, SM_DEV_LOCAL,
                                         (uint64_t) (DISKFS_BT_MAX_DEPTH + 2) * DISKFS_BLOCK_SIZE,
-                                        SM_RESERVATION_MIN);
+                                        SM_RESERVATION_MIN, SM_DEVICE_ANY);
 
             if (rrc == SM_AGAIN) {
                 /* Parked on a cold journal block.  Mark the op suspended so
@@ -1369,6 +1498,12 @@ diskfs_bt_run(struct diskfs_bt_op *op)
                 struct diskfs_bt_islot *isl = diskfs_bt_islots(buf, base);
                 int                     ci  = diskfs_bt_interior_search(buf, base, &op->key);
 
+                /* Every descent below here goes through this node: keep it in
+                 * the block cache's hot list. */
+                __atomic_store_n(&blk->interior, 1, __ATOMIC_RELAXED);
+                diskfs_metric_btree(thread, DISKFS_METRIC_BTREE_LEVELS, 1);
+                diskfs_metric_btree(thread, DISKFS_METRIC_BTREE_FANOUT, h->nitems);
+
                 op->last_parent_valid      = 1;
                 op->last_parent_ci         = ci;
                 op->last_parent_nitems     = h->nitems;
@@ -1394,20 +1529,24 @@ diskfs_bt_run(struct diskfs_bt_op *op)
                 continue;
             }
 
-            /* At the leaf. */
-            if (op->opcode == DISKFS_BT_OP_INSERT) {
-                /* A leaf split rewrites the right sibling's prev_leaf link.
-                 * That sibling is off the descent path, so on a cold cache
-                 * (remount) the synchronous split's node_for_write would miss
-                 * it.  Fault it in first via the async evpl_block path (parks +
-                 * resumes into this phase if not resident); a warm cache hits. */
-                if (h->next_leaf) {
-                    off = sm_inum_to_device_offset(thread->shared->space_map,
-                                                   h->next_leaf, &dev);
-                    if (!diskfs_bt_block_get(op, dev, off)) {
-                        return;
-                    }
+            /* At the leaf.  A leaf split rewrites the right sibling's
+             * prev_leaf link.  That sibling is off the descent path, so on a
+             * cold cache (remount) an insert's synchronous split would miss it
+             * in node_for_write.  Fault it in first via the async evpl_block
+             * path (parks + resumes into this phase if not resident); a warm
+             * cache hits. */
+            if (op->opcode == DISKFS_BT_OP_INSERT && h->next_leaf) {
+                off = sm_inum_to_device_offset(thread->shared->space_map,
+                                               h->next_leaf, &dev);
+                if (!diskfs_bt_block_get(op, dev, off)) {
+                    return;
                 }
+            }
+            diskfs_metric_btree(thread, DISKFS_METRIC_BTREE_DESCENTS, 1);
+            diskfs_metric_btree(thread, DISKFS_METRIC_BTREE_LEVELS, 1);
+            diskfs_metric_btree(thread, DISKFS_METRIC_BTREE_LEAF_ITEMS, h->nitems);
+
+            if (op->opcode == DISKFS_BT_OP_INSERT) {
                 diskfs_bt_insert_locked(thread, op->txn, inode, &op->key,
                                         op->rec, op->reclen);
                 diskfs_bt_complete(op, 0);
@@ -1431,8 +1570,9 @@ diskfs_bt_run(struct diskfs_bt_op *op)
                 int exact, idx = h->nitems ? diskfs_bt_leaf_search(buf, base, &op->key, &exact) : 0;
 
                 if (idx < h->nitems) {
-                    if (unlikely(diskfs_bt_key_cmp(&diskfs_bt_lslots(buf, base)[idx].key,
-                                                   &op->key) < 0)) {
+                    struct diskfs_bt_key fk = diskfs_bt_leaf_key(buf, base, idx);
+
+                    if (unlikely(diskfs_bt_key_cmp(&fk, &op->key) < 0)) {
                         chimera_diskfs_error("b+tree lookup_ge routed backwards");
                         diskfs_bt_complete(op, -1);
                         return;
@@ -1468,8 +1608,9 @@ diskfs_bt_run(struct diskfs_bt_op *op)
             }
         } else if (op->phase == DISKFS_BT_PHASE_WALK_NEXT) {
             if (h->nitems > 0) {
-                if (unlikely(diskfs_bt_key_cmp(&diskfs_bt_lslots(buf, base)[0].key,
-                                               &op->key) < 0)) {
+                struct diskfs_bt_key fk = diskfs_bt_leaf_key(buf, base, 0);
+
+                if (unlikely(diskfs_bt_key_cmp(&fk, &op->key) < 0)) {
                     chimera_diskfs_error("b+tree leaf chain moved backwards during lookup_ge");
                     diskfs_bt_complete(op, -1);
                     return;
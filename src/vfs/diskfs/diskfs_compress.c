@@ -0,0 +1,236 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Transparent data compression: the LZ4 / zstd codecs behind compressed
+ * extents, the per-worker scratch and contexts they run in, and the sampling
+ * test that keeps incompressible units raw (see the design note in
+ * diskfs_internal.h).  The write, read and inflate paths in diskfs_io.c call
+ * in here on the worker that owns the request.
+ */
+
+#include <lz4.h>
+#include <zstd.h>
+
+#include "diskfs_internal.h"
+
+/* A unit is sampled as DISKFS_COMPRESS_SAMPLES slices spread over it; it is
+ * worth encoding if LZ4 gets the sample under 7/8 of its size. */
+#define DISKFS_COMPRESS_SAMPLES    8
+#define DISKFS_COMPRESS_SAMPLE_LEN 512
+
+
+const char *diskfs_compress_counter_names[DISKFS_METRIC_COMPRESS_NUM] = {
+    "bytes_in",
+    "bytes_out",
+    "compressed",
+    "raw",
+    "decompressed",
+    "inflated",
+    "errors",
+};
+
+
+struct diskfs_compress_ctx {
+    uint8_t   *out;      /* DISKFS_COMPRESS_UNIT_MAX: encode output / decode target */
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+};
+
+
+static struct diskfs_compress_ctx *
+diskfs_compress_ctx(struct diskfs_thread *thread)
+{
+    struct diskfs_compress_ctx *zc = thread->compress;
+
+    if (!zc) {
+        zc      = calloc(1, sizeof(*zc));
+        zc->out = malloc(DISKFS_COMPRESS_UNIT_MAX);
+        chimera_diskfs_abort_if(!zc->out, "diskfs compression scratch allocation failed");
+        thread->compress = zc;
+    }
+    return zc;
+} /* diskfs_compress_ctx */
+
+
+/* Cheap incompressibility test: LZ4 a sample of the unit into a buffer 7/8
+ * its size; already-compressed or encrypted data does not fit and is stored
+ * raw without running the configured codec over the whole unit. */
+static int
+diskfs_compress_worthwhile(
+    struct diskfs_compress_ctx *zc,
+    const uint8_t              *buf,
+    uint32_t                    length)
+{
+    char     sample[DISKFS_COMPRESS_SAMPLES * DISKFS_COMPRESS_SAMPLE_LEN];
+    uint32_t stride;
+    int      i;
+
+    if (length <= sizeof(sample)) {
+        return 1;
+    }
+
+    stride = (length - DISKFS_COMPRESS_SAMPLE_LEN) / (DISKFS_COMPRESS_SAMPLES - 1);
+    for (i = 0; i < DISKFS_COMPRESS_SAMPLES; i++) {
+        memcpy(sample + i * DISKFS_COMPRESS_SAMPLE_LEN, buf + (uint64_t) i * stride,
+               DISKFS_COMPRESS_SAMPLE_LEN);
+    }
+
+    return LZ4_compress_default(sample, (char *) zc->out, sizeof(sample),
+                                sizeof(sample) * 7 / 8) > 0;
+} /* diskfs_compress_worthwhile */
+
+
+/*
+ * Encode the `length` logical bytes at buf (a whole number of blocks) in
+ * place with the mount's codec.  Returns the device bytes the unit now takes
+ * at buf and sets *r_flags to its extent flags: a compressed blob (header,
+ * payload, zero fill to the block) when that saves at least one block,
+ * otherwise the data is left untouched, *r_flags is 0 and length is returned.
+ */
+uint32_t
+diskfs_compress_encode(
+    struct diskfs_thread *thread,
+    void                 *buf,
+    uint32_t              length,
+    uint32_t             *r_flags)
+{
+    struct diskfs_shared       *shared = thread->shared;
+    struct diskfs_compress_ctx *zc     = diskfs_compress_ctx(thread);
+    struct diskfs_zhdr         *hdr    = (struct diskfs_zhdr *) zc->out;
+    uint32_t                    cap, used, plen;
+    size_t                      csize;
+    int                         n;
+
+    *r_flags = 0;
+    diskfs_metric_compress(thread, DISKFS_METRIC_COMPRESS_BYTES_IN, length);
+
+    /* The payload must come in a block under the raw size to be kept. */
+    if (length <= DISKFS_BLOCK_SIZE + sizeof(*hdr) ||
+        !diskfs_compress_worthwhile(zc, buf, length)) {
+        goto raw;
+    }
+    cap = length - DISKFS_BLOCK_SIZE - sizeof(*hdr);
+
+    switch (shared->compress_algo) {
+        case DISKFS_COMPRESS_LZ4:
+            n = LZ4_compress_default(buf, (char *) (hdr + 1), (int) length, (int) cap);
+            if (n <= 0) {
+                goto raw;
+            }
+            csize = (size_t) n;
+            break;
+        case DISKFS_COMPRESS_ZSTD:
+            if (!zc->cctx) {
+                zc->cctx = ZSTD_createCCtx();
+                chimera_diskfs_abort_if(!zc->cctx, "ZSTD_createCCtx failed");
+            }
+            csize = ZSTD_compressCCtx(zc->cctx, hdr + 1, cap, buf, length,
+                                      shared->compress_level);
+            if (ZSTD_isError(csize)) {
+                goto raw;
+            }
+            break;
+        default:
+            goto raw;
+    } /* switch */
+
+    hdr->csize = (uint32_t) csize;
+    hdr->lsize = length;
+    used       = sizeof(*hdr) + (uint32_t) csize;
+    plen       = SM_ALIGN_UP(used);
+
+    memcpy(buf, zc->out, used);
+    memset((uint8_t *) buf + used, 0, plen - used);
+
+    *r_flags = DISKFS_EXT_COMPRESSED |
+        (shared->compress_algo << DISKFS_EXT_ALGO_SHIFT) |
+        ((plen / DISKFS_BLOCK_SIZE) << DISKFS_EXT_PBLK_SHIFT);
+
+    diskfs_metric_compress(thread, DISKFS_METRIC_COMPRESS_COMPRESSED, 1);
+    diskfs_metric_compress(thread, DISKFS_METRIC_COMPRESS_BYTES_OUT, plen);
+    return plen;
+
+ raw:
+    diskfs_metric_compress(thread, DISKFS_METRIC_COMPRESS_RAW, 1);
+    diskfs_metric_compress(thread, DISKFS_METRIC_COMPRESS_BYTES_OUT, length);
+    return length;
+} /* diskfs_compress_encode */
+
+
+/*
+ * Decode the blob of a compressed extent with `flags` into this worker's
+ * scratch.  On success *r_data / *r_length describe the unit's logical bytes,
+ * valid until the worker's next encode or decode.  Returns -1 if the blob is
+ * corrupt (the codec comes from the flags, so blobs written under another
+ * codec setting still decode).
+ */
+int
+diskfs_compress_decode(
+    struct diskfs_thread *thread,
+    const void           *blob,
+    uint32_t              flags,
+    const void          **r_data,
+    uint32_t             *r_length)
+{
+    struct diskfs_compress_ctx *zc   = diskfs_compress_ctx(thread);
+    const struct diskfs_zhdr   *hdr  = blob;
+    uint64_t                    phys = diskfs_ext_phys_len(0, flags);
+    size_t                      n;
+    int                         ln;
+
+    if (phys < sizeof(*hdr) || hdr->csize > phys - sizeof(*hdr) ||
+        hdr->lsize > DISKFS_COMPRESS_UNIT_MAX) {
+        goto corrupt;
+    }
+
+    switch ((flags & DISKFS_EXT_ALGO_MASK) >> DISKFS_EXT_ALGO_SHIFT) {
+        case DISKFS_COMPRESS_LZ4:
+            ln = LZ4_decompress_safe((const char *) (hdr + 1), (char *) zc->out,
+                                     (int) hdr->csize, (int) hdr->lsize);
+            if (ln < 0 || (uint32_t) ln != hdr->lsize) {
+                goto corrupt;
+            }
+            break;
+        case DISKFS_COMPRESS_ZSTD:
+            if (!zc->dctx) {
+                zc->dctx = ZSTD_createDCtx();
+                chimera_diskfs_abort_if(!zc->dctx, "ZSTD_createDCtx failed");
+            }
+            n = ZSTD_decompressDCtx(zc->dctx, zc->out, hdr->lsize, hdr + 1, hdr->csize);
+            if (ZSTD_isError(n) || n != hdr->lsize) {
+                goto corrupt;
+            }
+            break;
+        default:
+            goto corrupt;
+    } /* switch */
+
+    diskfs_metric_compress(thread, DISKFS_METRIC_COMPRESS_DECOMPRESSED, 1);
+    *r_data   = zc->out;
+    *r_length = hdr->lsize;
+    return 0;
+
+ corrupt:
+    diskfs_metric_compress(thread, DISKFS_METRIC_COMPRESS_ERRORS, 1);
+    chimera_diskfs_error("corrupt compressed extent (flags 0x%x)", flags);
+    return -1;
+} /* diskfs_compress_decode */
+
+
+void
+diskfs_compress_thread_destroy(struct diskfs_thread *thread)
+{
+    struct diskfs_compress_ctx *zc = thread->compress;
+
+    if (!zc) {
+        return;
+    }
+
+    ZSTD_freeCCtx(zc->cctx);
+    ZSTD_freeDCtx(zc->dctx);
+    free(zc->out);
+    free(zc);
+    thread->compress = NULL;
+} /* diskfs_compress_thread_destroy */
@@ -0,0 +1,884 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Data checksums: hashing the blocks a data write submits, storing them in
+ * the per-AG checksum tables at commit, verifying blocks against the tables
+ * on the way in, and the rate-limited scrub that reads every checksummed
+ * block back (see the design note in diskfs_internal.h).  Hashing and
+ * verification run on the worker that owns the request; the scrub runs on a
+ * reclaim worker, driven by a timer.
+ */
+
+#include "diskfs_internal.h"
+
+/* Forward declarations (definitions below, in call-graph order) */
+
+static void
+diskfs_scrub_run(
+    struct diskfs_scrub *sc);
+
+static void
+diskfs_scrub_io_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data);
+
+static void
+diskfs_scrub_check(
+    struct diskfs_thread *thread,
+    void                 *arg);
+
+
+const char *diskfs_csum_counter_names[DISKFS_METRIC_CSUM_NUM] = {
+    "verified",
+    "unverified",
+    "failures",
+    "scrubbed",
+    "passes",
+    "throttled",
+    "errors",
+};
+
+
+/* One scrub read-back in flight. */
+struct diskfs_scrub_io {
+    struct diskfs_scrub *sc;
+    struct evpl_iovec    iov;
+    uint64_t             device_offset;
+    uint32_t             device_id;
+    uint32_t             nblocks;
+    int                  retried;
+};
+
+
+/* A block's checksum: XXH3 folded to 32 bits, never 0 (which marks an
+ * entry with nothing recorded). */
+static inline uint32_t
+diskfs_csum_block(const void *data)
+{
+    uint64_t h = chimera_xxh3_64(data, DISKFS_BLOCK_SIZE);
+    uint32_t v = (uint32_t) (h ^ (h >> 32));
+
+    return v ? v : 1;
+} /* diskfs_csum_block */
+
+
+/* Checksum `nblocks` consecutive blocks starting `skip` bytes into iov.  A
+ * block that straddles segments is gathered into a bounce buffer first. */
+static void
+diskfs_csum_hash(
+    const struct evpl_iovec *iov,
+    int                      niov,
+    uint64_t                 skip,
+    uint32_t                 nblocks,
+    uint32_t                *out)
+{
+    uint8_t  bounce[DISKFS_BLOCK_SIZE];
+    uint64_t off = skip;
+    uint32_t b, got, n;
+    int      i = 0;
+
+    while (i < niov && off >= iov[i].length) {
+        off -= iov[i].length;
+        i++;
+    }
+
+    for (b = 0; b < nblocks; b++) {
+        if (i < niov && iov[i].length - off >= DISKFS_BLOCK_SIZE) {
+            out[b] = diskfs_csum_block((const uint8_t *) iov[i].data + off);
+            off   += DISKFS_BLOCK_SIZE;
+        } else {
+            got = 0;
+            while (got < DISKFS_BLOCK_SIZE && i < niov) {
+                n = (uint32_t) (iov[i].length - off);
+                if (n > DISKFS_BLOCK_SIZE - got) {
+                    n = DISKFS_BLOCK_SIZE - got;
+                }
+                memcpy(bounce + got, (const uint8_t *) iov[i].data + off, n);
+                got += n;
+                off += n;
+                if (off == iov[i].length) {
+                    off = 0;
+                    i++;
+                }
+            }
+            memset(bounce + got, 0, DISKFS_BLOCK_SIZE - got);
+            out[b] = diskfs_csum_block(bounce);
+        }
+
+        while (i < niov && off >= iov[i].length) {
+            off -= iov[i].length;
+            i++;
+        }
+    }
+} /* diskfs_csum_hash */
+
+
+/* Blocks from device_offset to the end of its AG. */
+static inline uint64_t
+diskfs_csum_ag_left(uint64_t device_offset)
+{
+    uint64_t ag_end = ((device_offset >> SM_AG_SIZE_LOG2) + 1) << SM_AG_SIZE_LOG2;
+
+    return (ag_end - device_offset) >> SM_BLOCK_SHIFT;
+} /* diskfs_csum_ag_left */
+
+
+static inline pthread_mutex_t *
+diskfs_csum_lock(
+    struct diskfs_shared *shared,
+    uint32_t              device_id,
+    uint64_t              table_offset)
+{
+    return &shared->csum_lock[((table_offset >> SM_BLOCK_SHIFT) + device_id) %
+                              DISKFS_CSUM_LOCKS];
+} /* diskfs_csum_lock */
+
+
+/*
+ * Record the checksums of the `length` bytes (whole blocks) a data write is
+ * about to submit at device_offset, taken from the write's own buffers so
+ * they describe exactly what goes to the device.  Stored by the txn's commit.
+ */
+void
+diskfs_csum_note(
+    struct diskfs_thread    *thread,
+    struct diskfs_txn       *txn,
+    uint32_t                 device_id,
+    uint64_t                 device_offset,
+    const struct evpl_iovec *iov,
+    int                      niov,
+    uint64_t                 length)
+{
+    struct diskfs_txn_csum *c;
+    uint32_t                nblocks = (uint32_t) (length >> SM_BLOCK_SHIFT);
+
+    if (!thread->shared->data_csum || !txn || !nblocks) {
+        return;
+    }
+
+    c = malloc(sizeof(*c) + (size_t) nblocks * sizeof(uint32_t));
+    chimera_diskfs_abort_if(!c, "failed to allocate data checksums for %u blocks", nblocks);
+    c->device_id     = device_id;
+    c->device_offset = device_offset;
+    c->nblocks       = nblocks;
+    diskfs_csum_hash(iov, niov, 0, nblocks, c->sums);
+
+    c->next            = txn->pending_csums;
+    txn->pending_csums = c;
+} /* diskfs_csum_note */
+
+
+/* Pin a table block into the txn, once: a block already in it (an earlier
+ * record, or a resumed flush) just drops the extra pin. */
+static void
+diskfs_csum_txn_add(
+    struct diskfs_thread *thread,
+    struct diskfs_txn    *txn,
+    struct diskfs_block  *blk)
+{
+    struct diskfs_txn_block *tb;
+
+    for (tb = txn->blocks; tb; tb = tb->next) {
+        if (tb->block == blk) {
+            diskfs_block_release(thread, blk);
+            return;
+        }
+    }
+
+    diskfs_txn_add_block(txn, blk);
+
+    /* Writers of different files update the same table block concurrently,
+     * so, like an AG-log block, it is always logged as a full image. */
+    txn->blocks->journal = 1;
+} /* diskfs_csum_txn_add */
+
+
+/*
+ * Store checksums for `nblocks` blocks at device_offset into the table, or
+ * zero their entries when sums is NULL.  Each table block is claimed into
+ * the txn under its stripe lock, so concurrent writers and readers of its
+ * other entries see whole updates.  Returns SM_AGAIN if a table block is
+ * loading (the commit resumes through cctx once it lands); the store is
+ * idempotent, so the caller simply re-runs it.
+ */
+static int
+diskfs_csum_store(
+    struct diskfs_thread     *thread,
+    struct diskfs_txn        *txn,
+    struct diskfs_commit_ctx *cctx,
+    uint32_t                  device_id,
+    uint64_t                  device_offset,
+    uint32_t                  nblocks,
+    const uint32_t           *sums)
+{
+    struct diskfs_shared *shared = thread->shared;
+    struct space_map     *sm     = shared->space_map;
+    struct sm_csum_block *tbl;
+    struct diskfs_block  *blk;
+    pthread_mutex_t      *lock;
+    uint64_t              off, table_offset, n;
+    uint32_t              b = 0, slot, i;
+    int                   dirty;
+
+    while (b < nblocks) {
+        off = device_offset + ((uint64_t) b << SM_BLOCK_SHIFT);
+        n   = diskfs_csum_ag_left(off);
+        if (n > nblocks - b) {
+            n = nblocks - b;
+        }
+
+        if (sm_csum_locate(sm, device_id, off, &table_offset, &slot) != 0) {
+            b += (uint32_t) n;
+            continue;
+        }
+        if (n > SM_CSUM_PER_BLOCK - slot) {
+            n = SM_CSUM_PER_BLOCK - slot;
+        }
+
+        lock = diskfs_csum_lock(shared, device_id, table_offset);
+        chimera_mutex_lock(lock, "diskfs_csum");
+
+        blk = diskfs_block_claim_async(thread, device_id, table_offset, 0,
+                                       diskfs_commit_resume, cctx);
+        if (!blk) {
+            pthread_mutex_unlock(lock);
+            return SM_AGAIN;
+        }
+
+        tbl   = blk->iov.data;
+        dirty = 1;
+        if (tbl->stamp != shared->fsid) {
+            if (sums) {
+                memset(tbl, 0, DISKFS_BLOCK_SIZE);
+                tbl->stamp = shared->fsid;
+            } else {
+                dirty = 0;      /* never written: already all zero */
+            }
+        } else if (!sums) {
+            for (i = 0; i < n && !tbl->csum[slot + i]; i++) {
+            }
+            dirty = i < n;
+        }
+
+        if (dirty) {
+            if (sums) {
+                memcpy(&tbl->csum[slot], sums + b, n * sizeof(uint32_t));
+            } else {
+                memset(&tbl->csum[slot], 0, n * sizeof(uint32_t));
+            }
+        }
+
+        pthread_mutex_unlock(lock);
+
+        if (dirty) {
+            diskfs_csum_txn_add(thread, txn, blk);
+        } else {
+            diskfs_block_release(thread, blk);
+        }
+
+        b += (uint32_t) n;
+    }
+
+    return 0;
+} /* diskfs_csum_store */
+
+
+/*
+ * The commit's checksum pre-pass, run after the FREE deltas are journaled:
+ * zero the entries of the whole blocks the txn frees (so a block reused for
+ * metadata never keeps a stale checksum), then store the checksums of the
+ * data it wrote.  Suspendable like diskfs_txn_flush_free_journals; progress
+ * is kept on the txn, so a resumed pass continues where it stopped.
+ */
+int
+diskfs_csum_flush(
+    struct diskfs_thread     *thread,
+    struct diskfs_txn        *txn,
+    struct diskfs_commit_ctx *cctx)
+{
+    struct diskfs_txn_free *f;
+    struct diskfs_txn_csum *c;
+    uint64_t                start, end;
+
+    if (!thread->shared->data_csum) {
+        return 0;
+    }
+
+    for (f = txn->pending_frees; f; f = f->next) {
+        if (f->cleared) {
+            continue;
+        }
+        start = SM_ALIGN_UP(f->device_offset);
+        end   = (f->device_offset + f->length) & ~(uint64_t) SM_BLOCK_MASK;
+        if (end > start &&
+            diskfs_csum_store(thread, txn, cctx, f->device_id, start,
+                              (uint32_t) ((end - start) >> SM_BLOCK_SHIFT),
+                              NULL) == SM_AGAIN) {
+            return SM_AGAIN;
+        }
+        f->cleared = 1;
+    }
+
+    while ((c = txn->pending_csums)) {
+        if (diskfs_csum_store(thread, txn, cctx, c->device_id, c->device_offset,
+                              c->nblocks, c->sums) == SM_AGAIN) {
+            return SM_AGAIN;
+        }
+        txn->pending_csums = c->next;
+        free(c);
+    }
+
+    return 0;
+} /* diskfs_csum_flush */
+
+
+/* Drop an aborted txn's checksums: its data never becomes reachable. */
+void
+diskfs_csum_discard(struct diskfs_txn *txn)
+{
+    struct diskfs_txn_csum *c, *n;
+
+    for (c = txn->pending_csums; c; c = n) {
+        n = c->next;
+        free(c);
+    }
+    txn->pending_csums = NULL;
+} /* diskfs_csum_discard */
+
+
+/*
+ * Check `nblocks` blocks read from device_offset, which sit `skip` bytes into
+ * iov, against the table.  Entries are fetched a batch at a time under the
+ * table block's stripe lock, then the blocks are hashed and compared.
+ * Returns 0 if every recorded checksum matched, -1 on a mismatch, or
+ * SM_AGAIN if a table block is loading (resume(thread, arg) runs once it
+ * lands; the check restarts from the top).  With `report`, the outcome is
+ * counted and mismatches are logged; r_counts, if given, accumulates the
+ * verified / unverified / failed block counts either way.
+ */
+static int
+diskfs_csum_check(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    uint32_t nblocks,
+    const struct evpl_iovec *iov,
+    int niov,
+    uint64_t skip,
+    int report,
+    uint64_t *r_counts,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg)
+{
+    struct diskfs_shared       *shared = thread->shared;
+    struct space_map           *sm     = shared->space_map;
+    const struct sm_csum_block *tbl;
+    struct diskfs_block        *blk;
+    pthread_mutex_t            *lock;
+    uint32_t                    want[DISKFS_CSUM_BATCH], got[DISKFS_CSUM_BATCH];
+    uint64_t                    off, table_offset, n;
+    uint64_t                    verified = 0, unverified = 0, failed = 0;
+    uint32_t                    b = 0, slot, i, any;
+
+    while (b < nblocks) {
+        off = device_offset + ((uint64_t) b << SM_BLOCK_SHIFT);
+        n   = diskfs_csum_ag_left(off);
+        if (n > nblocks - b) {
+            n = nblocks - b;
+        }
+
+        if (sm_csum_locate(sm, device_id, off, &table_offset, &slot) != 0) {
+            unverified += n;
+            b          += (uint32_t) n;
+            continue;
+        }
+        if (n > SM_CSUM_PER_BLOCK - slot) {
+            n = SM_CSUM_PER_BLOCK - slot;
+        }
+        if (n > DISKFS_CSUM_BATCH) {
+            n = DISKFS_CSUM_BATCH;
+        }
+
+        blk = diskfs_block_get_async(thread, device_id, table_offset, resume, arg);
+        if (!blk) {
+            return SM_AGAIN;
+        }
+
+        lock = diskfs_csum_lock(shared, device_id, table_offset);
+        chimera_mutex_lock(lock, "diskfs_csum");
+        tbl = blk->iov.data;
+        if (tbl->stamp == shared->fsid) {
+            memcpy(want, &tbl->csum[slot], n * sizeof(uint32_t));
+        } else {
+            memset(want, 0, n * sizeof(uint32_t));
+        }
+        pthread_mutex_unlock(lock);
+        diskfs_block_release(thread, blk);
+
+        any = 0;
+        for (i = 0; i < n; i++) {
+            any |= want[i];
+        }
+
+        if (!any) {
+            unverified += n;
+        } else {
+            diskfs_csum_hash(iov, niov, skip + ((uint64_t) b << SM_BLOCK_SHIFT),
+                             (uint32_t) n, got);
+            for (i = 0; i < n; i++) {
+                if (!want[i]) {
+                    unverified++;
+                } else if (want[i] == got[i]) {
+                    verified++;
+                } else {
+                    failed++;
+                    if (report) {
+                        chimera_diskfs_error(
+                            "data checksum mismatch: device %u offset %lu "
+                            "(recorded %08x, read %08x)",
+                            device_id, off + ((uint64_t) i << SM_BLOCK_SHIFT),
+                            want[i], got[i]);
+                    }
+                }
+            }
+        }
+
+        b += (uint32_t) n;
+    }
+
+    if (report) {
+        diskfs_metric_csum(thread, DISKFS_METRIC_CSUM_VERIFIED, verified);
+        diskfs_metric_csum(thread, DISKFS_METRIC_CSUM_UNVERIFIED, unverified);
+        diskfs_metric_csum(thread, DISKFS_METRIC_CSUM_FAILURES, failed);
+    }
+    if (r_counts) {
+        r_counts[0] += verified;
+        r_counts[1] += unverified;
+        r_counts[2] += failed;
+    }
+
+    return failed ? -1 : 0;
+} /* diskfs_csum_check */
+
+
+/* Verify blocks a foreground path read (see diskfs_csum_check): 0, -1 on a
+ * mismatch (logged and counted), or SM_AGAIN after parking resume. */
+int
+diskfs_csum_verify(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    uint32_t nblocks,
+    const struct evpl_iovec *iov,
+    int niov,
+    uint64_t skip,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg)
+{
+    if (!thread->shared->data_csum || !nblocks) {
+        return 0;
+    }
+
+    return diskfs_csum_check(thread, device_id, device_offset, nblocks, iov, niov,
+                             skip, 1, NULL, resume, arg);
+} /* diskfs_csum_verify */
+
+
+static inline void
+diskfs_scrub_count(
+    struct diskfs_scrub       *sc,
+    enum diskfs_metric_csum_op op,
+    uint64_t                   n)
+{
+    chimera_job_counter_add(&sc->job, op, n);
+    diskfs_metric_csum(sc->worker->ctx, op, n);
+} /* diskfs_scrub_count */
+
+
+static void
+diskfs_scrub_resume(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    struct diskfs_scrub *sc = arg;
+
+    (void) thread;
+
+    sc->parked = 0;
+    diskfs_scrub_run(sc);
+} /* diskfs_scrub_resume */
+
+
+/*
+ * Find the next run of blocks with recorded checksums at or after the pass
+ * cursor: at most DISKFS_SCRUB_CHUNK, within one table block, and advance
+ * the cursor past it.  Returns 0 with the run, 1 once the pass has walked
+ * every table, or SM_AGAIN if a table block is loading.
+ */
+static int
+diskfs_scrub_next(
+    struct diskfs_scrub *sc,
+    uint32_t            *r_device_id,
+    uint64_t            *r_offset,
+    uint32_t            *r_nblocks)
+{
+    struct diskfs_shared       *shared = sc->shared;
+    struct space_map           *sm     = shared->space_map;
+    struct diskfs_thread       *thread = sc->worker->ctx;
+    const struct sm_csum_block *tbl;
+    const struct sm_device     *dev;
+    const struct sm_ag         *ag;
+    struct diskfs_block        *blk;
+    pthread_mutex_t            *lock;
+    uint64_t                    table_offset;
+    uint32_t                    ag_index, slot, n, first, last;
+
+    while (sc->device_id < sm->num_devices) {
+        dev      = &sm->devices[sc->device_id];
+        ag_index = (uint32_t) (sc->offset >> SM_AG_SIZE_LOG2);
+
+        if (ag_index >= dev->num_ags) {
+            sc->device_id++;
+            sc->offset = 0;
+            continue;
+        }
+
+        ag = &dev->ags[ag_index];
+        if (!ag->csum_offset || sc->offset >= ag->csum_offset ||
+            sm_csum_locate(sm, sc->device_id, sc->offset, &table_offset, &slot) != 0) {
+            sc->offset = (uint64_t) (ag_index + 1) << SM_AG_SIZE_LOG2;
+            continue;
+        }
+
+        n = SM_CSUM_PER_BLOCK - slot;
+        if (n > (ag->csum_offset - sc->offset) >> SM_BLOCK_SHIFT) {
+            n = (uint32_t) ((ag->csum_offset - sc->offset) >> SM_BLOCK_SHIFT);
+        }
+
+        blk = diskfs_block_get_async(thread, sc->device_id, table_offset,
+                                     diskfs_scrub_resume, sc);
+        if (!blk) {
+            sc->parked = 1;
+            return SM_AGAIN;
+        }
+
+        lock = diskfs_csum_lock(shared, sc->device_id, table_offset);
+        chimera_mutex_lock(lock, "diskfs_csum");
+        tbl   = blk->iov.data;
+        first = n;
+        if (tbl->stamp == shared->fsid) {
+            for (first = 0; first < n && !tbl->csum[slot + first]; first++) {
+            }
+        }
+        for (last = first; last < n && tbl->csum[slot + last] &&
+             last - first < DISKFS_SCRUB_CHUNK / DISKFS_BLOCK_SIZE; last++) {
+        }
+        pthread_mutex_unlock(lock);
+        diskfs_block_release(thread, blk);
+
+        if (first == n) {
+            sc->offset += (uint64_t) n << SM_BLOCK_SHIFT;
+            continue;
+        }
+
+        *r_device_id = sc->device_id;
+        *r_offset    = sc->offset + ((uint64_t) first << SM_BLOCK_SHIFT);
+        *r_nblocks   = last - first;
+        sc->offset  += (uint64_t) last << SM_BLOCK_SHIFT;
+        return 0;
+    }
+
+    return 1;
+} /* diskfs_scrub_next */
+
+
+/* The pass has walked every table and its last read-back has landed. */
+static void
+diskfs_scrub_pass_done(struct diskfs_scrub *sc)
+{
+    if (!sc->active || sc->inflight ||
+        sc->device_id < sc->shared->space_map->num_devices) {
+        return;
+    }
+
+    sc->active = 0;
+    diskfs_scrub_count(sc, DISKFS_METRIC_CSUM_PASSES, 1);
+    __atomic_store_n(&sc->job.running, 0, __ATOMIC_RELAXED);
+} /* diskfs_scrub_pass_done */
+
+
+static void
+diskfs_scrub_tick(
+    struct evpl       *evpl,
+    struct evpl_timer *timer)
+{
+    struct diskfs_scrub *sc   = container_of(timer, struct diskfs_scrub, timer);
+    uint64_t             rate = __atomic_load_n(&sc->job.rate, __ATOMIC_RELAXED);
+
+    (void) evpl;
+
+    /* Refill the byte budget, holding at most one second's worth (see
+     * diskfs_discard_tick). */
+    if (rate) {
+        sc->tokens += rate * DISKFS_SCRUB_TICK_US / 1000000;
+        if (sc->tokens > (int64_t) rate) {
+            sc->tokens = rate;
+        }
+    }
+
+    diskfs_scrub_run(sc);
+} /* diskfs_scrub_tick */
+
+
+/*
+ * Start a pass if one is due (the job is enabled, or was started through
+ * REST), then issue read-backs while the budget and the in-flight cap allow.
+ */
+static void
+diskfs_scrub_run(struct diskfs_scrub *sc)
+{
+    struct diskfs_thread   *thread = sc->worker->ctx;
+    struct diskfs_scrub_io *io;
+    uint64_t                rate = __atomic_load_n(&sc->job.rate, __ATOMIC_RELAXED);
+    uint64_t                offset, length;
+    uint32_t                device_id, nblocks;
+    int                     rc;
+
+    if (sc->stopping || sc->parked) {
+        return;
+    }
+
+    if (!sc->active) {
+        if (!__atomic_exchange_n(&sc->kick, 0, __ATOMIC_RELAXED) &&
+            !__atomic_load_n(&sc->job.enabled, __ATOMIC_RELAXED)) {
+            return;
+        }
+        sc->active    = 1;
+        sc->device_id = 0;
+        sc->offset    = 0;
+        __atomic_store_n(&sc->job.running, 1, __ATOMIC_RELAXED);
+    }
+
+    while (sc->inflight < DISKFS_SCRUB_QDEPTH) {
+        if (rate && sc->tokens <= 0) {
+            diskfs_scrub_count(sc, DISKFS_METRIC_CSUM_THROTTLED, 1);
+            break;
+        }
+
+        rc = diskfs_scrub_next(sc, &device_id, &offset, &nblocks);
+        if (rc == SM_AGAIN) {
+            return;
+        }
+        if (rc) {
+            diskfs_scrub_pass_done(sc);
+            break;
+        }
+
+        length = (uint64_t) nblocks << SM_BLOCK_SHIFT;
+
+        io                = calloc(1, sizeof(*io));
+        io->sc            = sc;
+        io->device_id     = device_id;
+        io->device_offset = offset;
+        io->nblocks       = nblocks;
+        if (evpl_iovec_alloc(thread->evpl, length, DISKFS_BLOCK_SIZE, 1, 0,
+                             &io->iov) < 1) {
+            free(io);
+            diskfs_scrub_count(sc, DISKFS_METRIC_CSUM_ERRORS, 1);
+            break;
+        }
+
+        sc->tokens -= length;
+        sc->inflight++;
+
+        diskfs_metric_block_io(thread, DISKFS_METRIC_IO_READ,
+                               DISKFS_METRIC_IO_DATA, length);
+        diskfs_metric_block_io_device(thread, device_id, DISKFS_METRIC_IO_READ,
+                                      DISKFS_METRIC_IO_DATA, length);
+        evpl_block_read(thread->evpl, thread->queue[device_id], &io->iov, 1,
+                        offset, diskfs_scrub_io_cb, io);
+    }
+} /* diskfs_scrub_run */
+
+
+static void
+diskfs_scrub_io_done(struct diskfs_scrub_io *io)
+{
+    struct diskfs_scrub *sc = io->sc;
+
+    evpl_iovec_release(sc->worker->ctx->evpl, &io->iov);
+    free(io);
+
+    sc->inflight--;
+    diskfs_scrub_pass_done(sc);
+    diskfs_scrub_run(sc);
+} /* diskfs_scrub_io_done */
+
+
+static void
+diskfs_scrub_io_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct diskfs_scrub_io *io = private_data;
+
+    (void) evpl;
+
+    if (status) {
+        diskfs_scrub_count(io->sc, DISKFS_METRIC_CSUM_ERRORS, 1);
+        diskfs_scrub_io_done(io);
+        return;
+    }
+
+    diskfs_scrub_check(io->sc->worker->ctx, io);
+} /* diskfs_scrub_io_cb */
+
+
+/* Check a landed read-back against the entries as they are now.  A
+ * mismatch is read again once before it counts: the blocks may have been
+ * rewritten (and their checksums replaced) while the first read was out. */
+static void
+diskfs_scrub_check(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    struct diskfs_scrub_io *io       = arg;
+    struct diskfs_scrub    *sc       = io->sc;
+    uint64_t                count[3] = { 0, 0, 0 };
+    int                     rc;
+
+    rc = diskfs_csum_check(thread, io->device_id, io->device_offset, io->nblocks,
+                           &io->iov, 1, 0, io->retried, count,
+                           diskfs_scrub_check, io);
+    if (rc == SM_AGAIN) {
+        return;
+    }
+
+    if (rc && !io->retried) {
+        io->retried = 1;
+        evpl_block_read(thread->evpl, thread->queue[io->device_id], &io->iov, 1,
+                        io->device_offset, diskfs_scrub_io_cb, io);
+        return;
+    }
+
+    chimera_job_counter_add(&sc->job, DISKFS_METRIC_CSUM_VERIFIED, count[0]);
+    chimera_job_counter_add(&sc->job, DISKFS_METRIC_CSUM_UNVERIFIED, count[1]);
+    chimera_job_counter_add(&sc->job, DISKFS_METRIC_CSUM_FAILURES, count[2]);
+    diskfs_scrub_count(sc, DISKFS_METRIC_CSUM_SCRUBBED,
+                       (uint64_t) io->nblocks << SM_BLOCK_SHIFT);
+    diskfs_scrub_io_done(io);
+} /* diskfs_scrub_check */
+
+
+/* chimera_job ops: called from the REST thread under the registry lock. */
+static void
+diskfs_scrub_job_set_enabled(
+    struct chimera_job *job,
+    int                 enabled)
+{
+    __atomic_store_n(&job->enabled, enabled, __ATOMIC_RELAXED);
+} /* diskfs_scrub_job_set_enabled */
+
+
+static void
+diskfs_scrub_job_set_rate(
+    struct chimera_job *job,
+    uint64_t            bytes_per_sec)
+{
+    __atomic_store_n(&job->rate, bytes_per_sec, __ATOMIC_RELAXED);
+} /* diskfs_scrub_job_set_rate */
+
+
+static void
+diskfs_scrub_job_start(struct chimera_job *job)
+{
+    struct diskfs_scrub *sc = job->private_data;
+
+    __atomic_store_n(&sc->kick, 1, __ATOMIC_RELAXED);
+} /* diskfs_scrub_job_start */
+
+
+static const struct chimera_job_ops diskfs_scrub_job_ops = {
+    .set_enabled = diskfs_scrub_job_set_enabled,
+    .set_rate    = diskfs_scrub_job_set_rate,
+    .start       = diskfs_scrub_job_start,
+};
+
+
+/* The scrub exists only on a filesystem formatted with data checksums. */
+void
+diskfs_scrub_create(struct diskfs_shared *shared)
+{
+    struct diskfs_scrub *sc;
+    int                  i;
+
+    if (!shared->data_csum) {
+        return;
+    }
+
+    sc         = calloc(1, sizeof(*sc));
+    sc->shared = shared;
+
+    snprintf(sc->job.name, sizeof(sc->job.name), "diskfs_scrub");
+    sc->job.ops          = &diskfs_scrub_job_ops;
+    sc->job.private_data = sc;
+    sc->job.enabled      = shared->scrub_enabled;
+    sc->job.rate         = shared->scrub_rate;
+    sc->job.ncounters    = DISKFS_METRIC_CSUM_NUM;
+    for (i = 0; i < DISKFS_METRIC_CSUM_NUM; i++) {
+        sc->job.counter_names[i] = diskfs_csum_counter_names[i];
+    }
+    chimera_job_register(&sc->job);
+
+    shared->scrub = sc;
+} /* diskfs_scrub_create */
+
+
+void
+diskfs_scrub_destroy(struct diskfs_shared *shared)
+{
+    struct diskfs_scrub *sc = shared->scrub;
+
+    if (!sc) {
+        return;
+    }
+    chimera_job_unregister(&sc->job);
+    free(sc);
+    shared->scrub = NULL;
+} /* diskfs_scrub_destroy */
+
+
+void
+diskfs_scrub_thread_init(struct diskfs_reclaim_worker *w)
+{
+    struct diskfs_scrub *sc = w->shared->scrub;
+
+    evpl_add_timer(w->ctx->evpl, &sc->timer, diskfs_scrub_tick,
+                   DISKFS_SCRUB_TICK_US);
+    sc->armed = 1;
+} /* diskfs_scrub_thread_init */
+
+
+/* Abandon the pass: let its read-backs (and a table block it waits on) land,
+ * issuing nothing more.  The next mount starts a fresh pass. */
+void
+diskfs_scrub_thread_shutdown(struct diskfs_reclaim_worker *w)
+{
+    struct diskfs_scrub *sc = w->shared->scrub;
+
+    sc->stopping = 1;
+
+    if (sc->armed) {
+        evpl_remove_timer(w->ctx->evpl, &sc->timer);
+        sc->armed = 0;
+    }
+
+    while (sc->inflight || sc->parked) {
+        evpl_continue(w->ctx->evpl);
+    }
+    __atomic_store_n(&sc->job.running, 0, __ATOMIC_RELAXED);
+} /* diskfs_scrub_thread_shutdown */
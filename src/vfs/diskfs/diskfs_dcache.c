@@ -0,0 +1,663 @@
+// SPDX-FileCopyrightText: 2025-2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Data cache: sharded segmented-LRU cache of 4 KiB file-data blocks keyed by
+ * (device, offset).  Reads copy cached blocks into the VFS read buffers and
+ * reserve the blocks they fetch from the device; the reservation is filled
+ * from the same buffers once the read lands.  Writes and extent frees
+ * invalidate.
+ */
+
+#include "diskfs_internal.h"
+
+/* Forward declarations (definitions below, in call-graph order) */
+
+static inline struct diskfs_dcache_shard *
+diskfs_dcache_shard(
+    struct diskfs_dcache *cache,
+    uint32_t              device_id,
+    uint64_t              device_offset);
+
+static inline uint32_t
+diskfs_dcache_bucket(
+    uint32_t device_id,
+    uint64_t device_offset);
+
+static inline void
+diskfs_dcache_list_unlink(
+    struct diskfs_dcache_list  *list,
+    struct diskfs_dcache_entry *e);
+
+static inline void
+diskfs_dcache_list_push_head(
+    struct diskfs_dcache_list  *list,
+    struct diskfs_dcache_entry *e);
+
+static inline void
+diskfs_dcache_queue_unlink(
+    struct diskfs_dcache_shard *shard,
+    struct diskfs_dcache_entry *e);
+
+static struct diskfs_dcache_entry *
+diskfs_dcache_lookup_locked(
+    struct diskfs_dcache_shard *shard,
+    uint32_t                    device_id,
+    uint64_t                    device_offset);
+
+static void
+diskfs_dcache_unhash_locked(
+    struct diskfs_dcache_shard *shard,
+    struct diskfs_dcache_entry *e);
+
+static inline void
+diskfs_dcache_put_locked(
+    struct diskfs_dcache_shard *shard,
+    struct diskfs_dcache_entry *e);
+
+static struct diskfs_dcache_entry *
+diskfs_dcache_victim_locked(
+    struct diskfs_thread       *thread,
+    struct diskfs_dcache_shard *shard);
+
+static void
+diskfs_dcache_touch_locked(
+    struct diskfs_thread       *thread,
+    struct diskfs_dcache       *cache,
+    struct diskfs_dcache_shard *shard,
+    struct diskfs_dcache_entry *e);
+
+static void
+diskfs_dcache_invalidate_scan(
+    struct diskfs_thread *thread,
+    struct diskfs_dcache *cache,
+    uint32_t              device_id,
+    uint64_t              start,
+    uint64_t              end);
+
+
+static inline struct diskfs_dcache_shard *
+diskfs_dcache_shard(
+    struct diskfs_dcache *cache,
+    uint32_t              device_id,
+    uint64_t              device_offset)
+{
+    uint64_t hash = diskfs_block_hash(device_id, device_offset);
+
+    return &cache->shards[hash & DISKFS_DCACHE_SHARD_MASK];
+} /* diskfs_dcache_shard */
+
+
+static inline uint32_t
+diskfs_dcache_bucket(
+    uint32_t device_id,
+    uint64_t device_offset)
+{
+    uint64_t hash = diskfs_block_hash(device_id, device_offset);
+
+    return (hash >> 8) & DISKFS_DCACHE_BUCKET_MASK;
+} /* diskfs_dcache_bucket */
+
+
+static inline void
+diskfs_dcache_list_unlink(
+    struct diskfs_dcache_list  *list,
+    struct diskfs_dcache_entry *e)
+{
+    if (e->prev) {
+        e->prev->next = e->next;
+    } else {
+        list->head = e->next;
+    }
+    if (e->next) {
+        e->next->prev = e->prev;
+    } else {
+        list->tail = e->prev;
+    }
+    e->prev = e->next = NULL;
+    list->count--;
+} /* diskfs_dcache_list_unlink */
+
+
+static inline void
+diskfs_dcache_list_push_head(
+    struct diskfs_dcache_list  *list,
+    struct diskfs_dcache_entry *e)
+{
+    e->prev = NULL;
+    e->next = list->head;
+    if (list->head) {
+        list->head->prev = e;
+    } else {
+        list->tail = e;
+    }
+    list->head = e;
+    list->count++;
+} /* diskfs_dcache_list_push_head */
+
+
+static inline void
+diskfs_dcache_queue_unlink(
+    struct diskfs_dcache_shard *shard,
+    struct diskfs_dcache_entry *e)
+{
+    if (e->queue == DISKFS_DCACHE_Q_PROBATION) {
+        diskfs_dcache_list_unlink(&shard->probation, e);
+    } else if (e->queue == DISKFS_DCACHE_Q_PROTECTED) {
+        diskfs_dcache_list_unlink(&shard->protected, e);
+    }
+    e->queue = DISKFS_DCACHE_Q_NONE;
+} /* diskfs_dcache_queue_unlink */
+
+
+static struct diskfs_dcache_entry *
+diskfs_dcache_lookup_locked(
+    struct diskfs_dcache_shard *shard,
+    uint32_t                    device_id,
+    uint64_t                    device_offset)
+{
+    struct diskfs_dcache_entry *e;
+
+    e = shard->buckets[diskfs_dcache_bucket(device_id, device_offset)];
+    while (e) {
+        if (e->device_offset == device_offset && e->device_id == device_id) {
+            return e;
+        }
+        e = e->hash_next;
+    }
+    return NULL;
+} /* diskfs_dcache_lookup_locked */
+
+
+/* Drop an entry from its bucket and queue.  An entry with a copy in flight is
+ * left floating; the last diskfs_dcache_put_locked returns it to the free
+ * list. */
+static void
+diskfs_dcache_unhash_locked(
+    struct diskfs_dcache_shard *shard,
+    struct diskfs_dcache_entry *e)
+{
+    struct diskfs_dcache_entry **pp;
+
+    pp = &shard->buckets[diskfs_dcache_bucket(e->device_id, e->device_offset)];
+    while (*pp != e) {
+        pp = &(*pp)->hash_next;
+    }
+    *pp          = e->hash_next;
+    e->hash_next = NULL;
+    e->hashed    = 0;
+    e->state     = DISKFS_DCACHE_FREE;
+    diskfs_dcache_queue_unlink(shard, e);
+
+    if (e->refs == 0) {
+        e->next          = shard->free_list;
+        shard->free_list = e;
+    }
+} /* diskfs_dcache_unhash_locked */
+
+
+static inline void
+diskfs_dcache_put_locked(
+    struct diskfs_dcache_shard *shard,
+    struct diskfs_dcache_entry *e)
+{
+    if (--e->refs == 0 && !e->hashed) {
+        e->next          = shard->free_list;
+        shard->free_list = e;
+    }
+} /* diskfs_dcache_put_locked */
+
+
+/* A free entry for a new reservation: the free list first, then the least
+ * recently used unreferenced probation entry, then protected.  NULL if every
+ * entry is mid-copy (the block just goes uncached). */
+static struct diskfs_dcache_entry *
+diskfs_dcache_victim_locked(
+    struct diskfs_thread       *thread,
+    struct diskfs_dcache_shard *shard)
+{
+    struct diskfs_dcache_entry *e = shard->free_list;
+
+    if (e) {
+        shard->free_list = e->next;
+        e->next          = NULL;
+        return e;
+    }
+
+    for (e = shard->probation.tail; e && e->refs; e = e->prev) {
+    }
+    if (!e) {
+        for (e = shard->protected.tail; e && e->refs; e = e->prev) {
+        }
+    }
+    if (!e) {
+        return NULL;
+    }
+
+    diskfs_dcache_unhash_locked(shard, e);
+    diskfs_metric_dcache(thread, DISKFS_METRIC_DCACHE_EVICT, 1);
+
+    /* unhash pushed it (refs == 0); take it straight back off. */
+    shard->free_list = e->next;
+    e->next          = NULL;
+    return e;
+} /* diskfs_dcache_victim_locked */
+
+
+/* Reference a hit: a probation entry earns the protected segment, demoting
+ * the protected tail back to probation once the segment is over its cap. */
+static void
+diskfs_dcache_touch_locked(
+    struct diskfs_thread       *thread,
+    struct diskfs_dcache       *cache,
+    struct diskfs_dcache_shard *shard,
+    struct diskfs_dcache_entry *e)
+{
+    struct diskfs_dcache_entry *demote;
+
+    if (e->queue == DISKFS_DCACHE_Q_PROTECTED) {
+        diskfs_dcache_list_unlink(&shard->protected, e);
+        diskfs_dcache_list_push_head(&shard->protected, e);
+        return;
+    }
+
+    diskfs_dcache_list_unlink(&shard->probation, e);
+    diskfs_dcache_list_push_head(&shard->protected, e);
+    e->queue = DISKFS_DCACHE_Q_PROTECTED;
+    diskfs_metric_dcache(thread, DISKFS_METRIC_DCACHE_PROMOTE, 1);
+
+    if (shard->protected.count > cache->protected_cap) {
+        demote = shard->protected.tail;
+        diskfs_dcache_list_unlink(&shard->protected, demote);
+        diskfs_dcache_list_push_head(&shard->probation, demote);
+        demote->queue = DISKFS_DCACHE_Q_PROBATION;
+    }
+} /* diskfs_dcache_touch_locked */
+
+
+/* Copy into the read buffers across iovec boundaries (also used by the
+ * compressed-extent read path). */
+void
+diskfs_dcache_cursor_put(
+    struct evpl_iovec_cursor *cursor,
+    const void               *src,
+    uint32_t                  length)
+{
+    const uint8_t *p = src;
+    int            chunk, left = length;
+
+    while (left && cursor->niov) {
+        chunk = cursor->iov->length - cursor->offset;
+        if (left < chunk) {
+            chunk = left;
+        }
+
+        memcpy(cursor->iov->data + cursor->offset, p, chunk);
+
+        p    += chunk;
+        left -= chunk;
+
+        cursor->offset   += chunk;
+        cursor->consumed += chunk;
+        if (cursor->offset == cursor->iov->length) {
+            cursor->iov++;
+            cursor->niov--;
+            cursor->offset = 0;
+        }
+    }
+
+    chimera_diskfs_abort_if(left, "diskfs data cache copy overran the read buffers");
+} /* diskfs_dcache_cursor_put */
+
+
+void
+diskfs_dcache_create(struct diskfs_shared *shared)
+{
+    struct diskfs_dcache *cache;
+    int                   i;
+    uint32_t              j;
+
+    if (shared->data_cache_blocks == 0) {
+        shared->dcache = NULL;
+        return;
+    }
+
+    cache            = calloc(1, sizeof(*cache));
+    cache->shard_cap = shared->data_cache_blocks / DISKFS_DCACHE_SHARDS;
+    if (cache->shard_cap == 0) {
+        cache->shard_cap = 1;
+    }
+    cache->protected_cap = cache->shard_cap * DISKFS_DCACHE_PROTECTED_PCT / 100;
+    pthread_mutex_init(&cache->prealloc_lock, NULL);
+
+    for (i = 0; i < DISKFS_DCACHE_SHARDS; i++) {
+        struct diskfs_dcache_shard *shard = &cache->shards[i];
+
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->buckets = calloc(DISKFS_DCACHE_BUCKETS_PER_SHARD,
+                                sizeof(struct diskfs_dcache_entry *));
+        shard->pool     = calloc(cache->shard_cap, sizeof(struct diskfs_dcache_entry));
+        shard->nentries = cache->shard_cap;
+
+        /* Every entry starts free; its buffer is attached by prealloc. */
+        for (j = 0; j < shard->nentries; j++) {
+            shard->pool[j].next = shard->free_list;
+            shard->free_list    = &shard->pool[j];
+        }
+    }
+    shared->dcache = cache;
+} /* diskfs_dcache_create */
+
+
+void
+diskfs_dcache_prealloc(
+    struct diskfs_shared *shared,
+    struct evpl          *evpl)
+{
+    struct diskfs_dcache *cache = shared->dcache;
+    uint32_t              i, j;
+
+    if (!cache) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->prealloc_lock);
+    if (cache->buffers_ready) {
+        pthread_mutex_unlock(&cache->prealloc_lock);
+        return;
+    }
+
+    for (i = 0; i < DISKFS_DCACHE_SHARDS; i++) {
+        struct diskfs_dcache_shard *shard = &cache->shards[i];
+
+        for (j = 0; j < shard->nentries; j++) {
+            int niov;
+
+            niov = evpl_iovec_alloc(evpl, DISKFS_BLOCK_SIZE, DISKFS_BLOCK_SIZE, 1,
+                                    EVPL_IOVEC_FLAG_SHARED, &shard->pool[j].iov);
+            chimera_diskfs_abort_if(niov != 1,
+                                    "diskfs data cache buffer did not fit in one iovec (%d)",
+                                    niov);
+        }
+    }
+
+    cache->buffers_ready = 1;
+    pthread_mutex_unlock(&cache->prealloc_lock);
+} /* diskfs_dcache_prealloc */
+
+
+void
+diskfs_dcache_destroy(struct diskfs_shared *shared)
+{
+    struct diskfs_dcache *cache = shared->dcache;
+    int                   i;
+    uint32_t              j;
+
+    if (!cache) {
+        return;
+    }
+
+    for (i = 0; i < DISKFS_DCACHE_SHARDS; i++) {
+        struct diskfs_dcache_shard *shard = &cache->shards[i];
+
+        if (cache->buffers_ready) {
+            for (j = 0; j < shard->nentries; j++) {
+                evpl_iovec_release(NULL, &shard->pool[j].iov);
+            }
+        }
+        free(shard->pool);
+        free(shard->buckets);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    pthread_mutex_destroy(&cache->prealloc_lock);
+    free(cache);
+    shared->dcache = NULL;
+} /* diskfs_dcache_destroy */
+
+
+/*
+ * Serve the leading cached blocks of [device_offset, +length) into the cursor
+ * and return the bytes served (a multiple of the block size, or all of a short
+ * tail).  Stops at the first block not resident; the caller reads the rest.
+ * device_offset must be block aligned.  The copy runs outside the shard lock
+ * under an entry reference, so eviction and invalidation skip it meanwhile.
+ */
+uint64_t
+diskfs_dcache_read(
+    struct diskfs_thread     *thread,
+    uint32_t                  device_id,
+    uint64_t                  device_offset,
+    uint64_t                  length,
+    struct evpl_iovec_cursor *cursor)
+{
+    struct diskfs_dcache       *cache = thread->shared->dcache;
+    struct diskfs_dcache_shard *shard;
+    struct diskfs_dcache_entry *e;
+    uint64_t                    served = 0, off;
+    uint32_t                    chunk;
+
+    if (!cache) {
+        return 0;
+    }
+
+    while (served < length) {
+        off   = device_offset + served;
+        shard = diskfs_dcache_shard(cache, device_id, off);
+
+        chimera_mutex_lock(&shard->lock, "diskfs_dcache_shard");
+        e = diskfs_dcache_lookup_locked(shard, device_id, off);
+        if (!e || e->state != DISKFS_DCACHE_VALID) {
+            pthread_mutex_unlock(&shard->lock);
+            break;
+        }
+        diskfs_dcache_touch_locked(thread, cache, shard, e);
+        e->refs++;
+        pthread_mutex_unlock(&shard->lock);
+
+        chunk = length - served < DISKFS_BLOCK_SIZE ?
+            (uint32_t) (length - served) : DISKFS_BLOCK_SIZE;
+        diskfs_dcache_cursor_put(cursor, e->iov.data, chunk);
+
+        chimera_mutex_lock(&shard->lock, "diskfs_dcache_shard");
+        diskfs_dcache_put_locked(shard, e);
+        pthread_mutex_unlock(&shard->lock);
+
+        served += chunk;
+        diskfs_metric_dcache(thread, DISKFS_METRIC_DCACHE_HIT, 1);
+    }
+
+    return served;
+} /* diskfs_dcache_read */
+
+
+/*
+ * Reserve the blocks of a device read before it is issued: each absent block
+ * gets a PENDING entry stamped with a fresh token, which only this read's
+ * diskfs_dcache_fill may complete.  An invalidation in between drops the entry,
+ * so a read racing a write can never install the data it read before the
+ * write.  Returns nonzero if anything was reserved.
+ */
+int
+diskfs_dcache_reserve(
+    struct diskfs_thread      *thread,
+    struct diskfs_dcache_fill *fill)
+{
+    struct diskfs_dcache       *cache = thread->shared->dcache;
+    struct diskfs_dcache_shard *shard;
+    struct diskfs_dcache_entry *e;
+    uint64_t                    off, end = fill->device_offset + fill->length;
+    struct diskfs_dcache_entry **bucket;
+    int                         reserved = 0;
+
+    if (!cache || fill->length == 0) {
+        return 0;
+    }
+
+    diskfs_metric_dcache(thread, DISKFS_METRIC_DCACHE_MISS,
+                         fill->length >> DISKFS_BLOCK_SHIFT);
+
+    fill->token = __atomic_add_fetch(&cache->next_token, 1, __ATOMIC_RELAXED);
+
+    for (off = fill->device_offset; off < end; off += DISKFS_BLOCK_SIZE) {
+        shard = diskfs_dcache_shard(cache, fill->device_id, off);
+
+        chimera_mutex_lock(&shard->lock, "diskfs_dcache_shard");
+        if (diskfs_dcache_lookup_locked(shard, fill->device_id, off)) {
+            /* Already resident or reserved by a concurrent read. */
+            pthread_mutex_unlock(&shard->lock);
+            continue;
+        }
+
+        e = diskfs_dcache_victim_locked(thread, shard);
+        if (!e) {
+            pthread_mutex_unlock(&shard->lock);
+            continue;
+        }
+
+        e->device_id     = fill->device_id;
+        e->device_offset = off;
+        e->token         = fill->token;
+        e->state         = DISKFS_DCACHE_PENDING;
+        e->hashed        = 1;
+        bucket           = &shard->buckets[diskfs_dcache_bucket(fill->device_id, off)];
+        e->hash_next     = *bucket;
+        *bucket          = e;
+        diskfs_dcache_list_push_head(&shard->probation, e);
+        e->queue = DISKFS_DCACHE_Q_PROBATION;
+        pthread_mutex_unlock(&shard->lock);
+
+        reserved = 1;
+    }
+
+    return reserved;
+} /* diskfs_dcache_reserve */
+
+
+/*
+ * Complete a reservation from the read buffers (iov, niov) the device read
+ * landed in.  valid == 0 (the read failed) just drops the PENDING entries.
+ */
+void
+diskfs_dcache_fill(
+    struct diskfs_thread      *thread,
+    struct diskfs_dcache_fill *fill,
+    struct evpl_iovec         *iov,
+    int                        niov,
+    int                        valid)
+{
+    struct diskfs_dcache       *cache = thread->shared->dcache;
+    struct diskfs_dcache_shard *shard;
+    struct diskfs_dcache_entry *e;
+    struct evpl_iovec_cursor    cursor;
+    uint64_t                    off, end = fill->device_offset + fill->length;
+
+    if (!cache) {
+        return;
+    }
+
+    evpl_iovec_cursor_init(&cursor, iov, niov);
+    evpl_iovec_cursor_skip(&cursor, fill->buf_offset);
+
+    for (off = fill->device_offset; off < end; off += DISKFS_BLOCK_SIZE) {
+        shard = diskfs_dcache_shard(cache, fill->device_id, off);
+
+        chimera_mutex_lock(&shard->lock, "diskfs_dcache_shard");
+        e = diskfs_dcache_lookup_locked(shard, fill->device_id, off);
+        if (!e || e->state != DISKFS_DCACHE_PENDING || e->token != fill->token) {
+            pthread_mutex_unlock(&shard->lock);
+            evpl_iovec_cursor_skip(&cursor, DISKFS_BLOCK_SIZE);
+            continue;
+        }
+        if (!valid) {
+            diskfs_dcache_unhash_locked(shard, e);
+            pthread_mutex_unlock(&shard->lock);
+            evpl_iovec_cursor_skip(&cursor, DISKFS_BLOCK_SIZE);
+            continue;
+        }
+        e->refs++;
+        pthread_mutex_unlock(&shard->lock);
+
+        evpl_iovec_cursor_copy(&cursor, e->iov.data, DISKFS_BLOCK_SIZE);
+
+        chimera_mutex_lock(&shard->lock, "diskfs_dcache_shard");
+        if (e->hashed && e->state == DISKFS_DCACHE_PENDING && e->token == fill->token) {
+            e->state = DISKFS_DCACHE_VALID;
+            diskfs_metric_dcache(thread, DISKFS_METRIC_DCACHE_INSERT, 1);
+        }
+        diskfs_dcache_put_locked(shard, e);
+        pthread_mutex_unlock(&shard->lock);
+    }
+} /* diskfs_dcache_fill */
+
+
+/* Large ranges (a big extent free) walk the pools once instead of probing
+ * every block of the range. */
+static void
+diskfs_dcache_invalidate_scan(
+    struct diskfs_thread *thread,
+    struct diskfs_dcache *cache,
+    uint32_t              device_id,
+    uint64_t              start,
+    uint64_t              end)
+{
+    int      i;
+    uint32_t j;
+
+    for (i = 0; i < DISKFS_DCACHE_SHARDS; i++) {
+        struct diskfs_dcache_shard *shard = &cache->shards[i];
+
+        chimera_mutex_lock(&shard->lock, "diskfs_dcache_shard");
+        for (j = 0; j < shard->nentries; j++) {
+            struct diskfs_dcache_entry *e = &shard->pool[j];
+
+            if (e->hashed && e->device_id == device_id &&
+                e->device_offset >= start && e->device_offset < end) {
+                diskfs_dcache_unhash_locked(shard, e);
+                diskfs_metric_dcache(thread, DISKFS_METRIC_DCACHE_INVALIDATE, 1);
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+} /* diskfs_dcache_invalidate_scan */
+
+
+/* Drop every cached or reserved block overlapping [device_offset, +length). */
+void
+diskfs_dcache_invalidate(
+    struct diskfs_thread *thread,
+    uint32_t              device_id,
+    uint64_t              device_offset,
+    uint64_t              length)
+{
+    struct diskfs_dcache       *cache = thread->shared->dcache;
+    struct diskfs_dcache_shard *shard;
+    struct diskfs_dcache_entry *e;
+    uint64_t                    start, end, off;
+
+    if (!cache || length == 0) {
+        return;
+    }
+
+    start = device_offset & ~(uint64_t) (DISKFS_BLOCK_SIZE - 1);
+    end   = (device_offset + length + DISKFS_BLOCK_SIZE - 1) &
+        ~(uint64_t) (DISKFS_BLOCK_SIZE - 1);
+
+    if (((end - start) >> DISKFS_BLOCK_SHIFT) >
+        (uint64_t) cache->shard_cap * DISKFS_DCACHE_SHARDS) {
+        diskfs_dcache_invalidate_scan(thread, cache, device_id, start, end);
+        return;
+    }
+
+    for (off = start; off < end; off += DISKFS_BLOCK_SIZE) {
+        shard = diskfs_dcache_shard(cache, device_id, off);
+
+        chimera_mutex_lock(&shard->lock, "diskfs_dcache_shard");
+        e = diskfs_dcache_lookup_locked(shard, device_id, off);
+        if (e) {
+            diskfs_dcache_unhash_locked(shard, e);
+            diskfs_metric_dcache(thread, DISKFS_METRIC_DCACHE_INVALIDATE, 1);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+} /* diskfs_dcache_invalidate */
@@ -0,0 +1,881 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Online defragmentation: the write-path fragmentation trigger, the
+ * candidate queue, and the rate-limited pass that rewrites runs of small
+ * extents into one contiguous extent (see the design note in
+ * diskfs_internal.h).  Runs on reclaim worker 0, driven by a timer.
+ */
+
+#include "diskfs_internal.h"
+
+/* Forward declarations (definitions below, in call-graph order) */
+
+static void
+diskfs_defrag_run(
+    struct diskfs_defrag *df);
+
+static void
+diskfs_defrag_window_begin(
+    struct diskfs_defrag_op *op);
+
+static void
+diskfs_defrag_acquired_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_defrag_walk(
+    struct diskfs_defrag_op *op,
+    uint64_t                 file_offset);
+
+static void
+diskfs_defrag_walk_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv);
+
+static void
+diskfs_defrag_alloc(
+    struct diskfs_thread *thread,
+    void                 *arg);
+
+static void
+diskfs_defrag_read_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data);
+
+static void
+diskfs_defrag_verify(
+    struct diskfs_thread *thread,
+    void                 *arg);
+
+static void
+diskfs_defrag_write_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data);
+
+static void
+diskfs_defrag_swap_step(
+    struct diskfs_defrag_op *op);
+
+static void
+diskfs_defrag_removed_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv);
+
+static void
+diskfs_defrag_inserted_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv);
+
+static void
+diskfs_defrag_committed_cb(
+    struct diskfs_txn *txn,
+    int                status,
+    void              *priv);
+
+static void
+diskfs_defrag_yield(
+    struct diskfs_defrag_op *op);
+
+static void
+diskfs_defrag_file_finish(
+    struct diskfs_defrag_op *op);
+
+
+const char *diskfs_defrag_counter_names[DISKFS_METRIC_DEFRAG_NUM] = {
+    "queued",
+    "scanned",
+    "defragmented",
+    "windows",
+    "extents_removed",
+    "bytes_moved",
+    "throttled",
+    "errors",
+};
+
+
+static inline void
+diskfs_defrag_count(
+    struct diskfs_defrag        *df,
+    struct diskfs_thread        *thread,
+    enum diskfs_metric_defrag_op op,
+    uint64_t                     n)
+{
+    chimera_job_counter_add(&df->job, op, n);
+    diskfs_metric_defrag(thread, op, n);
+} /* diskfs_defrag_count */
+
+
+/*
+ * Write path hook, under the inode write lock: the extent just recorded at
+ * `inode`'s tail could not coalesce with its file predecessor because the two
+ * are not adjacent on disk.  Queue the file once enough such breaks pile up.
+ */
+void
+diskfs_defrag_note(
+    struct diskfs_thread *thread,
+    struct diskfs_inode  *inode)
+{
+    struct diskfs_defrag *df = thread->shared->defrag;
+    int                   queued;
+
+    if (!df || inode->defrag_queued || ++inode->frag_breaks < DISKFS_DEFRAG_TRIGGER) {
+        return;
+    }
+
+    pthread_mutex_lock(&df->lock);
+    queued = df->count < DISKFS_DEFRAG_QUEUE_MAX;
+    if (queued) {
+        struct diskfs_defrag_cand *c = &df->ring[(df->head + df->count) %
+                                                 DISKFS_DEFRAG_QUEUE_MAX];
+
+        c->inum = inode->inum;
+        c->gen  = inode->gen;
+        df->count++;
+    }
+    pthread_mutex_unlock(&df->lock);
+
+    if (queued) {
+        inode->frag_breaks   = 0;
+        inode->defrag_queued = 1;
+        diskfs_defrag_count(df, thread, DISKFS_METRIC_DEFRAG_QUEUED, 1);
+    }
+} /* diskfs_defrag_note */
+
+
+static int
+diskfs_defrag_pop(
+    struct diskfs_defrag      *df,
+    struct diskfs_defrag_cand *out)
+{
+    int have;
+
+    pthread_mutex_lock(&df->lock);
+    have = df->count > 0;
+    if (have) {
+        *out     = df->ring[df->head];
+        df->head = (df->head + 1) % DISKFS_DEFRAG_QUEUE_MAX;
+        df->count--;
+    }
+    pthread_mutex_unlock(&df->lock);
+
+    return have;
+} /* diskfs_defrag_pop */
+
+
+/*
+ * Foreground load: the share of wall time every other registered event-loop
+ * thread (protocol and VFS workers, delegation and close threads -- anything
+ * outside diskfs's own log and reclaim pools) spent busy since the last tick.
+ */
+static int
+diskfs_defrag_sample_load(struct diskfs_defrag *df)
+{
+    struct chimera_thread_stats *st;
+    uint64_t                     busy = 0, total = 0, b, t;
+    int                          over;
+
+    for (st = chimera_thread_stats_first(); st; st = st->next) {
+        if (!__atomic_load_n(&st->active, __ATOMIC_RELAXED) ||
+            strncmp(st->pool, "diskfs", 6) == 0) {
+            continue;
+        }
+        b      = __atomic_load_n(&st->busy_ns, __ATOMIC_RELAXED);
+        t      = b + __atomic_load_n(&st->poll_ns, __ATOMIC_RELAXED) +
+            __atomic_load_n(&st->idle_ns, __ATOMIC_RELAXED);
+        busy  += b;
+        total += t;
+    }
+
+    /* A thread that exited since the last sample takes its time with it;
+     * treat that interval as idle and rebase. */
+    over = total > df->fg_total_ns && busy >= df->fg_busy_ns &&
+        (busy - df->fg_busy_ns) * 100 >
+        (total - df->fg_total_ns) * df->busy_pct;
+
+    df->fg_busy_ns  = busy;
+    df->fg_total_ns = total;
+    return over;
+} /* diskfs_defrag_sample_load */
+
+
+static inline int
+diskfs_defrag_may_copy(struct diskfs_defrag *df)
+{
+    uint64_t rate = __atomic_load_n(&df->job.rate, __ATOMIC_RELAXED);
+
+    return !df->stopping && !df->busy &&
+           (__atomic_load_n(&df->job.enabled, __ATOMIC_RELAXED) ||
+            __atomic_load_n(&df->kick, __ATOMIC_RELAXED)) &&
+           (rate == 0 || df->tokens > 0);
+} /* diskfs_defrag_may_copy */
+
+
+static void
+diskfs_defrag_tick(
+    struct evpl       *evpl,
+    struct evpl_timer *timer)
+{
+    struct diskfs_defrag *df   = container_of(timer, struct diskfs_defrag, timer);
+    uint64_t              rate = __atomic_load_n(&df->job.rate, __ATOMIC_RELAXED);
+    int                   want;
+
+    (void) evpl;
+
+    /* Refill the byte budget, holding at most one second's worth.  A window
+     * may start on any positive balance and drive it negative, so the rate
+     * holds on average even when it is below one window per second. */
+    if (rate) {
+        df->tokens += rate * DISKFS_DEFRAG_TICK_US / 1000000;
+        if (df->tokens > (int64_t) rate) {
+            df->tokens = rate;
+        }
+    }
+
+    df->busy = diskfs_defrag_sample_load(df);
+
+    want = (__atomic_load_n(&df->job.enabled, __ATOMIC_RELAXED) ||
+            __atomic_load_n(&df->kick, __ATOMIC_RELAXED)) &&
+        (df->op || __atomic_load_n(&df->count, __ATOMIC_RELAXED));
+
+    if (df->busy && want) {
+        diskfs_defrag_count(df, df->worker->ctx, DISKFS_METRIC_DEFRAG_THROTTLED, 1);
+    }
+
+    diskfs_defrag_run(df);
+} /* diskfs_defrag_tick */
+
+
+/*
+ * Drive the pass as far as the budget allows: resume a parked file, or start
+ * the next queued one.  Windows that complete synchronously park and come
+ * back round this loop rather than recursing.
+ */
+static void
+diskfs_defrag_run(struct diskfs_defrag *df)
+{
+    struct diskfs_defrag_cand c;
+    struct diskfs_defrag_op  *op;
+
+    df->in_run = 1;
+
+    while (diskfs_defrag_may_copy(df)) {
+        op = df->op;
+
+        if (op) {
+            if (!op->parked) {
+                break;                  /* window in flight */
+            }
+            op->parked = 0;
+            diskfs_defrag_window_begin(op);
+            continue;
+        }
+
+        if (!diskfs_defrag_pop(df, &c)) {
+            __atomic_store_n(&df->kick, 0, __ATOMIC_RELAXED);
+            break;
+        }
+
+        op         = calloc(1, sizeof(*op));
+        op->df     = df;
+        op->thread = df->worker->ctx;
+        op->inum   = c.inum;
+        op->gen    = c.gen;
+        df->op     = op;
+        diskfs_defrag_window_begin(op);
+    }
+
+    df->in_run = 0;
+    __atomic_store_n(&df->job.running, df->op != NULL, __ATOMIC_RELAXED);
+} /* diskfs_defrag_run */
+
+
+static void
+diskfs_defrag_window_begin(struct diskfs_defrag_op *op)
+{
+    op->txn     = diskfs_txn_begin(op->thread, DISKFS_TXN_WRITE);
+    op->scanned = 0;
+    op->next    = 0;
+    op->nchunks = 0;
+    op->failed  = 0;
+    diskfs_inode_acquire(op->thread, op->txn, op->inum, op->gen,
+                         DISKFS_INODE_LOCK_WRITE, diskfs_defrag_acquired_cb, op);
+} /* diskfs_defrag_window_begin */
+
+
+static void
+diskfs_defrag_acquired_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_defrag_op *op = priv;
+
+    /* Gone, or no longer extent-mapped: nothing to do. */
+    if (status != CHIMERA_VFS_OK || !S_ISREG(inode->mode) ||
+        inode->nlink == 0 || inode->inline_data) {
+        diskfs_txn_abort(op->txn);
+        diskfs_defrag_file_finish(op);
+        return;
+    }
+
+    op->inode = inode;
+    diskfs_defrag_walk(op, op->cursor);
+} /* diskfs_defrag_acquired_cb */
+
+
+static void
+diskfs_defrag_walk(
+    struct diskfs_defrag_op *op,
+    uint64_t                 file_offset)
+{
+    struct diskfs_bt_op *bop;
+
+    /* Bound the lock hold on a long, mostly-contiguous file: between windows,
+     * give the inode back and pick up here on the next round. */
+    if (op->next == 0 && op->scanned >= DISKFS_DEFRAG_SCAN_MAX) {
+        op->cursor = file_offset;
+        diskfs_txn_abort(op->txn);
+        diskfs_defrag_yield(op);
+        return;
+    }
+
+    bop = diskfs_bt_op_alloc(op->thread);
+    if (diskfs_ext_ceil_async(bop, op->thread, op->inode, file_offset,
+                              op->rec_scratch, sizeof(op->rec_scratch),
+                              diskfs_defrag_walk_cb, op)) {
+        diskfs_defrag_walk_cb(bop, bop->result, op);
+    }
+} /* diskfs_defrag_walk */
+
+
+/* Can `e` extend the current window (or, with an empty window, open one)? */
+static int
+diskfs_defrag_fits(
+    const struct diskfs_defrag_op *op,
+    const struct diskfs_extent    *e)
+{
+    uint64_t chunk = op->df->chunk;
+
+    if (e->flags || e->length >= DISKFS_DEFRAG_TARGET ||
+        ((e->file_offset | e->length | e->device_offset) & (DISKFS_BLOCK_SIZE - 1))) {
+        return 0;
+    }
+    if (op->next == 0) {
+        return 1;
+    }
+    return op->next < DISKFS_DEFRAG_MAX_EXTENTS &&
+           e->file_offset == op->win_start + op->win_len &&
+           op->win_len + e->length <= DISKFS_DEFRAG_WINDOW &&
+           op->nchunks + (e->length + chunk - 1) / chunk <= DISKFS_DEFRAG_MAX_IOV;
+} /* diskfs_defrag_fits */
+
+
+static void
+diskfs_defrag_append(
+    struct diskfs_defrag_op    *op,
+    const struct diskfs_extent *e)
+{
+    uint64_t chunk = op->df->chunk;
+
+    if (op->next == 0) {
+        op->win_start = e->file_offset;
+        op->win_len   = 0;
+    }
+    op->ext[op->next++] = *e;
+    op->win_len        += e->length;
+    op->nchunks        += (e->length + chunk - 1) / chunk;
+} /* diskfs_defrag_append */
+
+
+/* Worth rewriting: two or more extents with at least one break on disk. */
+static int
+diskfs_defrag_window_broken(const struct diskfs_defrag_op *op)
+{
+    int i;
+
+    for (i = 1; i < op->next; i++) {
+        if (op->ext[i].device_id != op->ext[i - 1].device_id ||
+            op->ext[i].device_offset !=
+            op->ext[i - 1].device_offset + op->ext[i - 1].length) {
+            return 1;
+        }
+    }
+    return 0;
+} /* diskfs_defrag_window_broken */
+
+
+static void
+diskfs_defrag_walk_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv)
+{
+    struct diskfs_defrag_op *op = priv;
+    struct diskfs_extent     e;
+    int                      have;
+
+    have = diskfs_ext_from_op(bop, result, &e);
+    diskfs_bt_op_free(op->thread, bop);
+    op->scanned++;
+
+    if (have && diskfs_defrag_fits(op, &e)) {
+        diskfs_defrag_append(op, &e);
+        diskfs_defrag_walk(op, e.file_offset + e.length);
+        return;
+    }
+
+    /* The window closes here. */
+    if (diskfs_defrag_window_broken(op)) {
+        op->cursor = op->win_start + op->win_len;
+        diskfs_defrag_alloc(op->thread, op);
+        return;
+    }
+
+    if (!have) {
+        /* End of the extent map: the file is done; let the write path
+         * queue it again if it fragments anew. */
+        op->inode->defrag_queued = 0;
+        op->inode->frag_breaks   = 0;
+        diskfs_txn_abort(op->txn);
+        diskfs_defrag_file_finish(op);
+        return;
+    }
+
+    /* Nothing to gain so far; `e` may open the next window. */
+    op->next    = 0;
+    op->nchunks = 0;
+    if (diskfs_defrag_fits(op, &e)) {
+        diskfs_defrag_append(op, &e);
+    }
+    diskfs_defrag_walk(op, e.file_offset + e.length);
+} /* diskfs_defrag_walk_cb */
+
+
+/* Draw one exact, contiguous run for the window (resumable on SM_AGAIN). */
+static void
+diskfs_defrag_alloc(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    struct diskfs_defrag_op *op     = arg;
+    struct diskfs_defrag    *df     = op->df;
+    struct space_map        *sm     = thread->shared->space_map;
+    struct evpl             *evpl   = thread->evpl;
+    uint32_t                 role   = space_map_has_remote(sm) ? SM_DEV_REMOTE : SM_DEV_LOCAL;
+    uint64_t                 off, len;
+    struct diskfs_extent    *e;
+    int                      rc, i;
+
+    DISKFS_SM_JNL(jnl, thread, op->txn, diskfs_defrag_alloc, op);
+    rc = space_map_alloc_volatile_reservation(sm, &op->resv, &jnl, role,
+                                              op->win_len, 0, SM_DEVICE_ANY,
+                                              &op->new_dev, &op->new_off);
+
+    if (rc == SM_AGAIN) {
+        return;                 /* parked; re-driven here */
+    }
+
+    if (rc != 0) {
+        /* No contiguous run this large: leave the file as it is. */
+        diskfs_defrag_count(df, thread, DISKFS_METRIC_DEFRAG_ERRORS, 1);
+        op->inode->defrag_queued = 0;
+        diskfs_txn_abort(op->txn);
+        diskfs_defrag_file_finish(op);
+        return;
+    }
+
+    /* Read the window into chunk buffers; the same buffers are then written
+     * at their offsets in the new run. */
+    op->niov     = 0;
+    op->io_error = 0;
+    op->pending  = op->nchunks;
+
+    for (i = 0; i < op->next; i++) {
+        e = &op->ext[i];
+
+        for (off = 0; off < e->length; off += len) {
+            len = e->length - off < df->chunk ? e->length - off : df->chunk;
+
+            evpl_iovec_alloc(evpl, len, DISKFS_BLOCK_SIZE, 1, 0, &op->iov[op->niov]);
+            op->iov_off[op->niov]     = e->file_offset - op->win_start + off;
+            op->iov_src_dev[op->niov] = e->device_id;
+            op->iov_src_off[op->niov] = e->device_offset + off;
+
+            diskfs_metric_block_io(thread, DISKFS_METRIC_IO_READ,
+                                   DISKFS_METRIC_IO_DATA, len);
+            diskfs_metric_block_io_device(thread, e->device_id,
+                                          DISKFS_METRIC_IO_READ,
+                                          DISKFS_METRIC_IO_DATA, len);
+            evpl_block_read(evpl, thread->queue[e->device_id], &op->iov[op->niov], 1,
+                            e->device_offset + off, diskfs_defrag_read_cb, op);
+            op->niov++;
+        }
+    }
+} /* diskfs_defrag_alloc */
+
+
+static void
+diskfs_defrag_read_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct diskfs_defrag_op *op     = private_data;
+    struct diskfs_thread    *thread = op->thread;
+
+    if (status) {
+        op->io_error = 1;
+    }
+    if (--op->pending) {
+        return;
+    }
+
+    if (op->io_error) {
+        diskfs_defrag_write_cb(evpl, 0, op);  /* pending is 0: unwind */
+        return;
+    }
+
+    op->checked = 0;
+    diskfs_defrag_verify(thread, op);
+} /* diskfs_defrag_read_cb */
+
+
+/* The window has been read: check each chunk against its data checksums
+ * (a check parked on a table block re-enters here, at op->checked) so a
+ * corrupt block is not copied and re-checksummed as good, then write the
+ * chunks at their offsets in the new run. */
+static void
+diskfs_defrag_verify(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    struct diskfs_defrag_op *op   = arg;
+    struct evpl             *evpl = thread->evpl;
+    int                      i, rc;
+
+    for (; op->checked < op->niov; op->checked++) {
+        i  = op->checked;
+        rc = diskfs_csum_verify(thread, op->iov_src_dev[i], op->iov_src_off[i],
+                                (uint32_t) (op->iov[i].length >> SM_BLOCK_SHIFT),
+                                &op->iov[i], 1, 0, diskfs_defrag_verify, op);
+        if (rc == SM_AGAIN) {
+            return;
+        }
+        if (rc) {
+            op->io_error = 1;
+            diskfs_defrag_write_cb(evpl, 0, op);  /* pending is 0: unwind */
+            return;
+        }
+    }
+
+    op->pending = op->niov;
+    for (i = 0; i < op->niov; i++) {
+        diskfs_csum_note(thread, op->txn, op->new_dev, op->new_off + op->iov_off[i],
+                         &op->iov[i], 1, op->iov[i].length & ~(uint64_t) SM_BLOCK_MASK);
+        diskfs_metric_block_io(thread, DISKFS_METRIC_IO_WRITE,
+                               DISKFS_METRIC_IO_DATA, op->iov[i].length);
+        diskfs_metric_block_io_device(thread, op->new_dev,
+                                      DISKFS_METRIC_IO_WRITE,
+                                      DISKFS_METRIC_IO_DATA, op->iov[i].length);
+        evpl_block_write(evpl, thread->queue[op->new_dev], &op->iov[i], 1,
+                         op->new_off + op->iov_off[i],
+                         !thread->shared->unsafe_async,
+                         diskfs_defrag_write_cb, op);
+    }
+} /* diskfs_defrag_verify */
+
+
+static void
+diskfs_defrag_write_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct diskfs_defrag_op *op = private_data;
+    int                      i;
+
+    if (status) {
+        op->io_error = 1;
+    }
+    if (op->pending && --op->pending) {
+        return;
+    }
+
+    for (i = 0; i < op->niov; i++) {
+        evpl_iovec_release(evpl, &op->iov[i]);
+    }
+    op->niov = 0;
+
+    if (op->io_error) {
+        /* Keep the old map; commit just the return of the new run (an
+         * abort would leave its allocation applied in memory). */
+        diskfs_defrag_count(op->df, op->thread, DISKFS_METRIC_DEFRAG_ERRORS, 1);
+        op->failed = 1;
+        diskfs_thread_free_space(op->thread, op->txn, op->new_dev, op->new_off,
+                                 SM_ALIGN_UP(op->win_len));
+        diskfs_txn_commit(op->txn, diskfs_defrag_committed_cb, op);
+        return;
+    }
+
+    op->idx = 0;
+    diskfs_defrag_swap_step(op);
+} /* diskfs_defrag_write_cb */
+
+
+/* New copy durable: drop the window's records (freeing their old ranges),
+ * insert the single replacement, commit. */
+static void
+diskfs_defrag_swap_step(struct diskfs_defrag_op *op)
+{
+    struct diskfs_bt_op *bop = diskfs_bt_op_alloc(op->thread);
+    struct diskfs_bt_key key;
+
+    if (op->idx < op->next) {
+        key = diskfs_extent_key(op->ext[op->idx].file_offset);
+        if (diskfs_bt_remove_async(bop, op->thread, op->txn, op->inode, &key,
+                                   diskfs_defrag_removed_cb, op)) {
+            diskfs_defrag_removed_cb(bop, bop->result, op);
+        }
+        return;
+    }
+
+    if (diskfs_ext_insert_async(bop, op->thread, op->txn, op->inode,
+                                op->win_start, op->win_len,
+                                op->new_dev, op->new_off, 0,
+                                diskfs_defrag_inserted_cb, op)) {
+        diskfs_defrag_inserted_cb(bop, bop->result, op);
+    }
+} /* diskfs_defrag_swap_step */
+
+
+static void
+diskfs_defrag_removed_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv)
+{
+    struct diskfs_defrag_op *op = priv;
+    struct diskfs_extent    *e  = &op->ext[op->idx];
+
+    (void) result;
+    diskfs_bt_op_free(op->thread, bop);
+
+    diskfs_thread_free_space(op->thread, op->txn, e->device_id, e->device_offset,
+                             SM_ALIGN_UP(e->length));
+    op->idx++;
+    diskfs_defrag_swap_step(op);
+} /* diskfs_defrag_removed_cb */
+
+
+static void
+diskfs_defrag_inserted_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv)
+{
+    struct diskfs_defrag_op *op = priv;
+
+    (void) result;
+    diskfs_bt_op_free(op->thread, bop);
+    diskfs_txn_commit(op->txn, diskfs_defrag_committed_cb, op);
+} /* diskfs_defrag_inserted_cb */
+
+
+static void
+diskfs_defrag_committed_cb(
+    struct diskfs_txn *txn,
+    int                status,
+    void              *priv)
+{
+    struct diskfs_defrag_op *op = priv;
+    struct diskfs_defrag    *df = op->df;
+
+    (void) txn;
+    (void) status;
+
+    /* Charged whether or not the window stuck: the I/O was spent. */
+    df->tokens -= op->win_len;
+
+    if (!op->failed) {
+        op->moved = 1;
+        diskfs_defrag_count(df, op->thread, DISKFS_METRIC_DEFRAG_WINDOWS, 1);
+        diskfs_defrag_count(df, op->thread, DISKFS_METRIC_DEFRAG_EXTENTS_REMOVED,
+                            op->next - 1);
+        diskfs_defrag_count(df, op->thread, DISKFS_METRIC_DEFRAG_BYTES_MOVED,
+                            op->win_len);
+    }
+
+    diskfs_defrag_yield(op);
+} /* diskfs_defrag_committed_cb */
+
+
+/* Between windows (no txn, no lock): continue now or on a later tick. */
+static void
+diskfs_defrag_yield(struct diskfs_defrag_op *op)
+{
+    op->parked = 1;
+    if (!op->df->in_run) {
+        diskfs_defrag_run(op->df);
+    }
+} /* diskfs_defrag_yield */
+
+
+static void
+diskfs_defrag_file_finish(struct diskfs_defrag_op *op)
+{
+    struct diskfs_defrag *df = op->df;
+
+    diskfs_defrag_count(df, op->thread, DISKFS_METRIC_DEFRAG_SCANNED, 1);
+    if (op->moved) {
+        diskfs_defrag_count(df, op->thread, DISKFS_METRIC_DEFRAG_DEFRAGMENTED, 1);
+    }
+
+    df->op = NULL;
+    free(op);
+
+    if (!df->in_run) {
+        diskfs_defrag_run(df);
+    }
+} /* diskfs_defrag_file_finish */
+
+
+/* chimera_job ops: called from the REST thread under the registry lock. */
+static void
+diskfs_defrag_job_set_enabled(
+    struct chimera_job *job,
+    int                 enabled)
+{
+    __atomic_store_n(&job->enabled, enabled, __ATOMIC_RELAXED);
+} /* diskfs_defrag_job_set_enabled */
+
+
+static void
+diskfs_defrag_job_set_rate(
+    struct chimera_job *job,
+    uint64_t            bytes_per_sec)
+{
+    __atomic_store_n(&job->rate, bytes_per_sec, __ATOMIC_RELAXED);
+} /* diskfs_defrag_job_set_rate */
+
+
+static void
+diskfs_defrag_job_start(struct chimera_job *job)
+{
+    struct diskfs_defrag *df = job->private_data;
+
+    __atomic_store_n(&df->kick, 1, __ATOMIC_RELAXED);
+} /* diskfs_defrag_job_start */
+
+
+static const struct chimera_job_ops diskfs_defrag_job_ops = {
+    .set_enabled = diskfs_defrag_job_set_enabled,
+    .set_rate    = diskfs_defrag_job_set_rate,
+    .start       = diskfs_defrag_job_start,
+};
+
+
+void
+diskfs_defrag_create(struct diskfs_shared *shared)
+{
+    struct diskfs_defrag *df;
+    int                   i;
+
+    /* pNFS block/SCSI clients read and write the extents they were handed
+     * directly; moving data underneath a layout would corrupt it. */
+    if (shared->block_layout || shared->scsi_layout) {
+        chimera_diskfs_info("Online defragmentation disabled: pNFS block layouts in use");
+        return;
+    }
+
+    df           = calloc(1, sizeof(*df));
+    df->shared   = shared;
+    df->ring     = calloc(DISKFS_DEFRAG_QUEUE_MAX, sizeof(*df->ring));
+    df->busy_pct = shared->defrag_busy_pct;
+    pthread_mutex_init(&df->lock, NULL);
+
+    df->chunk = UINT64_MAX;
+    for (i = 0; i < shared->num_devices; i++) {
+        if (shared->devices[i].max_request_size < df->chunk) {
+            df->chunk = shared->devices[i].max_request_size;
+        }
+    }
+    df->chunk &= ~((uint64_t) DISKFS_BLOCK_SIZE - 1);
+    if (df->chunk < DISKFS_BLOCK_SIZE) {
+        df->chunk = DISKFS_BLOCK_SIZE;
+    }
+
+    snprintf(df->job.name, sizeof(df->job.name), "diskfs_defrag");
+    df->job.ops          = &diskfs_defrag_job_ops;
+    df->job.private_data = df;
+    df->job.enabled      = shared->defrag_enabled;
+    df->job.rate         = shared->defrag_rate;
+    df->job.ncounters    = DISKFS_METRIC_DEFRAG_NUM;
+    for (i = 0; i < DISKFS_METRIC_DEFRAG_NUM; i++) {
+        df->job.counter_names[i] = diskfs_defrag_counter_names[i];
+    }
+    chimera_job_register(&df->job);
+
+    shared->defrag = df;
+} /* diskfs_defrag_create */
+
+
+void
+diskfs_defrag_destroy(struct diskfs_shared *shared)
+{
+    struct diskfs_defrag *df = shared->defrag;
+
+    if (!df) {
+        return;
+    }
+    chimera_job_unregister(&df->job);
+    pthread_mutex_destroy(&df->lock);
+    free(df->ring);
+    free(df);
+    shared->defrag = NULL;
+} /* diskfs_defrag_destroy */
+
+
+void
+diskfs_defrag_thread_init(struct diskfs_reclaim_worker *w)
+{
+    struct diskfs_defrag *df = w->shared->defrag;
+
+    df->fg_busy_ns  = 0;
+    df->fg_total_ns = 0;
+    diskfs_defrag_sample_load(df);   /* baseline */
+    evpl_add_timer(w->ctx->evpl, &df->timer, diskfs_defrag_tick,
+                   DISKFS_DEFRAG_TICK_US);
+    df->armed = 1;
+} /* diskfs_defrag_thread_init */
+
+
+/* Let the window in flight commit, then drop the pass; the file is simply
+ * picked up again when it next fragments. */
+void
+diskfs_defrag_thread_shutdown(struct diskfs_reclaim_worker *w)
+{
+    struct diskfs_defrag *df = w->shared->defrag;
+
+    df->stopping = 1;
+    while (df->op && !df->op->parked) {
+        evpl_continue(w->ctx->evpl);
+    }
+    free(df->op);
+    df->op = NULL;
+
+    if (df->armed) {
+        evpl_remove_timer(w->ctx->evpl, &df->timer);
+        df->armed = 0;
+    }
+    __atomic_store_n(&df->job.running, 0, __ATOMIC_RELAXED);
+} /* diskfs_defrag_thread_shutdown */
@@ -0,0 +1,428 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Discard (TRIM/UNMAP) of freed space: the per-AG queues that durable frees
+ * feed, and the rate-limited pass that claims each run out of the space map,
+ * discards it on its device and releases it (see the design note in
+ * diskfs_internal.h).  Runs on the last reclaim worker, driven by a timer.
+ */
+
+#include "diskfs_internal.h"
+
+/* Forward declarations (definitions below, in call-graph order) */
+
+static void
+diskfs_discard_run(
+    struct diskfs_discard *dc);
+
+static void
+diskfs_discard_io_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data);
+
+
+const char *diskfs_discard_counter_names[DISKFS_METRIC_DISCARD_NUM] = {
+    "queued",
+    "issued",
+    "bytes",
+    "skipped",
+    "dropped",
+    "throttled",
+    "errors",
+};
+
+
+/* One discard in flight; the range stays claimed until it completes. */
+struct diskfs_discard_io {
+    struct diskfs_discard *dc;
+    uint32_t               device_id;
+    uint64_t               offset;
+    uint64_t               length;
+};
+
+
+static inline void
+diskfs_discard_count(
+    struct diskfs_discard        *dc,
+    enum diskfs_metric_discard_op op,
+    uint64_t                      n)
+{
+    chimera_job_counter_add(&dc->job, op, n);
+    diskfs_metric_discard(dc->worker->ctx, op, n);
+} /* diskfs_discard_count */
+
+
+/*
+ * Queue a freed range for discard.  Called from diskfs_txn_apply_frees on an
+ * intent-log thread once the free is durable and applied.  The range is cut
+ * to whole blocks as the space map freed it, then merged with an adjacent
+ * queued run of the same AG; if the AG has no room left it is not queued
+ * (the space is already free, it just is not trimmed).
+ */
+void
+diskfs_discard_queue(
+    struct diskfs_shared *shared,
+    uint32_t              device_id,
+    uint64_t              device_offset,
+    uint64_t              length)
+{
+    struct diskfs_discard    *dc = shared->discard;
+    struct diskfs_discard_ag *ag;
+    uint64_t                  start, end;
+    uint32_t                  ag_index;
+    int                       i;
+
+    if (!dc || !__atomic_load_n(&dc->job.enabled, __ATOMIC_RELAXED) ||
+        shared->devices[device_id].role != SM_DEV_LOCAL) {
+        return;
+    }
+
+    start = SM_ALIGN_UP(device_offset);
+    end   = (device_offset + length) & ~(uint64_t) SM_BLOCK_MASK;
+    if (end <= start) {
+        return;
+    }
+    ag_index = (uint32_t) (start >> SM_AG_SIZE_LOG2);
+
+    pthread_mutex_lock(&dc->lock);
+
+    if (dc->stopping) {
+        pthread_mutex_unlock(&dc->lock);
+        return;
+    }
+
+    ag = dc->ags[device_id][ag_index];
+    if (!ag) {
+        ag                           = calloc(1, sizeof(*ag));
+        ag->device_id                = device_id;
+        dc->ags[device_id][ag_index] = ag;
+    }
+
+    for (i = 0; i < ag->nranges; i++) {
+        struct diskfs_discard_range *r = &ag->ranges[i];
+
+        if (r->offset + r->length == start) {
+            r->length += end - start;
+            break;
+        }
+        if (end == r->offset) {
+            r->offset  = start;
+            r->length += end - start;
+            break;
+        }
+    }
+
+    if (i == ag->nranges) {
+        if (ag->nranges == DISKFS_DISCARD_AG_RANGES) {
+            dc->dropped += end - start;
+            pthread_mutex_unlock(&dc->lock);
+            return;
+        }
+        ag->ranges[ag->nranges].offset = start;
+        ag->ranges[ag->nranges].length = end - start;
+        ag->nranges++;
+    }
+
+    if (!ag->dirty) {
+        ag->dirty = 1;
+        ag->stamp = __atomic_load_n(&dc->now, __ATOMIC_RELAXED);
+        ag->next  = NULL;
+        if (dc->dirty_tail) {
+            dc->dirty_tail->next = ag;
+        } else {
+            dc->dirty_head = ag;
+        }
+        dc->dirty_tail = ag;
+    }
+
+    pthread_mutex_unlock(&dc->lock);
+} /* diskfs_discard_queue */
+
+
+/*
+ * Take the next run that is due: the oldest dirty AG's last queued range,
+ * once the AG has gathered for DISKFS_DISCARD_DELAY_TICKS (or at once when
+ * flushing).  The dirty list is in queue order, so if its head is not due
+ * nothing is.  Returns 0 if there is nothing to issue.
+ */
+static int
+diskfs_discard_pop(
+    struct diskfs_discard *dc,
+    int                    flush,
+    uint32_t              *r_device_id,
+    uint64_t              *r_offset,
+    uint64_t              *r_length)
+{
+    struct diskfs_discard_ag *ag;
+    int                       found = 0;
+
+    pthread_mutex_lock(&dc->lock);
+
+    ag = dc->dirty_head;
+    if (ag && (flush || __atomic_load_n(&dc->now, __ATOMIC_RELAXED) - ag->stamp >=
+               DISKFS_DISCARD_DELAY_TICKS)) {
+        ag->nranges--;
+        *r_device_id = ag->device_id;
+        *r_offset    = ag->ranges[ag->nranges].offset;
+        *r_length    = ag->ranges[ag->nranges].length;
+        found        = 1;
+
+        if (ag->nranges == 0) {
+            ag->dirty      = 0;
+            dc->dirty_head = ag->next;
+            if (!dc->dirty_head) {
+                dc->dirty_tail = NULL;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&dc->lock);
+    return found;
+} /* diskfs_discard_pop */
+
+
+static void
+diskfs_discard_tick(
+    struct evpl       *evpl,
+    struct evpl_timer *timer)
+{
+    struct diskfs_discard *dc   = container_of(timer, struct diskfs_discard, timer);
+    uint64_t               rate = __atomic_load_n(&dc->job.rate, __ATOMIC_RELAXED);
+    uint64_t               dropped;
+
+    (void) evpl;
+
+    __atomic_add_fetch(&dc->now, 1, __ATOMIC_RELAXED);
+
+    /* Refill the byte budget, holding at most one second's worth.  A run
+     * may start on any positive balance and drive it negative, so the rate
+     * holds on average even for runs larger than a second's budget. */
+    if (rate) {
+        dc->tokens += rate * DISKFS_DISCARD_TICK_US / 1000000;
+        if (dc->tokens > (int64_t) rate) {
+            dc->tokens = rate;
+        }
+    }
+
+    pthread_mutex_lock(&dc->lock);
+    dropped     = dc->dropped;
+    dc->dropped = 0;
+    pthread_mutex_unlock(&dc->lock);
+    if (dropped) {
+        diskfs_discard_count(dc, DISKFS_METRIC_DISCARD_DROPPED, dropped);
+    }
+
+    diskfs_discard_run(dc);
+} /* diskfs_discard_tick */
+
+
+/*
+ * Issue due runs while the budget and the in-flight cap allow.  Each run is
+ * claimed out of the space map first so nothing can allocate (and write) it
+ * while the discard is outstanding.
+ */
+static void
+diskfs_discard_run(struct diskfs_discard *dc)
+{
+    struct diskfs_thread     *thread = dc->worker->ctx;
+    struct diskfs_shared     *shared = dc->shared;
+    struct diskfs_discard_io *io;
+    uint64_t                  rate = __atomic_load_n(&dc->job.rate, __ATOMIC_RELAXED);
+    uint64_t                  offset, length;
+    uint32_t                  device_id;
+    int                       flush, pending;
+
+    flush = __atomic_exchange_n(&dc->kick, 0, __ATOMIC_RELAXED);
+
+    while (dc->inflight < DISKFS_DISCARD_QDEPTH) {
+        if (rate && dc->tokens <= 0) {
+            pthread_mutex_lock(&dc->lock);
+            pending = dc->dirty_head != NULL;
+            pthread_mutex_unlock(&dc->lock);
+            if (pending) {
+                diskfs_discard_count(dc, DISKFS_METRIC_DISCARD_THROTTLED, 1);
+            }
+            break;
+        }
+        if (!diskfs_discard_pop(dc, flush, &device_id, &offset, &length)) {
+            break;
+        }
+        diskfs_discard_count(dc, DISKFS_METRIC_DISCARD_QUEUED, length);
+
+        if (length < DISKFS_DISCARD_MIN ||
+            space_map_discard_claim(shared->space_map, device_id, offset, length) != 0) {
+            diskfs_discard_count(dc, DISKFS_METRIC_DISCARD_SKIPPED, length);
+            continue;
+        }
+
+        io            = calloc(1, sizeof(*io));
+        io->dc        = dc;
+        io->device_id = device_id;
+        io->offset    = offset;
+        io->length    = length;
+
+        dc->tokens -= length;
+        dc->inflight++;
+        __atomic_store_n(&dc->job.running, 1, __ATOMIC_RELAXED);
+        diskfs_discard_count(dc, DISKFS_METRIC_DISCARD_ISSUED, 1);
+
+        evpl_block_discard(thread->evpl, thread->queue[device_id], offset, length,
+                           diskfs_discard_io_cb, io);
+    }
+} /* diskfs_discard_run */
+
+
+static void
+diskfs_discard_io_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct diskfs_discard_io *io = private_data;
+    struct diskfs_discard    *dc = io->dc;
+
+    (void) evpl;
+
+    /* A failed discard leaves the data in place, which is harmless: the
+     * range is free either way. */
+    if (status) {
+        diskfs_discard_count(dc, DISKFS_METRIC_DISCARD_ERRORS, 1);
+    } else {
+        diskfs_discard_count(dc, DISKFS_METRIC_DISCARD_BYTES, io->length);
+    }
+
+    space_map_discard_release(dc->shared->space_map, io->device_id,
+                              io->offset, io->length);
+    free(io);
+
+    if (--dc->inflight == 0) {
+        __atomic_store_n(&dc->job.running, 0, __ATOMIC_RELAXED);
+    }
+} /* diskfs_discard_io_cb */
+
+
+/* chimera_job ops: called from the REST thread under the registry lock. */
+static void
+diskfs_discard_job_set_enabled(
+    struct chimera_job *job,
+    int                 enabled)
+{
+    __atomic_store_n(&job->enabled, enabled, __ATOMIC_RELAXED);
+} /* diskfs_discard_job_set_enabled */
+
+
+static void
+diskfs_discard_job_set_rate(
+    struct chimera_job *job,
+    uint64_t            bytes_per_sec)
+{
+    __atomic_store_n(&job->rate, bytes_per_sec, __ATOMIC_RELAXED);
+} /* diskfs_discard_job_set_rate */
+
+
+static void
+diskfs_discard_job_start(struct chimera_job *job)
+{
+    struct diskfs_discard *dc = job->private_data;
+
+    __atomic_store_n(&dc->kick, 1, __ATOMIC_RELAXED);
+} /* diskfs_discard_job_start */
+
+
+static const struct chimera_job_ops diskfs_discard_job_ops = {
+    .set_enabled = diskfs_discard_job_set_enabled,
+    .set_rate    = diskfs_discard_job_set_rate,
+    .start       = diskfs_discard_job_start,
+};
+
+
+void
+diskfs_discard_create(struct diskfs_shared *shared)
+{
+    struct space_map      *sm = shared->space_map;
+    struct diskfs_discard *dc;
+    uint32_t               i;
+
+    dc         = calloc(1, sizeof(*dc));
+    dc->shared = shared;
+    dc->ags    = calloc(sm->num_devices, sizeof(*dc->ags));
+    for (i = 0; i < sm->num_devices; i++) {
+        dc->ags[i] = calloc(sm->devices[i].num_ags, sizeof(*dc->ags[i]));
+    }
+    pthread_mutex_init(&dc->lock, NULL);
+
+    snprintf(dc->job.name, sizeof(dc->job.name), "diskfs_discard");
+    dc->job.ops          = &diskfs_discard_job_ops;
+    dc->job.private_data = dc;
+    dc->job.enabled      = shared->discard_enabled;
+    dc->job.rate         = shared->discard_rate;
+    dc->job.ncounters    = DISKFS_METRIC_DISCARD_NUM;
+    for (i = 0; i < DISKFS_METRIC_DISCARD_NUM; i++) {
+        dc->job.counter_names[i] = diskfs_discard_counter_names[i];
+    }
+    chimera_job_register(&dc->job);
+
+    shared->discard = dc;
+} /* diskfs_discard_create */
+
+
+void
+diskfs_discard_destroy(struct diskfs_shared *shared)
+{
+    struct diskfs_discard *dc = shared->discard;
+    uint32_t               i, j;
+
+    if (!dc) {
+        return;
+    }
+    chimera_job_unregister(&dc->job);
+    for (i = 0; i < shared->space_map->num_devices; i++) {
+        for (j = 0; j < shared->space_map->devices[i].num_ags; j++) {
+            free(dc->ags[i][j]);
+        }
+        free(dc->ags[i]);
+    }
+    free(dc->ags);
+    pthread_mutex_destroy(&dc->lock);
+    free(dc);
+    shared->discard = NULL;
+} /* diskfs_discard_destroy */
+
+
+void
+diskfs_discard_thread_init(struct diskfs_reclaim_worker *w)
+{
+    struct diskfs_discard *dc = w->shared->discard;
+
+    evpl_add_timer(w->ctx->evpl, &dc->timer, diskfs_discard_tick,
+                   DISKFS_DISCARD_TICK_US);
+    dc->armed = 1;
+} /* diskfs_discard_thread_init */
+
+
+/* Stop queuing, let the discards in flight complete (returning their claimed
+ * ranges to the space map before it is persisted) and drop the rest: the
+ * space is already free, only the trim is lost. */
+void
+diskfs_discard_thread_shutdown(struct diskfs_reclaim_worker *w)
+{
+    struct diskfs_discard *dc = w->shared->discard;
+
+    pthread_mutex_lock(&dc->lock);
+    dc->stopping   = 1;
+    dc->dirty_head = NULL;
+    dc->dirty_tail = NULL;
+    pthread_mutex_unlock(&dc->lock);
+
+    if (dc->armed) {
+        evpl_remove_timer(w->ctx->evpl, &dc->timer);
+        dc->armed = 0;
+    }
+
+    while (dc->inflight) {
+        evpl_continue(w->ctx->evpl);
+    }
+} /* diskfs_discard_thread_shutdown */
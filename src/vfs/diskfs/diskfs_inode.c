@@ -3,7 +3,7 @@
 // SPDX-License-Identifier: LGPL-2.1-only
 
 /*
- * Inode cache: sharded rb-trees of in-memory inodes, logical read/write
+ * Inode cache: sharded RCU hashes of in-memory inodes, logical read/write
  * transaction locks (grant/waiter machinery), LRU and recycling, deferred
  * mtime flushing, and the inode-generation epoch that makes inum reuse safe
  * against stale file handles.
@@ -161,7 +161,7 @@ diskfs_inode_release_one(
     struct diskfs_inode_waiter *granted = NULL;
     struct diskfs_inode_waiter *w;
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
 
     if (mode == DISKFS_INODE_LOCK_WRITE) {
         inode->writer = 0;
@@ -225,7 +225,7 @@ diskfs_inode_release_one(
 /*
  * Grant (or enqueue a waiter for) `inode` with the shard lock already held, and
  * release the lock before returning.  Shared by diskfs_inode_acquire (after the
- * rb-tree lookup) and diskfs_inode_acquire_pinned (lookup skipped because an
+ * hash lookup) and diskfs_inode_acquire_pinned (lookup skipped because an
  * open handle pins the inode).  On a compatible WRITE grant this pins the home
  * block, which may async-load it and defer the callback.  `gen` is recorded on
  * a parked waiter so a later grant can detect a stale generation.
@@ -324,14 +324,17 @@ diskfs_inode_acquire(
     }
 
     shard = diskfs_inode_shard(thread->shared, inum);
-    pthread_mutex_lock(&shard->lock);
 
-    rb_tree_query_exact(&shard->inodes, inum, inum, inode);
+    /* The lookup itself is lock-free; the shard lock is only taken to grant
+     * on a hit, since lock state, waiters and refcnt all live under it. */
+ retry:
+    rcu_read_lock();
+    inode = diskfs_inode_cache_lookup(shard, inum);
 
-    if (unlikely(inode && inode->gen != gen)) {
+    if (unlikely(inode && __atomic_load_n(&inode->gen, __ATOMIC_RELAXED) != gen)) {
         /* Cached under a different generation: the handle is stale. */
+        rcu_read_unlock();
         diskfs_metric_inode_cache(thread, DISKFS_METRIC_INODE_CACHE_STALE);
-        pthread_mutex_unlock(&shard->lock);
         cb(NULL, CHIMERA_VFS_ENOENT, private_data);
         return;
     }
@@ -342,9 +345,10 @@ diskfs_inode_acquire(
          * whenever the inum is within allocated space; the on-disk dinode read
          * validates inum/gen/nlink and yields ENOENT if it isn't really there.
          * (This must not gate on `mounted` -- a freshly-formatted FS evicts
-         * too, so a miss is not necessarily ENOENT.) */
+         * too, so a miss is not necessarily ENOENT.)  A racing fault of the
+         * same inum is resolved at install time in diskfs_inode_load. */
+        rcu_read_unlock();
         diskfs_metric_inode_cache(thread, DISKFS_METRIC_INODE_CACHE_MISS);
-        pthread_mutex_unlock(&shard->lock);
         if (sm_inum_valid(thread->shared->space_map, inum)) {
             diskfs_inode_load(thread, txn, inum, gen, mode, cb, private_data);
         } else {
@@ -353,6 +357,15 @@ diskfs_inode_acquire(
         return;
     }
 
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
+    rcu_read_unlock();
+
+    if (unlikely(!inode->hashed)) {
+        /* Recycled or retired between the lookup and the lock. */
+        pthread_mutex_unlock(&shard->lock);
+        goto retry;
+    }
+
     diskfs_inode_grant_locked(thread, txn, shard, inode, gen, mode, cb, private_data);
 } /* diskfs_inode_acquire */
 
@@ -361,7 +374,7 @@ diskfs_inode_acquire(
  * Acquire the inode lock on an inode already pinned by an open handle (its
  * refcnt was bumped in diskfs_open_fh_inode_cb, so it is resident and will not
  * be freed; gen bumps only on free).  This skips the fh->inum decode and the
- * inode-cache rb-tree lookup -- the hot per-I/O cost on a warm handle -- but
+ * inode-cache hash lookup -- the hot per-I/O cost on a warm handle -- but
  * still takes the shard lock to serialize the lock-state grant against the
  * concurrent release/completion path.
  */
@@ -387,7 +400,7 @@ diskfs_inode_acquire_pinned(
     }
 
     shard = diskfs_inode_shard(thread->shared, inode->inum);
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
     diskfs_inode_grant_locked(thread, txn, shard, inode, inode->gen, mode, cb,
                               private_data);
 } /* diskfs_inode_acquire_pinned */
@@ -416,8 +429,8 @@ diskfs_inode_load_sync(
 
     /* Already resident (e.g. a freshly-bootstrapped root/orphan inode, or a
      * prior fault): return it without touching disk. */
-    pthread_mutex_lock(&shard->lock);
-    rb_tree_query_exact(&shard->inodes, inum, inum, inode);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
+    inode = diskfs_inode_cache_lookup(shard, inum);
     if (inode) {
         int ok = (inode->gen == gen && (inode->nlink != 0 || allow_orphan));
 
@@ -440,8 +453,8 @@ diskfs_inode_load_sync(
         return NULL;
     }
 
-    pthread_mutex_lock(&shard->lock);
-    rb_tree_query_exact(&shard->inodes, inum, inum, inode);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
+    inode = diskfs_inode_cache_lookup(shard, inum);
     if (!inode) {
         created = 1;
         diskfs_inode_cache_recycle_locked(shared, shard);
@@ -467,15 +480,16 @@ diskfs_inode_load_sync(
         inode->dos_attributes = di->dos_attributes;
         inode->parent_inum    = di->parent_inum;
         inode->parent_gen     = di->parent_gen;
-        rb_tree_insert(&shard->inodes, inum, inode);
-        shard->ninodes++;
+        inode->extsize        = di->extsize;
+        inode->flags          = di->flags;
+        diskfs_inode_cache_link_locked(shard, inode);
         diskfs_metric_inode_cache(thread, DISKFS_METRIC_INODE_CACHE_LOAD);
     }
     pthread_mutex_unlock(&shard->lock);
 
-    /* Mirror the singleton ACL/pNFS records onto the freshly-constructed
-     * inode (the runtime fault path does the same through the async b+tree
-     * ops), walking the on-disk tree through the pump. */
+    /* Mirror the singleton ACL/pNFS/inline-data records onto the
+     * freshly-constructed inode (the runtime fault path does the same through
+     * the async b+tree ops), walking the on-disk tree through the pump. */
     if (created) {
         uint8_t rec[DISKFS_ACL_REC_MAX];
         int     len;
@@ -493,6 +507,17 @@ diskfs_inode_load_sync(
             memcpy(inode->pnfs_blob, rec, len);
             inode->pnfs_blob_len = (uint32_t) len;
         }
+
+        if (S_ISREG(inode->mode) && inode->size > 0 &&
+            inode->size <= DISKFS_INLINE_DATA_MAX) {
+            len = diskfs_bt_lookup_pump(shared, io, buf, &diskfs_inline_key,
+                                        rec, DISKFS_INLINE_DATA_MAX);
+            if (len >= 0) {
+                inode->inline_data = malloc(len ? len : 1);
+                memcpy(inode->inline_data, rec, len);
+                inode->inline_len = (uint32_t) len;
+            }
+        }
     }
 
     /* Seed the inode's home block into the block cache from the disk image we
@@ -791,7 +816,7 @@ diskfs_mtime_flush_pick(struct diskfs_thread *thread)
         }
 
         shard = &shared->inode_cache->shards[s];
-        pthread_mutex_lock(&shard->lock);
+        chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
         if (shard->mdirty_head &&
             (thread->mtime_flush_all ||
              now_ns - shard->mdirty_head->mtime_dirty_since >= period_ns)) {
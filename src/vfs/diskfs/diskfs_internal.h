@@ -48,6 +48,8 @@
 
 #include "common/rbtree.h"
 
+#include "common/checksum.h"
+
 
 #include "slab_allocator.h"
 
@@ -76,6 +78,9 @@
 #include "common/misc.h"
 
 #include "common/evpl_iovec_cursor.h"
+#include "common/lock_profile.h"
+#include "common/thread_stats.h"
+#include "common/job_registry.h"
 
 
 #ifndef container_of
@@ -86,10 +91,13 @@
 #endif /* ifndef container_of */
 
 
-/* Inode cache: sharded rb-tree keyed by inum. */
-#define DISKFS_INODE_CACHE_SHARDS 256
+/* Inode cache: sharded RCU hash keyed by inum. */
+#define DISKFS_INODE_CACHE_SHARDS      256
+
+#define DISKFS_INODE_CACHE_MASK        (DISKFS_INODE_CACHE_SHARDS - 1)
 
-#define DISKFS_INODE_CACHE_MASK   (DISKFS_INODE_CACHE_SHARDS - 1)
+/* Per-shard hash buckets: sized to the shard cap, never resized. */
+#define DISKFS_INODE_CACHE_BUCKETS_MIN 64
 
 
 /* Statically-reserved inums (block_idx in AG 0 / disk 0; see space_map.c).
@@ -114,12 +122,27 @@
         (DISKFS_ORPHAN_INUM_BASE + ((inum) % DISKFS_ORPHAN_SHARDS))
 
 
+/* Snapshot directory (filesystems formatted with snapshots only): the
+ * read-only directory holding one entry per snapshot, in the bootstrap
+ * block after the orphan shards.  Not linked into the live tree; reached by
+ * mounting the ".snapshot" path (see diskfs_snapshot.c). */
+#define DISKFS_SNAP_INUM          (DISKFS_ORPHAN_INUM_BASE + DISKFS_ORPHAN_SHARDS)
+
+#define DISKFS_SNAP_GEN           1   /* permanent: created at format, never deleted */
+
+
 /* Max inodes a single transaction can hold locked at once.  rename needs
  * 5 (two parents, child, replaced target, plus the orphan-list shard when
  * the replace deletes the target); others (e.g. readdir) touch many but
  * only 2 at a time and release as they go. */
 #define DISKFS_TXN_MAX_INODES     5
 
+/* Readdir child-inode prefetch: default window of entries loaded ahead of
+ * the emit cursor (config readdir_prefetch), and the per-thread cap on
+ * prefetch loads outstanding across all walks. */
+#define DISKFS_READDIR_PREFETCH_DEFAULT 32
+#define DISKFS_INODE_PREFETCH_MAX       256
+
 
 /* Diskfs RMW writes assemble:
  *   prefix (valid + zero) + request write iovecs +
@@ -187,6 +210,63 @@ struct diskfs_extent {
 };
 
 
+/* Device-read fills one read can carry (one per issued chunk). */
+#define DISKFS_DCACHE_MAX_FILLS 16
+
+
+/* Extents (compression units) one compressed write can produce; each unit
+ * is at most one device request, so this also bounds its write slices. */
+#define DISKFS_COMPRESS_MAX_UNITS 64
+
+
+/* A device read's data-cache span: `length` bytes (whole blocks) at
+ * device_offset, landing at buf_offset in the read's VFS buffers. */
+struct diskfs_dcache_fill {
+    uint64_t device_offset;
+    uint64_t token;
+    uint32_t device_id;
+    uint32_t buf_offset;
+    uint32_t length;
+};
+
+
+/* Stripe locks serializing access to the entries of a data checksum table
+ * block (diskfs_csum.c), by block address. */
+#define DISKFS_CSUM_LOCKS     64
+
+
+/* Stripe locks serializing access to the entries of an extent reference
+ * table block (diskfs_snapshot.c), by block address. */
+#define DISKFS_REF_LOCKS      64
+
+
+/* Checksum verification of a read (diskfs_read_verify): `nblocks` whole
+ * blocks at device_offset that landed at buf_offset in the VFS buffers. */
+#define DISKFS_CSUM_MAX_SPANS 16
+
+struct diskfs_csum_span {
+    uint64_t device_offset;
+    uint32_t device_id;
+    uint32_t buf_offset;
+    uint32_t nblocks;
+};
+
+
+/* A partial block at either end of a checksummed read's chunk, read aside
+ * whole so it can be verified; `length` bytes from `skip` are copied to
+ * buf_offset in the VFS buffers once it is. */
+#define DISKFS_CSUM_MAX_EDGES 4
+
+struct diskfs_csum_edge {
+    struct evpl_iovec iov;
+    uint64_t          device_offset;
+    uint32_t          device_id;
+    uint32_t          buf_offset;
+    uint32_t          skip;
+    uint32_t          length;
+};
+
+
 struct diskfs_request_private {
     int                         opcode;
     int                         status;
@@ -235,6 +315,15 @@ struct diskfs_request_private {
     int                         rd_looping;
     int                         rd_advance;
     int                         rd_done;
+    /* readdir prefetch cursor (see diskfs_readdir_prefetch): next hash it
+     * examines, entries it is ahead of the emit cursor, a dirent lookup in
+     * flight, end of directory seen, and finish deferred until it lands. */
+    uint64_t                    rd_pf_hash;
+    uint32_t                    rd_pf_ahead;
+    int                         rd_pf_busy;
+    int                         rd_pf_eof;
+    int                         rd_pf_finish;
+    char                        rd_pf_rec[320];
 
     /* Scratch buffer for handlers that parse a looked-up b+tree record
      * (e.g. a dirent's inum/gen) in their async continuation.  Sized to hold
@@ -256,6 +345,18 @@ struct diskfs_request_private {
     uint64_t                    loop_pos;
     int                         loop_have;
     uint64_t                    alloc_cap;   /* ALLOCATE: adaptive per-chunk cap */
+    /* Data-cache reservations of this read's device chunks, filled from the
+     * VFS buffers once every chunk has landed. */
+    struct diskfs_dcache_fill   rd_fill[DISKFS_DCACHE_MAX_FILLS];
+    int                         rd_nfill;
+    /* Data checksums: the read's whole-block spans and edge blocks, checked
+     * before the fill; rd_vnext is the next one to check (spans first), so
+     * a check parked on a cold table block resumes where it stopped. */
+    struct diskfs_csum_span     rd_verify[DISKFS_CSUM_MAX_SPANS];
+    struct diskfs_csum_edge     rd_edge[DISKFS_CSUM_MAX_EDGES];
+    int                         rd_nverify;
+    int                         rd_nedge;
+    int                         rd_vnext;
 
     struct evpl_iovec           iov[66];
 
@@ -281,8 +382,12 @@ struct diskfs_request_private {
      * range (in-place overwrite, extent map untouched): the only inode change
      * is the mtime/ctime bump, so a non-FILE_SYNC write can defer it. */
     int                         inplace_written;
+    /* Set when this write first promoted an inline file to an extent: the map
+     * changed, so the in-place overwrite that follows must not defer. */
+    int                         inline_promoted;
     uint64_t                    prefix_device_id, prefix_device_offset;
     uint64_t                    suffix_device_id, suffix_device_offset;
+    int                         rmw_checked; /* prefix/suffix blocks verified */
 
     /* Coalescing-insert descriptor (diskfs_ext_put): the extent to record,
      * merged with a contiguous predecessor when possible; ci_cont runs after. */
@@ -290,6 +395,25 @@ struct diskfs_request_private {
     uint32_t                    ci_devid, ci_flags;
     void                        (*ci_cont)(
         struct chimera_vfs_request *);
+
+    /* Compressed redirect write (diskfs_write_compress): the encoded units
+     * staged back to back in zc_iov (zc_phys bytes), each unit's extent flags,
+     * and the unit / device offset diskfs_write_zc_put records next.
+     * zc_checked keeps an allocation retry from encoding twice. */
+    struct evpl_iovec           zc_iov;
+    uint64_t                    zc_phys;
+    uint64_t                    zc_devoff;
+    uint32_t                    zc_nunits;
+    uint32_t                    zc_next;
+    int                         zc_checked;
+    uint32_t                    zc_flags[DISKFS_COMPRESS_MAX_UNITS];
+    /* Inflate of the compressed extent in ext_iter (diskfs_inflate_start):
+     * the blob / its raw copy, the raw copy's new home, and where to resume. */
+    struct evpl_iovec           zi_iov;
+    uint64_t                    zi_devoff;
+    uint32_t                    zi_devid;
+    void                        (*zi_cont)(
+        struct chimera_vfs_request *);
 };
 
 
@@ -305,6 +429,7 @@ struct diskfs_device {
      * device's storage lives outside this system: diskfs allocates space on it
      * and hands the layout to the block client but never opens or touches it. */
     uint32_t                  role;             /* SM_DEV_LOCAL | SM_DEV_REMOTE */
+    uint32_t                  weight;           /* placement share among its role (config) */
     uint8_t                   deviceid[SM_DEVICEID_SIZE];
     uint64_t                  sig_offset;
     uint32_t                  sig_len;
@@ -372,6 +497,7 @@ enum diskfs_metric_inode_cache_op {
     DISKFS_METRIC_INODE_CACHE_LOAD,
     DISKFS_METRIC_INODE_CACHE_INSERT,
     DISKFS_METRIC_INODE_CACHE_WAIT,
+    DISKFS_METRIC_INODE_CACHE_PREFETCH,
     DISKFS_METRIC_INODE_CACHE_NUM,
 };
 
@@ -383,10 +509,23 @@ enum diskfs_metric_block_cache_op {
     DISKFS_METRIC_BLOCK_CACHE_WAIT,
     DISKFS_METRIC_BLOCK_CACHE_COW,
     DISKFS_METRIC_BLOCK_CACHE_RECYCLE,
+    DISKFS_METRIC_BLOCK_CACHE_GHOST_HIT,   /* miss on a recently recycled cold block */
+    DISKFS_METRIC_BLOCK_CACHE_HOT_RECYCLE, /* recycle taken from the hot list */
     DISKFS_METRIC_BLOCK_CACHE_NUM,
 };
 
 
+enum diskfs_metric_dcache_op {
+    DISKFS_METRIC_DCACHE_HIT,         /* block served from the data cache */
+    DISKFS_METRIC_DCACHE_MISS,        /* block read from the device */
+    DISKFS_METRIC_DCACHE_INSERT,      /* block filled after a device read */
+    DISKFS_METRIC_DCACHE_PROMOTE,     /* probation -> protected on a re-hit */
+    DISKFS_METRIC_DCACHE_EVICT,       /* block recycled for a new reservation */
+    DISKFS_METRIC_DCACHE_INVALIDATE,  /* block dropped by a write or free */
+    DISKFS_METRIC_DCACHE_NUM,
+};
+
+
 /* Deferred-mtime accounting: did a write defer its inode timestamp log, and if
  * not, which gate stopped it.  flushed = coalesced flush records issued. */
 enum diskfs_metric_mtime_op {
@@ -428,6 +567,106 @@ enum diskfs_metric_txn_phase {
 };
 
 
+/* Mount-time crash recovery: counts and per-phase wall time of the last
+ * replay (diskfs_recover_log).  Reported as gauges; zero after a clean mount. */
+enum diskfs_metric_recovery {
+    DISKFS_METRIC_RECOVERY_THREADS,
+    DISKFS_METRIC_RECOVERY_LOG_BYTES,
+    DISKFS_METRIC_RECOVERY_RECORDS,
+    DISKFS_METRIC_RECOVERY_BLOCKS,        /* block entries in intact records */
+    DISKFS_METRIC_RECOVERY_HOME_WRITES,   /* distinct home blocks written */
+    DISKFS_METRIC_RECOVERY_HOME_READS,    /* blocks read home to apply deltas */
+    DISKFS_METRIC_RECOVERY_READ_NS,       /* log reads (overlap the scan) */
+    DISKFS_METRIC_RECOVERY_SCAN_NS,       /* streamed read, probe, verify, gather */
+    DISKFS_METRIC_RECOVERY_BUILD_NS,      /* delta application to replay set */
+    DISKFS_METRIC_RECOVERY_REPLAY_NS,     /* home reads, writes and flush */
+    DISKFS_METRIC_RECOVERY_TOTAL_NS,
+    DISKFS_METRIC_RECOVERY_NUM,
+};
+
+
+/* Online defragmentation progress (also the REST job counters, same order). */
+enum diskfs_metric_defrag_op {
+    DISKFS_METRIC_DEFRAG_QUEUED,          /* file queued by the write path */
+    DISKFS_METRIC_DEFRAG_SCANNED,         /* file pass finished */
+    DISKFS_METRIC_DEFRAG_DEFRAGMENTED,    /* file pass that moved data */
+    DISKFS_METRIC_DEFRAG_WINDOWS,         /* extent runs rewritten */
+    DISKFS_METRIC_DEFRAG_EXTENTS_REMOVED, /* extent records merged away */
+    DISKFS_METRIC_DEFRAG_BYTES_MOVED,     /* data bytes copied */
+    DISKFS_METRIC_DEFRAG_THROTTLED,       /* ticks skipped for foreground load */
+    DISKFS_METRIC_DEFRAG_ERRORS,          /* runs abandoned (ENOSPC, I/O error) */
+    DISKFS_METRIC_DEFRAG_NUM,
+};
+
+
+/* Discard pipeline progress, in bytes except ISSUED, THROTTLED and ERRORS
+ * (also the REST job counters, same order). */
+enum diskfs_metric_discard_op {
+    DISKFS_METRIC_DISCARD_QUEUED,    /* freed bytes taken off the AG queues */
+    DISKFS_METRIC_DISCARD_ISSUED,    /* discard requests sent to a device */
+    DISKFS_METRIC_DISCARD_BYTES,     /* bytes discarded */
+    DISKFS_METRIC_DISCARD_SKIPPED,   /* short runs, or reused before issue */
+    DISKFS_METRIC_DISCARD_DROPPED,   /* never queued: AG queue full */
+    DISKFS_METRIC_DISCARD_THROTTLED, /* ticks that stopped on the rate cap */
+    DISKFS_METRIC_DISCARD_ERRORS,    /* discards the device failed */
+    DISKFS_METRIC_DISCARD_NUM,
+};
+
+
+/* Data compression, in bytes for BYTES_IN / BYTES_OUT, units otherwise. */
+enum diskfs_metric_compress_op {
+    DISKFS_METRIC_COMPRESS_BYTES_IN,     /* logical bytes offered to the codec */
+    DISKFS_METRIC_COMPRESS_BYTES_OUT,    /* device bytes they were stored in */
+    DISKFS_METRIC_COMPRESS_COMPRESSED,   /* units stored compressed */
+    DISKFS_METRIC_COMPRESS_RAW,          /* units stored raw (failed the sample or saved no block) */
+    DISKFS_METRIC_COMPRESS_DECOMPRESSED, /* blobs decoded */
+    DISKFS_METRIC_COMPRESS_INFLATED,     /* extents rewritten raw ahead of a partial edit */
+    DISKFS_METRIC_COMPRESS_ERRORS,       /* corrupt blobs, failed inflates */
+    DISKFS_METRIC_COMPRESS_NUM,
+};
+
+
+/* Data checksums, in blocks except SCRUBBED (bytes); PASSES onwards are the
+ * scrub's (also the REST job counters, same order). */
+enum diskfs_metric_csum_op {
+    DISKFS_METRIC_CSUM_VERIFIED,   /* blocks read that matched their checksum */
+    DISKFS_METRIC_CSUM_UNVERIFIED, /* blocks read with no checksum recorded */
+    DISKFS_METRIC_CSUM_FAILURES,   /* blocks that did not match */
+    DISKFS_METRIC_CSUM_SCRUBBED,   /* bytes the scrub read back */
+    DISKFS_METRIC_CSUM_PASSES,     /* scrub passes completed */
+    DISKFS_METRIC_CSUM_THROTTLED,  /* scrub ticks that stopped on the rate cap */
+    DISKFS_METRIC_CSUM_ERRORS,     /* scrub reads the device failed */
+    DISKFS_METRIC_CSUM_NUM,
+};
+
+
+/* Snapshot creation, in bytes for BYTES_SHARED (also the REST job counters,
+ * same order). */
+enum diskfs_metric_snap_op {
+    DISKFS_METRIC_SNAP_CREATED,      /* snapshots published */
+    DISKFS_METRIC_SNAP_INODES,       /* inodes cloned */
+    DISKFS_METRIC_SNAP_EXTENTS,      /* extent records shared */
+    DISKFS_METRIC_SNAP_BYTES_SHARED, /* device bytes those extents cover */
+    DISKFS_METRIC_SNAP_ERRORS,       /* creations abandoned (name taken, ENOSPC) */
+    DISKFS_METRIC_SNAP_NUM,
+};
+
+
+/* Per-inode b+trees.  levels / descents is the mean depth, fanout /
+ * (levels - descents) the mean interior fanout, leaf_items / descents the
+ * mean records per leaf reached. */
+enum diskfs_metric_btree_op {
+    DISKFS_METRIC_BTREE_DESCENTS,      /* descents that reached a leaf */
+    DISKFS_METRIC_BTREE_LEVELS,        /* nodes those descents visited */
+    DISKFS_METRIC_BTREE_FANOUT,        /* children of the interior nodes visited */
+    DISKFS_METRIC_BTREE_LEAF_ITEMS,    /* records in the leaves reached */
+    DISKFS_METRIC_BTREE_SPLITS,        /* leaf splits */
+    DISKFS_METRIC_BTREE_APPEND_SPLITS, /* of which right-edge appends left the lower leaf full */
+    DISKFS_METRIC_BTREE_REENCODED,     /* full leaves re-encoded or repacked instead of split */
+    DISKFS_METRIC_BTREE_NUM,
+};
+
+
 struct diskfs_metrics {
     struct prometheus_metrics          *metrics;
     int                                 num_devices;
@@ -435,6 +674,8 @@ struct diskfs_metrics {
     struct prometheus_counter_series   *inode_cache_series[DISKFS_METRIC_INODE_CACHE_NUM];
     struct prometheus_counter          *block_cache;
     struct prometheus_counter_series   *block_cache_series[DISKFS_METRIC_BLOCK_CACHE_NUM];
+    struct prometheus_counter          *dcache;
+    struct prometheus_counter_series   *dcache_series[DISKFS_METRIC_DCACHE_NUM];
     struct prometheus_counter          *mtime;
     struct prometheus_counter_series   *mtime_series[DISKFS_METRIC_MTIME_NUM];
     struct prometheus_counter          *block_io_ops;
@@ -446,33 +687,58 @@ struct diskfs_metrics {
     struct prometheus_counter          *block_io_device_bytes;
     struct prometheus_counter_series  **block_io_device_bytes_series;
     struct prometheus_counter          *txn;
-    struct prometheus_counter_series   *txn_series[3];
+    struct prometheus_counter_series   *txn_series[5];
     struct prometheus_histogram        *txn_blocks;
     struct prometheus_histogram_series *txn_blocks_series;
     struct prometheus_histogram        *txn_bytes;
     struct prometheus_histogram_series *txn_bytes_series;
     struct prometheus_histogram        *txn_latency;
     struct prometheus_histogram_series *txn_latency_series[DISKFS_METRIC_TXN_NUM_PHASES];
+    struct prometheus_histogram        *group_commit_txns;
+    struct prometheus_histogram_series *group_commit_txns_series;
+    struct prometheus_histogram        *group_commit_wait;
+    struct prometheus_histogram_series *group_commit_wait_series;
     struct prometheus_gauge            *pending_io;
     struct prometheus_gauge_series     *pending_io_series;
     struct prometheus_gauge            *intent_log;
     struct prometheus_gauge_series     *intent_log_series[9];
+    struct prometheus_gauge            *recovery;
+    struct prometheus_gauge_series     *recovery_series[DISKFS_METRIC_RECOVERY_NUM];
+    struct prometheus_counter          *defrag;
+    struct prometheus_counter_series   *defrag_series[DISKFS_METRIC_DEFRAG_NUM];
+    struct prometheus_counter          *discard;
+    struct prometheus_counter_series   *discard_series[DISKFS_METRIC_DISCARD_NUM];
+    struct prometheus_counter          *compress;
+    struct prometheus_counter_series   *compress_series[DISKFS_METRIC_COMPRESS_NUM];
+    struct prometheus_counter          *csum;
+    struct prometheus_counter_series   *csum_series[DISKFS_METRIC_CSUM_NUM];
+    struct prometheus_counter          *snap;
+    struct prometheus_counter_series   *snap_series[DISKFS_METRIC_SNAP_NUM];
+    struct prometheus_counter          *btree;
+    struct prometheus_counter_series   *btree_series[DISKFS_METRIC_BTREE_NUM];
 };
 
 
 struct diskfs_thread_metrics {
     struct prometheus_counter_instance   *inode_cache[DISKFS_METRIC_INODE_CACHE_NUM];
     struct prometheus_counter_instance   *block_cache[DISKFS_METRIC_BLOCK_CACHE_NUM];
+    struct prometheus_counter_instance   *dcache[DISKFS_METRIC_DCACHE_NUM];
     struct prometheus_counter_instance   *mtime[DISKFS_METRIC_MTIME_NUM];
     struct prometheus_counter_instance *block_io_ops[DISKFS_METRIC_IO_NUM_DIRS][DISKFS_METRIC_IO_NUM_CLASSES];
     struct prometheus_counter_instance *block_io_bytes[DISKFS_METRIC_IO_NUM_DIRS][DISKFS_METRIC_IO_NUM_CLASSES];
     struct prometheus_counter_instance  **block_io_device_ops;
     struct prometheus_counter_instance  **block_io_device_bytes;
-    struct prometheus_counter_instance   *txn[3];
+    struct prometheus_counter_instance   *txn[5];
     struct prometheus_histogram_instance *txn_blocks;
     struct prometheus_histogram_instance *txn_bytes;
     struct prometheus_histogram_instance *txn_latency[DISKFS_METRIC_TXN_NUM_PHASES];
     struct prometheus_gauge_instance     *pending_io;
+    struct prometheus_counter_instance   *defrag[DISKFS_METRIC_DEFRAG_NUM];
+    struct prometheus_counter_instance   *discard[DISKFS_METRIC_DISCARD_NUM];
+    struct prometheus_counter_instance   *compress[DISKFS_METRIC_COMPRESS_NUM];
+    struct prometheus_counter_instance   *csum[DISKFS_METRIC_CSUM_NUM];
+    struct prometheus_counter_instance   *snap[DISKFS_METRIC_SNAP_NUM];
+    struct prometheus_counter_instance   *btree[DISKFS_METRIC_BTREE_NUM];
 };
 
 
@@ -482,6 +748,8 @@ struct diskfs_intent_log_metrics {
     struct prometheus_counter_instance  **block_io_device_ops;
     struct prometheus_counter_instance  **block_io_device_bytes;
     struct prometheus_histogram_instance *txn_latency[DISKFS_METRIC_TXN_NUM_PHASES];
+    struct prometheus_histogram_instance *group_commit_txns;
+    struct prometheus_histogram_instance *group_commit_wait;
     struct prometheus_gauge_instance     *redo_inflight;
     struct prometheus_gauge_instance     *iocbs_inflight;
     struct prometheus_gauge_instance     *push_outstanding;
@@ -551,10 +819,14 @@ struct diskfs_inode {
     uint32_t                    btime_nsec;
     uint32_t                    dos_attributes;
 
-    /* Inode-cache linkage, keyed by inum.  Lock state and the wait list
-     * below are protected by the owning shard's mutex, never held across
-     * a callback or I/O. */
-    struct rb_node              node;
+    /* Inode-cache linkage, keyed by inum.  The bucket chain is published
+     * with rcu_assign_pointer under the shard mutex and walked lock-free;
+     * an unhashed struct is freed only after a grace period.  Lock state
+     * and the wait list below are protected by the owning shard's mutex,
+     * never held across a callback or I/O. */
+    struct diskfs_inode        *hash_next;
+    struct rcu_head             rcu;
+    int                         hashed;      /* on a bucket chain */
     int                         readers;     /* shared-lock holders */
     int                         writer;      /* 0/1 exclusive holder */
     struct diskfs_inode_waiter *wait_head;
@@ -600,15 +872,36 @@ struct diskfs_inode {
     uint8_t                    *pnfs_blob;
     uint32_t                    pnfs_blob_len;
 
+    /* Regular file only: the contents of an inline file (the DISKFS_REC_INLINE
+     * record, mirrored like the ACL above), with inline_len == size.  NULL
+     * for an extent-mapped or empty file. */
+    uint8_t                    *inline_data;
+    uint32_t                    inline_len;
+
     /* Directory only: parent for ".." resolution (also persisted in dinode). */
     uint64_t                    parent_inum;
     uint32_t                    parent_gen;
+
+    /* Extent-size hint in bytes (0 = none; persisted in dinode).  On a file it
+     * sets the data reservation size; on a directory it is inherited by the
+     * files and directories created beneath it. */
+    uint64_t                    extsize;
+
+    /* DISKFS_INODE_F_* (persisted in dinode). */
+    uint32_t                    flags;
+
+    /* Online defragmentation (RAM only, under the inode write lock): writes
+     * that landed next to their file predecessor but not next to it on disk
+     * since the file was last queued, and whether it is queued now. */
+    uint32_t                    frag_breaks;
+    int                         defrag_queued;
 };
 
 
 struct diskfs_inode_shard {
     pthread_mutex_t      lock;
-    struct rb_tree       inodes;       /* keyed by inum */
+    struct diskfs_inode **buckets;     /* RCU chains, keyed by inum */
+    uint32_t             bucket_mask;
     struct diskfs_inode *lru_head, *lru_tail; /* idle (recycle) candidates, LRU-first */
     uint32_t             ninodes;      /* resident inodes in this shard */
     struct diskfs_inode *mdirty_head, *mdirty_tail; /* deferred-mtime queue (FIFO) */
@@ -643,6 +936,28 @@ struct diskfs_inode_cache {
 
 #define DISKFS_BLOCK_CACHE_BUCKET_MASK       (DISKFS_BLOCK_CACHE_BUCKETS_PER_SHARD - 1)
 
+/*
+ * Replacement is 2Q.  A block enters on the cold list; recycling takes the
+ * cold head while the cold list holds more than COLD_PCT of the shard (or the
+ * hot list is empty), otherwise the hot head.  A block recycled from the cold
+ * list leaves its key on a ghost ring sized GHOST_PCT of the shard; a miss
+ * that finds its key there was re-referenced after eviction and is admitted
+ * hot.  Interior b+tree nodes are admitted hot on first use.  A one-pass scan
+ * therefore only churns the cold list.
+ */
+#define DISKFS_BLOCK_CACHE_COLD_PCT          25
+
+#define DISKFS_BLOCK_CACHE_GHOST_PCT         50
+
+#define DISKFS_BLOCK_GHOST_NONE              UINT32_MAX
+
+
+enum diskfs_block_lru {
+    DISKFS_BLOCK_LRU_NONE,    /* pinned, dirty or logged: not a candidate */
+    DISKFS_BLOCK_LRU_COLD,
+    DISKFS_BLOCK_LRU_HOT,
+};
+
 
 enum diskfs_block_state {
     DISKFS_BLOCK_LOADING,  /* read I/O in flight; buffer not yet valid, ops wait */
@@ -681,10 +996,11 @@ struct diskfs_block_buf {
  * evpl_iovec so buffers are never shared across evpl instances.  All fields
  * (hash linkage, pin_count, state, LRU membership) are protected by the
  * owning shard lock.  A buffer is a recycle candidate exactly when it is CLEAN
- * and pin_count == 0, in which case it sits on the shard LRU (on_lru == 1);
- * recycling reuses the least-recently-used such buffer.  Buffers are drawn
- * from a pre-allocated fixed pool (shard->pool) -- a free, never-yet-keyed
- * buffer starts CLEAN on the LRU, not in any bucket.
+ * and pin_count == 0, in which case it sits on one of the shard's 2Q lists
+ * (on_lru names which); recycling reuses the least-recently-used candidate of
+ * the list the 2Q rule picks.  Buffers are drawn from a pre-allocated fixed
+ * pool (shard->pool) -- a free, never-yet-keyed buffer starts CLEAN on the
+ * cold list, not in any bucket.
  */
 struct diskfs_block {
     uint32_t                    device_id;
@@ -694,10 +1010,17 @@ struct diskfs_block {
     int                         pin_count;     /* >0 => pinned, not reclaimable */
     enum diskfs_block_state state;
     uint64_t                    seq;           /* update order for tail-push */
+    /* The image last handed to the intent log, kept when a writer COW-forks a
+     * LOGGED block (seq base_seq, durable by then) so the next snapshot can
+     * log a delta against it.  Consumed by that snapshot. */
+    struct diskfs_block_buf    *base;
+    uint64_t                    base_seq;
     struct diskfs_block        *hash_next;     /* bucket chain */
-    struct diskfs_block        *lru_prev, *lru_next; /* shard LRU (CLEAN + unpinned) */
+    struct diskfs_block        *lru_prev, *lru_next; /* shard 2Q list (CLEAN + unpinned) */
     struct diskfs_block        *clean_next;    /* atomic clean-return queue */
-    int                         on_lru;        /* 1 iff linked on the shard LRU */
+    int                         on_lru;        /* enum diskfs_block_lru: list linked on */
+    int                         hot;           /* joins the hot list when next unpinned */
+    int                         interior;      /* interior b+tree node (hint, set on descent) */
     int                         clean_queued;  /* 1 iff queued on shard clean queue */
 
     /* Continuations blocked on a LOADING block, woken when the read I/O
@@ -709,6 +1032,14 @@ struct diskfs_block {
 };
 
 
+struct diskfs_block_ghost {
+    uint64_t device_offset;
+    uint32_t device_id;
+    uint32_t next;             /* bucket chain (DISKFS_BLOCK_GHOST_NONE ends) */
+    int      valid;
+};
+
+
 struct diskfs_block_shard {
     pthread_mutex_t          lock;
     struct diskfs_block    **buckets;  /* [DISKFS_BLOCK_CACHE_BUCKETS_PER_SHARD] */
@@ -716,12 +1047,23 @@ struct diskfs_block_shard {
     /* Pre-allocated fixed pool of block structs (all protected by lock); the
      * structs are never individually freed.  Each struct's buffer is a SHARED
      * evpl iovec allocated lazily on first use and reused across recyclings
-     * (released only at teardown).  The LRU holds only CLEAN, unpinned buffers
-     * (recycle candidates), ordered least-recently-used first. */
+     * (released only at teardown).  The cold and hot lists hold only CLEAN,
+     * unpinned buffers (recycle candidates), each least-recently-used first. */
     struct diskfs_block     *pool;              /* [nblocks] */
-    struct diskfs_block     *lru_head, *lru_tail; /* lru_head = next to recycle */
+    struct diskfs_block     *cold_head, *cold_tail; /* cold_head = next cold victim */
+    struct diskfs_block     *hot_head, *hot_tail;
+    uint32_t                 ncold, nhot;       /* candidates on each list */
+    uint32_t                 cold_target;       /* recycle cold while ncold exceeds it */
     uint32_t                 nblocks;           /* block structs owned by this shard */
 
+    /* Ghost ring: keys of blocks recycled off the cold list, oldest
+     * overwritten first, with a chained index for lookup. */
+    struct diskfs_block_ghost *ghosts;          /* [nghosts] */
+    uint32_t                  *ghost_buckets;   /* [ghost_mask + 1] */
+    uint32_t                   nghosts;
+    uint32_t                   ghost_mask;
+    uint32_t                   ghost_next;      /* ring slot to overwrite next */
+
     struct diskfs_block_buf *buffers;           /* [nbuffers] */
     struct diskfs_block_buf *free_buffers;
     struct diskfs_block_buf *returned_buffers;   /* atomic stack, drained under lock */
@@ -758,6 +1100,87 @@ struct diskfs_block_cache {
                                                DISKFS_INTENT_LOG_BLOCKS(sz) / 2)
 
 
+/* ------------------------------------------------------------------ */
+/* Data cache                                                          */
+/* ------------------------------------------------------------------ */
+
+/*
+ * File-data read cache: 4 KiB device blocks keyed by (device, offset), held in
+ * a fixed pool of registered SHARED buffers with its own budget
+ * (data_cache_blocks).  Each shard is a segmented LRU: a block enters on the
+ * probation list and is promoted to the protected list on a second hit, so a
+ * one-pass scan only churns probation.  Writes and extent frees invalidate the
+ * blocks they touch; a fill races an invalidation through a per-reservation
+ * token (see diskfs_dcache_reserve).
+ */
+#define DISKFS_DCACHE_SHARDS               64
+
+#define DISKFS_DCACHE_SHARD_MASK           (DISKFS_DCACHE_SHARDS - 1)
+
+#define DISKFS_DCACHE_BUCKETS_PER_SHARD    1024
+
+#define DISKFS_DCACHE_BUCKET_MASK          (DISKFS_DCACHE_BUCKETS_PER_SHARD - 1)
+
+#define DISKFS_DCACHE_DEFAULT_BLOCKS       16384          /* 64 MiB */
+
+#define DISKFS_DCACHE_PROTECTED_PCT        75
+
+enum diskfs_dcache_state {
+    DISKFS_DCACHE_FREE,       /* on the free list, unkeyed */
+    DISKFS_DCACHE_PENDING,    /* reserved by an in-flight device read */
+    DISKFS_DCACHE_VALID,      /* buffer holds the block's current contents */
+};
+
+
+enum diskfs_dcache_queue {
+    DISKFS_DCACHE_Q_NONE,
+    DISKFS_DCACHE_Q_PROBATION,
+    DISKFS_DCACHE_Q_PROTECTED,
+};
+
+
+struct diskfs_dcache_entry {
+    struct diskfs_dcache_entry *hash_next;
+    struct diskfs_dcache_entry *prev, *next;   /* queue or free-list links */
+    uint64_t                    device_offset;
+    uint64_t                    token;         /* reservation that may fill it */
+    uint32_t                    device_id;
+    uint32_t                    refs;          /* copies in flight outside the lock */
+    uint8_t                     state;         /* enum diskfs_dcache_state */
+    uint8_t                     queue;         /* enum diskfs_dcache_queue */
+    uint8_t                     hashed;
+    struct evpl_iovec           iov;
+};
+
+
+/* One queue per segment, head = most recently used. */
+struct diskfs_dcache_list {
+    struct diskfs_dcache_entry *head, *tail;
+    uint32_t                    count;
+};
+
+
+struct diskfs_dcache_shard {
+    pthread_mutex_t             lock;
+    struct diskfs_dcache_entry **buckets;      /* [DISKFS_DCACHE_BUCKETS_PER_SHARD] */
+    struct diskfs_dcache_entry *pool;          /* [nentries] */
+    struct diskfs_dcache_entry *free_list;
+    struct diskfs_dcache_list   probation;
+    struct diskfs_dcache_list   protected;
+    uint32_t                    nentries;
+};
+
+
+struct diskfs_dcache {
+    uint32_t                   shard_cap;      /* buffers per shard */
+    uint32_t                   protected_cap;  /* protected-segment cap per shard */
+    uint64_t                   next_token;     /* atomic */
+    int                        buffers_ready;
+    pthread_mutex_t            prealloc_lock;
+    struct diskfs_dcache_shard shards[DISKFS_DCACHE_SHARDS];
+};
+
+
 /*
  * On-disk inode block layout (4 KiB):
  *   [0, DISKFS_INODE_AREA)   struct diskfs_dinode (scalar attributes)
@@ -797,9 +1220,17 @@ struct diskfs_dinode {
     uint32_t dos_attributes;
     uint64_t parent_inum;     /* directories only */
     uint32_t parent_gen;
+    uint64_t extsize;         /* extent-size hint, bytes (0 = none) */
+    uint32_t flags;           /* DISKFS_INODE_F_* */
 };
 
 
+/* dinode flags.  SNAPSHOT marks an inode of a snapshot tree (or the snapshot
+ * directory): its file handles carry the snapshot mount id, so the VFS routes
+ * them to a read-only mount, and reads leave its atime alone. */
+#define DISKFS_INODE_F_SNAPSHOT 0x1
+
+
 /* ------------------------------------------------------------------ */
 /* Per-inode b+tree (on-disk, slotted nodes)                           */
 /* ------------------------------------------------------------------ */
@@ -813,6 +1244,7 @@ enum diskfs_bt_rectype {
     DISKFS_REC_XATTR   = 5,
     DISKFS_REC_PNFS    = 6,   /* regular file: opaque pNFS layout blob (flex-files) */
     DISKFS_REC_ACL     = 7,   /* single record: serialized NFSv4/Windows ACL (subkey 0) */
+    DISKFS_REC_INLINE  = 8,   /* regular file: its bytes [0, size) held inline (subkey 0) */
 };
 
 
@@ -830,13 +1262,21 @@ struct diskfs_bt_key {
  * block).  level 0 == leaf.  Interior nodes hold a fixed array of
  * {key, child_bptr}; leaves hold a slot array of {key, off, len} plus a
  * record heap growing down from free_end.
+ *
+ * A leaf whose keys all share a type and the high bytes of their subkey may
+ * instead be compact (key_format != 0): the shared subkey prefix follows the
+ * header as one u64 (low bytes zero), and each slot is just the low
+ * DISKFS_BT_KFMT_WIDTH bytes of its subkey followed by the record's u16
+ * offset and length -- 8 bytes per extent slot rather than 24.  Slots stay a
+ * fixed stride, so the binary search is unchanged.  Only filesystems
+ * formatted with bt_compact write them (see diskfs_bt_leaf_fill).
  */
 struct diskfs_bt_node_hdr {
     uint16_t level;
     uint16_t nitems;
     uint32_t capacity;     /* usable node bytes (DISKFS_BT_ROOT_CAP or _NODE_CAP) */
     uint32_t free_end;     /* leaf heap top (records occupy [free_end, capacity)) */
-    uint32_t reserved;
+    uint32_t key_format;   /* leaf only: 0 = wide slots, else DISKFS_BT_KFMT() */
     uint64_t next_leaf;    /* leaf only: bptr of next leaf in key order (0 = none) */
     uint64_t prev_leaf;    /* leaf only: bptr of prev leaf in key order (0 = none) */
 };
@@ -855,6 +1295,13 @@ struct diskfs_bt_lslot {          /* leaf slot, 24 B */
 };
 
 
+/* Compact leaf key format: the common key type and the bytes of subkey each
+ * slot stores (1-8). */
+#define DISKFS_BT_KFMT(type, width) ((uint32_t) (type) | ((uint32_t) (width) << 8))
+#define DISKFS_BT_KFMT_TYPE(fmt)    ((uint8_t) ((fmt) & 0xff))
+#define DISKFS_BT_KFMT_WIDTH(fmt)   (((fmt) >> 8) & 0xff)
+
+
 /* Leaf record payloads (stored in the leaf heap). */
 struct diskfs_dirent_rec {
     uint64_t inum;
@@ -869,6 +1316,21 @@ struct diskfs_dirent_rec {
                                      *
                                      * written: reads return zeros, the first
                                      * write clears the bit */
+#define DISKFS_EXT_COMPRESSED 0x2u  /* the device range is one blob (diskfs_zhdr
+                                     * + payload) that decodes, whole, to the
+                                     * bytes from file_offset on; length is the
+                                     * logical size */
+#define DISKFS_EXT_ALGO_SHIFT 4     /* compressed: codec, DISKFS_COMPRESS_* */
+#define DISKFS_EXT_ALGO_MASK  0xf0u
+#define DISKFS_EXT_PBLK_SHIFT 16    /* compressed: blob size in 4 KiB blocks */
+
+
+/* Head of a compressed extent's blob: payload bytes after it, and the
+ * logical bytes they decode to. */
+struct diskfs_zhdr {
+    uint32_t csize;
+    uint32_t lsize;
+} __attribute__((packed));
 
 struct diskfs_extent_rec {
     uint64_t length;
@@ -910,27 +1372,46 @@ struct diskfs_xattr_rec {
         (((DISKFS_ACL_REC_MAX) -CHIMERA_ACL_SERIAL_HDR) / CHIMERA_ACL_SERIAL_ACE)
 
 
+/*
+ * Inline data: a regular file no larger than the share's inline_data_max keeps
+ * its whole contents as one DISKFS_REC_INLINE record instead of an extent and a
+ * 4 KiB data block, so it lives (with the rest of a small file's records) in
+ * the embedded root of its inode block and a read never touches a data block.
+ * Growing past the limit promotes it to an ordinary extent.  The cap stays
+ * below a full root record to leave room beside it for an ACL or xattrs.
+ */
+#define DISKFS_INLINE_DATA_MAX 3072
+
+
 /*
  * Intent-log redo record, written into the reserved intent-log region.
- * A record is a header followed by num_blocks (block-header, 4 KiB content)
- * pairs, padded to a 4 KiB multiple.  Full-block redo: the record carries
- * the entire post-image of every dirty block in the transaction.
+ * A record is a header region followed by one 4 KiB post-image per
+ * full-logged block, padded to a 4 KiB multiple.  A block whose change since
+ * its previous logged image is small is logged as a delta (the changed byte
+ * ranges) inside the header region instead of as a full image.
  */
 #define DISKFS_REDO_MAGIC 0x4F44455246534944ULL     /* "DISFREDO" */
 
 
 /*
  * Redo record on-log layout: this header, then num_blocks
- * {diskfs_redo_block_header, 4 KiB image} pairs, padded to a 4 KiB multiple.
+ * diskfs_redo_block_header, then the delta payload of every delta-logged
+ * block (in block-header order), padded to a 4 KiB multiple -- the header
+ * region -- followed by the 4 KiB image of every full-logged block (again in
+ * block-header order).  Full-logged blocks come first in the block-header
+ * array.
  *
  * `magic` is the scan signature and `csum_{lo,hi}` is an XXH3-128 over the
- * entire record (reclen bytes) computed with the csum fields zeroed.  Together
- * they let crash recovery locate intact records anywhere in the (possibly
- * wrapped) circular log: probe 4 KiB boundaries for the magic, then accept the
- * record only if the 128-bit hash over `reclen` bytes verifies -- a partially
- * overwritten or torn record fails and is skipped.  `seq` orders records
- * (latest image of a block wins) and `tail` is the log tail at write time, so
- * recovery bounds replay to [tail, head] from the highest-seq record.
+ * header region computed with the csum fields zeroed; it covers the delta
+ * payloads, and each full-logged block header carries the XXH3-128 of its
+ * image (SM_LOG_INCOMPAT_REDO_BLOCK_CSUM; older records hashed the whole
+ * record in csum_{lo,hi} instead).  Together they let crash recovery locate intact records anywhere in
+ * the (possibly wrapped) circular log: probe 4 KiB boundaries for the magic,
+ * then accept the record only if the header hash and every image hash verify
+ * -- a partially overwritten or torn record fails and is skipped.  `seq`
+ * orders records across every commit stream (latest image of a block wins)
+ * and `tail` is the log tail at write time, so recovery can bound replay to
+ * [tail, head] from the highest-seq record.
  */
 struct diskfs_redo_header {
     uint64_t magic;
@@ -945,13 +1426,31 @@ struct diskfs_redo_header {
 
 struct diskfs_redo_block_header {
     uint32_t device_id;
-    uint32_t pad;
+    uint32_t delta_len;    /* 0: full image; else delta payload bytes */
     uint64_t device_offset;
-    uint64_t block_csum_lo;
+    uint64_t block_csum_lo; /* full image only; 0 for a delta */
     uint64_t block_csum_hi;
 };
 
 
+/*
+ * Delta payload: a run of {diskfs_redo_delta, length bytes} extents, each the
+ * post-image of one changed byte range of the block.  A delta always holds at
+ * least one extent (a zero-length one when nothing changed), so delta_len is
+ * never 0.  It applies to the block's image as of its previous logged record,
+ * which the writer guarantees was durable before the delta was built: replay
+ * starts from the last full image of a block, or its home copy, and applies
+ * the deltas after it in seq order.
+ */
+struct diskfs_redo_delta {
+    uint16_t offset;
+    uint16_t length;
+};
+
+/* Default cap on a block's delta payload before it is logged as a full image. */
+#define DISKFS_REDO_DELTA_MAX_DEFAULT 1024
+
+
 enum diskfs_txn_type {
     DISKFS_TXN_READ,
     DISKFS_TXN_WRITE,
@@ -970,6 +1469,12 @@ struct diskfs_txn_block {
     struct diskfs_block_buf *snap_buf;
     uint64_t                 snap_csum_lo;
     uint64_t                 snap_csum_hi;
+    /* Delta payload against the block's previous logged image, built at
+     * snapshot time (NULL: log the full image).  Freed by the intent-log
+     * thread once copied into the record. */
+    void                    *delta;
+    uint32_t                 delta_len;
+    int                      journal;   /* space-map journal block: shared, never a delta */
     struct diskfs_txn_block *next;
 };
 
@@ -1000,6 +1505,10 @@ struct diskfs_txn_free {
     uint64_t                device_offset;
     uint64_t                length;
     int                     journaled; /* FREE delta written (pre-commit flush) */
+    int                     cleared;   /* data checksums zeroed (diskfs_csum_flush) */
+    int                     refchecked; /* shared blocks kept back (diskfs_ref_flush) */
+    int                     ref_split;  /* some block was shared: replaced by its runs */
+    uint64_t                ref_done;   /* blocks the reference pass has examined */
     struct diskfs_txn_free *next;
 };
 
@@ -1012,6 +1521,8 @@ struct diskfs_txn {
     int                      num_inodes;
     struct diskfs_txn_block *blocks;       /* dirty blocks pinned by this txn */
     struct diskfs_txn_free  *pending_frees; /* ranges freed, applied on commit */
+    struct diskfs_txn_csum  *pending_csums; /* data checksums, stored at commit */
+    struct diskfs_txn_ref   *pending_refs;  /* extent references taken, applied at commit */
 
     /* When the IL submission queue is full, the commit parks on its worker's
      * commit-wait FIFO (carrying its completion cb) instead of spinning the
@@ -1059,6 +1570,7 @@ struct diskfs_iq_channel {
     struct diskfs_iq_ring     cq;
     struct evpl_doorbell      cq_doorbell;
     struct diskfs_thread     *worker;
+    struct diskfs_il_stream  *stream;      /* commit stream this channel feeds */
 
     /* CQEs reserved for redo writes issued but not yet completed.  Owned by
      * the intent-log thread; bounds in-flight writes to available CQ space. */
@@ -1154,41 +1666,99 @@ struct diskfs_retire_slot {
 #define DISKFS_HANDOFF_RING_MASK (DISKFS_HANDOFF_RING_SIZE - 1)
 
 
+/*
+ * Intent-log commit streams.  Each stream is a commit thread with its own set
+ * of worker channels, block queue, retirement ring and hand-off ring, so redo
+ * records are assembled, checksummed and submitted on up to
+ * DISKFS_IL_MAX_STREAMS threads in parallel.  All streams share one log region
+ * and one sequence: a record's seq and offset are reserved together under
+ * place_lock, so the on-log order is the seq order and a superseding record
+ * always outlives the records it supersedes, exactly as with a single stream.
+ *
+ * Cross-stream ordering: a record is acknowledged only once every record with
+ * a lower seq is durable, whichever stream wrote it.  Completions publish their
+ * seq into the `durable` window and advance the shared frontier (durable_seq);
+ * the stream that advances it past another stream's record wakes that stream to
+ * retire it.  A transaction that touches inodes or AGs owned by other workers
+ * (rename, link, shared AG-log blocks) therefore needs no extra protocol: its
+ * record is ordered against every other by seq, acknowledged in seq order, and
+ * replayed in seq order by recovery.
+ */
+#define DISKFS_IL_MAX_STREAMS  16
+
+#define DISKFS_IL_SEQ_WINDOW   (DISKFS_IL_MAX_STREAMS * DISKFS_RETIRE_RING_SIZE)
+
+#define DISKFS_IL_SEQ_MASK     (DISKFS_IL_SEQ_WINDOW - 1)
+
+
+struct diskfs_intent_log;
+
+struct diskfs_il_stream {
+    struct diskfs_intent_log    *il;
+    int                          index;
+    struct evpl_doorbell         wake_doorbell;   /* workers, push trim and other streams ring this */
+    struct evpl                 *evpl;            /* commit thread evpl */
+    struct evpl_thread          *thread;          /* commit thread */
+    int                          ready;           /* atomic: commit thread up */
+    int                          alive;           /* wake_doorbell is live (under il->wake_lock); cleared once the thread has drained */
+    struct evpl_poll            *sq_poll;         /* polls all channel SQs every loop iteration */
+    int                          awake;           /* atomic (seq_cst): 1 while the commit thread is in poll mode (not blocked).  A submitter skips ringing wake_doorbell when this is set; see diskfs_iq_try_submit / diskfs_il_poll_exit. */
+    int                          reg_dirty;       /* atomic (seq_cst): a channel (un)registration is pending.  Set by workers after touching pending_head / unregister_requested; the commit thread's per-iteration poll services it without waiting for the wake doorbell (which is starved while we stay in continuous poll mode under load). */
+    uint32_t                     num_channels;
+    struct diskfs_iq_channel    *channels[DISKFS_IL_MAX_CHANNELS];
+    pthread_mutex_t              registration_lock;
+    struct diskfs_iq_channel    *pending_head;
+    struct evpl_block_queue     *log_queue;       /* redo writes -> intent-log device */
+    struct diskfs_retire_slot   *retire;          /* [DISKFS_RETIRE_RING_SIZE] */
+    uint64_t                     retire_head;     /* next slot to retire (in order) */
+    uint64_t                     retire_tail;     /* next submission index */
+    int                          redo_inflight;   /* redo block writes in flight (commit watermark) */
+    int                          group_holding;   /* a short batch is being held open (group commit) */
+    struct prometheus_stopwatch  group_hold;      /* when the held batch was first deferred */
+    struct chimera_thread_stats *stats;           /* commit thread utilisation; queue = SQ entries */
+    struct diskfs_intent_log_metrics metrics;     /* this thread's I/O + latency instances (no gauges) */
+
+    /* SPSC ring of durable record* (this stream -> push thread), seq order */
+    struct diskfs_il_record    **handoff;
+    uint32_t                     handoff_head;    /* atomic: push consumer */
+    uint32_t                     handoff_tail;    /* atomic: commit producer */
+};
+
+
 struct diskfs_intent_log {
-    /* ---------- commit thread ---------- */
-    struct evpl_doorbell             wake_doorbell;   /* workers + push-trim ring this */
-    struct evpl                     *evpl;            /* commit thread evpl */
-    struct evpl_thread              *thread;          /* commit thread */
-    int                              ready;           /* atomic: commit thread up */
+    /* ---------- commit streams ---------- */
+    struct diskfs_il_stream          streams[DISKFS_IL_MAX_STREAMS];
+    int                              num_streams;
     int                              shutdown;        /* atomic */
-    int                              commit_alive;    /* atomic: 1 while the commit thread's wake_doorbell is live; the push thread must not ring it once 0 (cleared before the commit thread is destroyed, which closes that fd) */
-    struct evpl_poll                *sq_poll;         /* polls all channel SQs every loop iteration */
-    int                              awake;           /* atomic (seq_cst): 1 while the commit thread is in poll mode (not blocked).  A submitter skips ringing wake_doorbell when this is set; see diskfs_iq_try_submit / diskfs_il_poll_exit. */
-    int                              reg_dirty;       /* atomic (seq_cst): a channel (un)registration is pending.  Set by workers after touching pending_head / unregister_requested; the commit thread's per-iteration poll services it without waiting for the wake doorbell (which is starved while we stay in continuous poll mode under load). */
-    uint32_t                         num_channels;
-    struct diskfs_iq_channel        *channels[DISKFS_IL_MAX_CHANNELS];
-    pthread_mutex_t                  registration_lock;
-    struct diskfs_iq_channel        *pending_head;
-    struct evpl_block_queue         *log_queue;       /* redo writes -> intent-log device */
-    uint64_t                         log_seq;         /* next redo seq (commit only) */
+    pthread_mutex_t                  wake_lock;       /* guards stream->alive against ringing a closed doorbell */
+    pthread_mutex_t                  place_lock;      /* log_head + log_seq reservation */
+    uint64_t                         log_seq;         /* next redo seq (under place_lock) */
+    /* Durable frontier: every record with seq < durable_seq is durable.
+     * durable[seq & mask] holds seq + 1 once that record's write completes
+     * (never cleared -- a stale slot simply does not match) and owner[] the
+     * stream that wrote it.  Records at or past the frontier are all still in
+     * some stream's retirement ring, so the window never laps. */
+    uint64_t                         durable_seq;     /* atomic */
+    uint64_t                        *durable;         /* [DISKFS_IL_SEQ_WINDOW] */
+    uint8_t                         *owner;           /* [DISKFS_IL_SEQ_WINDOW] */
     /* Records placed in the log and not yet trimmed past (atomic; incremented
-     * by the commit thread at placement, decremented by the push thread when
-     * the trim point passes the record).  Zero means the log is logically
-     * empty even when log_head != log_tail -- see the stale-trim-point reset
-     * in diskfs_iq_process_channel. */
+     * at placement, decremented by the push thread when the trim point passes
+     * the record).  Zero means the log is logically empty even when
+     * log_head != log_tail -- see the stale-trim-point reset in
+     * diskfs_il_reserve. */
     uint64_t                         live_records;
-    struct diskfs_retire_slot       *retire;          /* [DISKFS_RETIRE_RING_SIZE] */
-    uint64_t                         retire_head;     /* next slot to retire (in order) */
-    uint64_t                         retire_tail;     /* next submission index */
-    int                              redo_inflight;   /* redo block writes in flight (commit watermark) */
+    uint32_t                         num_channels;    /* atomic: channels registered across all streams */
+    int                              redo_inflight;   /* atomic: redo block writes in flight across all streams */
 
     /* ---------- push thread ---------- */
-    struct evpl_doorbell             push_doorbell;   /* commit rings after hand-off */
+    struct evpl_doorbell             push_doorbell;   /* streams ring after hand-off */
     struct evpl                     *push_evpl;
     struct evpl_thread              *push_thread;
     int                              push_ready;      /* atomic */
+    struct chimera_thread_stats     *push_stats;      /* push thread utilisation; queue = hand-offs */
     struct evpl_block_queue        **home_queue;      /* [num_devices] home writes */
-    struct diskfs_il_record         *push_head;       /* record FIFO (log order, for trim) */
+    uint64_t                         push_seq;        /* next seq to take from the streams' hand-off rings */
+    struct diskfs_il_record         *push_head;       /* record FIFO (seq == log order, for trim) */
     struct diskfs_il_record         *push_tail;
     struct diskfs_pending          **phash;           /* [phash_mask+1] (dev,off) buckets */
     uint32_t                         phash_mask;
@@ -1198,13 +1768,13 @@ struct diskfs_intent_log {
     int                              push_outstanding; /* home writes in flight (push watermark) */
 
     /* ---------- shared (cross-thread) ---------- */
-    struct diskfs_il_record        **handoff;         /* SPSC ring of record* (commit -> push) */
-    uint32_t                         handoff_head;    /* atomic: push consumer */
-    uint32_t                         handoff_tail;    /* atomic: commit producer */
-    uint64_t                         log_head;        /* atomic: commit-written (next free byte) */
+    uint64_t                         log_head;        /* atomic: next free byte (under place_lock) */
     uint64_t                         log_tail;        /* atomic: push-written (trim point) */
     uint64_t                         intent_log_size; /* active log size (from space_map / superblock) */
     int                              sync;            /* FUA/sync flag (0 in unsafe_async) */
+    int                              crash_test;      /* DISKFS_TEST_CRASH: never push home, unmount dirty */
+    uint64_t                         group_commit_ns; /* longest a short batch is held open (0 = off) */
+    uint32_t                         group_commit_txns; /* batch size issued without waiting */
 
     /* ---------- metrics ---------- */
     int                              redo_inflight_high_water;
@@ -1220,6 +1790,7 @@ struct diskfs_shared {
     int                         num_devices;
     struct diskfs_inode_cache  *inode_cache;
     struct diskfs_block_cache  *block_cache;
+    struct diskfs_dcache       *dcache;          /* NULL when data_cache_blocks is 0 */
     struct diskfs_kv_shard     *kv_shards;
     int                         num_kv_shards;
     int                         num_active_threads;
@@ -1234,7 +1805,13 @@ struct diskfs_shared {
     int                         mounted;           /* 1 = remounted existing FS (enables inode read-back) */
     uint64_t                    intent_log_size;   /* config knob (0 -> default at parse); persisted in the superblock */
     uint32_t                    block_cache_blocks; /* total resident block-buffer cap (0 = default) */
+    uint32_t                    data_cache_blocks;  /* data read cache size in 4 KiB blocks (0 = off) */
+    uint32_t                    redo_delta_max;     /* largest delta logged instead of a full image (0 = always full) */
+    uint32_t                    inline_data_max;    /* largest file kept inline in its inode block (0 = never) */
+    uint64_t                    prealloc_max;       /* largest size-scaled data reservation, bytes */
+    uint64_t                    stripe_chunk;       /* file data past this offset is striped over the data devices in units of it (0 = off) */
     uint32_t                    inode_cache_inodes; /* total resident inode cap (0 = default) */
+    uint32_t                    readdir_prefetch;   /* child inodes loaded ahead of readdir (0 = off) */
     int                         block_layout;      /* config opt-in: advertise pNFS block layouts */
     int                         scsi_layout;       /* config opt-in: advertise pNFS SCSI layouts  */
     uint64_t                    fsid;
@@ -1244,6 +1821,44 @@ struct diskfs_shared {
      * maintenance) runs here, off the request workers' hot path. */
     struct diskfs_reclaim      *reclaim;
     uint32_t                    reclaim_threads;   /* config knob (0 = default) */
+    uint32_t                    recovery_threads;  /* crash-recovery scan/build threads (0 = online CPUs) */
+    uint64_t                    recovery_window;   /* crash-recovery log read window, bytes */
+    /* Online defragmentation, run on reclaim worker 0 (NULL when pNFS
+     * block/SCSI layouts are enabled: clients address the extents directly). */
+    struct diskfs_defrag       *defrag;
+    int                         defrag_enabled;    /* config: schedule passes at startup */
+    uint64_t                    defrag_rate;       /* config: copy budget, bytes/s (0 = unlimited) */
+    uint32_t                    defrag_busy_pct;   /* config: pause above this foreground busy % */
+    /* Device discard of durably freed ranges, run on the last reclaim
+     * worker (see diskfs_discard.c). */
+    struct diskfs_discard      *discard;
+    int                         discard_enabled;   /* config: discard freed space */
+    uint64_t                    discard_rate;      /* config: discard budget, bytes/s (0 = unlimited) */
+    /* Transparent data compression (see diskfs_compress.c). */
+    uint32_t                    compress_algo;     /* config: DISKFS_COMPRESS_* (NONE = off) */
+    int                         compress_level;    /* config: zstd level */
+    uint32_t                    compress_unit;     /* config: logical bytes per compressed extent */
+    /* Data checksums (see diskfs_csum.c): fixed at format time; the scrub
+     * runs on a middle reclaim worker. */
+    int                         data_csum;         /* superblock: checksum tables present */
+    int                         data_csum_cfg;     /* config: format with data checksums */
+    struct diskfs_scrub        *scrub;
+    int                         scrub_enabled;     /* config: scrub continuously */
+    uint64_t                    scrub_rate;        /* config: scrub budget, bytes/s (0 = unlimited) */
+    pthread_mutex_t             csum_lock[DISKFS_CSUM_LOCKS];
+    /* Snapshots (see diskfs_snapshot.c): fixed at format time; the creation
+     * job runs on reclaim worker 0.  Snapshot inodes' file handles carry
+     * snap_fh's mount id instead of root_fh's. */
+    int                         snapshots;         /* superblock: reference tables present */
+    int                         snapshots_cfg;     /* config: format for snapshots */
+    struct diskfs_snapshot     *snapshot;
+    pthread_mutex_t             ref_lock[DISKFS_REF_LOCKS];
+    uint8_t                     snap_fh[CHIMERA_VFS_FH_SIZE];
+    uint32_t                    snap_fhlen;
+    /* Compact b+tree leaves (see struct diskfs_bt_node_hdr): fixed at format
+     * time. */
+    int                         bt_compact;        /* superblock: compact leaves allowed */
+    int                         bt_compact_cfg;    /* config: format with compact leaves */
     /* Inode-generation epoch: every generation is drawn from this global
      * monotonic counter; gen_floor is the durably-persisted bound
      * (reserve-ahead) that no issued generation may reach.  A reused inode
@@ -1274,6 +1889,8 @@ struct diskfs_thread {
     struct slab_allocator       *allocator;
     struct sm_thread_cache       space_cache;      /* metadata (LOCAL devices); file
                                                     * data uses per-inode space_resv */
+    struct sm_thread_cache      *near_cache;       /* [num_devices] inode blocks placed
+                                                    * beside their parent */
     struct diskfs_txn           *txn_free_list;
     struct diskfs_inode_waiter  *waiter_free_list;
     struct diskfs_iq_channel    *iq_channel;
@@ -1318,6 +1935,13 @@ struct diskfs_thread {
     struct diskfs_drain         *drain_head, *drain_tail;
     int                          draining;
 
+    /* Inode loads issued by diskfs_inode_prefetch and not yet landed;
+     * nothing waits on them, so teardown does. */
+    int                          prefetching;
+
+    /* Codec scratch and contexts, allocated on first use (diskfs_compress.c). */
+    struct diskfs_compress_ctx  *compress;
+
     /* Deferred-mtime flusher: this worker owns inode-cache shards where
      * (shard % num_active_threads) == thread_id.  The periodic timer kicks the
      * driver, which flushes eligible dirty inodes one txn at a time (drain
@@ -1633,15 +2257,16 @@ struct diskfs_ag_wait {
 
 
 struct diskfs_reclaim_worker {
-    struct diskfs_shared      *shared;
-    struct diskfs_thread      *ctx;        /* this worker's diskfs thread context */
-    struct evpl_thread        *thread;
-    struct evpl_doorbell       doorbell;
-    pthread_mutex_t            lock;
-    struct diskfs_reclaim_job *head;
-    struct diskfs_reclaim_job *tail;
-    int                        condenses;  /* condense jobs in flight here */
-    int                        ready;      /* atomic: context constructed */
+    struct diskfs_shared        *shared;
+    struct diskfs_thread        *ctx;        /* this worker's diskfs thread context */
+    struct evpl_thread          *thread;
+    struct evpl_doorbell         doorbell;
+    pthread_mutex_t              lock;
+    struct diskfs_reclaim_job   *head;
+    struct diskfs_reclaim_job   *tail;
+    int                          condenses;  /* condense jobs in flight here */
+    int                          ready;      /* atomic: context constructed */
+    struct chimera_thread_stats *stats;      /* queue = submitted jobs */
 };
 
 
@@ -1677,6 +2302,380 @@ struct diskfs_condense {
 };
 
 
+/* ------------------------------------------------------------------ */
+/* Online defragmentation                                              */
+/*                                                                      */
+/* The write path counts, per file, writes whose new extent lands next  */
+/* to its file predecessor but not next to it on disk (so the extent    */
+/* map cannot coalesce them); at DISKFS_DEFRAG_TRIGGER such breaks the  */
+/* file is queued here.  Reclaim worker 0 works the queue from a timer: */
+/* it walks each file in windows of file-contiguous written extents     */
+/* smaller than DISKFS_DEFRAG_TARGET (at most DISKFS_DEFRAG_MAX_EXTENTS */
+/* of them, DISKFS_DEFRAG_WINDOW bytes), and for every window of two or */
+/* more allocates one contiguous run, copies the data there through its */
+/* own block queues, then -- in the same transaction -- replaces the    */
+/* window's extent records with one and frees the old ranges.  The inode */
+/* is write-locked from the first read to the commit, so no write can   */
+/* slip between copy and swap, and a crash before the commit leaves the */
+/* old map (and the old data) authoritative.                            */
+/*                                                                      */
+/* Copying is paced by a byte budget refilled every tick (defrag_rate)  */
+/* and pauses while the other event-loop threads are busier than        */
+/* defrag_busy_pct.  The queue, budget and counters are exposed as the  */
+/* "diskfs_defrag" background job (REST /api/v1/jobs).                  */
+/* ------------------------------------------------------------------ */
+
+#define DISKFS_DEFRAG_TRIGGER          16
+#define DISKFS_DEFRAG_TARGET           (1ULL << 20)
+#define DISKFS_DEFRAG_WINDOW           (8ULL << 20)
+#define DISKFS_DEFRAG_MAX_EXTENTS      64
+#define DISKFS_DEFRAG_MAX_IOV          256        /* copy chunks per window */
+#define DISKFS_DEFRAG_SCAN_MAX         1024       /* extents examined per txn */
+#define DISKFS_DEFRAG_QUEUE_MAX        4096
+#define DISKFS_DEFRAG_TICK_US          100000
+#define DISKFS_DEFRAG_RATE_DEFAULT     (32ULL << 20)
+#define DISKFS_DEFRAG_BUSY_PCT_DEFAULT 50
+
+
+struct diskfs_defrag_cand {
+    uint64_t inum;
+    uint32_t gen;
+};
+
+
+/* One file pass; windows run one transaction each. */
+struct diskfs_defrag_op {
+    struct diskfs_defrag  *df;
+    struct diskfs_thread  *thread;
+    uint64_t               inum;
+    uint32_t               gen;
+    struct diskfs_txn     *txn;
+    struct diskfs_inode   *inode;
+    uint64_t               cursor;      /* next file offset to examine */
+    uint32_t               scanned;     /* extents examined in this txn */
+    int                    moved;       /* some window of this file was rewritten */
+    int                    parked;      /* between windows (no txn held) */
+    int                    failed;      /* window abandoned; its txn only frees */
+
+    /* Current window */
+    struct diskfs_extent   ext[DISKFS_DEFRAG_MAX_EXTENTS];
+    int                    next;
+    int                    idx;         /* swap progress */
+    int                    nchunks;
+    uint64_t               win_start;
+    uint64_t               win_len;
+    uint32_t               new_dev;
+    uint64_t               new_off;
+    struct sm_thread_cache resv;       /* exact draws; no retained tail */
+
+    /* Copy */
+    struct evpl_iovec      iov[DISKFS_DEFRAG_MAX_IOV];
+    uint64_t               iov_off[DISKFS_DEFRAG_MAX_IOV]; /* offset within window */
+    uint64_t               iov_src_off[DISKFS_DEFRAG_MAX_IOV]; /* where it was read */
+    uint32_t               iov_src_dev[DISKFS_DEFRAG_MAX_IOV];
+    int                    niov;
+    int                    pending;
+    int                    io_error;
+    int                    checked;     /* chunks verified against data checksums */
+    uint8_t                rec_scratch[sizeof(struct diskfs_extent_rec)];
+};
+
+
+struct diskfs_defrag {
+    struct chimera_job            job;
+    struct diskfs_shared         *shared;
+    struct diskfs_reclaim_worker *worker;     /* host: reclaim worker 0 */
+    struct evpl_timer             timer;
+    int                           armed;      /* timer added (worker only) */
+
+    /* Candidate ring (any thread) */
+    pthread_mutex_t               lock;
+    struct diskfs_defrag_cand    *ring;
+    uint32_t                      head;
+    uint32_t                      count;
+
+    /* Controls: job.enabled and job.rate (bytes/s, 0 = unlimited) are set
+     * through the job ops, as is this (atomic) */
+    int                           kick;       /* run a pass now, even disabled */
+
+    /* Worker only */
+    uint64_t                      chunk;      /* copy I/O size: smallest device max */
+    uint32_t                      busy_pct;
+    int                           busy;       /* last load sample over busy_pct */
+    int                           stopping;   /* worker shutting down */
+    int                           in_run;     /* diskfs_defrag_run on the stack */
+    int64_t                       tokens;     /* copy budget, bytes */
+    uint64_t                      fg_busy_ns; /* last foreground sample */
+    uint64_t                      fg_total_ns;
+    struct diskfs_defrag_op      *op;         /* pass in flight, or NULL */
+};
+
+
+/* ------------------------------------------------------------------ */
+/* Discard of freed space                                              */
+/*                                                                      */
+/* Once a transaction's frees are durable and back in the space map     */
+/* (diskfs_txn_apply_frees), the ranges are also queued here per        */
+/* (device, AG), merged with adjacent queued ranges so a file freed     */
+/* extent by extent becomes one request.  An AG's ranges are held for   */
+/* DISKFS_DISCARD_DELAY_TICKS to gather neighbours; the host reclaim    */
+/* worker then claims each run back out of the space map (skipping it   */
+/* if any of it was reallocated meanwhile), discards it on the device   */
+/* and releases it.  Runs shorter than DISKFS_DISCARD_MIN are not worth */
+/* a device command and are skipped.  Requests are paced by a byte      */
+/* budget refilled every tick (discard_rate) and capped in flight.      */
+/* Nothing here is persistent: a crash or unmount only loses trims.     */
+/* ------------------------------------------------------------------ */
+
+#define DISKFS_DISCARD_AG_RANGES    32          /* queued runs per AG */
+#define DISKFS_DISCARD_MIN          (64ULL << 10)
+#define DISKFS_DISCARD_QDEPTH       8           /* discards in flight */
+#define DISKFS_DISCARD_TICK_US      100000
+#define DISKFS_DISCARD_DELAY_TICKS  10
+#define DISKFS_DISCARD_RATE_DEFAULT (256ULL << 20)
+
+
+struct diskfs_discard_range {
+    uint64_t offset;
+    uint64_t length;
+};
+
+
+struct diskfs_discard_ag {
+    struct diskfs_discard_ag   *next;      /* dirty list, oldest first */
+    uint32_t                    device_id;
+    uint32_t                    stamp;     /* tick its first range was queued */
+    int                         dirty;
+    int                         nranges;
+    struct diskfs_discard_range ranges[DISKFS_DISCARD_AG_RANGES];
+};
+
+
+struct diskfs_discard {
+    struct chimera_job            job;
+    struct diskfs_shared         *shared;
+    struct diskfs_reclaim_worker *worker;     /* host: last reclaim worker */
+    struct evpl_timer             timer;
+    int                           armed;      /* timer added (worker only) */
+
+    /* Queues (any thread, under lock); ags[device][ag] allocated on first use */
+    pthread_mutex_t               lock;
+    struct diskfs_discard_ag   ***ags;
+    struct diskfs_discard_ag     *dirty_head;
+    struct diskfs_discard_ag     *dirty_tail;
+    int                           stopping;   /* worker shut down: stop queuing */
+    uint64_t                      dropped;    /* bytes, folded into metrics by the worker */
+
+    uint32_t                      now;        /* tick counter (atomic) */
+    int                           kick;       /* issue everything now (atomic) */
+
+    /* Worker only */
+    int64_t                       tokens;     /* discard budget, bytes */
+    int                           inflight;
+};
+
+
+/* ------------------------------------------------------------------ */
+/* Transparent compression                                             */
+/*                                                                      */
+/* A redirect write that replaces whole blocks is cut into units of     */
+/* compress_unit logical bytes, one extent each.  A unit whose sample   */
+/* does not compress, or whose encoding saves no block, is stored raw;  */
+/* otherwise it is stored as a single blob flagged                      */
+/* DISKFS_EXT_COMPRESSED, with the codec and the blob's block count in  */
+/* the flags.  A blob decodes only as a whole: reads decode it into     */
+/* worker scratch and copy the slice they need, truncation keeps it     */
+/* whole under a shorter head, and any edit that would keep a tail of   */
+/* it first inflates the extent to a raw one (diskfs_inflate_start).    */
+/* The codecs run inline on the worker that owns the request.           */
+/* ------------------------------------------------------------------ */
+
+#define DISKFS_COMPRESS_NONE               0
+#define DISKFS_COMPRESS_LZ4                1
+#define DISKFS_COMPRESS_ZSTD               2
+
+#define DISKFS_COMPRESS_UNIT_MIN           (8U << 10)
+#define DISKFS_COMPRESS_UNIT_MAX           (128U << 10)
+#define DISKFS_COMPRESS_UNIT_DEFAULT       DISKFS_COMPRESS_UNIT_MAX
+#define DISKFS_COMPRESS_ZSTD_LEVEL_DEFAULT 3
+#define DISKFS_COMPRESS_ZSTD_LEVEL_MAX     19
+#define DISKFS_COMPRESS_MAX_STAGE          (1U << 20)  /* staged run per write */
+
+
+/* ------------------------------------------------------------------ */
+/* Data checksums                                                      */
+/*                                                                      */
+/* A filesystem formatted with data_checksums ends every local AG in a  */
+/* table of one 32-bit checksum per 4 KiB block (sm_csum_locate).  The  */
+/* table blocks are cached and logged like any other metadata block,    */
+/* so an entry is as durable as the extent record it describes.  Each   */
+/* data write hashes the blocks it submits onto its txn; the commit's   */
+/* suspendable pre-pass (diskfs_csum_flush) stores them and zeroes the  */
+/* entries of whole blocks the txn frees, so a live entry always        */
+/* describes file data.  Reads check the blocks they bring in before    */
+/* filling the data cache and fail with EIO on a mismatch; RMW, inflate */
+/* and defrag check what they read before it is rewritten under a new   */
+/* checksum.  A zero entry (nothing recorded) checks nothing.  The hash */
+/* is XXH3 (AVX2 / NEON), a fraction of a memory copy per block.        */
+/*                                                                      */
+/* The scrub job walks the tables in the background and reads back      */
+/* every block with a recorded checksum, paced by a byte budget         */
+/* (scrub_rate) refilled every tick; a mismatch is re-read once before  */
+/* it is reported.                                                      */
+/* ------------------------------------------------------------------ */
+
+#define DISKFS_CSUM_BATCH         64            /* entries fetched per table visit */
+#define DISKFS_SCRUB_CHUNK        (256U << 10)  /* largest read-back */
+#define DISKFS_SCRUB_QDEPTH       4             /* read-backs in flight */
+#define DISKFS_SCRUB_TICK_US      100000
+#define DISKFS_SCRUB_RATE_DEFAULT (64ULL << 20)
+
+
+/* Checksums of `nblocks` blocks a txn wrote at device_offset, stored in the
+ * table by its commit. */
+struct diskfs_txn_csum {
+    uint64_t                device_offset;
+    uint32_t                device_id;
+    uint32_t                nblocks;
+    struct diskfs_txn_csum *next;
+    uint32_t                sums[];
+};
+
+
+struct diskfs_scrub {
+    struct chimera_job            job;
+    struct diskfs_shared         *shared;
+    struct diskfs_reclaim_worker *worker;     /* host reclaim worker */
+    struct evpl_timer             timer;
+    int                           armed;      /* timer added (worker only) */
+    int                           kick;       /* start a pass now (atomic) */
+
+    /* Worker only */
+    int                           active;     /* a pass is under way */
+    int                           parked;     /* waiting on a table block */
+    int                           stopping;
+    uint32_t                      device_id;  /* pass cursor: next block */
+    uint64_t                      offset;
+    int64_t                       tokens;     /* read budget, bytes */
+    int                           inflight;
+};
+
+
+/* ------------------------------------------------------------------ */
+/* Snapshots                                                           */
+/*                                                                      */
+/* A filesystem formatted with snapshots keeps a 16-bit reference count */
+/* per 4 KiB block of every local AG (sm_ref_locate), counting the      */
+/* references beyond the first.  The tables are cached and logged like  */
+/* the checksum tables.  A txn that adds references to a range notes    */
+/* them (diskfs_ref_note); the commit's first pre-pass (diskfs_ref_flush) */
+/* applies them, then walks the txn's frees: a whole block with a       */
+/* nonzero count is decremented instead of freed, and the free is split */
+/* around it.  A shared block is never overwritten in place either: the */
+/* write path and defrag check the counts (diskfs_ref_shared) and       */
+/* redirect or skip.                                                    */
+/*                                                                      */
+/* A snapshot is a read-only copy of the live tree's inodes and b+tree  */
+/* records, under the permanent snapshot directory (DISKFS_SNAP_INUM),  */
+/* named @GMT-YYYY.MM.DD-HH.MM.SS.  The creation job clones one inode   */
+/* batch per transaction, taking a reference on every extent it copies, */
+/* so file data is shared and creation costs a metadata copy.  A        */
+/* snapshot is consistent per batch, not as a point in time, and is     */
+/* published in the snapshot directory only once it is whole.  Its      */
+/* inodes carry DISKFS_INODE_F_SNAPSHOT, so their file handles name a   */
+/* separate mount id (snap_fh) that is reachable only through a "ro"    */
+/* mount of the ".snapshot" path.                                       */
+/* ------------------------------------------------------------------ */
+
+#define DISKFS_SNAP_BATCH   64     /* records copied per transaction */
+#define DISKFS_SNAP_TICK_US 100000
+#define DISKFS_SNAP_NAME    sizeof("@GMT-YYYY.MM.DD-HH.MM.SS")
+
+
+/* References a txn takes on `nblocks` blocks at device_offset, applied by
+ * its commit; `done` counts the blocks already applied. */
+struct diskfs_txn_ref {
+    uint64_t               device_offset;
+    uint32_t               device_id;
+    uint32_t               nblocks;
+    uint32_t               done;
+    struct diskfs_txn_ref *next;
+};
+
+
+/* A live inode whose records remain to be copied into its clone. */
+struct diskfs_snap_item {
+    uint64_t                 src_inum;
+    uint32_t                 src_gen;
+    uint64_t                 dst_inum;
+    uint32_t                 dst_gen;
+    struct diskfs_bt_key     cursor;      /* next record to copy */
+    struct diskfs_snap_item *next;
+};
+
+
+/* Live inum -> clone, for files with more than one link. */
+struct diskfs_snap_link {
+    uint64_t                 src_inum;
+    uint64_t                 dst_inum;
+    uint32_t                 dst_gen;
+    struct diskfs_snap_link *next;
+};
+
+#define DISKFS_SNAP_LINK_BUCKETS 1024
+
+
+/* One snapshot creation; each step runs one transaction. */
+struct diskfs_snapshot_op {
+    struct diskfs_snapshot  *sn;
+    struct diskfs_thread    *thread;
+    struct diskfs_txn       *txn;
+    int                      phase;       /* DISKFS_SNAP_PHASE_* */
+    int                      parked;      /* between transactions */
+    char                     name[DISKFS_SNAP_NAME];
+    uint32_t                 name_len;
+    uint64_t                 name_hash;
+
+    uint64_t                 root_inum;   /* the snapshot's root clone */
+    uint32_t                 root_gen;
+    struct diskfs_snap_item *head, *tail; /* inodes left to copy, FIFO */
+    struct diskfs_snap_link *links[DISKFS_SNAP_LINK_BUCKETS];
+
+    /* Current step */
+    struct diskfs_inode     *dir;         /* the snapshot directory (CHECK, PUBLISH) */
+    struct diskfs_inode     *src;
+    struct diskfs_inode     *dst;
+    struct diskfs_inode     *child;       /* dirent target being cloned */
+    struct diskfs_bt_key     key;         /* record in hand */
+    uint32_t                 rec_len;
+    uint32_t                 copied;
+    uint64_t                 child_inum;
+    uint32_t                 child_gen;
+    uint8_t                  rec[DISKFS_BT_ROOT_CAP];    /* no record outgrows a root */
+};
+
+#define DISKFS_SNAP_PHASE_CHECK   0      /* name not taken yet */
+#define DISKFS_SNAP_PHASE_ROOT    1      /* clone the live root */
+#define DISKFS_SNAP_PHASE_COPY    2      /* clone everything below it */
+#define DISKFS_SNAP_PHASE_PUBLISH 3      /* link it into the snapshot directory */
+#define DISKFS_SNAP_PHASE_DONE    4      /* published */
+
+
+struct diskfs_snapshot {
+    struct chimera_job            job;
+    struct diskfs_shared         *shared;
+    struct diskfs_reclaim_worker *worker;     /* host: reclaim worker 0 */
+    struct evpl_timer             timer;
+    int                           armed;      /* timer added (worker only) */
+    int                           kick;       /* take a snapshot now (atomic) */
+
+    /* Worker only */
+    int                           stopping;
+    int                           in_run;     /* diskfs_snapshot_run on the stack */
+    struct diskfs_snapshot_op    *op;         /* creation in flight, or NULL */
+};
+
+
 /* ------------------------------------------------------------------ */
 /* Inode-generation epoch                                              */
 /* ------------------------------------------------------------------ */
@@ -1745,8 +2744,10 @@ struct diskfs_inode_load_ctx {
     struct diskfs_inode        *inode;
     int                         acl_len;
     int                         pnfs_len;
+    int                         inline_len;
     uint8_t                     acl_rec[DISKFS_ACL_REC_MAX];
     uint8_t                     pnfs_rec[CHIMERA_VFS_PNFS_LAYOUT_MAX];
+    uint8_t                     inline_rec[DISKFS_INLINE_DATA_MAX];
 };
 
 
@@ -1755,6 +2756,7 @@ struct diskfs_inode_load_ctx {
 struct diskfs_inode_alloc_ctx {
     struct diskfs_thread *thread;
     struct diskfs_txn    *txn;
+    uint64_t              near;
     diskfs_inode_cb_t     cb;
     void                 *private_data;
 };
@@ -1772,7 +2774,7 @@ struct diskfs_redo_entry {
 
 
 struct diskfs_redo_ctx {
-    struct diskfs_intent_log *il;
+    struct diskfs_il_stream  *stream;
     struct diskfs_redo_entry *entries; /* one CQE/completion per grouped txn */
     uint32_t                  num_entries;
     struct diskfs_il_record  *rec;     /* owns the record image (iovs) */
@@ -1789,6 +2791,15 @@ struct diskfs_redo_ctx {
  */
 #define DISKFS_IL_MAX_IOV       64
 
+/*
+ * Delta payloads live in a record's header region, which is one buffer.  A
+ * batch stops growing once that region would pass DISKFS_IL_HDR_MAX, and a
+ * single txn whose deltas total more than DISKFS_IL_TXN_DELTA_MAX is logged
+ * as full images.
+ */
+#define DISKFS_IL_HDR_MAX       (64 * 1024)
+#define DISKFS_IL_TXN_DELTA_MAX (32 * 1024)
+
 
 /*
  * The intent-log thread submits all its block writes (redo records + tail-push
@@ -1815,10 +2826,78 @@ struct diskfs_redo_ctx {
 
 #define DISKFS_PUSH_LOWAT       128
 
+/*
+ * Group commit.  A commit stream builds each redo record from whatever its
+ * channels have queued, so when the log is idle a lone FILE_SYNC write or
+ * COMMIT goes straight out.  While the stream already has redo writes in
+ * flight, a batch shorter than group_commit_txns would only queue behind them:
+ * it is held open for up to group_commit_us (from when it was first deferred)
+ * to collect more transactions, then issued as one record -- one FUA write for
+ * every waiter.  A batch that fills the record (iov or header cap) or runs out
+ * of log space goes at once.  Off by default: the window trades a lone
+ * writer's latency for aggregate throughput under many concurrent syncers,
+ * which only the deployment can judge.
+ */
+#define DISKFS_GROUP_COMMIT_US_DEFAULT   0
+
+#define DISKFS_GROUP_COMMIT_US_MAX       10000
+
+#define DISKFS_GROUP_COMMIT_TXNS_DEFAULT 16
+
 
 struct diskfs_recover_rec {
     uint64_t seq;
-    uint64_t offset;     /* byte offset within the read-in log image */
+    uint64_t offset;     /* byte offset within its log window */
+    uint64_t hdr_len;    /* header region length (full images follow it) */
+};
+
+
+/*
+ * Crash recovery runs its log scan and replay-set build on up to this many
+ * threads, streams the log through windows (DISKFS_RECOVER_WINDOW unless
+ * configured) read in
+ * DISKFS_RECOVER_READ_CHUNK requests, and keeps up to DISKFS_RECOVER_IO_DEPTH
+ * reads or writes in flight.
+ */
+#define DISKFS_RECOVER_MAX_THREADS 64
+#define DISKFS_RECOVER_WINDOW      (32 * 1024 * 1024)
+#define DISKFS_RECOVER_READ_CHUNK  (1024 * 1024)
+#define DISKFS_RECOVER_IO_DEPTH    64
+
+
+/* A redo delta kept for the replay of one home block, copied out of the log. */
+struct diskfs_recover_delta {
+    uint64_t seq;
+    uint32_t index;    /* position within its record */
+    uint32_t len;
+    char    *data;
+};
+
+
+/*
+ * The replay of one home block: its newest full image in the log and the
+ * deltas logged after it, or -- when no full image of it survives -- the
+ * deltas to apply to its home copy.
+ */
+struct diskfs_recover_write {
+    uint64_t                     device_offset;
+    uint64_t                     seq;       /* of the image in buf */
+    uint32_t                     device_id;
+    uint32_t                     index;
+    uint32_t                     has_image;
+    uint32_t                     ndeltas;   /* > 0 at replay: read home, then apply */
+    uint32_t                     delta_cap;
+    char                        *buf;
+    struct diskfs_recover_delta *deltas;
+};
+
+
+/* One read of a batched mount-time read (diskfs_mount_io_read_many). */
+struct diskfs_mount_io_read {
+    uint32_t device_id;
+    void    *buf;
+    uint64_t length;
+    uint64_t offset;
 };
 
 
@@ -1907,6 +2986,35 @@ struct diskfs_mtime_flush {
 #define DISKFS_ALLOCATE_MAX_EXTENT (256ULL << 20)
 
 
+/*
+ * Streaming-write preallocation.  A write that needs fresh blocks draws them
+ * from the file's volatile reservation (diskfs_inode_alloc_space); the size of
+ * each refill is the file's extent-size hint when it has one, otherwise it
+ * grows with the file -- the next power of two of its size, from
+ * SM_RESERVATION_MIN up to the share's prealloc_max -- so a large file is laid
+ * down in a few long device-contiguous runs, and each refill first tries to
+ * continue where the last one ended.  The unused tail is never journaled and
+ * returns to the free pool when the file is closed.
+ *
+ * The hint is read and set through the virtual xattr DISKFS_XATTR_EXTSIZE
+ * (decimal bytes, a multiple of 4 KiB up to DISKFS_EXTSIZE_MAX); it is kept in
+ * the dinode, not as an xattr record, and is not listed.
+ */
+#define DISKFS_PREALLOC_MAX_DEFAULT (64ULL << 20)
+#define DISKFS_EXTSIZE_MAX          (1ULL << 30)
+#define DISKFS_XATTR_EXTSIZE        "user.diskfs.extsize"
+
+/*
+ * Striping.  With more than one data device, file data past the first
+ * stripe_chunk bytes is placed a stripe unit at a time round the devices'
+ * weighted placement order (diskfs_inode_data_device), so one sequential
+ * stream drives every device; the head of the file stays with its inode,
+ * beside the parent directory.  Each stripe unit is still a contiguous run,
+ * so the reservation of a striped write is capped at the chunk.
+ */
+#define DISKFS_STRIPE_CHUNK_DEFAULT (1ULL << 20)
+
+
 /* ------------------------------------------------------------------ */
 /* pNFS block layout (CHIMERA_VFS_OP_GET_LAYOUT, RFC 5663)             */
 /* ------------------------------------------------------------------ */
@@ -1936,6 +3044,10 @@ static const struct diskfs_bt_key diskfs_pnfs_key = {
     .type = DISKFS_REC_PNFS, .subkey = 0
 };
 
+static const struct diskfs_bt_key diskfs_inline_key = {
+    .type = DISKFS_REC_INLINE, .subkey = 0
+};
+
 /* ------------------------------------------------------------------ */
 /* Cross-file function declarations                                    */
 /* ------------------------------------------------------------------ */
@@ -1944,6 +3056,10 @@ void
 diskfs_intent_log_metrics_init(
     struct diskfs_intent_log *il);
 
+void
+diskfs_il_stream_metrics_init(
+    struct diskfs_il_stream *st);
+
 void
 diskfs_inode_release_one(
     struct diskfs_thread       *thread,
@@ -1999,10 +3115,27 @@ diskfs_block_release(
     struct diskfs_thread *thread,
     struct diskfs_block  *blk);
 
-void
-diskfs_block_cache_create(
-    struct diskfs_shared *shared);
-
+struct diskfs_block *
+diskfs_block_claim_async(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    int is_new,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg);
+
+struct diskfs_block *
+diskfs_block_get_async(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg);
+
+void
+diskfs_block_cache_create(
+    struct diskfs_shared *shared);
+
 void
 diskfs_block_cache_prealloc(
     struct diskfs_shared *shared,
@@ -2012,6 +3145,53 @@ void
 diskfs_block_cache_destroy(
     struct diskfs_shared *shared);
 
+void
+diskfs_dcache_create(
+    struct diskfs_shared *shared);
+
+void
+diskfs_dcache_prealloc(
+    struct diskfs_shared *shared,
+    struct evpl          *evpl);
+
+void
+diskfs_dcache_destroy(
+    struct diskfs_shared *shared);
+
+uint64_t
+diskfs_dcache_read(
+    struct diskfs_thread     *thread,
+    uint32_t                  device_id,
+    uint64_t                  device_offset,
+    uint64_t                  length,
+    struct evpl_iovec_cursor *cursor);
+
+int
+diskfs_dcache_reserve(
+    struct diskfs_thread      *thread,
+    struct diskfs_dcache_fill *fill);
+
+void
+diskfs_dcache_fill(
+    struct diskfs_thread      *thread,
+    struct diskfs_dcache_fill *fill,
+    struct evpl_iovec         *iov,
+    int                        niov,
+    int                        valid);
+
+void
+diskfs_dcache_invalidate(
+    struct diskfs_thread *thread,
+    uint32_t              device_id,
+    uint64_t              device_offset,
+    uint64_t              length);
+
+void
+diskfs_dcache_cursor_put(
+    struct evpl_iovec_cursor *cursor,
+    const void               *src,
+    uint32_t                  length);
+
 struct diskfs_block *
 diskfs_block_claim(
     struct diskfs_thread *thread,
@@ -2122,6 +3302,8 @@ diskfs_txn_unpin_blocks(
     struct diskfs_txn      *txn,
     enum diskfs_block_state new_state);
 
+extern const char *diskfs_bt_counter_names[DISKFS_METRIC_BTREE_NUM];
+
 int
 diskfs_bt_leaf_search(
     void                       *buf,
@@ -2152,9 +3334,10 @@ diskfs_bt_node_for_write(
 
 void
 diskfs_bt_leaf_compact(
-    void    *buf,
-    uint32_t base,
-    uint32_t cap);
+    struct diskfs_thread *thread,
+    void                 *buf,
+    uint32_t              base,
+    uint32_t              cap);
 
 int
 diskfs_bt_rebalance_leaf(
@@ -2196,6 +3379,170 @@ void
 diskfs_reclaim_destroy(
     struct diskfs_shared *shared);
 
+extern const char *diskfs_defrag_counter_names[DISKFS_METRIC_DEFRAG_NUM];
+
+void
+diskfs_defrag_create(
+    struct diskfs_shared *shared);
+
+void
+diskfs_defrag_destroy(
+    struct diskfs_shared *shared);
+
+void
+diskfs_defrag_thread_init(
+    struct diskfs_reclaim_worker *w);
+
+void
+diskfs_defrag_thread_shutdown(
+    struct diskfs_reclaim_worker *w);
+
+void
+diskfs_defrag_note(
+    struct diskfs_thread *thread,
+    struct diskfs_inode  *inode);
+
+extern const char *diskfs_discard_counter_names[DISKFS_METRIC_DISCARD_NUM];
+
+void
+diskfs_discard_create(
+    struct diskfs_shared *shared);
+
+void
+diskfs_discard_destroy(
+    struct diskfs_shared *shared);
+
+void
+diskfs_discard_thread_init(
+    struct diskfs_reclaim_worker *w);
+
+void
+diskfs_discard_thread_shutdown(
+    struct diskfs_reclaim_worker *w);
+
+void
+diskfs_discard_queue(
+    struct diskfs_shared *shared,
+    uint32_t              device_id,
+    uint64_t              device_offset,
+    uint64_t              length);
+
+extern const char *diskfs_compress_counter_names[DISKFS_METRIC_COMPRESS_NUM];
+
+uint32_t
+diskfs_compress_encode(
+    struct diskfs_thread *thread,
+    void                 *buf,
+    uint32_t              length,
+    uint32_t             *r_flags);
+
+int
+diskfs_compress_decode(
+    struct diskfs_thread *thread,
+    const void           *blob,
+    uint32_t              flags,
+    const void          **r_data,
+    uint32_t             *r_length);
+
+void
+diskfs_compress_thread_destroy(
+    struct diskfs_thread *thread);
+
+extern const char *diskfs_csum_counter_names[DISKFS_METRIC_CSUM_NUM];
+
+void
+diskfs_csum_note(
+    struct diskfs_thread    *thread,
+    struct diskfs_txn       *txn,
+    uint32_t                 device_id,
+    uint64_t                 device_offset,
+    const struct evpl_iovec *iov,
+    int                      niov,
+    uint64_t                 length);
+
+int
+diskfs_csum_flush(
+    struct diskfs_thread     *thread,
+    struct diskfs_txn        *txn,
+    struct diskfs_commit_ctx *cctx);
+
+void
+diskfs_csum_discard(
+    struct diskfs_txn *txn);
+
+int
+diskfs_csum_verify(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    uint32_t nblocks,
+    const struct evpl_iovec *iov,
+    int niov,
+    uint64_t skip,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg);
+
+void
+diskfs_scrub_create(
+    struct diskfs_shared *shared);
+
+void
+diskfs_scrub_destroy(
+    struct diskfs_shared *shared);
+
+void
+diskfs_scrub_thread_init(
+    struct diskfs_reclaim_worker *w);
+
+void
+diskfs_scrub_thread_shutdown(
+    struct diskfs_reclaim_worker *w);
+
+extern const char *diskfs_snapshot_counter_names[DISKFS_METRIC_SNAP_NUM];
+
+void
+diskfs_ref_note(
+    struct diskfs_thread *thread,
+    struct diskfs_txn    *txn,
+    uint32_t              device_id,
+    uint64_t              device_offset,
+    uint64_t              length);
+
+int
+diskfs_ref_flush(
+    struct diskfs_thread     *thread,
+    struct diskfs_txn        *txn,
+    struct diskfs_commit_ctx *cctx);
+
+void
+diskfs_ref_discard(
+    struct diskfs_txn *txn);
+
+int
+diskfs_ref_shared(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    uint64_t length,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg);
+
+void
+diskfs_snapshot_create(
+    struct diskfs_shared *shared);
+
+void
+diskfs_snapshot_destroy(
+    struct diskfs_shared *shared);
+
+void
+diskfs_snapshot_thread_init(
+    struct diskfs_reclaim_worker *w);
+
+void
+diskfs_snapshot_thread_shutdown(
+    struct diskfs_reclaim_worker *w);
+
 void
 diskfs_sm_ag_condense(
     void    *user,
@@ -2355,6 +3702,12 @@ diskfs_inode_load(
     diskfs_inode_cb_t           cb,
     void                       *private_data);
 
+void
+diskfs_inode_prefetch(
+    struct diskfs_thread *thread,
+    uint64_t              inum,
+    uint32_t              gen);
+
 void
 diskfs_inode_alloc_resume(
     struct diskfs_thread *thread,
@@ -2443,11 +3796,6 @@ diskfs_commit_resume(
     struct diskfs_thread *thread,
     void                 *arg);
 
-int
-diskfs_recover_rec_cmp(
-    const void *a,
-    const void *b);
-
 struct diskfs_mount_io *
 diskfs_mount_io_open(
     struct diskfs_shared *shared);
@@ -2464,6 +3812,31 @@ diskfs_mount_io_read(
     uint64_t length,
     uint64_t offset);
 
+int
+diskfs_mount_io_read_many(
+    struct diskfs_mount_io      *io,
+    struct diskfs_mount_io_read *reads,
+    uint32_t                     count);
+
+int
+diskfs_mount_io_write_many(
+    void                     *user,
+    const struct sm_io_write *writes,
+    uint32_t                  count);
+
+int
+diskfs_mount_io_flush(
+    void    *user,
+    uint32_t device_id);
+
+int
+diskfs_recover_log(
+    struct diskfs_shared   *shared,
+    struct diskfs_mount_io *io,
+    uint64_t                log_incompat,
+    int                     replay,
+    uint64_t               *next_seq);
+
 void *
 diskfs_init(
     const char                *cfgdata,
@@ -2659,6 +4032,17 @@ void
 diskfs_ext_put(
     struct chimera_vfs_request *request);
 
+void
+diskfs_inline_store(
+    struct chimera_vfs_request *request,
+    int                         had_record,
+    void (                     *cont )(struct chimera_vfs_request *));
+
+void
+diskfs_inline_promote(
+    struct chimera_vfs_request *request,
+    void (                     *cont )(struct chimera_vfs_request *));
+
 void
 diskfs_write(
     struct diskfs_thread       *thread,
@@ -2796,10 +4180,10 @@ diskfs_metric_counter_add(
 
 static inline void
 diskfs_metric_il_block_io(
-    struct diskfs_intent_log   *il,
-    enum diskfs_metric_io_dir   dir,
-    enum diskfs_metric_io_class class,
-    uint64_t                    bytes);
+    struct diskfs_intent_log_metrics *m,
+    enum diskfs_metric_io_dir         dir,
+    enum diskfs_metric_io_class       class,
+    uint64_t                          bytes);
 
 static inline size_t
 diskfs_metric_io_device_idx(
@@ -2809,11 +4193,12 @@ diskfs_metric_io_device_idx(
 
 static inline void
 diskfs_metric_il_block_io_device(
-    struct diskfs_intent_log   *il,
-    uint32_t                    device_id,
-    enum diskfs_metric_io_dir   dir,
-    enum diskfs_metric_io_class class,
-    uint64_t                    bytes);
+    struct diskfs_intent_log         *il,
+    struct diskfs_intent_log_metrics *m,
+    uint32_t                          device_id,
+    enum diskfs_metric_io_dir         dir,
+    enum diskfs_metric_io_class       class,
+    uint64_t                          bytes);
 
 static inline void
 diskfs_metric_gauge_set(
@@ -2852,11 +4237,53 @@ diskfs_metric_block_cache(
     struct diskfs_thread             *thread,
     enum diskfs_metric_block_cache_op op);
 
+static inline void
+diskfs_metric_dcache(
+    struct diskfs_thread        *thread,
+    enum diskfs_metric_dcache_op op,
+    uint64_t                     blocks);
+
 static inline void
 diskfs_metric_mtime(
     struct diskfs_thread       *thread,
     enum diskfs_metric_mtime_op op);
 
+static inline void
+diskfs_metric_defrag(
+    struct diskfs_thread        *thread,
+    enum diskfs_metric_defrag_op op,
+    uint64_t                     count);
+
+static inline void
+diskfs_metric_discard(
+    struct diskfs_thread         *thread,
+    enum diskfs_metric_discard_op op,
+    uint64_t                      count);
+
+static inline void
+diskfs_metric_compress(
+    struct diskfs_thread          *thread,
+    enum diskfs_metric_compress_op op,
+    uint64_t                       count);
+
+static inline void
+diskfs_metric_csum(
+    struct diskfs_thread      *thread,
+    enum diskfs_metric_csum_op op,
+    uint64_t                   count);
+
+static inline void
+diskfs_metric_snap(
+    struct diskfs_thread      *thread,
+    enum diskfs_metric_snap_op op,
+    uint64_t                   count);
+
+static inline void
+diskfs_metric_btree(
+    struct diskfs_thread       *thread,
+    enum diskfs_metric_btree_op op,
+    uint64_t                    count);
+
 static inline void
 diskfs_metric_block_io(
     struct diskfs_thread       *thread,
@@ -2900,6 +4327,21 @@ diskfs_inode_shard(
     struct diskfs_shared *shared,
     uint64_t              inum);
 
+static inline struct diskfs_inode *
+diskfs_inode_cache_lookup(
+    struct diskfs_inode_shard *shard,
+    uint64_t                   inum);
+
+static inline void
+diskfs_inode_cache_link_locked(
+    struct diskfs_inode_shard *shard,
+    struct diskfs_inode       *inode);
+
+static inline void
+diskfs_inode_cache_unlink_locked(
+    struct diskfs_inode_shard *shard,
+    struct diskfs_inode       *inode);
+
 static inline struct diskfs_block_waiter *
 diskfs_block_waiter_alloc(
     struct diskfs_thread *thread);
@@ -3024,6 +4466,70 @@ diskfs_bt_lslots(
     void    *buf,
     uint32_t base);
 
+static inline uint32_t
+diskfs_bt_leaf_stride(
+    const struct diskfs_bt_node_hdr *h);
+
+static inline uint32_t
+diskfs_bt_leaf_slots_start(
+    const struct diskfs_bt_node_hdr *h);
+
+static inline uint8_t *
+diskfs_bt_leaf_slot(
+    void    *buf,
+    uint32_t base,
+    int      i);
+
+static inline uint64_t
+diskfs_bt_leaf_prefix(
+    void    *buf,
+    uint32_t base);
+
+static inline struct diskfs_bt_key
+diskfs_bt_leaf_key(
+    void    *buf,
+    uint32_t base,
+    int      i);
+
+static inline uint32_t
+diskfs_bt_leaf_rec_off(
+    void    *buf,
+    uint32_t base,
+    int      i);
+
+static inline uint32_t
+diskfs_bt_leaf_rec_len(
+    void    *buf,
+    uint32_t base,
+    int      i);
+
+static inline void *
+diskfs_bt_leaf_rec(
+    void    *buf,
+    uint32_t base,
+    int      i);
+
+static inline void
+diskfs_bt_leaf_set_slot(
+    void                       *buf,
+    uint32_t                    base,
+    int                         i,
+    const struct diskfs_bt_key *key,
+    uint32_t                    off,
+    uint32_t                    len);
+
+static inline int
+diskfs_bt_leaf_key_fits(
+    void                       *buf,
+    uint32_t                    base,
+    const struct diskfs_bt_key *key);
+
+static inline void
+diskfs_bt_leaf_drop(
+    void    *buf,
+    uint32_t base,
+    int      i);
+
 static inline void
 diskfs_bt_node_init(
     void    *buf,
@@ -3056,6 +4562,11 @@ diskfs_ext_from_op(
     int                   result,
     struct diskfs_extent *out);
 
+static inline uint64_t
+diskfs_ext_phys_len(
+    uint64_t length,
+    uint32_t flags);
+
 static inline struct diskfs_inode *
 diskfs_inode_struct_new(
     uint64_t inum);
@@ -3064,6 +4575,10 @@ static inline void
 diskfs_inode_struct_free(
     struct diskfs_inode *inode);
 
+static inline void
+diskfs_inode_struct_retire(
+    struct diskfs_inode *inode);
+
 static inline void
 diskfs_inode_cache_insert(
     struct diskfs_shared *shared,
@@ -3073,6 +4588,7 @@ static inline void
 diskfs_inode_alloc_async(
     struct diskfs_thread *thread,
     struct diskfs_txn    *txn,
+    uint64_t              near,
     diskfs_inode_cb_t     cb,
     void                 *private_data);
 
@@ -3090,11 +4606,25 @@ diskfs_kv_entry_alloc(
     const void           *value,
     uint32_t              value_len);
 
+static inline uint64_t
+diskfs_inode_prealloc(
+    const struct diskfs_shared *shared,
+    const struct diskfs_inode  *inode);
+
+static inline uint32_t
+diskfs_inode_data_device(
+    const struct diskfs_shared *shared,
+    const struct diskfs_inode  *inode,
+    uint32_t                    role,
+    uint64_t                    file_offset,
+    uint64_t                    len);
+
 static inline int
 diskfs_inode_alloc_space(
     struct diskfs_thread *thread,
     struct diskfs_txn *txn,
     struct diskfs_inode *inode,
+    uint64_t file_offset,
     int64_t desired_size,
     uint64_t floor,
     uint64_t *r_device_id,
@@ -3142,7 +4672,8 @@ diskfs_op_ok(
 
 static inline uint64_t
 diskfs_il_hdr_len(
-    uint32_t nblocks);
+    uint32_t nblocks,
+    uint64_t delta_bytes);
 
 static inline void
 diskfs_txn_commit(
@@ -3184,13 +4715,13 @@ diskfs_metric_counter_add(
 
 static inline void
 diskfs_metric_il_block_io(
-    struct diskfs_intent_log   *il,
-    enum diskfs_metric_io_dir   dir,
-    enum diskfs_metric_io_class class,
-    uint64_t                    bytes)
+    struct diskfs_intent_log_metrics *m,
+    enum diskfs_metric_io_dir         dir,
+    enum diskfs_metric_io_class       class,
+    uint64_t                          bytes)
 {
-    diskfs_metric_counter_inc(il->metrics.block_io_ops[dir][class]);
-    diskfs_metric_counter_add(il->metrics.block_io_bytes[dir][class], bytes);
+    diskfs_metric_counter_inc(m->block_io_ops[dir][class]);
+    diskfs_metric_counter_add(m->block_io_bytes[dir][class], bytes);
 } /* diskfs_metric_il_block_io */
 
 
@@ -3207,21 +4738,22 @@ diskfs_metric_io_device_idx(
 
 static inline void
 diskfs_metric_il_block_io_device(
-    struct diskfs_intent_log   *il,
-    uint32_t                    device_id,
-    enum diskfs_metric_io_dir   dir,
-    enum diskfs_metric_io_class class,
-    uint64_t                    bytes)
+    struct diskfs_intent_log         *il,
+    struct diskfs_intent_log_metrics *m,
+    uint32_t                          device_id,
+    enum diskfs_metric_io_dir         dir,
+    enum diskfs_metric_io_class       class,
+    uint64_t                          bytes)
 {
     struct diskfs_shared *shared = container_of(il, struct diskfs_shared, intent_log);
     size_t                idx;
 
-    if (!il->metrics.block_io_device_ops || device_id >= (uint32_t) shared->num_devices) {
+    if (!m->block_io_device_ops || device_id >= (uint32_t) shared->num_devices) {
         return;
     }
     idx = diskfs_metric_io_device_idx(device_id, dir, class);
-    diskfs_metric_counter_inc(il->metrics.block_io_device_ops[idx]);
-    diskfs_metric_counter_add(il->metrics.block_io_device_bytes[idx], bytes);
+    diskfs_metric_counter_inc(m->block_io_device_ops[idx]);
+    diskfs_metric_counter_add(m->block_io_device_bytes[idx], bytes);
 } /* diskfs_metric_il_block_io_device */
 
 
@@ -3249,17 +4781,21 @@ diskfs_il_used_bytes(struct diskfs_intent_log *il)
 } /* diskfs_il_used_bytes */
 
 
-/* Commit-thread metrics: redo write depth + registered channels. */
+/* Commit-thread metrics: redo write depth + registered channels, summed over
+ * every stream (any commit thread may publish; the high water is advisory). */
 static inline void
 diskfs_il_commit_metrics(struct diskfs_intent_log *il)
 {
-    if (il->redo_inflight > il->redo_inflight_high_water) {
-        il->redo_inflight_high_water = il->redo_inflight;
+    int inflight = __atomic_load_n(&il->redo_inflight, __ATOMIC_RELAXED);
+
+    if (inflight > __atomic_load_n(&il->redo_inflight_high_water, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&il->redo_inflight_high_water, inflight, __ATOMIC_RELAXED);
     }
-    diskfs_metric_gauge_set(il->metrics.redo_inflight, il->redo_inflight);
-    diskfs_metric_gauge_set(il->metrics.registered_channels, il->num_channels);
+    diskfs_metric_gauge_set(il->metrics.redo_inflight, inflight);
+    diskfs_metric_gauge_set(il->metrics.registered_channels,
+                            __atomic_load_n(&il->num_channels, __ATOMIC_RELAXED));
     diskfs_metric_gauge_set(il->metrics.redo_inflight_high_water,
-                            il->redo_inflight_high_water);
+                            __atomic_load_n(&il->redo_inflight_high_water, __ATOMIC_RELAXED));
 } /* diskfs_il_commit_metrics */
 
 
@@ -3328,6 +4864,18 @@ diskfs_metric_block_cache(
 } /* diskfs_metric_block_cache */
 
 
+static inline void
+diskfs_metric_dcache(
+    struct diskfs_thread        *thread,
+    enum diskfs_metric_dcache_op op,
+    uint64_t                     blocks)
+{
+    if (thread) {
+        diskfs_metric_counter_add(thread->metrics.dcache[op], blocks);
+    }
+} /* diskfs_metric_dcache */
+
+
 static inline void
 diskfs_metric_mtime(
     struct diskfs_thread       *thread,
@@ -3339,6 +4887,78 @@ diskfs_metric_mtime(
 } /* diskfs_metric_mtime */
 
 
+static inline void
+diskfs_metric_defrag(
+    struct diskfs_thread        *thread,
+    enum diskfs_metric_defrag_op op,
+    uint64_t                     count)
+{
+    if (thread) {
+        diskfs_metric_counter_add(thread->metrics.defrag[op], count);
+    }
+} /* diskfs_metric_defrag */
+
+
+static inline void
+diskfs_metric_discard(
+    struct diskfs_thread         *thread,
+    enum diskfs_metric_discard_op op,
+    uint64_t                      count)
+{
+    if (thread) {
+        diskfs_metric_counter_add(thread->metrics.discard[op], count);
+    }
+} /* diskfs_metric_discard */
+
+
+static inline void
+diskfs_metric_compress(
+    struct diskfs_thread          *thread,
+    enum diskfs_metric_compress_op op,
+    uint64_t                       count)
+{
+    if (thread) {
+        diskfs_metric_counter_add(thread->metrics.compress[op], count);
+    }
+} /* diskfs_metric_compress */
+
+
+static inline void
+diskfs_metric_csum(
+    struct diskfs_thread      *thread,
+    enum diskfs_metric_csum_op op,
+    uint64_t                   count)
+{
+    if (thread) {
+        diskfs_metric_counter_add(thread->metrics.csum[op], count);
+    }
+} /* diskfs_metric_csum */
+
+
+static inline void
+diskfs_metric_snap(
+    struct diskfs_thread      *thread,
+    enum diskfs_metric_snap_op op,
+    uint64_t                   count)
+{
+    if (thread) {
+        diskfs_metric_counter_add(thread->metrics.snap[op], count);
+    }
+} /* diskfs_metric_snap */
+
+
+static inline void
+diskfs_metric_btree(
+    struct diskfs_thread       *thread,
+    enum diskfs_metric_btree_op op,
+    uint64_t                    count)
+{
+    if (thread) {
+        diskfs_metric_counter_add(thread->metrics.btree[op], count);
+    }
+} /* diskfs_metric_btree */
+
+
 static inline void
 diskfs_metric_block_io(
     struct diskfs_thread       *thread,
@@ -3437,6 +5057,74 @@ diskfs_inode_shard(
 } /* diskfs_inode_shard */
 
 
+/* Bucket head for inum; the low hash bits already chose the shard. */
+static inline struct diskfs_inode **
+diskfs_inode_bucket(
+    struct diskfs_inode_shard *shard,
+    uint64_t                   inum)
+{
+    return &shard->buckets[(diskfs_inum_hash(inum) >> 8) & shard->bucket_mask];
+} /* diskfs_inode_bucket */
+
+
+/*
+ * Find a resident inode.  The caller holds either the shard lock or an rcu
+ * read-side critical section; in the latter case the struct stays valid
+ * until rcu_read_unlock but may be unhashed concurrently, so anything acted
+ * upon must be rechecked (inode->hashed) under the shard lock.
+ */
+static inline struct diskfs_inode *
+diskfs_inode_cache_lookup(
+    struct diskfs_inode_shard *shard,
+    uint64_t                   inum)
+{
+    struct diskfs_inode *inode;
+
+    for (inode = rcu_dereference(*diskfs_inode_bucket(shard, inum));
+         inode;
+         inode = rcu_dereference(inode->hash_next)) {
+        if (inode->inum == inum) {
+            return inode;
+        }
+    }
+    return NULL;
+} /* diskfs_inode_cache_lookup */
+
+
+/* Publish a fully-initialized inode at the head of its chain. */
+static inline void
+diskfs_inode_cache_link_locked(
+    struct diskfs_inode_shard *shard,
+    struct diskfs_inode       *inode)
+{
+    struct diskfs_inode **head = diskfs_inode_bucket(shard, inode->inum);
+
+    inode->hash_next = *head;
+    inode->hashed    = 1;
+    rcu_assign_pointer(*head, inode);
+    shard->ninodes++;
+} /* diskfs_inode_cache_link_locked */
+
+
+/* Unpublish an inode.  Its hash_next is left intact so a concurrent reader
+ * standing on it still reaches the rest of the chain; free it through
+ * diskfs_inode_struct_retire. */
+static inline void
+diskfs_inode_cache_unlink_locked(
+    struct diskfs_inode_shard *shard,
+    struct diskfs_inode       *inode)
+{
+    struct diskfs_inode **pp = diskfs_inode_bucket(shard, inode->inum);
+
+    while (*pp != inode) {
+        pp = &(*pp)->hash_next;
+    }
+    rcu_assign_pointer(*pp, inode->hash_next);
+    inode->hashed = 0;
+    shard->ninodes--;
+} /* diskfs_inode_cache_unlink_locked */
+
+
 static inline struct diskfs_block_waiter *
 diskfs_block_waiter_alloc(struct diskfs_thread *thread)
 {
@@ -3540,7 +5228,7 @@ diskfs_inode_ref_get(
     struct diskfs_inode_shard *shard = diskfs_inode_shard(thread->shared,
                                                           inode->inum);
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
     inode->refcnt++;
     diskfs_inode_lru_unlink(shard, inode);
     pthread_mutex_unlock(&shard->lock);
@@ -3725,22 +5413,39 @@ diskfs_block_bucket(
 } /* diskfs_block_bucket */
 
 
-/* --- shard LRU (caller holds the shard lock) --------------------------- */
+/* --- shard 2Q lists (caller holds the shard lock) ---------------------- */
 
+/* Queue a block that just became a recycle candidate at the MRU end of its
+ * list: hot if it was admitted or marked hot (an interior node always is),
+ * cold otherwise. */
 static inline void
 diskfs_block_lru_push_tail(
     struct diskfs_block_shard *shard,
     struct diskfs_block       *blk)
 {
-    blk->lru_prev = shard->lru_tail;
+    struct diskfs_block **head, **tail;
+
+    if (blk->hot || __atomic_load_n(&blk->interior, __ATOMIC_RELAXED)) {
+        blk->hot    = 1;
+        head        = &shard->hot_head;
+        tail        = &shard->hot_tail;
+        blk->on_lru = DISKFS_BLOCK_LRU_HOT;
+        shard->nhot++;
+    } else {
+        head        = &shard->cold_head;
+        tail        = &shard->cold_tail;
+        blk->on_lru = DISKFS_BLOCK_LRU_COLD;
+        shard->ncold++;
+    }
+
+    blk->lru_prev = *tail;
     blk->lru_next = NULL;
-    if (shard->lru_tail) {
-        shard->lru_tail->lru_next = blk;
+    if (*tail) {
+        (*tail)->lru_next = blk;
     } else {
-        shard->lru_head = blk;
+        *head = blk;
     }
-    shard->lru_tail = blk;
-    blk->on_lru     = 1;
+    *tail = blk;
 } /* diskfs_block_lru_push_tail */
 
 
@@ -3783,6 +5488,9 @@ diskfs_txn_add_block(
     tb->snap_buf     = NULL;
     tb->snap_csum_lo = 0;
     tb->snap_csum_hi = 0;
+    tb->delta        = NULL;
+    tb->delta_len    = 0;
+    tb->journal      = 0;
     tb->next         = txn->blocks;
     txn->blocks      = tb;
 } /* diskfs_txn_add_block */
@@ -3883,6 +5591,188 @@ diskfs_bt_lslots(
 } /* diskfs_bt_lslots */
 
 
+/* Bytes per leaf slot, and where slot 0 starts (past the shared prefix in a
+ * compact leaf). */
+static inline uint32_t
+diskfs_bt_leaf_stride(const struct diskfs_bt_node_hdr *h)
+{
+    return h->key_format ?
+           DISKFS_BT_KFMT_WIDTH(h->key_format) + 2 * sizeof(uint16_t) :
+           sizeof(struct diskfs_bt_lslot);
+} /* diskfs_bt_leaf_stride */
+
+
+static inline uint32_t
+diskfs_bt_leaf_slots_start(const struct diskfs_bt_node_hdr *h)
+{
+    return sizeof(*h) + (h->key_format ? sizeof(uint64_t) : 0);
+} /* diskfs_bt_leaf_slots_start */
+
+
+static inline uint8_t *
+diskfs_bt_leaf_slot(
+    void    *buf,
+    uint32_t base,
+    int      i)
+{
+    struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
+
+    return (uint8_t *) buf + base + diskfs_bt_leaf_slots_start(h) +
+           (uint32_t) i * diskfs_bt_leaf_stride(h);
+} /* diskfs_bt_leaf_slot */
+
+
+static inline uint64_t
+diskfs_bt_leaf_prefix(
+    void    *buf,
+    uint32_t base)
+{
+    uint64_t prefix;
+
+    memcpy(&prefix, (char *) buf + base + sizeof(struct diskfs_bt_node_hdr),
+           sizeof(prefix));
+    return prefix;
+} /* diskfs_bt_leaf_prefix */
+
+
+/* Leaf slot accessors, either format.  Compact slots are unaligned and hold
+ * the subkey's low bytes (little-endian, like every on-disk field). */
+static inline struct diskfs_bt_key
+diskfs_bt_leaf_key(
+    void    *buf,
+    uint32_t base,
+    int      i)
+{
+    struct diskfs_bt_node_hdr *h      = diskfs_bt_hdr(buf, base);
+    struct diskfs_bt_key       k      = { 0 };
+    uint64_t                   suffix = 0;
+
+    if (!h->key_format) {
+        return diskfs_bt_lslots(buf, base)[i].key;
+    }
+    memcpy(&suffix, diskfs_bt_leaf_slot(buf, base, i),
+           DISKFS_BT_KFMT_WIDTH(h->key_format));
+    k.type   = DISKFS_BT_KFMT_TYPE(h->key_format);
+    k.subkey = diskfs_bt_leaf_prefix(buf, base) | suffix;
+    return k;
+} /* diskfs_bt_leaf_key */
+
+
+static inline uint32_t
+diskfs_bt_leaf_rec_off(
+    void    *buf,
+    uint32_t base,
+    int      i)
+{
+    struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
+    uint16_t                   off;
+
+    if (!h->key_format) {
+        return diskfs_bt_lslots(buf, base)[i].off;
+    }
+    memcpy(&off, diskfs_bt_leaf_slot(buf, base, i) +
+           DISKFS_BT_KFMT_WIDTH(h->key_format), sizeof(off));
+    return off;
+} /* diskfs_bt_leaf_rec_off */
+
+
+static inline uint32_t
+diskfs_bt_leaf_rec_len(
+    void    *buf,
+    uint32_t base,
+    int      i)
+{
+    struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
+    uint16_t                   len;
+
+    if (!h->key_format) {
+        return diskfs_bt_lslots(buf, base)[i].len;
+    }
+    memcpy(&len, diskfs_bt_leaf_slot(buf, base, i) +
+           DISKFS_BT_KFMT_WIDTH(h->key_format) + sizeof(uint16_t), sizeof(len));
+    return len;
+} /* diskfs_bt_leaf_rec_len */
+
+
+static inline void *
+diskfs_bt_leaf_rec(
+    void    *buf,
+    uint32_t base,
+    int      i)
+{
+    return (char *) buf + base + diskfs_bt_leaf_rec_off(buf, base, i);
+} /* diskfs_bt_leaf_rec */
+
+
+/* Write slot i; in a compact leaf the key must pass diskfs_bt_leaf_key_fits. */
+static inline void
+diskfs_bt_leaf_set_slot(
+    void                       *buf,
+    uint32_t                    base,
+    int                         i,
+    const struct diskfs_bt_key *key,
+    uint32_t                    off,
+    uint32_t                    len)
+{
+    struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
+    uint8_t                   *s;
+    uint32_t                   w;
+    uint16_t                   off16 = off, len16 = len;
+
+    if (!h->key_format) {
+        struct diskfs_bt_lslot *sl = diskfs_bt_lslots(buf, base);
+
+        sl[i].key = *key;
+        sl[i].off = off;
+        sl[i].len = len;
+        return;
+    }
+    s = diskfs_bt_leaf_slot(buf, base, i);
+    w = DISKFS_BT_KFMT_WIDTH(h->key_format);
+    memcpy(s, &key->subkey, w);
+    memcpy(s + w, &off16, sizeof(off16));
+    memcpy(s + w + sizeof(off16), &len16, sizeof(len16));
+} /* diskfs_bt_leaf_set_slot */
+
+
+/* Whether key can be stored in the leaf's current slot format. */
+static inline int
+diskfs_bt_leaf_key_fits(
+    void                       *buf,
+    uint32_t                    base,
+    const struct diskfs_bt_key *key)
+{
+    struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
+    uint32_t                   w;
+
+    if (!h->key_format) {
+        return 1;
+    }
+    if (key->type != DISKFS_BT_KFMT_TYPE(h->key_format)) {
+        return 0;
+    }
+    w = DISKFS_BT_KFMT_WIDTH(h->key_format);
+    return w >= sizeof(uint64_t) ||
+           ((key->subkey ^ diskfs_bt_leaf_prefix(buf, base)) >> (8 * w)) == 0;
+} /* diskfs_bt_leaf_key_fits */
+
+
+/* Remove slot i, leaving its record as dead heap space. */
+static inline void
+diskfs_bt_leaf_drop(
+    void    *buf,
+    uint32_t base,
+    int      i)
+{
+    struct diskfs_bt_node_hdr *h      = diskfs_bt_hdr(buf, base);
+    uint32_t                   stride = diskfs_bt_leaf_stride(h);
+    uint8_t                   *s      = diskfs_bt_leaf_slot(buf, base, i);
+
+    memmove(s, s + stride, (h->nitems - 1 - i) * stride);
+    h->nitems--;
+} /* diskfs_bt_leaf_drop */
+
+
 static inline void
 diskfs_bt_node_init(
     void    *buf,
@@ -3892,13 +5782,13 @@ diskfs_bt_node_init(
 {
     struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
 
-    h->level     = level;
-    h->nitems    = 0;
-    h->capacity  = capacity;
-    h->free_end  = capacity;
-    h->reserved  = 0;
-    h->next_leaf = 0;
-    h->prev_leaf = 0;
+    h->level      = level;
+    h->nitems     = 0;
+    h->capacity   = capacity;
+    h->free_end   = capacity;
+    h->key_format = 0;
+    h->next_leaf  = 0;
+    h->prev_leaf  = 0;
 } /* diskfs_bt_node_init */
 
 
@@ -3911,8 +5801,8 @@ diskfs_bt_leaf_underflow(
     uint32_t base)
 {
     struct diskfs_bt_node_hdr *h    = diskfs_bt_hdr(buf, base);
-    uint32_t                   used = h->nitems * sizeof(struct diskfs_bt_lslot) +
-        (h->capacity - h->free_end);
+    uint32_t                   used = diskfs_bt_leaf_slots_start(h) - sizeof(*h) +
+        h->nitems * diskfs_bt_leaf_stride(h) + (h->capacity - h->free_end);
 
     return used * 2 < h->capacity;
 } /* diskfs_bt_leaf_underflow */
@@ -3997,6 +5887,20 @@ diskfs_ext_from_op(
 } /* diskfs_ext_from_op */
 
 
+/* Device bytes an extent of `length` logical bytes holds: the whole blob for
+ * a compressed one (however short its head), else its blocks. */
+static inline uint64_t
+diskfs_ext_phys_len(
+    uint64_t length,
+    uint32_t flags)
+{
+    if (flags & DISKFS_EXT_COMPRESSED) {
+        return (uint64_t) (flags >> DISKFS_EXT_PBLK_SHIFT) * DISKFS_BLOCK_SIZE;
+    }
+    return SM_ALIGN_UP(length);
+} /* diskfs_ext_phys_len */
+
+
 
 /*
  * Allocate a bare inode struct for a freshly-minted inum.  The 4 KiB
@@ -4022,10 +5926,26 @@ diskfs_inode_struct_free(struct diskfs_inode *inode)
 {
     free(inode->acl_serial);
     free(inode->pnfs_blob);
+    free(inode->inline_data);
     free(inode);
 } /* diskfs_inode_struct_free */
 
 
+static inline void
+diskfs_inode_struct_free_rcu(struct rcu_head *head)
+{
+    diskfs_inode_struct_free(caa_container_of(head, struct diskfs_inode, rcu));
+} /* diskfs_inode_struct_free_rcu */
+
+
+/* Free an unhashed inode once no lock-free lookup can still hold it. */
+static inline void
+diskfs_inode_struct_retire(struct diskfs_inode *inode)
+{
+    call_rcu(&inode->rcu, diskfs_inode_struct_free_rcu);
+} /* diskfs_inode_struct_retire */
+
+
 static inline void
 diskfs_inode_cache_insert(
     struct diskfs_shared *shared,
@@ -4034,14 +5954,14 @@ diskfs_inode_cache_insert(
     struct diskfs_inode_shard *shard = diskfs_inode_shard(shared, inode->inum);
     struct diskfs_inode       *stale;
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
 
     /* A reallocated inum can collide with the previous life's retired struct
      * (kept cached through its background drain).  By the time the space map
      * re-issued the home block, the drain fully retired it -- dead, unlocked,
      * unreferenced -- so it can be replaced; any straggling lookup by the old
      * generation gets ENOENT from the new struct's gen check. */
-    rb_tree_query_exact(&shard->inodes, inode->inum, inum, stale);
+    stale = diskfs_inode_cache_lookup(shard, inode->inum);
     if (stale) {
         chimera_diskfs_abort_if(stale->nlink != 0 || stale->refcnt != 0 ||
                                 stale->writer || stale->readers ||
@@ -4050,14 +5970,12 @@ diskfs_inode_cache_insert(
                                 "is still live", inode->inum);
         diskfs_inode_lru_unlink(shard, stale);
         diskfs_inode_mtime_unlink_locked(shard, stale);
-        rb_tree_remove(&shard->inodes, &stale->node);
-        shard->ninodes--;
-        diskfs_inode_struct_free(stale);
+        diskfs_inode_cache_unlink_locked(shard, stale);
+        diskfs_inode_struct_retire(stale);
     }
 
     diskfs_inode_cache_recycle_locked(shared, shard);
-    rb_tree_insert(&shard->inodes, inum, inode);
-    shard->ninodes++;
+    diskfs_inode_cache_link_locked(shard, inode);
     pthread_mutex_unlock(&shard->lock);
 } /* diskfs_inode_cache_insert */
 
@@ -4065,18 +5983,24 @@ diskfs_inode_cache_insert(
 /*
  * Allocate a new inode: grab a 4 KiB metadata block from the space map to
  * mint the inum, create the in-memory inode, publish it write-locked into
- * the cache, and record it in the transaction.
+ * the cache, and record it in the transaction.  `near` is an inum whose
+ * device the new inode should share (the parent directory, so a small file
+ * stays beside it); 0 spreads new inodes over the devices by weight, which
+ * is what a new directory wants.
  */
 static inline void
 diskfs_inode_alloc_async(
     struct diskfs_thread *thread,
     struct diskfs_txn    *txn,
+    uint64_t              near,
     diskfs_inode_cb_t     cb,
     void                 *private_data)
 {
     struct diskfs_shared          *shared = thread->shared;
     struct diskfs_inode           *inode;
     struct diskfs_inode_alloc_ctx *actx;
+    struct sm_thread_cache        *cache  = &thread->space_cache;
+    uint32_t                       hint   = SM_DEVICE_ANY;
     uint32_t                       device_id;
     uint64_t                       device_offset, inum;
     uint32_t                       gen;
@@ -4087,6 +6011,7 @@ diskfs_inode_alloc_async(
     actx               = malloc(sizeof(*actx));
     actx->thread       = thread;
     actx->txn          = txn;
+    actx->near         = near;
     actx->cb           = cb;
     actx->private_data = private_data;
 
@@ -4097,10 +6022,17 @@ diskfs_inode_alloc_async(
         return;     /* parked; diskfs_inode_alloc_resume re-runs (owns actx) */
     }
 
+    /* A placed inode draws from that device's own reservation, so locality
+     * requests for different devices do not churn one shared cache. */
+    if (near && shared->num_devices > 1) {
+        sm_inum_to_device_offset(shared->space_map, near, &hint);
+        cache = &thread->near_cache[hint];
+    }
+
     DISKFS_SM_JNL(jnl, thread, txn, diskfs_inode_alloc_resume, actx);
-    rc = space_map_alloc(shared->space_map, &thread->space_cache, &jnl,
+    rc = space_map_alloc(shared->space_map, cache, &jnl,
                          SM_DEV_LOCAL, SM_BLOCK_SIZE, SM_RESERVATION_MIN,
-                         &device_id, &device_offset);
+                         hint, &device_id, &device_offset);
     if (rc == SM_AGAIN) {
         return;     /* parked; diskfs_inode_alloc_resume re-runs (owns actx) */
     }
@@ -4184,13 +6116,73 @@ diskfs_kv_entry_alloc(
 } /* diskfs_kv_entry_alloc */
 
 
+/* Reservation floor for a write into `inode` (see DISKFS_PREALLOC_MAX_DEFAULT). */
+static inline uint64_t
+diskfs_inode_prealloc(
+    const struct diskfs_shared *shared,
+    const struct diskfs_inode  *inode)
+{
+    uint64_t want = SM_RESERVATION_MIN;
+
+    if (inode->extsize) {
+        return inode->extsize;
+    }
+    while (want < inode->size && want < shared->prealloc_max) {
+        want <<= 1;
+    }
+    return want < shared->prealloc_max ? want : shared->prealloc_max;
+} /* diskfs_inode_prealloc */
+
+
+/*
+ * Data device for the bytes of `inode` at [file_offset, +len).  The head of a
+ * file (below stripe_chunk) stays on the inode's own device when that holds
+ * data, so small files sit beside their metadata; past it, each stripe unit
+ * goes to the next device of the role's weighted placement order, starting
+ * at a per-file point so concurrent large files do not march in lockstep.
+ * A write is never split: one wider than the chunk is its own stripe unit.
+ */
+static inline uint32_t
+diskfs_inode_data_device(
+    const struct diskfs_shared *shared,
+    const struct diskfs_inode  *inode,
+    uint32_t                    role,
+    uint64_t                    file_offset,
+    uint64_t                    len)
+{
+    const struct space_map *sm    = shared->space_map;
+    uint64_t                chunk = shared->stripe_chunk;
+    uint64_t                unit;
+    uint32_t                dev_id;
+
+    if (!chunk || space_map_role_devices(sm, role) < 2) {
+        return SM_DEVICE_ANY;
+    }
+
+    if (file_offset < chunk) {
+        if (role != SM_DEV_LOCAL) {
+            return SM_DEVICE_ANY;
+        }
+        sm_inum_to_device_offset(sm, inode->inum, &dev_id);
+        return dev_id;
+    }
+
+    unit = len > chunk ? (len + chunk - 1) / chunk * chunk : chunk;
+    return space_map_stripe_device(sm, role,
+                                   (inode->inum * 0x9E3779B97F4A7C15ULL) >> 32,
+                                   file_offset / unit);
+} /* diskfs_inode_data_device */
+
+
 /*
  * Allocate file-data backing for `inode` from its own per-open-file reservation
  * (inode->space_resv) rather than a shared per-thread cache, so a file's blocks
  * lay out sequentially and the unused tail is returned when the file is closed
  * (not stranded per-thread).  `floor` is the over-reserve minimum: writes pass
- * SM_RESERVATION_MIN (reserve 1 MiB or the write, whichever is larger, and keep
- * the rest for the next write); fallocate passes 0 (exact, no retained tail).
+ * diskfs_inode_prealloc (at least 1 MiB, more for a hinted or growing file, and
+ * keep the rest for the next write); fallocate passes 0 (exact, no retained
+ * tail).  `file_offset` places the bytes (diskfs_inode_data_device); while
+ * striping, the reservation never runs past one stripe unit.
  * Must be called with the inode write-locked (the data path holds it).  Returns
  * SM_AGAIN on a journal-block miss (caller's resume re-drives), ENOSPC, or 0.
  */
@@ -4199,6 +6191,7 @@ diskfs_inode_alloc_space(
     struct diskfs_thread *thread,
     struct diskfs_txn *txn,
     struct diskfs_inode *inode,
+    uint64_t file_offset,
     int64_t desired_size,
     uint64_t floor,
     uint64_t *r_device_id,
@@ -4206,7 +6199,7 @@ diskfs_inode_alloc_space(
     void ( *resume )(struct diskfs_thread *, void *),
     void *resume_arg)
 {
-    uint32_t          dev_id;
+    uint32_t          dev_id, hint;
     int               rc;
     struct space_map *sm = thread->shared->space_map;
 
@@ -4215,10 +6208,16 @@ diskfs_inode_alloc_space(
      * classes never collide. */
     uint32_t          role = space_map_has_remote(sm) ? SM_DEV_REMOTE : SM_DEV_LOCAL;
 
+    hint = diskfs_inode_data_device(thread->shared, inode, role, file_offset,
+                                    (uint64_t) desired_size);
+    if (hint != SM_DEVICE_ANY && floor > thread->shared->stripe_chunk) {
+        floor = thread->shared->stripe_chunk;
+    }
+
     DISKFS_SM_JNL(jnl, thread, txn, resume, resume_arg);
     rc = space_map_alloc_volatile_reservation(sm, &inode->space_resv, &jnl,
                                               role, (uint64_t) desired_size,
-                                              floor, &dev_id, r_device_offset);
+                                              floor, hint, &dev_id, r_device_offset);
 
     if (rc == SM_AGAIN) {
         return SM_AGAIN;        /* parked; caller's resume re-drives */
@@ -4242,7 +6241,9 @@ diskfs_thread_free_space(
 {
     /* Pending free: journal now, apply on commit (hardens the data path's
      * abort behavior too -- an aborted txn no longer leaves the range freed
-     * in memory while its redo is discarded). */
+     * in memory while its redo is discarded).  The range's cached data goes
+     * now; nothing reads it once its extent record is gone. */
+    diskfs_dcache_invalidate(thread, device_id, device_offset, length);
     diskfs_txn_free_space(thread, txn, device_id, device_offset, length);
 } /* diskfs_thread_free_space */
 
@@ -4297,6 +6298,8 @@ diskfs_txn_begin(
     txn->num_inodes    = 0;
     txn->blocks        = NULL;
     txn->pending_frees = NULL;
+    txn->pending_csums = NULL;
+    txn->pending_refs  = NULL;
     return txn;
 } /* diskfs_txn_begin */
 
@@ -4318,8 +6321,12 @@ diskfs_txn_abort(struct diskfs_txn *txn)
      * ranges stay allocated).  Drop any blocks the aborted txn pinned (their
      * contents are discarded) and release the inode locks.  NOTE: the in-memory
      * allocator alloc deltas applied during the txn are still not rolled back
-     * here -- a pre-existing transaction-atomicity gap, separate from frees. */
+     * here -- a pre-existing transaction-atomicity gap, separate from frees.
+     * Checksums of data the txn wrote, and references it took, are dropped
+     * with it. */
     diskfs_txn_discard_frees(txn);
+    diskfs_csum_discard(txn);
+    diskfs_ref_discard(txn);
     diskfs_txn_unpin_blocks(txn, DISKFS_BLOCK_CLEAN);
     diskfs_txn_unlock_all(txn);
     diskfs_txn_release(txn);
@@ -4357,16 +6364,20 @@ diskfs_op_ok(
 
 /*
  * On-log record layout (all 4 KiB-aligned for zero-copy scatter-gather):
- *   [ header region: redo_header + num_blocks * redo_block_header, 4K-padded ]
- *   [ block 0 data (4 KiB) ][ block 1 data ] ... [ block N-1 data ]
- * The header region is materialized into one iovec; each data block is a
+ *   [ header region: redo_header + num_blocks * redo_block_header
+ *     + delta payloads, 4K-padded ]
+ *   [ full block 0 data (4 KiB) ][ full block 1 data ] ...
+ * The header region is materialized into one iovec; each full data block is a
  * zero-copy clone of the cache block's buffer.
  */
 static inline uint64_t
-diskfs_il_hdr_len(uint32_t nblocks)
+diskfs_il_hdr_len(
+    uint32_t nblocks,
+    uint64_t delta_bytes)
 {
     uint64_t h = sizeof(struct diskfs_redo_header) +
-        (uint64_t) nblocks * sizeof(struct diskfs_redo_block_header);
+        (uint64_t) nblocks * sizeof(struct diskfs_redo_block_header) +
+        delta_bytes;
 
     return (h + DISKFS_BLOCK_SIZE - 1) & ~((uint64_t) DISKFS_BLOCK_SIZE - 1);
 } /* diskfs_il_hdr_len */
@@ -4394,25 +6405,31 @@ diskfs_txn_commit(
      * whose data went straight to the device.  Unlock inline like a read txn;
      * routing it through the intent log would write a header-only record per
      * write and defeat the deferral. */
-    if (!txn->blocks && !txn->pending_frees) {
+    if (!txn->blocks && !txn->pending_frees && !txn->pending_csums &&
+        !txn->pending_refs) {
         diskfs_txn_unlock_all(txn);
         cb(txn, 0, private_data);
         diskfs_txn_release(txn);
         return;
     }
 
-    /* Journal the deferred FREE deltas before block serialization + snapshot,
-     * so the FREE-delta log blocks ride this txn's redo.  The journal claim is
-     * async: a cold log block parks the request and the flush returns SM_AGAIN,
-     * so commit defers and diskfs_commit_resume finishes once it loads. */
-    if (txn->pending_frees) {
+    /* Settle extent references first (a free of a shared block becomes a
+     * decrement), then journal the deferred FREE deltas before block
+     * serialization + snapshot, so the FREE-delta log blocks ride this txn's
+     * redo, then store the data checksums the same way.  The claims are
+     * async: a cold log, reference or checksum table block parks the request
+     * and the flush returns SM_AGAIN, so commit defers and
+     * diskfs_commit_resume finishes once it loads. */
+    if (txn->pending_frees || txn->pending_csums || txn->pending_refs) {
         struct diskfs_commit_ctx *c = malloc(sizeof(*c));
 
         c->txn          = txn;
         c->cb           = cb;
         c->private_data = private_data;
 
-        if (diskfs_txn_flush_free_journals(thread, txn, c) == SM_AGAIN) {
+        if (diskfs_ref_flush(thread, txn, c) == SM_AGAIN ||
+            diskfs_txn_flush_free_journals(thread, txn, c) == SM_AGAIN ||
+            diskfs_csum_flush(thread, txn, c) == SM_AGAIN) {
             return;     /* parked; diskfs_commit_resume continues */
         }
         free(c);
@@ -4435,7 +6452,14 @@ diskfs_map_attrs(
 
     if (attr->va_req_mask & CHIMERA_VFS_ATTR_FH) {
         attr->va_set_mask |= CHIMERA_VFS_ATTR_FH;
-        attr->va_fh_len    = diskfs_inum_to_fh(shared, attr->va_fh, inode->inum, inode->gen);
+        /* A snapshot inode's handle names the snapshot mount id, which the
+         * VFS reaches only through a read-only mount of ".snapshot". */
+        if (inode->flags & DISKFS_INODE_F_SNAPSHOT) {
+            attr->va_fh_len = chimera_vfs_encode_fh_inum_parent(shared->snap_fh, inode->inum,
+                                                                inode->gen, attr->va_fh);
+        } else {
+            attr->va_fh_len = diskfs_inum_to_fh(shared, attr->va_fh, inode->inum, inode->gen);
+        }
     }
 
     if (attr->va_req_mask & CHIMERA_VFS_ATTR_MASK_STAT) {
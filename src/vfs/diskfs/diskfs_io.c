@@ -3,10 +3,10 @@
 // SPDX-License-Identifier: LGPL-2.1-only
 
 /*
- * File I/O: extent records over the inode b+tree, per-open-file space
- * reservations, read, write (in-place, redirect and RMW paths),
- * allocate/deallocate (fallocate), seek (SEEK_HOLE/SEEK_DATA) and the
- * COMMIT operation.
+ * File I/O: extent and inline-data records over the inode b+tree,
+ * per-open-file space reservations, read, write (inline, in-place, redirect
+ * and RMW paths), allocate/deallocate (fallocate), seek (SEEK_HOLE/SEEK_DATA)
+ * and the COMMIT operation.
  */
 
 #include "diskfs_internal.h"
@@ -76,6 +76,12 @@ diskfs_write_reported_sync(
     return CHIMERA_VFS_WRITE_FILESYNC;
 } /* diskfs_write_reported_sync */
 
+static void
+diskfs_inode_load_recs_inline_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data);
+
 static void
 diskfs_inode_load_recs_pnfs_cb(
     struct diskfs_bt_op *op,
@@ -123,6 +129,14 @@ diskfs_io_gate(
     struct chimera_vfs_request *request,
     void (                     *resume )(struct chimera_vfs_request *));
 
+static void
+diskfs_read_fill_cache(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_read_complete(
+    struct chimera_vfs_request *request);
+
 static inline void
 diskfs_io_callback(
     struct evpl *evpl,
@@ -143,6 +157,27 @@ static void
 diskfs_read_advance(
     struct chimera_vfs_request *request);
 
+static void
+diskfs_read_compressed_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data);
+
+static void
+diskfs_read_compressed(
+    struct chimera_vfs_request *request,
+    const struct diskfs_extent *extent,
+    uint64_t                    skip,
+    uint64_t                    length);
+
+static int
+diskfs_read_chunk_csum(
+    struct chimera_vfs_request *request,
+    uint32_t                    device_id,
+    uint64_t                    dev_offset,
+    uint64_t                    chunk,
+    struct evpl_iovec          *chunk_iov);
+
 static void
 diskfs_read_process(
     struct chimera_vfs_request *request);
@@ -169,6 +204,11 @@ diskfs_write_rmw_read_callback(
     int          status,
     void        *private_data);
 
+static void
+diskfs_write_rmw_verify(
+    struct diskfs_thread *thread,
+    void                 *arg);
+
 static void
 diskfs_write_phase2(
     struct diskfs_thread       *thread,
@@ -197,10 +237,104 @@ diskfs_ext_put_floor_cb(
     int                  result,
     void                *private_data);
 
+static void
+diskfs_inflate_fail(
+    struct chimera_vfs_request *request,
+    int                         status);
+
+static void
+diskfs_inflate_inserted_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data);
+
+static void
+diskfs_inflate_removed_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data);
+
+static void
+diskfs_inflate_write_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data);
+
+static void
+diskfs_inflate_alloc(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_inflate_alloc_resume(
+    struct diskfs_thread *thread,
+    void                 *arg);
+
+static void
+diskfs_inflate_read_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data);
+
+static void
+diskfs_inflate_start(
+    struct chimera_vfs_request *request,
+    void (                     *cont )(struct chimera_vfs_request *));
+
+static void
+diskfs_inline_store_inserted_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data);
+
+static void
+diskfs_inline_store_insert(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_inline_store_removed_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data);
+
+static void
+diskfs_inline_promote_removed_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data);
+
+static void
+diskfs_inline_promote_written(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data);
+
+static void
+diskfs_inline_promote_submit(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_inline_promote_alloc(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_inline_promote_alloc_resume(
+    struct diskfs_thread *thread,
+    void                 *arg);
+
+static int
+diskfs_write_stamp(
+    struct chimera_vfs_request *request,
+    struct diskfs_inode        *inode,
+    const struct timespec      *now);
+
 static void
 diskfs_write_finish_map(
     struct chimera_vfs_request *request);
 
+static void
+diskfs_write_zc_put(
+    struct chimera_vfs_request *request);
+
 static void
 diskfs_write_trim_done(
     struct chimera_vfs_request *request);
@@ -285,18 +419,55 @@ static void
 diskfs_write_prefix_lookup(
     struct chimera_vfs_request *request);
 
+static void
+diskfs_write_inline_done(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_write_inline(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_write_inline_probe_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data);
+
 static void
 diskfs_write_inode_cb(
     struct diskfs_inode *inode,
     int                  status,
     void                *private_data);
 
+static void
+diskfs_write_classify_start(
+    struct chimera_vfs_request *request);
+
 static void
 diskfs_write_classify_cb(
     struct diskfs_bt_op *op,
     int                  result,
     void                *private_data);
 
+static void
+diskfs_write_inplace(
+    struct chimera_vfs_request *request,
+    const struct diskfs_extent *e);
+
+static void
+diskfs_write_shared_check(
+    struct diskfs_thread *thread,
+    void                 *arg);
+
+static uint32_t
+diskfs_write_compress_units(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_write_compress(
+    struct chimera_vfs_request *request,
+    uint32_t                    nunits);
+
 static void
 diskfs_write_redirect_alloc(
     struct chimera_vfs_request *request);
@@ -447,6 +618,10 @@ diskfs_allocate_inode_cb(
     int                  status,
     void                *private_data);
 
+static void
+diskfs_allocate_start(
+    struct chimera_vfs_request *request);
+
 static void
 diskfs_seek_walk_cb(
     struct diskfs_bt_op *op,
@@ -712,9 +887,8 @@ diskfs_inode_cache_recycle_locked(
                                 inode->inum);
 
         diskfs_inode_lru_unlink(shard, inode);
-        rb_tree_remove(&shard->inodes, &inode->node);
-        shard->ninodes--;
-        diskfs_inode_struct_free(inode);
+        diskfs_inode_cache_unlink_locked(shard, inode);
+        diskfs_inode_struct_retire(inode);
         return;
     }
 } /* diskfs_inode_cache_recycle_locked */
@@ -737,26 +911,65 @@ diskfs_inode_load_recs_done(struct diskfs_inode_load_ctx *lc)
         memcpy(inode->pnfs_blob, lc->pnfs_rec, lc->pnfs_len);
         inode->pnfs_blob_len = (uint32_t) lc->pnfs_len;
     }
+    if (lc->inline_len >= 0) {
+        inode->inline_data = malloc(lc->inline_len ? lc->inline_len : 1);
+        memcpy(inode->inline_data, lc->inline_rec, lc->inline_len);
+        inode->inline_len = (uint32_t) lc->inline_len;
+    }
 
     diskfs_inode_release_one(thread, inode, DISKFS_INODE_LOCK_WRITE);
 
-    diskfs_inode_acquire(thread, lc->txn, lc->inum, lc->gen, lc->mode,
-                         lc->cb, lc->private_data);
+    if (lc->cb) {
+        diskfs_inode_acquire(thread, lc->txn, lc->inum, lc->gen, lc->mode,
+                             lc->cb, lc->private_data);
+    } else {
+        thread->prefetching--;
+    }
     free(lc);
 } /* diskfs_inode_load_recs_done */
 
 
 static void
-diskfs_inode_load_recs_pnfs_cb(
+diskfs_inode_load_recs_inline_cb(
     struct diskfs_bt_op *op,
     int                  result,
     void                *private_data)
 {
     struct diskfs_inode_load_ctx *lc = private_data;
 
-    lc->pnfs_len = result;
+    lc->inline_len = result;
     diskfs_bt_op_free(lc->thread, op);
     diskfs_inode_load_recs_done(lc);
+} /* diskfs_inode_load_recs_inline_cb */
+
+
+static void
+diskfs_inode_load_recs_pnfs_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data)
+{
+    struct diskfs_inode_load_ctx *lc    = private_data;
+    struct diskfs_inode          *inode = lc->inode;
+
+    lc->pnfs_len = result;
+    diskfs_bt_op_free(lc->thread, op);
+
+    /* Only a small regular file can be inline; skip the probe otherwise. */
+    lc->inline_len = -1;
+    if (!S_ISREG(inode->mode) || inode->size == 0 ||
+        inode->size > DISKFS_INLINE_DATA_MAX) {
+        diskfs_inode_load_recs_done(lc);
+        return;
+    }
+
+    op = diskfs_bt_op_alloc(lc->thread);
+    if (diskfs_bt_lookup_async(op, lc->thread, inode,
+                               DISKFS_BT_OP_LOOKUP_EXACT, &diskfs_inline_key,
+                               NULL, lc->inline_rec, sizeof(lc->inline_rec),
+                               diskfs_inode_load_recs_inline_cb, lc)) {
+        diskfs_inode_load_recs_inline_cb(op, op->result, lc);
+    }
 } /* diskfs_inode_load_recs_pnfs_cb */
 
 
@@ -812,13 +1025,17 @@ diskfs_inode_load_complete(
         di->nlink == 0) {
         /* No such inode on disk (or stale generation). */
         evpl_iovec_release(thread->evpl, &lc->iov);
-        lc->cb(NULL, CHIMERA_VFS_ENOENT, lc->private_data);
+        if (lc->cb) {
+            lc->cb(NULL, CHIMERA_VFS_ENOENT, lc->private_data);
+        } else {
+            thread->prefetching--;
+        }
         free(lc);
         return;
     }
 
-    pthread_mutex_lock(&shard->lock);
-    rb_tree_query_exact(&shard->inodes, lc->inum, inum, inode);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
+    inode = diskfs_inode_cache_lookup(shard, lc->inum);
     if (!inode) {
         diskfs_inode_cache_recycle_locked(shared, shard);
         inode                 = diskfs_inode_struct_new(lc->inum);
@@ -841,20 +1058,25 @@ diskfs_inode_load_complete(
         inode->dos_attributes = di->dos_attributes;
         inode->parent_inum    = di->parent_inum;
         inode->parent_gen     = di->parent_gen;
+        inode->extsize        = di->extsize;
+        inode->flags          = di->flags;
         /* Publish write-locked, held by this fault: nobody can grant (or
          * modify the tree) until the record loads below finish; concurrent
          * acquirers park as ordinary lock waiters. */
         inode->writer = 1;
-        rb_tree_insert(&shard->inodes, inum, inode);
-        shard->ninodes++;
+        diskfs_inode_cache_link_locked(shard, inode);
         diskfs_metric_inode_cache(thread, DISKFS_METRIC_INODE_CACHE_LOAD);
     } else {
         /* Lost a concurrent fault race: the winner published the inode (and
          * does/did its own record loads).  Just re-drive the acquire. */
         pthread_mutex_unlock(&shard->lock);
         evpl_iovec_release(thread->evpl, &lc->iov);
-        diskfs_inode_acquire(thread, lc->txn, lc->inum, lc->gen, lc->mode,
-                             lc->cb, lc->private_data);
+        if (lc->cb) {
+            diskfs_inode_acquire(thread, lc->txn, lc->inum, lc->gen, lc->mode,
+                                 lc->cb, lc->private_data);
+        } else {
+            thread->prefetching--;
+        }
         free(lc);
         return;
     }
@@ -879,7 +1101,7 @@ diskfs_inode_load_complete(
 
     evpl_iovec_release(thread->evpl, &lc->iov);
 
-    /* Load the ACL/pNFS record mirrors, then release the hold and re-drive
+    /* Load the ACL/pNFS/inline-data record mirrors, then release the hold and re-drive
      * the acquire to grant the lock as usual. */
     lc->inode = inode;
     diskfs_inode_load_recs(lc);
@@ -919,6 +1141,41 @@ diskfs_inode_load(
 } /* diskfs_inode_load */
 
 
+/*
+ * Fault an inode into the cache ahead of use, without locking it or waiting
+ * for it: the same load as a cold acquire, minus the grant at the end (a
+ * load with no callback).  An acquirer that arrives while the fault is in
+ * flight parks on the loader's hold and is granted once it lands.  Skipped
+ * when the inode is already resident or this thread already has
+ * DISKFS_INODE_PREFETCH_MAX prefetches outstanding.
+ */
+void
+diskfs_inode_prefetch(
+    struct diskfs_thread *thread,
+    uint64_t              inum,
+    uint32_t              gen)
+{
+    struct diskfs_inode_shard *shard = diskfs_inode_shard(thread->shared, inum);
+    struct diskfs_inode       *inode;
+
+    if (thread->prefetching >= DISKFS_INODE_PREFETCH_MAX ||
+        !sm_inum_valid(thread->shared->space_map, inum)) {
+        return;
+    }
+
+    rcu_read_lock();
+    inode = diskfs_inode_cache_lookup(shard, inum);
+    rcu_read_unlock();
+    if (inode) {
+        return;
+    }
+
+    thread->prefetching++;
+    diskfs_metric_inode_cache(thread, DISKFS_METRIC_INODE_CACHE_PREFETCH);
+    diskfs_inode_load(thread, NULL, inum, gen, DISKFS_INODE_LOCK_READ, NULL, NULL);
+} /* diskfs_inode_prefetch */
+
+
 void
 diskfs_inode_alloc_resume(
     struct diskfs_thread *thread,
@@ -928,7 +1185,7 @@ diskfs_inode_alloc_resume(
 
     (void) thread;
     free(arg);
-    diskfs_inode_alloc_async(c.thread, c.txn, c.cb, c.private_data);
+    diskfs_inode_alloc_async(c.thread, c.txn, c.near, c.cb, c.private_data);
 } /* diskfs_inode_alloc_resume */
 
 
@@ -1055,6 +1312,96 @@ diskfs_io_resume_waiters(struct diskfs_thread *thread)
 } /* diskfs_io_resume_waiters */
 
 
+/* Every device chunk of a read has landed: complete its data-cache
+ * reservations from the VFS buffers (or drop them if the read failed). */
+static void
+diskfs_read_fill_cache(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p = request->plugin_data;
+
+    for (int i = 0; i < p->rd_nfill; i++) {
+        diskfs_dcache_fill(p->thread, &p->rd_fill[i], request->read.iov,
+                           request->read.buffers_provided, p->status == 0);
+    }
+    p->rd_nfill = 0;
+} /* diskfs_read_fill_cache */
+
+
+static void
+diskfs_read_complete_resume(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    (void) thread;
+    diskfs_read_complete(arg);
+} /* diskfs_read_complete_resume */
+
+
+/*
+ * Every device chunk of a read has landed: check the blocks read against
+ * their data checksums (a mismatch fails the read with EIO), copy the edge
+ * blocks' slices into place, fill the data cache and finish the op.  A check
+ * parked on a cold checksum-table block re-enters here, at rd_vnext.
+ */
+static void
+diskfs_read_complete(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_csum_span       *span;
+    struct diskfs_csum_edge       *edge;
+    struct evpl_iovec_cursor       cursor;
+    int                            rc, i;
+
+    while (p->status == 0 && p->rd_vnext < p->rd_nverify + p->rd_nedge) {
+        if (p->rd_vnext < p->rd_nverify) {
+            span = &p->rd_verify[p->rd_vnext];
+            rc   = diskfs_csum_verify(thread, span->device_id, span->device_offset,
+                                      span->nblocks, request->read.iov,
+                                      request->read.buffers_provided,
+                                      span->buf_offset,
+                                      diskfs_read_complete_resume, request);
+        } else {
+            edge = &p->rd_edge[p->rd_vnext - p->rd_nverify];
+            rc   = diskfs_csum_verify(thread, edge->device_id, edge->device_offset,
+                                      1, &edge->iov, 1, 0,
+                                      diskfs_read_complete_resume, request);
+        }
+        if (rc == SM_AGAIN) {
+            return;
+        }
+        if (rc) {
+            p->status = CHIMERA_VFS_EIO;
+        }
+        p->rd_vnext++;
+    }
+
+    for (i = 0; i < p->rd_nedge; i++) {
+        edge = &p->rd_edge[i];
+        if (p->status == 0) {
+            evpl_iovec_cursor_init(&cursor, request->read.iov,
+                                   request->read.buffers_provided);
+            evpl_iovec_cursor_skip(&cursor, edge->buf_offset);
+            diskfs_dcache_cursor_put(&cursor, (const uint8_t *) edge->iov.data +
+                                     edge->skip, edge->length);
+        }
+        evpl_iovec_release(thread->evpl, &edge->iov);
+    }
+    p->rd_nedge   = 0;
+    p->rd_nverify = 0;
+    p->rd_vnext   = 0;
+
+    if (p->rd_nfill) {
+        diskfs_read_fill_cache(request);
+    }
+    if (p->status) {
+        diskfs_op_fail(request, p->txn, p->status);
+    } else {
+        diskfs_op_ok(request, p->txn);
+    }
+} /* diskfs_read_complete */
+
+
 static inline void
 diskfs_io_callback(
     struct evpl *evpl,
@@ -1083,7 +1430,9 @@ diskfs_io_callback(
         * request->read.iov itself after the request bounces back. */
         evpl_iovecs_release(thread->evpl, diskfs_private->iov, diskfs_private->niov);
 
-        if (diskfs_private->status != 0) {
+        if (diskfs_private->opcode == CHIMERA_VFS_OP_READ) {
+            diskfs_read_complete(request);
+        } else if (diskfs_private->status != 0) {
             diskfs_op_fail(request, diskfs_private->txn,
                            diskfs_private->status);
         } else {
@@ -1113,10 +1462,12 @@ diskfs_read_finish(struct chimera_vfs_request *request)
     p->io_reading = 0;
 
     if (p->pending == 0) {
-        diskfs_op_ok(request, p->txn);
-    } else if (p->txn->type == DISKFS_TXN_READ) {
+        diskfs_read_complete(request);
+    } else if (p->txn->type == DISKFS_TXN_READ && !thread->shared->data_csum) {
         /* I/O is in flight; drop the inode lock so other ops proceed.  The
-         * txn commits from diskfs_io_callback once all reads complete. */
+         * txn commits from diskfs_io_callback once all reads complete.  With
+         * data checksums the lock is kept: an overwrite committing under the
+         * read would replace the checksums the completion verifies against. */
         diskfs_txn_unlock_inode(p->txn, inode);
     }
     /* A relatime atime bump upgraded this read to a WRITE txn: keep the inode
@@ -1156,60 +1507,291 @@ diskfs_read_advance(struct chimera_vfs_request *request)
 } /* diskfs_read_advance */
 
 
+/* A compressed extent's blob read in flight (diskfs_read_compressed). */
+struct diskfs_zread {
+    struct chimera_vfs_request *request;
+    struct evpl_iovec           iov;
+    uint64_t                    device_offset;
+    uint32_t                    device_id;
+    uint32_t                    buf_offset;   /* slice position in the read buffers */
+    uint32_t                    skip;         /* slice start in the decoded unit */
+    uint32_t                    length;
+    uint32_t                    flags;
+    int                         status;
+};
+
+
+/* The blob has landed (zr->status): verify it against the data checksums,
+ * decode it and copy the slice out.  Re-entered if the check parks on a
+ * checksum-table block. */
 static void
-diskfs_read_process(struct chimera_vfs_request *request)
+diskfs_read_compressed_finish(
+    struct diskfs_thread *thread,
+    void                 *arg)
 {
-    struct diskfs_request_private *p           = request->plugin_data;
-    struct diskfs_thread          *thread      = p->thread;
-    struct diskfs_shared          *shared      = thread->shared;
-    struct evpl                   *evpl        = thread->evpl;
-    struct diskfs_extent          *extent      = &p->ext_iter;
-    uint64_t                       read_offset = p->loop_off;
-    uint64_t                       read_left   = p->loop_left;
-    uint64_t                       aligned_end = p->loop_pos;
-    uint64_t                       extent_end, overlap_start, overlap_length, chunk;
-    uint32_t                       chunk_niov;
-    struct evpl_iovec             *chunk_iov;
-
-    if (!(read_left && p->loop_have && extent->file_offset < aligned_end)) {
-        diskfs_read_finish(request);
-        return;
+    struct diskfs_zread        *zr      = arg;
+    struct chimera_vfs_request *request = zr->request;
+    struct evpl_iovec_cursor    cursor;
+    const void                 *data;
+    uint32_t                    data_len;
+    int                         status = zr->status;
+    int                         rc;
+
+    if (!status) {
+        rc = diskfs_csum_verify(thread, zr->device_id, zr->device_offset,
+                                (uint32_t) (zr->iov.length >> SM_BLOCK_SHIFT),
+                                &zr->iov, 1, 0, diskfs_read_compressed_finish, zr);
+        if (rc == SM_AGAIN) {
+            return;
+        }
+        if (rc ||
+            diskfs_compress_decode(thread, zr->iov.data, zr->flags, &data, &data_len) ||
+            zr->skip + zr->length > data_len) {
+            status = CHIMERA_VFS_EIO;
+        } else {
+            evpl_iovec_cursor_init(&cursor, request->read.iov,
+                                   request->read.buffers_provided);
+            evpl_iovec_cursor_skip(&cursor, zr->buf_offset);
+            diskfs_dcache_cursor_put(&cursor, (const uint8_t *) data + zr->skip,
+                                     zr->length);
+        }
     }
 
-    /* Bound in-flight data I/O: park here (state is fully in p) and resume the
-     * walk from a completion if the queue is at the cap. */
-    if (diskfs_io_gate(thread, request, diskfs_read_process)) {
-        return;
-    }
+    evpl_iovec_release(thread->evpl, &zr->iov);
+    slab_allocator_free(thread->allocator, zr, sizeof(*zr));
 
-    if (read_offset < extent->file_offset) {
-        chunk = extent->file_offset - read_offset;
-        evpl_iovec_cursor_zero(&p->rd_cursor, chunk);
-        read_offset += chunk;
-        read_left   -= chunk;
-    }
+    diskfs_io_callback(thread->evpl, status, request);
+} /* diskfs_read_compressed_finish */
 
-    extent_end     = extent->file_offset + extent->length;
-    overlap_start  = read_offset - extent->file_offset;
-    overlap_length = extent_end - read_offset;
-    if (overlap_length > read_left) {
-        overlap_length = read_left;
-    }
 
-    if (extent->flags & DISKFS_EXT_UNWRITTEN) {
-        /* Space is reserved (fallocate) but was never written: it reads back
-         * as zeros, with no device I/O.  Fill the cursor like a hole and skip
-         * the read loop. */
-        evpl_iovec_cursor_zero(&p->rd_cursor, overlap_length);
+static void
+diskfs_read_compressed_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct diskfs_zread           *zr = private_data;
+    struct diskfs_request_private *p  = zr->request->plugin_data;
+
+    (void) evpl;
+
+    zr->status = status;
+    diskfs_read_compressed_finish(p->thread, zr);
+} /* diskfs_read_compressed_cb */
+
+
+/* Read `length` bytes from `skip` into a compressed extent: the blob decodes
+ * only whole, so it is read aside and the completion copies the slice into
+ * the read buffers at the cursor's current position (which moves past it
+ * now).  The data cache holds device blocks, so it is not consulted. */
+static void
+diskfs_read_compressed(
+    struct chimera_vfs_request *request,
+    const struct diskfs_extent *extent,
+    uint64_t                    skip,
+    uint64_t                    length)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    uint64_t                       phys   = diskfs_ext_phys_len(extent->length, extent->flags);
+    struct diskfs_zread           *zr;
+
+    zr                = slab_allocator_alloc(thread->allocator, sizeof(*zr));
+    zr->request       = request;
+    zr->device_id     = extent->device_id;
+    zr->device_offset = extent->device_offset;
+    zr->buf_offset    = evpl_iovec_cursor_consumed(&p->rd_cursor);
+    zr->skip          = (uint32_t) skip;
+    zr->length        = (uint32_t) length;
+    zr->flags         = extent->flags;
+
+    evpl_iovec_cursor_skip(&p->rd_cursor, length);
+
+    if (evpl_iovec_alloc(thread->evpl, phys, 4096, 1, 0, &zr->iov) < 1) {
+        slab_allocator_free(thread->allocator, zr, sizeof(*zr));
+        p->status = CHIMERA_VFS_EIO;
+        return;
+    }
+
+    p->pending++;
+    diskfs_pending_io_add(thread, 1);
+
+    diskfs_metric_block_io(thread, DISKFS_METRIC_IO_READ,
+                           DISKFS_METRIC_IO_DATA, phys);
+    diskfs_metric_block_io_device(thread, extent->device_id,
+                                  DISKFS_METRIC_IO_READ,
+                                  DISKFS_METRIC_IO_DATA, phys);
+    evpl_block_read(thread->evpl, thread->queue[extent->device_id], &zr->iov, 1,
+                    extent->device_offset, diskfs_read_compressed_cb, zr);
+} /* diskfs_read_compressed */
+
+
+/*
+ * Build the device iovec of a read chunk on a checksummed filesystem, which
+ * verifies whole blocks only: a partial block at either end is read whole
+ * into an edge buffer (its slice is copied out after the check), the whole
+ * blocks between land in the VFS buffers and are recorded as a span.  The
+ * read is then issued at the chunk's block-aligned start.  Returns the
+ * iovec count, or -1 with nothing consumed if the request is out of edge or
+ * span slots and the chunk is read unverified.
+ */
+static int
+diskfs_read_chunk_csum(
+    struct chimera_vfs_request *request,
+    uint32_t                    device_id,
+    uint64_t                    dev_offset,
+    uint64_t                    chunk,
+    struct evpl_iovec          *chunk_iov)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_csum_edge       *edge;
+    struct diskfs_csum_span       *span;
+    struct evpl_iovec              eiov[2];
+    uint32_t                       pad  = (uint32_t) (dev_offset & 4095ULL);
+    uint64_t                       head = 0, mid, tail;
+    int                            nedge = 0, e = 0, niov = 0;
+
+    if (pad) {
+        head = 4096 - pad < chunk ? 4096 - pad : chunk;
+        nedge++;
+    }
+    mid  = (chunk - head) & ~4095ULL;
+    tail = chunk - head - mid;
+    if (tail) {
+        nedge++;
+    }
+
+    if (p->rd_nedge + nedge > DISKFS_CSUM_MAX_EDGES ||
+        (mid && p->rd_nverify >= DISKFS_CSUM_MAX_SPANS)) {
+        return -1;
+    }
+
+    for (e = 0; e < nedge; e++) {
+        if (evpl_iovec_alloc(thread->evpl, 4096, 4096, 1, 0, &eiov[e]) < 1) {
+            while (e--) {
+                evpl_iovec_release(thread->evpl, &eiov[e]);
+            }
+            return -1;
+        }
+    }
+    e = 0;
+
+    if (head) {
+        edge                = &p->rd_edge[p->rd_nedge++];
+        edge->iov           = eiov[e++];
+        edge->device_id     = device_id;
+        edge->device_offset = dev_offset - pad;
+        edge->buf_offset    = evpl_iovec_cursor_consumed(&p->rd_cursor);
+        edge->skip          = pad;
+        edge->length        = (uint32_t) head;
+        evpl_iovec_cursor_skip(&p->rd_cursor, head);
+        evpl_iovec_clone_segment(&chunk_iov[niov++], &edge->iov, 0, 4096);
+    }
+
+    if (mid) {
+        span                = &p->rd_verify[p->rd_nverify++];
+        span->device_id     = device_id;
+        span->device_offset = dev_offset + head;
+        span->buf_offset    = evpl_iovec_cursor_consumed(&p->rd_cursor);
+        span->nblocks       = (uint32_t) (mid >> SM_BLOCK_SHIFT);
+        niov               += evpl_iovec_cursor_move(&p->rd_cursor, &chunk_iov[niov],
+                                                     32, mid, 1);
+    }
+
+    if (tail) {
+        edge                = &p->rd_edge[p->rd_nedge++];
+        edge->iov           = eiov[e++];
+        edge->device_id     = device_id;
+        edge->device_offset = dev_offset + head + mid;
+        edge->buf_offset    = evpl_iovec_cursor_consumed(&p->rd_cursor);
+        edge->skip          = 0;
+        edge->length        = (uint32_t) tail;
+        evpl_iovec_cursor_skip(&p->rd_cursor, tail);
+        evpl_iovec_clone_segment(&chunk_iov[niov++], &edge->iov, 0, 4096);
+    }
+
+    return niov;
+} /* diskfs_read_chunk_csum */
+
+
+static void
+diskfs_read_process(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p           = request->plugin_data;
+    struct diskfs_thread          *thread      = p->thread;
+    struct diskfs_shared          *shared      = thread->shared;
+    struct evpl                   *evpl        = thread->evpl;
+    struct diskfs_extent          *extent      = &p->ext_iter;
+    uint64_t                       read_offset = p->loop_off;
+    uint64_t                       read_left   = p->loop_left;
+    uint64_t                       aligned_end = p->loop_pos;
+    uint64_t                       extent_end, overlap_start, overlap_length, chunk;
+    uint32_t                       chunk_niov;
+    struct evpl_iovec             *chunk_iov;
+
+    if (!(read_left && p->loop_have && extent->file_offset < aligned_end)) {
+        diskfs_read_finish(request);
+        return;
+    }
+
+    /* Bound in-flight data I/O: park here (state is fully in p) and resume the
+     * walk from a completion if the queue is at the cap. */
+    if (diskfs_io_gate(thread, request, diskfs_read_process)) {
+        return;
+    }
+
+    if (read_offset < extent->file_offset) {
+        chunk = extent->file_offset - read_offset;
+        evpl_iovec_cursor_zero(&p->rd_cursor, chunk);
+        read_offset += chunk;
+        read_left   -= chunk;
+    }
+
+    extent_end     = extent->file_offset + extent->length;
+    overlap_start  = read_offset - extent->file_offset;
+    overlap_length = extent_end - read_offset;
+    if (overlap_length > read_left) {
+        overlap_length = read_left;
+    }
+
+    if (extent->flags & DISKFS_EXT_UNWRITTEN) {
+        /* Space is reserved (fallocate) but was never written: it reads back
+         * as zeros, with no device I/O.  Fill the cursor like a hole and skip
+         * the read loop. */
+        evpl_iovec_cursor_zero(&p->rd_cursor, overlap_length);
+        read_offset   += overlap_length;
+        read_left     -= overlap_length;
+        overlap_length = 0;
+    } else if (extent->flags & DISKFS_EXT_COMPRESSED) {
+        diskfs_read_compressed(request, extent, overlap_start, overlap_length);
         read_offset   += overlap_length;
         read_left     -= overlap_length;
         overlap_length = 0;
     }
 
     while (overlap_length) {
-        uint64_t dev_offset;
+        uint64_t dev_offset, served;
         uint32_t dev_pad, total;
-        int      pad_niov = 0;
+        int      pad_niov = 0, csum_niov;
+
+        dev_offset = extent->device_offset + overlap_start;
+        dev_pad    = (uint32_t) (dev_offset & 4095ULL);
+
+        /* Serve the leading resident blocks from the data cache; only the
+         * remainder of this chunk goes to the device. */
+        if (!dev_pad) {
+            served = diskfs_dcache_read(thread, extent->device_id, dev_offset,
+                                        overlap_length, &p->rd_cursor);
+            overlap_length -= served;
+            overlap_start  += served;
+            read_offset    += served;
+            read_left      -= served;
+            dev_offset     += served;
+            if (!overlap_length) {
+                break;
+            }
+        }
 
         if (overlap_length > shared->devices[extent->device_id].max_request_size) {
             chunk = shared->devices[extent->device_id].max_request_size;
@@ -1217,25 +1799,46 @@ diskfs_read_process(struct chimera_vfs_request *request)
             chunk = overlap_length;
         }
 
-        chunk_iov  = &p->iov[p->niov];
-        dev_offset = extent->device_offset + overlap_start;
-        dev_pad    = (uint32_t) (dev_offset & 4095ULL);
+        chunk_iov = &p->iov[p->niov];
 
-        if (dev_pad) {
-            evpl_iovec_clone_segment(&chunk_iov[0], &thread->pad, 0, dev_pad);
-            pad_niov    = 1;
-            dev_offset -= dev_pad;
+        /* Reserve the chunk's whole blocks so the completion can cache them;
+         * the data lands at the cursor's current buffer position. */
+        if (!dev_pad && chunk >= DISKFS_BLOCK_SIZE && p->rd_nfill < DISKFS_DCACHE_MAX_FILLS) {
+            struct diskfs_dcache_fill *fill = &p->rd_fill[p->rd_nfill];
+
+            fill->device_id     = extent->device_id;
+            fill->device_offset = dev_offset;
+            fill->length        = (uint32_t) (chunk & ~4095ULL);
+            fill->buf_offset    = evpl_iovec_cursor_consumed(&p->rd_cursor);
+            if (diskfs_dcache_reserve(thread, fill)) {
+                p->rd_nfill++;
+            }
         }
 
-        chunk_niov = evpl_iovec_cursor_move(&p->rd_cursor, &chunk_iov[pad_niov],
-                                            32, chunk, 1);
-        chunk_niov += pad_niov;
+        csum_niov = shared->data_csum ?
+            diskfs_read_chunk_csum(request, extent->device_id, dev_offset, chunk,
+                                   chunk_iov) : -1;
 
-        total = dev_pad + chunk;
-        if (total & 4095) {
-            evpl_iovec_clone_segment(&chunk_iov[chunk_niov], &thread->pad, 0,
-                                     4096 - (total & 4095));
-            chunk_niov++;
+        if (csum_niov >= 0) {
+            chunk_niov  = csum_niov;
+            dev_offset -= dev_pad;
+        } else {
+            if (dev_pad) {
+                evpl_iovec_clone_segment(&chunk_iov[0], &thread->pad, 0, dev_pad);
+                pad_niov    = 1;
+                dev_offset -= dev_pad;
+            }
+
+            chunk_niov = evpl_iovec_cursor_move(&p->rd_cursor, &chunk_iov[pad_niov],
+                                                32, chunk, 1);
+            chunk_niov += pad_niov;
+
+            total = dev_pad + chunk;
+            if (total & 4095) {
+                evpl_iovec_clone_segment(&chunk_iov[chunk_niov], &thread->pad, 0,
+                                         4096 - (total & 4095));
+                chunk_niov++;
+            }
         }
 
         p->niov += chunk_niov;
@@ -1347,7 +1950,8 @@ diskfs_read_inode_cb(
      * READ txn; if relatime says atime is due for a bump we can't journal it
      * under a read lock, so abort and re-run the whole read under a WRITE txn.
      * On the (rare) re-entry the txn is already WRITE: pin the inode block and
-     * stamp atime only (never ctime); the WRITE commit journals it.
+     * stamp atime only (never ctime); the WRITE commit journals it.  A
+     * snapshot's inodes are frozen, atime included.
      */
     if (diskfs_private->txn->type == DISKFS_TXN_WRITE) {
         struct timespec now;
@@ -1356,7 +1960,7 @@ diskfs_read_inode_cb(
         diskfs_txn_pin_inode_block(thread, diskfs_private->txn, inode, 0);
         inode->atime_sec  = now.tv_sec;
         inode->atime_nsec = now.tv_nsec;
-    } else if (!thread->shared->noatime) {
+    } else if (!thread->shared->noatime && !(inode->flags & DISKFS_INODE_F_SNAPSHOT)) {
         struct timespec atime = { inode->atime_sec, inode->atime_nsec };
         struct timespec mtime = { inode->mtime_sec, inode->mtime_nsec };
         struct timespec ctime = { inode->ctime_sec, inode->ctime_nsec };
@@ -1403,6 +2007,31 @@ diskfs_read_inode_cb(
     evpl_iovec_cursor_init(&diskfs_private->rd_cursor, request->read.iov,
                            request->read.buffers_provided);
 
+    if (inode->inline_data) {
+        /* Inline file: the contents are resident with the inode, so fill the
+         * buffers from memory -- no extent walk, no data-block read. */
+        uint64_t copy = inode->inline_len > aligned_offset ?
+            inode->inline_len - aligned_offset : 0;
+
+        if (copy > aligned_length) {
+            copy = aligned_length;
+        }
+        if (copy) {
+            evpl_iovec_cursor_append_blob(&diskfs_private->rd_cursor,
+                                          inode->inline_data + aligned_offset,
+                                          copy);
+        }
+        if (aligned_length > copy) {
+            evpl_iovec_cursor_zero(&diskfs_private->rd_cursor,
+                                   aligned_length - copy);
+        }
+
+        diskfs_private->io_reading = 0;
+        diskfs_map_attrs(thread, &request->read.r_attr, inode);
+        diskfs_op_ok(request, diskfs_private->txn);
+        return;
+    }
+
     diskfs_private->inode_stash[0] = inode;
     diskfs_private->loop_off       = aligned_offset;
     diskfs_private->loop_left      = aligned_length;
@@ -1442,6 +2071,10 @@ diskfs_read(
     p->status     = 0;
     p->pending    = 0;
     p->niov       = 0;
+    p->rd_nfill   = 0;
+    p->rd_nverify = 0;
+    p->rd_nedge   = 0;
+    p->rd_vnext   = 0;
     p->thread     = thread;
     p->io_reading = 1;     /* cleared in diskfs_read_finish when the walk ends */
     p->txn        = diskfs_txn_begin(thread, DISKFS_TXN_READ);
@@ -1483,7 +2116,6 @@ diskfs_write_rmw_read_callback(
     struct chimera_vfs_request    *request        = private_data;
     struct diskfs_request_private *diskfs_private = request->plugin_data;
     struct diskfs_thread          *thread         = diskfs_private->thread;
-    struct diskfs_shared          *shared         = thread->shared;
 
     if (status && diskfs_private->status == 0) {
         diskfs_private->status = status;
@@ -1509,13 +2141,68 @@ diskfs_write_rmw_read_callback(
             return;
         }
 
-        // All RMW reads complete, proceed to write phase
-        diskfs_private->rmw_phase = 2;
-        diskfs_write_phase2(thread, shared, request);
+        // All RMW reads complete, verify them and proceed to write phase
+        diskfs_write_rmw_verify(thread, request);
     }
 } /* diskfs_write_rmw_read_callback */
 
 
+/* The prefix / suffix blocks an RMW merges are checked against their data
+ * checksums before phase 2 rewrites them, so a corrupt block is never
+ * re-checksummed as good.  rmw_checked counts the blocks done; a check
+ * parked on a checksum-table block re-enters here. */
+static void
+diskfs_write_rmw_verify(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    struct chimera_vfs_request    *request = arg;
+    struct diskfs_request_private *p       = request->plugin_data;
+    int                            rc      = 0;
+
+    if (p->rmw_checked == 0) {
+        if (p->rmw_prefix_pending && p->rmw_prefix_iov.data) {
+            rc = diskfs_csum_verify(thread, p->prefix_device_id,
+                                    p->prefix_device_offset, 1,
+                                    &p->rmw_prefix_iov, 1, 0,
+                                    diskfs_write_rmw_verify, request);
+            if (rc == SM_AGAIN) {
+                return;
+            }
+        }
+        p->rmw_checked = 1;
+    }
+
+    if (rc == 0 && p->rmw_checked == 1) {
+        if (p->rmw_suffix_pending && p->rmw_suffix_iov.data) {
+            rc = diskfs_csum_verify(thread, p->suffix_device_id,
+                                    p->suffix_device_offset, 1,
+                                    &p->rmw_suffix_iov, 1, 0,
+                                    diskfs_write_rmw_verify, request);
+            if (rc == SM_AGAIN) {
+                return;
+            }
+        }
+        p->rmw_checked = 2;
+    }
+
+    if (rc) {
+        if (p->rmw_prefix_iov.data) {
+            evpl_iovec_release(thread->evpl, &p->rmw_prefix_iov);
+        }
+        if (p->rmw_suffix_iov.data) {
+            evpl_iovec_release(thread->evpl, &p->rmw_suffix_iov);
+        }
+        request->status = CHIMERA_VFS_EIO;
+        request->complete(request);
+        return;
+    }
+
+    p->rmw_phase = 2;
+    diskfs_write_phase2(thread, thread->shared, request);
+} /* diskfs_write_rmw_verify */
+
+
 // Phase 2: Issue actual writes (called after RMW reads complete or if no RMW needed)
 static void
 diskfs_write_phase2(
@@ -1549,6 +2236,58 @@ diskfs_write_phase2(
         return;
     }
 
+    /* The target blocks' cached contents (or an in-flight read's reservation
+     * of them) are stale from here on. */
+    diskfs_dcache_invalidate(thread, (uint32_t) diskfs_private->rmw_device_id,
+                             diskfs_private->rmw_device_offset,
+                             diskfs_private->zc_nunits ? diskfs_private->zc_phys :
+                             diskfs_private->rmw_aligned_length);
+
+    /* Compressed write: the encoded units are already staged back to back
+     * (diskfs_write_compress); issue them in device-sized slices and drop the
+     * staging reference -- each slice holds its own until it completes. */
+    if (diskfs_private->zc_nunits) {
+        diskfs_private->pending = 0;
+        diskfs_private->niov    = 0;
+
+        diskfs_csum_note(thread, diskfs_private->txn,
+                         (uint32_t) diskfs_private->rmw_device_id,
+                         diskfs_private->rmw_device_offset,
+                         &diskfs_private->zc_iov, 1, diskfs_private->zc_phys);
+
+        for (offset = 0; offset < diskfs_private->zc_phys; offset += chunk) {
+            chunk = shared->devices[diskfs_private->rmw_device_id].max_request_size;
+            if (diskfs_private->zc_phys - offset < chunk) {
+                chunk = diskfs_private->zc_phys - offset;
+            }
+
+            chunk_iov = &diskfs_private->iov[diskfs_private->niov];
+            evpl_iovec_clone_segment(chunk_iov, &diskfs_private->zc_iov, offset, chunk);
+            diskfs_private->niov++;
+
+            diskfs_private->pending++;
+            diskfs_pending_io_add(thread, 1);
+
+            diskfs_metric_block_io(thread, DISKFS_METRIC_IO_WRITE,
+                                   DISKFS_METRIC_IO_DATA, chunk);
+            diskfs_metric_block_io_device(thread, diskfs_private->rmw_device_id,
+                                          DISKFS_METRIC_IO_WRITE,
+                                          DISKFS_METRIC_IO_DATA, chunk);
+            evpl_block_write(evpl,
+                             thread->queue[diskfs_private->rmw_device_id],
+                             chunk_iov,
+                             1,
+                             diskfs_private->rmw_device_offset + offset,
+                             diskfs_write_data_sync(shared, request),
+                             diskfs_io_callback,
+                             request);
+        }
+
+        evpl_iovec_release(evpl, &diskfs_private->zc_iov);
+        diskfs_private->zc_iov.data = NULL;
+        return;
+    }
+
     /* Zero-copy fast path: a fully block-aligned overwrite has no RMW prefix or
     * suffix (and therefore no sub-block padding), so the staged buffer would be
     * a byte-for-byte copy of the caller's write data.  When the data is a single
@@ -1580,6 +2319,11 @@ diskfs_write_phase2(
 
         diskfs_pending_io_add(thread, 1);
 
+        diskfs_csum_note(thread, diskfs_private->txn,
+                         (uint32_t) diskfs_private->rmw_device_id,
+                         diskfs_private->rmw_device_offset,
+                         request->write.iov, request->write.niov, write_length);
+
         diskfs_metric_block_io(thread, DISKFS_METRIC_IO_WRITE,
                                DISKFS_METRIC_IO_DATA, write_length);
         diskfs_metric_block_io_device(thread, diskfs_private->rmw_device_id,
@@ -1706,6 +2450,11 @@ diskfs_write_phase2(
 
         diskfs_private->niov += chunk_niov;
 
+        diskfs_csum_note(thread, diskfs_private->txn,
+                         (uint32_t) diskfs_private->rmw_device_id,
+                         diskfs_private->rmw_device_offset + offset,
+                         chunk_iov, chunk_niov, chunk);
+
         diskfs_private->pending++;
         diskfs_pending_io_add(thread, 1);
 
@@ -1793,6 +2542,7 @@ diskfs_ext_put_floor_cb(
     diskfs_bt_op_free(thread, op);
 
     if (have && prev.flags == p->ci_flags && prev.device_id == p->ci_devid &&
+        !(p->ci_flags & DISKFS_EXT_COMPRESSED) &&
         prev.file_offset + prev.length == p->ci_off &&
         prev.device_offset + prev.length == p->ci_devoff) {
         /* Contiguous predecessor: widen it (remove then re-insert at its key). */
@@ -1809,29 +2559,555 @@ diskfs_ext_put_floor_cb(
         return;
     }
 
-    diskfs_ext_put_insert(request);
-} /* diskfs_ext_put_floor_cb */
+    /* Adjacent in the file but not on disk: a fragment boundary (unless it
+     * is a deliberate stripe boundary onto another device). */
+    if (have && prev.flags == 0 && p->ci_flags == 0 &&
+        prev.file_offset + prev.length == p->ci_off &&
+        !(thread->shared->stripe_chunk && prev.device_id != p->ci_devid)) {
+        diskfs_defrag_note(thread, p->inode_stash[0]);
+    }
+
+    diskfs_ext_put_insert(request);
+} /* diskfs_ext_put_floor_cb */
+
+
+void
+diskfs_ext_put(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_bt_op           *op;
+
+    if (p->ci_off == 0) {
+        diskfs_ext_put_insert(request);     /* nothing precedes offset 0 */
+        return;
+    }
+
+    op = diskfs_bt_op_alloc(thread);
+    if (diskfs_ext_floor_async(op, thread, p->inode_stash[0], p->ci_off - 1,
+                               p->rec_scratch, sizeof(p->rec_scratch),
+                               diskfs_ext_put_floor_cb, request)) {
+        diskfs_ext_put_floor_cb(op, op->result, request);
+    }
+} /* diskfs_ext_put */
+
+
+/*
+ * Inflate: rewrite the compressed extent in p->ext_iter as a raw extent over
+ * the same file range, for an edit that would keep a tail of it or read part
+ * of a block from it (a blob decodes only whole, so it cannot be cut).
+ * read the blob -> decode into a raw buffer -> allocate -> write -> remove
+ * the compressed record, insert the raw one and free the blob in the op's
+ * txn -> p->ext_iter now describes the raw extent; run zi_cont.  The raw
+ * copy is written before the txn commits, like any redirect write.
+ */
+static void
+diskfs_inflate_fail(
+    struct chimera_vfs_request *request,
+    int                         status)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+
+    if (p->zi_iov.data) {
+        evpl_iovec_release(thread->evpl, &p->zi_iov);
+        p->zi_iov.data = NULL;
+    }
+    if (p->zc_iov.data) {
+        evpl_iovec_release(thread->evpl, &p->zc_iov);
+        p->zc_iov.data = NULL;
+    }
+    diskfs_metric_compress(thread, DISKFS_METRIC_COMPRESS_ERRORS, 1);
+    diskfs_op_fail(request, p->txn, status);
+} /* diskfs_inflate_fail */
+
+
+static void
+diskfs_inflate_inserted_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+
+    (void) result;
+    diskfs_bt_op_free(p->thread, op);
+
+    p->ext_iter.device_id     = p->zi_devid;
+    p->ext_iter.device_offset = p->zi_devoff;
+    p->ext_iter.flags         = 0;
+
+    diskfs_metric_compress(p->thread, DISKFS_METRIC_COMPRESS_INFLATED, 1);
+    p->zi_cont(request);
+} /* diskfs_inflate_inserted_cb */
+
+
+static void
+diskfs_inflate_removed_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+    struct diskfs_thread          *thread  = p->thread;
+
+    (void) result;
+    diskfs_bt_op_free(thread, op);
+
+    op = diskfs_bt_op_alloc(thread);
+    if (diskfs_ext_insert_async(op, thread, p->txn, p->inode_stash[0],
+                                p->ext_iter.file_offset, p->ext_iter.length,
+                                p->zi_devid, p->zi_devoff, 0,
+                                diskfs_inflate_inserted_cb, request)) {
+        diskfs_inflate_inserted_cb(op, op->result, request);
+    }
+} /* diskfs_inflate_removed_cb */
+
+
+static void
+diskfs_inflate_write_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+    struct diskfs_thread          *thread  = p->thread;
+    struct diskfs_bt_op           *op;
+
+    diskfs_pending_io_add(thread, -1);
+    diskfs_io_resume_waiters(thread);
+
+    evpl_iovec_release(evpl, &p->zi_iov);
+    p->zi_iov.data = NULL;
+
+    if (status) {
+        diskfs_inflate_fail(request, CHIMERA_VFS_EIO);
+        return;
+    }
+
+    diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
+                             p->ext_iter.device_offset,
+                             diskfs_ext_phys_len(p->ext_iter.length, p->ext_iter.flags));
+
+    op = diskfs_bt_op_alloc(thread);
+    if (diskfs_ext_remove_async(op, thread, p->txn, p->inode_stash[0],
+                                p->ext_iter.file_offset,
+                                diskfs_inflate_removed_cb, request)) {
+        diskfs_inflate_removed_cb(op, op->result, request);
+    }
+} /* diskfs_inflate_write_cb */
+
+
+static void
+diskfs_inflate_alloc(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_shared          *shared = thread->shared;
+    uint64_t                       dev_id, dev_off;
+    int                            rc;
+
+    rc = diskfs_inode_alloc_space(thread, p->txn, p->inode_stash[0],
+                                  p->ext_iter.file_offset,
+                                  (int64_t) p->zi_iov.length, 0, &dev_id, &dev_off,
+                                  diskfs_inflate_alloc_resume, request);
+    if (rc == SM_AGAIN) {
+        return;     /* parked; diskfs_inflate_alloc_resume re-runs */
+    }
+    if (rc) {
+        diskfs_inflate_fail(request, CHIMERA_VFS_ENOSPC);
+        return;
+    }
+
+    p->zi_devid  = (uint32_t) dev_id;
+    p->zi_devoff = dev_off;
+
+    diskfs_dcache_invalidate(thread, p->zi_devid, dev_off, p->zi_iov.length);
+
+    diskfs_csum_note(thread, p->txn, p->zi_devid, dev_off, &p->zi_iov, 1,
+                     p->zi_iov.length);
+
+    diskfs_pending_io_add(thread, 1);
+    diskfs_metric_block_io(thread, DISKFS_METRIC_IO_WRITE,
+                           DISKFS_METRIC_IO_RMW, p->zi_iov.length);
+    diskfs_metric_block_io_device(thread, p->zi_devid, DISKFS_METRIC_IO_WRITE,
+                                  DISKFS_METRIC_IO_RMW, p->zi_iov.length);
+    evpl_block_write(thread->evpl, thread->queue[p->zi_devid], &p->zi_iov, 1,
+                     dev_off, diskfs_write_data_sync(shared, request),
+                     diskfs_inflate_write_cb, request);
+} /* diskfs_inflate_alloc */
+
+
+static void
+diskfs_inflate_alloc_resume(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    (void) thread;
+    diskfs_inflate_alloc((struct chimera_vfs_request *) arg);
+} /* diskfs_inflate_alloc_resume */
+
+
+/* The compressed blob has landed in zi_iov: verify it against the data
+ * checksums (re-entered if the check parks on a table block), then decode
+ * it into a raw, block-padded buffer for the rewrite. */
+static void
+diskfs_inflate_decode(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    struct chimera_vfs_request    *request = arg;
+    struct diskfs_request_private *p       = request->plugin_data;
+    struct evpl                   *evpl    = thread->evpl;
+    uint64_t                       raw_len = SM_ALIGN_UP(p->ext_iter.length);
+    const void                    *data;
+    uint32_t                       data_len;
+    int                            rc;
+
+    rc = diskfs_csum_verify(thread, p->ext_iter.device_id, p->ext_iter.device_offset,
+                            (uint32_t) (p->zi_iov.length >> SM_BLOCK_SHIFT),
+                            &p->zi_iov, 1, 0, diskfs_inflate_decode, request);
+    if (rc == SM_AGAIN) {
+        return;
+    }
+    if (rc) {
+        diskfs_inflate_fail(request, CHIMERA_VFS_EIO);
+        return;
+    }
+
+    rc = diskfs_compress_decode(thread, p->zi_iov.data, p->ext_iter.flags,
+                                &data, &data_len);
+    evpl_iovec_release(evpl, &p->zi_iov);
+    p->zi_iov.data = NULL;
+
+    if (rc || data_len < p->ext_iter.length) {
+        diskfs_inflate_fail(request, CHIMERA_VFS_EIO);
+        return;
+    }
+
+    if (evpl_iovec_alloc(evpl, raw_len, 4096, 1, 0, &p->zi_iov) < 1) {
+        p->zi_iov.data = NULL;
+        diskfs_inflate_fail(request, CHIMERA_VFS_EIO);
+        return;
+    }
+    memcpy(p->zi_iov.data, data, p->ext_iter.length);
+    memset((uint8_t *) p->zi_iov.data + p->ext_iter.length, 0,
+           raw_len - p->ext_iter.length);
+
+    diskfs_inflate_alloc(request);
+} /* diskfs_inflate_decode */
+
+
+static void
+diskfs_inflate_read_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+    struct diskfs_thread          *thread  = p->thread;
+
+    (void) evpl;
+
+    diskfs_pending_io_add(thread, -1);
+    diskfs_io_resume_waiters(thread);
+
+    if (status) {
+        diskfs_inflate_fail(request, CHIMERA_VFS_EIO);
+        return;
+    }
+
+    diskfs_inflate_decode(thread, request);
+} /* diskfs_inflate_read_cb */
+
+
+static void
+diskfs_inflate_start(
+    struct chimera_vfs_request *request,
+    void (                     *cont )(struct chimera_vfs_request *))
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_extent          *e      = &p->ext_iter;
+    uint64_t                       phys   = diskfs_ext_phys_len(e->length, e->flags);
+
+    p->zi_cont = cont;
+
+    if (evpl_iovec_alloc(thread->evpl, phys, 4096, 1, 0, &p->zi_iov) < 1) {
+        p->zi_iov.data = NULL;
+        diskfs_inflate_fail(request, CHIMERA_VFS_EIO);
+        return;
+    }
+
+    diskfs_pending_io_add(thread, 1);
+    diskfs_metric_block_io(thread, DISKFS_METRIC_IO_READ,
+                           DISKFS_METRIC_IO_RMW, phys);
+    diskfs_metric_block_io_device(thread, e->device_id, DISKFS_METRIC_IO_READ,
+                                  DISKFS_METRIC_IO_RMW, phys);
+    evpl_block_read(thread->evpl, thread->queue[e->device_id], &p->zi_iov, 1,
+                    e->device_offset, diskfs_inflate_read_cb, request);
+} /* diskfs_inflate_start */
+
+
+/*
+ * Inline data record maintenance.  The in-memory copy (inode->inline_data) is
+ * updated first by the caller; diskfs_inline_store replays it into the b+tree
+ * as the single DISKFS_REC_INLINE record (remove the old one, then insert
+ * unless the file is now empty) and runs cont.  ci_cont carries the
+ * continuation across the async steps.
+ */
+static void
+diskfs_inline_store_inserted_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+
+    (void) result;
+    diskfs_bt_op_free(p->thread, op);
+    p->ci_cont(request);
+} /* diskfs_inline_store_inserted_cb */
+
+
+static void
+diskfs_inline_store_insert(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_inode           *inode  = p->inode_stash[0];
+    struct diskfs_bt_op           *op;
+
+    if (!inode->inline_data) {
+        p->ci_cont(request);
+        return;
+    }
+
+    op = diskfs_bt_op_alloc(thread);
+    if (diskfs_bt_insert_async(op, thread, p->txn, inode, &diskfs_inline_key,
+                               inode->inline_data, inode->inline_len,
+                               diskfs_inline_store_inserted_cb, request)) {
+        diskfs_inline_store_inserted_cb(op, op->result, request);
+    }
+} /* diskfs_inline_store_insert */
+
+
+static void
+diskfs_inline_store_removed_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+
+    (void) result;
+    diskfs_bt_op_free(p->thread, op);
+    diskfs_inline_store_insert(request);
+} /* diskfs_inline_store_removed_cb */
+
+
+void
+diskfs_inline_store(
+    struct chimera_vfs_request *request,
+    int                         had_record,
+    void (                     *cont )(struct chimera_vfs_request *))
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_bt_op           *op;
+
+    p->ci_cont = cont;
+
+    if (!had_record) {
+        diskfs_inline_store_insert(request);
+        return;
+    }
+
+    op = diskfs_bt_op_alloc(thread);
+    if (diskfs_bt_remove_async(op, thread, p->txn, p->inode_stash[0],
+                               &diskfs_inline_key,
+                               diskfs_inline_store_removed_cb, request)) {
+        diskfs_inline_store_removed_cb(op, op->result, request);
+    }
+} /* diskfs_inline_store */
+
+
+/*
+ * Promote an inline file to an ordinary extent: allocate one data block, write
+ * the inline bytes (zero-padded) to it and wait for that write, then drop the
+ * inline record and map the block as the written extent [0, 4096) before
+ * running cont.  The data is on disk before the txn that maps it commits, so
+ * a crash leaves either the inline record or the complete extent.  An inline
+ * file never exceeds one block, so one block always holds it.
+ */
+static void
+diskfs_inline_promote_removed_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+    struct diskfs_inode           *inode   = p->inode_stash[0];
+
+    (void) result;
+    diskfs_bt_op_free(p->thread, op);
+
+    free(inode->inline_data);
+    inode->inline_data = NULL;
+    inode->inline_len  = 0;
+    inode->space_used  = DISKFS_BLOCK_SIZE;
+
+    /* ci_devid/ci_devoff were filled by the allocation; ci_cont is the
+     * caller's continuation. */
+    p->ci_off   = 0;
+    p->ci_len   = DISKFS_BLOCK_SIZE;
+    p->ci_flags = 0;
+    diskfs_ext_put(request);
+} /* diskfs_inline_promote_removed_cb */
+
+
+static void
+diskfs_inline_promote_written(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+    struct diskfs_thread          *thread  = p->thread;
+    struct diskfs_bt_op           *op;
+
+    evpl_iovec_release(evpl, &p->iov[0]);
+    diskfs_pending_io_add(thread, -1);
+
+    if (status) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_EIO);
+    } else {
+        op = diskfs_bt_op_alloc(thread);
+        if (diskfs_bt_remove_async(op, thread, p->txn, p->inode_stash[0],
+                                   &diskfs_inline_key,
+                                   diskfs_inline_promote_removed_cb, request)) {
+            diskfs_inline_promote_removed_cb(op, op->result, request);
+        }
+    }
+
+    diskfs_io_resume_waiters(thread);
+} /* diskfs_inline_promote_written */
+
+
+static void
+diskfs_inline_promote_submit(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_inode           *inode  = p->inode_stash[0];
+    int                            niov;
+
+    if (diskfs_io_gate(thread, request, diskfs_inline_promote_submit)) {
+        return;
+    }
+
+    niov = evpl_iovec_alloc(thread->evpl, DISKFS_BLOCK_SIZE, DISKFS_BLOCK_SIZE,
+                            1, 0, &p->iov[0]);
+    chimera_diskfs_abort_if(niov != 1, "inline promotion buffer allocation failed");
+
+    memcpy(p->iov[0].data, inode->inline_data, inode->inline_len);
+    memset((uint8_t *) p->iov[0].data + inode->inline_len, 0,
+           DISKFS_BLOCK_SIZE - inode->inline_len);
+
+    diskfs_dcache_invalidate(thread, p->ci_devid, p->ci_devoff, DISKFS_BLOCK_SIZE);
+
+    diskfs_csum_note(thread, p->txn, p->ci_devid, p->ci_devoff, &p->iov[0], 1,
+                     DISKFS_BLOCK_SIZE);
+
+    diskfs_pending_io_add(thread, 1);
+    diskfs_metric_block_io(thread, DISKFS_METRIC_IO_WRITE,
+                           DISKFS_METRIC_IO_DATA, DISKFS_BLOCK_SIZE);
+    diskfs_metric_block_io_device(thread, p->ci_devid, DISKFS_METRIC_IO_WRITE,
+                                  DISKFS_METRIC_IO_DATA, DISKFS_BLOCK_SIZE);
+    evpl_block_write(thread->evpl, thread->queue[p->ci_devid], &p->iov[0], 1,
+                     p->ci_devoff, !thread->shared->unsafe_async,
+                     diskfs_inline_promote_written, request);
+} /* diskfs_inline_promote_submit */
 
 
-void
-diskfs_ext_put(struct chimera_vfs_request *request)
+static void
+diskfs_inline_promote_alloc(struct chimera_vfs_request *request)
 {
     struct diskfs_request_private *p      = request->plugin_data;
     struct diskfs_thread          *thread = p->thread;
-    struct diskfs_bt_op           *op;
+    uint64_t                       dev_id, dev_off;
+    int                            rc;
 
-    if (p->ci_off == 0) {
-        diskfs_ext_put_insert(request);     /* nothing precedes offset 0 */
+    rc = diskfs_inode_alloc_space(thread, p->txn, p->inode_stash[0],
+                                  0, DISKFS_BLOCK_SIZE,
+                                  diskfs_inode_prealloc(thread->shared, p->inode_stash[0]),
+                                  &dev_id, &dev_off,
+                                  diskfs_inline_promote_alloc_resume, request);
+    if (rc == SM_AGAIN) {
+        return;     /* parked; diskfs_inline_promote_alloc_resume re-runs */
+    }
+    if (rc) {
+        diskfs_op_fail(request, p->txn, CHIMERA_VFS_ENOSPC);
         return;
     }
 
-    op = diskfs_bt_op_alloc(thread);
-    if (diskfs_ext_floor_async(op, thread, p->inode_stash[0], p->ci_off - 1,
-                               p->rec_scratch, sizeof(p->rec_scratch),
-                               diskfs_ext_put_floor_cb, request)) {
-        diskfs_ext_put_floor_cb(op, op->result, request);
-    }
-} /* diskfs_ext_put */
+    p->ci_devid  = (uint32_t) dev_id;
+    p->ci_devoff = dev_off;
+    diskfs_inline_promote_submit(request);
+} /* diskfs_inline_promote_alloc */
+
+
+static void
+diskfs_inline_promote_alloc_resume(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    (void) thread;
+    diskfs_inline_promote_alloc((struct chimera_vfs_request *) arg);
+} /* diskfs_inline_promote_alloc_resume */
+
+
+void
+diskfs_inline_promote(
+    struct chimera_vfs_request *request,
+    void (                     *cont )(struct chimera_vfs_request *))
+{
+    struct diskfs_request_private *p = request->plugin_data;
+
+    p->ci_cont         = cont;
+    p->inline_promoted = 1;
+    diskfs_inline_promote_alloc(request);
+} /* diskfs_inline_promote */
+
+
+/* Stamp a write's inode changes: mtime/ctime, and the POSIX kill-priv rule (a
+ * non-privileged write to a regular file clears the set-user-ID bit and the
+ * set-group-ID bit when group-executable).  Returns nonzero when the mode
+ * changed, which obliges the caller to journal the inode block. */
+static int
+diskfs_write_stamp(
+    struct chimera_vfs_request *request,
+    struct diskfs_inode        *inode,
+    const struct timespec      *now)
+{
+    uint32_t new_mode = chimera_vfs_killpriv_mode(request->cred, inode->mode);
+    int      killpriv = (new_mode != inode->mode);
+
+    inode->mtime_sec  = now->tv_sec;
+    inode->mtime_nsec = now->tv_nsec;
+    inode->ctime_sec  = now->tv_sec;
+    inode->ctime_nsec = now->tv_nsec;
+    inode->mode       = new_mode;
+    return killpriv;
+} /* diskfs_write_stamp */
 
 
 /* Tail shared by every write path (in-place, unwritten-split, redirect):
@@ -1847,7 +3123,7 @@ diskfs_write_finish_map(struct chimera_vfs_request *request)
     uint64_t                       write_end      = request->write.offset + request->write.length;
     struct timespec                now;
     int                            size_grew = write_end > inode->size;
-    int                            deferrable;
+    int                            deferrable, killpriv;
 
     if (size_grew) {
         inode->size       = write_end;
@@ -1855,18 +3131,10 @@ diskfs_write_finish_map(struct chimera_vfs_request *request)
     }
 
     clock_gettime(CLOCK_REALTIME, &now);
-    inode->mtime_sec  = now.tv_sec;
-    inode->mtime_nsec = now.tv_nsec;
-    inode->ctime_sec  = now.tv_sec;
-    inode->ctime_nsec = now.tv_nsec;
 
-    /* POSIX kill-priv: a non-privileged write to a regular file clears the
-     * set-user-ID bit and the set-group-ID bit (when group-executable).  When
-     * the mode actually changes, the inode block must be journaled (the
-     * deferred mtime-only path below would drop it from the txn). */
-    uint32_t new_mode = chimera_vfs_killpriv_mode(request->cred, inode->mode);
-    int      killpriv = (new_mode != inode->mode);
-    inode->mode = new_mode;
+    /* A kill-priv mode change must be journaled: the deferred mtime-only path
+     * below would drop the inode block from the txn. */
+    killpriv = diskfs_write_stamp(request, inode, &now);
 
     diskfs_map_attrs(thread, &request->write.r_post_attr, inode);
 
@@ -1894,7 +3162,7 @@ diskfs_write_finish_map(struct chimera_vfs_request *request)
         struct diskfs_inode_shard *shard  = diskfs_inode_shard(shared, inode->inum);
         uint64_t                   now_ns = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
 
-        pthread_mutex_lock(&shard->lock);
+        chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
         diskfs_inode_mtime_dirty_locked(shard, inode, now_ns);
         pthread_mutex_unlock(&shard->lock);
 
@@ -1977,6 +3245,34 @@ diskfs_write_finish_map(struct chimera_vfs_request *request)
 } /* diskfs_write_finish_map */
 
 
+/* Compressed redirect: record one extent per unit, each over its own blob in
+ * the staged run (never coalesced), then run the tail. */
+static void
+diskfs_write_zc_put(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p     = request->plugin_data;
+    uint64_t                       unit  = p->thread->shared->compress_unit;
+    uint64_t                       start = p->rmw_aligned_start + p->zc_next * unit;
+    uint64_t                       end   = p->rmw_aligned_start + p->rmw_aligned_length;
+
+    if (p->zc_next == p->zc_nunits) {
+        diskfs_write_finish_map(request);
+        return;
+    }
+
+    p->ci_off    = start;
+    p->ci_len    = end - start < unit ? end - start : unit;
+    p->ci_devid  = (uint32_t) p->rmw_device_id;
+    p->ci_devoff = p->zc_devoff;
+    p->ci_flags  = p->zc_flags[p->zc_next];
+    p->ci_cont   = diskfs_write_zc_put;
+
+    p->zc_devoff += diskfs_ext_phys_len(p->ci_len, p->ci_flags);
+    p->zc_next++;
+    diskfs_ext_put(request);
+} /* diskfs_write_zc_put */
+
+
 /* Redirect path: record the freshly-allocated extent (coalescing it with a
  * contiguous predecessor -- e.g. a sequential append), then run the tail. */
 static void
@@ -1984,6 +3280,13 @@ diskfs_write_trim_done(struct chimera_vfs_request *request)
 {
     struct diskfs_request_private *p = request->plugin_data;
 
+    if (p->zc_nunits) {
+        p->zc_next   = 0;
+        p->zc_devoff = p->rmw_device_offset;
+        diskfs_write_zc_put(request);
+        return;
+    }
+
     p->ci_off    = p->rmw_aligned_start;
     p->ci_len    = p->rmw_aligned_length;
     p->ci_devid  = (uint32_t) p->rmw_device_id;
@@ -2177,6 +3480,13 @@ diskfs_write_trim_process(struct chimera_vfs_request *request)
         return;
     }
 
+    /* A blob is only ever kept whole or cut down to a head (which still
+     * decodes); a cut that would keep its tail inflates it first. */
+    if ((p->ext_iter.flags & DISKFS_EXT_COMPRESSED) && ee > aend && es < aend) {
+        diskfs_inflate_start(request, diskfs_write_trim_process);
+        return;
+    }
+
     /* The aligned region's data is being redirected to freshly-allocated
      * blocks (rmw_device_offset), so the old device blocks backing the part of
      * this extent that the region covers are now garbage and must be freed --
@@ -2186,7 +3496,8 @@ diskfs_write_trim_process(struct chimera_vfs_request *request)
         /* Completely inside the aligned region: free + remove, then advance. */
         diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
                                  p->ext_iter.device_offset,
-                                 SM_ALIGN_UP(p->ext_iter.length));
+                                 diskfs_ext_phys_len(p->ext_iter.length,
+                                                     p->ext_iter.flags));
         op = diskfs_bt_op_alloc(thread);
         if (diskfs_ext_remove_async(op, thread, p->txn, p->inode_stash[0], es,
                                     diskfs_write_trim_advance_cb, request)) {
@@ -2208,10 +3519,12 @@ diskfs_write_trim_process(struct chimera_vfs_request *request)
         }
     } else if (es < astart && ee > astart) {
         /* Overlaps the left edge: free the covered tail, remove, reinsert the
-         * head. */
-        diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
-                                 p->ext_iter.device_offset + (astart - es),
-                                 ee - astart);
+         * head.  A compressed head keeps its whole blob, so nothing is freed. */
+        if (!(p->ext_iter.flags & DISKFS_EXT_COMPRESSED)) {
+            diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
+                                     p->ext_iter.device_offset + (astart - es),
+                                     ee - astart);
+        }
         op = diskfs_bt_op_alloc(thread);
         if (diskfs_ext_remove_async(op, thread, p->txn, p->inode_stash[0], es,
                                     diskfs_write_trim_oleft_removed_cb, request)) {
@@ -2295,6 +3608,11 @@ diskfs_write_suffix_cb(
         write_end < p->ext_iter.file_offset + p->ext_iter.length) {
         uint64_t ee = p->ext_iter.file_offset + p->ext_iter.length;
 
+        if (p->ext_iter.flags & DISKFS_EXT_COMPRESSED) {
+            diskfs_inflate_start(request, diskfs_write_suffix_lookup);
+            return;
+        }
+
         if (ee >= aend) {
             p->rmw_suffix_valid = p->rmw_suffix_len;
         } else if (ee > write_end) {
@@ -2359,6 +3677,11 @@ diskfs_write_prefix_cb(
         astart < p->ext_iter.file_offset + p->ext_iter.length) {
         uint64_t ee = p->ext_iter.file_offset + p->ext_iter.length;
 
+        if (p->ext_iter.flags & DISKFS_EXT_COMPRESSED) {
+            diskfs_inflate_start(request, diskfs_write_prefix_lookup);
+            return;
+        }
+
         if (ee >= astart + p->rmw_prefix_len) {
             p->rmw_prefix_valid = p->rmw_prefix_len;
         } else if (ee > astart) {
@@ -2400,6 +3723,86 @@ diskfs_write_prefix_lookup(struct chimera_vfs_request *request)
 } /* diskfs_write_prefix_lookup */
 
 
+/*
+ * Inline write: update the inode's in-memory copy of the file, stamp the
+ * inode, then replay the copy into the DISKFS_REC_INLINE record.  The write
+ * commits with the inode block like any metadata change; there is no data I/O.
+ */
+static void
+diskfs_write_inline_done(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p = request->plugin_data;
+
+    diskfs_op_ok(request, p->txn);
+} /* diskfs_write_inline_done */
+
+
+static void
+diskfs_write_inline(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p           = request->plugin_data;
+    struct diskfs_thread          *thread      = p->thread;
+    struct diskfs_inode           *inode       = p->inode_stash[0];
+    uint64_t                       write_start = request->write.offset;
+    uint64_t                       write_end   = write_start + request->write.length;
+    int                            had_record  = inode->inline_data != NULL;
+    struct evpl_iovec_cursor       cursor;
+    struct timespec                now;
+    uint8_t                       *data;
+
+    if (write_end > inode->inline_len) {
+        data = realloc(inode->inline_data, write_end);
+        if (unlikely(!data)) {
+            diskfs_op_fail(request, p->txn, CHIMERA_VFS_ENOMEM);
+            return;
+        }
+        inode->inline_data = data;
+        if (write_start > inode->inline_len) {
+            memset(inode->inline_data + inode->inline_len, 0,
+                   write_start - inode->inline_len);
+        }
+        inode->inline_len = (uint32_t) write_end;
+        inode->size       = write_end;
+    }
+
+    evpl_iovec_cursor_init(&cursor, request->write.iov, request->write.niov);
+    evpl_iovec_cursor_get_blob(&cursor, inode->inline_data + write_start,
+                               request->write.length);
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    diskfs_write_stamp(request, inode, &now);
+
+    diskfs_map_attrs(thread, &request->write.r_post_attr, inode);
+    request->write.r_length = request->write.length;
+    request->write.r_sync   = diskfs_write_reported_sync(thread->shared, request);
+
+    diskfs_inline_store(request, had_record, diskfs_write_inline_done);
+} /* diskfs_write_inline */
+
+
+/* An empty file takes its first write inline only if it has no extents. */
+static void
+diskfs_write_inline_probe_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+    struct diskfs_extent           e;
+    int                            have;
+
+    have = diskfs_ext_from_op(op, result, &e);
+    diskfs_bt_op_free(p->thread, op);
+
+    if (have) {
+        diskfs_write_classify_start(request);
+    } else {
+        diskfs_write_inline(request);
+    }
+} /* diskfs_write_inline_probe_cb */
+
+
 /*
  * A write is dispatched here with the inode write-locked.  Compute the 4 KiB-
  * aligned region, then classify it (diskfs_write_classify_cb) against the
@@ -2465,15 +3868,49 @@ diskfs_write_inode_cb(
     p->need_suffix_read   = 0;
     p->inode_stash[0]     = inode;
 
-    op = diskfs_bt_op_alloc(thread);
-    if (diskfs_ext_floor_async(op, thread, inode, aligned_start, p->rec_scratch,
-                               sizeof(p->rec_scratch), diskfs_write_classify_cb,
-                               request)) {
-        diskfs_write_classify_cb(op, op->result, request);
+    /* Inline data: a write that leaves the file within inline_data_max goes
+     * to the inline record -- an empty file first checks it has no extents
+     * (fallocate can reserve some without growing the size).  A write that
+     * takes an inline file past the limit promotes it to an extent, then
+     * continues as an ordinary write. */
+    if (write_end <= thread->shared->inline_data_max) {
+        if (inode->inline_data) {
+            diskfs_write_inline(request);
+            return;
+        }
+        if (inode->size == 0) {
+            op = diskfs_bt_op_alloc(thread);
+            if (diskfs_ext_ceil_async(op, thread, inode, 0, p->rec_scratch,
+                                      sizeof(p->rec_scratch),
+                                      diskfs_write_inline_probe_cb, request)) {
+                diskfs_write_inline_probe_cb(op, op->result, request);
+            }
+            return;
+        }
+    } else if (inode->inline_data) {
+        diskfs_inline_promote(request, diskfs_write_classify_start);
+        return;
     }
+
+    diskfs_write_classify_start(request);
 } /* diskfs_write_inode_cb */
 
 
+static void
+diskfs_write_classify_start(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_bt_op           *op     = diskfs_bt_op_alloc(thread);
+
+    if (diskfs_ext_floor_async(op, thread, p->inode_stash[0], p->rmw_aligned_start,
+                               p->rec_scratch, sizeof(p->rec_scratch),
+                               diskfs_write_classify_cb, request)) {
+        diskfs_write_classify_cb(op, op->result, request);
+    }
+} /* diskfs_write_classify_start */
+
+
 static void
 diskfs_write_classify_cb(
     struct diskfs_bt_op *op,
@@ -2491,9 +3928,11 @@ diskfs_write_classify_cb(
     have = diskfs_ext_from_op(op, result, &e);
     diskfs_bt_op_free(thread, op);
 
-    if (have && e.file_offset <= astart && e.file_offset + e.length >= aend) {
+    if (have && e.file_offset <= astart && e.file_offset + e.length >= aend &&
+        !(e.flags & DISKFS_EXT_COMPRESSED)) {
         /* Single extent fully covers the region: overwrite its blocks in
-         * place at the matching device offset. */
+         * place at the matching device offset.  (A compressed blob has no
+         * block-for-block mapping; writes into one always redirect.) */
         p->rmw_device_id     = e.device_id;
         p->rmw_device_offset = e.device_offset + (astart - e.file_offset);
 
@@ -2503,28 +3942,12 @@ diskfs_write_classify_cb(
              * read.  Split the covered range to written. */
             p->ext_iter = e;
             diskfs_write_split_start(request);
+        } else if (thread->shared->snapshots) {
+            /* A block a snapshot shares must keep its old contents. */
+            p->ext_iter = e;
+            diskfs_write_shared_check(thread, request);
         } else {
-            /* RMW the partial first/last blocks from these same in-place
-             * blocks; the extent map is left untouched -- the only inode change
-             * is the timestamp bump, which a non-FILE_SYNC write may defer. */
-            p->inplace_written = 1;
-            if (p->rmw_prefix_len) {
-                p->need_prefix_read     = 1;
-                p->prefix_device_id     = e.device_id;
-                p->prefix_device_offset = p->rmw_device_offset;
-                p->rmw_prefix_valid     = p->rmw_prefix_len;
-            }
-            if (p->rmw_suffix_len) {
-                uint64_t write_end    = request->write.offset + request->write.length;
-                uint64_t suffix_block = write_end & ~4095ULL;
-
-                p->need_suffix_read     = 1;
-                p->suffix_device_id     = e.device_id;
-                p->suffix_device_offset = e.device_offset +
-                    (suffix_block - e.file_offset);
-                p->rmw_suffix_valid = p->rmw_suffix_len;
-            }
-            diskfs_write_finish_map(request);
+            diskfs_write_inplace(request, &e);
         }
         return;
     }
@@ -2534,23 +3957,178 @@ diskfs_write_classify_cb(
 } /* diskfs_write_classify_cb */
 
 
+/* Overwrite a written extent's blocks in place.  RMW the partial first/last
+ * blocks from these same blocks; the extent map is left untouched -- the only
+ * inode change is the timestamp bump, which a non-FILE_SYNC write may defer
+ * (unless this write just mapped the block by promoting an inline file). */
+static void
+diskfs_write_inplace(
+    struct chimera_vfs_request *request,
+    const struct diskfs_extent *e)
+{
+    struct diskfs_request_private *p = request->plugin_data;
+
+    p->inplace_written = !p->inline_promoted;
+    if (p->rmw_prefix_len) {
+        p->need_prefix_read     = 1;
+        p->prefix_device_id     = e->device_id;
+        p->prefix_device_offset = p->rmw_device_offset;
+        p->rmw_prefix_valid     = p->rmw_prefix_len;
+    }
+    if (p->rmw_suffix_len) {
+        uint64_t write_end    = request->write.offset + request->write.length;
+        uint64_t suffix_block = write_end & ~4095ULL;
+
+        p->need_suffix_read     = 1;
+        p->suffix_device_id     = e->device_id;
+        p->suffix_device_offset = e->device_offset +
+            (suffix_block - e->file_offset);
+        p->rmw_suffix_valid = p->rmw_suffix_len;
+    }
+    diskfs_write_finish_map(request);
+} /* diskfs_write_inplace */
+
+
+/* Snapshots: check the reference counts of the written extent's blocks
+ * (p->ext_iter) before overwriting them in place.  Any shared block sends
+ * the whole write down the redirect path, which frees -- that is, drops a
+ * reference to -- the old blocks.  Re-entered once a table block loads. */
+static void
+diskfs_write_shared_check(
+    struct diskfs_thread *thread,
+    void                 *arg)
+{
+    struct chimera_vfs_request    *request = arg;
+    struct diskfs_request_private *p       = request->plugin_data;
+    int                            rc;
+
+    rc = diskfs_ref_shared(thread, (uint32_t) p->rmw_device_id, p->rmw_device_offset,
+                           p->rmw_aligned_length, diskfs_write_shared_check, request);
+    if (rc == SM_AGAIN) {
+        return;
+    }
+    if (rc) {
+        diskfs_write_redirect_alloc(request);
+        return;
+    }
+    diskfs_write_inplace(request, &p->ext_iter);
+} /* diskfs_write_shared_check */
+
+
+/*
+ * Compression units a redirect write can be stored as, or 0 to write it raw.
+ * Only a write whose aligned region needs no old data qualifies: it starts
+ * on a block and ends on one or at/after EOF (the tail of the last block is
+ * then zero), so every unit is encoded whole from the caller's bytes.  The
+ * staged run must fit one buffer and the request's write slices.
+ */
+static uint32_t
+diskfs_write_compress_units(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p         = request->plugin_data;
+    struct diskfs_shared          *shared    = p->thread->shared;
+    uint64_t                       write_end = request->write.offset + request->write.length;
+    uint64_t                       len       = p->rmw_aligned_length;
+
+    if (shared->compress_algo == DISKFS_COMPRESS_NONE ||
+        p->rmw_prefix_len ||
+        (p->rmw_suffix_len && write_end < p->inode_stash[0]->size) ||
+        len < DISKFS_COMPRESS_UNIT_MIN ||
+        len > DISKFS_COMPRESS_MAX_STAGE ||
+        (len + shared->compress_unit - 1) / shared->compress_unit > DISKFS_COMPRESS_MAX_UNITS ||
+        request->write.niov > DISKFS_WRITE_MAX_IOV) {
+        return 0;
+    }
+
+    return (len + shared->compress_unit - 1) / shared->compress_unit;
+} /* diskfs_write_compress_units */
+
+
+/* Stage the write's units back to back in zc_iov and encode each in place.
+ * Leaves zc_nunits 0 (and nothing staged) if no unit compressed. */
+static void
+diskfs_write_compress(
+    struct chimera_vfs_request *request,
+    uint32_t                    nunits)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    uint64_t                       unit   = thread->shared->compress_unit;
+    uint64_t                       len    = p->rmw_aligned_length;
+    uint64_t                       off, ulen, avail;
+    struct evpl_iovec_cursor       cursor;
+    uint8_t                       *dst;
+    uint32_t                       i, plen, packed = 0;
+
+    if (evpl_iovec_alloc(thread->evpl, len, 4096, 1, 0, &p->zc_iov) < 1) {
+        p->zc_iov.data = NULL;
+        return;     /* write it raw */
+    }
+
+    evpl_iovec_cursor_init(&cursor, request->write.iov, request->write.niov);
+    p->zc_phys = 0;
+
+    for (i = 0, off = 0; i < nunits; i++, off += ulen) {
+        ulen  = len - off < unit ? len - off : unit;
+        avail = request->write.length > off ? request->write.length - off : 0;
+        if (avail > ulen) {
+            avail = ulen;
+        }
+
+        /* Units pack down as they encode: unit i lands at zc_phys, never
+         * past its own logical offset, so it cannot overrun unit i+1. */
+        dst = (uint8_t *) p->zc_iov.data + p->zc_phys;
+        evpl_iovec_cursor_get_blob(&cursor, dst, avail);
+        memset(dst + avail, 0, ulen - avail);
+
+        plen          = diskfs_compress_encode(thread, dst, (uint32_t) ulen, &p->zc_flags[i]);
+        p->zc_phys   += plen;
+        packed       += !!p->zc_flags[i];
+    }
+
+    if (!packed) {
+        evpl_iovec_release(thread->evpl, &p->zc_iov);
+        p->zc_iov.data = NULL;
+        return;
+    }
+
+    p->zc_nunits = nunits;
+} /* diskfs_write_compress */
+
+
 static void
 diskfs_write_redirect_alloc(struct chimera_vfs_request *request)
 {
     struct diskfs_request_private *p      = request->plugin_data;
     struct diskfs_thread          *thread = p->thread;
     uint64_t                       dev_id, dev_off;
+    uint32_t                       nunits;
     int                            rc;
 
+    /* Encode once, before the first attempt: an SM_AGAIN retry re-enters. */
+    if (!p->zc_checked) {
+        p->zc_checked = 1;
+        nunits        = diskfs_write_compress_units(request);
+        if (nunits) {
+            diskfs_write_compress(request, nunits);
+        }
+    }
+
     rc = diskfs_inode_alloc_space(thread, p->txn, p->inode_stash[0],
-                                  (int64_t) p->rmw_aligned_length,
-                                  SM_RESERVATION_MIN,
+                                  p->rmw_aligned_start,
+                                  (int64_t) (p->zc_nunits ? p->zc_phys :
+                                             p->rmw_aligned_length),
+                                  diskfs_inode_prealloc(thread->shared, p->inode_stash[0]),
                                   &dev_id, &dev_off,
                                   diskfs_write_alloc_resume, request);
     if (rc == SM_AGAIN) {
         return;     /* parked; diskfs_write_alloc_resume re-runs */
     }
     if (rc) {
+        if (p->zc_iov.data) {
+            evpl_iovec_release(thread->evpl, &p->zc_iov);
+            p->zc_iov.data = NULL;
+        }
         diskfs_op_fail(request, p->txn, CHIMERA_VFS_ENOSPC);
         return;
     }
@@ -2558,6 +4136,12 @@ diskfs_write_redirect_alloc(struct chimera_vfs_request *request)
     p->rmw_device_id     = dev_id;
     p->rmw_device_offset = dev_off;
 
+    /* A compressed write reads no old blocks: straight to the trim. */
+    if (p->zc_nunits) {
+        diskfs_write_trim_start(request);
+        return;
+    }
+
     diskfs_write_prefix_lookup(request);
 } /* diskfs_write_redirect_alloc */
 
@@ -2744,12 +4328,18 @@ diskfs_write(
     p->rmw_suffix_iov.data = NULL;
     p->rmw_prefix_pending  = 0;
     p->rmw_suffix_pending  = 0;
+    p->rmw_checked         = 0;
     p->rmw_prefix_valid    = 0;
     p->rmw_suffix_adjust   = 0;
     p->rmw_suffix_valid    = 0;
     p->need_prefix_read    = 0;
     p->need_suffix_read    = 0;
     p->inplace_written     = 0;
+    p->inline_promoted     = 0;
+    p->zc_nunits           = 0;
+    p->zc_checked          = 0;
+    p->zc_iov.data         = NULL;
+    p->zi_iov.data         = NULL;
     p->txn                 = diskfs_txn_begin(thread, DISKFS_TXN_WRITE);
 
     /* Warm-handle fast path (see diskfs_read): reuse the inode pinned at open
@@ -3000,11 +4590,19 @@ diskfs_dealloc_process(struct chimera_vfs_request *request)
         return;
     }
 
+    /* A punch that keeps the tail of a compressed extent inflates it first
+     * (see diskfs_inflate_start); a kept head keeps its whole blob. */
+    if ((p->ext_iter.flags & DISKFS_EXT_COMPRESSED) && ee > hole_end) {
+        diskfs_inflate_start(request, diskfs_dealloc_process);
+        return;
+    }
+
     if (es >= hole_start && ee <= hole_end) {
         /* Completely inside the hole: free + remove, then advance. */
         diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
                                  p->ext_iter.device_offset,
-                                 SM_ALIGN_UP(p->ext_iter.length));
+                                 diskfs_ext_phys_len(p->ext_iter.length,
+                                                     p->ext_iter.flags));
         op = diskfs_bt_op_alloc(thread);
         if (diskfs_ext_remove_async(op, thread, p->txn, p->inode_stash[0], es,
                                     diskfs_dealloc_modify_advance_cb, request)) {
@@ -3030,9 +4628,11 @@ diskfs_dealloc_process(struct chimera_vfs_request *request)
     } else if (es < hole_start) {
         /* Overlaps the hole start: free the punched tail [hole_start, ee) of this
          * extent's backing, then remove + reinsert the kept head [es, hole_start). */
-        diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
-                                 p->ext_iter.device_offset + (hole_start - es),
-                                 ee - hole_start);
+        if (!(p->ext_iter.flags & DISKFS_EXT_COMPRESSED)) {
+            diskfs_thread_free_space(thread, p->txn, p->ext_iter.device_id,
+                                     p->ext_iter.device_offset + (hole_start - es),
+                                     ee - hole_start);
+        }
         op = diskfs_bt_op_alloc(thread);
         if (diskfs_ext_remove_async(op, thread, p->txn, p->inode_stash[0], es,
                                     diskfs_dealloc_ostart_removed_cb, request)) {
@@ -3110,7 +4710,7 @@ diskfs_allocate_do_alloc(struct chimera_vfs_request *request)
     struct diskfs_request_private *p      = request->plugin_data;
     struct diskfs_thread          *thread = p->thread;
     uint64_t                       off    = p->loop_off;
-    uint64_t                       dev_id, dev_off, chunk;
+    uint64_t                       dev_id, dev_off, chunk, stripe;
     int                            rc;
 
     chunk = p->loop_left - off;
@@ -3118,7 +4718,14 @@ diskfs_allocate_do_alloc(struct chimera_vfs_request *request)
         chunk = p->alloc_cap;
     }
 
-    rc = diskfs_inode_alloc_space(thread, p->txn, p->inode_stash[0],
+    /* Past the head of a striped file, place one stripe unit at a time so a
+     * preallocated file stripes like a written one. */
+    stripe = thread->shared->stripe_chunk;
+    if (stripe && off >= stripe && chunk > stripe - off % stripe) {
+        chunk = stripe - off % stripe;
+    }
+
+    rc = diskfs_inode_alloc_space(thread, p->txn, p->inode_stash[0], off,
                                   (int64_t) chunk, 0 /* exact, no retained tail */,
                                   &dev_id, &dev_off,
                                   diskfs_allocate_alloc_resume, request);
@@ -3257,7 +4864,6 @@ diskfs_allocate_inode_cb(
     struct chimera_vfs_request    *request = private_data;
     struct diskfs_request_private *p       = request->plugin_data;
     struct diskfs_thread          *thread  = p->thread;
-    struct diskfs_bt_op           *op;
 
     if (unlikely(status != CHIMERA_VFS_OK)) {
         diskfs_op_fail(request, p->txn, status);
@@ -3267,6 +4873,42 @@ diskfs_allocate_inode_cb(
     diskfs_map_attrs(thread, &request->allocate.r_pre_attr, inode);
     p->inode_stash[0] = inode;
 
+    /* Inline file: punching a hole just zeroes bytes of the inline copy;
+     * reserving space needs real extents, so promote first. */
+    if (inode->inline_data) {
+        if (request->allocate.flags & CHIMERA_VFS_ALLOCATE_DEALLOCATE) {
+            uint64_t hole_start = request->allocate.offset;
+            uint64_t hole_end   = hole_start + request->allocate.length;
+
+            if (hole_end > inode->inline_len) {
+                hole_end = inode->inline_len;
+            }
+            if (hole_start >= hole_end) {
+                diskfs_allocate_finalize(request);
+                return;
+            }
+            memset(inode->inline_data + hole_start, 0, hole_end - hole_start);
+            diskfs_inline_store(request, 1, diskfs_allocate_finalize);
+            return;
+        }
+        if (request->allocate.length) {
+            diskfs_inline_promote(request, diskfs_allocate_start);
+            return;
+        }
+    }
+
+    diskfs_allocate_start(request);
+} /* diskfs_allocate_inode_cb */
+
+
+static void
+diskfs_allocate_start(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_inode           *inode  = p->inode_stash[0];
+    struct diskfs_bt_op           *op;
+
     if (request->allocate.flags & CHIMERA_VFS_ALLOCATE_DEALLOCATE) {
         uint64_t hole_start = request->allocate.offset;
         uint64_t hole_end   = hole_start + request->allocate.length;
@@ -3300,7 +4942,7 @@ diskfs_allocate_inode_cb(
     }
 
     diskfs_allocate_finalize(request);
-} /* diskfs_allocate_inode_cb */
+} /* diskfs_allocate_start */
 
 
 void
@@ -3315,8 +4957,10 @@ diskfs_allocate(
     (void) shared;
     (void) private_data;
 
-    p->thread = thread;
-    p->txn    = diskfs_txn_begin(thread, DISKFS_TXN_WRITE);
+    p->thread      = thread;
+    p->zc_iov.data = NULL;
+    p->zi_iov.data = NULL;
+    p->txn         = diskfs_txn_begin(thread, DISKFS_TXN_WRITE);
 
     diskfs_inode_get_fh_async(thread, p->txn,
                               request->fh, request->fh_len,
@@ -3472,6 +5116,14 @@ diskfs_seek_inode_cb(
         return;
     }
 
+    if (inode->inline_data) {
+        /* Inline file: one data region spanning [0, size). */
+        request->seek.r_offset = (request->seek.what == 0) ? offset : inode->size;
+        request->seek.r_eof    = (request->seek.what != 0);
+        diskfs_op_ok(request, p->txn);
+        return;
+    }
+
     p->inode_stash[0] = inode;
     p->loop_pos       = offset;
 
@@ -3533,7 +5185,7 @@ diskfs_commit_acquired_cb(
     }
 
     shard = diskfs_inode_shard(thread->shared, inode->inum);
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
     if (inode->mtime_dirty) {
         diskfs_inode_mtime_unlink_locked(shard, inode);
         /* Drop the dirty-pin; the txn write lock holds the inode.  Never the
@@ -27,6 +27,22 @@ diskfs_il_place(
     struct diskfs_intent_log *il,
     uint64_t                  reclen);
 
+static int
+diskfs_il_reserve(
+    struct diskfs_intent_log *il,
+    uint64_t                  reclen,
+    uint64_t                 *offset,
+    uint64_t                 *seq);
+
+static void
+diskfs_il_stream_kick(
+    struct diskfs_il_stream *st);
+
+static struct diskfs_il_record *
+diskfs_il_handoff_peek(
+    struct diskfs_intent_log *il,
+    struct diskfs_il_stream **stp);
+
 static inline uint32_t
 diskfs_il_pow2(
     uint32_t v);
@@ -107,40 +123,73 @@ diskfs_il_push_doorbell_cb(
     struct evpl          *evpl,
     struct evpl_doorbell *doorbell);
 
+static uint32_t
+diskfs_il_durable_advance(
+    struct diskfs_intent_log *il,
+    uint64_t                  seq,
+    int                       index);
+
+static int
+diskfs_il_stream_retirable(
+    struct diskfs_il_stream *st);
+
+static void
+diskfs_il_stream_retire(
+    struct diskfs_il_stream *st);
+
 static void
 diskfs_il_write_redo(
-    struct diskfs_intent_log *il,
+    struct diskfs_il_stream  *st,
     struct diskfs_redo_entry *entries,
     uint32_t                  num_entries,
-    uint32_t                  nblocks);
+    uint32_t                  nblocks,
+    uint32_t                  nfull,
+    uint64_t                  delta_bytes,
+    uint64_t                  offset,
+    uint64_t                  seq);
 
-static uint32_t
-diskfs_il_txn_blocks(
-    struct diskfs_txn *txn);
+static void
+diskfs_il_txn_shape(
+    struct diskfs_txn *txn,
+    uint32_t          *nblocks,
+    uint32_t          *nfull,
+    uint64_t          *delta_bytes);
 
 static uint64_t
-diskfs_il_blocks_reclen(
-    uint32_t nblocks);
+diskfs_il_rec_len(
+    uint32_t nblocks,
+    uint32_t nfull,
+    uint64_t delta_bytes);
 
-static uint64_t
-diskfs_il_txn_reclen(
-    struct diskfs_txn *txn);
+static uint32_t
+diskfs_redo_delta_encode(
+    const void *base,
+    const void *img,
+    uint8_t    *out,
+    uint32_t    max);
+
+static void
+diskfs_txn_block_delta(
+    struct diskfs_thread    *thread,
+    struct diskfs_txn_block *tb,
+    struct diskfs_block_buf *base,
+    uint64_t                 base_seq);
 
 static void
 diskfs_intent_log_drain_pending(
-    struct diskfs_intent_log *il);
+    struct diskfs_il_stream *st);
 
 static void
 diskfs_il_service_registrations(
-    struct diskfs_intent_log *il);
+    struct diskfs_il_stream *st);
 
 static int
 diskfs_il_process_all(
-    struct diskfs_intent_log *il);
+    struct diskfs_il_stream *st);
 
 static int
 diskfs_il_has_sq_work(
-    struct diskfs_intent_log *il);
+    struct diskfs_il_stream *st);
 
 static void
 diskfs_intent_log_wake_cb(
@@ -187,15 +236,16 @@ diskfs_txn_request_complete_cb(
  * of the log region; a short run at the end is simply left unused until the
  * tail laps it).  The log is empty exactly when no record is pending.
  */
-/* Commit thread owns log_head; the push thread advances log_tail (trim) and
- * the commit thread reads it here to check space.  head == tail means empty
- * (place() always leaves the wrap gap, so the ring never reads full as empty). */
+/* Commit streams advance log_head under place_lock; the push thread advances
+ * log_tail (trim) and the streams read it here to check space.  head == tail
+ * means empty (place() always leaves the wrap gap, so the ring never reads
+ * full as empty).  Outside place_lock the answer is only a hint. */
 static uint64_t
 diskfs_il_contig_free(struct diskfs_intent_log *il)
 {
     uint64_t start = SM_INTENT_LOG_OFFSET;
     uint64_t end   = SM_INTENT_LOG_OFFSET + il->intent_log_size;
-    uint64_t head  = il->log_head;     /* commit-owned */
+    uint64_t head  = __atomic_load_n(&il->log_head, __ATOMIC_ACQUIRE);
     uint64_t tail  = __atomic_load_n(&il->log_tail, __ATOMIC_ACQUIRE);
 
     if (head == tail) {
@@ -220,7 +270,8 @@ diskfs_il_fits(
 } /* diskfs_il_fits */
 
 
-/* Choose the offset for a record of `reclen` bytes and advance log_head. */
+/* Choose the offset for a record of `reclen` bytes and advance log_head.
+ * Caller holds place_lock. */
 static uint64_t
 diskfs_il_place(
     struct diskfs_intent_log *il,
@@ -241,6 +292,64 @@ diskfs_il_place(
 } /* diskfs_il_place */
 
 
+/*
+ * Reserve log space and the record's seq in one step, so records land in the
+ * log in seq order no matter which stream writes them.  Returns 0 when the
+ * space the caller saw has since gone to another stream (or the trim point
+ * has not caught up); the caller leaves its batch on the SQs and retries.
+ */
+static int
+diskfs_il_reserve(
+    struct diskfs_intent_log *il,
+    uint64_t                  reclen,
+    uint64_t                 *offset,
+    uint64_t                 *seq)
+{
+    chimera_mutex_lock(&il->place_lock, "diskfs_il_place");
+
+    if (!diskfs_il_fits(il, reclen)) {
+        /* Nothing live but the trim point lags log_head (the push thread only
+         * moves it to a record it knows of): the log is empty, reset it. */
+        if (__atomic_load_n(&il->live_records, __ATOMIC_ACQUIRE) != 0) {
+            pthread_mutex_unlock(&il->place_lock);
+            return 0;
+        }
+        __atomic_store_n(&il->log_tail, il->log_head, __ATOMIC_RELEASE);
+        if (!diskfs_il_fits(il, reclen)) {
+            pthread_mutex_unlock(&il->place_lock);
+            return 0;
+        }
+    }
+
+    *offset = diskfs_il_place(il, reclen);
+    *seq    = il->log_seq++;
+
+    pthread_mutex_unlock(&il->place_lock);
+    return 1;
+} /* diskfs_il_reserve */
+
+
+/* Rouse a sleeping commit stream.  An awake one notices new work (retirable
+ * records, freed log space) from its per-iteration poll. */
+static void
+diskfs_il_stream_kick(struct diskfs_il_stream *st)
+{
+    struct diskfs_intent_log *il = st->il;
+
+    if (__atomic_load_n(&st->awake, __ATOMIC_SEQ_CST)) {
+        return;
+    }
+
+    /* The doorbell's fd closes when the stream's thread is destroyed; alive is
+     * cleared (under the same lock) before that happens. */
+    pthread_mutex_lock(&il->wake_lock);
+    if (st->alive) {
+        evpl_ring_doorbell(&st->wake_doorbell);
+    }
+    pthread_mutex_unlock(&il->wake_lock);
+} /* diskfs_il_stream_kick */
+
+
 /* ================================================================== */
 /* Tail-push thread: per-block coalescing home writes + in-order trim  */
 /* ================================================================== */
@@ -451,7 +560,7 @@ diskfs_push_clean_block(
     uint32_t                   bucket = diskfs_block_bucket(dev, off);
     struct diskfs_block       *blk;
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_block_shard");
     blk = diskfs_block_lookup_locked(shard, bucket, dev, off);
     if (blk && blk->state == DISKFS_BLOCK_LOGGED &&
         __atomic_load_n(&blk->seq, __ATOMIC_ACQUIRE) == seq && blk->pin_count == 0) {
@@ -497,7 +606,7 @@ diskfs_push_record_covered(
 static void
 diskfs_push_trim(struct diskfs_intent_log *il)
 {
-    int advanced = 0;
+    int advanced = 0, i;
 
     while (il->push_head && diskfs_push_record_covered(il, il->push_head)) {
         struct diskfs_il_record *rec = il->push_head;
@@ -508,19 +617,17 @@ diskfs_push_trim(struct diskfs_intent_log *il)
         }
 
         /* Trim point = start of the oldest record we have not retired: the next
-         * record in the FIFO, or (FIFO drained) the oldest record the commit
-         * thread has handed off but we have not yet consumed.  If neither is
-         * known, leave log_tail unchanged (conservative -- the next hand-off
+         * record in the FIFO, or (FIFO drained) the next-seq record a stream
+         * has handed off but we have not yet consumed.  If neither is known,
+         * leave log_tail unchanged (conservative -- the next hand-off
          * advances it). */
         if (il->push_head) {
             __atomic_store_n(&il->log_tail, il->push_head->offset, __ATOMIC_RELEASE);
         } else {
-            uint32_t hh = il->handoff_head;
-            uint32_t ht = __atomic_load_n(&il->handoff_tail, __ATOMIC_ACQUIRE);
-            if (hh != ht) {
-                __atomic_store_n(&il->log_tail,
-                                 il->handoff[hh & DISKFS_HANDOFF_RING_MASK]->offset,
-                                 __ATOMIC_RELEASE);
+            struct diskfs_il_record *next = diskfs_il_handoff_peek(il, NULL);
+
+            if (next) {
+                __atomic_store_n(&il->log_tail, next->offset, __ATOMIC_RELEASE);
             }
         }
 
@@ -538,14 +645,11 @@ diskfs_push_trim(struct diskfs_intent_log *il)
 
     if (advanced) {
         diskfs_il_push_metrics(il);
-        /* Freed log space -> resume the commit thread, but only while its
-         * doorbell is still live.  The commit thread is destroyed before the
-         * push thread (the push thread drains the records it handed off), which
-         * closes wake_doorbell's fd; ringing it after that aborts.  commit_alive
-         * is cleared before that teardown, and during shutdown the commit thread
-         * makes progress by self-pumping, so a skipped wake is harmless. */
-        if (__atomic_load_n(&il->commit_alive, __ATOMIC_ACQUIRE)) {
-            evpl_ring_doorbell(&il->wake_doorbell);
+        /* Freed log space -> resume any stream that went to sleep.  Streams
+         * are destroyed before the push thread (it drains what they handed
+         * off); the kick skips a stream whose doorbell is already gone. */
+        for (i = 0; i < il->num_streams; i++) {
+            diskfs_il_stream_kick(&il->streams[i]);
         }
     }
 } /* diskfs_push_trim */
@@ -555,6 +659,11 @@ diskfs_push_trim(struct diskfs_intent_log *il)
 static void
 diskfs_push_issue(struct diskfs_intent_log *il)
 {
+    /* Crash test: the log is the only durable copy until recovery replays it */
+    if (unlikely(il->crash_test)) {
+        return;
+    }
+
     while (il->push_outstanding < DISKFS_PUSH_WATERMARK) {
         struct diskfs_pending *e = diskfs_ready_pop(il);
 
@@ -569,9 +678,9 @@ diskfs_push_issue(struct diskfs_intent_log *il)
         il->push_outstanding++;
         diskfs_il_push_metrics(il);
 
-        diskfs_metric_il_block_io(il, DISKFS_METRIC_IO_WRITE,
+        diskfs_metric_il_block_io(&il->metrics, DISKFS_METRIC_IO_WRITE,
                                   DISKFS_METRIC_IO_TAIL_PUSH, DISKFS_BLOCK_SIZE);
-        diskfs_metric_il_block_io_device(il, e->device_id, DISKFS_METRIC_IO_WRITE,
+        diskfs_metric_il_block_io_device(il, &il->metrics, e->device_id, DISKFS_METRIC_IO_WRITE,
                                          DISKFS_METRIC_IO_TAIL_PUSH, DISKFS_BLOCK_SIZE);
         evpl_block_write(il->push_evpl, il->home_queue[e->device_id], e->iov, 1,
                          e->device_offset, il->sync, diskfs_push_block_cb, e);
@@ -619,9 +728,43 @@ diskfs_push_block_cb(
 
 
 /*
- * Push-thread doorbell: drain the hand-off ring into the record FIFO and the
- * pending map, then issue and trim.  Rung by the commit thread after it hands
- * off durable records.
+ * The record with the next expected seq, if the stream that wrote it has
+ * handed it off yet.  Each stream hands off in seq order, so it can only be at
+ * the head of one of the rings.
+ */
+static struct diskfs_il_record *
+diskfs_il_handoff_peek(
+    struct diskfs_intent_log *il,
+    struct diskfs_il_stream **stp)
+{
+    int i;
+
+    for (i = 0; i < il->num_streams; i++) {
+        struct diskfs_il_stream *st   = &il->streams[i];
+        uint32_t                 head = st->handoff_head;
+        struct diskfs_il_record *rec;
+
+        if (head == __atomic_load_n(&st->handoff_tail, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        rec = st->handoff[head & DISKFS_HANDOFF_RING_MASK];
+        if (rec->seq == il->push_seq) {
+            if (stp) {
+                *stp = st;
+            }
+            return rec;
+        }
+    }
+    return NULL;
+} /* diskfs_il_handoff_peek */
+
+
+/*
+ * Push-thread doorbell: merge the streams' hand-off rings, in seq order, into
+ * the record FIFO and the pending map, then issue and trim.  Rung by a stream
+ * after it hands off durable records.  A record is handed off only once the
+ * durable frontier has passed it, so every lower seq is durable and is (or is
+ * about to be) at the head of its own stream's ring.
  */
 static void
 diskfs_il_push_doorbell_cb(
@@ -631,15 +774,17 @@ diskfs_il_push_doorbell_cb(
     struct diskfs_intent_log *il = container_of(doorbell,
                                                 struct diskfs_intent_log,
                                                 push_doorbell);
-    uint32_t                  head = il->handoff_head;
-    uint32_t                  tail = __atomic_load_n(&il->handoff_tail, __ATOMIC_ACQUIRE);
+    struct diskfs_il_stream  *st;
+    struct diskfs_il_record  *rec;
+    uint64_t                  taken = 0;
 
     (void) evpl;
 
-    while (head != tail) {
-        struct diskfs_il_record *rec = il->handoff[head & DISKFS_HANDOFF_RING_MASK];
+    while ((rec = diskfs_il_handoff_peek(il, &st))) {
+        __atomic_store_n(&st->handoff_head, st->handoff_head + 1, __ATOMIC_RELEASE);
+        il->push_seq++;
+        taken++;
 
-        head++;
         rec->next          = NULL;
         rec->inflight_refs = 0;
         rec->retired       = 0;
@@ -651,7 +796,11 @@ diskfs_il_push_doorbell_cb(
         il->push_tail = rec;
         diskfs_push_fold_record(il, rec);
     }
-    __atomic_store_n(&il->handoff_head, head, __ATOMIC_RELEASE);
+
+    if (taken) {
+        chimera_thread_stats_queue(il->push_stats, -(int64_t) taken);
+        chimera_thread_stats_work(taken);
+    }
 
     diskfs_push_issue(il);
     diskfs_push_trim(il);
@@ -659,46 +808,72 @@ diskfs_il_push_doorbell_cb(
 
 
 /*
- * Runs on the intent-log thread when a redo record has been written
- * durably.  The transaction's changes are now recoverable, so drop the
- * block pins (-> LOGGED, awaiting tail-push) and the inode locks, then push
- * the completion onto the worker's CQ.
+ * Publish `seq` durable and advance the shared frontier over every durable
+ * seq.  Returns a mask of the streams owning the seqs this call moved the
+ * frontier past (index bit set).  Lock-free: each step is a CAS on
+ * durable_seq gated on the slot holding exactly that seq, so concurrent
+ * completions on several streams each move it as far as they can and a step
+ * is never lost -- whichever of the two racing threads publishes last sees the
+ * other's seq.
  */
-void
-diskfs_redo_write_cb(
-    struct evpl *evpl,
-    int          status,
-    void        *private_data)
+static uint32_t
+diskfs_il_durable_advance(
+    struct diskfs_intent_log *il,
+    uint64_t                  seq,
+    int                       index)
 {
-    struct diskfs_redo_ctx   *ctx        = private_data;
-    struct diskfs_intent_log *il         = ctx->il;
-    int                       handed_off = 0;
+    uint32_t passed = 0;
+    uint64_t w;
 
-    (void) evpl;
-    chimera_diskfs_abort_if(status, "redo record write failed: %d", status);
+    __atomic_store_n(&il->owner[seq & DISKFS_IL_SEQ_MASK], (uint8_t) index, __ATOMIC_RELAXED);
+    __atomic_store_n(&il->durable[seq & DISKFS_IL_SEQ_MASK], seq + 1, __ATOMIC_SEQ_CST);
 
-    /* One redo block write (one chunk) drained from the log queue.  Resume SQ
-     * draining once redo writes bleed back down to the low watermark. */
-    if (--il->redo_inflight == DISKFS_COMMIT_LOWAT) {
-        evpl_ring_doorbell(&il->wake_doorbell);
+    w = __atomic_load_n(&il->durable_seq, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&il->durable[w & DISKFS_IL_SEQ_MASK], __ATOMIC_SEQ_CST) == w + 1) {
+        uint8_t owner = __atomic_load_n(&il->owner[w & DISKFS_IL_SEQ_MASK], __ATOMIC_RELAXED);
+
+        if (__atomic_compare_exchange_n(&il->durable_seq, &w, w + 1, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            passed |= 1u << owner;
+            w++;
+        }
+        /* else: w now holds the frontier another stream moved it to */
     }
 
-    /* One chunk of a possibly multi-chunk journal write landed; the record is
-     * durable only when its last chunk completes. */
-    if (--ctx->segments > 0) {
-        diskfs_il_commit_metrics(il);
-        return;
+    return passed;
+} /* diskfs_il_durable_advance */
+
+
+/* The stream's oldest submitted record is durable and behind the frontier. */
+static int
+diskfs_il_stream_retirable(struct diskfs_il_stream *st)
+{
+    struct diskfs_retire_slot *slot;
+
+    if (st->retire_head == st->retire_tail) {
+        return 0;
     }
+    slot = &st->retire[st->retire_head & DISKFS_RETIRE_RING_MASK];
+    return slot->done &&
+           slot->ctx->rec->seq < __atomic_load_n(&st->il->durable_seq, __ATOMIC_SEQ_CST);
+} /* diskfs_il_stream_retirable */
+
 
-    /* Mark this record done; retire the contiguous completed prefix strictly in
-     * submission (== log) order.  Replay stops at the first torn record, so a
-     * later record is not recoverable -- nor ACKable -- until every earlier
-     * record is durable. */
-    il->retire[ctx->retire_idx & DISKFS_RETIRE_RING_MASK].done = 1;
+/*
+ * Retire the stream's contiguous prefix of records that are behind the durable
+ * frontier: ACK their transactions back to the workers and hand the records to
+ * the push thread.  Runs on the stream's commit thread (it is the only
+ * producer on its channels' CQs and its hand-off ring).
+ */
+static void
+diskfs_il_stream_retire(struct diskfs_il_stream *st)
+{
+    struct diskfs_intent_log *il         = st->il;
+    int                       handed_off = 0;
 
-    while (il->retire_head != il->retire_tail &&
-           il->retire[il->retire_head & DISKFS_RETIRE_RING_MASK].done) {
-        struct diskfs_retire_slot *slot = &il->retire[il->retire_head & DISKFS_RETIRE_RING_MASK];
+    while (diskfs_il_stream_retirable(st)) {
+        struct diskfs_retire_slot *slot = &st->retire[st->retire_head & DISKFS_RETIRE_RING_MASK];
         struct diskfs_redo_ctx    *rc   = slot->ctx;
         struct diskfs_il_record   *rec  = rc->rec;
         uint32_t                   ht, i;
@@ -710,10 +885,10 @@ diskfs_redo_write_cb(
 
             prometheus_stopwatch_start(&entry->durable_time);
             diskfs_metric_time_sample(
-                il->metrics.txn_latency[DISKFS_METRIC_TXN_SUBMIT_TO_DURABLE],
+                st->metrics.txn_latency[DISKFS_METRIC_TXN_SUBMIT_TO_DURABLE],
                 &entry->submit_time);
             diskfs_metric_time_sample(
-                il->metrics.txn_latency[DISKFS_METRIC_TXN_QUEUE_TO_DURABLE],
+                st->metrics.txn_latency[DISKFS_METRIC_TXN_QUEUE_TO_DURABLE],
                 &entry->enqueue_time);
 
             /* Record durable & recoverable: drop block pins (-> LOGGED),
@@ -730,60 +905,121 @@ diskfs_redo_write_cb(
             ch->cq_inflight--;
         }
 
-        /* Hand the durable record to the push thread, in log order.  The
+        /* Hand the durable record to the push thread, in seq order.  The
          * hand-off ring is sized larger than the log can ever hold, so it
          * cannot fill before the log does. */
-        ht = il->handoff_tail;
-        chimera_diskfs_abort_if(ht - __atomic_load_n(&il->handoff_head, __ATOMIC_ACQUIRE) >=
+        ht = st->handoff_tail;
+        chimera_diskfs_abort_if(ht - __atomic_load_n(&st->handoff_head, __ATOMIC_ACQUIRE) >=
                                 DISKFS_HANDOFF_RING_SIZE, "intent-log hand-off ring overflow");
-        il->handoff[ht & DISKFS_HANDOFF_RING_MASK] = rec;
-        __atomic_store_n(&il->handoff_tail, ht + 1, __ATOMIC_RELEASE);
+        st->handoff[ht & DISKFS_HANDOFF_RING_MASK] = rec;
+        chimera_thread_stats_queue(il->push_stats, 1);
+        __atomic_store_n(&st->handoff_tail, ht + 1, __ATOMIC_RELEASE);
         handed_off = 1;
 
         slot->ctx  = NULL;
         slot->done = 0;
         free(rc->entries);
         free(rc);
-        il->retire_head++;
+        st->retire_head++;
     }
 
-    diskfs_il_commit_metrics(il);
-
     if (handed_off) {
         evpl_ring_doorbell(&il->push_doorbell);
     }
+} /* diskfs_il_stream_retire */
+
+
+/*
+ * Runs on a stream's commit thread when a redo record has been written
+ * durably.  Publish it to the durable frontier; once the frontier passes it
+ * the transaction's changes are recoverable, so drop the block pins (-> LOGGED,
+ * awaiting tail-push) and the inode locks, then push the completion onto the
+ * worker's CQ.
+ */
+void
+diskfs_redo_write_cb(
+    struct evpl *evpl,
+    int          status,
+    void        *private_data)
+{
+    struct diskfs_redo_ctx   *ctx = private_data;
+    struct diskfs_il_stream  *st  = ctx->stream;
+    struct diskfs_intent_log *il  = st->il;
+    uint32_t                  passed;
+    int                       i;
+
+    (void) evpl;
+    chimera_diskfs_abort_if(status, "redo record write failed: %d", status);
+
+    /* One redo block write (one chunk) drained from the log queue.  Resume SQ
+     * draining once redo writes bleed back down to the low watermark. */
+    __atomic_sub_fetch(&il->redo_inflight, 1, __ATOMIC_RELAXED);
+    if (--st->redo_inflight == DISKFS_COMMIT_LOWAT) {
+        evpl_ring_doorbell(&st->wake_doorbell);
+    }
+
+    /* One chunk of a possibly multi-chunk journal write landed; the record is
+     * durable only when its last chunk completes. */
+    if (--ctx->segments > 0) {
+        diskfs_il_commit_metrics(il);
+        return;
+    }
+
+    /* Mark this record done and move the frontier.  Retirement is strictly in
+     * seq order across every stream: replay of a later record without an
+     * earlier one it builds on (a shared AG-log block, say) is not a state
+     * any client was told about, so nothing is ACKed until every lower seq is
+     * durable. */
+    st->retire[ctx->retire_idx & DISKFS_RETIRE_RING_MASK].done = 1;
+
+    passed = diskfs_il_durable_advance(il, ctx->rec->seq, st->index);
+
+    diskfs_il_stream_retire(st);
+
+    /* Other streams whose records we just moved the frontier past. */
+    for (i = 0; i < il->num_streams; i++) {
+        if (i != st->index && (passed & (1u << i))) {
+            diskfs_il_stream_kick(&il->streams[i]);
+        }
+    }
+
+    diskfs_il_commit_metrics(il);
 } /* diskfs_redo_write_cb */
 
 /*
- * Build a full-block redo record for one transaction and issue a durable
- * write into the reserved intent-log region.  Runs on the intent-log thread.
+ * Build a redo record for a batch of transactions and issue a durable write
+ * into the log space the caller reserved (diskfs_il_reserve, at `offset` under
+ * `seq`).  Blocks whose snapshot carries a delta go into the header region;
+ * the rest are logged as full images.  Runs on the stream's commit thread.
  */
 static void
 diskfs_il_write_redo(
-    struct diskfs_intent_log *il,
+    struct diskfs_il_stream  *st,
     struct diskfs_redo_entry *entries,
     uint32_t                  num_entries,
-    uint32_t                  nblocks)
+    uint32_t                  nblocks,
+    uint32_t                  nfull,
+    uint64_t                  delta_bytes,
+    uint64_t                  offset,
+    uint64_t                  seq)
 {
+    struct diskfs_intent_log        *il = st->il;
     struct diskfs_redo_ctx          *ctx;
     struct diskfs_il_record         *rec;
     struct diskfs_redo_header       *hdr;
     struct diskfs_redo_block_header *bh;
-    uint64_t                         hdr_len, reclen, offset;
-    uint32_t                         i, e;
-    char                            *p;
-    int                              niov;
-    XXH3_state_t                     xs;
-
-    hdr_len = diskfs_il_hdr_len(nblocks);
-    reclen  = diskfs_il_blocks_reclen(nblocks);
+    uint64_t                         hdr_len, reclen;
+    uint32_t                         i, e, log_niov;
+    char                            *p, *d;
+    int                              niov, pass;
+    XXH128_hash_t                    h;
 
-    /* Caller guarantees space (diskfs_iq_process_channel checks diskfs_il_fits
-     * before consuming SQ entries), so placement always succeeds. */
-    offset = diskfs_il_place(il, reclen);
+    hdr_len  = diskfs_il_hdr_len(nblocks, delta_bytes);
+    reclen   = diskfs_il_rec_len(nblocks, nfull, delta_bytes);
+    log_niov = 1 + nfull;
 
     rec             = malloc(sizeof(*rec));
-    rec->seq        = il->log_seq;
+    rec->seq        = seq;
     rec->offset     = offset;
     rec->reclen     = reclen;
     rec->num_blocks = nblocks;
@@ -793,12 +1029,12 @@ diskfs_il_write_redo(
     rec->next       = NULL;
 
     /* iovs[0]: materialized header region (redo_header + per-block headers). */
-    niov = evpl_iovec_alloc(il->evpl, hdr_len, DISKFS_BLOCK_SIZE, 1,
+    niov = evpl_iovec_alloc(st->evpl, hdr_len, DISKFS_BLOCK_SIZE, 1,
                             EVPL_IOVEC_FLAG_SHARED, &rec->iovs[0]);
     chimera_diskfs_abort_if(niov != 1, "redo header did not fit in one iovec (%d)", niov);
 
     ctx              = malloc(sizeof(*ctx));
-    ctx->il          = il;
+    ctx->stream      = st;
     ctx->entries     = malloc(num_entries * sizeof(*ctx->entries));
     ctx->num_entries = num_entries;
     ctx->rec         = rec;
@@ -809,79 +1045,104 @@ diskfs_il_write_redo(
     hdr->magic      = DISKFS_REDO_MAGIC;
     hdr->csum_lo    = 0;
     hdr->csum_hi    = 0;
-    hdr->seq        = il->log_seq++;
-    rec->seq        = hdr->seq;
+    hdr->seq        = seq;
     hdr->tail       = __atomic_load_n(&il->log_tail, __ATOMIC_ACQUIRE);
     hdr->num_blocks = nblocks;
     hdr->reclen     = (uint32_t) reclen;
     p              += sizeof(*hdr);
+    d               = p + (size_t) nblocks * sizeof(*bh);
 
+    /* Full images first, then deltas: the image iovecs that follow the header
+     * region are then the first nfull block slots, in block-header order.
+     * Every slot, delta or not, keeps a ref to its full image for the
+     * tail-pusher. */
     i = 0;
-    for (e = 0; e < num_entries; e++) {
-        struct diskfs_txn_block *tb;
-
-        for (tb = entries[e].entry.txn->blocks; tb; tb = tb->next, i++) {
-            struct diskfs_block *blk = tb->block;
+    for (pass = 0; pass < 2; pass++) {
+        for (e = 0; e < num_entries; e++) {
+            struct diskfs_txn_block *tb;
 
-            /* Stamp the block with this record's seq so the tail-pusher can
-            * tell whether the block has been re-logged since this image. */
-            __atomic_store_n(&blk->seq, rec->seq, __ATOMIC_RELEASE);
+            for (tb = entries[e].entry.txn->blocks; tb; tb = tb->next) {
+                struct diskfs_block *blk = tb->block;
 
-            bh                = (struct diskfs_redo_block_header *) p;
-            bh->device_id     = blk->device_id;
-            bh->pad           = 0;
-            bh->device_offset = blk->device_offset;
-            p                += sizeof(*bh);
+                if ((tb->delta != NULL) != pass) {
+                    continue;
+                }
 
-            evpl_iovec_clone(&rec->iovs[1 + i], &tb->snap_buf->iov);
-            rec->block_bufs[i] = tb->snap_buf;
+                /* Stamp the block with this record's seq so the tail-pusher can
+                * tell whether the block has been re-logged since this image. */
+                __atomic_store_n(&blk->seq, rec->seq, __ATOMIC_RELEASE);
+
+                evpl_iovec_clone(&rec->iovs[1 + i], &tb->snap_buf->iov);
+                rec->block_bufs[i] = tb->snap_buf;
+
+                bh                = (struct diskfs_redo_block_header *) p;
+                bh->device_id     = blk->device_id;
+                bh->device_offset = blk->device_offset;
+
+                if (tb->delta) {
+                    /* The header hash below covers the payload. */
+                    memcpy(d, tb->delta, tb->delta_len);
+                    d                += tb->delta_len;
+                    bh->delta_len     = tb->delta_len;
+                    bh->block_csum_lo = 0;
+                    bh->block_csum_hi = 0;
+                    free(tb->delta);
+                    tb->delta = NULL;
+                } else {
+                    /* Per-block image hash: recovery verifies each image
+                     * against it independently of the header hash below. */
+                    h = XXH3_128bits(rec->iovs[1 + i].data, DISKFS_BLOCK_SIZE);
+
+                    bh->delta_len     = 0;
+                    bh->block_csum_lo = h.low64;
+                    bh->block_csum_hi = h.high64;
+                }
+                p += sizeof(*bh);
+                i++;
+            }
         }
     }
     chimera_diskfs_abort_if(i != nblocks,
                             "redo grouped block count changed (%u != %u)", i, nblocks);
 
     /* Zero the header-region tail padding so the checksum covers deterministic
-     * bytes, then stamp the XXH3-128 over the header region + every block. */
+     * bytes, then stamp the XXH3-128 over the header region (which carries
+     * every full block's hash and every delta) -- the layout
+     * diskfs_recover_log verifies. */
     {
         char *end = (char *) rec->iovs[0].data + hdr_len;
 
-        if (p < end) {
-            memset(p, 0, (size_t) (end - p));
+        if (d < end) {
+            memset(d, 0, (size_t) (end - d));
         }
     }
-    XXH3_128bits_reset(&xs);
-    XXH3_128bits_update(&xs, rec->iovs[0].data, hdr_len);
-    for (i = 0; i < nblocks; i++) {
-        XXH3_128bits_update(&xs, rec->iovs[1 + i].data, DISKFS_BLOCK_SIZE);
-    }
-    {
-        XXH128_hash_t h = XXH3_128bits_digest(&xs);
-
-        hdr->csum_lo = h.low64;
-        hdr->csum_hi = h.high64;
-    }
+    h            = XXH3_128bits(rec->iovs[0].data, hdr_len);
+    hdr->csum_lo = h.low64;
+    hdr->csum_hi = h.high64;
 
-    ctx->segments = (rec->niov + DISKFS_IL_MAX_IOV - 1) / DISKFS_IL_MAX_IOV;
+    ctx->segments = (log_niov + DISKFS_IL_MAX_IOV - 1) / DISKFS_IL_MAX_IOV;
 
-    /* Reserve this record's retirement-ring slot (in submission/log order) so
+    /* Reserve this record's retirement-ring slot (in submission/seq order) so
      * the completion can retire the contiguous done-prefix in order. */
-    ctx->retire_idx                                            = il->retire_tail;
-    il->retire[il->retire_tail & DISKFS_RETIRE_RING_MASK].ctx  = ctx;
-    il->retire[il->retire_tail & DISKFS_RETIRE_RING_MASK].done = 0;
-    il->retire_tail++;
+    ctx->retire_idx                                            = st->retire_tail;
+    st->retire[st->retire_tail & DISKFS_RETIRE_RING_MASK].ctx  = ctx;
+    st->retire[st->retire_tail & DISKFS_RETIRE_RING_MASK].done = 0;
+    st->retire_tail++;
 
-    il->redo_inflight += ctx->segments;     /* one redo block write per chunk below */
+    st->redo_inflight += ctx->segments;     /* one redo block write per chunk below */
+    __atomic_add_fetch(&il->redo_inflight, ctx->segments, __ATOMIC_RELAXED);
     diskfs_il_commit_metrics(il);
 
-    /* Issue the record in <=DISKFS_IL_MAX_IOV-iovec chunks to consecutive
+    /* Issue the record -- the header region and the full images, the first
+     * log_niov iovecs -- in <=DISKFS_IL_MAX_IOV-iovec chunks to consecutive
      * offsets (the on-log record is contiguous); all chunks share ctx and the
      * last completion finalizes the record. */
     {
         uint32_t done = 0;
         uint64_t woff = offset;
 
-        while (done < rec->niov) {
-            uint32_t cnt   = rec->niov - done;
+        while (done < log_niov) {
+            uint32_t cnt   = log_niov - done;
             uint64_t bytes = 0;
             uint32_t k;
 
@@ -892,12 +1153,12 @@ diskfs_il_write_redo(
                 bytes += rec->iovs[done + k].length;
             }
 
-            evpl_block_write(il->evpl, il->log_queue,
+            evpl_block_write(st->evpl, st->log_queue,
                              &rec->iovs[done], cnt, woff, il->sync,
                              diskfs_redo_write_cb, ctx);
-            diskfs_metric_il_block_io(il, DISKFS_METRIC_IO_WRITE,
+            diskfs_metric_il_block_io(&st->metrics, DISKFS_METRIC_IO_WRITE,
                                       DISKFS_METRIC_IO_INTENT_LOG, bytes);
-            diskfs_metric_il_block_io_device(il, SM_INTENT_LOG_DEVICE,
+            diskfs_metric_il_block_io_device(il, &st->metrics, SM_INTENT_LOG_DEVICE,
                                              DISKFS_METRIC_IO_WRITE,
                                              DISKFS_METRIC_IO_INTENT_LOG, bytes);
             woff += bytes;
@@ -906,76 +1167,208 @@ diskfs_il_write_redo(
     }
 } /* diskfs_il_write_redo */
 
-static uint32_t
-diskfs_il_txn_blocks(struct diskfs_txn *txn)
+/*
+ * Add one transaction's blocks to a record's shape: total blocks, blocks
+ * logged as full images, and delta payload bytes.  A transaction whose deltas
+ * alone would swell the header region past DISKFS_IL_TXN_DELTA_MAX (a big
+ * truncate, say) is logged as full images instead; dropping the deltas here
+ * keeps the answer stable if the batch is retried.
+ */
+static void
+diskfs_il_txn_shape(
+    struct diskfs_txn *txn,
+    uint32_t          *nblocks,
+    uint32_t          *nfull,
+    uint64_t          *delta_bytes)
 {
     struct diskfs_txn_block *tb;
-    uint32_t                 nblocks = 0;
+    uint64_t                 bytes = 0;
+    uint32_t                 n     = 0, full = 0;
 
     for (tb = txn->blocks; tb; tb = tb->next) {
-        nblocks++;
+        n++;
+        if (tb->delta) {
+            bytes += tb->delta_len;
+        } else {
+            full++;
+        }
     }
-    return nblocks;
-} /* diskfs_il_txn_blocks */
 
+    if (bytes > DISKFS_IL_TXN_DELTA_MAX) {
+        for (tb = txn->blocks; tb; tb = tb->next) {
+            free(tb->delta);
+            tb->delta     = NULL;
+            tb->delta_len = 0;
+        }
+        bytes = 0;
+        full  = n;
+    }
+
+    *nblocks     += n;
+    *nfull       += full;
+    *delta_bytes += bytes;
+} /* diskfs_il_txn_shape */
 
+
+/* Padded on-log length of a redo record of the given shape. */
 static uint64_t
-diskfs_il_blocks_reclen(uint32_t nblocks)
+diskfs_il_rec_len(
+    uint32_t nblocks,
+    uint32_t nfull,
+    uint64_t delta_bytes)
 {
-    return diskfs_il_hdr_len(nblocks) + (uint64_t) nblocks * DISKFS_BLOCK_SIZE;
-} /* diskfs_il_blocks_reclen */
+    return diskfs_il_hdr_len(nblocks, delta_bytes) + (uint64_t) nfull * DISKFS_BLOCK_SIZE;
+} /* diskfs_il_rec_len */
 
 
-/* Padded on-log length of the redo record for one transaction. */
-static uint64_t
-diskfs_il_txn_reclen(struct diskfs_txn *txn)
+/*
+ * Encode the bytes of `img` that differ from `base` as delta extents into
+ * `out`.  Compares a word at a time and emits one extent per run of changed
+ * words, trimmed to its first and last changed byte (an unchanged word is
+ * already wider than an extent header, so splitting there never costs more).
+ * Returns the payload length, or 0 if it would exceed `max`.
+ */
+static uint32_t
+diskfs_redo_delta_encode(
+    const void *base,
+    const void *img,
+    uint8_t    *out,
+    uint32_t    max)
+{
+    const uint64_t          *bw = base, *iw = img;
+    const uint8_t           *bb = base, *ib = img;
+    struct diskfs_redo_delta ext;
+    uint32_t                 nwords = DISKFS_BLOCK_SIZE / sizeof(uint64_t);
+    uint32_t                 w, start, end, len = 0;
+
+    w = 0;
+    while (w < nwords) {
+        if (bw[w] == iw[w]) {
+            w++;
+            continue;
+        }
+
+        start = w;
+        while (w < nwords && bw[w] != iw[w]) {
+            w++;
+        }
+        end = w;
+
+        start *= sizeof(uint64_t);
+        end   *= sizeof(uint64_t);
+        while (bb[start] == ib[start]) {
+            start++;
+        }
+        while (bb[end - 1] == ib[end - 1]) {
+            end--;
+        }
+
+        if (len + sizeof(ext) + (end - start) > max) {
+            return 0;
+        }
+
+        ext.offset = (uint16_t) start;
+        ext.length = (uint16_t) (end - start);
+        memcpy(out + len, &ext, sizeof(ext));
+        memcpy(out + len + sizeof(ext), ib + start, end - start);
+        len += sizeof(ext) + (end - start);
+    }
+
+    if (len == 0) {
+        /* Nothing changed; a delta is never empty (delta_len 0 is a full image). */
+        ext.offset = 0;
+        ext.length = 0;
+        memcpy(out, &ext, sizeof(ext));
+        len = sizeof(ext);
+    }
+
+    return len;
+} /* diskfs_redo_delta_encode */
+
+
+/*
+ * Try to log a snapshotted block as a delta against `base`, its image as of
+ * its previous record.  Only private (inode-locked) blocks qualify, and only
+ * once that previous record is durable, so replay always has the image the
+ * delta applies to.  On success tb->delta owns the payload.
+ */
+static void
+diskfs_txn_block_delta(
+    struct diskfs_thread    *thread,
+    struct diskfs_txn_block *tb,
+    struct diskfs_block_buf *base,
+    uint64_t                 base_seq)
 {
-    return diskfs_il_blocks_reclen(diskfs_il_txn_blocks(txn));
-} /* diskfs_il_txn_reclen */
+    struct diskfs_shared *shared = thread->shared;
+    uint8_t               scratch[DISKFS_BLOCK_SIZE / 2];
+    uint32_t              len;
+
+    if (tb->journal || shared->redo_delta_max == 0 ||
+        base_seq == 0 ||
+        base_seq >= __atomic_load_n(&shared->intent_log.durable_seq, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    len = diskfs_redo_delta_encode(base->iov.data, tb->snap.data, scratch,
+                                   shared->redo_delta_max);
+    if (len == 0) {
+        return;
+    }
+
+    tb->delta = malloc(len);
+    chimera_diskfs_abort_if(!tb->delta, "failed to allocate %u-byte redo delta", len);
+    memcpy(tb->delta, scratch, len);
+    tb->delta_len = len;
+} /* diskfs_txn_block_delta */
 
 
 static int
-diskfs_iq_process_batch(struct diskfs_intent_log *il)
+diskfs_iq_process_batch(struct diskfs_il_stream *st)
 {
-    struct diskfs_redo_entry entries[DISKFS_IL_MAX_IOV];
-    uint32_t                 sq_head[DISKFS_IL_MAX_CHANNELS]  = { 0 };
-    uint32_t                 sq_tail[DISKFS_IL_MAX_CHANNELS]  = { 0 };
-    uint32_t                 consumed[DISKFS_IL_MAX_CHANNELS] = { 0 };
-    uint32_t                 batch_count                      = 0;
-    uint32_t                 batch_blocks                     = 0;
-    uint32_t                 start, rounds, pass, i;
-    int                      stopped = 0;
-
-    if (il->redo_inflight >= DISKFS_COMMIT_WATERMARK) {
+    struct diskfs_intent_log *il = st->il;
+    struct diskfs_redo_entry  entries[DISKFS_IL_MAX_IOV];
+    uint32_t                  sq_head[DISKFS_IL_MAX_CHANNELS]  = { 0 };
+    uint32_t                  sq_tail[DISKFS_IL_MAX_CHANNELS]  = { 0 };
+    uint32_t                  consumed[DISKFS_IL_MAX_CHANNELS] = { 0 };
+    uint32_t                  batch_count                      = 0;
+    uint32_t                  batch_blocks                     = 0;
+    uint32_t                  batch_full                       = 0;
+    uint64_t                  batch_delta                      = 0;
+    uint32_t                  start, rounds, pass, i;
+    uint64_t                  offset, seq;
+    int                       stopped = 0;
+
+    if (st->redo_inflight >= DISKFS_COMMIT_WATERMARK) {
         return 0;
     }
 
-    if (il->retire_tail - il->retire_head >= DISKFS_RETIRE_RING_SIZE) {
+    if (st->retire_tail - st->retire_head >= DISKFS_RETIRE_RING_SIZE) {
         return 0;
     }
 
-    if (il->num_channels == 0) {
+    if (st->num_channels == 0) {
         return 0;
     }
 
-    for (i = 0; i < il->num_channels; i++) {
-        struct diskfs_iq_channel *ch = il->channels[i];
+    for (i = 0; i < st->num_channels; i++) {
+        struct diskfs_iq_channel *ch = st->channels[i];
 
         sq_head[i]  = __atomic_load_n(&ch->sq.head, __ATOMIC_RELAXED);
         sq_tail[i]  = __atomic_load_n(&ch->sq.tail, __ATOMIC_ACQUIRE);
         consumed[i] = 0;
     }
 
-    start = il->log_seq % il->num_channels;
+    start = st->retire_tail % st->num_channels;
 
     for (rounds = 0; !stopped && batch_count < DISKFS_IL_MAX_IOV; rounds++) {
         int took = 0;
 
-        for (pass = 0; pass < il->num_channels && batch_count < DISKFS_IL_MAX_IOV; pass++) {
-            uint32_t                  idx = (start + pass) % il->num_channels;
-            struct diskfs_iq_channel *ch  = il->channels[idx];
+        for (pass = 0; pass < st->num_channels && batch_count < DISKFS_IL_MAX_IOV; pass++) {
+            uint32_t                  idx = (start + pass) % st->num_channels;
+            struct diskfs_iq_channel *ch  = st->channels[idx];
             struct diskfs_iq_entry   *slot;
-            uint32_t                  nblocks, next_blocks;
+            uint32_t                  next_blocks, next_full;
+            uint64_t                  next_delta;
             uint32_t                  cq_tail, cq_head;
             uint64_t                  reclen;
 
@@ -985,12 +1378,18 @@ diskfs_iq_process_batch(struct diskfs_intent_log *il)
 
             slot = &ch->sq.entries[(sq_head[idx] + consumed[idx]) &
                                    DISKFS_IQ_RING_MASK];
-            nblocks     = diskfs_il_txn_blocks(slot->txn);
-            next_blocks = batch_blocks + nblocks;
-
-            /* Keep one normal record to one backend write.  Transactions larger
-             * than the iov cap still go alone and use the segmented path. */
-            if (batch_count > 0 && 1 + next_blocks > DISKFS_IL_MAX_IOV) {
+            next_blocks = batch_blocks;
+            next_full   = batch_full;
+            next_delta  = batch_delta;
+            diskfs_il_txn_shape(slot->txn, &next_blocks, &next_full, &next_delta);
+
+            /* Keep one normal record to one backend write (full images are
+             * an iovec each) and its header region modest.  Transactions
+             * larger than the iov cap still go alone and use the segmented
+             * path. */
+            if (batch_count > 0 &&
+                (1 + next_full > DISKFS_IL_MAX_IOV ||
+                 diskfs_il_hdr_len(next_blocks, next_delta) > DISKFS_IL_HDR_MAX)) {
                 stopped = 1;
                 break;
             }
@@ -1002,31 +1401,27 @@ diskfs_iq_process_batch(struct diskfs_intent_log *il)
                 continue;
             }
 
-            reclen = diskfs_il_blocks_reclen(next_blocks);
-            if (!diskfs_il_fits(il, reclen)) {
-                if (batch_count > 0) {
-                    stopped = 1;
-                    break;
-                }
-                if (__atomic_load_n(&il->live_records, __ATOMIC_ACQUIRE) != 0) {
-                    stopped = 1;
-                    break;
-                }
-                __atomic_store_n(&il->log_tail, il->log_head, __ATOMIC_RELEASE);
-                if (!diskfs_il_fits(il, reclen)) {
-                    stopped = 1;
-                    break;
-                }
+            /* Space hint only; diskfs_il_reserve decides under place_lock.
+             * An empty log (no live records) is reset there, so let a lone
+             * first txn through to it. */
+            reclen = diskfs_il_rec_len(next_blocks, next_full, next_delta);
+            if (!diskfs_il_fits(il, reclen) &&
+                (batch_count > 0 ||
+                 __atomic_load_n(&il->live_records, __ATOMIC_ACQUIRE) != 0)) {
+                stopped = 1;
+                break;
             }
 
             entries[batch_count].ch    = ch;
             entries[batch_count].entry = *slot;
             batch_count++;
             batch_blocks = next_blocks;
+            batch_full   = next_full;
+            batch_delta  = next_delta;
             consumed[idx]++;
             took = 1;
 
-            if (1 + batch_blocks > DISKFS_IL_MAX_IOV) {
+            if (1 + batch_full > DISKFS_IL_MAX_IOV) {
                 stopped = 1;
                 break;
             }
@@ -1045,25 +1440,57 @@ diskfs_iq_process_batch(struct diskfs_intent_log *il)
         return 0;
     }
 
+    /* Group commit: with our own redo writes still in flight, hold a short
+     * batch open (nothing is consumed yet) so later arrivals share its write.
+     * The poll loop stays awake while SQs are non-empty and re-checks every
+     * iteration, so the window needs no timer. */
+    if (!stopped && il->group_commit_ns && st->redo_inflight > 0 &&
+        batch_count < il->group_commit_txns) {
+        if (!st->group_holding) {
+            st->group_holding = 1;
+            prometheus_stopwatch_start(&st->group_hold);
+        }
+        if (prometheus_stopwatch_elapsed_ns(&st->group_hold) < il->group_commit_ns) {
+            return 0;
+        }
+    }
+
+    /* Lost the space to another stream since the hint: leave the batch on the
+     * SQs (nothing is consumed until below) and retry once the log trims. */
+    if (!diskfs_il_reserve(il, diskfs_il_rec_len(batch_blocks, batch_full, batch_delta),
+                           &offset, &seq)) {
+        return 0;
+    }
+
     for (i = 0; i < batch_count; i++) {
         entries[i].entry.status = 0;
         prometheus_stopwatch_start(&entries[i].entry.submit_time);
         diskfs_metric_time_sample(
-            il->metrics.txn_latency[DISKFS_METRIC_TXN_QUEUE_TO_SUBMIT],
+            st->metrics.txn_latency[DISKFS_METRIC_TXN_QUEUE_TO_SUBMIT],
             &entries[i].entry.enqueue_time);
     }
 
-    for (i = 0; i < il->num_channels; i++) {
+    for (i = 0; i < st->num_channels; i++) {
         if (consumed[i] == 0) {
             continue;
         }
-        __atomic_store_n(&il->channels[i]->sq.head,
+        __atomic_store_n(&st->channels[i]->sq.head,
                          sq_head[i] + consumed[i],
                          __ATOMIC_RELEASE);
-        il->channels[i]->cq_inflight += consumed[i];
+        st->channels[i]->cq_inflight += consumed[i];
+    }
+
+    diskfs_metric_histogram_sample(st->metrics.group_commit_txns, batch_count);
+    if (st->group_holding) {
+        diskfs_metric_time_sample(st->metrics.group_commit_wait, &st->group_hold);
+        st->group_holding = 0;
     }
 
-    diskfs_il_write_redo(il, entries, batch_count, batch_blocks);
+    chimera_thread_stats_queue(st->stats, -(int64_t) batch_count);
+    chimera_thread_stats_work(batch_count);
+
+    diskfs_il_write_redo(st, entries, batch_count, batch_blocks, batch_full, batch_delta,
+                         offset, seq);
     return 1;
 } /* diskfs_iq_process_batch */
 
@@ -1071,31 +1498,31 @@ diskfs_iq_process_batch(struct diskfs_intent_log *il)
 void
 diskfs_iq_process_channel(struct diskfs_iq_channel *ch)
 {
-    struct diskfs_intent_log *il = &ch->worker->shared->intent_log;
-
-    while (diskfs_iq_process_batch(il)) {
+    while (diskfs_iq_process_batch(ch->stream)) {
     }
 } /* diskfs_iq_process_channel */
 
 static void
-diskfs_intent_log_drain_pending(struct diskfs_intent_log *il)
+diskfs_intent_log_drain_pending(struct diskfs_il_stream *st)
 {
+    struct diskfs_intent_log *il = st->il;
     struct diskfs_iq_channel *head, *ch;
 
-    pthread_mutex_lock(&il->registration_lock);
-    head             = il->pending_head;
-    il->pending_head = NULL;
-    pthread_mutex_unlock(&il->registration_lock);
+    pthread_mutex_lock(&st->registration_lock);
+    head             = st->pending_head;
+    st->pending_head = NULL;
+    pthread_mutex_unlock(&st->registration_lock);
 
     while (head) {
         ch               = head;
         head             = ch->next_pending;
         ch->next_pending = NULL;
 
-        chimera_diskfs_abort_if(il->num_channels >= DISKFS_IL_MAX_CHANNELS,
+        chimera_diskfs_abort_if(st->num_channels >= DISKFS_IL_MAX_CHANNELS,
                                 "intent log: too many channels (%u >= %u)",
-                                il->num_channels, DISKFS_IL_MAX_CHANNELS);
-        il->channels[il->num_channels++] = ch;
+                                st->num_channels, DISKFS_IL_MAX_CHANNELS);
+        st->channels[st->num_channels++] = ch;
+        __atomic_add_fetch(&il->num_channels, 1, __ATOMIC_RELAXED);
 
         __atomic_store_n(&ch->registered, 1, __ATOMIC_RELEASE);
     }
@@ -1107,24 +1534,25 @@ diskfs_intent_log_drain_pending(struct diskfs_intent_log *il)
  * requested unregistration.  Rare (worker-thread lifecycle), so it stays on the
  * wake-doorbell path rather than the per-iteration poll. */
 static void
-diskfs_il_service_registrations(struct diskfs_intent_log *il)
+diskfs_il_service_registrations(struct diskfs_il_stream *st)
 {
-    uint32_t i;
+    struct diskfs_intent_log *il = st->il;
+    uint32_t                  i;
 
     /* Clear the dirty flag before we read pending_head / scan for unregisters,
      * so a (un)registration published after this point re-sets it and is picked
      * up on a later poll rather than being lost. */
-    __atomic_store_n(&il->reg_dirty, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&st->reg_dirty, 0, __ATOMIC_SEQ_CST);
 
-    diskfs_intent_log_drain_pending(il);
+    diskfs_intent_log_drain_pending(st);
 
     /* Unregister pass: compact slots out (swap-with-tail). */
     i = 0;
-    while (i < il->num_channels) {
-        struct diskfs_iq_channel *ch = il->channels[i];
+    while (i < st->num_channels) {
+        struct diskfs_iq_channel *ch = st->channels[i];
 
         if (__atomic_load_n(&ch->unregister_requested, __ATOMIC_ACQUIRE)) {
-            uint32_t last = il->num_channels - 1;
+            uint32_t last = st->num_channels - 1;
 
             /* The worker frees the channel (and soon its thread struct) the
              * moment unregister_done is set, and retired txns dereference
@@ -1141,10 +1569,11 @@ diskfs_il_service_registrations(struct diskfs_intent_log *il)
                 "(cq_inflight=%u)", ch->cq_inflight);
 
             if (i != last) {
-                il->channels[i] = il->channels[last];
+                st->channels[i] = st->channels[last];
             }
-            il->channels[last] = NULL;
-            il->num_channels   = last;
+            st->channels[last] = NULL;
+            st->num_channels   = last;
+            __atomic_sub_fetch(&il->num_channels, 1, __ATOMIC_RELAXED);
             __atomic_store_n(&ch->unregister_done, 1, __ATOMIC_RELEASE);
             diskfs_il_commit_metrics(il);
             continue;     /* re-process index i (now a different channel) */
@@ -1154,27 +1583,38 @@ diskfs_il_service_registrations(struct diskfs_intent_log *il)
 } /* diskfs_il_service_registrations */
 
 
-/* Process registered channel SQs into cross-channel redo batches. */
+/* Retire what the durable frontier has passed, then process registered
+ * channel SQs into cross-channel redo batches. */
 static int
-diskfs_il_process_all(struct diskfs_intent_log *il)
+diskfs_il_process_all(struct diskfs_il_stream *st)
 {
     int worked = 0;
 
-    while (diskfs_iq_process_batch(il)) {
+    if (diskfs_il_stream_retirable(st)) {
+        diskfs_il_stream_retire(st);
+        worked = 1;
+    }
+
+    while (diskfs_iq_process_batch(st)) {
         worked = 1;
     }
     return worked;
 } /* diskfs_il_process_all */
 
 
-/* Seq-cst re-scan for the poll-exit wakeup handshake (diskfs_iq_try_submit). */
+/* Seq-cst re-scan for the poll-exit wakeup handshake (diskfs_iq_try_submit,
+ * and diskfs_il_stream_kick from a stream that moved the frontier). */
 static int
-diskfs_il_has_sq_work(struct diskfs_intent_log *il)
+diskfs_il_has_sq_work(struct diskfs_il_stream *st)
 {
     uint32_t i;
 
-    for (i = 0; i < il->num_channels; i++) {
-        struct diskfs_iq_channel *ch = il->channels[i];
+    if (diskfs_il_stream_retirable(st)) {
+        return 1;
+    }
+
+    for (i = 0; i < st->num_channels; i++) {
+        struct diskfs_iq_channel *ch = st->channels[i];
 
         if (__atomic_load_n(&ch->sq.tail, __ATOMIC_SEQ_CST) !=
             __atomic_load_n(&ch->sq.head, __ATOMIC_SEQ_CST)) {
@@ -1193,14 +1633,14 @@ diskfs_intent_log_wake_cb(
     struct evpl          *evpl,
     struct evpl_doorbell *doorbell)
 {
-    struct diskfs_intent_log *il = container_of(doorbell,
-                                                struct diskfs_intent_log,
-                                                wake_doorbell);
+    struct diskfs_il_stream *st = container_of(doorbell,
+                                               struct diskfs_il_stream,
+                                               wake_doorbell);
 
     (void) evpl;
 
-    diskfs_il_service_registrations(il);
-    diskfs_il_process_all(il);
+    diskfs_il_service_registrations(st);
+    diskfs_il_process_all(st);
 } /* diskfs_intent_log_wake_cb */
 
 
@@ -1212,18 +1652,18 @@ diskfs_il_sq_poll(
     struct evpl *evpl,
     void        *private_data)
 {
-    struct diskfs_intent_log *il = private_data;
+    struct diskfs_il_stream *st = private_data;
 
     /* Pick up channel (un)registrations without waiting for the wake doorbell:
      * while we stay in continuous poll mode under load the doorbell is starved,
      * so a freshly-registered channel would otherwise never enter channels[] and
      * its commits would never be seen.  Gated on a cheap atomic so the common
      * (no-change) case avoids the registration_lock. */
-    if (__atomic_load_n(&il->reg_dirty, __ATOMIC_ACQUIRE)) {
-        diskfs_il_service_registrations(il);
+    if (__atomic_load_n(&st->reg_dirty, __ATOMIC_ACQUIRE)) {
+        diskfs_il_service_registrations(st);
     }
 
-    if (diskfs_il_process_all(il)) {
+    if (diskfs_il_process_all(st)) {
         evpl_activity(evpl);
     }
 } /* diskfs_il_sq_poll */
@@ -1235,10 +1675,10 @@ diskfs_il_poll_enter(
     struct evpl *evpl,
     void        *private_data)
 {
-    struct diskfs_intent_log *il = private_data;
+    struct diskfs_il_stream *st = private_data;
 
     (void) evpl;
-    __atomic_store_n(&il->awake, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&st->awake, 1, __ATOMIC_SEQ_CST);
 } /* diskfs_il_poll_enter */
 
 
@@ -1252,13 +1692,13 @@ diskfs_il_poll_exit(
     struct evpl *evpl,
     void        *private_data)
 {
-    struct diskfs_intent_log *il = private_data;
+    struct diskfs_il_stream *st = private_data;
 
-    __atomic_store_n(&il->awake, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&st->awake, 0, __ATOMIC_SEQ_CST);
 
-    if (diskfs_il_has_sq_work(il)) {
-        __atomic_store_n(&il->awake, 1, __ATOMIC_SEQ_CST);
-        diskfs_il_process_all(il);
+    if (diskfs_il_has_sq_work(st)) {
+        __atomic_store_n(&st->awake, 1, __ATOMIC_SEQ_CST);
+        diskfs_il_process_all(st);
         evpl_activity(evpl);   /* stay awake; the loop will not block this pass */
     }
 } /* diskfs_il_poll_exit */
@@ -1273,8 +1713,8 @@ diskfs_iq_try_submit(
     diskfs_txn_commit_cb_t cb,
     void                  *private_data)
 {
-    struct diskfs_shared     *shared = thread->shared;
-    struct diskfs_iq_channel *ch     = thread->iq_channel;
+    struct diskfs_iq_channel *ch = thread->iq_channel;
+    struct diskfs_il_stream  *st = ch->stream;
     struct diskfs_iq_entry   *slot;
     uint32_t                  tail, head;
 
@@ -1292,6 +1732,8 @@ diskfs_iq_try_submit(
     slot->status       = 0;
     prometheus_stopwatch_start(&slot->enqueue_time);
 
+    chimera_thread_stats_queue(st->stats, 1);
+
     /* Seq-cst so this store is ordered before the awake load below; pairs with
      * the commit thread's diskfs_il_poll_exit handshake. */
     __atomic_store_n(&ch->sq.tail, tail + 1, __ATOMIC_SEQ_CST);
@@ -1299,8 +1741,8 @@ diskfs_iq_try_submit(
     /* The commit thread polls every channel's SQ each loop iteration while it is
      * awake, so the wake doorbell is only needed to rouse it once it has gone to
      * sleep.  Skip the eventfd write in the common (awake) case. */
-    if (!__atomic_load_n(&shared->intent_log.awake, __ATOMIC_SEQ_CST)) {
-        evpl_ring_doorbell(&shared->intent_log.wake_doorbell);
+    if (!__atomic_load_n(&st->awake, __ATOMIC_SEQ_CST)) {
+        evpl_ring_doorbell(&st->wake_doorbell);
     }
     return 1;
 } /* diskfs_iq_try_submit */
@@ -1336,7 +1778,7 @@ int
 diskfs_iq_drain_cq(struct diskfs_iq_channel *ch)
 {
     struct diskfs_thread     *worker  = ch->worker;
-    struct diskfs_intent_log *il      = &worker->shared->intent_log;
+    struct diskfs_il_stream  *st      = ch->stream;
     uint32_t                  head    = __atomic_load_n(&ch->cq.head, __ATOMIC_RELAXED);
     uint32_t                  tail    = __atomic_load_n(&ch->cq.tail, __ATOMIC_ACQUIRE);
     int                       drained = 0;
@@ -1369,8 +1811,8 @@ diskfs_iq_drain_cq(struct diskfs_iq_channel *ch)
         __atomic_store_n(&ch->cq.head, head, __ATOMIC_RELEASE);
         /* Freeing CQ space may let the IL resume a channel it deferred; it sees
          * that on its next poll if awake, so only rouse it if it is asleep. */
-        if (!__atomic_load_n(&il->awake, __ATOMIC_SEQ_CST)) {
-            evpl_ring_doorbell(&il->wake_doorbell);
+        if (!__atomic_load_n(&st->awake, __ATOMIC_SEQ_CST)) {
+            evpl_ring_doorbell(&st->wake_doorbell);
         }
     }
 
@@ -1419,57 +1861,55 @@ diskfs_intent_log_thread_init(
     struct evpl *evpl,
     void        *private_data)
 {
-    struct diskfs_intent_log *il     = private_data;
+    struct diskfs_il_stream  *st     = private_data;
+    struct diskfs_intent_log *il     = st->il;
     struct diskfs_shared     *shared = container_of(il, struct diskfs_shared, intent_log);
-    int                       i;
 
-    il->evpl                        = evpl;
-    il->intent_log_size             = shared->intent_log_size;
-    il->log_head                    = SM_INTENT_LOG_OFFSET;
-    il->log_tail                    = SM_INTENT_LOG_OFFSET;
-    il->live_records                = 0;
-    il->log_seq                     = 0;
-    il->redo_inflight               = 0;
-    il->redo_inflight_high_water    = 0;
-    il->push_outstanding            = 0;
-    il->push_outstanding_high_water = 0;
-    il->log_used_bytes_high_water   = 0;
-    il->sync                        = !shared->unsafe_async;
+    st->evpl          = evpl;
+    st->redo_inflight = 0;
+    st->group_holding = 0;
 
     /* In-order retirement ring + cross-thread hand-off ring to the push thread. */
-    il->retire      = calloc(DISKFS_RETIRE_RING_SIZE, sizeof(*il->retire));
-    il->retire_head = 0;
-    il->retire_tail = 0;
-    il->handoff     = calloc(DISKFS_HANDOFF_RING_SIZE, sizeof(*il->handoff));
-    __atomic_store_n(&il->handoff_head, 0, __ATOMIC_RELAXED);
-    __atomic_store_n(&il->handoff_tail, 0, __ATOMIC_RELAXED);
-
-    diskfs_intent_log_metrics_init(il);
-    diskfs_il_commit_metrics(il);
-
-    /* Redo records are written only to the intent-log device. */
-    il->log_queue = shared->devices[SM_INTENT_LOG_DEVICE].bdev ?
+    st->retire      = calloc(DISKFS_RETIRE_RING_SIZE, sizeof(*st->retire));
+    st->retire_head = 0;
+    st->retire_tail = 0;
+    st->handoff     = calloc(DISKFS_HANDOFF_RING_SIZE, sizeof(*st->handoff));
+    __atomic_store_n(&st->handoff_head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&st->handoff_tail, 0, __ATOMIC_RELAXED);
+
+    /* Redo records are written only to the intent-log device; each stream
+     * submits on its own queue. */
+    st->log_queue = shared->devices[SM_INTENT_LOG_DEVICE].bdev ?
         evpl_block_open_queue(evpl, shared->devices[SM_INTENT_LOG_DEVICE].bdev) : NULL;
 
-    (void) i;
-    evpl_add_doorbell(evpl, &il->wake_doorbell, diskfs_intent_log_wake_cb);
+    diskfs_il_stream_metrics_init(st);
+
+    st->stats = chimera_thread_stats_register("diskfs_log_commit");
+    evpl_set_loop_hooks(evpl, &chimera_thread_stats_loop_hooks);
+
+    evpl_add_doorbell(evpl, &st->wake_doorbell, diskfs_intent_log_wake_cb);
+
+    pthread_mutex_lock(&il->wake_lock);
+    st->alive = 1;
+    pthread_mutex_unlock(&il->wake_lock);
 
     /* Poll all channel SQs every loop iteration (cheap atomic loads) so commit
      * pickup never waits for the wake doorbell; the doorbell only rouses us when
-     * we have actually gone to sleep.  Start "awake" -- we are about to spin. */
-    /* awake must track the loop's poll_mode, which starts at 0 (the thread is
+     * we have actually gone to sleep.
+     *
+     * awake must track the loop's poll_mode, which starts at 0 (the thread is
      * event-driven until activity pulls it into poll mode).  Initialising this
      * to 1 would lie -- a submitter would skip the wake doorbell believing we
      * are polling while we are actually asleep, stranding the commit until some
      * unrelated doorbell happens to wake us.  poll_enter/poll_exit own it from
      * here; it is 0 (asleep) until the first poll_enter. */
-    __atomic_store_n(&il->awake, 0, __ATOMIC_SEQ_CST);
-    __atomic_store_n(&il->reg_dirty, 1, __ATOMIC_SEQ_CST);   /* service any channels registered before we started polling */
-    il->sq_poll = evpl_add_poll(evpl, diskfs_il_poll_enter, diskfs_il_poll_exit,
-                                diskfs_il_sq_poll, il);
+    __atomic_store_n(&st->awake, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&st->reg_dirty, 1, __ATOMIC_SEQ_CST);   /* service any channels registered before we started polling */
+    st->sq_poll = evpl_add_poll(evpl, diskfs_il_poll_enter, diskfs_il_poll_exit,
+                                diskfs_il_sq_poll, st);
 
-    __atomic_store_n(&il->ready, 1, __ATOMIC_RELEASE);
-    return il;
+    __atomic_store_n(&st->ready, 1, __ATOMIC_RELEASE);
+    return st;
 } /* diskfs_intent_log_thread_init */
 
 
@@ -1478,22 +1918,35 @@ diskfs_intent_log_thread_shutdown(
     struct evpl *evpl,
     void        *private_data)
 {
-    struct diskfs_intent_log *il = private_data;
+    struct diskfs_il_stream *st = private_data;
 
     /* Workers are gone, so no new SQ work arrives.  Drain every in-flight redo
      * write and retire (hand off, in order) every record to the push thread --
      * which is still running and will flush them home before it is itself shut
-     * down (the push thread is destroyed after this one). */
-    while (il->redo_inflight || il->retire_head != il->retire_tail) {
+     * down (the push thread is destroyed after every stream).  Our oldest
+     * records may be waiting on another stream's writes to move the frontier;
+     * that stream is still running and kicks us when it does. */
+    for (;;) {
+        diskfs_il_stream_retire(st);
+        if (!st->redo_inflight && st->retire_head == st->retire_tail) {
+            break;
+        }
         evpl_continue(evpl);
     }
 
-    evpl_remove_poll(evpl, il->sq_poll);
-    evpl_remove_doorbell(evpl, &il->wake_doorbell);
-    if (il->log_queue) {
-        evpl_block_close_queue(evpl, il->log_queue);
+    pthread_mutex_lock(&st->il->wake_lock);
+    st->alive = 0;
+    pthread_mutex_unlock(&st->il->wake_lock);
+
+    evpl_remove_poll(evpl, st->sq_poll);
+    evpl_remove_doorbell(evpl, &st->wake_doorbell);
+    if (st->log_queue) {
+        evpl_block_close_queue(evpl, st->log_queue);
     }
-    free(il->retire);
+    free(st->retire);
+
+    evpl_set_loop_hooks(evpl, NULL);
+    chimera_thread_stats_unregister();
 } /* diskfs_intent_log_thread_shutdown */
 
 
@@ -1526,6 +1979,9 @@ diskfs_il_push_thread_init(
             evpl_block_open_queue(evpl, shared->devices[i].bdev) : NULL;
     }
 
+    il->push_stats = chimera_thread_stats_register("diskfs_log_push");
+    evpl_set_loop_hooks(evpl, &chimera_thread_stats_loop_hooks);
+
     evpl_add_doorbell(evpl, &il->push_doorbell, diskfs_il_push_doorbell_cb);
     __atomic_store_n(&il->push_ready, 1, __ATOMIC_RELEASE);
     return il;
@@ -1540,13 +1996,39 @@ diskfs_il_push_thread_shutdown(
     struct diskfs_intent_log *il     = private_data;
     struct diskfs_shared     *shared = container_of(il, struct diskfs_shared, intent_log);
     struct diskfs_pending    *p;
+    struct diskfs_il_record  *rec;
+    uint32_t                  b;
     int                       i;
 
-    /* The commit thread is already gone, so no new hand-offs arrive.  Drain
-     * every handed-off record home and trim the log fully (clean unmount => no
+    if (unlikely(il->crash_test)) {
+        /* Simulated crash: take every hand-off, then drop the records and
+         * the pending map without writing anything home, leaving the whole
+         * session in the log for the next mount's recovery. */
+        while (il->push_seq != il->log_seq) {
+            diskfs_il_push_doorbell_cb(evpl, &il->push_doorbell);
+            evpl_continue(evpl);
+        }
+
+        while ((rec = il->push_head)) {
+            il->push_head = rec->next;
+            diskfs_il_free_record(il, rec);
+        }
+        il->push_tail = NULL;
+
+        for (b = 0; b <= il->phash_mask; b++) {
+            while ((p = il->phash[b])) {
+                il->phash[b] = p->hnext;
+                free(p);
+            }
+        }
+        il->ready_head = NULL;
+        il->ready_tail = NULL;
+    }
+
+    /* Every stream is already gone, so no new hand-offs arrive.  Drain every
+     * handed-off record home and trim the log fully (clean unmount => no
      * replay needed). */
-    while (il->handoff_head != __atomic_load_n(&il->handoff_tail, __ATOMIC_ACQUIRE) ||
-           il->push_head || il->push_outstanding) {
+    while (il->push_seq != il->log_seq || il->push_head || il->push_outstanding) {
         diskfs_il_push_doorbell_cb(evpl, &il->push_doorbell);
         evpl_continue(evpl);
     }
@@ -1565,6 +2047,9 @@ diskfs_il_push_thread_shutdown(
         free(p);
     }
     free(il->phash);
+
+    evpl_set_loop_hooks(evpl, NULL);
+    chimera_thread_stats_unregister();
 } /* diskfs_il_push_thread_shutdown */
 
 
@@ -1601,7 +2086,9 @@ diskfs_txn_commit_finish(
      * bytes. */
     {
         struct diskfs_txn_block *tb;
-        uint64_t                 blocks = 0;
+        struct diskfs_block_buf *base;
+        uint64_t                 base_seq;
+        uint64_t                 blocks = 0, delta_blocks = 0, log_bytes = 0;
 
         for (tb = txn->blocks; tb; tb = tb->next) {
             struct diskfs_block_shard *bshard =
@@ -1609,16 +2096,35 @@ diskfs_txn_commit_finish(
                                    tb->block->device_id,
                                    tb->block->device_offset);
 
-            pthread_mutex_lock(&bshard->lock);
+            chimera_mutex_lock(&bshard->lock, "diskfs_block_shard");
             diskfs_block_buf_ref_locked(tb->block->buf);
-            tb->snap     = tb->block->iov;
-            tb->snap_buf = tb->block->buf;
+            tb->snap          = tb->block->iov;
+            tb->snap_buf      = tb->block->buf;
+            base              = tb->block->base;
+            base_seq          = tb->block->base_seq;
+            tb->block->base   = NULL;
             pthread_mutex_unlock(&bshard->lock);
+
+            /* Every snapshot consumes the block's base: once this record is
+             * written, it is the image the next delta must apply to. */
+            if (base) {
+                diskfs_txn_block_delta(thread, tb, base, base_seq);
+                diskfs_block_buf_release(base);
+            }
+
+            if (tb->delta) {
+                delta_blocks++;
+                log_bytes += sizeof(struct diskfs_redo_block_header) + tb->delta_len;
+            } else {
+                log_bytes += sizeof(struct diskfs_redo_block_header) + DISKFS_BLOCK_SIZE;
+            }
             blocks++;
         }
         diskfs_metric_counter_inc(thread->metrics.txn[0]);
         diskfs_metric_counter_add(thread->metrics.txn[1], blocks);
         diskfs_metric_counter_add(thread->metrics.txn[2], blocks * DISKFS_BLOCK_SIZE);
+        diskfs_metric_counter_add(thread->metrics.txn[3], delta_blocks);
+        diskfs_metric_counter_add(thread->metrics.txn[4], log_bytes);
         diskfs_metric_histogram_sample(thread->metrics.txn_blocks, blocks);
         diskfs_metric_histogram_sample(thread->metrics.txn_bytes,
                                        blocks * DISKFS_BLOCK_SIZE);
@@ -1672,21 +2178,11 @@ diskfs_commit_resume(
 {
     struct diskfs_commit_ctx *c = arg;
 
-    if (diskfs_txn_flush_free_journals(thread, c->txn, c) == SM_AGAIN) {
-        return;     /* re-parked; another log block is loading */
+    if (diskfs_ref_flush(thread, c->txn, c) == SM_AGAIN ||
+        diskfs_txn_flush_free_journals(thread, c->txn, c) == SM_AGAIN ||
+        diskfs_csum_flush(thread, c->txn, c) == SM_AGAIN) {
+        return;     /* re-parked; another log or table block is loading */
     }
     diskfs_txn_commit_finish(c->txn, c->cb, c->private_data);
     free(c);
 } /* diskfs_commit_resume */
-
-
-int
-diskfs_recover_rec_cmp(
-    const void *a,
-    const void *b)
-{
-    uint64_t sa = ((const struct diskfs_recover_rec *) a)->seq;
-    uint64_t sb = ((const struct diskfs_recover_rec *) b)->seq;
-
-    return (sa > sb) - (sa < sb);
-} /* diskfs_recover_rec_cmp */
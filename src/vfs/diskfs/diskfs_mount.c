@@ -19,6 +19,7 @@ static const char *diskfs_metric_inode_cache_op_names[] = {
     "load",
     "insert",
     "wait",
+    "prefetch",
 };
 
 
@@ -29,6 +30,18 @@ static const char *diskfs_metric_block_cache_op_names[] = {
     "wait",
     "cow",
     "recycle",
+    "ghost_hit",
+    "hot_recycle",
+};
+
+
+static const char *diskfs_metric_dcache_op_names[] = {
+    "hit",
+    "miss",
+    "insert",
+    "promote",
+    "evict",
+    "invalidate",
 };
 
 
@@ -58,6 +71,21 @@ static const char *diskfs_metric_io_class_names[] = {
 };
 
 
+static const char *diskfs_metric_recovery_names[] = {
+    "threads",
+    "log_bytes",
+    "records",
+    "blocks",
+    "home_writes",
+    "home_reads",
+    "read_ns",
+    "scan_ns",
+    "build_ns",
+    "replay_ns",
+    "total_ns",
+};
+
+
 static const char *diskfs_metric_txn_phase_names[] = {
     "queue_to_submit",
     "submit_to_durable",
@@ -77,6 +105,11 @@ static void
 diskfs_thread_metrics_init(
     struct diskfs_thread *thread);
 
+static void
+diskfs_intent_log_io_metrics_init(
+    struct diskfs_metrics            *m,
+    struct diskfs_intent_log_metrics *im);
+
 static void
 diskfs_mount_io_complete(
     struct evpl *evpl,
@@ -91,17 +124,6 @@ diskfs_mount_io_write(
     uint64_t    length,
     uint64_t    offset);
 
-static int
-diskfs_mount_io_write_many(
-    void                     *user,
-    const struct sm_io_write *writes,
-    uint32_t                  count);
-
-static int
-diskfs_mount_io_flush(
-    void    *user,
-    uint32_t device_id);
-
 static int
 diskfs_mount_io_discard(
     void    *user,
@@ -113,10 +135,6 @@ static struct sm_io
 diskfs_mount_sm_io(
     struct diskfs_mount_io *io);
 
-static int
-diskfs_recover_log(
-    struct diskfs_shared   *shared,
-    struct diskfs_mount_io *io);
 
 static uint32_t
 diskfs_parse_hex(
@@ -126,8 +144,7 @@ diskfs_parse_hex(
 
 static void
 diskfs_inode_cache_release(
-    struct rb_node *node,
-    void           *private_data);
+    struct diskfs_inode_shard *shard);
 
 
 static void
@@ -142,7 +159,7 @@ diskfs_metrics_init(
     static const char     *io_dev_labels[] = { "direction", "class", "device" };
     static const char     *intent_label[]  = { "name" };
     static const char     *txn_label[]     = { "name" };
-    static const char     *txn_names[]     = { "write", "blocks", "bytes" };
+    static const char     *txn_names[]     = { "write", "blocks", "bytes", "delta_blocks", "log_bytes" };
     static const char     *intent_names[]  = {
         "redo_inflight",
         "iocbs_inflight",
@@ -167,6 +184,9 @@ diskfs_metrics_init(
     m->block_cache = prometheus_metrics_create_counter(
         metrics, "chimera_diskfs_block_cache",
         "Diskfs block cache events");
+    m->dcache = prometheus_metrics_create_counter(
+        metrics, "chimera_diskfs_data_cache",
+        "Diskfs data block cache events (in 4 KiB blocks)");
     m->mtime = prometheus_metrics_create_counter(
         metrics, "chimera_diskfs_mtime",
         "Diskfs deferred-mtime accounting (deferred/flushed/skip reasons)");
@@ -194,12 +214,39 @@ diskfs_metrics_init(
     m->txn_latency = prometheus_metrics_create_histogram_time(
         metrics, "chimera_diskfs_txn_latency_nanoseconds",
         "Diskfs transaction latency in nanoseconds", 34);
+    m->group_commit_txns = prometheus_metrics_create_histogram_exponential(
+        metrics, "chimera_diskfs_group_commit_txns",
+        "Diskfs transactions per intent-log record (group commit batch size)", 8);
+    m->group_commit_wait = prometheus_metrics_create_histogram_time(
+        metrics, "chimera_diskfs_group_commit_wait_nanoseconds",
+        "Diskfs time a short group-commit batch was held open", 34);
     m->pending_io = prometheus_metrics_create_gauge(
         metrics, "chimera_diskfs_pending_io",
         "Diskfs outstanding worker block I/O");
     m->intent_log = prometheus_metrics_create_gauge(
         metrics, "chimera_diskfs_intent_log",
         "Diskfs intent-log pressure gauges");
+    m->recovery = prometheus_metrics_create_gauge(
+        metrics, "chimera_diskfs_recovery",
+        "Diskfs crash recovery counts and phase times of the last mount");
+    m->defrag = prometheus_metrics_create_counter(
+        metrics, "chimera_diskfs_defrag",
+        "Diskfs online defragmentation progress");
+    m->discard = prometheus_metrics_create_counter(
+        metrics, "chimera_diskfs_discard",
+        "Diskfs discard of freed space");
+    m->compress = prometheus_metrics_create_counter(
+        metrics, "chimera_diskfs_compress",
+        "Diskfs transparent data compression");
+    m->csum = prometheus_metrics_create_counter(
+        metrics, "chimera_diskfs_csum",
+        "Diskfs data checksum verification and scrub");
+    m->snap = prometheus_metrics_create_counter(
+        metrics, "chimera_diskfs_snapshot",
+        "Diskfs snapshot creation");
+    m->btree = prometheus_metrics_create_counter(
+        metrics, "chimera_diskfs_btree",
+        "Diskfs b+tree depth, fanout and leaf maintenance");
     for (int i = 0; i < DISKFS_METRIC_INODE_CACHE_NUM; i++) {
         m->inode_cache_series[i] = prometheus_counter_create_series(
             m->inode_cache, op_label, &diskfs_metric_inode_cache_op_names[i], 1);
@@ -208,6 +255,10 @@ diskfs_metrics_init(
         m->block_cache_series[i] = prometheus_counter_create_series(
             m->block_cache, op_label, &diskfs_metric_block_cache_op_names[i], 1);
     }
+    for (int i = 0; i < DISKFS_METRIC_DCACHE_NUM; i++) {
+        m->dcache_series[i] = prometheus_counter_create_series(
+            m->dcache, op_label, &diskfs_metric_dcache_op_names[i], 1);
+    }
     for (int i = 0; i < DISKFS_METRIC_MTIME_NUM; i++) {
         m->mtime_series[i] = prometheus_counter_create_series(
             m->mtime, op_label, &diskfs_metric_mtime_op_names[i], 1);
@@ -249,7 +300,7 @@ diskfs_metrics_init(
             }
         }
     }
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < 5; i++) {
         m->txn_series[i] = prometheus_counter_create_series(
             m->txn, txn_label, &txn_names[i], 1);
     }
@@ -259,11 +310,43 @@ diskfs_metrics_init(
         m->txn_latency_series[i] = prometheus_histogram_create_series(
             m->txn_latency, phase_label, &diskfs_metric_txn_phase_names[i], 1);
     }
+    m->group_commit_txns_series = prometheus_histogram_create_series(
+        m->group_commit_txns, NULL, NULL, 0);
+    m->group_commit_wait_series = prometheus_histogram_create_series(
+        m->group_commit_wait, NULL, NULL, 0);
     m->pending_io_series = prometheus_gauge_create_series(m->pending_io, NULL, NULL, 0);
     for (int i = 0; i < 9; i++) {
         m->intent_log_series[i] = prometheus_gauge_create_series(
             m->intent_log, intent_label, &intent_names[i], 1);
     }
+    for (int i = 0; i < DISKFS_METRIC_RECOVERY_NUM; i++) {
+        m->recovery_series[i] = prometheus_gauge_create_series(
+            m->recovery, intent_label, &diskfs_metric_recovery_names[i], 1);
+    }
+    for (int i = 0; i < DISKFS_METRIC_DEFRAG_NUM; i++) {
+        m->defrag_series[i] = prometheus_counter_create_series(
+            m->defrag, op_label, &diskfs_defrag_counter_names[i], 1);
+    }
+    for (int i = 0; i < DISKFS_METRIC_DISCARD_NUM; i++) {
+        m->discard_series[i] = prometheus_counter_create_series(
+            m->discard, op_label, &diskfs_discard_counter_names[i], 1);
+    }
+    for (int i = 0; i < DISKFS_METRIC_COMPRESS_NUM; i++) {
+        m->compress_series[i] = prometheus_counter_create_series(
+            m->compress, op_label, &diskfs_compress_counter_names[i], 1);
+    }
+    for (int i = 0; i < DISKFS_METRIC_CSUM_NUM; i++) {
+        m->csum_series[i] = prometheus_counter_create_series(
+            m->csum, op_label, &diskfs_csum_counter_names[i], 1);
+    }
+    for (int i = 0; i < DISKFS_METRIC_SNAP_NUM; i++) {
+        m->snap_series[i] = prometheus_counter_create_series(
+            m->snap, op_label, &diskfs_snapshot_counter_names[i], 1);
+    }
+    for (int i = 0; i < DISKFS_METRIC_BTREE_NUM; i++) {
+        m->btree_series[i] = prometheus_counter_create_series(
+            m->btree, op_label, &diskfs_bt_counter_names[i], 1);
+    }
 } /* diskfs_metrics_init */
 
 
@@ -283,9 +366,30 @@ diskfs_thread_metrics_init(struct diskfs_thread *thread)
     for (int i = 0; i < DISKFS_METRIC_BLOCK_CACHE_NUM; i++) {
         tm->block_cache[i] = prometheus_counter_series_create_instance(m->block_cache_series[i]);
     }
+    for (int i = 0; i < DISKFS_METRIC_DCACHE_NUM; i++) {
+        tm->dcache[i] = prometheus_counter_series_create_instance(m->dcache_series[i]);
+    }
     for (int i = 0; i < DISKFS_METRIC_MTIME_NUM; i++) {
         tm->mtime[i] = prometheus_counter_series_create_instance(m->mtime_series[i]);
     }
+    for (int i = 0; i < DISKFS_METRIC_DEFRAG_NUM; i++) {
+        tm->defrag[i] = prometheus_counter_series_create_instance(m->defrag_series[i]);
+    }
+    for (int i = 0; i < DISKFS_METRIC_DISCARD_NUM; i++) {
+        tm->discard[i] = prometheus_counter_series_create_instance(m->discard_series[i]);
+    }
+    for (int i = 0; i < DISKFS_METRIC_COMPRESS_NUM; i++) {
+        tm->compress[i] = prometheus_counter_series_create_instance(m->compress_series[i]);
+    }
+    for (int i = 0; i < DISKFS_METRIC_CSUM_NUM; i++) {
+        tm->csum[i] = prometheus_counter_series_create_instance(m->csum_series[i]);
+    }
+    for (int i = 0; i < DISKFS_METRIC_SNAP_NUM; i++) {
+        tm->snap[i] = prometheus_counter_series_create_instance(m->snap_series[i]);
+    }
+    for (int i = 0; i < DISKFS_METRIC_BTREE_NUM; i++) {
+        tm->btree[i] = prometheus_counter_series_create_instance(m->btree_series[i]);
+    }
     for (int d = 0; d < DISKFS_METRIC_IO_NUM_DIRS; d++) {
         for (int c = 0; c < DISKFS_METRIC_IO_NUM_CLASSES; c++) {
             tm->block_io_ops[d][c] =
@@ -315,7 +419,7 @@ diskfs_thread_metrics_init(struct diskfs_thread *thread)
             }
         }
     }
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < 5; i++) {
         tm->txn[i] = prometheus_counter_series_create_instance(m->txn_series[i]);
     }
     tm->txn_blocks = prometheus_histogram_series_create_instance(m->txn_blocks_series);
@@ -327,49 +431,66 @@ diskfs_thread_metrics_init(struct diskfs_thread *thread)
 } /* diskfs_thread_metrics_init */
 
 
-void
-diskfs_intent_log_metrics_init(struct diskfs_intent_log *il)
+/* I/O counters and txn latency histograms for one intent-log thread. */
+static void
+diskfs_intent_log_io_metrics_init(
+    struct diskfs_metrics            *m,
+    struct diskfs_intent_log_metrics *im)
 {
-    struct diskfs_shared  *shared = container_of(il, struct diskfs_shared, intent_log);
-    struct diskfs_metrics *m      = &shared->metrics;
-
-    if (!m->metrics) {
-        return;
-    }
-
     for (int d = 0; d < DISKFS_METRIC_IO_NUM_DIRS; d++) {
         for (int c = 0; c < DISKFS_METRIC_IO_NUM_CLASSES; c++) {
-            il->metrics.block_io_ops[d][c] =
+            im->block_io_ops[d][c] =
                 prometheus_counter_series_create_instance(m->block_io_ops_series[d][c]);
-            il->metrics.block_io_bytes[d][c] =
+            im->block_io_bytes[d][c] =
                 prometheus_counter_series_create_instance(m->block_io_bytes_series[d][c]);
         }
     }
-    il->metrics.block_io_device_ops = calloc(
+    im->block_io_device_ops = calloc(
         (size_t) m->num_devices * DISKFS_METRIC_IO_NUM_DIRS *
-        DISKFS_METRIC_IO_NUM_CLASSES, sizeof(*il->metrics.block_io_device_ops));
-    il->metrics.block_io_device_bytes = calloc(
+        DISKFS_METRIC_IO_NUM_CLASSES, sizeof(*im->block_io_device_ops));
+    im->block_io_device_bytes = calloc(
         (size_t) m->num_devices * DISKFS_METRIC_IO_NUM_DIRS *
-        DISKFS_METRIC_IO_NUM_CLASSES, sizeof(*il->metrics.block_io_device_bytes));
+        DISKFS_METRIC_IO_NUM_CLASSES, sizeof(*im->block_io_device_bytes));
     for (int dev = 0; dev < m->num_devices; dev++) {
         for (int d = 0; d < DISKFS_METRIC_IO_NUM_DIRS; d++) {
             for (int c = 0; c < DISKFS_METRIC_IO_NUM_CLASSES; c++) {
                 size_t idx = ((size_t) dev * DISKFS_METRIC_IO_NUM_DIRS + d) *
                     DISKFS_METRIC_IO_NUM_CLASSES + c;
 
-                il->metrics.block_io_device_ops[idx] =
+                im->block_io_device_ops[idx] =
                     prometheus_counter_series_create_instance(
                         m->block_io_device_ops_series[idx]);
-                il->metrics.block_io_device_bytes[idx] =
+                im->block_io_device_bytes[idx] =
                     prometheus_counter_series_create_instance(
                         m->block_io_device_bytes_series[idx]);
             }
         }
     }
     for (int i = 0; i < DISKFS_METRIC_TXN_NUM_PHASES; i++) {
-        il->metrics.txn_latency[i] =
+        im->txn_latency[i] =
             prometheus_histogram_series_create_instance(m->txn_latency_series[i]);
     }
+    im->group_commit_txns =
+        prometheus_histogram_series_create_instance(m->group_commit_txns_series);
+    im->group_commit_wait =
+        prometheus_histogram_series_create_instance(m->group_commit_wait_series);
+} /* diskfs_intent_log_io_metrics_init */
+
+
+/* Push-thread I/O instances plus the intent log's gauges (one set, shared by
+ * every stream). */
+void
+diskfs_intent_log_metrics_init(struct diskfs_intent_log *il)
+{
+    struct diskfs_shared  *shared = container_of(il, struct diskfs_shared, intent_log);
+    struct diskfs_metrics *m      = &shared->metrics;
+
+    if (!m->metrics) {
+        return;
+    }
+
+    diskfs_intent_log_io_metrics_init(m, &il->metrics);
+
     il->metrics.redo_inflight =
         prometheus_gauge_series_create_instance(m->intent_log_series[0]);
     il->metrics.iocbs_inflight =
@@ -391,6 +512,21 @@ diskfs_intent_log_metrics_init(struct diskfs_intent_log *il)
 } /* diskfs_intent_log_metrics_init */
 
 
+/* Per-stream I/O instances, created on the stream's own commit thread. */
+void
+diskfs_il_stream_metrics_init(struct diskfs_il_stream *st)
+{
+    struct diskfs_shared  *shared = container_of(st->il, struct diskfs_shared, intent_log);
+    struct diskfs_metrics *m      = &shared->metrics;
+
+    if (!m->metrics) {
+        return;
+    }
+
+    diskfs_intent_log_io_metrics_init(m, &st->metrics);
+} /* diskfs_il_stream_metrics_init */
+
+
 static void
 diskfs_mount_io_complete(
     struct evpl *evpl,
@@ -494,6 +630,83 @@ diskfs_mount_io_read(
 } /* diskfs_mount_io_read */
 
 
+/*
+ * Issue a batch of block-aligned reads at once and pump until all complete --
+ * the read-side twin of diskfs_mount_io_write_many, used by crash recovery to
+ * keep the log and home devices busy.  Each read must fit one device request.
+ */
+int
+diskfs_mount_io_read_many(
+    struct diskfs_mount_io      *io,
+    struct diskfs_mount_io_read *reads,
+    uint32_t                     count)
+{
+    struct diskfs_mount_io_wait *waits;
+    struct evpl_iovec           *iovs;
+    uint32_t                     i, done = 0;
+    int                          rc = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    waits = calloc(count, sizeof(*waits));
+    iovs  = calloc(count, sizeof(*iovs));
+    if (!waits || !iovs) {
+        free(waits);
+        free(iovs);
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        struct diskfs_device *dev;
+
+        if (reads[i].device_id >= (uint32_t) io->shared->num_devices ||
+            !io->queue[reads[i].device_id]) {
+            rc    = -1;
+            count = i;
+            goto out;
+        }
+        dev = &io->shared->devices[reads[i].device_id];
+
+        if (dev->max_request_size == 0 || reads[i].length > dev->max_request_size ||
+            (reads[i].length & (DISKFS_BLOCK_SIZE - 1))) {
+            rc    = -1;
+            count = i;
+            goto out;
+        }
+
+        evpl_iovec_alloc(io->evpl, reads[i].length, DISKFS_BLOCK_SIZE, 1, 0,
+                         &iovs[i]);
+        evpl_block_read(io->evpl, io->queue[reads[i].device_id], &iovs[i], 1,
+                        reads[i].offset, diskfs_mount_io_complete, &waits[i]);
+    }
+
+ out:
+    while (done < count) {
+        evpl_continue(io->evpl);
+        done = 0;
+        for (i = 0; i < count; i++) {
+            if (waits[i].done) {
+                done++;
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (waits[i].status) {
+            rc = -1;
+        } else if (rc == 0) {
+            memcpy(reads[i].buf, iovs[i].data, reads[i].length);
+        }
+        evpl_iovec_release(io->evpl, &iovs[i]);
+    }
+    free(iovs);
+    free(waits);
+    return rc;
+} /* diskfs_mount_io_read_many */
+
+
 /* sm_io write bridge.  offset and length must be block-aligned (callers write
  * whole blocks / the block-padded superblock + condensed log slots). */
 static int
@@ -542,7 +755,7 @@ diskfs_mount_io_write(
 } /* diskfs_mount_io_write */
 
 
-static int
+int
 diskfs_mount_io_write_many(
     void                     *user,
     const struct sm_io_write *writes,
@@ -618,7 +831,7 @@ diskfs_mount_io_write_many(
 } /* diskfs_mount_io_write_many */
 
 
-static int
+int
 diskfs_mount_io_flush(
     void    *user,
     uint32_t device_id)
@@ -681,138 +894,6 @@ diskfs_mount_sm_io(struct diskfs_mount_io *io)
 } /* diskfs_mount_sm_io */
 
 
-/*
- * Crash recovery (synchronous replay): the previous instance did not unmount
- * cleanly, so logged-but-not-yet-pushed redo records may still sit in the
- * intent log while their home locations hold stale data.  Sweep the log for
- * intact records -- a 4 KiB-aligned magic whose XXH3-128 over reclen bytes
- * verifies (rejecting torn/partially-overwritten records) -- and write each
- * block image to its home location in seq order (latest image of a block
- * wins), then flush.  After this the on-disk b+tree / inodes / data are
- * consistent with the last acknowledged write, exactly as the tail-pusher
- * would have left them.
- *
- * Replaying every intact record (rather than just [tail, head]) is safe: in a
- * FIFO circular log a superseding record outlives every record it supersedes,
- * so seq-ordered replay always lands the latest image, and re-writing an
- * already-current block is idempotent.  Runs at mount before worker threads
- * exist, so it drives the device through the mount-time evpl pump.
- */
-static int
-diskfs_recover_log(
-    struct diskfs_shared   *shared,
-    struct diskfs_mount_io *io)
-{
-    char                      *log;
-    uint64_t                   o;
-    struct diskfs_recover_rec *recs;
-    uint32_t                   nrec = 0, cap = 4096, i;
-
-    uint64_t                   intent_log_size = shared->intent_log_size;
-
-    log = malloc(intent_log_size);
-    if (diskfs_mount_io_read(io, SM_INTENT_LOG_DEVICE, log, intent_log_size,
-                             SM_INTENT_LOG_OFFSET) != 0) {
-        free(log);
-        return -1;
-    }
-
-    recs = malloc(cap * sizeof(*recs));
-
-    for (o = 0; o + sizeof(struct diskfs_redo_header) <= intent_log_size;
-         o += DISKFS_BLOCK_SIZE) {
-        struct diskfs_redo_header *hdr = (struct diskfs_redo_header *) (log + o);
-        uint64_t                   lo, hi;
-        XXH128_hash_t              h;
-
-        if (hdr->magic != DISKFS_REDO_MAGIC) {
-            continue;
-        }
-        if (hdr->reclen < sizeof(*hdr) ||
-            (hdr->reclen & (DISKFS_BLOCK_SIZE - 1)) ||
-            hdr->reclen != diskfs_il_hdr_len(hdr->num_blocks) + (uint64_t) hdr->num_blocks * DISKFS_BLOCK_SIZE ||
-            o + hdr->reclen > intent_log_size) {
-            continue;
-        }
-        lo           = hdr->csum_lo;
-        hi           = hdr->csum_hi;
-        hdr->csum_lo = 0;
-        hdr->csum_hi = 0;
-        h            = XXH3_128bits(log + o, diskfs_il_hdr_len(hdr->num_blocks));
-        hdr->csum_lo = lo;
-        hdr->csum_hi = hi;
-        if (h.low64 != lo || h.high64 != hi) {
-            continue;
-        }
-        {
-            char    *bhp  = log + o + sizeof(*hdr);
-            char    *data = log + o + diskfs_il_hdr_len(hdr->num_blocks);
-            uint32_t b;
-            int      ok = 1;
-
-            for (b = 0; b < hdr->num_blocks; b++) {
-                struct diskfs_redo_block_header *bh =
-                    (struct diskfs_redo_block_header *) (bhp + (size_t) b * sizeof(*bh));
-                char                            *img   = data + (size_t) b * DISKFS_BLOCK_SIZE;
-                XXH128_hash_t                    bhash = XXH3_128bits(img, DISKFS_BLOCK_SIZE);
-
-                if (bhash.low64 != bh->block_csum_lo ||
-                    bhash.high64 != bh->block_csum_hi) {
-                    ok = 0;
-                    break;
-                }
-            }
-            if (!ok) {
-                continue;
-            }
-        }
-
-        if (nrec == cap) {
-            cap *= 2;
-            recs = realloc(recs, cap * sizeof(*recs));
-        }
-        recs[nrec].seq    = hdr->seq;
-        recs[nrec].offset = o;
-        nrec++;
-    }
-
-    qsort(recs, nrec, sizeof(*recs), diskfs_recover_rec_cmp);
-
-    for (i = 0; i < nrec; i++) {
-        struct diskfs_redo_header *hdr  = (struct diskfs_redo_header *) (log + recs[i].offset);
-        char                      *bhp  = log + recs[i].offset + sizeof(*hdr);
-        char                      *data = log + recs[i].offset + diskfs_il_hdr_len(hdr->num_blocks);
-        uint32_t                   b;
-
-        /* New layout: all per-block headers are grouped after the redo header,
-         * and the block images follow the 4 KiB-aligned header region. */
-        for (b = 0; b < hdr->num_blocks; b++) {
-            struct diskfs_redo_block_header *bh =
-                (struct diskfs_redo_block_header *) (bhp + (size_t) b * sizeof(*bh));
-            char                            *img = data + (size_t) b * DISKFS_BLOCK_SIZE;
-
-            if (bh->device_id < (uint32_t) shared->num_devices) {
-                int wr = diskfs_mount_io_write(io, bh->device_id, img,
-                                               DISKFS_BLOCK_SIZE,
-                                               bh->device_offset);
-
-                chimera_diskfs_abort_if(wr != 0,
-                                        "recovery replay write failed");
-            }
-        }
-    }
-
-    for (i = 0; i < (uint32_t) shared->num_devices; i++) {
-        diskfs_mount_io_flush(io, i);
-    }
-
-    free(recs);
-    free(log);
-    chimera_diskfs_info("crash recovery: replayed %u intact intent-log records", nrec);
-    return 0;
-} /* diskfs_recover_log */
-
-
 /*
  * Decode a hex string (e.g. "deadbeef" or "de:ad:be:ef") into up to `max`
  * bytes; returns the number of bytes decoded.  Used for the block-mode device
@@ -870,6 +951,7 @@ diskfs_init(
     json_t                     *cfg, *devices_cfg, *device_cfg;
     json_error_t                json_error;
     int                         initialize;
+    uint32_t                    nbuckets;
 
 
     cfg = json_loads(cfgdata, 0, &json_error);
@@ -886,8 +968,9 @@ diskfs_init(
     {
         const char *role_name;
 
-        device     = &shared->devices[i];
-        device->id = i;
+        device         = &shared->devices[i];
+        device->id     = i;
+        device->weight = json_integer_value(json_object_get(device_cfg, "weight"));
 
         protocol_name = json_string_value(json_object_get(device_cfg, "type"));
         device_path   = json_string_value(json_object_get(device_cfg, "path"));
@@ -1021,6 +1104,81 @@ diskfs_init(
     shared->block_cache_blocks = (uint32_t) json_integer_value(
         json_object_get(cfg, "block_cache_blocks"));
 
+    /* Data read cache budget in 4 KiB blocks; 0 turns the cache off.  Block/
+     * SCSI-layout shares never read file data on the server. */
+    {
+        json_t *dcb = json_object_get(cfg, "data_cache_blocks");
+
+        shared->data_cache_blocks = dcb ? (uint32_t) json_integer_value(dcb) :
+            DISKFS_DCACHE_DEFAULT_BLOCKS;
+        if (shared->block_layout || shared->scsi_layout) {
+            shared->data_cache_blocks = 0;
+        }
+    }
+
+    /* Delta redo: a metadata block whose change is at most this many bytes is
+     * logged as byte ranges rather than a full 4 KiB image.  Past half a block
+     * a delta saves too little to be worth the extent overhead. */
+    {
+        json_t *rdm = json_object_get(cfg, "redo_delta_max");
+
+        shared->redo_delta_max = rdm ? (uint32_t) json_integer_value(rdm) :
+            DISKFS_REDO_DELTA_MAX_DEFAULT;
+        if (shared->redo_delta_max > DISKFS_BLOCK_SIZE / 2) {
+            shared->redo_delta_max = DISKFS_BLOCK_SIZE / 2;
+        }
+    }
+
+    /* Inline data: files up to this size keep their bytes in the inode block.
+     * Block/SCSI-layout shares hand every byte to the client through extents,
+     * so they never store a file inline. */
+    {
+        json_t *idm = json_object_get(cfg, "inline_data_max");
+
+        shared->inline_data_max = idm ? (uint32_t) json_integer_value(idm) :
+            DISKFS_INLINE_DATA_MAX;
+        if (shared->inline_data_max > DISKFS_INLINE_DATA_MAX) {
+            shared->inline_data_max = DISKFS_INLINE_DATA_MAX;
+        }
+        if (shared->block_layout || shared->scsi_layout) {
+            shared->inline_data_max = 0;
+        }
+    }
+
+    /* Largest size-scaled data reservation a streaming writer grows to; never
+     * below the fixed 1 MiB reservation nor past the extent-size hint cap. */
+    {
+        json_t *pam = json_object_get(cfg, "prealloc_max");
+
+        shared->prealloc_max = pam ? (uint64_t) json_integer_value(pam) :
+            DISKFS_PREALLOC_MAX_DEFAULT;
+        if (shared->prealloc_max < SM_RESERVATION_MIN) {
+            shared->prealloc_max = SM_RESERVATION_MIN;
+        }
+        if (shared->prealloc_max > DISKFS_EXTSIZE_MAX) {
+            shared->prealloc_max = DISKFS_EXTSIZE_MAX;
+        }
+    }
+
+    /* Stripe unit for large files over several data devices (0 = no
+     * striping).  Kept at least a reservation and block aligned, so each unit
+     * stays one extent that defrag leaves alone. */
+    {
+        json_t *sc = json_object_get(cfg, "stripe_chunk");
+
+        shared->stripe_chunk = sc ? (uint64_t) json_integer_value(sc) :
+            DISKFS_STRIPE_CHUNK_DEFAULT;
+        if (shared->stripe_chunk) {
+            if (shared->stripe_chunk < SM_RESERVATION_MIN) {
+                shared->stripe_chunk = SM_RESERVATION_MIN;
+            }
+            if (shared->stripe_chunk > DISKFS_EXTSIZE_MAX) {
+                shared->stripe_chunk = DISKFS_EXTSIZE_MAX;
+            }
+            shared->stripe_chunk = SM_ALIGN_UP(shared->stripe_chunk);
+        }
+    }
+
     /* Intent-log size (bytes).  Larger pipelines more redo records before the
      * ring laps (throughput on big devices); small test devices need a small
      * log so the AG 0 metadata reservation fits.  A remount overrides this with
@@ -1053,14 +1211,204 @@ diskfs_init(
     }
     shared->inode_cache_inodes = (uint32_t) json_integer_value(
         json_object_get(cfg, "inode_cache_inodes"));
+    {
+        json_t *rp = json_object_get(cfg, "readdir_prefetch");
+
+        shared->readdir_prefetch = rp ? (uint32_t) json_integer_value(rp) :
+            DISKFS_READDIR_PREFETCH_DEFAULT;
+        if (shared->readdir_prefetch > DISKFS_INODE_PREFETCH_MAX) {
+            shared->readdir_prefetch = DISKFS_INODE_PREFETCH_MAX;
+        }
+    }
     shared->reclaim_threads = (uint32_t) json_integer_value(
         json_object_get(cfg, "reclaim_threads"));
+    shared->recovery_threads = (uint32_t) json_integer_value(
+        json_object_get(cfg, "recovery_threads"));
+    {
+        json_t *rw = json_object_get(cfg, "recovery_window");
+
+        shared->recovery_window = rw ? (uint64_t) json_integer_value(rw) & ~SM_BLOCK_MASK : 0;
+        if (shared->recovery_window == 0) {
+            shared->recovery_window = DISKFS_RECOVER_WINDOW;
+        }
+    }
+
+    /* Online defragmentation: off unless asked for (REST can switch it on
+     * later); copy budget in bytes/s (0 = unlimited) and the foreground
+     * busy share above which it pauses (100 = never). */
+    shared->defrag_enabled = json_is_true(json_object_get(cfg, "defrag"));
+    {
+        json_t *dr = json_object_get(cfg, "defrag_rate");
+        json_t *db = json_object_get(cfg, "defrag_busy_pct");
+
+        shared->defrag_rate = dr ? (uint64_t) json_integer_value(dr) :
+            DISKFS_DEFRAG_RATE_DEFAULT;
+        shared->defrag_busy_pct = db ? (uint32_t) json_integer_value(db) :
+            DISKFS_DEFRAG_BUSY_PCT_DEFAULT;
+        if (shared->defrag_busy_pct < 1) {
+            shared->defrag_busy_pct = 1;
+        }
+        if (shared->defrag_busy_pct > 100) {
+            shared->defrag_busy_pct = 100;
+        }
+    }
+
+    /* Discard (TRIM/UNMAP) of freed space: off unless asked for, since not
+     * every device benefits; budget in bytes/s (0 = unlimited). */
+    shared->discard_enabled = json_is_true(json_object_get(cfg, "discard"));
+    {
+        json_t *dr = json_object_get(cfg, "discard_rate");
+
+        shared->discard_rate = dr ? (uint64_t) json_integer_value(dr) :
+            DISKFS_DISCARD_RATE_DEFAULT;
+    }
+
+    /* Transparent compression of file data: off, or LZ4 ("lz4" or true) or
+     * zstd at compression_level; compression_unit is the logical size each
+     * compressed extent covers.  A blob is read in one device request, so the
+     * unit is capped by the smallest device limit.  pNFS block/SCSI clients
+     * address the extents directly, so those modes store data raw. */
+    {
+        json_t *ca = json_object_get(cfg, "compression");
+        json_t *cl = json_object_get(cfg, "compression_level");
+        json_t *cu = json_object_get(cfg, "compression_unit");
+
+        shared->compress_algo = DISKFS_COMPRESS_NONE;
+        if (json_is_true(ca) ||
+            (json_is_string(ca) && strcmp(json_string_value(ca), "lz4") == 0)) {
+            shared->compress_algo = DISKFS_COMPRESS_LZ4;
+        } else if (json_is_string(ca) && strcmp(json_string_value(ca), "zstd") == 0) {
+            shared->compress_algo = DISKFS_COMPRESS_ZSTD;
+        } else {
+            chimera_diskfs_abort_if(json_is_string(ca) &&
+                                    strcmp(json_string_value(ca), "none") != 0,
+                                    "unknown compression '%s' (none, lz4 or zstd)",
+                                    json_string_value(ca));
+        }
+
+        shared->compress_level = cl ? (int) json_integer_value(cl) :
+            DISKFS_COMPRESS_ZSTD_LEVEL_DEFAULT;
+        if (shared->compress_level < 1) {
+            shared->compress_level = 1;
+        }
+        if (shared->compress_level > DISKFS_COMPRESS_ZSTD_LEVEL_MAX) {
+            shared->compress_level = DISKFS_COMPRESS_ZSTD_LEVEL_MAX;
+        }
+
+        shared->compress_unit = cu ? (uint32_t) json_integer_value(cu) :
+            DISKFS_COMPRESS_UNIT_DEFAULT;
+        if (shared->compress_unit < DISKFS_COMPRESS_UNIT_MIN) {
+            shared->compress_unit = DISKFS_COMPRESS_UNIT_MIN;
+        }
+        if (shared->compress_unit > DISKFS_COMPRESS_UNIT_MAX) {
+            shared->compress_unit = DISKFS_COMPRESS_UNIT_MAX;
+        }
+        for (i = 0; i < shared->num_devices; i++) {
+            if (shared->devices[i].bdev &&
+                shared->devices[i].max_request_size < shared->compress_unit) {
+                shared->compress_unit = (uint32_t) shared->devices[i].max_request_size;
+            }
+        }
+        shared->compress_unit &= ~(uint32_t) (DISKFS_BLOCK_SIZE - 1);
+
+        if (shared->compress_algo != DISKFS_COMPRESS_NONE &&
+            (shared->block_layout || shared->scsi_layout)) {
+            chimera_diskfs_info("Compression disabled: pNFS block layouts in use");
+            shared->compress_algo = DISKFS_COMPRESS_NONE;
+        }
+        if (shared->compress_algo != DISKFS_COMPRESS_NONE &&
+            shared->compress_unit < DISKFS_COMPRESS_UNIT_MIN) {
+            chimera_diskfs_info("Compression disabled: device request size below %u bytes",
+                                DISKFS_COMPRESS_UNIT_MIN);
+            shared->compress_algo = DISKFS_COMPRESS_NONE;
+        }
+    }
+
+    /* Data checksums are a format-time choice (recorded in the superblock;
+     * an existing filesystem keeps what it was formatted with).  pNFS
+     * block/SCSI clients write the extents directly, bypassing them.  The
+     * scrub reads every checksummed block back at scrub_rate bytes/s. */
+    shared->data_csum_cfg = json_is_true(json_object_get(cfg, "data_checksums"));
+    if (shared->data_csum_cfg && (shared->block_layout || shared->scsi_layout)) {
+        chimera_diskfs_info("Data checksums disabled: pNFS block layouts in use");
+        shared->data_csum_cfg = 0;
+    }
+    shared->scrub_enabled = json_is_true(json_object_get(cfg, "scrub"));
+
+    /* Snapshots need the extent reference tables, another format-time
+     * choice.  pNFS clients would overwrite shared extents in place. */
+    shared->snapshots_cfg = json_is_true(json_object_get(cfg, "snapshots"));
+    if (shared->snapshots_cfg && (shared->block_layout || shared->scsi_layout)) {
+        chimera_diskfs_info("Snapshots disabled: pNFS block layouts in use");
+        shared->snapshots_cfg = 0;
+    }
+
+    /* Compact b+tree leaves are also chosen at format time: a filesystem
+     * formatted without them stays readable by older builds. */
+    {
+        json_t *bc = json_object_get(cfg, "btree_compact_leaves");
+
+        shared->bt_compact_cfg = bc ? json_is_true(bc) : 1;
+    }
+    {
+        json_t *sr = json_object_get(cfg, "scrub_rate");
+
+        shared->scrub_rate = sr ? (uint64_t) json_integer_value(sr) :
+            DISKFS_SCRUB_RATE_DEFAULT;
+    }
+
+    /* Intent-log commit streams (threads assembling and submitting redo
+     * records in parallel); workers are spread over them. */
+    shared->intent_log.num_streams = (int) json_integer_value(
+        json_object_get(cfg, "intent_log_streams"));
+    if (shared->intent_log.num_streams < 1) {
+        shared->intent_log.num_streams = 1;
+    }
+    if (shared->intent_log.num_streams > DISKFS_IL_MAX_STREAMS) {
+        shared->intent_log.num_streams = DISKFS_IL_MAX_STREAMS;
+    }
+    {
+        /* Group-commit window (us in config; 0 disables) and the batch size
+         * that is worth issuing without waiting. */
+        json_t  *gcu = json_object_get(cfg, "group_commit_us");
+        json_t  *gct = json_object_get(cfg, "group_commit_txns");
+        uint64_t us;
+        int64_t  txns;
+
+        chimera_diskfs_abort_if(gcu && (!json_is_integer(gcu) || json_integer_value(gcu) < 0),
+                                "group_commit_us must be a non-negative integer (microseconds)");
+        chimera_diskfs_abort_if(gct && !json_is_integer(gct),
+                                "group_commit_txns must be an integer");
+
+        us = gcu ? (uint64_t) json_integer_value(gcu) :
+            DISKFS_GROUP_COMMIT_US_DEFAULT;
+        txns = gct ? json_integer_value(gct) :
+            DISKFS_GROUP_COMMIT_TXNS_DEFAULT;
+
+        if (us > DISKFS_GROUP_COMMIT_US_MAX) {
+            us = DISKFS_GROUP_COMMIT_US_MAX;
+        }
+        if (txns < 1) {
+            txns = 1;
+        }
+        if (txns > DISKFS_IL_MAX_IOV) {
+            txns = DISKFS_IL_MAX_IOV;
+        }
+        shared->intent_log.group_commit_ns   = us * 1000;
+        shared->intent_log.group_commit_txns = (uint32_t) txns;
+    }
 
     json_decref(cfg);
 
 
     pthread_mutex_init(&shared->lock, NULL);
     pthread_mutex_init(&shared->gen_lock, NULL);
+    for (i = 0; i < DISKFS_CSUM_LOCKS; i++) {
+        pthread_mutex_init(&shared->csum_lock[i], NULL);
+    }
+    for (i = 0; i < DISKFS_REF_LOCKS; i++) {
+        pthread_mutex_init(&shared->ref_lock[i], NULL);
+    }
     diskfs_metrics_init(shared, metrics);
 
     /* Decide mkfs vs clean-mount vs crash-recovery from the superblock, just as
@@ -1108,12 +1456,45 @@ diskfs_init(
             shared->intent_log_size = sb.intent_log_size;
         }
 
+        /* Likewise data checksums: the tables are part of the AG layout. */
+        if (mode == 0) {
+            shared->data_csum = shared->data_csum_cfg;
+        } else {
+            shared->data_csum = sb.version >= SM_FORMAT_VERSION_CSUM && sb.data_csum;
+            if (shared->data_csum != shared->data_csum_cfg) {
+                chimera_diskfs_info("data_checksums=%s ignored: filesystem was formatted %s them",
+                                    shared->data_csum_cfg ? "true" : "false",
+                                    shared->data_csum ? "with" : "without");
+            }
+        }
+
+        /* And compact b+tree leaves, which older readers cannot parse. */
+        if (mode == 0) {
+            shared->bt_compact = shared->bt_compact_cfg;
+        } else {
+            shared->bt_compact = sb.version >= SM_FORMAT_VERSION_BTC && sb.bt_compact;
+        }
+
+        /* And the extent reference tables snapshots rely on. */
+        if (mode == 0) {
+            shared->snapshots = shared->snapshots_cfg;
+        } else {
+            shared->snapshots = sb.version >= SM_FORMAT_VERSION_FEAT &&
+                (sb.incompat & SM_INCOMPAT_SNAPSHOT);
+            if (shared->snapshots != shared->snapshots_cfg) {
+                chimera_diskfs_info("snapshots=%s ignored: filesystem was formatted %s them",
+                                    shared->snapshots_cfg ? "true" : "false",
+                                    shared->snapshots ? "with" : "without");
+            }
+        }
+
         dev_cfg = calloc(shared->num_devices, sizeof(*dev_cfg));
         for (i = 0; i < shared->num_devices; i++) {
             struct diskfs_device *dv = &shared->devices[i];
 
-            dev_cfg[i].size = dv->size;
-            dev_cfg[i].role = dv->role;
+            dev_cfg[i].size   = dv->size;
+            dev_cfg[i].role   = dv->role;
+            dev_cfg[i].weight = dv->weight;
             if (dv->role == SM_DEV_REMOTE) {
                 memcpy(dev_cfg[i].deviceid, dv->deviceid, SM_DEVICEID_SIZE);
                 dev_cfg[i].sig_offset = dv->sig_offset;
@@ -1122,7 +1503,10 @@ diskfs_init(
             }
         }
         shared->space_map = space_map_create(dev_cfg, shared->num_devices,
-                                             shared->intent_log_size);
+                                             shared->intent_log_size,
+                                             shared->data_csum,
+                                             shared->bt_compact,
+                                             shared->snapshots);
         free(dev_cfg);
 
         /* On a persistent remount the relocated-log map is recomputed from the
@@ -1137,9 +1521,68 @@ diskfs_init(
                 "mismatch): refusing to mount to avoid corrupting relocated AG logs");
         }
 
-        if (mode == 2) {
-            chimera_diskfs_info("superblock not clean: running crash recovery");
-            diskfs_recover_log(shared, mio);
+        /* Feature gates (superblock version 5): refuse anything this build
+         * does not understand before the log or the AGs are touched.  Log
+         * bits only matter when there is a log to replay. */
+        if (mode != 0 && sb.version >= SM_FORMAT_VERSION_FEAT) {
+            chimera_diskfs_abort_if(sb.incompat & ~SM_INCOMPAT_KNOWN,
+                                    "filesystem uses unknown incompatible features 0x%lx: "
+                                    "refusing to mount", sb.incompat & ~SM_INCOMPAT_KNOWN);
+            chimera_diskfs_abort_if(mode == 2 && (sb.log_incompat & ~SM_LOG_INCOMPAT_KNOWN),
+                                    "intent log holds records of unknown formats 0x%lx: "
+                                    "refusing to recover",
+                                    sb.log_incompat & ~SM_LOG_INCOMPAT_KNOWN);
+            shared->space_map->incompat = sb.incompat;
+        }
+
+        /* Inline files are records older builds would read as empty.  The bit
+         * is sticky: once set, any file may still be inline. */
+        if (shared->inline_data_max) {
+            shared->space_map->incompat |= SM_INCOMPAT_INLINE_DATA;
+        }
+
+        /* Likewise compressed extents, which older builds would return as
+         * the raw compressed bytes; sticky because existing extents stay
+         * compressed when the setting is turned off. */
+        if (shared->compress_algo != DISKFS_COMPRESS_NONE) {
+            shared->space_map->incompat |= SM_INCOMPAT_COMPRESSION;
+        }
+
+        /* Snapshots change the AG layout, so the bit is fixed at format. */
+        if (shared->snapshots) {
+            shared->space_map->incompat |= SM_INCOMPAT_SNAPSHOT;
+        }
+
+        /* Record formats this session may log; the dirty superblock below
+         * carries them until a clean unmount drains the log. */
+        if (shared->redo_delta_max) {
+            shared->space_map->log_incompat |= SM_LOG_INCOMPAT_REDO_DELTA;
+        }
+        shared->space_map->log_incompat |= SM_LOG_INCOMPAT_REDO_BLOCK_CSUM;
+
+        /* Continue the redo sequence past every record still on the log.
+         * Recovery replays every intact record in seq order, so a session
+         * that restarted at zero would sort stale images from an earlier
+         * session after its own.  A superblock marked SM_SB_LOG_SEQ holds the
+         * resume point; one written by an older build (which restarted every
+         * session and never sets the flag) only counts its last session, so
+         * the log is swept for the highest seq instead, once. */
+        if (mode != 0 && (sb.flags & SM_SB_LOG_SEQ)) {
+            shared->intent_log.log_seq = sb.log_seq;
+        }
+
+        if (mode != 0 && (mode == 2 || !(sb.flags & SM_SB_LOG_SEQ))) {
+            uint64_t next_seq = 0;
+
+            if (mode == 2) {
+                chimera_diskfs_info("superblock not clean: running crash recovery");
+            }
+            diskfs_recover_log(shared, mio,
+                               sb.version >= SM_FORMAT_VERSION_FEAT ? sb.log_incompat : 0,
+                               mode == 2, &next_seq);
+            if (next_seq > shared->intent_log.log_seq) {
+                shared->intent_log.log_seq = next_seq;
+            }
         }
 
         /* Reload the persisted free-space map.  The allocator is authoritative
@@ -1192,6 +1635,12 @@ diskfs_init(
                                                                   rinum,
                                                                   rgen,
                                                                   shared->root_fh);
+            if (shared->snapshots) {
+                shared->snap_fhlen = chimera_vfs_encode_fh_inum_mount(fsid_buf,
+                                                                      DISKFS_SNAP_INUM,
+                                                                      DISKFS_SNAP_GEN,
+                                                                      shared->snap_fh);
+            }
         }
 
         /* Fresh format: deallocate every device before writing any metadata,
@@ -1220,10 +1669,10 @@ diskfs_init(
          * leaves it clear, so the next mount won't mistake a crash for a
          * clean shutdown. */
         rc = space_map_write_superblock(shared->space_map, &smio,
-                                        shared->fsid, 0,
+                                        shared->fsid, SM_SB_LOG_SEQ,
                                         mode != 0 ? shared->root_inum : 0,
                                         mode != 0 ? shared->root_gen : 0,
-                                        mode != 0 ? sb.log_seq : 0,
+                                        shared->intent_log.log_seq,
                                         shared->gen_floor);
         chimera_diskfs_abort_if(rc != 0, "Failed to write superblock");
 
@@ -1239,8 +1688,9 @@ diskfs_init(
     }
     free(device0_path);
 
-    /* Inode cache: sharded rb-trees keyed by inum, with per-shard LRU eviction
-     * of idle inodes (recycle candidates). */
+    /* Inode cache: sharded RCU hashes keyed by inum, with per-shard LRU
+     * eviction of idle inodes (recycle candidates).  Buckets are sized for
+     * the shard cap up front so lookups never race a resize. */
     shared->inode_cache            = calloc(1, sizeof(*shared->inode_cache));
     shared->inode_cache->shard_cap = (shared->inode_cache_inodes ?
                                       shared->inode_cache_inodes :
@@ -1249,14 +1699,22 @@ diskfs_init(
     if (shared->inode_cache->shard_cap == 0) {
         shared->inode_cache->shard_cap = 1;
     }
+    nbuckets = DISKFS_INODE_CACHE_BUCKETS_MIN;
+    while (nbuckets < shared->inode_cache->shard_cap) {
+        nbuckets <<= 1;
+    }
     for (i = 0; i < DISKFS_INODE_CACHE_SHARDS; i++) {
-        rb_tree_init(&shared->inode_cache->shards[i].inodes);
+        shared->inode_cache->shards[i].buckets     = calloc(nbuckets, sizeof(struct diskfs_inode *));
+        shared->inode_cache->shards[i].bucket_mask = nbuckets - 1;
         pthread_mutex_init(&shared->inode_cache->shards[i].lock, NULL);
     }
 
     /* Block cache: sharded RCU hash of 4 KiB device blocks. */
     diskfs_block_cache_create(shared);
 
+    /* Data cache: segmented-LRU read cache of file-data blocks. */
+    diskfs_dcache_create(shared);
+
     /* Initialize KV shards */
     shared->num_kv_shards = 256;
     shared->kv_shards     = calloc(shared->num_kv_shards, sizeof(*shared->kv_shards));
@@ -1266,33 +1724,64 @@ diskfs_init(
         pthread_mutex_init(&shared->kv_shards[i].lock, NULL);
     }
 
-    /* Bring up the intent log thread.  Spin until its init has registered
-     * the wake doorbell, since workers will start ringing it as soon as
-     * they begin processing requests. */
-    shared->intent_log.ready        = 0;
-    shared->intent_log.push_ready   = 0;
-    shared->intent_log.shutdown     = 0;
-    shared->intent_log.commit_alive = 1;
-    shared->intent_log.num_channels = 0;
-    shared->intent_log.pending_head = NULL;
-    pthread_mutex_init(&shared->intent_log.registration_lock, NULL);
-
-    /* Commit thread first: it allocates the cross-thread hand-off ring the
-     * push thread consumes, and opens the intent-log device queue. */
-    shared->intent_log.thread = evpl_thread_create(NULL,
-                                                   diskfs_intent_log_thread_init,
-                                                   diskfs_intent_log_thread_shutdown,
-                                                   &shared->intent_log);
-    while (!__atomic_load_n(&shared->intent_log.ready, __ATOMIC_ACQUIRE)) {
-        /* spin briefly */
-    }
+    /* Bring up the intent log streams.  Spin until each one's init has
+     * registered its wake doorbell, since workers will start ringing it as
+     * soon as they begin processing requests.  log_seq was set above from the
+     * superblock / recovery. */
+    {
+        struct diskfs_intent_log *il = &shared->intent_log;
+
+        il->push_ready       = 0;
+        il->shutdown         = 0;
+        il->num_channels     = 0;
+        il->redo_inflight    = 0;
+        il->live_records     = 0;
+        il->intent_log_size  = shared->intent_log_size;
+        il->log_head         = SM_INTENT_LOG_OFFSET;
+        il->log_tail         = SM_INTENT_LOG_OFFSET;
+        il->sync             = !shared->unsafe_async;
+        /* Test knob: simulate a crash at unmount.  Nothing is pushed home and
+         * the superblock is left dirty, so the next mount replays the whole
+         * session from the log (the log must not fill meanwhile). */
+        il->crash_test = getenv("DISKFS_TEST_CRASH") != NULL;
+        il->durable_seq      = il->log_seq;
+        il->push_seq         = il->log_seq;
+        il->durable          = calloc(DISKFS_IL_SEQ_WINDOW, sizeof(*il->durable));
+        il->owner            = calloc(DISKFS_IL_SEQ_WINDOW, sizeof(*il->owner));
+        pthread_mutex_init(&il->wake_lock, NULL);
+        pthread_mutex_init(&il->place_lock, NULL);
+
+        diskfs_intent_log_metrics_init(il);
+        diskfs_il_commit_metrics(il);
+
+        /* Streams first: each allocates the hand-off ring the push thread
+         * consumes, and opens its own intent-log device queue. */
+        for (i = 0; i < il->num_streams; i++) {
+            struct diskfs_il_stream *st = &il->streams[i];
+
+            st->il           = il;
+            st->index        = i;
+            st->ready        = 0;
+            st->num_channels = 0;
+            st->pending_head = NULL;
+            pthread_mutex_init(&st->registration_lock, NULL);
+
+            st->thread = evpl_thread_create(NULL,
+                                            diskfs_intent_log_thread_init,
+                                            diskfs_intent_log_thread_shutdown,
+                                            st);
+            while (!__atomic_load_n(&st->ready, __ATOMIC_ACQUIRE)) {
+                /* spin briefly */
+            }
+        }
 
-    shared->intent_log.push_thread = evpl_thread_create(NULL,
-                                                        diskfs_il_push_thread_init,
-                                                        diskfs_il_push_thread_shutdown,
-                                                        &shared->intent_log);
-    while (!__atomic_load_n(&shared->intent_log.push_ready, __ATOMIC_ACQUIRE)) {
-        /* spin briefly */
+        il->push_thread = evpl_thread_create(NULL,
+                                             diskfs_il_push_thread_init,
+                                             diskfs_il_push_thread_shutdown,
+                                             il);
+        while (!__atomic_load_n(&il->push_ready, __ATOMIC_ACQUIRE)) {
+            /* spin briefly */
+        }
     }
 
     /* Per-(device, AG) park lists for journaling stalled behind an AG-log
@@ -1439,6 +1928,48 @@ diskfs_bootstrap(struct diskfs_thread *thread)
         oin->block = NULL;
     }
 
+    /* Statically-reserved snapshot directory (after the orphan shards):
+     * read-only, one entry per published snapshot, its own parent.  It and
+     * everything below it are SNAPSHOT inodes, reached through snap_fh. */
+    if (shared->snapshots) {
+        uint32_t             sdev;
+        uint64_t             soff = sm_inum_to_device_offset(shared->space_map,
+                                                             DISKFS_SNAP_INUM, &sdev);
+        struct diskfs_inode *sin = diskfs_inode_struct_new(DISKFS_SNAP_INUM);
+
+        sin->gen            = DISKFS_SNAP_GEN;
+        sin->size           = 4096;
+        sin->space_used     = 4096;
+        sin->nlink          = 2;
+        sin->mode           = S_IFDIR | 0555;
+        sin->atime_sec      = now.tv_sec;
+        sin->atime_nsec     = now.tv_nsec;
+        sin->mtime_sec      = now.tv_sec;
+        sin->mtime_nsec     = now.tv_nsec;
+        sin->ctime_sec      = now.tv_sec;
+        sin->ctime_nsec     = now.tv_nsec;
+        sin->btime_sec      = now.tv_sec;
+        sin->btime_nsec     = now.tv_nsec;
+        sin->dos_attributes = 0;
+        sin->parent_inum    = sin->inum;
+        sin->parent_gen     = sin->gen;
+        sin->flags          = DISKFS_INODE_F_SNAPSHOT;
+
+        diskfs_inode_cache_insert(shared, sin);
+
+        sin->block = diskfs_block_claim(thread, sdev, soff, 1);
+        diskfs_bt_node_init(sin->block->iov.data, DISKFS_BT_ROOT_BASE,
+                            DISKFS_BT_ROOT_CAP, 0);
+        diskfs_inode_flush(sin);
+        rc = diskfs_mount_io_write(mio, sdev, sin->block->iov.data,
+                                   DISKFS_BLOCK_SIZE, soff);
+        chimera_diskfs_abort_if(rc != 0, "bootstrap snapshot directory write failed");
+        diskfs_mount_io_flush(mio, sdev);
+        sin->block->state = DISKFS_BLOCK_CLEAN;
+        diskfs_block_unpin(thread, sin->block, DISKFS_BLOCK_CLEAN);
+        sin->block = NULL;
+    }
+
     /* Create 16-byte fsid buffer for root FH encoding (8-byte fsid + 8 bytes padding) */
     {
         uint8_t fsid_buf[CHIMERA_VFS_FSID_SIZE] = { 0 };
@@ -1447,6 +1978,12 @@ diskfs_bootstrap(struct diskfs_thread *thread)
                                                               inode->inum,
                                                               inode->gen,
                                                               shared->root_fh);
+        if (shared->snapshots) {
+            shared->snap_fhlen = chimera_vfs_encode_fh_inum_mount(fsid_buf,
+                                                                  DISKFS_SNAP_INUM,
+                                                                  DISKFS_SNAP_GEN,
+                                                                  shared->snap_fh);
+        }
     }
     shared->root_inum       = inode->inum;
     shared->root_gen        = inode->gen;
@@ -1459,17 +1996,21 @@ diskfs_bootstrap(struct diskfs_thread *thread)
 
 
 static void
-diskfs_inode_cache_release(
-    struct rb_node *node,
-    void           *private_data)
+diskfs_inode_cache_release(struct diskfs_inode_shard *shard)
 {
-    struct diskfs_inode *inode = container_of(node, struct diskfs_inode, node);
-
-    (void) private_data;
+    struct diskfs_inode *inode, *next;
+    uint32_t             b;
 
     /* All inode contents live in b+tree blocks freed via the block cache;
-     * we only own the inode struct itself and the record mirrors riding it. */
-    diskfs_inode_struct_free(inode);
+     * we only own the inode structs and the record mirrors riding them.
+     * Every reader is gone by now, so no grace period is needed. */
+    for (b = 0; b <= shard->bucket_mask; b++) {
+        for (inode = shard->buckets[b]; inode; inode = next) {
+            next = inode->hash_next;
+            diskfs_inode_struct_free(inode);
+        }
+    }
+    free(shard->buckets);
 } /* diskfs_inode_cache_release */
 
 
@@ -1484,28 +2025,34 @@ diskfs_destroy(void *private_data)
     diskfs_reclaim_destroy(shared);
 
     for (i = 0; i < DISKFS_INODE_CACHE_SHARDS; i++) {
-        rb_tree_destroy(&shared->inode_cache->shards[i].inodes,
-                        diskfs_inode_cache_release, NULL);
+        diskfs_inode_cache_release(&shared->inode_cache->shards[i]);
         pthread_mutex_destroy(&shared->inode_cache->shards[i].lock);
     }
 
     /* Shut down the intent-log threads before tearing down anything they
      * might still touch.  Worker threads have already unregistered their
      * channels via the unregister handshake at this point.  Order matters: the
-     * commit thread first (it drains all redo writes and hands every record to
-     * the push thread), then the push thread (it flushes every record home and
-     * trims the log).  Only then are the shared rings and device-metric arrays
-     * safe to free. */
+     * commit streams first (each drains its redo writes and hands every record
+     * to the push thread; a stream still running kicks one that is draining
+     * when it moves the durable frontier, and a drained stream marks its
+     * doorbell dead so nothing rings it after destroy closes the fd), then the
+     * push thread (it flushes every record home and trims the log).  Only then
+     * are the shared rings and device-metric arrays safe to free. */
     __atomic_store_n(&shared->intent_log.shutdown, 1, __ATOMIC_RELEASE);
-    /* Stop the push thread from ringing the commit thread's wake_doorbell:
-     * destroying the commit thread closes that fd, and the push thread (torn
-     * down afterwards, to drain what the commit thread handed off) would
-     * otherwise abort writing to it. */
-    __atomic_store_n(&shared->intent_log.commit_alive, 0, __ATOMIC_RELEASE);
-    evpl_thread_destroy(shared->intent_log.thread);
+    for (i = 0; i < shared->intent_log.num_streams; i++) {
+        evpl_thread_destroy(shared->intent_log.streams[i].thread);
+    }
     evpl_thread_destroy(shared->intent_log.push_thread);
-    pthread_mutex_destroy(&shared->intent_log.registration_lock);
-    free(shared->intent_log.handoff);
+    for (i = 0; i < shared->intent_log.num_streams; i++) {
+        pthread_mutex_destroy(&shared->intent_log.streams[i].registration_lock);
+        free(shared->intent_log.streams[i].handoff);
+        free(shared->intent_log.streams[i].metrics.block_io_device_ops);
+        free(shared->intent_log.streams[i].metrics.block_io_device_bytes);
+    }
+    pthread_mutex_destroy(&shared->intent_log.wake_lock);
+    pthread_mutex_destroy(&shared->intent_log.place_lock);
+    free(shared->intent_log.durable);
+    free(shared->intent_log.owner);
     free(shared->intent_log.metrics.block_io_device_ops);
     free(shared->intent_log.metrics.block_io_device_bytes);
 
@@ -1515,18 +2062,23 @@ diskfs_destroy(void *private_data)
      * reloads instead of re-handing-out in-use space.  Driven through the
      * mount-time evpl pump while the devices are still open -- the IL thread
      * (the only other device user) is already gone.  Only mark clean if a root
-     * actually exists (an untouched mkfs has nothing to preserve). */
-    {
+     * actually exists (an untouched mkfs has nothing to preserve).  The crash
+     * test skips all of it, leaving the superblock dirty. */
+    if (!shared->intent_log.crash_test) {
         struct diskfs_mount_io *mio  = diskfs_mount_io_open(shared);
         struct sm_io            smio = diskfs_mount_sm_io(mio);
 
+        /* The log is empty now, so no record format needs gating. */
+        shared->space_map->log_incompat = 0;
+
         if (space_map_persist(shared->space_map, &smio) != 0) {
             chimera_diskfs_error("space-map persist at unmount failed");
         } else if (shared->root_fhlen != 0) {
             /* Clean unmount: persist the exact next generation (no reserve
              * needed -- nothing was issued past gen_next). */
             int rc = space_map_write_superblock(shared->space_map, &smio,
-                                                shared->fsid, SM_SB_CLEAN,
+                                                shared->fsid,
+                                                SM_SB_CLEAN | SM_SB_LOG_SEQ,
                                                 shared->root_inum, shared->root_gen,
                                                 shared->intent_log.log_seq,
                                                 __atomic_load_n(&shared->gen_next,
@@ -1545,6 +2097,7 @@ diskfs_destroy(void *private_data)
     }
 
     diskfs_block_cache_destroy(shared);
+    diskfs_dcache_destroy(shared);
 
     if (shared->agw) {
         for (i = 0; i < shared->num_devices; i++) {
@@ -1568,6 +2121,12 @@ diskfs_destroy(void *private_data)
     free(shared->metrics.block_io_device_bytes_series);
 
     pthread_mutex_destroy(&shared->lock);
+    for (i = 0; i < DISKFS_CSUM_LOCKS; i++) {
+        pthread_mutex_destroy(&shared->csum_lock[i]);
+    }
+    for (i = 0; i < DISKFS_REF_LOCKS; i++) {
+        pthread_mutex_destroy(&shared->ref_lock[i]);
+    }
     free(shared->devices);
     free(shared->inode_cache);
 
@@ -1594,6 +2153,7 @@ diskfs_thread_init(
     thread->allocator = slab_allocator_create(4096, 1024 * 1024 * 1024);
 
     diskfs_block_cache_prealloc(shared, evpl);
+    diskfs_dcache_prealloc(shared, evpl);
 
     evpl_iovec_alloc(evpl, 4096, 4096, 1, 0, &thread->zero);
     memset(thread->zero.data, 0, 4096);  // Zero buffer must contain zeros!
@@ -1624,7 +2184,8 @@ diskfs_thread_init(
     evpl_add_doorbell(evpl, &thread->grant_doorbell, diskfs_grant_doorbell_cb);
     thread->grant_poll = evpl_add_poll(evpl, NULL, NULL, diskfs_grant_poll, thread);
 
-    thread->queue = calloc(shared->num_devices, sizeof(*thread->queue));
+    thread->queue      = calloc(shared->num_devices, sizeof(*thread->queue));
+    thread->near_cache = calloc(shared->num_devices, sizeof(*thread->near_cache));
 
     for (int i = 0; i < shared->num_devices; i++) {
         /* Remote (pNFS data) devices have no local handle: leave queue NULL. */
@@ -1657,17 +2218,27 @@ diskfs_thread_init(
                        shared->mtime_defer_us);
     }
 
-    /* Hand the channel to the intent log thread via the pending list. */
-    pthread_mutex_lock(&shared->intent_log.registration_lock);
-    thread->iq_channel->next_pending = shared->intent_log.pending_head;
-    shared->intent_log.pending_head  = thread->iq_channel;
-    pthread_mutex_unlock(&shared->intent_log.registration_lock);
+    /* Hand the channel to its commit stream via the pending list.  Workers are
+     * spread over the streams by id: a worker's commits stay on one stream (its
+     * SQ/CQ rings are single-producer/single-consumer), and every stream sees
+     * a share of the load whatever inodes or AGs the workers touch. */
+    {
+        struct diskfs_il_stream *st =
+            &shared->intent_log.streams[thread->thread_id % shared->intent_log.num_streams];
 
-    /* Publish "registration pending" before the doorbell: the commit thread
-     * services this from its per-iteration poll (reg_dirty) when awake, or from
-     * the wake doorbell when asleep. */
-    __atomic_store_n(&shared->intent_log.reg_dirty, 1, __ATOMIC_SEQ_CST);
-    evpl_ring_doorbell(&shared->intent_log.wake_doorbell);
+        thread->iq_channel->stream = st;
+
+        pthread_mutex_lock(&st->registration_lock);
+        thread->iq_channel->next_pending = st->pending_head;
+        st->pending_head                 = thread->iq_channel;
+        pthread_mutex_unlock(&st->registration_lock);
+
+        /* Publish "registration pending" before the doorbell: the commit thread
+         * services this from its per-iteration poll (reg_dirty) when awake, or
+         * from the wake doorbell when asleep. */
+        __atomic_store_n(&st->reg_dirty, 1, __ATOMIC_SEQ_CST);
+        evpl_ring_doorbell(&st->wake_doorbell);
+    }
 
     return thread;
 } /* diskfs_thread_init */
@@ -1702,6 +2273,11 @@ diskfs_thread_destroy(void *private_data)
         evpl_continue(thread->evpl);
     }
 
+    /* Readdir prefetches are fire-and-forget; let them land. */
+    while (thread->prefetching) {
+        evpl_continue(thread->evpl);
+    }
+
     /* Drain pending block I/O before closing queues */
     if (thread->pending_io > 0) {
         chimera_diskfs_debug("diskfs_thread_destroy: draining %d pending I/O operations",
@@ -1744,6 +2320,8 @@ diskfs_thread_destroy(void *private_data)
     evpl_iovec_release(thread->evpl, &thread->zero);
     evpl_iovec_release(thread->evpl, &thread->pad);
 
+    diskfs_compress_thread_destroy(thread);
+
     slab_allocator_destroy(thread->allocator);
 
     for (int i = 0; i < shared->num_devices; i++) {
@@ -1757,6 +2335,9 @@ diskfs_thread_destroy(void *private_data)
      * the in-memory free set and is captured by the condense at clean unmount.
      * (File-data reservations live on the inode and are returned on close.) */
     space_map_thread_cache_return(shared->space_map, NULL, &thread->space_cache);
+    for (int i = 0; i < shared->num_devices; i++) {
+        space_map_thread_cache_return(shared->space_map, NULL, &thread->near_cache[i]);
+    }
 
     /* Unregister the intent-log channel.  Caller must have quiesced all
      * in-flight VFS ops on this thread first. */
@@ -1764,8 +2345,8 @@ diskfs_thread_destroy(void *private_data)
         struct diskfs_iq_channel *ch = thread->iq_channel;
 
         __atomic_store_n(&ch->unregister_requested, 1, __ATOMIC_RELEASE);
-        __atomic_store_n(&shared->intent_log.reg_dirty, 1, __ATOMIC_SEQ_CST);
-        evpl_ring_doorbell(&shared->intent_log.wake_doorbell);
+        __atomic_store_n(&ch->stream->reg_dirty, 1, __ATOMIC_SEQ_CST);
+        evpl_ring_doorbell(&ch->stream->wake_doorbell);
 
         /* Spin (not evpl_continue: with nothing left in flight there is no
          * event to wake the loop, and the IL acks via a plain store with no
@@ -1820,5 +2401,6 @@ diskfs_thread_destroy(void *private_data)
     free(thread->metrics.block_io_device_ops);
     free(thread->metrics.block_io_device_bytes);
     free(thread->queue);
+    free(thread->near_cache);
     free(thread);
 } /* diskfs_thread_destroy */
@@ -187,6 +187,16 @@ static void
 diskfs_readdir_complete(
     struct chimera_vfs_request *request);
 
+static void
+diskfs_readdir_prefetch(
+    struct chimera_vfs_request *request);
+
+static void
+diskfs_readdir_prefetch_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data);
+
 static void
 diskfs_readdir_iter_inode_cb(
     struct diskfs_inode *dirent_inode,
@@ -805,6 +815,7 @@ diskfs_mkdir_at_alloc_cb(
 
     inode->parent_inum = parent->inum;
     inode->parent_gen  = parent->gen;
+    inode->extsize     = parent->extsize;
 
     /* Snapshot any explicit ACL pointer BEFORE diskfs_apply_attrs() rewrites
      * va_set_mask and drops the ATTR_ACL bit. */
@@ -856,7 +867,8 @@ diskfs_mkdir_at_check_cb(
         return;
     }
 
-    diskfs_inode_alloc_async(thread, p->txn, diskfs_mkdir_at_alloc_cb, request);
+    /* A new directory starts a subtree: let it land on any device. */
+    diskfs_inode_alloc_async(thread, p->txn, 0, diskfs_mkdir_at_alloc_cb, request);
 } /* diskfs_mkdir_at_check_cb */
 
 
@@ -996,6 +1008,9 @@ diskfs_mknod_at_alloc_cb(
     if (request->mknod_at.set_attr->va_set_mask & CHIMERA_VFS_ATTR_RDEV) {
         inode->rdev = request->mknod_at.set_attr->va_rdev;
     }
+    if (S_ISREG(inode->mode)) {
+        inode->extsize = parent->extsize;
+    }
 
     diskfs_apply_attrs(inode, request->mknod_at.set_attr);
     diskfs_map_attrs(thread, &request->mknod_at.r_attr, inode);
@@ -1037,7 +1052,8 @@ diskfs_mknod_at_check_cb(
         return;
     }
 
-    diskfs_inode_alloc_async(thread, p->txn, diskfs_mknod_at_alloc_cb, request);
+    diskfs_inode_alloc_async(thread, p->txn, p->inode_stash[0]->inum,
+                             diskfs_mknod_at_alloc_cb, request);
 } /* diskfs_mknod_at_check_cb */
 
 
@@ -1347,6 +1363,13 @@ diskfs_readdir_finish(struct chimera_vfs_request *request)
     struct diskfs_request_private *p     = request->plugin_data;
     struct diskfs_inode           *inode = p->inode_stash[0];
 
+    /* The prefetch cursor's dirent lookup reads the directory under this
+     * request's lock; its completion finishes the request instead. */
+    if (p->rd_pf_busy) {
+        p->rd_pf_finish = 1;
+        return;
+    }
+
     diskfs_map_attrs(p->thread, &request->readdir.r_dir_attr, inode);
     diskfs_op_ok(request, p->txn);
 } /* diskfs_readdir_finish */
@@ -1370,6 +1393,89 @@ diskfs_readdir_complete(struct chimera_vfs_request *request)
 } /* diskfs_readdir_complete */
 
 
+/* Consume one prefetch-cursor dirent: start faulting its inode in and step
+ * past it, or note the end of the directory. */
+static void
+diskfs_readdir_prefetch_advance(
+    struct chimera_vfs_request *request,
+    struct diskfs_bt_op        *op,
+    int                         result)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    struct diskfs_dirent_rec      *rec    = (struct diskfs_dirent_rec *) p->rd_pf_rec;
+
+    p->rd_pf_busy = 0;
+
+    if (result < 0 || op->found_key.type != DISKFS_REC_DIRENT) {
+        p->rd_pf_eof = 1;
+    } else {
+        diskfs_inode_prefetch(thread, rec->inum, rec->gen);
+        p->rd_pf_hash = op->found_key.subkey + 1;
+        p->rd_pf_ahead++;
+    }
+
+    diskfs_bt_op_free(thread, op);
+} /* diskfs_readdir_prefetch_advance */
+
+
+/*
+ * Keep a window of up to readdir_prefetch child inodes loading ahead of the
+ * emit cursor.  A second cursor walks the dirents past the one being emitted
+ * and faults each child into the inode cache without locking it, so the
+ * loads of a cold directory overlap instead of costing one dependent device
+ * read per entry; emission stays on the main cursor in cookie order, and its
+ * acquires then hit the cache or park on the fault already in flight.  At
+ * most one prefetch dirent lookup is outstanding.
+ */
+static void
+diskfs_readdir_prefetch(struct chimera_vfs_request *request)
+{
+    struct diskfs_request_private *p      = request->plugin_data;
+    struct diskfs_thread          *thread = p->thread;
+    uint32_t                       window = thread->shared->readdir_prefetch;
+    struct diskfs_bt_op           *op;
+
+    /* The emit cursor caught up (prefetch skipped or slow): restart here. */
+    if (p->rd_pf_hash < p->rd_from_hash) {
+        p->rd_pf_hash  = p->rd_from_hash;
+        p->rd_pf_ahead = 0;
+    }
+
+    while (!p->rd_pf_busy && !p->rd_pf_eof && !p->rd_pf_finish && !p->rd_done &&
+           p->rd_pf_ahead < window) {
+        op            = diskfs_bt_op_alloc(thread);
+        p->rd_pf_busy = 1;
+        if (!diskfs_dir_next_async(op, thread, p->inode_stash[0], p->rd_pf_hash,
+                                   &op->found_key, p->rd_pf_rec, sizeof(p->rd_pf_rec),
+                                   diskfs_readdir_prefetch_cb, request)) {
+            return;
+        }
+        diskfs_readdir_prefetch_advance(request, op, op->result);
+    }
+} /* diskfs_readdir_prefetch */
+
+
+static void
+diskfs_readdir_prefetch_cb(
+    struct diskfs_bt_op *op,
+    int                  result,
+    void                *private_data)
+{
+    struct chimera_vfs_request    *request = private_data;
+    struct diskfs_request_private *p       = request->plugin_data;
+
+    diskfs_readdir_prefetch_advance(request, op, result);
+
+    if (p->rd_pf_finish) {
+        diskfs_readdir_finish(request);
+        return;
+    }
+
+    diskfs_readdir_prefetch(request);
+} /* diskfs_readdir_prefetch_cb */
+
+
 static void
 diskfs_readdir_iter_inode_cb(
     struct diskfs_inode *dirent_inode,
@@ -1382,6 +1488,11 @@ diskfs_readdir_iter_inode_cb(
     struct chimera_vfs_attrs       attr;
     int                            rc;
 
+    /* This entry was one the prefetch cursor had passed: the window opens. */
+    if (p->rd_hash < p->rd_pf_hash && p->rd_pf_ahead) {
+        p->rd_pf_ahead--;
+    }
+
     if (status != CHIMERA_VFS_OK) {
         /* Stale dirent — skip to the next. */
         p->rd_from_hash = p->rd_hash + 1;
@@ -1464,7 +1575,8 @@ diskfs_readdir_iter_step(struct chimera_vfs_request *request)
     p->rd_looping = 1;
     do {
         p->rd_advance = 0;
-        op            = diskfs_bt_op_alloc(thread);
+        diskfs_readdir_prefetch(request);
+        op = diskfs_bt_op_alloc(thread);
         if (diskfs_dir_next_async(op, thread, inode, p->rd_from_hash, &op->found_key,
                                   p->rec_scratch, sizeof(p->rec_scratch),
                                   diskfs_readdir_next_cb, request)) {
@@ -1635,9 +1747,14 @@ diskfs_readdir(
 
     p->thread     = thread;
     p->txn        = diskfs_txn_begin(thread, DISKFS_TXN_READ);
-    p->rd_looping = 0;
-    p->rd_advance = 0;
-    p->rd_done    = 0;
+    p->rd_looping   = 0;
+    p->rd_advance   = 0;
+    p->rd_done      = 0;
+    p->rd_pf_hash   = 0;
+    p->rd_pf_ahead  = 0;
+    p->rd_pf_busy   = 0;
+    p->rd_pf_eof    = 0;
+    p->rd_pf_finish = 0;
 
     diskfs_inode_get_fh_async(thread, p->txn,
                               request->fh, request->fh_len,
@@ -1877,6 +1994,7 @@ diskfs_open_at_alloc_cb(
     inode->btime_sec      = now.tv_sec;
     inode->btime_nsec     = now.tv_nsec;
     inode->dos_attributes = 0;
+    inode->extsize        = parent->extsize;
 
     /* Snapshot any explicit ACL pointer BEFORE diskfs_apply_attrs() rewrites
      * va_set_mask and drops the ATTR_ACL bit. */
@@ -1940,7 +2058,8 @@ diskfs_open_at_check_cb(
             return;
         }
 
-        diskfs_inode_alloc_async(thread, p->txn, diskfs_open_at_alloc_cb, request);
+        diskfs_inode_alloc_async(thread, p->txn, p->inode_stash[0]->inum,
+                                 diskfs_open_at_alloc_cb, request);
         return;
     }
 
@@ -2090,7 +2209,7 @@ diskfs_create_unlinked(
     p->thread = thread;
     p->txn    = diskfs_txn_begin(thread, DISKFS_TXN_WRITE);
 
-    diskfs_inode_alloc_async(thread, p->txn,
+    diskfs_inode_alloc_async(thread, p->txn, 0,
                              diskfs_create_unlinked_alloc_cb, request);
 } /* diskfs_create_unlinked */
 
@@ -2268,7 +2387,8 @@ diskfs_symlink_at_check_cb(
     }
 
     diskfs_map_attrs(thread, &request->symlink_at.r_dir_pre_attr, p->inode_stash[0]);
-    diskfs_inode_alloc_async(thread, p->txn, diskfs_symlink_at_alloc_cb, request);
+    diskfs_inode_alloc_async(thread, p->txn, p->inode_stash[0]->inum,
+                             diskfs_symlink_at_alloc_cb, request);
 } /* diskfs_symlink_at_check_cb */
 
 
@@ -85,6 +85,21 @@ diskfs_reclaim_submit(
     uint64_t              inum,
     uint32_t              gen);
 
+static void
+diskfs_reclaim_rcu_quiescent(
+    struct evpl *evpl,
+    void        *private_data);
+
+static void
+diskfs_reclaim_rcu_offline(
+    struct evpl *evpl,
+    void        *private_data);
+
+static void
+diskfs_reclaim_rcu_online(
+    struct evpl *evpl,
+    void        *private_data);
+
 static void *
 diskfs_reclaim_thread_init(
     struct evpl *evpl,
@@ -260,14 +275,13 @@ diskfs_drain_final_cb(
      * with a reallocation of the inum.  Straggling lookups by the old (or
      * any) generation fault from disk and get ENOENT from the tombstone /
      * inum check there. */
-    pthread_mutex_lock(&shard->lock);
-    rb_tree_query_exact(&shard->inodes, d->inum, inum, inode);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
+    inode = diskfs_inode_cache_lookup(shard, d->inum);
     if (inode && inode->nlink == 0 && inode->refcnt == 0 &&
         !inode->writer && !inode->readers && !inode->wait_head) {
         diskfs_inode_lru_unlink(shard, inode);
-        rb_tree_remove(&shard->inodes, &inode->node);
-        shard->ninodes--;
-        diskfs_inode_struct_free(inode);
+        diskfs_inode_cache_unlink_locked(shard, inode);
+        diskfs_inode_struct_retire(inode);
     }
     pthread_mutex_unlock(&shard->lock);
 
@@ -342,7 +356,7 @@ diskfs_drain_looked_cb(
         struct diskfs_extent_rec *e = (struct diskfs_extent_rec *) d->recbuf;
 
         diskfs_thread_free_space(d->thread, d->txn, e->device_id, e->device_offset,
-                                 SM_ALIGN_UP(e->length));
+                                 diskfs_ext_phys_len(e->length, e->flags));
     }
     diskfs_bt_op_free(d->thread, op);
 
@@ -378,6 +392,7 @@ diskfs_reclaim_doorbell_cb(
                                                    struct diskfs_reclaim_worker,
                                                    doorbell);
     struct diskfs_reclaim_job    *jobs, *j;
+    int64_t                       count = 0;
 
     (void) evpl;
 
@@ -390,6 +405,7 @@ diskfs_reclaim_doorbell_cb(
     while (jobs) {
         j    = jobs;
         jobs = j->next;
+        count++;
         if (j->type == DISKFS_RECLAIM_JOB_CONDENSE) {
             diskfs_condense_start(w, j->device_id, j->ag_index);
         } else {
@@ -397,6 +413,11 @@ diskfs_reclaim_doorbell_cb(
         }
         free(j);
     }
+
+    if (count) {
+        chimera_thread_stats_queue(w->stats, -count);
+        chimera_thread_stats_work(count);
+    }
 } /* diskfs_reclaim_doorbell_cb */
 
 
@@ -434,6 +455,7 @@ diskfs_reclaim_submit_job(
         w->head = j;
     }
     w->tail = j;
+    chimera_thread_stats_queue(w->stats, 1);
     pthread_mutex_unlock(&w->lock);
 
     evpl_ring_doorbell(&w->doorbell);
@@ -455,6 +477,55 @@ diskfs_reclaim_submit(
 } /* diskfs_reclaim_submit */
 
 
+/*
+ * Reclaim workers acquire inodes through the lock-free inode-cache lookup, so
+ * unlike other helper threads they are QSBR readers: registered for their
+ * lifetime and driven through quiescent/offline states by the loop hooks,
+ * exactly as the VFS worker threads are (see chimera_vfs_rcu_hooks).
+ */
+static void
+diskfs_reclaim_rcu_quiescent(
+    struct evpl *evpl,
+    void        *private_data)
+{
+    (void) evpl;
+    (void) private_data;
+    urcu_qsbr_quiescent_state();
+    chimera_thread_stats_iteration_end();
+} /* diskfs_reclaim_rcu_quiescent */
+
+
+static void
+diskfs_reclaim_rcu_offline(
+    struct evpl *evpl,
+    void        *private_data)
+{
+    (void) evpl;
+    (void) private_data;
+    chimera_thread_stats_pre_wait();
+    urcu_qsbr_thread_offline();
+} /* diskfs_reclaim_rcu_offline */
+
+
+static void
+diskfs_reclaim_rcu_online(
+    struct evpl *evpl,
+    void        *private_data)
+{
+    (void) evpl;
+    (void) private_data;
+    urcu_qsbr_thread_online();
+    chimera_thread_stats_post_wait();
+} /* diskfs_reclaim_rcu_online */
+
+
+static const struct evpl_loop_hooks diskfs_reclaim_rcu_hooks = {
+    .iteration_end = diskfs_reclaim_rcu_quiescent,
+    .pre_wait      = diskfs_reclaim_rcu_offline,
+    .post_wait     = diskfs_reclaim_rcu_online,
+};
+
+
 static void *
 diskfs_reclaim_thread_init(
     struct evpl *evpl,
@@ -462,8 +533,24 @@ diskfs_reclaim_thread_init(
 {
     struct diskfs_reclaim_worker *w = private_data;
 
+    w->stats = chimera_thread_stats_register("diskfs_reclaim");
+    urcu_qsbr_register_thread();
+    evpl_set_loop_hooks(evpl, &diskfs_reclaim_rcu_hooks);
+
     w->ctx = diskfs_thread_init(evpl, w->shared);
     evpl_add_doorbell(evpl, &w->doorbell, diskfs_reclaim_doorbell_cb);
+    if (w->shared->defrag && w->shared->defrag->worker == w) {
+        diskfs_defrag_thread_init(w);
+    }
+    if (w->shared->discard && w->shared->discard->worker == w) {
+        diskfs_discard_thread_init(w);
+    }
+    if (w->shared->scrub && w->shared->scrub->worker == w) {
+        diskfs_scrub_thread_init(w);
+    }
+    if (w->shared->snapshot && w->shared->snapshot->worker == w) {
+        diskfs_snapshot_thread_init(w);
+    }
     __atomic_store_n(&w->ready, 1, __ATOMIC_RELEASE);
     return w;
 } /* diskfs_reclaim_thread_init */
@@ -488,6 +575,19 @@ diskfs_reclaim_thread_shutdown(
         evpl_continue(evpl);
     }
 
+    if (w->shared->defrag && w->shared->defrag->worker == w) {
+        diskfs_defrag_thread_shutdown(w);
+    }
+    if (w->shared->discard && w->shared->discard->worker == w) {
+        diskfs_discard_thread_shutdown(w);
+    }
+    if (w->shared->scrub && w->shared->scrub->worker == w) {
+        diskfs_scrub_thread_shutdown(w);
+    }
+    if (w->shared->snapshot && w->shared->snapshot->worker == w) {
+        diskfs_snapshot_thread_shutdown(w);
+    }
+
     evpl_remove_doorbell(evpl, &w->doorbell);
     diskfs_thread_destroy(w->ctx);
 
@@ -498,6 +598,10 @@ diskfs_reclaim_thread_shutdown(
         free(j);
     }
     pthread_mutex_destroy(&w->lock);
+
+    evpl_set_loop_hooks(evpl, NULL);
+    urcu_qsbr_unregister_thread();
+    chimera_thread_stats_unregister();
 } /* diskfs_reclaim_thread_shutdown */
 
 
@@ -511,6 +615,31 @@ diskfs_reclaim_create(struct diskfs_shared *shared)
                                           : DISKFS_RECLAIM_THREADS_DEFAULT;
     r->workers = calloc(r->nworkers, sizeof(*r->workers));
 
+    /* Online defragmentation lives on worker 0 (armed by its thread init). */
+    diskfs_defrag_create(shared);
+    if (shared->defrag) {
+        shared->defrag->worker = &r->workers[0];
+    }
+
+    /* Discard of freed space lives on the last worker, away from defrag
+     * when there is more than one. */
+    diskfs_discard_create(shared);
+    shared->discard->worker = &r->workers[r->nworkers - 1];
+
+    /* The data checksum scrub (checksummed filesystems only) takes the
+     * middle worker. */
+    diskfs_scrub_create(shared);
+    if (shared->scrub) {
+        shared->scrub->worker = &r->workers[r->nworkers / 2];
+    }
+
+    /* Snapshot creation (filesystems formatted for snapshots only) runs on
+     * worker 0, beside defrag. */
+    diskfs_snapshot_create(shared);
+    if (shared->snapshot) {
+        shared->snapshot->worker = &r->workers[0];
+    }
+
     for (i = 0; i < r->nworkers; i++) {
         struct diskfs_reclaim_worker *w = &r->workers[i];
 
@@ -539,6 +668,10 @@ diskfs_reclaim_destroy(struct diskfs_shared *shared)
     for (i = 0; i < r->nworkers; i++) {
         evpl_thread_destroy(r->workers[i].thread);
     }
+    diskfs_defrag_destroy(shared);
+    diskfs_discard_destroy(shared);
+    diskfs_scrub_destroy(shared);
+    diskfs_snapshot_destroy(shared);
     free(r->workers);
     free(r);
     shared->reclaim = NULL;
@@ -715,7 +848,7 @@ diskfs_inode_orphaned_recorded_cb(void *priv)
      * are recoverable.  Otherwise the final ref drop (close / pin release)
      * submits it.  (A duplicate submit from a racing ref drop is benign: the
      * second drain finds the bumped generation and skips.) */
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
     reclaim = (c.inode->refcnt == 0);
     pthread_mutex_unlock(&shard->lock);
 
@@ -753,7 +886,7 @@ diskfs_inode_orphaned(
 
     /* Shard-locked like every other ref drop, so it can't race a concurrent
      * deferred-mtime pin release. */
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
     --inode->refcnt;
     pthread_mutex_unlock(&shard->lock);
 
@@ -781,7 +914,7 @@ diskfs_inode_ref_drop(
                                                           inode->inum);
     int                        reclaim;
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "diskfs_inode_shard");
     --inode->refcnt;
     reclaim = (inode->refcnt == 0 && inode->nlink == 0);
     if (diskfs_inode_idle(inode) && !inode->on_lru) {
@@ -828,18 +961,18 @@ diskfs_orphan_scan_node(
             free(cbuf);
         }
     } else {
-        struct diskfs_bt_lslot *s = diskfs_bt_lslots(buf, base);
-
         for (i = 0; i < h->nitems; i++) {
-            if (s[i].key.type != DISKFS_REC_ORPHAN) {
+            struct diskfs_bt_key k = diskfs_bt_leaf_key(buf, base, i);
+
+            if (k.type != DISKFS_REC_ORPHAN) {
                 continue;
             }
             if (*n == *cap) {
                 *cap *= 2;
                 *arr  = realloc(*arr, *cap * sizeof(**arr));
             }
-            (*arr)[*n].inum = s[i].key.subkey;
-            (*arr)[*n].gen  = *(uint32_t *) ((char *) buf + base + s[i].off);
+            (*arr)[*n].inum = k.subkey;
+            (*arr)[*n].gen  = *(uint32_t *) diskfs_bt_leaf_rec(buf, base, i);
             (*n)++;
         }
     }
@@ -935,24 +1068,19 @@ diskfs_bt_remove_locked(
     int      depth = 0;
     void    *buf   = inode->block->iov.data;
     uint32_t base  = DISKFS_BT_ROOT_BASE;
-    int      idx, exact, j, level;
+    int      idx, exact, level;
 
     /* Descend to the leaf, recording the interior path. */
     for (;; ) {
         struct diskfs_bt_node_hdr *h = diskfs_bt_hdr(buf, base);
 
         if (h->level == 0) {
-            struct diskfs_bt_lslot *sl = diskfs_bt_lslots(buf, base);
-
             idx = diskfs_bt_leaf_search(buf, base, key, &exact);
             if (!exact) {
                 return 0;
             }
-            for (j = idx; j < h->nitems - 1; j++) {
-                sl[j] = sl[j + 1];
-            }
-            h->nitems--;
-            diskfs_bt_leaf_compact(buf, base, h->capacity);
+            diskfs_bt_leaf_drop(buf, base, idx);
+            diskfs_bt_leaf_compact(thread, buf, base, h->capacity);
             break;
         }
 
@@ -974,7 +1102,7 @@ diskfs_bt_remove_locked(
     /* Removing a leaf's minimum changes its subtree min; keep the ancestor
      * separators exact (cascading up through leftmost links). */
     if (idx == 0 && diskfs_bt_hdr(buf, base)->nitems > 0) {
-        struct diskfs_bt_key new_min = diskfs_bt_lslots(buf, base)[0].key;
+        struct diskfs_bt_key new_min = diskfs_bt_leaf_key(buf, base, 0);
 
         for (level = depth - 1; level >= 0; level--) {
             int ci = path[level].ci;
@@ -0,0 +1,1064 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Mount-time crash recovery: stream the intent log through a few bounded
+ * windows, probing and verifying each window's redo records on a pool of
+ * threads while the next window is read, gather the latest image of every
+ * logged home block as the windows go by, and write those images home in
+ * batches.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "diskfs_internal.h"
+
+/* One home block of the replay set, in its partition's hash table. */
+struct diskfs_recover_slot {
+    struct diskfs_recover_write write;
+    uint32_t                    next; /* hash chain (index into writes) */
+};
+
+/* One hash partition of the logged home blocks, owned by one thread while the
+ * replay set is gathered and built. */
+struct diskfs_recover_part {
+    struct diskfs_recover_slot *slots;
+    uint32_t                    nslots;
+    uint32_t                    cap;
+    uint32_t                   *hash;   /* bucket -> slot index, UINT32_MAX: empty */
+    uint32_t                    hash_bits;
+};
+
+/* Per-thread state: a slice of the current window's 4 KiB probe boundaries,
+ * the intact records found starting in it (two generations: the window being
+ * scanned and the one being gathered), and the records that run past the
+ * window's end. */
+struct diskfs_recover_scan {
+    struct diskfs_recover_ctx *ctx;
+    uint32_t                   id;
+    uint64_t                   start;
+    uint64_t                   end;
+    struct diskfs_recover_rec *recs[2];
+    uint32_t                   nrec[2];
+    uint32_t                   cap[2];
+    uint64_t                  *spill;   /* log offsets */
+    uint32_t                   nspill;
+    uint32_t                   spill_cap;
+    uint64_t                   records;
+    uint64_t                   nblocks;
+    uint64_t                   next_seq;
+};
+
+/* Shared state of one pipeline step: scan window `step`, gather window
+ * `step - 1` (whose buffer is left untouched until the step after). */
+struct diskfs_recover_ctx {
+    struct diskfs_shared       *shared;
+    uint64_t                    log_size;
+    int                         legacy;
+    int                         replay;
+    uint32_t                    nthreads;
+    uint32_t                    step;
+    const char                 *scan_buf;
+    uint64_t                    scan_base;
+    uint64_t                    scan_len;
+    const char                 *gather_buf;
+    struct diskfs_recover_scan *scans;
+    struct diskfs_recover_part *parts;
+};
+
+/* Threads started by diskfs_recover_spawn, to be waited for. */
+struct diskfs_recover_threads {
+    pthread_t *threads;
+    uint8_t   *started;
+    uint32_t   n;
+};
+
+/* Forward declarations (definitions below, in call-graph order) */
+
+static inline uint64_t
+diskfs_recover_now_ns(
+    void);
+
+static void
+diskfs_recover_spawn(
+    struct diskfs_recover_threads *th,
+    uint32_t                       n,
+    void *(*fn)(void *),
+    void                          *ctxs,
+    size_t                         stride);
+
+static void
+diskfs_recover_join(
+    struct diskfs_recover_threads *th);
+
+static void
+diskfs_recover_parallel(
+    uint32_t n,
+    void *(*fn)(void *),
+    void    *ctxs,
+    size_t   stride);
+
+static int
+diskfs_recover_read_log(
+    struct diskfs_mount_io *io,
+    char                   *buf,
+    uint64_t                offset,
+    uint64_t                size);
+
+static int
+diskfs_recover_verify(
+    const char *log,
+    uint64_t    log_size,
+    uint64_t    o,
+    int         legacy,
+    uint64_t   *hdr_len);
+
+static void
+diskfs_recover_scan_window(
+    struct diskfs_recover_scan *scan);
+
+static inline int
+diskfs_recover_newer(
+    uint64_t seq,
+    uint32_t index,
+    uint64_t than_seq,
+    uint32_t than_index);
+
+static struct diskfs_recover_write *
+diskfs_recover_slot(
+    struct diskfs_recover_part *part,
+    uint32_t                    device_id,
+    uint64_t                    device_offset);
+
+static void
+diskfs_recover_add(
+    struct diskfs_recover_part *part,
+    uint32_t                    device_id,
+    uint64_t                    device_offset,
+    uint64_t                    seq,
+    uint32_t                    index,
+    uint32_t                    delta_len,
+    const char                 *src);
+
+static void
+diskfs_recover_gather(
+    struct diskfs_recover_ctx *ctx,
+    uint32_t                   part_id,
+    const char                *rec,
+    uint64_t                   hdr_len);
+
+static void *
+diskfs_recover_worker(
+    void *arg);
+
+static int
+diskfs_recover_spills(
+    struct diskfs_recover_ctx *ctx,
+    struct diskfs_mount_io    *io,
+    const char                *window);
+
+static int
+diskfs_recover_delta_cmp(
+    const void *a,
+    const void *b);
+
+static void
+diskfs_recover_apply_delta(
+    char       *img,
+    const char *delta,
+    uint32_t    len);
+
+static void *
+diskfs_recover_build_worker(
+    void *arg);
+
+static void
+diskfs_recover_report(
+    struct diskfs_shared *shared,
+    const uint64_t       *values);
+
+
+static inline uint64_t
+diskfs_recover_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+} /* diskfs_recover_now_ns */
+
+
+/*
+ * Start fn over n contexts laid out `stride` bytes apart, one thread each.  A
+ * context whose thread cannot be spawned runs inline here, so recovery
+ * degrades to serial rather than failing.
+ */
+static void
+diskfs_recover_spawn(
+    struct diskfs_recover_threads *th,
+    uint32_t                       n,
+    void *(*fn)(void *),
+    void                          *ctxs,
+    size_t                         stride)
+{
+    uint32_t t;
+
+    th->n       = n;
+    th->threads = calloc(n, sizeof(*th->threads));
+    th->started = calloc(n, sizeof(*th->started));
+    chimera_diskfs_abort_if(!th->threads || !th->started,
+                            "failed to allocate recovery threads");
+
+    for (t = 0; t < n; t++) {
+        void *arg = (char *) ctxs + t * stride;
+
+        if (n > 1 && pthread_create(&th->threads[t], NULL, fn, arg) == 0) {
+            th->started[t] = 1;
+        } else {
+            fn(arg);
+        }
+    }
+} /* diskfs_recover_spawn */
+
+
+static void
+diskfs_recover_join(struct diskfs_recover_threads *th)
+{
+    uint32_t t;
+
+    for (t = 0; t < th->n; t++) {
+        if (th->started[t]) {
+            pthread_join(th->threads[t], NULL);
+        }
+    }
+
+    free(th->started);
+    free(th->threads);
+} /* diskfs_recover_join */
+
+
+/* Run fn over n contexts, one thread each, and wait for all of them. */
+static void
+diskfs_recover_parallel(
+    uint32_t n,
+    void *(*fn)(void *),
+    void    *ctxs,
+    size_t   stride)
+{
+    struct diskfs_recover_threads th;
+
+    diskfs_recover_spawn(&th, n, fn, ctxs, stride);
+    diskfs_recover_join(&th);
+} /* diskfs_recover_parallel */
+
+
+/*
+ * Read [offset, offset + size) of the log region with up to
+ * DISKFS_RECOVER_IO_DEPTH requests of DISKFS_RECOVER_READ_CHUNK (or the device
+ * max, if smaller) in flight, rather than one request at a time.
+ */
+static int
+diskfs_recover_read_log(
+    struct diskfs_mount_io *io,
+    char                   *buf,
+    uint64_t                offset,
+    uint64_t                size)
+{
+    struct diskfs_mount_io_read reads[DISKFS_RECOVER_IO_DEPTH];
+    uint64_t                    chunk = DISKFS_RECOVER_READ_CHUNK;
+    uint64_t                    maxreq, o = 0;
+    uint32_t                    n;
+
+    maxreq = io->shared->devices[SM_INTENT_LOG_DEVICE].max_request_size &
+        ~((uint64_t) DISKFS_BLOCK_SIZE - 1);
+    if (maxreq == 0) {
+        return -1;
+    }
+    if (chunk > maxreq) {
+        chunk = maxreq;
+    }
+
+    while (o < size) {
+        for (n = 0; n < DISKFS_RECOVER_IO_DEPTH && o < size; n++) {
+            reads[n].device_id = SM_INTENT_LOG_DEVICE;
+            reads[n].buf       = buf + o;
+            reads[n].length    = size - o < chunk ? size - o : chunk;
+            reads[n].offset    = SM_INTENT_LOG_OFFSET + offset + o;
+            o                 += reads[n].length;
+        }
+        if (diskfs_mount_io_read_many(io, reads, n) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+} /* diskfs_recover_read_log */
+
+
+/*
+ * Check whether an intact redo record starts at offset `o` of a log window
+ * (or of a spilled record's own buffer): the magic, a reclen matching the
+ * shape its block headers imply, the header-region hash, and every full
+ * image's hash.  The window is shared by every scan thread and never written;
+ * the header hash is computed over a copy of the header with its csum fields
+ * zeroed.
+ *
+ * With `legacy` set (the log may predate SM_LOG_INCOMPAT_REDO_BLOCK_CSUM), a
+ * record whose header hash instead covers the whole record -- header region
+ * and every image, the per-image hashes left unset -- is accepted too.
+ */
+static int
+diskfs_recover_verify(
+    const char *log,
+    uint64_t    log_size,
+    uint64_t    o,
+    int         legacy,
+    uint64_t   *hdr_len)
+{
+    const struct diskfs_redo_header       *hdr = (const struct diskfs_redo_header *) (log + o);
+    const struct diskfs_redo_block_header *bh;
+    struct diskfs_redo_header              tmp;
+    uint64_t                               delta_bytes = 0;
+    uint32_t                               b, nfull = 0;
+    XXH3_state_t                           state;
+    XXH128_hash_t                          h;
+
+    if (hdr->magic != DISKFS_REDO_MAGIC) {
+        return 0;
+    }
+
+    /* Size the record from its block headers before trusting them: the
+     * header array must fit, and the region it implies must match reclen
+     * exactly. */
+    if (hdr->reclen < sizeof(*hdr) ||
+        (hdr->reclen & (DISKFS_BLOCK_SIZE - 1)) ||
+        o + hdr->reclen > log_size ||
+        sizeof(*hdr) + (uint64_t) hdr->num_blocks * sizeof(*bh) > hdr->reclen) {
+        return 0;
+    }
+
+    bh = (const struct diskfs_redo_block_header *) (log + o + sizeof(*hdr));
+    for (b = 0; b < hdr->num_blocks; b++) {
+        if (bh[b].delta_len) {
+            delta_bytes += bh[b].delta_len;
+        } else {
+            nfull++;
+        }
+    }
+    *hdr_len = diskfs_il_hdr_len(hdr->num_blocks, delta_bytes);
+    if (hdr->reclen != *hdr_len + (uint64_t) nfull * DISKFS_BLOCK_SIZE) {
+        return 0;
+    }
+
+    tmp         = *hdr;
+    tmp.csum_lo = 0;
+    tmp.csum_hi = 0;
+    XXH3_128bits_reset(&state);
+    XXH3_128bits_update(&state, &tmp, sizeof(tmp));
+    XXH3_128bits_update(&state, log + o + sizeof(tmp), *hdr_len - sizeof(tmp));
+    h = XXH3_128bits_digest(&state);
+    if (h.low64 == hdr->csum_lo && h.high64 == hdr->csum_hi) {
+        /* Full images come first in the block-header array, in image order. */
+        for (b = 0; b < nfull; b++) {
+            if (bh[b].delta_len) {
+                return 0;
+            }
+            h = XXH3_128bits(log + o + *hdr_len + (size_t) b * DISKFS_BLOCK_SIZE,
+                             DISKFS_BLOCK_SIZE);
+            if (h.low64 != bh[b].block_csum_lo || h.high64 != bh[b].block_csum_hi) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+
+    /* Whole-record layout: never carried deltas. */
+    if (!legacy || nfull != hdr->num_blocks) {
+        return 0;
+    }
+    XXH3_128bits_update(&state, log + o + *hdr_len, hdr->reclen - *hdr_len);
+    h = XXH3_128bits_digest(&state);
+    return h.low64 == hdr->csum_lo && h.high64 == hdr->csum_hi;
+} /* diskfs_recover_verify */
+
+
+/*
+ * Probe this thread's slice of the current window.  A record that starts in
+ * the window but runs past its end (and not past the log's) is left for
+ * diskfs_recover_spills to read whole once the step is over.
+ */
+static void
+diskfs_recover_scan_window(struct diskfs_recover_scan *scan)
+{
+    struct diskfs_recover_ctx *ctx = scan->ctx;
+    const char                *buf = ctx->scan_buf;
+    uint32_t                   gen = ctx->step & 1;
+    uint64_t                   o, hdr_len;
+
+    scan->nrec[gen] = 0;
+
+    for (o = scan->start; o < scan->end &&
+         o + sizeof(struct diskfs_redo_header) <= ctx->scan_len;
+         o += DISKFS_BLOCK_SIZE) {
+        const struct diskfs_redo_header *hdr = (const struct diskfs_redo_header *) (buf + o);
+
+        if (hdr->magic != DISKFS_REDO_MAGIC) {
+            continue;
+        }
+
+        if (hdr->reclen >= sizeof(*hdr) &&
+            !(hdr->reclen & (DISKFS_BLOCK_SIZE - 1)) &&
+            o + hdr->reclen > ctx->scan_len &&
+            ctx->scan_base + o + hdr->reclen <= ctx->log_size) {
+            if (scan->nspill == scan->spill_cap) {
+                scan->spill_cap = scan->spill_cap ? scan->spill_cap * 2 : 16;
+                scan->spill     = realloc(scan->spill, scan->spill_cap * sizeof(*scan->spill));
+                chimera_diskfs_abort_if(!scan->spill, "failed to grow recovery spill list");
+            }
+            scan->spill[scan->nspill++] = ctx->scan_base + o;
+            continue;
+        }
+
+        if (!diskfs_recover_verify(buf, ctx->scan_len, o, ctx->legacy, &hdr_len)) {
+            continue;
+        }
+
+        if (scan->nrec[gen] == scan->cap[gen]) {
+            scan->cap[gen]  = scan->cap[gen] ? scan->cap[gen] * 2 : 256;
+            scan->recs[gen] = realloc(scan->recs[gen], scan->cap[gen] * sizeof(*scan->recs[gen]));
+            chimera_diskfs_abort_if(!scan->recs[gen], "failed to grow recovery record list");
+        }
+        scan->recs[gen][scan->nrec[gen]].seq     = hdr->seq;
+        scan->recs[gen][scan->nrec[gen]].offset  = o;
+        scan->recs[gen][scan->nrec[gen]].hdr_len = hdr_len;
+        scan->nrec[gen]++;
+        scan->records++;
+        scan->nblocks += hdr->num_blocks;
+        if (hdr->seq + 1 > scan->next_seq) {
+            scan->next_seq = hdr->seq + 1;
+        }
+    }
+} /* diskfs_recover_scan_window */
+
+
+/* Log order of two block entries: record seq, then position in the record. */
+static inline int
+diskfs_recover_newer(
+    uint64_t seq,
+    uint32_t index,
+    uint64_t than_seq,
+    uint32_t than_index)
+{
+    return seq > than_seq || (seq == than_seq && index > than_index);
+} /* diskfs_recover_newer */
+
+
+/* Find or insert a home block's entry in its partition. */
+static struct diskfs_recover_write *
+diskfs_recover_slot(
+    struct diskfs_recover_part *part,
+    uint32_t                    device_id,
+    uint64_t                    device_offset)
+{
+    struct diskfs_recover_slot *slot;
+    uint64_t                    key;
+    uint32_t                    b, i;
+
+    key = (device_offset / DISKFS_BLOCK_SIZE) ^ ((uint64_t) device_id << 52);
+
+    if (part->hash) {
+        b = (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> (64 - part->hash_bits));
+        for (i = part->hash[b]; i != UINT32_MAX; i = part->slots[i].next) {
+            if (part->slots[i].write.device_id == device_id &&
+                part->slots[i].write.device_offset == device_offset) {
+                return &part->slots[i].write;
+            }
+        }
+    }
+
+    if (part->nslots == part->cap) {
+        part->cap   = part->cap ? part->cap * 2 : 1024;
+        part->slots = realloc(part->slots, part->cap * sizeof(*part->slots));
+        chimera_diskfs_abort_if(!part->slots, "failed to grow recovery replay set");
+    }
+
+    /* Keep the load at or below one entry per bucket. */
+    if (part->nslots >= (part->hash ? 1U << part->hash_bits : 0)) {
+        part->hash_bits = part->hash ? part->hash_bits + 1 : 10;
+        free(part->hash);
+        part->hash = malloc(sizeof(*part->hash) << part->hash_bits);
+        chimera_diskfs_abort_if(!part->hash, "failed to grow recovery replay hash");
+        memset(part->hash, 0xff, sizeof(*part->hash) << part->hash_bits);
+        for (i = 0; i < part->nslots; i++) {
+            struct diskfs_recover_write *w = &part->slots[i].write;
+            uint64_t                     k;
+
+            k                  = (w->device_offset / DISKFS_BLOCK_SIZE) ^
+                ((uint64_t) w->device_id << 52);
+            b                  = (uint32_t) ((k * 0x9E3779B97F4A7C15ULL) >> (64 - part->hash_bits));
+            part->slots[i].next = part->hash[b];
+            part->hash[b]       = i;
+        }
+    }
+
+    b    = (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> (64 - part->hash_bits));
+    slot = &part->slots[part->nslots];
+    memset(slot, 0, sizeof(*slot));
+    slot->write.device_id     = device_id;
+    slot->write.device_offset = device_offset;
+    slot->next                = part->hash[b];
+    part->hash[b]             = part->nslots++;
+    return &slot->write;
+} /* diskfs_recover_slot */
+
+
+/*
+ * Fold one block entry into the replay set, copying what can still matter
+ * out of the window: the newest full image of the block, and the deltas newer
+ * than it.  Windows arrive in log order, not seq order (the log wraps), so an
+ * image may land after deltas it supersedes.
+ */
+static void
+diskfs_recover_add(
+    struct diskfs_recover_part *part,
+    uint32_t                    device_id,
+    uint64_t                    device_offset,
+    uint64_t                    seq,
+    uint32_t                    index,
+    uint32_t                    delta_len,
+    const char                 *src)
+{
+    struct diskfs_recover_write *w = diskfs_recover_slot(part, device_id, device_offset);
+    struct diskfs_recover_delta *d;
+    uint32_t                     i, n;
+
+    if (w->has_image && !diskfs_recover_newer(seq, index, w->seq, w->index)) {
+        return;
+    }
+
+    if (!delta_len) {
+        if (!w->buf) {
+            w->buf = malloc(DISKFS_BLOCK_SIZE);
+            chimera_diskfs_abort_if(!w->buf, "failed to allocate recovery block");
+        }
+        memcpy(w->buf, src, DISKFS_BLOCK_SIZE);
+        w->has_image = 1;
+        w->seq       = seq;
+        w->index     = index;
+
+        for (i = 0, n = 0; i < w->ndeltas; i++) {
+            if (diskfs_recover_newer(w->deltas[i].seq, w->deltas[i].index, seq, index)) {
+                w->deltas[n++] = w->deltas[i];
+            } else {
+                free(w->deltas[i].data);
+            }
+        }
+        w->ndeltas = n;
+        return;
+    }
+
+    if (w->ndeltas == w->delta_cap) {
+        w->delta_cap = w->delta_cap ? w->delta_cap * 2 : 4;
+        w->deltas    = realloc(w->deltas, w->delta_cap * sizeof(*w->deltas));
+        chimera_diskfs_abort_if(!w->deltas, "failed to grow recovery delta list");
+    }
+    d        = &w->deltas[w->ndeltas++];
+    d->seq   = seq;
+    d->index = index;
+    d->len   = delta_len;
+    d->data  = malloc(delta_len);
+    chimera_diskfs_abort_if(!d->data, "failed to allocate recovery delta");
+    memcpy(d->data, src, delta_len);
+} /* diskfs_recover_add */
+
+
+/*
+ * Fold the blocks of one intact record into the replay set: those hashing to
+ * partition `part_id`, or every block when it is UINT32_MAX.
+ */
+static void
+diskfs_recover_gather(
+    struct diskfs_recover_ctx *ctx,
+    uint32_t                   part_id,
+    const char                *rec,
+    uint64_t                   hdr_len)
+{
+    const struct diskfs_redo_header       *hdr = (const struct diskfs_redo_header *) rec;
+    const struct diskfs_redo_block_header *bh  =
+        (const struct diskfs_redo_block_header *) (rec + sizeof(*hdr));
+    const char                            *delta = (const char *) (bh + hdr->num_blocks);
+    const char                            *image = rec + hdr_len;
+    const char                            *src;
+    uint32_t                               b, p;
+
+    for (b = 0; b < hdr->num_blocks; b++) {
+        if (bh[b].delta_len) {
+            src    = delta;
+            delta += bh[b].delta_len;
+        } else {
+            src    = image;
+            image += DISKFS_BLOCK_SIZE;
+        }
+
+        if (bh[b].device_id >= (uint32_t) ctx->shared->num_devices) {
+            continue;
+        }
+
+        p = diskfs_block_bucket(bh[b].device_id, bh[b].device_offset) % ctx->nthreads;
+        if (part_id != UINT32_MAX && p != part_id) {
+            continue;
+        }
+
+        diskfs_recover_add(&ctx->parts[p], bh[b].device_id, bh[b].device_offset,
+                           hdr->seq, b, bh[b].delta_len, src);
+    }
+} /* diskfs_recover_gather */
+
+
+/*
+ * One thread's share of a pipeline step: fold the records the previous step
+ * found into this thread's partition, then probe its slice of the current
+ * window.  Both only read window buffers the main thread is not filling.
+ */
+static void *
+diskfs_recover_worker(void *arg)
+{
+    struct diskfs_recover_scan *scan = arg;
+    struct diskfs_recover_ctx  *ctx  = scan->ctx;
+    struct diskfs_recover_scan *s;
+    uint32_t                    gen = (ctx->step - 1) & 1;
+    uint32_t                    t, i;
+
+    if (ctx->gather_buf && ctx->replay) {
+        for (t = 0; t < ctx->nthreads; t++) {
+            s = &ctx->scans[t];
+            for (i = 0; i < s->nrec[gen]; i++) {
+                diskfs_recover_gather(ctx, scan->id,
+                                      ctx->gather_buf + s->recs[gen][i].offset,
+                                      s->recs[gen][i].hdr_len);
+            }
+        }
+    }
+
+    if (ctx->scan_buf) {
+        diskfs_recover_scan_window(scan);
+    }
+    return NULL;
+} /* diskfs_recover_worker */
+
+
+/*
+ * Records the last scan found running past its window: read each one whole
+ * into its own buffer, verify it there and fold it in.  At most a handful per
+ * window (one live record, plus any stale ones whose magic survived), so this
+ * runs serially once the step's threads are done.
+ */
+static int
+diskfs_recover_spills(
+    struct diskfs_recover_ctx *ctx,
+    struct diskfs_mount_io    *io,
+    const char                *window)
+{
+    struct diskfs_recover_scan      *scan;
+    const struct diskfs_redo_header *hdr;
+    uint64_t                         hdr_len;
+    uint32_t                         t, i;
+    char                            *rec;
+
+    for (t = 0; t < ctx->nthreads; t++) {
+        scan = &ctx->scans[t];
+        for (i = 0; i < scan->nspill; i++) {
+            hdr = (const struct diskfs_redo_header *) (window + (scan->spill[i] - ctx->scan_base));
+            rec = malloc(hdr->reclen);
+            chimera_diskfs_abort_if(!rec, "failed to allocate recovery record");
+
+            if (diskfs_recover_read_log(io, rec, scan->spill[i], hdr->reclen) != 0) {
+                free(rec);
+                return -1;
+            }
+            if (diskfs_recover_verify(rec, hdr->reclen, 0, ctx->legacy, &hdr_len)) {
+                hdr = (const struct diskfs_redo_header *) rec;
+                scan->records++;
+                scan->nblocks += hdr->num_blocks;
+                if (hdr->seq + 1 > scan->next_seq) {
+                    scan->next_seq = hdr->seq + 1;
+                }
+                if (ctx->replay) {
+                    diskfs_recover_gather(ctx, UINT32_MAX, rec, hdr_len);
+                }
+            }
+            free(rec);
+        }
+        scan->nspill = 0;
+    }
+    return 0;
+} /* diskfs_recover_spills */
+
+
+/* Order a block's deltas by log order. */
+static int
+diskfs_recover_delta_cmp(
+    const void *a,
+    const void *b)
+{
+    const struct diskfs_recover_delta *x = a, *y = b;
+
+    if (x->seq != y->seq) {
+        return (x->seq > y->seq) - (x->seq < y->seq);
+    }
+    return (x->index > y->index) - (x->index < y->index);
+} /* diskfs_recover_delta_cmp */
+
+
+/*
+ * Apply a redo delta payload to a block image.  The payload passed the record
+ * hash, but its extents are still bounds-checked: a bad one aborts rather than
+ * scribbling past the image.
+ */
+static void
+diskfs_recover_apply_delta(
+    char       *img,
+    const char *delta,
+    uint32_t    len)
+{
+    struct diskfs_redo_delta ext;
+    uint32_t                 pos = 0;
+
+    while (pos < len) {
+        chimera_diskfs_abort_if(len - pos < sizeof(ext), "truncated redo delta extent");
+        memcpy(&ext, delta + pos, sizeof(ext));
+        pos += sizeof(ext);
+
+        chimera_diskfs_abort_if(ext.length > len - pos ||
+                                (uint32_t) ext.offset + ext.length > DISKFS_BLOCK_SIZE,
+                                "redo delta extent out of range");
+        memcpy(img + ext.offset, delta + pos, ext.length);
+        pos += ext.length;
+    }
+} /* diskfs_recover_apply_delta */
+
+
+/*
+ * Settle one partition's replay set: apply each block's surviving deltas, in
+ * log order, to its newest full image.  A block with no full image left in the
+ * log keeps its deltas for the caller to apply to the home copy once it has
+ * been read.
+ */
+static void *
+diskfs_recover_build_worker(void *arg)
+{
+    struct diskfs_recover_part  *part = arg;
+    struct diskfs_recover_write *w;
+    uint32_t                     i, d;
+
+    for (i = 0; i < part->nslots; i++) {
+        w = &part->slots[i].write;
+
+        if (w->ndeltas > 1) {
+            qsort(w->deltas, w->ndeltas, sizeof(*w->deltas), diskfs_recover_delta_cmp);
+        }
+
+        if (!w->has_image) {
+            w->buf = malloc(DISKFS_BLOCK_SIZE);
+            chimera_diskfs_abort_if(!w->buf, "failed to allocate recovery block");
+            continue;
+        }
+
+        for (d = 0; d < w->ndeltas; d++) {
+            diskfs_recover_apply_delta(w->buf, w->deltas[d].data, w->deltas[d].len);
+            free(w->deltas[d].data);
+        }
+        w->ndeltas = 0;
+    }
+    return NULL;
+} /* diskfs_recover_build_worker */
+
+
+static void
+diskfs_recover_report(
+    struct diskfs_shared *shared,
+    const uint64_t       *values)
+{
+    struct diskfs_metrics *m = &shared->metrics;
+    int                    i;
+
+    if (!m->metrics) {
+        return;
+    }
+
+    for (i = 0; i < DISKFS_METRIC_RECOVERY_NUM; i++) {
+        diskfs_metric_gauge_set(
+            prometheus_gauge_series_create_instance(m->recovery_series[i]),
+            (int64_t) values[i]);
+    }
+} /* diskfs_recover_report */
+
+
+/*
+ * Crash recovery: the previous instance did not unmount cleanly, so
+ * logged-but-not-yet-pushed redo records may still sit in the intent log while
+ * their home locations hold stale data.  Sweep the log for intact records --
+ * a 4 KiB-aligned magic whose header and image hashes verify (rejecting
+ * torn/partially-overwritten records) -- and write the latest image of every
+ * logged block home, then flush.  After this the on-disk b+tree / inodes /
+ * data are consistent with the last acknowledged write, exactly as the
+ * tail-pusher would have left them.
+ *
+ * Replaying every intact record (rather than just [tail, head]) is safe: in a
+ * FIFO circular log a superseding record outlives every record it supersedes,
+ * so the last entry of a block in seq order is its latest image.  Runs at
+ * mount before worker threads exist, so it drives the devices through the
+ * mount-time evpl pump; the CPU-bound work runs on recovery_threads threads.
+ *
+ * The log is never held whole.  It goes by in recovery_window windows, three
+ * buffers deep: while this thread reads window i + 1, every recovery
+ * thread probes its slice of window i and folds the records window i - 1
+ * yielded into its own hash partition of the logged home blocks, copying out
+ * only each block's newest full image and the deltas newer than it.  Memory
+ * is the three windows plus the replay set, which is bounded by the distinct
+ * blocks logged rather than by the log size.
+ *
+ * A block whose surviving entries are all deltas is replayed read-modify-
+ * write against home, which holds either an image older than the first of
+ * them (its record was pushed before being overwritten) or one the pusher
+ * wrote from a later one.  Either way the result is the latest image: a delta
+ * carries the absolute post-image of every byte it changed, and the bytes it
+ * left alone already match.
+ *
+ * Records from every commit stream share the one region and one sequence, so
+ * the seq order is also the cross-stream merge.  `log_incompat` is the
+ * superblock's record-format mask: without SM_LOG_INCOMPAT_REDO_BLOCK_CSUM
+ * the log may hold whole-record-checksum records from an older build.  `next_seq` returns one past
+ * the highest seq found, so the new session never reuses a seq still on the
+ * log (a later crash would otherwise replay these older images last).  With
+ * `replay` clear the sweep stops there: a clean mount uses that to find where
+ * the sequence must resume when the superblock cannot say (SM_SB_LOG_SEQ).
+ */
+int
+diskfs_recover_log(
+    struct diskfs_shared   *shared,
+    struct diskfs_mount_io *io,
+    uint64_t                log_incompat,
+    int                     replay,
+    uint64_t               *next_seq)
+{
+    uint64_t                      log_size = shared->intent_log_size;
+    uint64_t                      values[DISKFS_METRIC_RECOVERY_NUM] = { 0 };
+    uint64_t                      t0, t1, tr, slice, window, base, len, nblocks = 0;
+    struct diskfs_recover_ctx     ctx;
+    struct diskfs_recover_threads th;
+    struct diskfs_recover_part   *parts;
+    struct diskfs_recover_write  *w;
+    struct sm_io_write            writes[DISKFS_RECOVER_IO_DEPTH];
+    struct diskfs_mount_io_read   reads[DISKFS_RECOVER_IO_DEPTH];
+    struct diskfs_recover_write  *pending[DISKFS_RECOVER_IO_DEPTH];
+    uint32_t                      nthreads, nwin, step, i, t, b, n, nw;
+    uint64_t                      nrec = 0;
+    char                         *bufs[3] = { NULL, NULL, NULL };
+    int                           rc      = 0;
+    long                          ncpu;
+
+    nthreads = shared->recovery_threads;
+    if (nthreads == 0) {
+        ncpu     = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = ncpu > 0 ? (uint32_t) ncpu : 1;
+    }
+    if (nthreads > DISKFS_RECOVER_MAX_THREADS) {
+        nthreads = DISKFS_RECOVER_MAX_THREADS;
+    }
+
+    t0 = diskfs_recover_now_ns();
+
+    window = log_size < shared->recovery_window ? log_size : shared->recovery_window;
+    nwin   = (uint32_t) ((log_size + window - 1) / window);
+    for (i = 0; i < 3 && i < nwin; i++) {
+        bufs[i] = malloc(window);
+        chimera_diskfs_abort_if(!bufs[i], "failed to allocate %lu-byte recovery window", window);
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.shared   = shared;
+    ctx.log_size = log_size;
+    ctx.legacy   = !(log_incompat & SM_LOG_INCOMPAT_REDO_BLOCK_CSUM);
+    ctx.replay   = replay;
+    ctx.nthreads = nthreads;
+    ctx.scans    = calloc(nthreads, sizeof(*ctx.scans));
+    ctx.parts    = calloc(nthreads, sizeof(*ctx.parts));
+    chimera_diskfs_abort_if(!ctx.scans || !ctx.parts, "failed to allocate recovery state");
+    parts = ctx.parts;
+
+    for (t = 0; t < nthreads; t++) {
+        ctx.scans[t].ctx = &ctx;
+        ctx.scans[t].id  = t;
+    }
+
+    values[DISKFS_METRIC_RECOVERY_LOG_BYTES] = log_size;
+    values[DISKFS_METRIC_RECOVERY_THREADS]   = nthreads;
+
+    /* Prime the pipeline with the first window. */
+    tr = diskfs_recover_now_ns();
+    if (diskfs_recover_read_log(io, bufs[0], 0, window) != 0) {
+        rc = -1;
+        goto out;
+    }
+    values[DISKFS_METRIC_RECOVERY_READ_NS] += diskfs_recover_now_ns() - tr;
+
+    /* Step i: scan window i and gather window i - 1 on the recovery threads,
+     * read window i + 1 here.  One step past the last window drains the
+     * final gather. */
+    for (step = 0; step <= nwin; step++) {
+        base = (uint64_t) step * window;
+        len  = step < nwin ? (log_size - base < window ? log_size - base : window) : 0;
+
+        ctx.step       = step;
+        ctx.scan_buf   = step < nwin ? bufs[step % 3] : NULL;
+        ctx.scan_base  = base;
+        ctx.scan_len   = len;
+        ctx.gather_buf = step > 0 ? bufs[(step - 1) % 3] : NULL;
+
+        slice = (len / DISKFS_BLOCK_SIZE + nthreads - 1) / nthreads * DISKFS_BLOCK_SIZE;
+        for (t = 0; t < nthreads; t++) {
+            ctx.scans[t].start = (uint64_t) t * slice;
+            ctx.scans[t].end   = ctx.scans[t].start + slice;
+        }
+
+        diskfs_recover_spawn(&th, nthreads, diskfs_recover_worker, ctx.scans, sizeof(*ctx.scans));
+
+        if (step + 1 < nwin) {
+            base += window;
+            tr    = diskfs_recover_now_ns();
+            rc    = diskfs_recover_read_log(io, bufs[(step + 1) % 3], base,
+                                            log_size - base < window ? log_size - base : window);
+            values[DISKFS_METRIC_RECOVERY_READ_NS] += diskfs_recover_now_ns() - tr;
+        }
+
+        diskfs_recover_join(&th);
+
+        if (rc == 0 && ctx.scan_buf) {
+            rc = diskfs_recover_spills(&ctx, io, ctx.scan_buf);
+        }
+        if (rc != 0) {
+            goto out;
+        }
+    }
+
+    for (i = 0; i < 3; i++) {
+        free(bufs[i]);
+        bufs[i] = NULL;
+    }
+
+    *next_seq = 0;
+    for (t = 0; t < nthreads; t++) {
+        nrec    += ctx.scans[t].records;
+        nblocks += ctx.scans[t].nblocks;
+        if (ctx.scans[t].next_seq > *next_seq) {
+            *next_seq = ctx.scans[t].next_seq;
+        }
+    }
+
+    if (!replay) {
+        chimera_diskfs_info("intent log: %lu stale records, redo sequence resumes at %lu",
+                            nrec, *next_seq);
+        goto out;
+    }
+
+    values[DISKFS_METRIC_RECOVERY_RECORDS] = nrec;
+    values[DISKFS_METRIC_RECOVERY_BLOCKS]  = nblocks;
+    values[DISKFS_METRIC_RECOVERY_SCAN_NS] = diskfs_recover_now_ns() - t0;
+    t1                                     = diskfs_recover_now_ns();
+
+    diskfs_recover_parallel(nthreads, diskfs_recover_build_worker, parts, sizeof(*parts));
+
+    values[DISKFS_METRIC_RECOVERY_BUILD_NS] = diskfs_recover_now_ns() - t1;
+    t1                                      = diskfs_recover_now_ns();
+
+    /* Replay: read home for delta-only blocks, then write every block, each
+     * DISKFS_RECOVER_IO_DEPTH at a time. */
+    for (t = 0; t < nthreads; t++) {
+        i = 0;
+        while (i < parts[t].nslots) {
+            for (n = 0; n < DISKFS_RECOVER_IO_DEPTH && i < parts[t].nslots; i++) {
+                w = &parts[t].slots[i].write;
+                if (!w->ndeltas) {
+                    continue;
+                }
+                reads[n].device_id = w->device_id;
+                reads[n].buf       = w->buf;
+                reads[n].length    = DISKFS_BLOCK_SIZE;
+                reads[n].offset    = w->device_offset;
+                pending[n++]       = w;
+            }
+            chimera_diskfs_abort_if(diskfs_mount_io_read_many(io, reads, n) != 0,
+                                    "recovery delta read failed");
+            values[DISKFS_METRIC_RECOVERY_HOME_READS] += n;
+
+            for (nw = 0; nw < n; nw++) {
+                w = pending[nw];
+                for (b = 0; b < w->ndeltas; b++) {
+                    diskfs_recover_apply_delta(w->buf, w->deltas[b].data, w->deltas[b].len);
+                    free(w->deltas[b].data);
+                }
+                w->ndeltas = 0;
+            }
+        }
+
+        for (i = 0; i < parts[t].nslots; i += nw) {
+            for (nw = 0; nw < DISKFS_RECOVER_IO_DEPTH && i + nw < parts[t].nslots; nw++) {
+                w                    = &parts[t].slots[i + nw].write;
+                writes[nw].device_id = w->device_id;
+                writes[nw].buf       = w->buf;
+                writes[nw].length    = DISKFS_BLOCK_SIZE;
+                writes[nw].offset    = w->device_offset;
+            }
+            chimera_diskfs_abort_if(diskfs_mount_io_write_many(io, writes, nw) != 0,
+                                    "recovery replay write failed");
+        }
+        values[DISKFS_METRIC_RECOVERY_HOME_WRITES] += parts[t].nslots;
+    }
+
+    for (i = 0; i < (uint32_t) shared->num_devices; i++) {
+        diskfs_mount_io_flush(io, i);
+    }
+
+    values[DISKFS_METRIC_RECOVERY_REPLAY_NS] = diskfs_recover_now_ns() - t1;
+    t0                                       = diskfs_recover_now_ns() - t0;
+    values[DISKFS_METRIC_RECOVERY_TOTAL_NS]  = t0;
+    diskfs_recover_report(shared, values);
+
+    chimera_diskfs_info("crash recovery: replayed %lu intact intent-log records "
+                        "(%lu blocks -> %lu home writes, %lu home reads) on %u threads "
+                        "in %lu ms (read %lu, scan %lu, build %lu, replay %lu)",
+                        nrec, nblocks,
+                        values[DISKFS_METRIC_RECOVERY_HOME_WRITES],
+                        values[DISKFS_METRIC_RECOVERY_HOME_READS], nthreads,
+                        t0 / 1000000,
+                        values[DISKFS_METRIC_RECOVERY_READ_NS] / 1000000,
+                        values[DISKFS_METRIC_RECOVERY_SCAN_NS] / 1000000,
+                        values[DISKFS_METRIC_RECOVERY_BUILD_NS] / 1000000,
+                        values[DISKFS_METRIC_RECOVERY_REPLAY_NS] / 1000000);
+
+ out:
+    for (t = 0; t < nthreads; t++) {
+        free(ctx.scans[t].recs[0]);
+        free(ctx.scans[t].recs[1]);
+        free(ctx.scans[t].spill);
+
+        for (i = 0; i < parts[t].nslots; i++) {
+            w = &parts[t].slots[i].write;
+            for (b = 0; b < w->ndeltas; b++) {
+                free(w->deltas[b].data);
+            }
+            free(w->deltas);
+            free(w->buf);
+        }
+        free(parts[t].slots);
+        free(parts[t].hash);
+    }
+    free(ctx.scans);
+    free(parts);
+    for (i = 0; i < 3; i++) {
+        free(bufs[i]);
+    }
+    return rc;
+} /* diskfs_recover_log */
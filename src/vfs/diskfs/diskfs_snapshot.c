@@ -0,0 +1,1362 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Snapshots: the per-AG extent reference counts (taking references at
+ * commit, turning a free of a shared block into a decrement, and the check
+ * the write path makes before overwriting in place), and the job that
+ * creates a read-only snapshot by cloning the live tree under the snapshot
+ * directory (see the design note in diskfs_internal.h).  The reference
+ * passes run on the committing worker; creation runs on reclaim worker 0,
+ * one transaction per step.
+ */
+
+#include "diskfs_internal.h"
+
+/* Forward declarations (definitions below, in call-graph order) */
+
+static void
+diskfs_snapshot_run(
+    struct diskfs_snapshot *sn);
+
+static void
+diskfs_snapshot_step(
+    struct diskfs_snapshot_op *op);
+
+static void
+diskfs_snapshot_check_dir_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_snapshot_check_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv);
+
+static void
+diskfs_snapshot_root_src_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_snapshot_root_alloc_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_snapshot_copy_src_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_snapshot_copy_dst_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_snapshot_copy_next(
+    struct diskfs_snapshot_op *op);
+
+static void
+diskfs_snapshot_found_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv);
+
+static void
+diskfs_snapshot_child_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_snapshot_clone_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_snapshot_insert(
+    struct diskfs_snapshot_op *op);
+
+static void
+diskfs_snapshot_inserted_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv);
+
+static void
+diskfs_snapshot_batch_end(
+    struct diskfs_snapshot_op *op,
+    int                        done);
+
+static void
+diskfs_snapshot_publish_dir_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv);
+
+static void
+diskfs_snapshot_published_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv);
+
+static void
+diskfs_snapshot_committed_cb(
+    struct diskfs_txn *txn,
+    int                status,
+    void              *priv);
+
+static void
+diskfs_snapshot_yield(
+    struct diskfs_snapshot_op *op);
+
+static void
+diskfs_snapshot_fail(
+    struct diskfs_snapshot_op *op,
+    const char                *why);
+
+static void
+diskfs_snapshot_finish(
+    struct diskfs_snapshot_op *op);
+
+
+const char *diskfs_snapshot_counter_names[DISKFS_METRIC_SNAP_NUM] = {
+    "created",
+    "inodes",
+    "extents",
+    "bytes_shared",
+    "errors",
+};
+
+
+/* Blocks from device_offset to the end of its AG. */
+static inline uint64_t
+diskfs_ref_ag_left(uint64_t device_offset)
+{
+    uint64_t ag_end = ((device_offset >> SM_AG_SIZE_LOG2) + 1) << SM_AG_SIZE_LOG2;
+
+    return (ag_end - device_offset) >> SM_BLOCK_SHIFT;
+} /* diskfs_ref_ag_left */
+
+
+static inline pthread_mutex_t *
+diskfs_ref_lock(
+    struct diskfs_shared *shared,
+    uint32_t              device_id,
+    uint64_t              table_offset)
+{
+    return &shared->ref_lock[((table_offset >> SM_BLOCK_SHIFT) + device_id) %
+                             DISKFS_REF_LOCKS];
+} /* diskfs_ref_lock */
+
+
+/*
+ * Note that the txn adds one reference to every block of the `length` bytes
+ * at device_offset (an extent record a snapshot now shares).  Applied by the
+ * txn's commit.
+ */
+void
+diskfs_ref_note(
+    struct diskfs_thread *thread,
+    struct diskfs_txn    *txn,
+    uint32_t              device_id,
+    uint64_t              device_offset,
+    uint64_t              length)
+{
+    struct diskfs_txn_ref *r;
+    uint64_t               start, end;
+
+    if (!thread->shared->snapshots || !txn || !length) {
+        return;
+    }
+
+    start = device_offset & ~(uint64_t) SM_BLOCK_MASK;
+    end   = SM_ALIGN_UP(device_offset + length);
+
+    r = malloc(sizeof(*r));
+    chimera_diskfs_abort_if(!r, "failed to allocate an extent reference");
+    r->device_id     = device_id;
+    r->device_offset = start;
+    r->nblocks       = (uint32_t) ((end - start) >> SM_BLOCK_SHIFT);
+    r->done          = 0;
+
+    r->next           = txn->pending_refs;
+    txn->pending_refs = r;
+} /* diskfs_ref_note */
+
+
+/* Pin a table block into the txn, once (as diskfs_csum_txn_add). */
+static void
+diskfs_ref_txn_add(
+    struct diskfs_thread *thread,
+    struct diskfs_txn    *txn,
+    struct diskfs_block  *blk)
+{
+    struct diskfs_txn_block *tb;
+
+    for (tb = txn->blocks; tb; tb = tb->next) {
+        if (tb->block == blk) {
+            diskfs_block_release(thread, blk);
+            return;
+        }
+    }
+
+    diskfs_txn_add_block(txn, blk);
+
+    /* Shared by every txn touching the AG: always a full image. */
+    txn->blocks->journal = 1;
+} /* diskfs_ref_txn_add */
+
+
+/*
+ * Apply one noted reference, a table block at a time.  A count that reaches
+ * UINT16_MAX stays there: the block is never freed again (leaked, never
+ * reused while still referenced).  Resumable through r->done.
+ */
+static int
+diskfs_ref_take(
+    struct diskfs_thread     *thread,
+    struct diskfs_txn        *txn,
+    struct diskfs_commit_ctx *cctx,
+    struct diskfs_txn_ref    *r)
+{
+    struct diskfs_shared *shared = thread->shared;
+    struct sm_ref_block  *tbl;
+    struct diskfs_block  *blk;
+    pthread_mutex_t      *lock;
+    uint64_t              off, table_offset, n;
+    uint32_t              slot, i;
+
+    while (r->done < r->nblocks) {
+        off = r->device_offset + ((uint64_t) r->done << SM_BLOCK_SHIFT);
+        n   = diskfs_ref_ag_left(off);
+        if (n > r->nblocks - r->done) {
+            n = r->nblocks - r->done;
+        }
+
+        if (sm_ref_locate(shared->space_map, r->device_id, off, &table_offset, &slot) != 0) {
+            r->done += (uint32_t) n;
+            continue;
+        }
+        if (n > SM_REF_PER_BLOCK - slot) {
+            n = SM_REF_PER_BLOCK - slot;
+        }
+
+        lock = diskfs_ref_lock(shared, r->device_id, table_offset);
+        chimera_mutex_lock(lock, "diskfs_ref");
+
+        blk = diskfs_block_claim_async(thread, r->device_id, table_offset, 0,
+                                       diskfs_commit_resume, cctx);
+        if (!blk) {
+            pthread_mutex_unlock(lock);
+            return SM_AGAIN;
+        }
+
+        tbl = blk->iov.data;
+        if (tbl->stamp != shared->fsid) {
+            memset(tbl, 0, DISKFS_BLOCK_SIZE);
+            tbl->stamp = shared->fsid;
+        }
+        for (i = 0; i < n; i++) {
+            if (tbl->ref[slot + i] < UINT16_MAX) {
+                tbl->ref[slot + i]++;
+            }
+        }
+
+        pthread_mutex_unlock(lock);
+        diskfs_ref_txn_add(thread, txn, blk);
+
+        r->done += (uint32_t) n;
+    }
+
+    return 0;
+} /* diskfs_ref_take */
+
+
+/* Queue a free of `nblocks` blocks at device_offset right behind `f`, already
+ * through the reference pass. */
+static void
+diskfs_ref_emit(
+    struct diskfs_txn_free *f,
+    uint64_t                device_offset,
+    uint64_t                nblocks)
+{
+    struct diskfs_txn_free *e;
+
+    if (!nblocks) {
+        return;
+    }
+
+    e = malloc(sizeof(*e));
+    chimera_diskfs_abort_if(!e, "failed to allocate a pending free");
+    e->device_id     = f->device_id;
+    e->device_offset = device_offset;
+    e->length        = nblocks << SM_BLOCK_SHIFT;
+    e->journaled     = 0;
+    e->cleared       = 0;
+    e->refchecked    = 1;
+    e->ref_split     = 0;
+    e->ref_done      = 0;
+    e->next          = f->next;
+    f->next          = e;
+} /* diskfs_ref_emit */
+
+
+/*
+ * Run one pending free through the reference counts: a block still
+ * referenced elsewhere is decremented and kept.  The first kept block splits
+ * the free: what was examined before it is queued on its own, and from then
+ * on each run of unreferenced blocks is.  Resumable through f->ref_done.
+ */
+static int
+diskfs_ref_free(
+    struct diskfs_thread     *thread,
+    struct diskfs_txn        *txn,
+    struct diskfs_commit_ctx *cctx,
+    struct diskfs_txn_free   *f)
+{
+    struct diskfs_shared *shared  = thread->shared;
+    uint64_t              nblocks = f->length >> SM_BLOCK_SHIFT;
+    uint8_t               kept[SM_REF_PER_BLOCK];
+    struct sm_ref_block  *tbl;
+    struct diskfs_block  *blk;
+    pthread_mutex_t      *lock;
+    uint64_t              off, table_offset, n, i, run;
+    uint32_t              slot;
+    int                   dirty;
+
+    while (f->ref_done < nblocks) {
+        off = f->device_offset + (f->ref_done << SM_BLOCK_SHIFT);
+        n   = diskfs_ref_ag_left(off);
+        if (n > nblocks - f->ref_done) {
+            n = nblocks - f->ref_done;
+        }
+
+        if (sm_ref_locate(shared->space_map, f->device_id, off, &table_offset, &slot) != 0) {
+            if (f->ref_split) {
+                diskfs_ref_emit(f, off, n);
+            }
+            f->ref_done += n;
+            continue;
+        }
+        if (n > SM_REF_PER_BLOCK - slot) {
+            n = SM_REF_PER_BLOCK - slot;
+        }
+
+        lock = diskfs_ref_lock(shared, f->device_id, table_offset);
+        chimera_mutex_lock(lock, "diskfs_ref");
+
+        blk = diskfs_block_claim_async(thread, f->device_id, table_offset, 0,
+                                       diskfs_commit_resume, cctx);
+        if (!blk) {
+            pthread_mutex_unlock(lock);
+            return SM_AGAIN;
+        }
+
+        tbl   = blk->iov.data;
+        dirty = 0;
+        if (tbl->stamp != shared->fsid) {
+            memset(kept, 0, n);
+        } else {
+            for (i = 0; i < n; i++) {
+                kept[i] = tbl->ref[slot + i] != 0;
+                if (kept[i] && tbl->ref[slot + i] < UINT16_MAX) {
+                    tbl->ref[slot + i]--;
+                    dirty = 1;
+                }
+            }
+        }
+
+        pthread_mutex_unlock(lock);
+
+        if (dirty) {
+            diskfs_ref_txn_add(thread, txn, blk);
+        } else {
+            diskfs_block_release(thread, blk);
+        }
+
+        for (i = 0; i < n; i = run) {
+            for (run = i; run < n && kept[run] == kept[i]; run++) {
+            }
+            if (kept[i]) {
+                if (!f->ref_split) {
+                    f->ref_split = 1;
+                    diskfs_ref_emit(f, f->device_offset, f->ref_done + i);
+                }
+            } else if (f->ref_split) {
+                diskfs_ref_emit(f, off + (i << SM_BLOCK_SHIFT), run - i);
+            }
+        }
+
+        f->ref_done += n;
+    }
+
+    return 0;
+} /* diskfs_ref_free */
+
+
+/*
+ * The commit's first pre-pass: take the references the txn noted, then
+ * settle its frees against the counts, so the FREE deltas journaled next
+ * (and the checksum entries cleared) cover only blocks nothing else uses.
+ * A split free is replaced by its pieces.  Suspendable like
+ * diskfs_csum_flush; progress lives on the txn.
+ */
+int
+diskfs_ref_flush(
+    struct diskfs_thread     *thread,
+    struct diskfs_txn        *txn,
+    struct diskfs_commit_ctx *cctx)
+{
+    struct diskfs_txn_free **pp, *f;
+    struct diskfs_txn_ref   *r;
+
+    if (!thread->shared->snapshots) {
+        return 0;
+    }
+
+    while ((r = txn->pending_refs)) {
+        if (diskfs_ref_take(thread, txn, cctx, r) == SM_AGAIN) {
+            return SM_AGAIN;
+        }
+        txn->pending_refs = r->next;
+        free(r);
+    }
+
+    pp = &txn->pending_frees;
+    while ((f = *pp)) {
+        if (f->refchecked) {
+            pp = &f->next;
+            continue;
+        }
+
+        /* Data extents are freed in whole blocks; anything else is
+         * metadata, never shared. */
+        if (((f->device_offset | f->length) & SM_BLOCK_MASK) == 0 &&
+            diskfs_ref_free(thread, txn, cctx, f) == SM_AGAIN) {
+            return SM_AGAIN;
+        }
+
+        if (f->ref_split) {
+            *pp = f->next;
+            free(f);
+        } else {
+            f->refchecked = 1;
+            pp            = &f->next;
+        }
+    }
+
+    return 0;
+} /* diskfs_ref_flush */
+
+
+/* Drop an aborted txn's references: the records taking them never commit. */
+void
+diskfs_ref_discard(struct diskfs_txn *txn)
+{
+    struct diskfs_txn_ref *r, *n;
+
+    for (r = txn->pending_refs; r; r = n) {
+        n = r->next;
+        free(r);
+    }
+    txn->pending_refs = NULL;
+} /* diskfs_ref_discard */
+
+
+/*
+ * Is any block of the `length` bytes at device_offset referenced more than
+ * once?  Returns 1 or 0, or SM_AGAIN if a table block is loading
+ * (resume(thread, arg) runs once it lands; the check restarts from the top).
+ */
+int
+diskfs_ref_shared(
+    struct diskfs_thread *thread,
+    uint32_t device_id,
+    uint64_t device_offset,
+    uint64_t length,
+    void ( *resume )(struct diskfs_thread *, void *),
+    void *arg)
+{
+    struct diskfs_shared      *shared = thread->shared;
+    const struct sm_ref_block *tbl;
+    struct diskfs_block       *blk;
+    pthread_mutex_t           *lock;
+    uint64_t                   start, nblocks, off, table_offset, n, b = 0;
+    uint32_t                   slot, i;
+    int                        shared_blk = 0;
+
+    start   = device_offset & ~(uint64_t) SM_BLOCK_MASK;
+    nblocks = (SM_ALIGN_UP(device_offset + length) - start) >> SM_BLOCK_SHIFT;
+
+    while (b < nblocks && !shared_blk) {
+        off = start + (b << SM_BLOCK_SHIFT);
+        n   = diskfs_ref_ag_left(off);
+        if (n > nblocks - b) {
+            n = nblocks - b;
+        }
+
+        if (sm_ref_locate(shared->space_map, device_id, off, &table_offset, &slot) != 0) {
+            b += n;
+            continue;
+        }
+        if (n > SM_REF_PER_BLOCK - slot) {
+            n = SM_REF_PER_BLOCK - slot;
+        }
+
+        blk = diskfs_block_get_async(thread, device_id, table_offset, resume, arg);
+        if (!blk) {
+            return SM_AGAIN;
+        }
+
+        lock = diskfs_ref_lock(shared, device_id, table_offset);
+        chimera_mutex_lock(lock, "diskfs_ref");
+        tbl = blk->iov.data;
+        if (tbl->stamp == shared->fsid) {
+            for (i = 0; i < n && !shared_blk; i++) {
+                shared_blk = tbl->ref[slot + i] != 0;
+            }
+        }
+        pthread_mutex_unlock(lock);
+        diskfs_block_release(thread, blk);
+
+        b += n;
+    }
+
+    return shared_blk;
+} /* diskfs_ref_shared */
+
+
+static inline void
+diskfs_snapshot_count(
+    struct diskfs_snapshot    *sn,
+    struct diskfs_thread      *thread,
+    enum diskfs_metric_snap_op op,
+    uint64_t                   n)
+{
+    chimera_job_counter_add(&sn->job, op, n);
+    diskfs_metric_snap(thread, op, n);
+} /* diskfs_snapshot_count */
+
+
+static void
+diskfs_snapshot_tick(
+    struct evpl       *evpl,
+    struct evpl_timer *timer)
+{
+    struct diskfs_snapshot *sn = container_of(timer, struct diskfs_snapshot, timer);
+
+    (void) evpl;
+
+    diskfs_snapshot_run(sn);
+} /* diskfs_snapshot_tick */
+
+
+static struct diskfs_snapshot_op *
+diskfs_snapshot_op_new(struct diskfs_snapshot *sn)
+{
+    struct diskfs_snapshot_op *op = calloc(1, sizeof(*op));
+    struct timespec            now;
+    struct tm                  tm;
+
+    chimera_diskfs_abort_if(!op, "failed to allocate a snapshot creation");
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    gmtime_r(&now.tv_sec, &tm);
+
+    op->sn        = sn;
+    op->thread    = sn->worker->ctx;
+    op->phase     = DISKFS_SNAP_PHASE_CHECK;
+    op->name_len  = (uint32_t) strftime(op->name, sizeof(op->name),
+                                        "@GMT-%Y.%m.%d-%H.%M.%S", &tm);
+    op->name_hash = chimera_vfs_hash(op->name, op->name_len);
+    return op;
+} /* diskfs_snapshot_op_new */
+
+
+static void
+diskfs_snapshot_op_free(struct diskfs_snapshot_op *op)
+{
+    struct diskfs_snap_item *item;
+    struct diskfs_snap_link *link;
+    int                      i;
+
+    while ((item = op->head)) {
+        op->head = item->next;
+        free(item);
+    }
+    for (i = 0; i < DISKFS_SNAP_LINK_BUCKETS; i++) {
+        while ((link = op->links[i])) {
+            op->links[i] = link->next;
+            free(link);
+        }
+    }
+    free(op);
+} /* diskfs_snapshot_op_free */
+
+
+/*
+ * Drive the creation in flight one step at a time, or start one if asked.
+ * Steps that complete synchronously park and come back round this loop
+ * rather than recursing.
+ */
+static void
+diskfs_snapshot_run(struct diskfs_snapshot *sn)
+{
+    struct diskfs_snapshot_op *op;
+
+    sn->in_run = 1;
+
+    while (!sn->stopping) {
+        op = sn->op;
+
+        if (op) {
+            if (!op->parked) {
+                break;                  /* step in flight */
+            }
+            op->parked = 0;
+            diskfs_snapshot_step(op);
+            continue;
+        }
+
+        if (!__atomic_exchange_n(&sn->kick, 0, __ATOMIC_RELAXED)) {
+            break;
+        }
+
+        sn->op = diskfs_snapshot_op_new(sn);
+        diskfs_snapshot_step(sn->op);
+    }
+
+    sn->in_run = 0;
+    __atomic_store_n(&sn->job.running, sn->op != NULL, __ATOMIC_RELAXED);
+} /* diskfs_snapshot_run */
+
+
+/* Copy a live inode's attributes onto its clone (parent fields excepted). */
+static void
+diskfs_snapshot_clone_attrs(
+    struct diskfs_inode       *dst,
+    const struct diskfs_inode *src)
+{
+    dst->mode           = src->mode;
+    dst->nlink          = src->nlink;
+    dst->uid            = src->uid;
+    dst->gid            = src->gid;
+    dst->rdev           = src->rdev;
+    dst->size           = src->size;
+    dst->space_used     = src->space_used;
+    dst->atime_sec      = src->atime_sec;
+    dst->atime_nsec     = src->atime_nsec;
+    dst->mtime_sec      = src->mtime_sec;
+    dst->mtime_nsec     = src->mtime_nsec;
+    dst->ctime_sec      = src->ctime_sec;
+    dst->ctime_nsec     = src->ctime_nsec;
+    dst->btime_sec      = src->btime_sec;
+    dst->btime_nsec     = src->btime_nsec;
+    dst->dos_attributes = src->dos_attributes;
+    dst->extsize        = src->extsize;
+    dst->flags          = DISKFS_INODE_F_SNAPSHOT;
+} /* diskfs_snapshot_clone_attrs */
+
+
+static void
+diskfs_snapshot_enqueue(
+    struct diskfs_snapshot_op *op,
+    const struct diskfs_inode *src,
+    const struct diskfs_inode *dst)
+{
+    struct diskfs_snap_item *item = calloc(1, sizeof(*item));
+
+    chimera_diskfs_abort_if(!item, "failed to allocate a snapshot work item");
+    item->src_inum = src->inum;
+    item->src_gen  = src->gen;
+    item->dst_inum = dst->inum;
+    item->dst_gen  = dst->gen;
+
+    if (op->tail) {
+        op->tail->next = item;
+    } else {
+        op->head = item;
+    }
+    op->tail = item;
+
+    diskfs_snapshot_count(op->sn, op->thread, DISKFS_METRIC_SNAP_INODES, 1);
+} /* diskfs_snapshot_enqueue */
+
+
+static struct diskfs_snap_link *
+diskfs_snapshot_link_find(
+    struct diskfs_snapshot_op *op,
+    uint64_t                   src_inum)
+{
+    struct diskfs_snap_link *link;
+
+    for (link = op->links[src_inum % DISKFS_SNAP_LINK_BUCKETS]; link; link = link->next) {
+        if (link->src_inum == src_inum) {
+            return link;
+        }
+    }
+    return NULL;
+} /* diskfs_snapshot_link_find */
+
+
+static void
+diskfs_snapshot_link_add(
+    struct diskfs_snapshot_op *op,
+    const struct diskfs_inode *src,
+    const struct diskfs_inode *dst)
+{
+    struct diskfs_snap_link *link   = malloc(sizeof(*link));
+    uint32_t                 bucket = src->inum % DISKFS_SNAP_LINK_BUCKETS;
+
+    chimera_diskfs_abort_if(!link, "failed to allocate a snapshot link");
+    link->src_inum    = src->inum;
+    link->dst_inum    = dst->inum;
+    link->dst_gen     = dst->gen;
+    link->next        = op->links[bucket];
+    op->links[bucket] = link;
+} /* diskfs_snapshot_link_add */
+
+
+static void
+diskfs_snapshot_step(struct diskfs_snapshot_op *op)
+{
+    struct diskfs_thread    *thread = op->thread;
+    struct diskfs_shared    *shared = thread->shared;
+    struct diskfs_snap_item *item;
+
+    switch (op->phase) {
+        case DISKFS_SNAP_PHASE_CHECK:
+            op->txn = diskfs_txn_begin(thread, DISKFS_TXN_READ);
+            diskfs_inode_acquire(thread, op->txn, DISKFS_SNAP_INUM, DISKFS_SNAP_GEN,
+                                 DISKFS_INODE_LOCK_READ, diskfs_snapshot_check_dir_cb, op);
+            break;
+        case DISKFS_SNAP_PHASE_ROOT:
+            op->txn = diskfs_txn_begin(thread, DISKFS_TXN_WRITE);
+            diskfs_inode_acquire(thread, op->txn, shared->root_inum, shared->root_gen,
+                                 DISKFS_INODE_LOCK_READ, diskfs_snapshot_root_src_cb, op);
+            break;
+        case DISKFS_SNAP_PHASE_COPY:
+            item = op->head;
+            if (!item) {
+                op->phase = DISKFS_SNAP_PHASE_PUBLISH;
+                diskfs_snapshot_step(op);
+                break;
+            }
+            op->txn    = diskfs_txn_begin(thread, DISKFS_TXN_WRITE);
+            op->copied = 0;
+            diskfs_inode_acquire(thread, op->txn, item->src_inum, item->src_gen,
+                                 DISKFS_INODE_LOCK_READ, diskfs_snapshot_copy_src_cb, op);
+            break;
+        case DISKFS_SNAP_PHASE_PUBLISH:
+            op->txn = diskfs_txn_begin(thread, DISKFS_TXN_WRITE);
+            diskfs_inode_acquire(thread, op->txn, DISKFS_SNAP_INUM, DISKFS_SNAP_GEN,
+                                 DISKFS_INODE_LOCK_WRITE, diskfs_snapshot_publish_dir_cb, op);
+            break;
+    } /* switch */
+} /* diskfs_snapshot_step */
+
+
+static void
+diskfs_snapshot_check_dir_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op = priv;
+    struct diskfs_bt_op       *bop;
+
+    if (status != CHIMERA_VFS_OK) {
+        diskfs_snapshot_fail(op, "snapshot directory missing");
+        return;
+    }
+
+    op->dir = inode;
+
+    bop = diskfs_bt_op_alloc(op->thread);
+    if (diskfs_dir_lookup_async(bop, op->thread, inode, op->name_hash, op->rec,
+                                sizeof(op->rec), diskfs_snapshot_check_cb, op)) {
+        diskfs_snapshot_check_cb(bop, bop->result, op);
+    }
+} /* diskfs_snapshot_check_dir_cb */
+
+
+static void
+diskfs_snapshot_check_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op = priv;
+
+    diskfs_bt_op_free(op->thread, bop);
+
+    if (result >= 0) {
+        diskfs_snapshot_fail(op, "name already taken");
+        return;
+    }
+
+    diskfs_txn_abort(op->txn);
+    op->txn   = NULL;
+    op->dir   = NULL;
+    op->phase = DISKFS_SNAP_PHASE_ROOT;
+    diskfs_snapshot_yield(op);
+} /* diskfs_snapshot_check_cb */
+
+
+static void
+diskfs_snapshot_root_src_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op = priv;
+
+    if (status != CHIMERA_VFS_OK) {
+        diskfs_snapshot_fail(op, "root inode unavailable");
+        return;
+    }
+
+    op->src = inode;
+
+    /* A snapshot is a new subtree: let it land on any device. */
+    diskfs_inode_alloc_async(op->thread, op->txn, 0, diskfs_snapshot_root_alloc_cb, op);
+} /* diskfs_snapshot_root_src_cb */
+
+
+static void
+diskfs_snapshot_root_alloc_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op = priv;
+
+    if (status != CHIMERA_VFS_OK) {
+        diskfs_snapshot_fail(op, "out of space");
+        return;
+    }
+
+    diskfs_snapshot_clone_attrs(inode, op->src);
+    inode->parent_inum = DISKFS_SNAP_INUM;
+    inode->parent_gen  = DISKFS_SNAP_GEN;
+
+    op->root_inum = inode->inum;
+    op->root_gen  = inode->gen;
+    diskfs_snapshot_enqueue(op, op->src, inode);
+
+    op->src   = NULL;
+    op->phase = DISKFS_SNAP_PHASE_COPY;
+    diskfs_txn_commit(op->txn, diskfs_snapshot_committed_cb, op);
+} /* diskfs_snapshot_root_alloc_cb */
+
+
+static void
+diskfs_snapshot_copy_src_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op   = priv;
+    struct diskfs_snap_item   *item = op->head;
+
+    /* Removed since it was reached: the clone keeps what was copied. */
+    if (status != CHIMERA_VFS_OK) {
+        diskfs_txn_abort(op->txn);
+        op->txn  = NULL;
+        op->head = item->next;
+        if (!op->head) {
+            op->tail = NULL;
+        }
+        free(item);
+        diskfs_snapshot_yield(op);
+        return;
+    }
+
+    op->src = inode;
+    diskfs_inode_acquire(op->thread, op->txn, item->dst_inum, item->dst_gen,
+                         DISKFS_INODE_LOCK_WRITE, diskfs_snapshot_copy_dst_cb, op);
+} /* diskfs_snapshot_copy_src_cb */
+
+
+static void
+diskfs_snapshot_copy_dst_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op = priv;
+
+    if (status != CHIMERA_VFS_OK) {
+        diskfs_snapshot_fail(op, "clone inode unavailable");
+        return;
+    }
+
+    op->dst = inode;
+    diskfs_snapshot_copy_next(op);
+} /* diskfs_snapshot_copy_dst_cb */
+
+
+/* Step the current item's cursor past the record in hand. */
+static void
+diskfs_snapshot_advance(struct diskfs_snapshot_op *op)
+{
+    struct diskfs_snap_item *item = op->head;
+
+    item->cursor = op->key;
+    if (++item->cursor.subkey == 0) {
+        item->cursor.type++;
+    }
+} /* diskfs_snapshot_advance */
+
+
+static void
+diskfs_snapshot_copy_next(struct diskfs_snapshot_op *op)
+{
+    struct diskfs_bt_op *bop;
+
+    if (op->copied >= DISKFS_SNAP_BATCH) {
+        diskfs_snapshot_batch_end(op, 0);
+        return;
+    }
+
+    bop = diskfs_bt_op_alloc(op->thread);
+    if (diskfs_bt_lookup_async(bop, op->thread, op->src, DISKFS_BT_OP_LOOKUP_GE,
+                               &op->head->cursor, &op->key, op->rec, sizeof(op->rec),
+                               diskfs_snapshot_found_cb, op)) {
+        diskfs_snapshot_found_cb(bop, bop->result, op);
+    }
+} /* diskfs_snapshot_copy_next */
+
+
+static void
+diskfs_snapshot_found_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op     = priv;
+    struct diskfs_thread      *thread = op->thread;
+    struct diskfs_inode       *dst    = op->dst;
+    struct diskfs_dirent_rec  *d      = (struct diskfs_dirent_rec *) op->rec;
+    struct diskfs_extent_rec  *x      = (struct diskfs_extent_rec *) op->rec;
+    struct diskfs_snap_link   *link;
+    uint64_t                   table_offset, phys;
+    uint32_t                   slot;
+
+    diskfs_bt_op_free(thread, bop);
+
+    if (result < 0) {
+        diskfs_snapshot_batch_end(op, 1);
+        return;
+    }
+    if ((uint32_t) result > sizeof(op->rec)) {
+        diskfs_snapshot_fail(op, "record too large");
+        return;
+    }
+    op->rec_len = (uint32_t) result;
+
+    switch (op->key.type) {
+        case DISKFS_REC_DIRENT:
+            /* A further link to a file already cloned. */
+            link = diskfs_snapshot_link_find(op, d->inum);
+            if (link) {
+                d->inum = link->dst_inum;
+                d->gen  = link->dst_gen;
+                break;
+            }
+            /* The child and its clone take two more slots. */
+            if (op->txn->num_inodes + 2 > DISKFS_TXN_MAX_INODES) {
+                diskfs_snapshot_batch_end(op, 0);
+                return;
+            }
+            op->child_inum = d->inum;
+            op->child_gen  = d->gen;
+            diskfs_inode_acquire(thread, op->txn, d->inum, d->gen,
+                                 DISKFS_INODE_LOCK_READ, diskfs_snapshot_child_cb, op);
+            return;
+        case DISKFS_REC_EXTENT:
+            /* Sharing needs a count to take: a device without reference
+             * tables (a remote one) cannot be snapshotted. */
+            if (sm_ref_locate(thread->shared->space_map, x->device_id, x->device_offset,
+                              &table_offset, &slot) != 0) {
+                diskfs_snapshot_fail(op, "extent on a device without reference counts");
+                return;
+            }
+            phys = diskfs_ext_phys_len(x->length, x->flags);
+            diskfs_ref_note(thread, op->txn, x->device_id, x->device_offset, phys);
+            diskfs_snapshot_count(op->sn, thread, DISKFS_METRIC_SNAP_EXTENTS, 1);
+            diskfs_snapshot_count(op->sn, thread, DISKFS_METRIC_SNAP_BYTES_SHARED, phys);
+            break;
+        case DISKFS_REC_INLINE:
+            free(dst->inline_data);
+            dst->inline_data = malloc(op->rec_len ? op->rec_len : 1);
+            memcpy(dst->inline_data, op->rec, op->rec_len);
+            dst->inline_len = op->rec_len;
+            break;
+        case DISKFS_REC_ACL:
+            diskfs_acl_serial_install(dst, op->rec, (int) op->rec_len);
+            break;
+        case DISKFS_REC_PNFS:
+            free(dst->pnfs_blob);
+            dst->pnfs_blob = malloc(op->rec_len ? op->rec_len : 1);
+            memcpy(dst->pnfs_blob, op->rec, op->rec_len);
+            dst->pnfs_blob_len = op->rec_len;
+            break;
+        case DISKFS_REC_SYMLINK:
+        case DISKFS_REC_XATTR:
+            break;
+        default:
+            diskfs_snapshot_advance(op);
+            diskfs_snapshot_copy_next(op);
+            return;
+    } /* switch */
+
+    diskfs_snapshot_insert(op);
+} /* diskfs_snapshot_found_cb */
+
+
+static void
+diskfs_snapshot_child_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op = priv;
+
+    /* Unlinked under us: leave it out. */
+    if (status != CHIMERA_VFS_OK) {
+        diskfs_snapshot_advance(op);
+        diskfs_snapshot_copy_next(op);
+        return;
+    }
+
+    op->child = inode;
+    diskfs_inode_alloc_async(op->thread, op->txn, op->dst->inum,
+                             diskfs_snapshot_clone_cb, op);
+} /* diskfs_snapshot_child_cb */
+
+
+static void
+diskfs_snapshot_clone_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op    = priv;
+    struct diskfs_inode       *child = op->child;
+    struct diskfs_dirent_rec  *d     = (struct diskfs_dirent_rec *) op->rec;
+
+    if (status != CHIMERA_VFS_OK) {
+        diskfs_snapshot_fail(op, "out of space");
+        return;
+    }
+
+    diskfs_snapshot_clone_attrs(inode, child);
+    if (S_ISDIR(child->mode)) {
+        inode->parent_inum = op->dst->inum;
+        inode->parent_gen  = op->dst->gen;
+    } else if (child->nlink > 1) {
+        diskfs_snapshot_link_add(op, child, inode);
+    }
+    diskfs_snapshot_enqueue(op, child, inode);
+
+    diskfs_txn_unlock_inode(op->txn, child);
+    op->child = NULL;
+
+    d->inum = inode->inum;
+    d->gen  = inode->gen;
+    diskfs_snapshot_insert(op);
+} /* diskfs_snapshot_clone_cb */
+
+
+/* Insert the record in hand into the clone. */
+static void
+diskfs_snapshot_insert(struct diskfs_snapshot_op *op)
+{
+    struct diskfs_bt_op *bop = diskfs_bt_op_alloc(op->thread);
+
+    if (diskfs_bt_insert_async(bop, op->thread, op->txn, op->dst, &op->key, op->rec,
+                               op->rec_len, diskfs_snapshot_inserted_cb, op)) {
+        diskfs_snapshot_inserted_cb(bop, bop->result, op);
+    }
+} /* diskfs_snapshot_insert */
+
+
+static void
+diskfs_snapshot_inserted_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op = priv;
+
+    diskfs_bt_op_free(op->thread, bop);
+
+    if (result < 0) {
+        diskfs_snapshot_fail(op, "out of space");
+        return;
+    }
+
+    diskfs_snapshot_advance(op);
+    op->copied++;
+    diskfs_snapshot_copy_next(op);
+} /* diskfs_snapshot_inserted_cb */
+
+
+/* Close the batch: bring the clone's attributes up to date with what was
+ * copied and, once the live inode has no more records, drop the item. */
+static void
+diskfs_snapshot_batch_end(
+    struct diskfs_snapshot_op *op,
+    int                        done)
+{
+    struct diskfs_snap_item *item = op->head;
+
+    diskfs_snapshot_clone_attrs(op->dst, op->src);
+
+    if (done) {
+        op->head = item->next;
+        if (!op->head) {
+            op->tail = NULL;
+        }
+        free(item);
+    }
+
+    op->src = NULL;
+    op->dst = NULL;
+    diskfs_txn_commit(op->txn, diskfs_snapshot_committed_cb, op);
+} /* diskfs_snapshot_batch_end */
+
+
+static void
+diskfs_snapshot_publish_dir_cb(
+    struct diskfs_inode *inode,
+    int                  status,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op  = priv;
+    struct diskfs_dirent_rec  *d   = (struct diskfs_dirent_rec *) op->rec;
+    struct diskfs_bt_key       key = { .type = DISKFS_REC_DIRENT, .subkey = op->name_hash };
+    struct diskfs_bt_op       *bop;
+
+    if (status != CHIMERA_VFS_OK) {
+        diskfs_snapshot_fail(op, "snapshot directory missing");
+        return;
+    }
+
+    op->dir = inode;
+
+    d->inum     = op->root_inum;
+    d->gen      = op->root_gen;
+    d->name_len = (uint16_t) op->name_len;
+    memcpy(d->name, op->name, op->name_len);
+
+    bop = diskfs_bt_op_alloc(op->thread);
+    if (diskfs_bt_insert_async(bop, op->thread, op->txn, inode, &key, op->rec,
+                               sizeof(*d) + op->name_len,
+                               diskfs_snapshot_published_cb, op)) {
+        diskfs_snapshot_published_cb(bop, bop->result, op);
+    }
+} /* diskfs_snapshot_publish_dir_cb */
+
+
+static void
+diskfs_snapshot_published_cb(
+    struct diskfs_bt_op *bop,
+    int                  result,
+    void                *priv)
+{
+    struct diskfs_snapshot_op *op  = priv;
+    struct diskfs_inode       *dir = op->dir;
+    struct timespec            now;
+
+    diskfs_bt_op_free(op->thread, bop);
+
+    if (result < 0) {
+        diskfs_snapshot_fail(op, "out of space");
+        return;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    dir->nlink++;
+    dir->mtime_sec  = now.tv_sec;
+    dir->mtime_nsec = now.tv_nsec;
+    dir->ctime_sec  = now.tv_sec;
+    dir->ctime_nsec = now.tv_nsec;
+
+    op->dir   = NULL;
+    op->phase = DISKFS_SNAP_PHASE_DONE;
+    diskfs_txn_commit(op->txn, diskfs_snapshot_committed_cb, op);
+} /* diskfs_snapshot_published_cb */
+
+
+static void
+diskfs_snapshot_committed_cb(
+    struct diskfs_txn *txn,
+    int                status,
+    void              *priv)
+{
+    struct diskfs_snapshot_op *op = priv;
+
+    (void) txn;
+
+    op->txn = NULL;
+
+    if (status != 0) {
+        diskfs_snapshot_fail(op, "commit failed");
+        return;
+    }
+
+    if (op->phase == DISKFS_SNAP_PHASE_DONE) {
+        diskfs_snapshot_count(op->sn, op->thread, DISKFS_METRIC_SNAP_CREATED, 1);
+        chimera_diskfs_info("Snapshot %s created", op->name);
+        diskfs_snapshot_finish(op);
+        return;
+    }
+
+    diskfs_snapshot_yield(op);
+} /* diskfs_snapshot_committed_cb */
+
+
+/* Between steps (no txn, no lock): continue now or on a later tick. */
+static void
+diskfs_snapshot_yield(struct diskfs_snapshot_op *op)
+{
+    op->parked = 1;
+    if (!op->sn->in_run) {
+        diskfs_snapshot_run(op->sn);
+    }
+} /* diskfs_snapshot_yield */
+
+
+/* Abandon the creation.  The clones made so far stay allocated, unreachable
+ * from the snapshot directory. */
+static void
+diskfs_snapshot_fail(
+    struct diskfs_snapshot_op *op,
+    const char                *why)
+{
+    if (op->txn) {
+        diskfs_txn_abort(op->txn);
+        op->txn = NULL;
+    }
+    diskfs_snapshot_count(op->sn, op->thread, DISKFS_METRIC_SNAP_ERRORS, 1);
+    chimera_diskfs_error("Snapshot %s not created: %s", op->name, why);
+    diskfs_snapshot_finish(op);
+} /* diskfs_snapshot_fail */
+
+
+static void
+diskfs_snapshot_finish(struct diskfs_snapshot_op *op)
+{
+    struct diskfs_snapshot *sn = op->sn;
+
+    sn->op = NULL;
+    diskfs_snapshot_op_free(op);
+
+    if (!sn->in_run) {
+        diskfs_snapshot_run(sn);
+    }
+} /* diskfs_snapshot_finish */
+
+
+/* chimera_job ops: called from the REST thread under the registry lock.
+ * Snapshots are taken on demand only, so the job has no background schedule
+ * or I/O budget to steer: it leaves set_enabled and set_rate unset. */
+static void
+diskfs_snapshot_job_start(struct chimera_job *job)
+{
+    struct diskfs_snapshot *sn = job->private_data;
+
+    __atomic_store_n(&sn->kick, 1, __ATOMIC_RELAXED);
+} /* diskfs_snapshot_job_start */
+
+
+static const struct chimera_job_ops diskfs_snapshot_job_ops = {
+    .start = diskfs_snapshot_job_start,
+};
+
+
+void
+diskfs_snapshot_create(struct diskfs_shared *shared)
+{
+    struct diskfs_snapshot *sn;
+    int                     i;
+
+    if (!shared->snapshots) {
+        return;
+    }
+
+    sn         = calloc(1, sizeof(*sn));
+    sn->shared = shared;
+
+    snprintf(sn->job.name, sizeof(sn->job.name), "diskfs_snapshot");
+    sn->job.ops          = &diskfs_snapshot_job_ops;
+    sn->job.private_data = sn;
+    sn->job.ncounters    = DISKFS_METRIC_SNAP_NUM;
+    for (i = 0; i < DISKFS_METRIC_SNAP_NUM; i++) {
+        sn->job.counter_names[i] = diskfs_snapshot_counter_names[i];
+    }
+    chimera_job_register(&sn->job);
+
+    shared->snapshot = sn;
+} /* diskfs_snapshot_create */
+
+
+void
+diskfs_snapshot_destroy(struct diskfs_shared *shared)
+{
+    struct diskfs_snapshot *sn = shared->snapshot;
+
+    if (!sn) {
+        return;
+    }
+    chimera_job_unregister(&sn->job);
+    free(sn);
+    shared->snapshot = NULL;
+} /* diskfs_snapshot_destroy */
+
+
+void
+diskfs_snapshot_thread_init(struct diskfs_reclaim_worker *w)
+{
+    struct diskfs_snapshot *sn = w->shared->snapshot;
+
+    evpl_add_timer(w->ctx->evpl, &sn->timer, diskfs_snapshot_tick,
+                   DISKFS_SNAP_TICK_US);
+    sn->armed = 1;
+} /* diskfs_snapshot_thread_init */
+
+
+/* Let the step in flight commit, then drop the creation: the clones it made
+ * stay allocated and unreachable. */
+void
+diskfs_snapshot_thread_shutdown(struct diskfs_reclaim_worker *w)
+{
+    struct diskfs_snapshot *sn = w->shared->snapshot;
+
+    sn->stopping = 1;
+    while (sn->op && !sn->op->parked) {
+        evpl_continue(w->ctx->evpl);
+    }
+    if (sn->op) {
+        diskfs_snapshot_op_free(sn->op);
+        sn->op = NULL;
+    }
+
+    if (sn->armed) {
+        evpl_remove_timer(w->ctx->evpl, &sn->timer);
+        sn->armed = 0;
+    }
+    __atomic_store_n(&sn->job.running, 0, __ATOMIC_RELAXED);
+} /* diskfs_snapshot_thread_shutdown */
@@ -14,6 +14,7 @@
 
 #include "common/rbtree.h"
 #include "common/logging.h"
+#include "common/checksum.h"
 
 #include "space_map.h"
 
@@ -197,6 +198,63 @@ sm_extent_new(
     return ext;
 } /* sm_extent_new */
 
+/*
+ * Every free extent is indexed twice: by offset, for coalescing on free and
+ * for carving a specific range, and by size, so allocation finds the smallest
+ * extent that fits in O(log n) rather than walking the holes of a fragmented
+ * AG in offset order.  The size key packs the length above the AG-relative
+ * offset, which keeps keys unique (the rb-tree rejects duplicates) and breaks
+ * ties between equal-sized holes towards the lowest offset.
+ */
+static inline uint64_t
+sm_size_key(
+    uint64_t offset,
+    uint64_t length)
+{
+    return (length << SM_AG_SIZE_LOG2) | (offset & SM_AG_OFFSET_MASK);
+} /* sm_size_key */
+
+/* Link `ext` into both of `ag`'s free indexes.  Caller holds ag->lock. */
+static void
+sm_ag_ext_insert(
+    struct sm_ag     *ag,
+    struct sm_extent *ext)
+{
+    ext->by_size.key = sm_size_key(ext->offset, ext->length);
+    rb_tree_insert(&ag->free_by_offset, offset, ext);
+    rb_tree_insert(&ag->free_by_size, key, &ext->by_size);
+} /* sm_ag_ext_insert */
+
+/* Unlink `ext` from both of `ag`'s free indexes.  Caller holds ag->lock. */
+static void
+sm_ag_ext_remove(
+    struct sm_ag     *ag,
+    struct sm_extent *ext)
+{
+    rb_tree_remove(&ag->free_by_offset, &ext->node);
+    rb_tree_remove(&ag->free_by_size, &ext->by_size.node);
+} /* sm_ag_ext_remove */
+
+/* Move/resize a linked extent, rekeying only the indexes whose key changed.
+ * Caller holds ag->lock. */
+static void
+sm_ag_ext_update(
+    struct sm_ag     *ag,
+    struct sm_extent *ext,
+    uint64_t          offset,
+    uint64_t          length)
+{
+    rb_tree_remove(&ag->free_by_size, &ext->by_size.node);
+    if (offset != ext->offset) {
+        rb_tree_remove(&ag->free_by_offset, &ext->node);
+        ext->offset = offset;
+        rb_tree_insert(&ag->free_by_offset, offset, ext);
+    }
+    ext->length      = length;
+    ext->by_size.key = sm_size_key(offset, length);
+    rb_tree_insert(&ag->free_by_size, key, &ext->by_size);
+} /* sm_ag_ext_update */
+
 static void
 sm_extent_release(
     struct rb_node *node,
@@ -245,6 +303,8 @@ sm_ag_init(
 
     pthread_mutex_init(&ag->lock, NULL);
     rb_tree_init(&ag->free_by_offset);
+    rb_tree_init(&ag->free_by_size);
+    rb_tree_init(&ag->discard_claims);
 
     if ((int64_t) data_len <= 0) {
         /* AG too small to hold even its own log + reservations: no data range. */
@@ -254,14 +314,16 @@ sm_ag_init(
 
     initial = sm_extent_new(data_off, data_len);
 
-    rb_tree_insert(&ag->free_by_offset, offset, initial);
+    sm_ag_ext_insert(ag, initial);
     ag->free_bytes = data_len;
 } /* sm_ag_init */
 
 static void
 sm_ag_destroy(struct sm_ag *ag)
 {
+    /* Extents are owned by the offset index; the size index just links them. */
     rb_tree_destroy(&ag->free_by_offset, sm_extent_release, NULL);
+    rb_tree_destroy(&ag->discard_claims, sm_extent_release, NULL);
     pthread_mutex_destroy(&ag->lock);
 } /* sm_ag_destroy */
 
@@ -270,9 +332,10 @@ sm_ag_destroy(struct sm_ag *ag)
  * writes the device offset (absolute) into `*r_offset`.  Returns -1 if the
  * AG cannot satisfy the request.  Caller must hold ag->lock.
  *
- * First-fit walk of the by-offset tree.  An optional best-fit secondary
- * index can be added later; the current shape supports it without changing
- * the public API.
+ * Best fit: one ceiling lookup in the size index finds the smallest free
+ * extent that can hold `size` (lowest offset among equals), and the request
+ * is carved from its front.  Leaving large extents whole for large requests
+ * keeps an aged AG from shredding its remaining contiguous space.
  */
 static int
 sm_ag_alloc_locked(
@@ -280,38 +343,74 @@ sm_ag_alloc_locked(
     uint64_t      size,
     uint64_t     *r_offset)
 {
-    struct sm_extent *ext;
+    struct sm_size_node *sn;
+    struct sm_extent    *ext;
 
     if (ag->free_bytes < size) {
         return -1;
     }
 
-    rb_tree_first(&ag->free_by_offset, ext);
+    rb_tree_query_ceil(&ag->free_by_size, sm_size_key(0, size), key, sn);
+    if (!sn) {
+        return -1;
+    }
+    ext = container_of(sn, struct sm_extent, by_size);
 
-    while (ext) {
-        if (ext->length >= size) {
-            *r_offset = ext->offset;
+    *r_offset = ext->offset;
 
-            if (ext->length == size) {
-                rb_tree_remove(&ag->free_by_offset, &ext->node);
-                free(ext);
-            } else {
-                /* Shrink: offset is the rb-tree key, so remove + reinsert. */
-                rb_tree_remove(&ag->free_by_offset, &ext->node);
-                ext->offset += size;
-                ext->length -= size;
-                rb_tree_insert(&ag->free_by_offset, offset, ext);
-            }
+    if (ext->length == size) {
+        sm_ag_ext_remove(ag, ext);
+        free(ext);
+    } else {
+        sm_ag_ext_update(ag, ext, ext->offset + size, ext->length - size);
+    }
 
-            ag->free_bytes -= size;
-            return 0;
-        }
+    ag->free_bytes -= size;
+    return 0;
+} /* sm_ag_alloc_locked */
 
-        ext = rb_tree_next(&ag->free_by_offset, ext);
+/*
+ * Carve exactly [offset, offset+size) out of `ag`'s free tree.  Succeeds only
+ * when the whole range lies inside one free extent; returns -1 otherwise.
+ * Caller must hold ag->lock.
+ */
+static int
+sm_ag_alloc_at_locked(
+    struct sm_ag *ag,
+    uint64_t      offset,
+    uint64_t      size)
+{
+    struct sm_extent *ext;
+    struct sm_extent *rest;
+    uint64_t          ext_end;
+
+    rb_tree_query_floor(&ag->free_by_offset, offset, offset, ext);
+
+    if (!ext || ext->offset + ext->length < offset + size) {
+        return -1;
     }
 
-    return -1;
-} /* sm_ag_alloc_locked */
+    ext_end = ext->offset + ext->length;
+
+    if (ext->offset == offset) {
+        if (ext->length == size) {
+            sm_ag_ext_remove(ag, ext);
+            free(ext);
+        } else {
+            sm_ag_ext_update(ag, ext, ext->offset + size, ext->length - size);
+        }
+    } else {
+        /* The head keeps its offset; anything past the carve is a new extent. */
+        sm_ag_ext_update(ag, ext, ext->offset, offset - ext->offset);
+        if (ext_end > offset + size) {
+            rest = sm_extent_new(offset + size, ext_end - (offset + size));
+            sm_ag_ext_insert(ag, rest);
+        }
+    }
+
+    ag->free_bytes -= size;
+    return 0;
+} /* sm_ag_alloc_at_locked */
 
 /*
  * Return [offset, offset+length) to `ag`'s free tree, coalescing with any
@@ -346,34 +445,81 @@ sm_ag_free_locked(
                 offset, next_ext->offset, next_ext->length);
 
     if (prev_ext && prev_ext->offset + prev_ext->length == offset) {
-        prev_ext->length += length;
-        merged_with_prev  = 1;
+        merged_with_prev = 1;
     }
 
     if (merged_with_prev) {
-        if (next_ext && next_ext->offset == prev_ext->offset + prev_ext->length) {
-            prev_ext->length += next_ext->length;
-            rb_tree_remove(&ag->free_by_offset, &next_ext->node);
+        uint64_t merged = prev_ext->length + length;
+
+        if (next_ext && next_ext->offset == offset + length) {
+            merged += next_ext->length;
+            sm_ag_ext_remove(ag, next_ext);
             free(next_ext);
         }
+        sm_ag_ext_update(ag, prev_ext, prev_ext->offset, merged);
     } else if (next_ext && next_ext->offset == offset + length) {
-        rb_tree_remove(&ag->free_by_offset, &next_ext->node);
-        next_ext->offset  = offset;
-        next_ext->length += length;
-        rb_tree_insert(&ag->free_by_offset, offset, next_ext);
+        sm_ag_ext_update(ag, next_ext, offset, next_ext->length + length);
     } else {
         struct sm_extent *fresh = sm_extent_new(offset, length);
-        rb_tree_insert(&ag->free_by_offset, offset, fresh);
+        sm_ag_ext_insert(ag, fresh);
     }
 
     ag->free_bytes += length;
 } /* sm_ag_free_locked */
 
+/*
+ * Build the role's placement order: smooth weighted round-robin, so a device
+ * of weight w appears w times per cycle, spread out rather than bunched.
+ */
+static void
+sm_placement_build(
+    struct space_map *sm,
+    uint32_t          role)
+{
+    int64_t  *credit;
+    uint32_t  total = 0;
+    uint32_t  d, k, best;
+
+    for (d = 0; d < sm->num_devices; d++) {
+        if (sm->devices[d].role == role) {
+            total += sm->devices[d].weight;
+        }
+    }
+
+    sm->placement_len[role] = total;
+    if (total == 0) {
+        return;
+    }
+
+    sm->placement[role] = calloc(total, sizeof(uint32_t));
+    credit              = calloc(sm->num_devices, sizeof(*credit));
+
+    for (k = 0; k < total; k++) {
+        best = UINT32_MAX;
+        for (d = 0; d < sm->num_devices; d++) {
+            if (sm->devices[d].role != role) {
+                continue;
+            }
+            credit[d] += sm->devices[d].weight;
+            if (best == UINT32_MAX || credit[d] > credit[best]) {
+                best = d;
+            }
+        }
+        credit[best]          -= total;
+        sm->placement[role][k] = best;
+    }
+
+    free(credit);
+} /* sm_placement_build */
+
 struct space_map *
 space_map_create(
     const struct sm_device_cfg *cfg,
     uint32_t                    num_devices,
-    uint64_t                    intent_log_size)
+    uint64_t                    intent_log_size,
+    int                         data_csum,
+    int                         bt_compact,
+    int                         snapshots)
 {
     struct space_map *sm;
     struct sm_device *dev;
@@ -391,6 +537,9 @@ space_map_create(
 
     sm                  = calloc(1, sizeof(*sm));
     sm->intent_log_size = intent_log_size;
+    sm->data_csum       = !!data_csum;
+    sm->bt_compact      = !!bt_compact;
+    sm->snapshots       = !!snapshots;
     sm->num_devices     = num_devices;
     sm->devices         = calloc(num_devices, sizeof(*sm->devices));
     pthread_mutex_init(&sm->lock, NULL);
@@ -402,6 +551,7 @@ space_map_create(
         dev->device_id = d;
         dev->size      = cfg[d].size;
         dev->role      = cfg[d].role;
+        dev->weight    = cfg[d].weight ? cfg[d].weight : 1;
         dev->ag_rotor  = 0;
         dev->num_ags   = (dev->size + SM_AG_SIZE - 1) >> SM_AG_SIZE_LOG2;
 
@@ -419,10 +569,17 @@ space_map_create(
             sm->num_remote_devices++;
         }
 
+        if (dev->weight > SM_DEVICE_WEIGHT_MAX) {
+            dev->weight = SM_DEVICE_WEIGHT_MAX;
+        }
+
         dev->ags            = calloc(dev->num_ags, sizeof(*dev->ags));
         sm->total_capacity += dev->size;
     }
 
+    sm_placement_build(sm, SM_DEV_LOCAL);
+    sm_placement_build(sm, SM_DEV_REMOTE);
+
     /* The relocated remote-AG-log region sits on device 0, between the intent
      * log and AG 0's own space-map log.  Deterministic (device,ag)->slot map. */
     region_base           = SM_SUPERBLOCK_SIZE + sm->intent_log_size;
@@ -438,7 +595,7 @@ space_map_create(
             uint64_t base = (uint64_t) a << SM_AG_SIZE_LOG2;
             uint64_t span = SM_AG_SIZE;
             uint32_t log_device_id;
-            uint64_t log_offset, data_off, data_end;
+            uint64_t log_offset, data_off, data_end, csum_offset;
 
             if (base + span > dev->size) {
                 span = dev->size - base;
@@ -473,10 +630,12 @@ space_map_create(
                  * and the relocated remote-AG-log region, all *before* this
                  * AG's own log.  Then the bootstrap inode blocks after the log
                  * (block_idx 1=reserved, 2=root inode, 3..=orphan-list
-                 * shards). */
+                 * shards, then the snapshot directory if formatted for
+                 * snapshots). */
                 uint64_t pre_log = SM_SUPERBLOCK_SIZE + sm->intent_log_size +
                     sm->remote_log_size;
-                uint64_t post_log = (2 + SM_BOOTSTRAP_ORPHAN_SLOTS) * SM_BLOCK_SIZE;
+                uint64_t post_log = (2 + SM_BOOTSTRAP_ORPHAN_SLOTS + !!sm->snapshots) *
+                    SM_BLOCK_SIZE;
 
                 log_offset = base + pre_log;
 
@@ -493,8 +652,37 @@ space_map_create(
             }
 
             data_end = base + span;
+            if (sm->data_csum) {
+                /* The data checksum table takes the tail of the AG: one entry
+                 * per block of the AG, SM_CSUM_PER_BLOCK to a table block. */
+                uint64_t nblocks = span >> SM_BLOCK_SHIFT;
+                uint64_t tblocks = (nblocks + SM_CSUM_PER_BLOCK - 1) / SM_CSUM_PER_BLOCK;
+
+                data_end = ((base + span) & ~SM_BLOCK_MASK) - tblocks * SM_BLOCK_SIZE;
+                sm_abort_if(data_end <= data_off,
+                            "AG size %lu too small to hold its data checksum table",
+                            span);
+            }
+            csum_offset = data_end;
+            if (sm->snapshots) {
+                /* The extent reference table sits just below it, sized the
+                 * same way. */
+                uint64_t nblocks = span >> SM_BLOCK_SHIFT;
+                uint64_t tblocks = (nblocks + SM_REF_PER_BLOCK - 1) / SM_REF_PER_BLOCK;
+
+                data_end -= tblocks * SM_BLOCK_SIZE;
+                sm_abort_if(data_end <= data_off,
+                            "AG size %lu too small to hold its extent reference table",
+                            span);
+            }
             sm_ag_init(ag, d, a, base, span, log_device_id, log_offset,
                        data_off, data_end > data_off ? data_end - data_off : 0);
+            if (sm->data_csum) {
+                ag->csum_offset = csum_offset;
+            }
+            if (sm->snapshots) {
+                ag->ref_offset = data_end;
+            }
         }
     }
 
@@ -516,6 +704,14 @@ space_map_create(
             (uint64_t) SM_AG_LOG_SIZE,
             (unsigned) SM_AG_LOG_SLOT_COUNT,
             (uint64_t) SM_AG_LOG_SLOT_SIZE);
+    if (sm->data_csum) {
+        sm_info("Data checksums: per-AG table of %lu entries per block",
+                (uint64_t) SM_CSUM_PER_BLOCK);
+    }
+    if (sm->snapshots) {
+        sm_info("Snapshots: per-AG extent reference table of %lu entries per block",
+                (uint64_t) SM_REF_PER_BLOCK);
+    }
     if (sm->num_remote_devices) {
         sm_info("Block mode: %u remote data device(s); relocated AG-log region "
                 "on device %u offset %lu size %lu",
@@ -541,13 +737,44 @@ space_map_destroy(struct space_map *sm)
     }
 
     pthread_mutex_destroy(&sm->lock);
+    free(sm->placement[SM_DEV_LOCAL]);
+    free(sm->placement[SM_DEV_REMOTE]);
     free(sm->devices);
     free(sm);
 } /* space_map_destroy */
 
+/*
+ * First device a pick scans: `hint` when it names a device of the role,
+ * otherwise the rotor's next entry in the role's weighted placement order.
+ * A hinted pick leaves the rotor alone so hinted traffic does not skew the
+ * share unhinted allocations give each device.
+ */
+static uint32_t
+sm_pick_start(
+    struct space_map *sm,
+    uint32_t          role,
+    uint32_t          hint)
+{
+    uint32_t start_dev;
+
+    if (hint < sm->num_devices && sm->devices[hint].role == role) {
+        return hint;
+    }
+    if (sm->placement_len[role] == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&sm->lock);
+    start_dev = sm->placement[role][sm->device_rotor % sm->placement_len[role]];
+    sm->device_rotor++;
+    pthread_mutex_unlock(&sm->lock);
+
+    return start_dev;
+} /* sm_pick_start */
+
 /*
  * Attempt to reserve `want` bytes by allocating from some AG.  Walks every
- * AG of every device starting from the rotor's current position; returns 0
+ * AG of every device starting from sm_pick_start's device; returns 0
  * on success.  May return less than `want` only via the failure path; this
  * function never returns a partial reservation.
  */
@@ -557,19 +784,14 @@ sm_pick_and_alloc(
     const struct sm_journal *jnl,
     uint32_t                 role,
     uint64_t                 want,
+    uint32_t                 hint,
     uint32_t                *r_device_id,
     uint64_t                *r_device_offset)
 {
     uint32_t start_dev, dev_id;
     uint32_t d, a;
 
-    pthread_mutex_lock(&sm->lock);
-    start_dev = sm->device_rotor;
-    sm->device_rotor++;
-    if (sm->device_rotor >= sm->num_devices) {
-        sm->device_rotor = 0;
-    }
-    pthread_mutex_unlock(&sm->lock);
+    start_dev = sm_pick_start(sm, role, hint);
 
     for (d = 0; d < sm->num_devices; d++) {
         dev_id = (start_dev + d) % sm->num_devices;
@@ -639,19 +861,14 @@ sm_pick_and_reserve_volatile(
     struct space_map *sm,
     uint32_t          role,
     uint64_t          want,
+    uint32_t          hint,
     uint32_t         *r_device_id,
     uint64_t         *r_device_offset)
 {
     uint32_t start_dev, dev_id;
     uint32_t d, a;
 
-    pthread_mutex_lock(&sm->lock);
-    start_dev = sm->device_rotor;
-    sm->device_rotor++;
-    if (sm->device_rotor >= sm->num_devices) {
-        sm->device_rotor = 0;
-    }
-    pthread_mutex_unlock(&sm->lock);
+    start_dev = sm_pick_start(sm, role, hint);
 
     for (d = 0; d < sm->num_devices; d++) {
         dev_id = (start_dev + d) % sm->num_devices;
@@ -695,6 +912,46 @@ sm_pick_and_reserve_volatile(
     return -1;
 } /* sm_pick_and_reserve_volatile */
 
+/*
+ * Volatile reservation of exactly [offset, offset+want) on `device_id`, for
+ * growing a reservation in place.  -1 if the range is not wholly free, leaves
+ * its AG, or sits on a device of the other role.
+ */
+static int
+sm_reserve_volatile_at(
+    struct space_map *sm,
+    uint32_t          role,
+    uint32_t          device_id,
+    uint64_t          offset,
+    uint64_t          want)
+{
+    struct sm_device *dev;
+    struct sm_ag     *ag;
+    uint32_t          ag_idx;
+    int               rc;
+
+    if (device_id >= sm->num_devices) {
+        return -1;
+    }
+    dev = &sm->devices[device_id];
+    if (dev->role != role) {
+        return -1;
+    }
+    ag_idx = (uint32_t) (offset >> SM_AG_SIZE_LOG2);
+    if (ag_idx >= dev->num_ags) {
+        return -1;
+    }
+    ag = &dev->ags[ag_idx];
+    if (offset < ag->base_offset || offset + want > ag->base_offset + ag->size) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&ag->lock);
+    rc = ag->free_bytes < want ? -1 : sm_ag_alloc_at_locked(ag, offset, want);
+    pthread_mutex_unlock(&ag->lock);
+    return rc;
+} /* sm_reserve_volatile_at */
+
 static int
 space_map_journal_alloc_exact(
     struct space_map        *sm,
@@ -728,7 +985,8 @@ space_map_reserve(
     const struct sm_journal *jnl,
     uint32_t                 role,
     uint64_t                 min_bytes,
-    uint64_t                 floor)
+    uint64_t                 floor,
+    uint32_t                 device_hint)
 {
     uint64_t need = SM_ALIGN_UP(min_bytes);
     uint64_t want;
@@ -776,7 +1034,8 @@ space_map_reserve(
         return -1;
     }
 
-    rc = sm_pick_and_alloc(sm, jnl, role, want, &cache->device_id, &cache->offset);
+    rc = sm_pick_and_alloc(sm, jnl, role, want, device_hint,
+                           &cache->device_id, &cache->offset);
     if (rc == SM_AGAIN) {
         return SM_AGAIN;
     }
@@ -784,7 +1043,8 @@ space_map_reserve(
         /* Try the smaller exact size before giving up, in case fragmentation
          * blocks the reservation but the caller's actual ask is small. */
         if (want != need) {
-            rc = sm_pick_and_alloc(sm, jnl, role, need, &cache->device_id, &cache->offset);
+            rc = sm_pick_and_alloc(sm, jnl, role, need, device_hint,
+                                   &cache->device_id, &cache->offset);
             if (rc == SM_AGAIN) {
                 return SM_AGAIN;
             }
@@ -811,6 +1071,7 @@ space_map_alloc(
     uint32_t                 role,
     uint64_t                 size,
     uint64_t                 floor,
+    uint32_t                 device_hint,
     uint32_t                *r_device_id,
     uint64_t                *r_device_offset)
 {
@@ -822,7 +1083,7 @@ space_map_alloc(
     /* Ensure the cache covers `need` (refilling -- journals, may SM_AGAIN),
      * then dole from it.  Callers that have front-loaded the reservation via
      * space_map_reserve hit the fast path here with no journaling. */
-    rc = space_map_reserve(sm, cache, jnl, role, need, floor);
+    rc = space_map_reserve(sm, cache, jnl, role, need, floor, device_hint);
     if (rc != 0) {
         return rc;     /* SM_AGAIN or -1 (ENOSPC) */
     }
@@ -845,16 +1106,29 @@ space_map_alloc_volatile_reservation(
     uint32_t                 role,
     uint64_t                 size,
     uint64_t                 floor,
+    uint32_t                 device_hint,
     uint32_t                *r_device_id,
     uint64_t                *r_device_offset)
 {
     uint64_t need = SM_ALIGN_UP(size);
     uint64_t want;
+    uint32_t near_dev;
+    uint64_t near_off;
     int      rc;
 
     sm_abort_if(need == 0, "alloc of zero bytes");
 
-    if (!cache->valid || cache->length < need) {
+    if (!cache->valid || cache->length < need ||
+        (device_hint != SM_DEVICE_ANY && cache->device_id != device_hint)) {
+        /* The unused tail (or, once drained, the end of the last draw) is
+         * where this owner's next bytes belong.  Return it, then try to take
+         * the refill starting right there, so a streaming writer keeps
+         * growing one device-contiguous run that its extent map coalesces
+         * into a single extent; fall back to a fresh pick anywhere.  A hint
+         * naming another device (the next stripe unit) skips the in-place
+         * attempt and starts the pick on that device. */
+        near_dev = cache->device_id;
+        near_off = cache->offset;
         space_map_thread_cache_discard_volatile(sm, cache);
 
         want = need > floor ? need : floor;
@@ -862,10 +1136,21 @@ space_map_alloc_volatile_reservation(
             return -1;
         }
 
-        rc = sm_pick_and_reserve_volatile(sm, role, want,
-                                          &cache->device_id, &cache->offset);
+        rc = -1;
+        if (near_off != 0 &&
+            (device_hint == SM_DEVICE_ANY || device_hint == near_dev)) {
+            rc = sm_reserve_volatile_at(sm, role, near_dev, near_off, want);
+            if (rc == 0) {
+                cache->device_id = near_dev;
+                cache->offset    = near_off;
+            }
+        }
+        if (rc != 0) {
+            rc = sm_pick_and_reserve_volatile(sm, role, want, device_hint,
+                                              &cache->device_id, &cache->offset);
+        }
         if (rc != 0 && want != need) {
-            rc = sm_pick_and_reserve_volatile(sm, role, need,
+            rc = sm_pick_and_reserve_volatile(sm, role, need, device_hint,
                                               &cache->device_id, &cache->offset);
             if (rc == 0) {
                 cache->length = need;
@@ -1091,7 +1376,9 @@ space_map_fill_superblock(
     memset(buf, 0, SM_SUPERBLOCK_SIZE);
 
     sb->magic              = SM_SUPERBLOCK_MAGIC;
-    sb->version            = SM_FORMAT_VERSION;
+    sb->version            = (sm->incompat | sm->log_incompat) ? SM_FORMAT_VERSION_FEAT :
+        sm->bt_compact ? SM_FORMAT_VERSION_BTC :
+        sm->data_csum ? SM_FORMAT_VERSION_CSUM : SM_FORMAT_VERSION;
     sb->block_size         = SM_BLOCK_SIZE;
     sb->ag_size            = SM_AG_SIZE;
     sb->ag_log_size        = SM_AG_LOG_SIZE;
@@ -1109,8 +1396,12 @@ space_map_fill_superblock(
     sb->remote_log_offset  = sm->remote_log_offset;
     sb->remote_log_size    = sm->remote_log_size;
     sb->gen_floor          = gen_floor;
+    sb->data_csum          = sm->data_csum;
+    sb->bt_compact         = sm->bt_compact;
+    sb->incompat           = sm->incompat;
+    sb->log_incompat       = sm->log_incompat;
     sb->crc32              = 0;
-    sb->crc32              = sm_crc32(buf, SM_SUPERBLOCK_SIZE);
+    sb->crc32              = chimera_crc32(0, buf, SM_SUPERBLOCK_SIZE);
 } /* space_map_fill_superblock */
 
 int
@@ -1154,13 +1445,14 @@ space_map_read_superblock(
         return -1;
     }
 
-    if (sb->magic != SM_SUPERBLOCK_MAGIC || sb->version != SM_FORMAT_VERSION) {
+    if (sb->magic != SM_SUPERBLOCK_MAGIC ||
+        sb->version < SM_FORMAT_VERSION || sb->version > SM_FORMAT_VERSION_FEAT) {
         return -1;
     }
 
     stored    = sb->crc32;
     sb->crc32 = 0;
-    computed  = sm_crc32(buf, sizeof(buf));
+    computed  = chimera_crc32(0, buf, sizeof(buf));
     sb->crc32 = stored;
     if (stored != computed) {
         return -1;
@@ -1192,21 +1484,82 @@ sm_ag_mark_used_locked(
 
     e_off = e->offset;
     e_len = e->length;
-    rb_tree_remove(&ag->free_by_offset, &e->node);
+    sm_ag_ext_remove(ag, e);
 
     if (offset > e_off) {
         struct sm_extent *l = sm_extent_new(e_off, offset - e_off);
-        rb_tree_insert(&ag->free_by_offset, offset, l);
+        sm_ag_ext_insert(ag, l);
     }
     if (offset + length < e_off + e_len) {
         struct sm_extent *r = sm_extent_new(offset + length,
                                             (e_off + e_len) - (offset + length));
-        rb_tree_insert(&ag->free_by_offset, offset, r);
+        sm_ag_ext_insert(ag, r);
     }
     ag->free_bytes -= length;
     free(e);
 } /* sm_ag_mark_used_locked */
 
+/*
+ * Take [device_offset, device_offset+length) out of its AG's free tree for the
+ * duration of a device discard, without journaling anything: the range stays
+ * free on disk, it just cannot be handed out until space_map_discard_release
+ * returns it.  Succeeds only if the whole range is still free -- a range that
+ * was (even partly) reallocated since it was freed must not be discarded.
+ * The claim is remembered in ag->discard_claims so a condensation (runtime or
+ * at unmount) that runs while it is held still writes the range into the new
+ * base as free.  Returns 0 on success, -1 if the range must not be discarded.
+ */
+int
+space_map_discard_claim(
+    struct space_map *sm,
+    uint32_t          device_id,
+    uint64_t          device_offset,
+    uint64_t          length)
+{
+    struct sm_ag     *ag;
+    struct sm_extent *e = NULL;
+    int               rc;
+
+    ag = sm_free_resolve_ag(sm, device_id, device_offset, length,
+                            "space_map_discard_claim");
+
+    pthread_mutex_lock(&ag->lock);
+    rb_tree_query_floor(&ag->free_by_offset, device_offset, offset, e);
+    rc = (e && e->offset + e->length >= device_offset + length) ? 0 : -1;
+    if (rc == 0) {
+        sm_ag_mark_used_locked(ag, device_offset, length);
+        e = sm_extent_new(device_offset, length);
+        rb_tree_insert(&ag->discard_claims, offset, e);
+    }
+    pthread_mutex_unlock(&ag->lock);
+    return rc;
+} /* space_map_discard_claim */
+
+/* Return a range claimed by space_map_discard_claim to the free tree. */
+void
+space_map_discard_release(
+    struct space_map *sm,
+    uint32_t          device_id,
+    uint64_t          device_offset,
+    uint64_t          length)
+{
+    struct sm_ag     *ag;
+    struct sm_extent *c = NULL;
+
+    ag = sm_free_resolve_ag(sm, device_id, device_offset, length,
+                            "space_map_discard_release");
+
+    pthread_mutex_lock(&ag->lock);
+    rb_tree_query_exact(&ag->discard_claims, device_offset, offset, c);
+    sm_abort_if(!c || c->length != length,
+                "discard release [%lu,%lu) was not claimed",
+                device_offset, device_offset + length);
+    rb_tree_remove(&ag->discard_claims, &c->node);
+    free(c);
+    sm_ag_free_locked(ag, device_offset, length);
+    pthread_mutex_unlock(&ag->lock);
+} /* space_map_discard_release */
+
 static uint64_t sm_ag_condense_into(
     struct sm_ag *ag,
     uint8_t      *slot,
@@ -1279,8 +1632,31 @@ space_map_condense_commit(
     pthread_mutex_unlock(&ag->lock);
 } /* space_map_condense_commit */
 
+/* Append [offset, offset+length) to a condensed base, merging it into the
+ * previous entry when they touch. */
+static inline void
+sm_condense_append(
+    struct sm_ag_log_ext *base,
+    uint32_t             *n,
+    uint64_t              maxbase,
+    uint64_t              offset,
+    uint64_t              length)
+{
+    if (*n && base[*n - 1].offset + base[*n - 1].length == offset) {
+        base[*n - 1].length += length;
+        return;
+    }
+    sm_abort_if(*n >= maxbase, "AG condense overflow (%u extents)", *n);
+    base[*n].offset = offset;
+    base[*n].length = length;
+    (*n)++;
+} /* sm_condense_append */
+
 /* Serialize the AG's current free set into `slot` as a condensed base (no
- * deltas) at `generation`.  Caller holds ag->lock.  Returns bytes written. */
+ * deltas) at `generation`.  Ranges held by discard claims are free on disk
+ * and go in too, merged in offset order with their free neighbours (replay
+ * carves ALLOC deltas out of single base extents, so touching entries must
+ * be one).  Caller holds ag->lock.  Returns bytes written. */
 static uint64_t
 sm_ag_condense_into(
     struct sm_ag *ag,
@@ -1289,18 +1665,21 @@ sm_ag_condense_into(
 {
     struct sm_ag_log_header *h    = (struct sm_ag_log_header *) slot;
     struct sm_ag_log_ext    *base = (struct sm_ag_log_ext *) (slot + sizeof(*h));
-    struct sm_extent        *e;
+    struct sm_extent        *e, *c;
     uint32_t                 n       = 0;
     uint64_t                 maxbase = (SM_AG_LOG_SLOT_SIZE - sizeof(*h)) /
         sizeof(struct sm_ag_log_ext);
 
     rb_tree_first(&ag->free_by_offset, e);
-    while (e) {
-        sm_abort_if(n >= maxbase, "AG condense overflow (%u extents)", n);
-        base[n].offset = e->offset;
-        base[n].length = e->length;
-        n++;
-        e = rb_tree_next(&ag->free_by_offset, e);
+    rb_tree_first(&ag->discard_claims, c);
+    while (e || c) {
+        if (e && (!c || e->offset < c->offset)) {
+            sm_condense_append(base, &n, maxbase, e->offset, e->length);
+            e = rb_tree_next(&ag->free_by_offset, e);
+        } else {
+            sm_condense_append(base, &n, maxbase, c->offset, c->length);
+            c = rb_tree_next(&ag->discard_claims, c);
+        }
     }
 
     h->magic       = SM_AG_LOG_MAGIC;
@@ -1326,11 +1705,12 @@ sm_ag_reconstruct(
 
     rb_tree_destroy(&ag->free_by_offset, sm_extent_release, NULL);
     rb_tree_init(&ag->free_by_offset);
+    rb_tree_init(&ag->free_by_size);
     ag->free_bytes = 0;
 
     for (i = 0; i < h->base_count; i++) {
         struct sm_extent *e = sm_extent_new(base[i].offset, base[i].length);
-        rb_tree_insert(&ag->free_by_offset, offset, e);
+        sm_ag_ext_insert(ag, e);
         ag->free_bytes += base[i].length;
     }
     for (i = 0; i < h->delta_count; i++) {
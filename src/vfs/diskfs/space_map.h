@@ -35,6 +35,9 @@
 #define SM_SUPERBLOCK_SIZE        4096
 #define SM_SUPERBLOCK_MAGIC       0x4D5346534B534944ULL     /* "DISKSFSM" */
 #define SM_FORMAT_VERSION         2
+#define SM_FORMAT_VERSION_CSUM    3                         /* v2 + data checksum tables */
+#define SM_FORMAT_VERSION_BTC     4                         /* v3 + compact b+tree leaves */
+#define SM_FORMAT_VERSION_FEAT    5                         /* v4 + feature masks */
 
 /*
  * Bootstrap inode blocks carved after AG 0's log on device 0 at format time:
@@ -46,6 +49,8 @@
 #define SM_BOOTSTRAP_ORPHAN_SLOTS 16
 
 #define SM_RESERVATION_MIN        (1ULL << 20)              /* 1 MiB */
+#define SM_DEVICE_ANY             UINT32_MAX                /* no placement hint */
+#define SM_DEVICE_WEIGHT_MAX      64
 
 #define SM_ALIGN_UP(x) (((x) + SM_BLOCK_MASK) & ~SM_BLOCK_MASK)
 
@@ -217,6 +222,30 @@ struct sm_io {
 
 /* superblock flags */
 #define SM_SB_CLEAN                0x1ULL  /* set at clean unmount, cleared at mount */
+#define SM_SB_LOG_SEQ              0x2ULL  /* log_seq is past every seq on the log */
+
+/*
+ * Version 5 feature masks.  A mount refuses a filesystem with an incompat bit
+ * it does not know.  log_incompat bits name record formats the intent log may
+ * hold: diskfs sets them for the session at mount and a clean unmount (log
+ * fully drained home) clears them, so a filesystem only needs version 5 while
+ * it is dirty, and a cleanly unmounted one stays mountable by older builds.
+ */
+#define SM_INCOMPAT_INLINE_DATA         0x1ULL  /* file bytes held in inode records */
+#define SM_INCOMPAT_COMPRESSION         0x2ULL  /* compressed data extents */
+#define SM_INCOMPAT_SNAPSHOT            0x4ULL  /* extent refcount tables, snapshots */
+
+/* REDO_BLOCK_CSUM: the redo header hash covers the header region only and
+ * each full image carries its own hash.  Every session sets it; a log
+ * without it may hold older records whose header hash covers the whole
+ * record, which recovery also accepts. */
+#define SM_LOG_INCOMPAT_REDO_DELTA      0x1ULL  /* delta redo records */
+#define SM_LOG_INCOMPAT_REDO_BLOCK_CSUM 0x2ULL  /* per-image redo hashes */
+
+#define SM_INCOMPAT_KNOWN               (SM_INCOMPAT_INLINE_DATA | SM_INCOMPAT_COMPRESSION | \
+                                         SM_INCOMPAT_SNAPSHOT)
+#define SM_LOG_INCOMPAT_KNOWN           (SM_LOG_INCOMPAT_REDO_DELTA | \
+                                         SM_LOG_INCOMPAT_REDO_BLOCK_CSUM)
 
 struct sm_superblock {
     uint64_t magic;
@@ -230,8 +259,8 @@ struct sm_superblock {
     uint64_t intent_log_offset;
     uint64_t intent_log_size;
     uint32_t crc32;
-    /* Mount/recovery state (covered by crc32, which is computed over the
-     * whole 4 KiB block with the crc field zeroed). */
+    /* Mount/recovery state (covered by crc32 -- IEEE CRC-32, chimera_crc32 --
+     * which is computed over the whole 4 KiB block with the crc field zeroed). */
     uint64_t flags;
     uint64_t root_inum;
     uint32_t root_gen;
@@ -250,31 +279,48 @@ struct sm_superblock {
      * reused inode block).  diskfs owns the semantics; see the gen allocator
      * there. */
     uint64_t gen_floor;
+    /* Version 3: nonzero if every local AG ends in a data checksum table (see
+     * struct sm_csum_block).  Fixed at format time. */
+    uint32_t data_csum;
+    /* Version 4: nonzero if diskfs may write compact b+tree leaves (older
+     * readers do not understand them).  Fixed at format time. */
+    uint32_t bt_compact;
+    /* Version 5: SM_INCOMPAT_* and SM_LOG_INCOMPAT_* feature masks (zero in
+     * older images, which end above). */
+    uint64_t incompat;
+    uint64_t log_incompat;
     /* Remainder of the 4 KiB block is implicit zero padding. */
 };
 
 /*
- * IEEE CRC-32 (bitwise; used for the superblock and, later, intent-log redo
- * records).  Adequate for these low-frequency / one-record-at-a-time paths.
+ * Data checksum table.  When the filesystem is formatted with data checksums,
+ * the tail of every LOCAL AG holds one 32-bit checksum per 4 KiB block of the
+ * AG, addressed by device offset (sm_csum_locate).  A table block whose stamp
+ * is not the filesystem's fsid has never been written and reads as all zero;
+ * a zero entry means "no checksum recorded" (freed, metadata, or never
+ * written as file data).  diskfs owns the contents; the space map only
+ * reserves the room.
  */
-static inline uint32_t
-sm_crc32(
-    const void *data,
-    size_t      len)
-{
-    const uint8_t *p   = data;
-    uint32_t       crc = 0xFFFFFFFFu;
-    size_t         i;
-    int            k;
-
-    for (i = 0; i < len; i++) {
-        crc ^= p[i];
-        for (k = 0; k < 8; k++) {
-            crc = (crc >> 1) ^ (0xEDB88320u & (uint32_t) (-(int32_t) (crc & 1)));
-        }
-    }
-    return ~crc;
-} /* sm_crc32 */
+#define SM_CSUM_PER_BLOCK ((SM_BLOCK_SIZE - sizeof(uint64_t)) / sizeof(uint32_t))
+
+struct sm_csum_block {
+    uint64_t stamp;
+    uint32_t csum[SM_CSUM_PER_BLOCK];
+};
+
+/*
+ * Extent reference table.  A filesystem formatted for snapshots
+ * (SM_INCOMPAT_SNAPSHOT) keeps, in front of the checksum table of every LOCAL
+ * AG, one 16-bit count per 4 KiB block of the AG (sm_ref_locate): the number
+ * of references to the block beyond the first, so 0 means owned by one file
+ * (or free).  Stamped like the checksum table; diskfs owns the contents.
+ */
+#define SM_REF_PER_BLOCK ((SM_BLOCK_SIZE - sizeof(uint64_t)) / sizeof(uint16_t))
+
+struct sm_ref_block {
+    uint64_t stamp;
+    uint16_t ref[SM_REF_PER_BLOCK];
+};
 
 /*
  * Device roles.  LOCAL devices hold all metadata (superblock, intent log,
@@ -295,21 +341,31 @@ sm_crc32(
  * `size` and `role` matter.  REMOTE devices additionally carry the stable
  * 16-byte pNFS deviceid and an RFC 5663 SIMPLE-volume content signature
  * {sig_offset, sig[0..sig_len)} that the block client matches against its local
- * disks (provisioned out of band; diskfs never writes it).
+ * disks (provisioned out of band; diskfs never writes it).  `weight` sets how
+ * often the device comes up in placement relative to others of its role, for
+ * pools mixing device sizes or speeds.
  */
 struct sm_device_cfg {
     uint64_t size;
     uint32_t role;
+    uint32_t weight;        /* placement share (0 = 1, max SM_DEVICE_WEIGHT_MAX) */
     uint8_t  deviceid[SM_DEVICEID_SIZE];
     uint64_t sig_offset;
     uint32_t sig_len;
     uint8_t  sig[SM_SIG_MAX];
 };
 
-struct sm_extent {
+/* Size-index linkage of a free extent (see sm_size_key). */
+struct sm_size_node {
     struct rb_node node;
-    uint64_t       offset;
-    uint64_t       length;
+    uint64_t       key;
+};
+
+struct sm_extent {
+    struct rb_node      node;
+    uint64_t            offset;
+    uint64_t            length;
+    struct sm_size_node by_size;
 };
 
 struct sm_ag {
@@ -322,8 +378,15 @@ struct sm_ag {
                                       * AG tracks a relocated REMOTE device) */
     uint64_t        log_offset;      /* absolute offset of this AG's log on log_device_id */
     uint64_t        log_size;        /* total log bytes (both slots) */
+    uint64_t        csum_offset;     /* absolute offset of the data checksum
+                                      * table (end of the AG), 0 if none */
+    uint64_t        ref_offset;      /* absolute offset of the extent reference
+                                      * table (before the checksum table), 0
+                                      * if none */
     uint64_t        free_bytes;
-    struct rb_tree  free_by_offset;
+    struct rb_tree  free_by_offset;  /* coalescing, exact-range carves */
+    struct rb_tree  free_by_size;    /* best-fit allocation */
+    struct rb_tree  discard_claims;  /* free on disk, held out for a discard */
     pthread_mutex_t lock;
 
     /* On-disk allocation-log state (protected by lock). */
@@ -344,6 +407,7 @@ struct sm_device {
     uint32_t      num_ags;
     uint32_t      ag_rotor;
     uint32_t      role;                       /* SM_DEV_LOCAL | SM_DEV_REMOTE */
+    uint32_t      weight;
     uint8_t       deviceid[SM_DEVICEID_SIZE];  /* REMOTE: pNFS deviceid */
     uint64_t      sig_offset;                 /* REMOTE: SIMPLE-volume signature */
     uint32_t      sig_len;
@@ -355,6 +419,12 @@ struct space_map {
     struct sm_device *devices;
     uint32_t          num_devices;
     uint32_t          device_rotor;
+    /* Weighted round-robin device order per role (smooth WRR over the
+     * device weights): unhinted allocations start their device scan at the
+     * rotor's next entry, and space_map_stripe_device maps stripe units onto
+     * it. */
+    uint32_t         *placement[2];
+    uint32_t          placement_len[2];
     uint64_t          total_capacity;  /* raw sum of device sizes */
     uint64_t          usable_capacity; /* allocatable total (sum of AG data
                                         * ranges, metadata excluded); constant
@@ -375,6 +445,21 @@ struct space_map {
     /* Active intent-log size: the configured value at mkfs, or the value the
      * superblock recorded on a remount.  Drives the AG 0 metadata layout. */
     uint64_t          intent_log_size;
+
+    /* Local AGs carry a data checksum table (superblock version 3). */
+    int               data_csum;
+
+    /* Recorded in the superblock for diskfs (version 4). */
+    int               bt_compact;
+
+    /* Local AGs carry an extent reference table and AG 0 one more bootstrap
+     * inode block (SM_INCOMPAT_SNAPSHOT). */
+    int               snapshots;
+
+    /* Feature masks recorded in the superblock; version 5 is written only
+     * while either is nonzero.  Owned by diskfs. */
+    uint64_t          incompat;
+    uint64_t          log_incompat;
 };
 
 struct sm_thread_cache {
@@ -388,7 +473,10 @@ struct space_map *
 space_map_create(
     const struct sm_device_cfg *cfg,
     uint32_t                    num_devices,
-    uint64_t                    intent_log_size);
+    uint64_t                    intent_log_size,
+    int                         data_csum,
+    int                         bt_compact,
+    int                         snapshots);
 
 void
 space_map_destroy(
@@ -412,6 +500,8 @@ space_map_destroy(
  * `floor` is the minimum reservation to grab when refilling (the over-reserve
  * amount that batches future small allocs); pass SM_RESERVATION_MIN for the
  * batched behaviour or 0 for an exact reservation (no retained tail).
+ * `device_hint` is the device a refill tries first (SM_DEVICE_ANY = the
+ * weighted rotor); other devices of the role are the fallback.
  * 0 = covered, -1 = ENOSPC, SM_AGAIN = parked.
  */
 int
@@ -421,12 +511,14 @@ space_map_reserve(
     const struct sm_journal *jnl,
     uint32_t                 role,
     uint64_t                 min_bytes,
-    uint64_t                 floor);
+    uint64_t                 floor,
+    uint32_t                 device_hint);
 
 /* `role` (SM_DEV_LOCAL/SM_DEV_REMOTE) restricts the allocation to devices of
  * that class: block mode places metadata on LOCAL and data on REMOTE devices.
  * With no remote devices everything is LOCAL (today's single-pool behavior).
- * `floor` is the over-reserve minimum (see space_map_reserve). */
+ * `floor` is the over-reserve minimum and `device_hint` the preferred device
+ * for a refill (see space_map_reserve). */
 int
 space_map_alloc(
     struct space_map        *sm,
@@ -435,12 +527,15 @@ space_map_alloc(
     uint32_t                 role,
     uint64_t                 size,
     uint64_t                 floor,
+    uint32_t                 device_hint,
     uint32_t                *r_device_id,
     uint64_t                *r_device_offset);
 
 /* File-data allocation path: the reservation tail is live only in memory.
  * Exact consumed ranges are journaled before being returned to the caller; the
- * unused tail can be discarded without a durable FREE. */
+ * unused tail can be discarded without a durable FREE.  A `device_hint` other
+ * than the reservation's device drops the tail and reserves afresh there
+ * (falling back to any device of the role when it is full). */
 int
 space_map_alloc_volatile_reservation(
     struct space_map        *sm,
@@ -449,9 +544,36 @@ space_map_alloc_volatile_reservation(
     uint32_t                 role,
     uint64_t                 size,
     uint64_t                 floor,
+    uint32_t                 device_hint,
     uint32_t                *r_device_id,
     uint64_t                *r_device_offset);
 
+/* Device holding stripe unit `index` of an object seeded `seed`: a walk of
+ * the role's weighted placement order, so consecutive units land on
+ * consecutive devices and each device takes its weighted share. */
+static inline uint32_t
+space_map_stripe_device(
+    const struct space_map *sm,
+    uint32_t                role,
+    uint64_t                seed,
+    uint64_t                index)
+{
+    if (sm->placement_len[role] == 0) {
+        return SM_DEVICE_ANY;
+    }
+    return sm->placement[role][(seed + index) % sm->placement_len[role]];
+} // space_map_stripe_device
+
+/* Number of devices of `role`. */
+static inline uint32_t
+space_map_role_devices(
+    const struct space_map *sm,
+    uint32_t                role)
+{
+    return role == SM_DEV_REMOTE ? sm->num_remote_devices :
+           sm->num_devices - sm->num_remote_devices;
+} // space_map_role_devices
+
 static inline int
 space_map_has_remote(const struct space_map *sm)
 {
@@ -483,6 +605,23 @@ space_map_free_apply(
     uint64_t          device_offset,
     uint64_t          length);
 
+/* Hold a still-free range out of the allocator while it is discarded on the
+ * device (no journaling); release returns it.  Claim returns -1 if any of the
+ * range was reallocated.  Condensation writes claimed ranges as free. */
+int
+space_map_discard_claim(
+    struct space_map *sm,
+    uint32_t          device_id,
+    uint64_t          device_offset,
+    uint64_t          length);
+
+void
+space_map_discard_release(
+    struct space_map *sm,
+    uint32_t          device_id,
+    uint64_t          device_offset,
+    uint64_t          length);
+
 int
 space_map_thread_cache_return(
     struct space_map        *sm,
@@ -662,7 +801,9 @@ sm_inum_valid(
     }
     ag  = &sm->devices[disk].ags[ag_idx];
     off = ag->log_offset + ag->log_size + (uint64_t) (block_idx - 1) * SM_BLOCK_SIZE;
-    return off + SM_BLOCK_SIZE <= ag->base_offset + ag->size;
+    return off + SM_BLOCK_SIZE <= (ag->ref_offset ? ag->ref_offset :
+                                   ag->csum_offset ? ag->csum_offset :
+                                   ag->base_offset + ag->size);
 } // sm_inum_valid
 
 /*
@@ -682,3 +823,63 @@ sm_inum_from_device_offset(
 
     return sm_inum_make(disk, ag_idx, block_idx);
 } // sm_inum_from_device_offset
+
+/*
+ * Locate the data checksum of the 4 KiB block at (disk, offset): the device
+ * offset of the table block holding it and the slot within that block.
+ * Returns -1 if the block's AG has no table (no data checksums, or a REMOTE
+ * device).
+ */
+static inline int
+sm_csum_locate(
+    const struct space_map *sm,
+    uint32_t                disk,
+    uint64_t                offset,
+    uint64_t               *r_table_offset,
+    uint32_t               *r_slot)
+{
+    uint32_t            ag_idx = (uint32_t) (offset >> SM_AG_SIZE_LOG2);
+    const struct sm_ag *ag;
+    uint64_t            idx;
+
+    if (disk >= sm->num_devices || ag_idx >= sm->devices[disk].num_ags) {
+        return -1;
+    }
+    ag = &sm->devices[disk].ags[ag_idx];
+    if (!ag->csum_offset) {
+        return -1;
+    }
+    idx             = (offset - ag->base_offset) >> SM_BLOCK_SHIFT;
+    *r_table_offset = ag->csum_offset + (idx / SM_CSUM_PER_BLOCK) * SM_BLOCK_SIZE;
+    *r_slot         = (uint32_t) (idx % SM_CSUM_PER_BLOCK);
+    return 0;
+} // sm_csum_locate
+
+/*
+ * Locate the reference count of the 4 KiB block at (disk, offset), like
+ * sm_csum_locate.  Returns -1 if the block's AG has no reference table.
+ */
+static inline int
+sm_ref_locate(
+    const struct space_map *sm,
+    uint32_t                disk,
+    uint64_t                offset,
+    uint64_t               *r_table_offset,
+    uint32_t               *r_slot)
+{
+    uint32_t            ag_idx = (uint32_t) (offset >> SM_AG_SIZE_LOG2);
+    const struct sm_ag *ag;
+    uint64_t            idx;
+
+    if (disk >= sm->num_devices || ag_idx >= sm->devices[disk].num_ags) {
+        return -1;
+    }
+    ag = &sm->devices[disk].ags[ag_idx];
+    if (!ag->ref_offset) {
+        return -1;
+    }
+    idx             = (offset - ag->base_offset) >> SM_BLOCK_SHIFT;
+    *r_table_offset = ag->ref_offset + (idx / SM_REF_PER_BLOCK) * SM_BLOCK_SIZE;
+    *r_slot         = (uint32_t) (idx % SM_REF_PER_BLOCK);
+    return 0;
+} // sm_ref_locate
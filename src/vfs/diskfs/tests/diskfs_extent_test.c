@@ -0,0 +1,547 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * File-data layout under interleaved streaming writers.  Formats diskfs on a
+ * single file-backed device and drives it through the VFS API, writing
+ * several files round-robin in 64 KiB pieces -- the pattern that used to
+ * leave every file in 1 MiB fragments -- and then finds each 4 KiB block in
+ * the device image by the marker it carries and counts each file's
+ * device-contiguous runs:
+ *
+ *   - without a hint, a file's reservations grow with it (1, 1, 2, 4, 8 MiB
+ *     for 16 MiB), so it lies in at most that many runs;
+ *   - user.diskfs.extsize set on a directory is inherited by the files
+ *     created in it, reads back from each, and lays them down in runs of the
+ *     hint;
+ *   - the hint rejects values that are not whole blocks and clears on 0.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <jansson.h>
+
+#include "evpl/evpl.h"
+#include "vfs/vfs.h"
+#include "vfs/vfs_procs.h"
+#include "vfs/vfs_release.h"
+#include "vfs/vfs_attrs.h"
+#include "vfs/vfs_cred.h"
+#include "vfs/vfs_error.h"
+#include "common/logging.h"
+#include "prometheus-c.h"
+
+#define TEST_MOUNT       "extent"
+#define TEST_DEVICE_SIZE (1ULL << 30)
+#define TEST_BLOCK       4096
+#define TEST_WRITE       (64 * 1024)
+#define TEST_FILE_SIZE   (16ULL << 20)
+#define TEST_FILE_BLOCKS (TEST_FILE_SIZE / TEST_BLOCK)
+#define TEST_NPLAIN      8
+#define TEST_NHINTED     4
+#define TEST_NFILES      (TEST_NPLAIN + TEST_NHINTED)
+#define TEST_EXTSIZE     (8ULL << 20)
+#define TEST_COPIES      4
+#define TEST_SCAN        (1024 * 1024)
+
+struct test_ctx {
+    struct evpl                    *evpl;
+    struct chimera_vfs_thread      *vfs_thread;
+    struct chimera_vfs_cred         cred;
+    int                             done;
+    enum chimera_vfs_error          status;
+    struct chimera_vfs_open_handle *handle;
+    uint8_t                         fh[CHIMERA_VFS_FH_SIZE];
+    uint32_t                        fh_len;
+    uint32_t                        value_len;
+};
+
+/* Device offsets each file block was found at (a block may also have a copy
+ * in the intent log). */
+struct test_block {
+    uint64_t offset[TEST_COPIES];
+    uint32_t ncopies;
+};
+
+static struct test_block *blocks;
+
+static void
+test_wait(struct test_ctx *t)
+{
+    while (!t->done) {
+        evpl_continue(t->evpl);
+    }
+    t->done = 0;
+} /* test_wait */
+
+static void
+test_mount_cb(
+    struct chimera_vfs_thread *thread,
+    enum chimera_vfs_error     status,
+    void                      *private_data)
+{
+    struct test_ctx *t = private_data;
+
+    t->status = status;
+    t->done   = 1;
+} /* test_mount_cb */
+
+static void
+test_lookup_cb(
+    enum chimera_vfs_error    error_code,
+    struct chimera_vfs_attrs *attr,
+    void                     *private_data)
+{
+    struct test_ctx *t = private_data;
+
+    t->status = error_code;
+    if (error_code == CHIMERA_VFS_OK) {
+        memcpy(t->fh, attr->va_fh, attr->va_fh_len);
+        t->fh_len = attr->va_fh_len;
+    }
+    t->done = 1;
+} /* test_lookup_cb */
+
+static void
+test_open_fh_cb(
+    enum chimera_vfs_error          error_code,
+    struct chimera_vfs_open_handle *oh,
+    void                           *private_data)
+{
+    struct test_ctx *t = private_data;
+
+    t->status = error_code;
+    t->handle = oh;
+    t->done   = 1;
+} /* test_open_fh_cb */
+
+static void
+test_open_at_cb(
+    enum chimera_vfs_error          error_code,
+    struct chimera_vfs_open_handle *oh,
+    struct chimera_vfs_attrs       *set_attr,
+    struct chimera_vfs_attrs       *attr,
+    struct chimera_vfs_attrs       *dir_pre,
+    struct chimera_vfs_attrs       *dir_post,
+    void                           *private_data)
+{
+    struct test_ctx *t = private_data;
+
+    t->status = error_code;
+    t->handle = oh;
+    t->done   = 1;
+} /* test_open_at_cb */
+
+static void
+test_mkdir_at_cb(
+    enum chimera_vfs_error    error_code,
+    struct chimera_vfs_attrs *set_attr,
+    struct chimera_vfs_attrs *attr,
+    struct chimera_vfs_attrs *dir_pre_attr,
+    struct chimera_vfs_attrs *dir_post_attr,
+    void                     *private_data)
+{
+    struct test_ctx *t = private_data;
+
+    t->status = error_code;
+    if (error_code == CHIMERA_VFS_OK) {
+        memcpy(t->fh, attr->va_fh, attr->va_fh_len);
+        t->fh_len = attr->va_fh_len;
+    }
+    t->done = 1;
+} /* test_mkdir_at_cb */
+
+static void
+test_write_cb(
+    enum chimera_vfs_error    error_code,
+    uint32_t                  length,
+    uint32_t                  sync,
+    struct chimera_vfs_attrs *pre_attr,
+    struct chimera_vfs_attrs *post_attr,
+    void                     *private_data)
+{
+    struct test_ctx *t = private_data;
+
+    t->status = error_code;
+    t->done   = 1;
+} /* test_write_cb */
+
+static void
+test_set_xattr_cb(
+    enum chimera_vfs_error          error_code,
+    const struct chimera_vfs_attrs *pre_attr,
+    const struct chimera_vfs_attrs *post_attr,
+    void                           *private_data)
+{
+    struct test_ctx *t = private_data;
+
+    t->status = error_code;
+    t->done   = 1;
+} /* test_set_xattr_cb */
+
+static void
+test_get_xattr_cb(
+    enum chimera_vfs_error error_code,
+    uint32_t               value_len,
+    void                  *private_data)
+{
+    struct test_ctx *t = private_data;
+
+    t->status    = error_code;
+    t->value_len = value_len;
+    t->done      = 1;
+} /* test_get_xattr_cb */
+
+static struct chimera_vfs_open_handle *
+test_open_fh(
+    struct test_ctx *t,
+    const uint8_t   *fh,
+    uint32_t         fh_len)
+{
+    chimera_vfs_open_fh(t->vfs_thread, &t->cred, fh, fh_len,
+                        CHIMERA_VFS_OPEN_INFERRED, test_open_fh_cb, t);
+    test_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "test", __FILE__, __LINE__,
+                     "open_fh failed: %d", t->status);
+    return t->handle;
+} /* test_open_fh */
+
+static struct chimera_vfs_open_handle *
+test_create(
+    struct test_ctx                *t,
+    struct chimera_vfs_open_handle *dir,
+    const char                     *name)
+{
+    struct chimera_vfs_attrs sattr;
+
+    memset(&sattr, 0, sizeof(sattr));
+    sattr.va_set_mask = CHIMERA_VFS_ATTR_MODE;
+    sattr.va_mode     = 0644;
+
+    chimera_vfs_open_at(t->vfs_thread, &t->cred, dir, name, strlen(name),
+                        CHIMERA_VFS_OPEN_CREATE, &sattr, CHIMERA_VFS_ATTR_FH,
+                        0, 0, test_open_at_cb, t);
+    test_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "test", __FILE__, __LINE__,
+                     "create %s failed: %d", name, t->status);
+    return t->handle;
+} /* test_create */
+
+static struct chimera_vfs_open_handle *
+test_mkdir(
+    struct test_ctx                *t,
+    struct chimera_vfs_open_handle *dir,
+    const char                     *name)
+{
+    struct chimera_vfs_attrs sattr;
+
+    memset(&sattr, 0, sizeof(sattr));
+    sattr.va_set_mask = CHIMERA_VFS_ATTR_MODE;
+    sattr.va_mode     = 0755;
+
+    chimera_vfs_mkdir_at(t->vfs_thread, &t->cred, dir, name, strlen(name),
+                         &sattr, CHIMERA_VFS_ATTR_FH, 0, 0, test_mkdir_at_cb, t);
+    test_wait(t);
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "test", __FILE__, __LINE__,
+                     "mkdir %s failed: %d", name, t->status);
+    return test_open_fh(t, t->fh, t->fh_len);
+} /* test_mkdir */
+
+static enum chimera_vfs_error
+test_set_extsize(
+    struct test_ctx                *t,
+    struct chimera_vfs_open_handle *h,
+    const char                     *value)
+{
+    chimera_vfs_set_xattr(t->vfs_thread, &t->cred, h, CHIMERA_VFS_XATTR_EITHER,
+                          "user.diskfs.extsize", 19, value, strlen(value),
+                          test_set_xattr_cb, t);
+    test_wait(t);
+    return t->status;
+} /* test_set_extsize */
+
+/* The hint as a number, or 0 if the file has none (ENODATA). */
+static uint64_t
+test_get_extsize(
+    struct test_ctx                *t,
+    struct chimera_vfs_open_handle *h)
+{
+    char value[32];
+
+    chimera_vfs_get_xattr(t->vfs_thread, &t->cred, h, "user.diskfs.extsize", 19,
+                          value, sizeof(value) - 1, test_get_xattr_cb, t);
+    test_wait(t);
+    if (t->status == CHIMERA_VFS_ENODATA) {
+        return 0;
+    }
+    chimera_abort_if(t->status != CHIMERA_VFS_OK, "test", __FILE__, __LINE__,
+                     "get_xattr user.diskfs.extsize failed: %d", t->status);
+    value[t->value_len] = '\0';
+    return strtoull(value, NULL, 10);
+} /* test_get_extsize */
+
+static void
+test_block_fill(
+    char *buf,
+    int   file,
+    int   block)
+{
+    int i;
+
+    for (i = 0; i < TEST_BLOCK; i++) {
+        buf[i] = (char) (file * 31 + block * 7 + i);
+    }
+    snprintf(buf, 32, "extent-test-%02d-%06d", file, block);
+} /* test_block_fill */
+
+/* Round-robin 64 KiB appends, one per file per pass, every file open
+ * throughout (each keeps its own reservation until released). */
+static void
+test_write_interleaved(
+    struct test_ctx                 *t,
+    struct chimera_vfs_open_handle **files,
+    int                              first,
+    int                              nfiles)
+{
+    struct evpl_iovec iov;
+    uint64_t          off;
+    int               f, b;
+
+    for (off = 0; off < TEST_FILE_SIZE; off += TEST_WRITE) {
+        for (f = first; f < first + nfiles; f++) {
+            evpl_iovec_alloc(t->evpl, TEST_WRITE, TEST_BLOCK, 1, 0, &iov);
+            for (b = 0; b < TEST_WRITE / TEST_BLOCK; b++) {
+                test_block_fill((char *) iov.data + b * TEST_BLOCK, f,
+                                (int) (off / TEST_BLOCK) + b);
+            }
+            chimera_vfs_write(t->vfs_thread, &t->cred, files[f], off, TEST_WRITE,
+                              1, 0, 0, &iov, 1, test_write_cb, t);
+            test_wait(t);
+            evpl_iovec_release(t->evpl, &iov);
+            chimera_abort_if(t->status != CHIMERA_VFS_OK, "test", __FILE__, __LINE__,
+                             "write failed: %d", t->status);
+        }
+    }
+} /* test_write_interleaved */
+
+/* Find every marked block in the allocated parts of the sparse image. */
+static void
+test_scan_device(const char *device)
+{
+    static char buf[TEST_SCAN];
+    off_t       data, hole, off;
+    ssize_t     n, i;
+    int         fd, file, block;
+
+    fd = open(device, O_RDONLY);
+    chimera_abort_if(fd < 0, "test", __FILE__, __LINE__, "open %s failed: %s",
+                     device, strerror(errno));
+
+    data = lseek(fd, 0, SEEK_DATA);
+    while (data >= 0) {
+        hole = lseek(fd, data, SEEK_HOLE);
+        for (off = data & ~(off_t) (TEST_BLOCK - 1); off < hole; off += n) {
+            n = pread(fd, buf, TEST_SCAN, off);
+            if (n <= 0) {
+                break;
+            }
+            for (i = 0; i + TEST_BLOCK <= n; i += TEST_BLOCK) {
+                struct test_block *blk;
+
+                if (memcmp(buf + i, "extent-test-", 12) != 0 ||
+                    sscanf(buf + i + 12, "%2d-%6d", &file, &block) != 2 ||
+                    file < 0 || file >= TEST_NFILES ||
+                    block < 0 || (uint64_t) block >= TEST_FILE_BLOCKS) {
+                    continue;
+                }
+                blk = &blocks[file * TEST_FILE_BLOCKS + block];
+                if (blk->ncopies < TEST_COPIES) {
+                    blk->offset[blk->ncopies++] = (uint64_t) (off + i);
+                }
+            }
+        }
+        data = lseek(fd, hole, SEEK_DATA);
+    }
+    close(fd);
+} /* test_scan_device */
+
+/* Device-contiguous runs of a file: a block that has a copy right behind the
+ * previous block's continues the run. */
+static int
+test_count_runs(int file)
+{
+    struct test_block *blk;
+    uint64_t           prev = 0;
+    uint32_t           b, c;
+    int                runs = 0, cont;
+
+    for (b = 0; b < TEST_FILE_BLOCKS; b++) {
+        blk = &blocks[file * TEST_FILE_BLOCKS + b];
+        chimera_abort_if(blk->ncopies == 0, "test", __FILE__, __LINE__,
+                         "file %d block %u not found on the device", file, b);
+
+        cont = 0;
+        for (c = 0; b && c < blk->ncopies; c++) {
+            if (blk->offset[c] == prev + TEST_BLOCK) {
+                cont = 1;
+            }
+        }
+        if (cont) {
+            prev += TEST_BLOCK;
+        } else {
+            prev = blk->offset[0];
+            runs++;
+        }
+    }
+    return runs;
+} /* test_count_runs */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    struct chimera_vfs_module_cfg   module_cfgs[2];
+    struct prometheus_metrics      *metrics;
+    struct chimera_vfs             *vfs;
+    struct test_ctx                 t;
+    struct chimera_vfs_open_handle *root, *dir, *files[TEST_NFILES];
+    uint8_t                         root_fh[CHIMERA_VFS_FH_SIZE];
+    uint32_t                        root_fh_len;
+    char                            device[256], name[32];
+    json_t                         *cfg, *devices, *dev;
+    char                           *text;
+    int                             fd, f, runs, max_plain = 0, max_hinted = 0;
+
+    (void) argc;
+    (void) argv;
+
+    snprintf(device, sizeof(device), "/dev/shm/diskfs_extent_test.%d.img", getpid());
+    fd = open(device, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    chimera_abort_if(fd < 0 || ftruncate(fd, TEST_DEVICE_SIZE) < 0, "test", __FILE__,
+                     __LINE__, "create %s failed: %s", device, strerror(errno));
+    close(fd);
+
+    blocks = calloc(TEST_NFILES * TEST_FILE_BLOCKS, sizeof(*blocks));
+
+    chimera_log_init();
+    metrics = prometheus_metrics_create(NULL, NULL, 0);
+
+    /* One device, so placement is the allocator's alone. */
+    cfg     = json_object();
+    devices = json_array();
+    dev     = json_object();
+    json_object_set_new(dev, "type", json_string("io_uring"));
+    json_object_set_new(dev, "path", json_string(device));
+    json_object_set_new(dev, "size", json_integer(TEST_DEVICE_SIZE));
+    json_array_append_new(devices, dev);
+    json_object_set_new(cfg, "devices", devices);
+    json_object_set_new(cfg, "initialize", json_true());
+    json_object_set_new(cfg, "intent_log_size", json_integer(16 * 1024 * 1024));
+    text = json_dumps(cfg, JSON_COMPACT);
+    json_decref(cfg);
+
+    memset(module_cfgs, 0, sizeof(module_cfgs));
+    strncpy(module_cfgs[0].module_name, "diskfs", sizeof(module_cfgs[0].module_name) - 1);
+    strncpy(module_cfgs[1].module_name, "memkv", sizeof(module_cfgs[1].module_name) - 1);
+    snprintf(module_cfgs[0].config_data, sizeof(module_cfgs[0].config_data), "%s", text);
+    free(text);
+
+    vfs = chimera_vfs_init(0, 0, module_cfgs, 2, "memkv", 60, 0, metrics);
+
+    memset(&t, 0, sizeof(t));
+    chimera_vfs_cred_init_unix(&t.cred, 0, 0, 0, NULL);
+    t.evpl       = evpl_create(NULL);
+    t.vfs_thread = chimera_vfs_thread_init(t.evpl, vfs);
+
+    chimera_vfs_mount(t.vfs_thread, &t.cred, "/" TEST_MOUNT, "diskfs", "/",
+                      NULL, test_mount_cb, &t);
+    test_wait(&t);
+    chimera_abort_if(t.status != CHIMERA_VFS_OK, "test", __FILE__, __LINE__,
+                     "mount failed: %d", t.status);
+    chimera_vfs_get_root_fh(root_fh, &root_fh_len);
+    chimera_vfs_lookup(t.vfs_thread, &t.cred, root_fh, root_fh_len,
+                       TEST_MOUNT, strlen(TEST_MOUNT),
+                       CHIMERA_VFS_ATTR_FH | CHIMERA_VFS_ATTR_MASK_STAT, 0,
+                       test_lookup_cb, &t);
+    test_wait(&t);
+    chimera_abort_if(t.status != CHIMERA_VFS_OK, "test", __FILE__, __LINE__,
+                     "lookup of the mount failed: %d", t.status);
+    root = test_open_fh(&t, t.fh, t.fh_len);
+
+    /* The hint: whole blocks only, inherited from the directory. */
+    dir = test_mkdir(&t, root, "hinted");
+    chimera_abort_if(test_set_extsize(&t, dir, "12345") != CHIMERA_VFS_EINVAL ||
+                     test_set_extsize(&t, dir, "8x") != CHIMERA_VFS_EINVAL,
+                     "test", __FILE__, __LINE__, "malformed extsize accepted");
+    chimera_abort_if(test_set_extsize(&t, dir, "8388608") != CHIMERA_VFS_OK ||
+                     test_get_extsize(&t, dir) != TEST_EXTSIZE,
+                     "test", __FILE__, __LINE__, "extsize did not stick on the directory");
+
+    for (f = 0; f < TEST_NPLAIN; f++) {
+        snprintf(name, sizeof(name), "plain.%d", f);
+        files[f] = test_create(&t, root, name);
+        chimera_abort_if(test_get_extsize(&t, files[f]) != 0, "test", __FILE__, __LINE__,
+                         "%s has a hint it was never given", name);
+    }
+    for (f = TEST_NPLAIN; f < TEST_NFILES; f++) {
+        snprintf(name, sizeof(name), "hinted.%d", f);
+        files[f] = test_create(&t, dir, name);
+        chimera_abort_if(test_get_extsize(&t, files[f]) != TEST_EXTSIZE, "test",
+                         __FILE__, __LINE__, "%s did not inherit the directory's hint", name);
+    }
+
+    /* Clearing takes the hint off a file again. */
+    chimera_abort_if(test_set_extsize(&t, files[0], "4096") != CHIMERA_VFS_OK ||
+                     test_get_extsize(&t, files[0]) != 4096 ||
+                     test_set_extsize(&t, files[0], "0") != CHIMERA_VFS_OK ||
+                     test_get_extsize(&t, files[0]) != 0,
+                     "test", __FILE__, __LINE__, "extsize did not set and clear");
+
+    test_write_interleaved(&t, files, 0, TEST_NPLAIN);
+    test_write_interleaved(&t, files, TEST_NPLAIN, TEST_NHINTED);
+
+    for (f = 0; f < TEST_NFILES; f++) {
+        chimera_vfs_release(t.vfs_thread, files[f]);
+    }
+    chimera_vfs_release(t.vfs_thread, dir);
+    chimera_vfs_release(t.vfs_thread, root);
+    chimera_vfs_thread_destroy(t.vfs_thread);
+    evpl_destroy(t.evpl);
+    chimera_vfs_destroy(vfs);
+    prometheus_metrics_destroy(metrics);
+
+    /* Unmounted, so everything written is at home on the device. */
+    test_scan_device(device);
+
+    for (f = 0; f < TEST_NFILES; f++) {
+        runs = test_count_runs(f);
+        fprintf(stderr, "file %2d (%s): %d run%s\n", f, f < TEST_NPLAIN ? "plain" : "hinted",
+                runs, runs == 1 ? "" : "s");
+        if (f < TEST_NPLAIN) {
+            max_plain = runs > max_plain ? runs : max_plain;
+        } else {
+            max_hinted = runs > max_hinted ? runs : max_hinted;
+        }
+    }
+
+    /* Five size-scaled reservations make up 16 MiB; two of the hint. */
+    chimera_abort_if(max_plain > 5, "test", __FILE__, __LINE__,
+                     "an interleaved 16 MiB file lies in %d runs", max_plain);
+    chimera_abort_if(max_hinted > (int) (TEST_FILE_SIZE / TEST_EXTSIZE), "test", __FILE__,
+                     __LINE__, "a hinted 16 MiB file lies in %d runs", max_hinted);
+
+    free(blocks);
+    unlink(device);
+
+    fprintf(stderr, "extent layout ok: plain <= %d runs, hinted <= %d runs\n",
+            max_plain, max_hinted);
+    return 0;
+} /* main */
@@ -0,0 +1,267 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+/*
+ * Space-map free-index consistency.  Every free extent of an AG is linked
+ * into two rb-trees, one keyed by offset and one by (length, offset); this
+ * fragments an AG and then drives it through allocation (best fit from the
+ * size index), in-place reservation growth (exact-range carve), discard
+ * claims (mark-used split) and frees that coalesce with both neighbours,
+ * checking after every step that the two trees describe the same extents.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "common/rbtree.h"
+#include "vfs/diskfs/space_map.h"
+
+#ifndef container_of
+#define container_of(ptr, type, member) \
+        ((type *) ((char *) (ptr) - offsetof(type, member)))
+#endif /* ifndef container_of */
+
+#define TEST_DEVICE_SIZE (1ULL << 30)
+#define TEST_STEPS       20000
+
+struct test_extent {
+    uint32_t device_id;
+    uint64_t offset;
+    uint64_t length;
+};
+
+static struct test_extent *live;
+static uint64_t            nlive;
+
+static uint64_t
+test_rand(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+} /* test_rand */
+
+static inline uint64_t
+test_size_key(
+    uint64_t offset,
+    uint64_t length)
+{
+    return (length << SM_AG_SIZE_LOG2) | (offset & SM_AG_OFFSET_MASK);
+} /* test_size_key */
+
+/*
+ * Both indexes hold exactly the same extents, each keyed by its current
+ * offset and length; the offset order is sorted, disjoint and fully
+ * coalesced; and the total matches free_bytes.
+ */
+static void
+test_check_ag(struct sm_ag *ag)
+{
+    struct sm_extent    *ext, *found;
+    struct sm_size_node *sn;
+    uint64_t             n_off = 0, n_size = 0, bytes = 0, end = 0, key = 0;
+
+    pthread_mutex_lock(&ag->lock);
+
+    rb_tree_first(&ag->free_by_offset, ext);
+    while (ext) {
+        assert(ext->length > 0);
+        assert(ext->offset >= ag->base_offset);
+        assert(ext->offset + ext->length <= ag->base_offset + ag->size);
+        assert(n_off == 0 || ext->offset > end);    /* disjoint, not adjacent */
+        assert(ext->by_size.key == test_size_key(ext->offset, ext->length));
+
+        end    = ext->offset + ext->length;
+        bytes += ext->length;
+        n_off++;
+        ext = rb_tree_next(&ag->free_by_offset, ext);
+    }
+
+    rb_tree_first(&ag->free_by_size, sn);
+    while (sn) {
+        assert(n_size == 0 || sn->key > key);
+        key = sn->key;
+
+        ext = container_of(sn, struct sm_extent, by_size);
+        rb_tree_query_exact(&ag->free_by_offset, ext->offset, offset, found);
+        assert(found == ext);
+
+        n_size++;
+        sn = rb_tree_next(&ag->free_by_size, sn);
+    }
+
+    assert(n_off == n_size);
+    assert(bytes == ag->free_bytes);
+
+    pthread_mutex_unlock(&ag->lock);
+} /* test_check_ag */
+
+/* The extent best fit must take: the smallest that holds `size`, lowest
+ * offset among equals.  Returns its offset, or 0 if none fits. */
+static uint64_t
+test_best_fit(
+    struct sm_ag *ag,
+    uint64_t      size)
+{
+    struct sm_extent *ext;
+    uint64_t          best_off = 0, best_len = UINT64_MAX;
+
+    rb_tree_first(&ag->free_by_offset, ext);
+    while (ext) {
+        if (ext->length >= size && ext->length < best_len) {
+            best_off = ext->offset;
+            best_len = ext->length;
+        }
+        ext = rb_tree_next(&ag->free_by_offset, ext);
+    }
+    return best_off;
+} /* test_best_fit */
+
+static void
+test_live_add(
+    uint32_t device_id,
+    uint64_t offset,
+    uint64_t length)
+{
+    live[nlive].device_id = device_id;
+    live[nlive].offset    = offset;
+    live[nlive].length    = length;
+    nlive++;
+} /* test_live_add */
+
+static void
+test_free_live(
+    struct space_map *sm,
+    uint64_t          i)
+{
+    space_map_free(sm, NULL, live[i].device_id, live[i].offset, live[i].length);
+    live[i] = live[--nlive];
+} /* test_free_live */
+
+int
+main(
+    int    argc,
+    char **argv)
+{
+    struct sm_device_cfg   cfg;
+    struct sm_thread_cache cache  = { 0 };
+    struct sm_thread_cache vcache = { 0 };
+    struct space_map      *sm;
+    struct sm_ag          *ag;
+    struct sm_extent      *ext;
+    uint64_t               seed = 0x9E3779B97F4A7C15ULL;
+    uint64_t               total, size, expect, offset, length, prev_end;
+    uint64_t               step, i, claims = 0, grown = 0, coalesced = 0;
+    uint32_t               device_id;
+
+    (void) argc;
+    (void) argv;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.size = TEST_DEVICE_SIZE;
+    cfg.role = SM_DEV_LOCAL;
+    sm       = space_map_create(&cfg, 1, SM_INTENT_LOG_SIZE_MIN, 0, 0, 0);
+    assert(sm && sm->num_devices == 1 && sm->devices[0].num_ags == 1);
+    ag    = &sm->devices[0].ags[0];
+    total = ag->free_bytes;
+    live  = malloc(total / 4096 * sizeof(*live));
+    assert(live);
+
+    /* Fragment: fill with 4 KiB..256 KiB extents, then free a random half,
+     * leaving holes of every size scattered across the AG. */
+    for (;;) {
+        size = (1 + test_rand(&seed) % 64) * 4096;
+        if (space_map_alloc(sm, &cache, NULL, SM_DEV_LOCAL, size, 0, SM_DEVICE_ANY,
+                            &device_id, &offset) != 0) {
+            break;
+        }
+        test_live_add(device_id, offset, size);
+    }
+    assert(ag->free_bytes < 256 * 1024);
+    for (i = nlive / 2; i > 0; i--) {
+        test_free_live(sm, test_rand(&seed) % nlive);
+    }
+    test_check_ag(ag);
+
+    for (step = 0; step < TEST_STEPS; step++) {
+        switch (test_rand(&seed) % 5) {
+            case 0:
+                /* Best-fit allocation out of the size index. */
+                size   = (1 + test_rand(&seed) % 32) * 4096;
+                expect = test_best_fit(ag, size);
+                if (space_map_alloc(sm, &cache, NULL, SM_DEV_LOCAL, size, 0, SM_DEVICE_ANY,
+                                    &device_id, &offset) == 0) {
+                    assert(offset == expect);
+                    test_live_add(device_id, offset, size);
+                } else {
+                    assert(expect == 0);
+                }
+                break;
+            case 1:
+                /* Volatile reservation: once drained, the refill is first
+                 * tried as an exact carve right behind the last draw. */
+                prev_end = vcache.valid ? 0 : vcache.offset;
+                if (space_map_alloc_volatile_reservation(sm, &vcache, NULL, SM_DEV_LOCAL,
+                                                         4096, 8 * 4096, SM_DEVICE_ANY,
+                                                         &device_id, &offset) == 0) {
+                    grown += prev_end && offset == prev_end;
+                    test_live_add(device_id, offset, 4096);
+                }
+                break;
+            case 2:
+                /* Discard claim: mark a range inside a free extent used,
+                 * splitting it, then hand it back (coalescing both sides). */
+                rb_tree_query_floor(&ag->free_by_offset,
+                                    ag->base_offset + test_rand(&seed) % ag->size,
+                                    offset, ext);
+                if (!ext || ext->length < 3 * 4096) {
+                    break;
+                }
+                length = (1 + test_rand(&seed) % (ext->length / 4096 - 2)) * 4096;
+                offset = ext->offset + 4096;
+                assert(space_map_discard_claim(sm, 0, offset, length) == 0);
+                test_check_ag(ag);
+                space_map_discard_release(sm, 0, offset, length);
+                claims++;
+                break;
+            default:
+                /* Free a live extent; count the ones that bridge two holes. */
+                if (!nlive) {
+                    break;
+                }
+                i = test_rand(&seed) % nlive;
+                rb_tree_query_floor(&ag->free_by_offset, live[i].offset, offset, ext);
+                if (ext && ext->offset + ext->length == live[i].offset) {
+                    rb_tree_query_exact(&ag->free_by_offset,
+                                        live[i].offset + live[i].length, offset, ext);
+                    coalesced += ext != NULL;
+                }
+                test_free_live(sm, i);
+                break;
+        } /* switch */
+        test_check_ag(ag);
+    }
+
+    fprintf(stderr, "space map index ok: %lu steps, %lu live, %lu claims, "
+            "%lu in-place growths, %lu two-sided coalesces\n",
+            (unsigned long) TEST_STEPS, (unsigned long) nlive, (unsigned long) claims,
+            (unsigned long) grown, (unsigned long) coalesced);
+    assert(claims > 0 && grown > 0 && coalesced > 0);
+
+    space_map_thread_cache_discard_volatile(sm, &vcache);
+    while (nlive) {
+        test_free_live(sm, nlive - 1);
+    }
+    test_check_ag(ag);
+    assert(ag->free_bytes == total);
+
+    free(live);
+    space_map_destroy(sm);
+    return 0;
+} /* main */
@@ -26,6 +26,7 @@
 #include "common/misc.h"
 #include "common/macros.h"
 #include "common/evpl_iovec_cursor.h"
+#include "common/lock_profile.h"
 
 #ifndef container_of
 #define container_of(ptr, type, member) \
@@ -409,7 +410,7 @@ memfs_inode_get_inum(
 
     inode = &inode_list->inode[block_id][block_index];
 
-    pthread_mutex_lock(&inode->lock);
+    chimera_mutex_lock(&inode->lock, "memfs_inode");
 
     if (unlikely(inode->gen != gen)) {
         pthread_mutex_unlock(&inode->lock);
@@ -458,14 +459,14 @@ memfs_resolve_io(
             (struct memfs_stream_open *) (uintptr_t) (vp & ~1ULL);
 
         inode = so->inode;
-        pthread_mutex_lock(&inode->lock);
+        chimera_mutex_lock(&inode->lock, "memfs_inode");
         *out_stream = so->stream;
         return inode;
     }
 
     if (vp) {
         inode = (struct memfs_inode *) (uintptr_t) vp;
-        pthread_mutex_lock(&inode->lock);
+        chimera_mutex_lock(&inode->lock, "memfs_inode");
         return inode;
     }
 
@@ -2767,7 +2768,7 @@ memfs_open_at(
 
         inode = memfs_inode_alloc_thread(thread);
 
-        pthread_mutex_lock(&inode->lock);
+        chimera_mutex_lock(&inode->lock, "memfs_inode");
 
         inode->size            = 0;
         inode->space_used      = 0;
@@ -2970,7 +2971,7 @@ memfs_close(
         inode = (struct memfs_inode *) (uintptr_t) vp;
     }
 
-    pthread_mutex_lock(&inode->lock);
+    chimera_mutex_lock(&inode->lock, "memfs_inode");
 
     /* Unhook this descriptor from the inode's live-open list before any cascade
      * below (inode_free) walks it, so its memory is freed exactly once -- here,
@@ -3738,13 +3739,13 @@ memfs_copy_range(
 
     /* Lock in deterministic order to avoid AB/BA deadlock */
     if (src_inode == dst_inode) {
-        pthread_mutex_lock(&src_inode->lock);
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
     } else if (src_inode < dst_inode) {
-        pthread_mutex_lock(&src_inode->lock);
-        pthread_mutex_lock(&dst_inode->lock);
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
+        chimera_mutex_lock(&dst_inode->lock, "memfs_inode");
     } else {
-        pthread_mutex_lock(&dst_inode->lock);
-        pthread_mutex_lock(&src_inode->lock);
+        chimera_mutex_lock(&dst_inode->lock, "memfs_inode");
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
     }
 
     memfs_map_attrs(shared, &request->copy_range.r_pre_attr, dst_inode,
@@ -3948,13 +3949,13 @@ memfs_move_range(
     chimera_vfs_realtime(&now);
 
     if (src_inode == dst_inode) {
-        pthread_mutex_lock(&src_inode->lock);
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
     } else if (src_inode < dst_inode) {
-        pthread_mutex_lock(&src_inode->lock);
-        pthread_mutex_lock(&dst_inode->lock);
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
+        chimera_mutex_lock(&dst_inode->lock, "memfs_inode");
     } else {
-        pthread_mutex_lock(&dst_inode->lock);
-        pthread_mutex_lock(&src_inode->lock);
+        chimera_mutex_lock(&dst_inode->lock, "memfs_inode");
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
     }
 
     memfs_map_attrs(shared, &request->move_range.r_dst_pre_attr, dst_inode,
@@ -4103,13 +4104,13 @@ memfs_clone_range(
     chimera_vfs_realtime(&now);
 
     if (src_inode == dst_inode) {
-        pthread_mutex_lock(&src_inode->lock);
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
     } else if (src_inode < dst_inode) {
-        pthread_mutex_lock(&src_inode->lock);
-        pthread_mutex_lock(&dst_inode->lock);
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
+        chimera_mutex_lock(&dst_inode->lock, "memfs_inode");
     } else {
-        pthread_mutex_lock(&dst_inode->lock);
-        pthread_mutex_lock(&src_inode->lock);
+        chimera_mutex_lock(&dst_inode->lock, "memfs_inode");
+        chimera_mutex_lock(&src_inode->lock, "memfs_inode");
     }
 
     memfs_map_attrs(shared, &request->clone_range.r_pre_attr, dst_inode,
@@ -77,6 +77,7 @@ chimera_vfs_delegation_drain(struct chimera_vfs_delegation_thread *delegation_th
     struct chimera_vfs_thread  *thread = delegation_thread->vfs_thread;
     struct chimera_vfs_request *requests, *request;
     struct chimera_vfs_module  *module;
+    int64_t                     count = 0;
 
     pthread_mutex_lock(&delegation_thread->lock);
     requests                    = delegation_thread->requests;
@@ -87,8 +88,16 @@ chimera_vfs_delegation_drain(struct chimera_vfs_delegation_thread *delegation_th
         request = requests;
         LL_DELETE(requests, request);
 
+        chimera_vfs_trace_stamp(request, CHIMERA_VFS_TRACE_DEQUEUE);
+
         module = request->module;
         module->dispatch(request, thread->module_private[module->fh_magic]);
+        count++;
+    }
+
+    if (count) {
+        chimera_thread_stats_queue(delegation_thread->stats, -count);
+        chimera_thread_stats_work(count);
     }
 } /* chimera_vfs_delegation_drain */
 
@@ -120,8 +129,13 @@ chimera_vfs_delegation_thread_init(
     void        *private_data)
 {
     struct chimera_vfs_delegation_thread *delegation_thread = private_data;
+    const char                           *pool;
+
+    pool = delegation_thread->mode == CHIMERA_VFS_DELEGATION_ASYNC ?
+        "async_delegation" : "sync_delegation";
 
     delegation_thread->evpl       = evpl;
+    delegation_thread->stats      = chimera_thread_stats_register(pool);
     delegation_thread->vfs_thread = chimera_vfs_thread_init(evpl, delegation_thread->vfs);
 
     evpl_add_doorbell(evpl, &delegation_thread->doorbell,
@@ -153,6 +167,7 @@ chimera_vfs_delegation_thread_shutdown(
     evpl_remove_doorbell(evpl, &delegation_thread->doorbell);
 
     chimera_vfs_thread_destroy(delegation_thread->vfs_thread);
+    chimera_thread_stats_unregister();
 } /* chimera_vfs_delegation_thread_shutdown */
 
 static void
@@ -201,6 +216,8 @@ chimera_vfs_close_thread_sweep(
         free(handle);
     }
 
+    chimera_thread_stats_work(count);
+
     return count;
 } /* chimera_vfs_close_thread_sweep */
 
@@ -278,6 +295,8 @@ chimera_vfs_close_thread_init(
 {
     struct chimera_vfs_close_thread *close_thread = private_data;
 
+    chimera_thread_stats_register("close");
+
     close_thread->evpl       = evpl;
     close_thread->vfs_thread = chimera_vfs_thread_init(evpl, close_thread->vfs);
 
@@ -302,6 +321,7 @@ chimera_vfs_close_thread_shutdown(
     evpl_remove_timer(evpl, &close_thread->timer);
 
     chimera_vfs_thread_destroy(close_thread->vfs_thread);
+    chimera_thread_stats_unregister();
 } /* chimera_vfs_close_thread_shutdown */
 
 static void
@@ -521,6 +541,9 @@ chimera_vfs_init(
         }
     }
 
+    chimera_vfs_trace_init(vfs);
+    chimera_vfs_hh_init(vfs);
+
     vfs->vfs_open_path_cache = chimera_vfs_open_cache_init(CHIMERA_VFS_OPEN_ID_PATH, 10, 128 * 1024, metrics,
                                                            "path_handles");
     vfs->vfs_open_file_cache = chimera_vfs_open_cache_init(CHIMERA_VFS_OPEN_ID_FILE, 10, 128 * 1024, metrics,
@@ -926,6 +949,9 @@ chimera_vfs_destroy(struct chimera_vfs *vfs)
         prometheus_histogram_destroy(vfs->metrics.metrics, vfs->metrics.op_latency);
     }
 
+    chimera_vfs_trace_destroy(vfs);
+    chimera_vfs_hh_destroy(vfs);
+
     chimera_vfs_clock_shutdown();
 
     free(vfs);
@@ -938,6 +964,7 @@ chimera_vfs_process_completion(
 {
     struct chimera_vfs_thread  *thread = container_of(doorbell, struct chimera_vfs_thread, doorbell);
     struct chimera_vfs_request *complete_requests, *unblocked_requests, *io_resume_requests, *request;
+    int64_t                     count = 0;
 
     pthread_mutex_lock(&thread->lock);
     complete_requests                 = thread->pending_complete_requests;
@@ -952,6 +979,7 @@ chimera_vfs_process_completion(
         request = complete_requests;
         DL_DELETE(complete_requests, request);
         request->complete_delegate(request);
+        count++;
     }
 
     while (unblocked_requests) {
@@ -965,6 +993,12 @@ chimera_vfs_process_completion(
         request = io_resume_requests;
         DL_DELETE(io_resume_requests, request);
         chimera_vfs_state_io_resume(request);
+        count++;
+    }
+
+    if (count) {
+        chimera_thread_stats_queue(thread->stats, -count);
+        chimera_thread_stats_work(count);
     }
 
     /* Deliver any identity-resolver jobs that completed for this thread. */
@@ -1052,6 +1086,7 @@ chimera_vfs_rcu_quiescent(
     (void) evpl;
     (void) private_data;
     urcu_qsbr_quiescent_state();
+    chimera_thread_stats_iteration_end();
 } /* chimera_vfs_rcu_quiescent */
 
 static void
@@ -1061,6 +1096,7 @@ chimera_vfs_rcu_offline(
 {
     (void) evpl;
     (void) private_data;
+    chimera_thread_stats_pre_wait();
     urcu_qsbr_thread_offline();
 } /* chimera_vfs_rcu_offline */
 
@@ -1072,6 +1108,7 @@ chimera_vfs_rcu_online(
     (void) evpl;
     (void) private_data;
     urcu_qsbr_thread_online();
+    chimera_thread_stats_post_wait();
 } /* chimera_vfs_rcu_online */
 
 static const struct evpl_loop_hooks chimera_vfs_rcu_hooks = {
@@ -1125,6 +1162,12 @@ chimera_vfs_thread_init(
         }
     }
 
+    chimera_vfs_trace_thread_init(thread);
+    chimera_vfs_hh_thread_init(thread);
+
+    /* Joins the pool the owning thread registered under, if any */
+    thread->stats = chimera_thread_stats_register("vfs");
+
     if (chimera_vfs_rcu_refs++ == 0) {
         urcu_qsbr_register_thread();
         evpl_set_loop_hooks(evpl, &chimera_vfs_rcu_hooks);
@@ -1206,6 +1249,9 @@ chimera_vfs_thread_destroy(struct chimera_vfs_thread *thread)
         free(thread->metrics.op_latency_series);
     }
 
+    chimera_vfs_trace_thread_destroy(thread);
+    chimera_vfs_hh_thread_destroy(thread);
+
     /* Return this thread's recycled RCU cache entries to their pool depots so
      * they are reclaimed at cache destroy (the pools outlive the threads). */
     for (i = 0; i < CHIMERA_RCU_POOL_COUNT; i++) {
@@ -1217,9 +1263,33 @@ chimera_vfs_thread_destroy(struct chimera_vfs_thread *thread)
         urcu_qsbr_unregister_thread();
     }
 
+    chimera_thread_stats_unregister();
+
     free(thread);
 } /* chimera_vfs_thread_destroy */
 
+/*
+ * Shares chimera_vfs_rcu_refs with VFS thread init, so a VFS thread is left
+ * as it is.  Any other thread is registered (online) only while it reads and
+ * unregistered on the way out, so it never holds up a grace period while it
+ * sleeps between scrapes.
+ */
+void
+chimera_vfs_rcu_reader_enter(void)
+{
+    if (chimera_vfs_rcu_refs++ == 0) {
+        urcu_qsbr_register_thread();
+    }
+} /* chimera_vfs_rcu_reader_enter */
+
+void
+chimera_vfs_rcu_reader_leave(void)
+{
+    if (--chimera_vfs_rcu_refs == 0) {
+        urcu_qsbr_unregister_thread();
+    }
+} /* chimera_vfs_rcu_reader_leave */
+
 void
 chimera_vfs_register(
     struct chimera_vfs        *vfs,
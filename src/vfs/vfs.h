@@ -15,7 +15,10 @@
 #include "evpl/evpl.h"
 #include "prometheus-c.h"
 #include "vfs_clock.h"
+#include "vfs_trace.h"
+#include "vfs_heavy_hitters.h"
 #include "common/tcp_flavor.h"
+#include "common/thread_stats.h"
 
 #define CHIMERA_VFS_PATH_MAX 4096
 #define CHIMERA_VFS_NAME_MAX 256
@@ -160,10 +163,15 @@ struct chimera_vfs_metrics {
     struct prometheus_metrics           *metrics;
     struct prometheus_histogram         *op_latency;
     struct prometheus_histogram_series **op_latency_series;
+    /* Sampled per-stage latency (see vfs_trace.h); series indexed by the
+     * stage that ends the interval, with [RECEIVE] holding the total. */
+    struct prometheus_histogram         *trace_stage;
+    struct prometheus_histogram_series  *trace_stage_series[CHIMERA_VFS_TRACE_STAGE_NUM];
 };
 
 struct chimera_vfs_thread_metrics {
     struct prometheus_histogram_instance **op_latency_series;
+    struct prometheus_histogram_instance  *trace_stage[CHIMERA_VFS_TRACE_STAGE_NUM];
 };
 
 #define CHIMERA_VFS_OPEN_HANDLE_EXCLUSIVE       0x1
@@ -425,6 +433,18 @@ struct chimera_vfs_request {
     uint64_t                           wait_arg1;
     uint64_t                           wait_arg2;
 
+    /* Latency tracing (vfs_trace.h).  trace_mask is 0 for untraced
+     * requests; otherwise one bit per stage stamped in trace_ticks.
+     * trace_sampled is set when the request also feeds the sampled trace
+     * (as opposed to being stamped only for the slow-op recorder). */
+    uint8_t                            trace_mask;
+    uint8_t                            trace_proto;
+    uint8_t                            trace_sampled;
+    uint64_t                           trace_ticks[CHIMERA_VFS_TRACE_STAGE_NUM];
+    struct chimera_vfs_trace_client   *trace_client;
+    /* Set when the request is accounted to the heavy-hitter sketches */
+    uint8_t                            hh_active;
+
     /* Points to one page of memory that the plugin may use as desired */
     void                              *plugin_data;
 
@@ -1453,15 +1473,16 @@ enum chimera_vfs_delegation_mode {
 };
 
 struct chimera_vfs_delegation_thread {
-    struct evpl                *evpl;
-    struct chimera_vfs         *vfs;
-    struct evpl_thread         *evpl_thread;
-    struct chimera_vfs_thread  *vfs_thread;
-    struct chimera_vfs_request *requests;
-    pthread_mutex_t             lock;
-    struct evpl_doorbell        doorbell;
+    struct evpl                     *evpl;
+    struct chimera_vfs              *vfs;
+    struct evpl_thread              *evpl_thread;
+    struct chimera_vfs_thread       *vfs_thread;
+    struct chimera_vfs_request      *requests;
+    pthread_mutex_t                  lock;
+    struct evpl_doorbell             doorbell;
     enum chimera_vfs_delegation_mode mode;
-    struct evpl_poll           *poll;
+    struct evpl_poll                *poll;
+    struct chimera_thread_stats     *stats;
 };
 
 struct chimera_vfs_close_thread {
@@ -1504,6 +1525,22 @@ struct chimera_vfs {
     struct chimera_vfs_delegation_thread *async_delegation_threads;
     struct chimera_vfs_close_thread       close_thread;
     struct chimera_vfs_metrics            metrics;
+    /* Request tracing: 1-in-N sample interval (0 = off), slow-op recorder
+     * threshold (0 = off; ticks cached for the hot path) and the registry of
+     * per-thread trace rings, guarded by trace_lock. */
+    uint32_t                              trace_interval;
+    uint64_t                              slow_op_threshold_ns;
+    uint64_t                              slow_op_threshold_ticks;
+    uint32_t                              trace_next_id;
+    struct chimera_vfs_trace_ring        *trace_rings;
+    pthread_mutex_t                       trace_lock;
+    /* Heavy-hitter tracking (vfs_heavy_hitters.h): enable flag, the
+     * registry of per-thread sketch sets, guarded by hh_lock, and the reset
+     * epoch each set is cleared up to. */
+    int                                   hh_enabled;
+    struct chimera_vfs_hh_sketches       *hh_sketches;
+    pthread_mutex_t                       hh_lock;
+    uint64_t                              hh_epoch;
     enum chimera_tcp_flavor               tcp_flavor;
     int                                   machine_name_len;
     char                                  machine_name[256];
@@ -1534,6 +1571,22 @@ struct chimera_vfs_thread {
     pthread_mutex_t                      lock;
     uint64_t                             anon_fh_key;
 
+    /* Sampled request tracing (vfs_trace.h). */
+    struct chimera_vfs_trace_ring       *trace_ring;
+    uint32_t                             trace_count;
+    uint8_t                              trace_recv_proto;
+    uint64_t                             trace_recv_ticks;
+    struct chimera_vfs_trace_client     *trace_recv_client;
+    /* Last client interned and the free list of unreferenced entries */
+    struct chimera_vfs_trace_client     *trace_client_last;
+    struct chimera_vfs_trace_client     *trace_client_free;
+
+    /* Heavy-hitter sketches, attached on first use */
+    struct chimera_vfs_hh_sketches      *hh_sketches;
+
+    /* Event loop utilisation of the OS thread running this context */
+    struct chimera_thread_stats         *stats;
+
     struct chimera_vfs_thread_metrics    metrics;
 };
 
@@ -1581,6 +1634,19 @@ void
 chimera_vfs_thread_destroy(
     struct chimera_vfs_thread *thread);
 
+/*
+ * Bracket RCU reads made from a thread that may not be a VFS thread (the
+ * metrics scraper, the daemon's main thread).  The thread is registered as
+ * a QSBR reader for the duration unless it already is one.  VFS-internal.
+ */
+void
+chimera_vfs_rcu_reader_enter(
+    void);
+
+void
+chimera_vfs_rcu_reader_leave(
+    void);
+
 void
 chimera_vfs_register(
     struct chimera_vfs        *vfs,
@@ -8,6 +8,7 @@
 #include "vfs/vfs_rcu_pool.h"
 #include <urcu/urcu-qsbr.h>
 #include "prometheus-c.h"
+#include "common/lock_profile.h"
 
 struct chimera_vfs_attr_cache_entry {
     struct chimera_rcu_node  rnode; /* must be first: aliases the entry pointer */
@@ -254,7 +255,7 @@ chimera_vfs_attr_cache_insert(
 
     urcu_qsbr_read_lock();
 
-    pthread_mutex_lock(&shard->entry_lock);
+    chimera_mutex_lock(&shard->entry_lock, "vfs_attr_cache");
 
     best_entry = *slot_best;
 
@@ -12,6 +12,7 @@ enum chimera_vfs_error {
     CHIMERA_VFS_EIO          = 5,      /* I/O error */
     CHIMERA_VFS_ENXIO        = 6,      /* No such device or address */
     CHIMERA_VFS_EAGAIN       = 11,     /* Try again */
+    CHIMERA_VFS_ENOMEM       = 12,     /* Out of memory */
     CHIMERA_VFS_EACCES       = 13,     /* Permission denied */
     CHIMERA_VFS_EFAULT       = 14,         /* Bad address */
     CHIMERA_VFS_EEXIST       = 17,     /* File exists */
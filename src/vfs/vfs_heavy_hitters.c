@@ -0,0 +1,839 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "vfs.h"
+#include "vfs_internal.h"
+#include "vfs_heavy_hitters.h"
+#include "vfs_mount_table.h"
+#include "vfs_notify.h"
+#include "vfs_rpl_cache.h"
+#include "common/macros.h"
+#include "common/format.h"
+
+/* Directory components walked through the RPL cache when naming a key */
+#define CHIMERA_VFS_HH_PATH_DEPTH 32
+
+/* Attempts a reader makes to copy a candidate the writer keeps rewriting */
+#define CHIMERA_VFS_HH_READ_TRIES 16
+
+/*
+ * A top-K candidate.  The writer brackets every change to hash or key with
+ * two increments of `seq`, so a reader that sees the same even value before
+ * and after its copy knows the copy is whole.  `count` is only ever used by
+ * the writer (readers re-estimate from the count-min tables) and is updated
+ * outside the sequence.
+ */
+struct chimera_vfs_hh_cand {
+    uint32_t                    seq;
+    struct chimera_vfs_hh_entry entry;
+};
+
+struct chimera_vfs_hh_sketch {
+    uint64_t                   cm[CHIMERA_VFS_HH_DEPTH][CHIMERA_VFS_HH_WIDTH];
+    int                        ntop;
+    struct chimera_vfs_hh_cand top[CHIMERA_VFS_HH_TOPK];
+};
+
+/*
+ * Like the trace rings, sketch sets are owned by the VFS and adopted by the
+ * next thread when their thread goes away, so readers never race a free.
+ *
+ * The owning thread is the only writer and takes no lock: count-min cells
+ * are plain relaxed stores, candidates are published through their seq, and
+ * a reset is a bump of vfs->hh_epoch that the owner notices on its next
+ * request and answers by clearing its own set.  Readers skip sets whose
+ * epoch is stale.  Decay is also applied by the owner, on its next request;
+ * until then readers scale the set's estimates by the periods that have
+ * passed since last_decay, so an idle thread's counts still age out.
+ */
+struct chimera_vfs_hh_sketches {
+    struct chimera_vfs_hh_sketches *next;
+    int                             active;    /* guarded by vfs->hh_lock */
+    uint64_t                        epoch;
+    uint64_t                        last_decay;
+    struct chimera_vfs_hh_sketch    sketch[CHIMERA_VFS_HH_DIM_NUM][CHIMERA_VFS_HH_METRIC_NUM];
+};
+
+SYMBOL_EXPORT const char *
+chimera_vfs_hh_dim_name(int dim)
+{
+    switch (dim) {
+        case CHIMERA_VFS_HH_CLIENT: return "client";
+        case CHIMERA_VFS_HH_EXPORT: return "export";
+        case CHIMERA_VFS_HH_FILE: return "file";
+        case CHIMERA_VFS_HH_DIRECTORY: return "directory";
+        default: return "unknown";
+    } /* switch */
+} /* chimera_vfs_hh_dim_name */
+
+SYMBOL_EXPORT const char *
+chimera_vfs_hh_metric_name(int metric)
+{
+    switch (metric) {
+        case CHIMERA_VFS_HH_OPS: return "ops";
+        case CHIMERA_VFS_HH_BYTES: return "bytes";
+        default: return "unknown";
+    } /* switch */
+} /* chimera_vfs_hh_metric_name */
+
+SYMBOL_EXPORT void
+chimera_vfs_set_heavy_hitters(
+    struct chimera_vfs *vfs,
+    int                 enabled)
+{
+    __atomic_store_n(&vfs->hh_enabled, !!enabled, __ATOMIC_RELAXED);
+} /* chimera_vfs_set_heavy_hitters */
+
+SYMBOL_EXPORT int
+chimera_vfs_get_heavy_hitters(struct chimera_vfs *vfs)
+{
+    return __atomic_load_n(&vfs->hh_enabled, __ATOMIC_RELAXED);
+} /* chimera_vfs_get_heavy_hitters */
+
+static inline void
+chimera_vfs_hh_cand_begin(struct chimera_vfs_hh_cand *cand)
+{
+    __atomic_store_n(&cand->seq, cand->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+} /* chimera_vfs_hh_cand_begin */
+
+static inline void
+chimera_vfs_hh_cand_end(struct chimera_vfs_hh_cand *cand)
+{
+    __atomic_store_n(&cand->seq, cand->seq + 1, __ATOMIC_RELEASE);
+} /* chimera_vfs_hh_cand_end */
+
+/* Copy a candidate the owner may be rewriting; returns 0 if it never held
+ * still long enough. */
+static int
+chimera_vfs_hh_cand_read(
+    const struct chimera_vfs_hh_cand *cand,
+    struct chimera_vfs_hh_entry      *out)
+{
+    uint32_t seq;
+    int      tries;
+
+    for (tries = 0; tries < CHIMERA_VFS_HH_READ_TRIES; tries++) {
+        seq = __atomic_load_n(&cand->seq, __ATOMIC_ACQUIRE);
+
+        if (seq & 1) {
+            continue;
+        }
+
+        memcpy(out, &cand->entry, sizeof(*out));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&cand->seq, __ATOMIC_RELAXED) == seq) {
+            return out->key_len <= CHIMERA_VFS_HH_KEY_MAX;
+        }
+    }
+
+    return 0;
+} /* chimera_vfs_hh_cand_read */
+
+/* Owner only: drop every count in the set */
+static void
+chimera_vfs_hh_clear(struct chimera_vfs_hh_sketches *hh)
+{
+    struct chimera_vfs_hh_sketch *sketch;
+    int                           d, m, row, col;
+
+    for (d = 0; d < CHIMERA_VFS_HH_DIM_NUM; d++) {
+        for (m = 0; m < CHIMERA_VFS_HH_METRIC_NUM; m++) {
+            sketch = &hh->sketch[d][m];
+
+            for (row = 0; row < CHIMERA_VFS_HH_DEPTH; row++) {
+                for (col = 0; col < CHIMERA_VFS_HH_WIDTH; col++) {
+                    __atomic_store_n(&sketch->cm[row][col], 0, __ATOMIC_RELAXED);
+                }
+            }
+
+            __atomic_store_n(&sketch->ntop, 0, __ATOMIC_RELEASE);
+        }
+    }
+} /* chimera_vfs_hh_clear */
+
+SYMBOL_EXPORT void
+chimera_vfs_hh_reset(struct chimera_vfs *vfs)
+{
+    __atomic_add_fetch(&vfs->hh_epoch, 1, __ATOMIC_RELEASE);
+} /* chimera_vfs_hh_reset */
+
+void
+chimera_vfs_hh_init(struct chimera_vfs *vfs)
+{
+    pthread_mutex_init(&vfs->hh_lock, NULL);
+} /* chimera_vfs_hh_init */
+
+void
+chimera_vfs_hh_destroy(struct chimera_vfs *vfs)
+{
+    struct chimera_vfs_hh_sketches *hh;
+
+    while (vfs->hh_sketches) {
+        hh               = vfs->hh_sketches;
+        vfs->hh_sketches = hh->next;
+        free(hh);
+    }
+
+    pthread_mutex_destroy(&vfs->hh_lock);
+} /* chimera_vfs_hh_destroy */
+
+void
+chimera_vfs_hh_thread_init(struct chimera_vfs_thread *thread)
+{
+    /* Sketches are attached on the first recorded request, so threads that
+     * never see traffic while tracking is enabled cost nothing. */
+    thread->hh_sketches = NULL;
+} /* chimera_vfs_hh_thread_init */
+
+void
+chimera_vfs_hh_thread_destroy(struct chimera_vfs_thread *thread)
+{
+    struct chimera_vfs *vfs = thread->vfs;
+
+    if (!thread->hh_sketches) {
+        return;
+    }
+
+    pthread_mutex_lock(&vfs->hh_lock);
+    thread->hh_sketches->active = 0;
+    pthread_mutex_unlock(&vfs->hh_lock);
+
+    thread->hh_sketches = NULL;
+} /* chimera_vfs_hh_thread_destroy */
+
+static struct chimera_vfs_hh_sketches *
+chimera_vfs_hh_attach(struct chimera_vfs_thread *thread)
+{
+    struct chimera_vfs             *vfs = thread->vfs;
+    struct chimera_vfs_hh_sketches *hh;
+
+    pthread_mutex_lock(&vfs->hh_lock);
+
+    for (hh = vfs->hh_sketches; hh; hh = hh->next) {
+        if (!hh->active) {
+            break;
+        }
+    }
+
+    if (!hh) {
+        hh = calloc(1, sizeof(*hh));
+
+        if (!hh) {
+            pthread_mutex_unlock(&vfs->hh_lock);
+            return NULL;
+        }
+
+        hh->epoch        = __atomic_load_n(&vfs->hh_epoch, __ATOMIC_ACQUIRE);
+        hh->last_decay   = chimera_vfs_now_ticks();
+        hh->next         = vfs->hh_sketches;
+        vfs->hh_sketches = hh;
+    }
+
+    hh->active = 1;
+
+    pthread_mutex_unlock(&vfs->hh_lock);
+
+    thread->hh_sketches = hh;
+
+    return hh;
+} /* chimera_vfs_hh_attach */
+
+static inline uint32_t
+chimera_vfs_hh_slot(
+    uint64_t hash,
+    int      row)
+{
+    uint32_t h1 = (uint32_t) hash;
+    uint32_t h2 = (uint32_t) (hash >> 32) | 1;
+
+    return (h1 + row * h2) & (CHIMERA_VFS_HH_WIDTH - 1);
+} /* chimera_vfs_hh_slot */
+
+static inline uint64_t
+chimera_vfs_hh_estimate(
+    const struct chimera_vfs_hh_sketch *sketch,
+    uint64_t                            hash)
+{
+    uint64_t est = UINT64_MAX, c;
+    int      row;
+
+    for (row = 0; row < CHIMERA_VFS_HH_DEPTH; row++) {
+        c = __atomic_load_n(&sketch->cm[row][chimera_vfs_hh_slot(hash, row)], __ATOMIC_RELAXED);
+
+        if (c < est) {
+            est = c;
+        }
+    }
+
+    return est;
+} /* chimera_vfs_hh_estimate */
+
+static void
+chimera_vfs_hh_update(
+    struct chimera_vfs_hh_sketch *sketch,
+    uint64_t                      hash,
+    const void                   *key,
+    int                           key_len,
+    uint64_t                      amount)
+{
+    struct chimera_vfs_hh_cand *cand, *min = NULL;
+    uint64_t                    est = UINT64_MAX, *c, v;
+    int                         row, i, append = 0;
+
+    /* Single writer: a load and a store, no read-modify-write */
+    for (row = 0; row < CHIMERA_VFS_HH_DEPTH; row++) {
+        c = &sketch->cm[row][chimera_vfs_hh_slot(hash, row)];
+        v = *c + amount;
+        __atomic_store_n(c, v, __ATOMIC_RELAXED);
+
+        if (v < est) {
+            est = v;
+        }
+    }
+
+    for (i = 0; i < sketch->ntop; i++) {
+        cand = &sketch->top[i];
+
+        if (cand->entry.hash == hash) {
+            __atomic_store_n(&cand->entry.count, est, __ATOMIC_RELAXED);
+            return;
+        }
+
+        if (!min || cand->entry.count < min->entry.count) {
+            min = cand;
+        }
+    }
+
+    if (sketch->ntop < CHIMERA_VFS_HH_TOPK) {
+        cand   = &sketch->top[sketch->ntop];
+        append = 1;
+    } else if (est > min->entry.count) {
+        cand = min;
+    } else {
+        return;
+    }
+
+    if (key_len > CHIMERA_VFS_HH_KEY_MAX) {
+        key_len = CHIMERA_VFS_HH_KEY_MAX;
+    }
+
+    chimera_vfs_hh_cand_begin(cand);
+    cand->entry.hash    = hash;
+    cand->entry.count   = est;
+    cand->entry.key_len = key_len;
+    memcpy(cand->entry.key, key, key_len);
+    chimera_vfs_hh_cand_end(cand);
+
+    if (append) {
+        __atomic_store_n(&sketch->ntop, sketch->ntop + 1, __ATOMIC_RELEASE);
+    }
+} /* chimera_vfs_hh_update */
+
+static inline uint64_t
+chimera_vfs_hh_decay_ticks(void)
+{
+    return chimera_vfs_ns_to_ticks(CHIMERA_VFS_HH_DECAY_SECS * 1000000000ULL);
+} /* chimera_vfs_hh_decay_ticks */
+
+/* Whole decay periods between `since` and `now`, capped at one full shift */
+static inline int
+chimera_vfs_hh_decay_periods(
+    uint64_t since,
+    uint64_t now)
+{
+    uint64_t periods = now > since ? (now - since) / chimera_vfs_hh_decay_ticks() : 0;
+
+    return periods > 63 ? 63 : (int) periods;
+} /* chimera_vfs_hh_decay_periods */
+
+/* Owner only: halve every count `shift` times */
+static void
+chimera_vfs_hh_decay(
+    struct chimera_vfs_hh_sketches *hh,
+    int                             shift)
+{
+    struct chimera_vfs_hh_sketch *sketch;
+    uint64_t                      count;
+    int                           d, m, row, col, i, n;
+
+    for (d = 0; d < CHIMERA_VFS_HH_DIM_NUM; d++) {
+        for (m = 0; m < CHIMERA_VFS_HH_METRIC_NUM; m++) {
+            sketch = &hh->sketch[d][m];
+
+            for (row = 0; row < CHIMERA_VFS_HH_DEPTH; row++) {
+                for (col = 0; col < CHIMERA_VFS_HH_WIDTH; col++) {
+                    __atomic_store_n(&sketch->cm[row][col], sketch->cm[row][col] >> shift,
+                                     __ATOMIC_RELAXED);
+                }
+            }
+
+            /* Compact out candidates that decayed to nothing.  A reader still
+             * walking the old ntop may see a moved key twice; it de-duplicates
+             * by hash. */
+            for (i = 0, n = 0; i < sketch->ntop; i++) {
+                count = sketch->top[i].entry.count >> shift;
+
+                if (!count) {
+                    continue;
+                }
+
+                if (n != i) {
+                    chimera_vfs_hh_cand_begin(&sketch->top[n]);
+                    sketch->top[n].entry       = sketch->top[i].entry;
+                    sketch->top[n].entry.count = count;
+                    chimera_vfs_hh_cand_end(&sketch->top[n]);
+                } else {
+                    __atomic_store_n(&sketch->top[n].entry.count, count, __ATOMIC_RELAXED);
+                }
+                n++;
+            }
+
+            __atomic_store_n(&sketch->ntop, n, __ATOMIC_RELEASE);
+        }
+    }
+} /* chimera_vfs_hh_decay */
+
+static inline int
+chimera_vfs_hh_is_dir_op(uint32_t opcode)
+{
+    switch (opcode) {
+        case CHIMERA_VFS_OP_LOOKUP_AT:
+        case CHIMERA_VFS_OP_READDIR:
+        case CHIMERA_VFS_OP_OPEN_AT:
+        case CHIMERA_VFS_OP_REMOVE_AT:
+        case CHIMERA_VFS_OP_MKDIR_AT:
+        case CHIMERA_VFS_OP_SYMLINK_AT:
+        case CHIMERA_VFS_OP_RENAME_AT:
+        case CHIMERA_VFS_OP_LINK_AT:
+        case CHIMERA_VFS_OP_MKNOD_AT:
+            return 1;
+        default:
+            return 0;
+    } /* switch */
+} /* chimera_vfs_hh_is_dir_op */
+
+void
+chimera_vfs_hh_record(
+    struct chimera_vfs_thread  *thread,
+    struct chimera_vfs_request *request)
+{
+    struct chimera_vfs_hh_sketches  *hh     = thread->hh_sketches;
+    struct chimera_vfs_trace_client *client = request->trace_client;
+    uint64_t                         now, epoch, bytes = 0, export_hash = 0, fh_hash = 0;
+    int                              has_export, has_fh, periods;
+
+    if (unlikely(!hh)) {
+        hh = chimera_vfs_hh_attach(thread);
+
+        if (!hh) {
+            return;
+        }
+    }
+
+    if (request->status == CHIMERA_VFS_OK) {
+        if (request->opcode == CHIMERA_VFS_OP_READ) {
+            bytes = request->read.r_length;
+        } else if (request->opcode == CHIMERA_VFS_OP_WRITE) {
+            bytes = request->write.r_length;
+        }
+    }
+
+    has_export = request->fh_len >= CHIMERA_VFS_MOUNT_ID_SIZE;
+    has_fh     = request->fh_len > 0;
+
+    if (has_export) {
+        export_hash = chimera_vfs_hash(request->fh, CHIMERA_VFS_MOUNT_ID_SIZE);
+    }
+
+    if (has_fh) {
+        fh_hash = chimera_vfs_hash(request->fh, request->fh_len);
+    }
+
+    now   = chimera_vfs_now_ticks();
+    epoch = __atomic_load_n(&thread->vfs->hh_epoch, __ATOMIC_ACQUIRE);
+
+    if (unlikely(hh->epoch != epoch)) {
+        chimera_vfs_hh_clear(hh);
+        __atomic_store_n(&hh->last_decay, now, __ATOMIC_RELAXED);
+        __atomic_store_n(&hh->epoch, epoch, __ATOMIC_RELEASE);
+    } else if (now - hh->last_decay >= chimera_vfs_hh_decay_ticks()) {
+        /* Catch up on every period the thread sat idle through.  Readers
+         * scale by the same periods until last_decay moves, so one that
+         * races this may see a set halved once too often. */
+        periods = chimera_vfs_hh_decay_periods(hh->last_decay, now);
+        chimera_vfs_hh_decay(hh, periods);
+        __atomic_store_n(&hh->last_decay,
+                         periods == 63 ? now : hh->last_decay + periods * chimera_vfs_hh_decay_ticks(),
+                         __ATOMIC_RELAXED);
+    }
+
+    /* Interned with its hash when the call was received */
+    if (client) {
+        chimera_vfs_hh_update(&hh->sketch[CHIMERA_VFS_HH_CLIENT][CHIMERA_VFS_HH_OPS],
+                              client->hash, client->name, client->len, 1);
+        if (bytes) {
+            chimera_vfs_hh_update(&hh->sketch[CHIMERA_VFS_HH_CLIENT][CHIMERA_VFS_HH_BYTES],
+                                  client->hash, client->name, client->len, bytes);
+        }
+    }
+
+    if (has_export) {
+        chimera_vfs_hh_update(&hh->sketch[CHIMERA_VFS_HH_EXPORT][CHIMERA_VFS_HH_OPS],
+                              export_hash, request->fh, CHIMERA_VFS_MOUNT_ID_SIZE, 1);
+        if (bytes) {
+            chimera_vfs_hh_update(&hh->sketch[CHIMERA_VFS_HH_EXPORT][CHIMERA_VFS_HH_BYTES],
+                                  export_hash, request->fh, CHIMERA_VFS_MOUNT_ID_SIZE, bytes);
+        }
+    }
+
+    if (has_fh) {
+        chimera_vfs_hh_update(&hh->sketch[CHIMERA_VFS_HH_FILE][CHIMERA_VFS_HH_OPS],
+                              fh_hash, request->fh, request->fh_len, 1);
+        if (bytes) {
+            chimera_vfs_hh_update(&hh->sketch[CHIMERA_VFS_HH_FILE][CHIMERA_VFS_HH_BYTES],
+                                  fh_hash, request->fh, request->fh_len, bytes);
+        }
+
+        /* Namespace ops carry the directory as their fh; there are no bytes
+         * to account to a directory. */
+        if (chimera_vfs_hh_is_dir_op(request->opcode)) {
+            chimera_vfs_hh_update(&hh->sketch[CHIMERA_VFS_HH_DIRECTORY][CHIMERA_VFS_HH_OPS],
+                                  fh_hash, request->fh, request->fh_len, 1);
+        }
+    }
+} /* chimera_vfs_hh_record */
+
+static int
+chimera_vfs_hh_entry_cmp(
+    const void *a,
+    const void *b)
+{
+    const struct chimera_vfs_hh_entry *ea = a;
+    const struct chimera_vfs_hh_entry *eb = b;
+
+    if (ea->count != eb->count) {
+        return ea->count < eb->count ? 1 : -1;
+    }
+
+    return ea->hash < eb->hash ? -1 : ea->hash > eb->hash;
+} /* chimera_vfs_hh_entry_cmp */
+
+SYMBOL_EXPORT int
+chimera_vfs_hh_top(
+    struct chimera_vfs          *vfs,
+    int                          dim,
+    int                          metric,
+    struct chimera_vfs_hh_entry *out,
+    int                          max)
+{
+    struct chimera_vfs_hh_sketches *hh;
+    struct chimera_vfs_hh_sketch   *sketch;
+    struct chimera_vfs_hh_entry    *cand = NULL, *tmp, entry;
+    uint64_t                        epoch, now;
+    int                             ncand = 0, capcand = 0, ntop, i, j, shift;
+
+    if (dim < 0 || dim >= CHIMERA_VFS_HH_DIM_NUM ||
+        metric < 0 || metric >= CHIMERA_VFS_HH_METRIC_NUM || max <= 0) {
+        return 0;
+    }
+
+    epoch = __atomic_load_n(&vfs->hh_epoch, __ATOMIC_ACQUIRE);
+
+    /* hh_lock only keeps the list stable; the owners keep writing */
+    pthread_mutex_lock(&vfs->hh_lock);
+
+    /* Pool every thread's candidates, de-duplicated by key hash.  Sets not
+     * yet cleared since the last reset are ignored. */
+    for (hh = vfs->hh_sketches; hh; hh = hh->next) {
+        if (__atomic_load_n(&hh->epoch, __ATOMIC_ACQUIRE) != epoch) {
+            continue;
+        }
+
+        if (capcand - ncand < CHIMERA_VFS_HH_TOPK) {
+            capcand += 4 * CHIMERA_VFS_HH_TOPK;
+            tmp      = realloc(cand, capcand * sizeof(*cand));
+
+            if (!tmp) {
+                break;
+            }
+
+            cand = tmp;
+        }
+
+        sketch = &hh->sketch[dim][metric];
+        ntop   = __atomic_load_n(&sketch->ntop, __ATOMIC_ACQUIRE);
+
+        for (i = 0; i < ntop; i++) {
+            if (!chimera_vfs_hh_cand_read(&sketch->top[i], &entry)) {
+                continue;
+            }
+
+            for (j = 0; j < ncand; j++) {
+                if (cand[j].hash == entry.hash) {
+                    break;
+                }
+            }
+
+            if (j == ncand) {
+                cand[ncand++] = entry;
+            }
+        }
+    }
+
+    /* Re-estimate each candidate across all threads' count-min tables, so a
+     * key spread thinly over many threads still ranks by its total.  A set
+     * whose owner has not decayed it on time (no requests since) is scaled
+     * here instead. */
+    for (j = 0; j < ncand; j++) {
+        cand[j].count = 0;
+    }
+
+    now = chimera_vfs_now_ticks();
+
+    for (hh = vfs->hh_sketches; hh && ncand; hh = hh->next) {
+        if (__atomic_load_n(&hh->epoch, __ATOMIC_ACQUIRE) != epoch) {
+            continue;
+        }
+
+        sketch = &hh->sketch[dim][metric];
+        shift  = chimera_vfs_hh_decay_periods(__atomic_load_n(&hh->last_decay, __ATOMIC_RELAXED), now);
+
+        for (j = 0; j < ncand; j++) {
+            cand[j].count += chimera_vfs_hh_estimate(sketch, cand[j].hash) >> shift;
+        }
+    }
+
+    pthread_mutex_unlock(&vfs->hh_lock);
+
+    /* Keys that have decayed away entirely */
+    for (i = 0, j = 0; j < ncand; j++) {
+        if (cand[j].count) {
+            cand[i++] = cand[j];
+        }
+    }
+    ncand = i;
+
+    qsort(cand, ncand, sizeof(*cand), chimera_vfs_hh_entry_cmp);
+
+    if (ncand > max) {
+        ncand = max;
+    }
+
+    if (ncand) {
+        memcpy(out, cand, ncand * sizeof(*cand));
+    }
+
+    free(cand);
+
+    return ncand;
+} /* chimera_vfs_hh_top */
+
+/*
+ * Walk fh up through the RPL cache, filling `out` with the path below the
+ * deepest resolved ancestor.  Returns the number of components resolved and
+ * sets *r_at_root if the walk ended at the mount root.
+ */
+static int
+chimera_vfs_hh_cached_path(
+    struct chimera_vfs             *vfs,
+    const struct chimera_vfs_mount *mount,
+    const uint8_t                  *fh,
+    int                             fh_len,
+    char                           *out,
+    int                             outlen,
+    int                            *r_at_root)
+{
+    struct chimera_vfs_rpl_cache *cache;
+    uint8_t                       cur[CHIMERA_VFS_FH_SIZE], parent[CHIMERA_VFS_FH_SIZE];
+    uint16_t                      cur_len, parent_len, name_len;
+    char                          name[CHIMERA_VFS_NAME_MAX];
+    int                           pos = outlen - 1, depth;
+
+    *r_at_root = 0;
+    out[pos]   = '\0';
+
+    if (!vfs->vfs_notify || !vfs->vfs_notify->rpl_cache ||
+        fh_len > CHIMERA_VFS_FH_SIZE) {
+        out[0] = '\0';
+        return 0;
+    }
+
+    cache   = vfs->vfs_notify->rpl_cache;
+    cur_len = fh_len;
+    memcpy(cur, fh, fh_len);
+
+    for (depth = 0; depth < CHIMERA_VFS_HH_PATH_DEPTH; depth++) {
+        if (mount && cur_len == mount->root_fh_len &&
+            memcmp(cur, mount->root_fh, cur_len) == 0) {
+            *r_at_root = 1;
+            break;
+        }
+
+        if (chimera_vfs_rpl_cache_lookup(cache, chimera_vfs_hash(cur, cur_len),
+                                         cur, cur_len, parent, &parent_len,
+                                         name, &name_len) != 0 ||
+            parent_len > CHIMERA_VFS_FH_SIZE ||
+            pos < name_len + 1) {
+            break;
+        }
+
+        pos -= name_len;
+        memcpy(out + pos, name, name_len);
+        out[--pos] = '/';
+
+        memcpy(cur, parent, parent_len);
+        cur_len = parent_len;
+    }
+
+    memmove(out, out + pos, outlen - pos);
+
+    return depth;
+} /* chimera_vfs_hh_cached_path */
+
+SYMBOL_EXPORT void
+chimera_vfs_hh_key_name(
+    struct chimera_vfs                *vfs,
+    int                                dim,
+    const struct chimera_vfs_hh_entry *entry,
+    char                              *out,
+    int                                outlen)
+{
+    struct chimera_vfs_mount *mount = NULL;
+    char                      mount_path[256];
+    char                      path[CHIMERA_VFS_PATH_MAX];
+    int                       components, at_root;
+
+    if (dim == CHIMERA_VFS_HH_CLIENT) {
+        snprintf(out, outlen, "%.*s", entry->key_len, (const char *) entry->key);
+        return;
+    }
+
+    mount_path[0] = '\0';
+
+    /* Callers include the metrics thread, which is not a VFS thread */
+    chimera_vfs_rcu_reader_enter();
+    urcu_qsbr_read_lock();
+
+    if (entry->key_len >= CHIMERA_VFS_MOUNT_ID_SIZE) {
+        mount = chimera_vfs_mount_table_lookup(vfs->mount_table, entry->key);
+    }
+
+    if (mount) {
+        snprintf(mount_path, sizeof(mount_path), "%s", mount->path);
+    }
+
+    if (dim == CHIMERA_VFS_HH_EXPORT) {
+        urcu_qsbr_read_unlock();
+        chimera_vfs_rcu_reader_leave();
+
+        if (mount_path[0]) {
+            snprintf(out, outlen, "%s", mount_path);
+        } else {
+            format_hex(out, outlen, entry->key, entry->key_len);
+        }
+        return;
+    }
+
+    components = chimera_vfs_hh_cached_path(vfs, mount, entry->key, entry->key_len,
+                                            path, sizeof(path), &at_root);
+
+    urcu_qsbr_read_unlock();
+    chimera_vfs_rcu_reader_leave();
+
+    if (at_root) {
+        snprintf(out, outlen, "%s%s", mount_path, path);
+    } else if (components) {
+        snprintf(out, outlen, "%s/...%s", mount_path[0] ? mount_path : "?", path);
+    } else {
+        format_hex(out, outlen, entry->key, entry->key_len);
+    }
+} /* chimera_vfs_hh_key_name */
+
+/* Escape a key for use as a Prometheus label value */
+static void
+chimera_vfs_hh_label_escape(
+    const char *in,
+    char       *out,
+    int         outlen)
+{
+    int o = 0;
+
+    for (; *in && o < outlen - 2; in++) {
+        if (*in == '"' || *in == '\\') {
+            out[o++] = '\\';
+            out[o++] = *in;
+        } else if (*in == '\n') {
+            out[o++] = '\\';
+            out[o++] = 'n';
+        } else {
+            out[o++] = *in;
+        }
+    }
+
+    out[o] = '\0';
+} /* chimera_vfs_hh_label_escape */
+
+#define HH_SCRAPE_APPEND(...)                                        \
+        do {                                                         \
+            int n_ = snprintf(buf + len, cap - len, __VA_ARGS__);    \
+            if (n_ < 0 || n_ >= cap - len) {                         \
+                len = -1;                                            \
+                goto out;                                            \
+            }                                                        \
+            len += n_;                                               \
+        } while (0)
+
+SYMBOL_EXPORT int
+chimera_vfs_hh_scrape(
+    struct chimera_vfs *vfs,
+    char               *buf,
+    int                 cap)
+{
+    struct chimera_vfs_hh_entry top[CHIMERA_VFS_HH_PROM_TOPN];
+    char                        name[CHIMERA_VFS_PATH_MAX], label[2 * CHIMERA_VFS_PATH_MAX];
+    int                         len = 0, dim, metric, n, i;
+
+    if (!chimera_vfs_get_heavy_hitters(vfs)) {
+        return 0;
+    }
+
+    /* Register once for the whole page rather than per key name */
+    chimera_vfs_rcu_reader_enter();
+
+    /* Cardinality is bounded by rank: at most PROM_TOPN series per
+     * (dimension, metric), whatever the key churn. */
+    for (metric = 0; metric < CHIMERA_VFS_HH_METRIC_NUM; metric++) {
+        HH_SCRAPE_APPEND("# HELP chimera_vfs_top_%s Decayed %s of the heaviest keys per dimension\n"
+                         "# TYPE chimera_vfs_top_%s gauge\n",
+                         chimera_vfs_hh_metric_name(metric), chimera_vfs_hh_metric_name(metric),
+                         chimera_vfs_hh_metric_name(metric));
+
+        for (dim = 0; dim < CHIMERA_VFS_HH_DIM_NUM; dim++) {
+            n = chimera_vfs_hh_top(vfs, dim, metric, top, CHIMERA_VFS_HH_PROM_TOPN);
+
+            for (i = 0; i < n; i++) {
+                chimera_vfs_hh_key_name(vfs, dim, &top[i], name, sizeof(name));
+                chimera_vfs_hh_label_escape(name, label, sizeof(label));
+
+                HH_SCRAPE_APPEND("chimera_vfs_top_%s{dimension=\"%s\",rank=\"%d\",key=\"%s\"} %lu\n",
+                                 chimera_vfs_hh_metric_name(metric), chimera_vfs_hh_dim_name(dim),
+                                 i + 1, label, top[i].count);
+            }
+        }
+    }
+
+ out:
+    chimera_vfs_rcu_reader_leave();
+
+    return len;
+} /* chimera_vfs_hh_scrape */
@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#pragma once
+
+#include <stdint.h>
+
+#include "vfs_attrs.h"
+#include "vfs_trace.h"
+
+/*
+ * Heavy-hitter tracking: who and what is generating the load.
+ *
+ * While enabled (chimera_vfs_set_heavy_hitters), every VFS request is fed to
+ * a set of per-thread streaming sketches, one per (dimension, metric) pair:
+ *
+ *   dimension  client     protocol client address
+ *              export     mount the fh belongs to
+ *              file       fh the op targets
+ *              directory  fh of the directory a namespace op targets
+ *   metric     ops        one per request
+ *              bytes      bytes read or written
+ *
+ * Each sketch is a count-min table (for frequency estimates of any key) plus
+ * a small top-K candidate list.  Sketches have a single writer, their VFS
+ * thread, which updates them without taking a lock or issuing an atomic
+ * read-modify-write: counters are relaxed stores and each candidate carries
+ * a sequence count.  They are merged only when read: the reader copies the
+ * candidates from every thread, retrying any caught mid-rewrite, pools them
+ * and re-estimates each by summing every thread's count-min.  Estimates may
+ * lag an in-flight update by one request.
+ *
+ * Counts decay by half every CHIMERA_VFS_HH_DECAY_SECS so the lists reflect
+ * recent load rather than everything since startup.  A thread applies the
+ * decay on its next request; readers scale the counts of a thread that has
+ * gone idle by the elapsed periods, so its keys still fade.
+ */
+
+enum chimera_vfs_hh_dim {
+    CHIMERA_VFS_HH_CLIENT = 0,
+    CHIMERA_VFS_HH_EXPORT,
+    CHIMERA_VFS_HH_FILE,
+    CHIMERA_VFS_HH_DIRECTORY,
+    CHIMERA_VFS_HH_DIM_NUM
+};
+
+enum chimera_vfs_hh_metric {
+    CHIMERA_VFS_HH_OPS = 0,
+    CHIMERA_VFS_HH_BYTES,
+    CHIMERA_VFS_HH_METRIC_NUM
+};
+
+#define CHIMERA_VFS_HH_DEPTH      4
+#define CHIMERA_VFS_HH_WIDTH      512    /* power of two */
+#define CHIMERA_VFS_HH_TOPK       32
+#define CHIMERA_VFS_HH_KEY_MAX    CHIMERA_VFS_FH_SIZE
+#define CHIMERA_VFS_HH_DECAY_SECS 10
+
+/* Series per (dimension, metric) on the Prometheus endpoint */
+#define CHIMERA_VFS_HH_PROM_TOPN  10
+
+struct chimera_vfs;
+struct chimera_vfs_thread;
+struct chimera_vfs_request;
+struct chimera_vfs_hh_sketches;
+
+struct chimera_vfs_hh_entry {
+    uint64_t hash;
+    uint64_t count;
+    uint16_t key_len;
+    uint8_t  key[CHIMERA_VFS_HH_KEY_MAX];
+};
+
+const char *
+chimera_vfs_hh_dim_name(
+    int dim);
+
+const char *
+chimera_vfs_hh_metric_name(
+    int metric);
+
+void
+chimera_vfs_set_heavy_hitters(
+    struct chimera_vfs *vfs,
+    int                 enabled);
+
+int
+chimera_vfs_get_heavy_hitters(
+    struct chimera_vfs *vfs);
+
+/*
+ * Drop all counts on every thread.  Readers stop seeing them at once; each
+ * thread clears its own sketches on its next recorded request.
+ */
+void
+chimera_vfs_hh_reset(
+    struct chimera_vfs *vfs);
+
+/*
+ * Merge every thread's sketches for one (dimension, metric) and write up to
+ * `max` of the heaviest keys, largest first, into `out`.  Returns the number
+ * written.  Safe to call from any thread.
+ */
+int
+chimera_vfs_hh_top(
+    struct chimera_vfs          *vfs,
+    int                          dim,
+    int                          metric,
+    struct chimera_vfs_hh_entry *out,
+    int                          max);
+
+/*
+ * Render a key for display: the client address, the mount path for exports,
+ * and for file and directory keys the path under its mount as far as the
+ * reverse-path-lookup cache can resolve it, falling back to the hex fh.
+ * Safe to call from any thread: one that is not a VFS thread is registered
+ * as an RCU reader while the mount table and cache are walked.
+ */
+void
+chimera_vfs_hh_key_name(
+    struct chimera_vfs                *vfs,
+    int                                dim,
+    const struct chimera_vfs_hh_entry *entry,
+    char                              *out,
+    int                                outlen);
+
+/*
+ * Write the top CHIMERA_VFS_HH_PROM_TOPN keys of every sketch as
+ * chimera_vfs_top_* Prometheus text exposition.  Returns bytes written, or
+ * -1 if `cap` was too small.
+ */
+int
+chimera_vfs_hh_scrape(
+    struct chimera_vfs *vfs,
+    char               *buf,
+    int                 cap);
+
+/* VFS-internal lifecycle, called from vfs.c. */
+void
+chimera_vfs_hh_init(
+    struct chimera_vfs *vfs);
+
+void
+chimera_vfs_hh_destroy(
+    struct chimera_vfs *vfs);
+
+void
+chimera_vfs_hh_thread_init(
+    struct chimera_vfs_thread *thread);
+
+void
+chimera_vfs_hh_thread_destroy(
+    struct chimera_vfs_thread *thread);
+
+/* Account a finished request to the calling thread's sketches. */
+void
+chimera_vfs_hh_record(
+    struct chimera_vfs_thread  *thread,
+    struct chimera_vfs_request *request);
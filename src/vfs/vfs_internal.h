@@ -203,6 +203,99 @@ chimera_vfs_kv_route_fh(
     }
 } /* chimera_vfs_kv_route_fh */
 
+/*
+ * Latency tracing hooks (see vfs_trace.h).  Untraced requests have
+ * trace_mask == 0 and only pay the branch.
+ */
+static inline void
+chimera_vfs_trace_client_put(
+    struct chimera_vfs_thread       *thread,
+    struct chimera_vfs_trace_client *client)
+{
+    if (--client->refcnt == 0) {
+        LL_PREPEND(thread->trace_client_free, client);
+    }
+} /* chimera_vfs_trace_client_put */
+
+static inline void
+chimera_vfs_trace_start(
+    struct chimera_vfs_thread  *thread,
+    struct chimera_vfs_request *request)
+{
+    struct chimera_vfs *vfs      = thread->vfs;
+    uint32_t            interval = __atomic_load_n(&vfs->trace_interval, __ATOMIC_RELAXED);
+    uint64_t            slow     = __atomic_load_n(&vfs->slow_op_threshold_ticks, __ATOMIC_RELAXED);
+
+    request->trace_mask = 0;
+
+    if (likely(interval == 0 && slow == 0)) {
+        return;
+    }
+
+    request->trace_sampled = 0;
+
+    if (interval && ++thread->trace_count >= interval) {
+        thread->trace_count    = 0;
+        request->trace_sampled = 1;
+    }
+
+    /* The slow-op recorder needs every request stamped */
+    if (!request->trace_sampled && !slow) {
+        return;
+    }
+
+    request->trace_proto = thread->trace_recv_proto;
+    request->trace_ticks[CHIMERA_VFS_TRACE_RECEIVE] =
+        thread->trace_recv_ticks ? thread->trace_recv_ticks : chimera_vfs_now_ticks();
+    request->trace_mask = 1 << CHIMERA_VFS_TRACE_RECEIVE;
+
+    request->trace_client = thread->trace_recv_client;
+    if (request->trace_client) {
+        request->trace_client->refcnt++;
+    }
+} /* chimera_vfs_trace_start */
+
+/*
+ * Heavy-hitter accounting (see vfs_heavy_hitters.h).  The client is only
+ * known while the protocol call is being received, so take a reference to
+ * it now; the request is recorded when it is freed, once its byte count is
+ * known.
+ */
+static inline void
+chimera_vfs_hh_start(
+    struct chimera_vfs_thread  *thread,
+    struct chimera_vfs_request *request)
+{
+    request->hh_active = 0;
+
+    if (likely(!__atomic_load_n(&thread->vfs->hh_enabled, __ATOMIC_RELAXED))) {
+        return;
+    }
+
+    request->hh_active = 1;
+
+    /* chimera_vfs_trace_start already took it for stamped requests */
+    if (request->trace_mask) {
+        return;
+    }
+
+    request->trace_client = thread->trace_recv_client;
+    if (request->trace_client) {
+        request->trace_client->refcnt++;
+    }
+} /* chimera_vfs_hh_start */
+
+static inline void
+chimera_vfs_trace_stamp(
+    struct chimera_vfs_request  *request,
+    enum chimera_vfs_trace_stage stage)
+{
+    if (unlikely(request->trace_mask)) {
+        request->trace_ticks[stage] = chimera_vfs_now_ticks();
+        request->trace_mask        |= 1 << stage;
+    }
+} /* chimera_vfs_trace_stamp */
+
 /*
  * Common request allocation helper with capability enforcement.
  * Returns ERR_PTR on failure:
@@ -269,6 +362,10 @@ chimera_vfs_request_alloc_common(
     request->wait_arg1     = 0;
     request->wait_arg2     = 0;
 
+    chimera_vfs_trace_start(thread, request);
+    chimera_vfs_hh_start(thread, request);
+    chimera_thread_stats_work(1);
+
     thread->num_active_requests++;
     DL_APPEND2(thread->active_requests, request, active_prev, active_next);
 
@@ -397,6 +494,12 @@ chimera_vfs_complete(struct chimera_vfs_request *request)
                                          &request->start_time);
     }
 
+    /* Delegated requests were already stamped on the delegation thread. */
+    if (unlikely(request->trace_mask) &&
+        !(request->trace_mask & (1 << CHIMERA_VFS_TRACE_COMPLETE))) {
+        chimera_vfs_trace_stamp(request, CHIMERA_VFS_TRACE_COMPLETE);
+    }
+
     chimera_vfs_dump_reply(request);
 } /* chimera_vfs_complete */
 
@@ -411,6 +514,19 @@ chimera_vfs_request_free(
                          "clang static analysis thinks this can happen");
 #endif /* ifdef __clang_analyzer__ */
 
+    if (unlikely(request->trace_mask)) {
+        chimera_vfs_trace_finish(thread, request);
+    }
+
+    if (unlikely(request->hh_active)) {
+        chimera_vfs_hh_record(thread, request);
+    }
+
+    if (unlikely(request->trace_client)) {
+        chimera_vfs_trace_client_put(thread, request->trace_client);
+        request->trace_client = NULL;
+    }
+
     DL_DELETE2(thread->active_requests, request, active_prev, active_next);
 
     thread->num_active_requests--;
@@ -423,8 +539,11 @@ chimera_vfs_complete_delegate(struct chimera_vfs_request *request)
 {
     struct chimera_vfs_thread *thread = request->thread;
 
+    chimera_vfs_trace_stamp(request, CHIMERA_VFS_TRACE_COMPLETE);
+
     pthread_mutex_lock(&thread->lock);
     DL_APPEND(thread->pending_complete_requests, request);
+    chimera_thread_stats_queue(thread->stats, 1);
     pthread_mutex_unlock(&thread->lock);
 
     evpl_ring_doorbell(&thread->doorbell);
@@ -443,6 +562,7 @@ chimera_vfs_io_resume_post(struct chimera_vfs_request *request)
 
     pthread_mutex_lock(&thread->lock);
     DL_APPEND(thread->pending_io_resume, request);
+    chimera_thread_stats_queue(thread->stats, 1);
     pthread_mutex_unlock(&thread->lock);
 
     evpl_ring_doorbell(&thread->doorbell);
@@ -456,8 +576,11 @@ chimera_vfs_post_to_delegation(
     request->complete_delegate = request->complete;
     request->complete          = chimera_vfs_complete_delegate;
 
+    chimera_vfs_trace_stamp(request, CHIMERA_VFS_TRACE_ENQUEUE);
+
     pthread_mutex_lock(&delegation_thread->lock);
     DL_APPEND(delegation_thread->requests, request);
+    chimera_thread_stats_queue(delegation_thread->stats, 1);
     pthread_mutex_unlock(&delegation_thread->lock);
 
     evpl_ring_doorbell(&delegation_thread->doorbell);
@@ -546,6 +669,8 @@ chimera_vfs_dispatch(struct chimera_vfs_request *request)
 
     chimera_vfs_dump_request(request);
 
+    chimera_vfs_trace_stamp(request, CHIMERA_VFS_TRACE_DISPATCH);
+
     if (!module || !thread->module_private[module->fh_magic]) {
         request->status = CHIMERA_VFS_ESTALE;
         request->complete(request);
@@ -7,6 +7,7 @@
 #include "vfs/vfs.h"
 #include "vfs/vfs_rcu_pool.h"
 #include <urcu/urcu-qsbr.h>
+#include "common/lock_profile.h"
 
 struct chimera_vfs_name_cache_entry {
     struct chimera_rcu_node rnode; /* must be first: aliases the entry pointer */
@@ -266,7 +267,7 @@ chimera_vfs_name_cache_insert(
 
     urcu_qsbr_read_lock();
 
-    pthread_mutex_lock(&shard->entry_lock);
+    chimera_mutex_lock(&shard->entry_lock, "vfs_name_cache");
 
     best_entry = *slot_best;
 
@@ -354,7 +355,7 @@ chimera_vfs_name_cache_remove(
 
     urcu_qsbr_read_lock();
 
-    pthread_mutex_lock(&shard->entry_lock);
+    chimera_mutex_lock(&shard->entry_lock, "vfs_name_cache");
 
     while (slot < slot_end) {
 
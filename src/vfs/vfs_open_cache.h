@@ -8,6 +8,7 @@
 
 #include "common/format.h"
 #include "common/misc.h"
+#include "common/lock_profile.h"
 #include "vfs.h"
 #include "vfs_procs.h"
 #include "vfs_internal.h"
@@ -298,7 +299,7 @@ chimera_vfs_open_cache_release(
 
     chimera_vfs_abort_if(handle->cache_id != shard->cache_id, "handle released by wrong cache");
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     handle->flags &= ~CHIMERA_VFS_OPEN_HANDLE_EXCLUSIVE;
 
@@ -362,7 +363,7 @@ chimera_vfs_open_cache_dup(
 
     chimera_vfs_abort_if(handle->cache_id != shard->cache_id, "handle duped by wrong cache");
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     chimera_vfs_abort_if(handle->opencnt == 0, "dup on handle with zero opencnt");
 
@@ -403,7 +404,7 @@ chimera_vfs_open_cache_evict(
         struct vfs_open_cache_shard    *shard = &cache->shards[s];
         struct chimera_vfs_open_handle *handle;
 
-        pthread_mutex_lock(&shard->lock);
+        chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
         for (handle = shard->handles; handle; handle = handle->bucket_next) {
             if (handle->fh_len == fhlen && memcmp(handle->fh, fh, fhlen) == 0) {
@@ -473,7 +474,7 @@ chimera_vfs_open_cache_populate(
 
     shard = &cache->shards[handle->fh_hash & cache->shard_mask];
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     handle->vfs_private = vfs_private_data;
     handle->flags      &= ~CHIMERA_VFS_OPEN_HANDLE_PENDING;
@@ -519,7 +520,7 @@ chimera_vfs_open_cache_acquire(
 
     shard = &cache->shards[fh_hash & cache->shard_mask];
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     handle = chimera_vfs_open_cache_shard_find(shard, fh, fhlen, access_mode, cred_hash);
 
@@ -646,7 +647,7 @@ chimera_vfs_open_cache_insert(
 
     shard = &cache->shards[fh_hash & cache->shard_mask];
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     prometheus_counter_increment(shard->insert);
 
@@ -761,7 +762,7 @@ chimera_vfs_open_cache_defer_close(
     for (unsigned int i = 0; i < cache->num_shards; i++) {
         shard = &cache->shards[i];
 
-        pthread_mutex_lock(&shard->lock);
+        chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
         while (shard->pending_close) {
 
@@ -806,7 +807,7 @@ chimera_vfs_open_cache_count_by_mount(
     for (unsigned int i = 0; i < cache->num_shards; i++) {
         shard = &cache->shards[i];
 
-        pthread_mutex_lock(&shard->lock);
+        chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
         for (handle = shard->handles; handle; handle = handle->bucket_next) {
             if (memcmp(handle->fh, mount_id, CHIMERA_VFS_MOUNT_ID_SIZE) == 0) {
@@ -840,7 +841,7 @@ chimera_vfs_open_cache_mark_for_close_by_mount(
     for (unsigned int i = 0; i < cache->num_shards; i++) {
         shard = &cache->shards[i];
 
-        pthread_mutex_lock(&shard->lock);
+        chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
         for (handle = shard->handles; handle; handle = handle->bucket_next) {
             if (memcmp(handle->fh, mount_id, CHIMERA_VFS_MOUNT_ID_SIZE) == 0) {
@@ -877,7 +878,7 @@ chimera_vfs_open_cache_lookup_ref(
 
     shard = &cache->shards[fh_hash & cache->shard_mask];
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     /* Scan for any handle matching fh with opencnt > 0, regardless of access_mode */
     for (handle = shard->handles; handle; handle = handle->bucket_next) {
@@ -914,7 +915,7 @@ chimera_vfs_open_cache_exists(
 
     shard = &cache->shards[fh_hash & cache->shard_mask];
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     /* Scan for any handle matching fh, regardless of access_mode */
     for (handle = shard->handles; handle; handle = handle->bucket_next) {
@@ -954,7 +955,7 @@ chimera_vfs_open_cache_set_doc(
 
     shard = &cache->shards[handle->fh_hash & cache->shard_mask];
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     handle->doc_delete_on_close = 1;
     handle->doc_parent_fh_len   = parent_fh_len;
@@ -984,7 +985,7 @@ chimera_vfs_open_cache_clear_doc(
 
     shard = &cache->shards[handle->fh_hash & cache->shard_mask];
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     handle->doc_delete_on_close = 0;
     handle->doc_parent_fh_len   = 0;
@@ -1030,7 +1031,7 @@ chimera_vfs_open_cache_release_doc(
     chimera_vfs_abort_if(handle->cache_id != shard->cache_id,
                          "handle released by wrong cache");
 
-    pthread_mutex_lock(&shard->lock);
+    chimera_mutex_lock(&shard->lock, "vfs_open_cache");
 
     handle->flags &= ~CHIMERA_VFS_OPEN_HANDLE_EXCLUSIVE;
 
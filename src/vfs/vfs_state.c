@@ -9,6 +9,7 @@
 #include "vfs_state.h"
 #include "vfs_internal.h"
 #include "common/macros.h"
+#include "common/lock_profile.h"
 
 /*
  * Default lease-break deadline.  Matches the SMB2 client expectation of
@@ -166,7 +167,7 @@ chimera_vfs_state_get(
 
     bucket = chimera_vfs_state_bucket_for(state, fh_hash);
 
-    pthread_mutex_lock(&bucket->lock);
+    chimera_mutex_lock(&bucket->lock, "vfs_state_bucket");
 
     for (file = bucket->files; file; file = file->bucket_next) {
         if (chimera_vfs_file_state_match(file, fh, fh_len, fh_hash)) {
@@ -216,7 +217,7 @@ chimera_vfs_state_put(
 
     bucket = chimera_vfs_state_bucket_for(state, file->fh_hash);
 
-    pthread_mutex_lock(&bucket->lock);
+    chimera_mutex_lock(&bucket->lock, "vfs_state_bucket");
 
     chimera_vfs_abort_if(file->refcount == 0, "double put on vfs_state file");
 
@@ -3754,7 +3755,7 @@ chimera_vfs_state_reap_idle(
         int                              n = 0;
         int                              i;
 
-        pthread_mutex_lock(&bucket->lock);
+        chimera_mutex_lock(&bucket->lock, "vfs_state_bucket");
         for (file = bucket->files;
              file && n < CHIMERA_VFS_STATE_REAP_BATCH;
              file = file->bucket_next) {
@@ -0,0 +1,698 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "vfs.h"
+#include "vfs_internal.h"
+#include "vfs_trace.h"
+#include "vfs_mount_table.h"
+#include "common/macros.h"
+#include "common/format.h"
+
+/*
+ * A ring slot is a tiny seqlock: the owning thread bumps `version` to odd,
+ * writes the record, then bumps it to even.  Readers copy the record between
+ * two loads of `version` and discard the copy if it changed or was odd.
+ */
+struct chimera_vfs_trace_slot {
+    uint64_t                        version;
+    struct chimera_vfs_trace_record record;
+};
+
+struct chimera_vfs_slow_op_slot {
+    uint64_t                          version;
+    struct chimera_vfs_slow_op_record record;
+};
+
+/*
+ * Rings are owned by the VFS, not the thread: a destroyed thread leaves its
+ * ring (and the records in it) behind for the next thread to adopt, so the
+ * REST reader never races a free.  All rings are released in
+ * chimera_vfs_trace_destroy.
+ */
+struct chimera_vfs_trace_ring {
+    struct chimera_vfs_trace_ring  *next;
+    uint32_t                        id;
+    int                             active;    /* guarded by vfs->trace_lock */
+    uint64_t                        head;      /* trace records ever written */
+    uint64_t                        slow_head; /* slow-op records ever written */
+    struct chimera_vfs_trace_slot   slots[CHIMERA_VFS_TRACE_RING_SIZE];
+    struct chimera_vfs_slow_op_slot slow_slots[CHIMERA_VFS_SLOW_OP_RING_SIZE];
+};
+
+/* Histogram series names: each names the interval ending at that stage.
+ * RECEIVE starts every interval, so its slot is used for the total. */
+static const char *chimera_vfs_trace_segment_names[CHIMERA_VFS_TRACE_STAGE_NUM] = {
+    [CHIMERA_VFS_TRACE_RECEIVE]  = "total",
+    [CHIMERA_VFS_TRACE_DISPATCH] = "dispatch",
+    [CHIMERA_VFS_TRACE_ENQUEUE]  = "enqueue",
+    [CHIMERA_VFS_TRACE_DEQUEUE]  = "queue",
+    [CHIMERA_VFS_TRACE_COMPLETE] = "backend",
+    [CHIMERA_VFS_TRACE_REPLY]    = "reply",
+};
+
+SYMBOL_EXPORT const char *
+chimera_vfs_trace_stage_name(int stage)
+{
+    switch (stage) {
+        case CHIMERA_VFS_TRACE_RECEIVE: return "receive";
+        case CHIMERA_VFS_TRACE_DISPATCH: return "dispatch";
+        case CHIMERA_VFS_TRACE_ENQUEUE: return "enqueue";
+        case CHIMERA_VFS_TRACE_DEQUEUE: return "dequeue";
+        case CHIMERA_VFS_TRACE_COMPLETE: return "complete";
+        case CHIMERA_VFS_TRACE_REPLY: return "reply";
+        default: return "unknown";
+    } /* switch */
+} /* chimera_vfs_trace_stage_name */
+
+SYMBOL_EXPORT const char *
+chimera_vfs_trace_proto_name(int proto)
+{
+    switch (proto) {
+        case CHIMERA_VFS_TRACE_PROTO_NONE: return "internal";
+        case CHIMERA_VFS_TRACE_PROTO_NFS3: return "nfs3";
+        case CHIMERA_VFS_TRACE_PROTO_NFS4: return "nfs4";
+        case CHIMERA_VFS_TRACE_PROTO_SMB: return "smb";
+        case CHIMERA_VFS_TRACE_PROTO_S3: return "s3";
+        default: return "unknown";
+    } /* switch */
+} /* chimera_vfs_trace_proto_name */
+
+SYMBOL_EXPORT void
+chimera_vfs_set_trace_sample_interval(
+    struct chimera_vfs *vfs,
+    uint32_t            interval)
+{
+    __atomic_store_n(&vfs->trace_interval, interval, __ATOMIC_RELAXED);
+} /* chimera_vfs_set_trace_sample_interval */
+
+SYMBOL_EXPORT uint32_t
+chimera_vfs_get_trace_sample_interval(struct chimera_vfs *vfs)
+{
+    return __atomic_load_n(&vfs->trace_interval, __ATOMIC_RELAXED);
+} /* chimera_vfs_get_trace_sample_interval */
+
+SYMBOL_EXPORT void
+chimera_vfs_set_slow_op_threshold(
+    struct chimera_vfs *vfs,
+    uint64_t            threshold_ns)
+{
+    __atomic_store_n(&vfs->slow_op_threshold_ns, threshold_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&vfs->slow_op_threshold_ticks,
+                     threshold_ns ? chimera_vfs_ns_to_ticks(threshold_ns) | 1 : 0,
+                     __ATOMIC_RELAXED);
+} /* chimera_vfs_set_slow_op_threshold */
+
+SYMBOL_EXPORT uint64_t
+chimera_vfs_get_slow_op_threshold(struct chimera_vfs *vfs)
+{
+    return __atomic_load_n(&vfs->slow_op_threshold_ns, __ATOMIC_RELAXED);
+} /* chimera_vfs_get_slow_op_threshold */
+
+SYMBOL_EXPORT int
+chimera_vfs_trace_enabled(struct chimera_vfs *vfs)
+{
+    return __atomic_load_n(&vfs->trace_interval, __ATOMIC_RELAXED) ||
+           __atomic_load_n(&vfs->slow_op_threshold_ticks, __ATOMIC_RELAXED) ||
+           __atomic_load_n(&vfs->hh_enabled, __ATOMIC_RELAXED);
+} /* chimera_vfs_trace_enabled */
+
+/*
+ * Intern `client` on the thread.  Calls from one client usually arrive in
+ * runs, so the last entry is reused while it matches; otherwise the thread
+ * drops its reference to it and fills a free (or new) entry.
+ */
+static struct chimera_vfs_trace_client *
+chimera_vfs_trace_client_get(
+    struct chimera_vfs_thread *thread,
+    const char                *client)
+{
+    struct chimera_vfs_trace_client *c = thread->trace_client_last;
+
+    if (c && strncmp(c->name, client, sizeof(c->name) - 1) == 0) {
+        return c;
+    }
+
+    if (c) {
+        chimera_vfs_trace_client_put(thread, c);
+    }
+
+    c = thread->trace_client_free;
+
+    if (c) {
+        LL_DELETE(thread->trace_client_free, c);
+    } else {
+        c = malloc(sizeof(*c));
+    }
+
+    c->refcnt = 1;
+    c->len    = strnlen(client, sizeof(c->name) - 1);
+    memcpy(c->name, client, c->len);
+    c->name[c->len] = '\0';
+    c->hash         = chimera_vfs_hash(c->name, c->len);
+
+    thread->trace_client_last = c;
+
+    return c;
+} /* chimera_vfs_trace_client_get */
+
+SYMBOL_EXPORT void
+chimera_vfs_trace_receive(
+    struct chimera_vfs_thread *thread,
+    uint8_t                    proto,
+    const char                *client)
+{
+    if (likely(!chimera_vfs_trace_enabled(thread->vfs))) {
+        return;
+    }
+
+    thread->trace_recv_ticks  = chimera_vfs_now_ticks();
+    thread->trace_recv_proto  = proto;
+    thread->trace_recv_client = client && client[0] ? chimera_vfs_trace_client_get(thread, client) : NULL;
+} /* chimera_vfs_trace_receive */
+
+SYMBOL_EXPORT void
+chimera_vfs_trace_receive_done(struct chimera_vfs_thread *thread)
+{
+    thread->trace_recv_ticks  = 0;
+    thread->trace_recv_proto  = CHIMERA_VFS_TRACE_PROTO_NONE;
+    thread->trace_recv_client = NULL;
+} /* chimera_vfs_trace_receive_done */
+
+void
+chimera_vfs_trace_init(struct chimera_vfs *vfs)
+{
+    struct prometheus_metrics *metrics = vfs->metrics.metrics;
+
+    pthread_mutex_init(&vfs->trace_lock, NULL);
+
+    if (!metrics) {
+        return;
+    }
+
+    /* Same bucket layout as op_latency, so the two can be compared. */
+    vfs->metrics.trace_stage = prometheus_metrics_create_histogram_time(metrics,
+                                                                        "chimera_vfs_trace_stage_nanoseconds",
+                                                                        "Sampled VFS request latency per stage in nanoseconds",
+                                                                        34);
+
+    for (int i = 0; i < CHIMERA_VFS_TRACE_STAGE_NUM; i++) {
+        vfs->metrics.trace_stage_series[i] = prometheus_histogram_create_series(vfs->metrics.trace_stage,
+                                                                                (const char *[]) { "stage" },
+                                                                                (const char *[]) {
+            chimera_vfs_trace_segment_names[i]
+        },
+                                                                                1);
+    }
+} /* chimera_vfs_trace_init */
+
+void
+chimera_vfs_trace_destroy(struct chimera_vfs *vfs)
+{
+    struct chimera_vfs_trace_ring *ring;
+
+    while (vfs->trace_rings) {
+        ring             = vfs->trace_rings;
+        vfs->trace_rings = ring->next;
+        free(ring);
+    }
+
+    if (vfs->metrics.trace_stage) {
+        for (int i = 0; i < CHIMERA_VFS_TRACE_STAGE_NUM; i++) {
+            prometheus_histogram_destroy_series(vfs->metrics.trace_stage, vfs->metrics.trace_stage_series[i]);
+        }
+        prometheus_histogram_destroy(vfs->metrics.metrics, vfs->metrics.trace_stage);
+    }
+
+    pthread_mutex_destroy(&vfs->trace_lock);
+} /* chimera_vfs_trace_destroy */
+
+void
+chimera_vfs_trace_thread_init(struct chimera_vfs_thread *thread)
+{
+    struct chimera_vfs            *vfs = thread->vfs;
+    struct chimera_vfs_trace_ring *ring;
+
+    if (vfs->metrics.trace_stage) {
+        for (int i = 0; i < CHIMERA_VFS_TRACE_STAGE_NUM; i++) {
+            thread->metrics.trace_stage[i] = prometheus_histogram_series_create_instance(
+                vfs->metrics.trace_stage_series[i]);
+        }
+    }
+
+    pthread_mutex_lock(&vfs->trace_lock);
+
+    for (ring = vfs->trace_rings; ring; ring = ring->next) {
+        if (!ring->active) {
+            break;
+        }
+    }
+
+    if (!ring) {
+        /* Published under trace_lock; readers walk the list under it too. */
+        ring             = calloc(1, sizeof(*ring));
+        ring->id         = vfs->trace_next_id++;
+        ring->next       = vfs->trace_rings;
+        vfs->trace_rings = ring;
+    }
+
+    ring->active = 1;
+
+    pthread_mutex_unlock(&vfs->trace_lock);
+
+    thread->trace_ring = ring;
+} /* chimera_vfs_trace_thread_init */
+
+void
+chimera_vfs_trace_thread_destroy(struct chimera_vfs_thread *thread)
+{
+    struct chimera_vfs *vfs = thread->vfs;
+
+    if (thread->metrics.trace_stage[0]) {
+        for (int i = 0; i < CHIMERA_VFS_TRACE_STAGE_NUM; i++) {
+            prometheus_histogram_series_destroy_instance(vfs->metrics.trace_stage_series[i],
+                                                         thread->metrics.trace_stage[i]);
+        }
+    }
+
+    pthread_mutex_lock(&vfs->trace_lock);
+    thread->trace_ring->active = 0;
+    pthread_mutex_unlock(&vfs->trace_lock);
+
+    thread->trace_ring = NULL;
+
+    /* Every request has been freed by now, so only the thread's own
+     * reference to the last client remains. */
+    if (thread->trace_client_last) {
+        chimera_vfs_trace_client_put(thread, thread->trace_client_last);
+        thread->trace_client_last = NULL;
+    }
+
+    while (thread->trace_client_free) {
+        struct chimera_vfs_trace_client *c = thread->trace_client_free;
+
+        LL_DELETE(thread->trace_client_free, c);
+        free(c);
+    }
+} /* chimera_vfs_trace_thread_destroy */
+
+static inline void
+chimera_vfs_trace_sample(
+    struct prometheus_histogram_instance *inst,
+    uint64_t                              ns)
+{
+    if (inst) {
+        prometheus_histogram_sample(inst, ns ? (int64_t) ns : 1);
+    }
+} /* chimera_vfs_trace_sample */
+
+/* Resolve the mount path for a request's fh (slow path only). */
+static void
+chimera_vfs_trace_mount_name(
+    struct chimera_vfs_thread  *thread,
+    struct chimera_vfs_request *request,
+    char                       *out,
+    int                         outlen)
+{
+    struct chimera_vfs_mount *mount;
+
+    out[0] = '\0';
+
+    if (request->fh_len < CHIMERA_VFS_MOUNT_ID_SIZE) {
+        return;
+    }
+
+    urcu_qsbr_read_lock();
+    mount = chimera_vfs_mount_table_lookup(thread->vfs->mount_table, request->fh);
+    if (mount) {
+        snprintf(out, outlen, "%s", mount->path);
+    }
+    urcu_qsbr_read_unlock();
+} /* chimera_vfs_trace_mount_name */
+
+static void
+chimera_vfs_slow_op_record(
+    struct chimera_vfs_thread       *thread,
+    struct chimera_vfs_request      *request,
+    struct chimera_vfs_trace_record *stamps)
+{
+    struct chimera_vfs_trace_ring     *ring = thread->trace_ring;
+    struct chimera_vfs_slow_op_slot   *slot;
+    struct chimera_vfs_slow_op_record *rec;
+    uint64_t                           head = ring->slow_head;
+
+    slot = &ring->slow_slots[head & (CHIMERA_VFS_SLOW_OP_RING_SIZE - 1)];
+    rec  = &slot->record;
+
+    __atomic_store_n(&slot->version, 2 * head + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    rec->seq        = head;
+    rec->wall_ns    = stamps->wall_ns;
+    rec->elapsed_ns = stamps->stage_ns[CHIMERA_VFS_TRACE_REPLY];
+    rec->opcode     = stamps->opcode;
+    rec->status     = stamps->status;
+    rec->thread_id  = stamps->thread_id;
+    rec->proto      = stamps->proto;
+    rec->stage_mask = stamps->stage_mask;
+    rec->fh_len     = request->fh_len > CHIMERA_VFS_FH_SIZE ? CHIMERA_VFS_FH_SIZE : request->fh_len;
+
+    memcpy(rec->stage_ns, stamps->stage_ns, sizeof(rec->stage_ns));
+    memcpy(rec->fh, request->fh, rec->fh_len);
+    if (request->trace_client) {
+        memcpy(rec->client, request->trace_client->name, sizeof(rec->client));
+    } else {
+        rec->client[0] = '\0';
+    }
+
+    snprintf(rec->backend, sizeof(rec->backend), "%s",
+             request->module ? request->module->name : "");
+
+    chimera_vfs_trace_mount_name(thread, request, rec->mount, sizeof(rec->mount));
+
+    __atomic_store_n(&slot->version, 2 * head + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->slow_head, head + 1, __ATOMIC_RELEASE);
+} /* chimera_vfs_slow_op_record */
+
+void
+chimera_vfs_trace_finish(
+    struct chimera_vfs_thread  *thread,
+    struct chimera_vfs_request *request)
+{
+    struct chimera_vfs_trace_ring   *ring = thread->trace_ring;
+    struct chimera_vfs_trace_slot   *slot = NULL;
+    struct chimera_vfs_trace_record  local, *rec = &local;
+    uint64_t                         now, base, prev, ticks, ns, slow;
+    int                              stage;
+
+    now = chimera_vfs_now_ticks();
+
+    request->trace_ticks[CHIMERA_VFS_TRACE_REPLY] = now;
+    request->trace_mask                          |= 1 << CHIMERA_VFS_TRACE_REPLY;
+
+    base = request->trace_ticks[CHIMERA_VFS_TRACE_RECEIVE];
+    slow = __atomic_load_n(&thread->vfs->slow_op_threshold_ticks, __ATOMIC_RELAXED);
+
+    if (!request->trace_sampled) {
+        /* Stamped only for the slow-op recorder */
+        if (!slow || now - base < slow) {
+            request->trace_mask = 0;
+            return;
+        }
+    } else {
+        /* Sampled: build the record in place in the trace ring */
+        slot = &ring->slots[ring->head & (CHIMERA_VFS_TRACE_RING_SIZE - 1)];
+        rec  = &slot->record;
+
+        __atomic_store_n(&slot->version, 2 * ring->head + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    prev = base;
+
+    rec->seq        = ring->head;
+    rec->fh_hash    = request->fh_hash;
+    rec->opcode     = request->opcode;
+    rec->status     = request->status;
+    rec->thread_id  = ring->id;
+    rec->proto      = request->trace_proto;
+    rec->stage_mask = request->trace_mask;
+
+    rec->stage_ns[CHIMERA_VFS_TRACE_RECEIVE] = 0;
+
+    for (stage = CHIMERA_VFS_TRACE_RECEIVE + 1; stage < CHIMERA_VFS_TRACE_STAGE_NUM; stage++) {
+
+        if (!(request->trace_mask & (1 << stage))) {
+            rec->stage_ns[stage] = 0;
+            continue;
+        }
+
+        ticks = request->trace_ticks[stage];
+
+        /* Stamps from other threads can be skewed slightly behind; clamp. */
+        if (slot) {
+            ns = ticks > prev ? chimera_vfs_ticks_to_ns(ticks - prev) : 0;
+            chimera_vfs_trace_sample(thread->metrics.trace_stage[stage], ns);
+        }
+
+        rec->stage_ns[stage] = ticks > base ? chimera_vfs_ticks_to_ns(ticks - base) : 0;
+
+        if (ticks > prev) {
+            prev = ticks;
+        }
+    }
+
+    rec->wall_ns = chimera_vfs_wall_ns() - rec->stage_ns[CHIMERA_VFS_TRACE_REPLY];
+
+    if (slot) {
+        chimera_vfs_trace_sample(thread->metrics.trace_stage[CHIMERA_VFS_TRACE_RECEIVE],
+                                 rec->stage_ns[CHIMERA_VFS_TRACE_REPLY]);
+
+        __atomic_store_n(&slot->version, 2 * ring->head + 2, __ATOMIC_RELEASE);
+        __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+    }
+
+    if (slow && now - base >= slow) {
+        chimera_vfs_slow_op_record(thread, request, rec);
+    }
+
+    request->trace_mask = 0;
+} /* chimera_vfs_trace_finish */
+
+/*
+ * Copy one seqlocked slot: succeeds only if the slot holds generation `gen`
+ * (i.e. the record written as the gen'th in its ring) both before and after
+ * the copy.
+ */
+static int
+chimera_vfs_trace_slot_read(
+    const uint64_t *version,
+    const void     *record,
+    void           *out,
+    size_t          len,
+    uint64_t        gen)
+{
+    uint64_t v1, v2;
+
+    v1 = __atomic_load_n(version, __ATOMIC_ACQUIRE);
+
+    if (v1 != 2 * gen + 2) {
+        /* Being rewritten, or already lapped by the writer. */
+        return 0;
+    }
+
+    memcpy(out, record, len);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    v2 = __atomic_load_n(version, __ATOMIC_RELAXED);
+
+    return v1 == v2;
+} /* chimera_vfs_trace_slot_read */
+
+static int
+chimera_vfs_trace_record_cmp(
+    const void *a,
+    const void *b)
+{
+    const struct chimera_vfs_trace_record *ra = a;
+    const struct chimera_vfs_trace_record *rb = b;
+
+    /* Newest first */
+    if (ra->wall_ns > rb->wall_ns) {
+        return -1;
+    }
+    if (ra->wall_ns < rb->wall_ns) {
+        return 1;
+    }
+    return 0;
+} /* chimera_vfs_trace_record_cmp */
+
+SYMBOL_EXPORT int
+chimera_vfs_trace_snapshot(
+    struct chimera_vfs              *vfs,
+    struct chimera_vfs_trace_record *out,
+    int                              max)
+{
+    struct chimera_vfs_trace_ring   *ring;
+    struct chimera_vfs_trace_slot   *slot;
+    struct chimera_vfs_trace_record *all;
+    uint64_t                         head, first, i;
+    int                              nrings = 0, n = 0;
+
+    if (max <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&vfs->trace_lock);
+
+    for (ring = vfs->trace_rings; ring; ring = ring->next) {
+        nrings++;
+    }
+
+    all = malloc((size_t) nrings * CHIMERA_VFS_TRACE_RING_SIZE * sizeof(*all));
+
+    if (!all) {
+        pthread_mutex_unlock(&vfs->trace_lock);
+        return 0;
+    }
+
+    for (ring = vfs->trace_rings; ring; ring = ring->next) {
+
+        head  = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        first = head > CHIMERA_VFS_TRACE_RING_SIZE ? head - CHIMERA_VFS_TRACE_RING_SIZE : 0;
+
+        for (i = first; i < head; i++) {
+            slot = &ring->slots[i & (CHIMERA_VFS_TRACE_RING_SIZE - 1)];
+
+            n += chimera_vfs_trace_slot_read(&slot->version, &slot->record,
+                                             &all[n], sizeof(all[n]), i);
+        }
+    }
+
+    pthread_mutex_unlock(&vfs->trace_lock);
+
+    qsort(all, n, sizeof(*all), chimera_vfs_trace_record_cmp);
+
+    if (n > max) {
+        n = max;
+    }
+
+    memcpy(out, all, (size_t) n * sizeof(*out));
+
+    free(all);
+
+    return n;
+} /* chimera_vfs_trace_snapshot */
+
+static int
+chimera_vfs_slow_op_record_cmp(
+    const void *a,
+    const void *b)
+{
+    const struct chimera_vfs_slow_op_record *ra = a;
+    const struct chimera_vfs_slow_op_record *rb = b;
+
+    /* Newest first */
+    if (ra->wall_ns > rb->wall_ns) {
+        return -1;
+    }
+    if (ra->wall_ns < rb->wall_ns) {
+        return 1;
+    }
+    return 0;
+} /* chimera_vfs_slow_op_record_cmp */
+
+SYMBOL_EXPORT int
+chimera_vfs_slow_op_snapshot(
+    struct chimera_vfs                *vfs,
+    struct chimera_vfs_slow_op_record *out,
+    int                                max)
+{
+    struct chimera_vfs_trace_ring     *ring;
+    struct chimera_vfs_slow_op_slot   *slot;
+    struct chimera_vfs_slow_op_record *all;
+    uint64_t                           head, first, i;
+    int                                nrings = 0, n = 0;
+
+    if (max <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&vfs->trace_lock);
+
+    for (ring = vfs->trace_rings; ring; ring = ring->next) {
+        nrings++;
+    }
+
+    all = malloc((size_t) nrings * CHIMERA_VFS_SLOW_OP_RING_SIZE * sizeof(*all));
+
+    if (!all) {
+        pthread_mutex_unlock(&vfs->trace_lock);
+        return 0;
+    }
+
+    for (ring = vfs->trace_rings; ring; ring = ring->next) {
+
+        head  = __atomic_load_n(&ring->slow_head, __ATOMIC_ACQUIRE);
+        first = head > CHIMERA_VFS_SLOW_OP_RING_SIZE ? head - CHIMERA_VFS_SLOW_OP_RING_SIZE : 0;
+
+        for (i = first; i < head; i++) {
+            slot = &ring->slow_slots[i & (CHIMERA_VFS_SLOW_OP_RING_SIZE - 1)];
+
+            n += chimera_vfs_trace_slot_read(&slot->version, &slot->record,
+                                             &all[n], sizeof(all[n]), i);
+        }
+    }
+
+    pthread_mutex_unlock(&vfs->trace_lock);
+
+    qsort(all, n, sizeof(*all), chimera_vfs_slow_op_record_cmp);
+
+    if (n > max) {
+        n = max;
+    }
+
+    memcpy(out, all, (size_t) n * sizeof(*out));
+
+    free(all);
+
+    return n;
+} /* chimera_vfs_slow_op_snapshot */
+
+SYMBOL_EXPORT void
+chimera_vfs_slow_op_dump(struct chimera_vfs *vfs)
+{
+    struct chimera_vfs_slow_op_record *records, *rec;
+    char                               fh[CHIMERA_VFS_FH_SIZE * 2 + 1];
+    char                               stages[256];
+    int                                n, i, stage, len;
+    int                                max = 1024;
+
+    records = calloc(max, sizeof(*records));
+
+    if (!records) {
+        return;
+    }
+
+    n = chimera_vfs_slow_op_snapshot(vfs, records, max);
+
+    chimera_vfs_info("Slow-op flight recorder: %d records over %llu us",
+                     n, (unsigned long long) (chimera_vfs_get_slow_op_threshold(vfs) / 1000));
+
+    for (i = 0; i < n; i++) {
+        rec = &records[i];
+
+        format_hex(fh, sizeof(fh), rec->fh, rec->fh_len);
+
+        len       = 0;
+        stages[0] = '\0';
+
+        for (stage = CHIMERA_VFS_TRACE_DISPATCH; stage < CHIMERA_VFS_TRACE_STAGE_NUM; stage++) {
+            if ((rec->stage_mask & (1 << stage)) && len < (int) sizeof(stages)) {
+                len += snprintf(stages + len, sizeof(stages) - len, " %s=%llu",
+                                chimera_vfs_trace_stage_name(stage),
+                                (unsigned long long) rec->stage_ns[stage]);
+            }
+        }
+
+        chimera_vfs_info("slow op %s %llu us status %d proto %s client %s mount %s backend %s thread %u fh %s stages_ns:%s",
+                         chimera_vfs_op_name(rec->opcode),
+                         (unsigned long long) (rec->elapsed_ns / 1000),
+                         rec->status,
+                         chimera_vfs_trace_proto_name(rec->proto),
+                         rec->client[0] ? rec->client : "-",
+                         rec->mount[0] ? rec->mount : "-",
+                         rec->backend[0] ? rec->backend : "-",
+                         rec->thread_id,
+                         fh,
+                         stages);
+    }
+
+    free(records);
+} /* chimera_vfs_slow_op_dump */
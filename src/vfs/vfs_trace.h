@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2026 Chimera-NAS Project Contributors
+//
+// SPDX-License-Identifier: LGPL-2.1-only
+
+#pragma once
+
+#include <stdint.h>
+
+#include "vfs_attrs.h"
+
+/*
+ * Sampled per-request latency breakdown.
+ *
+ * When tracing is enabled (chimera_vfs_set_trace_sample_interval), one VFS
+ * request in every `interval` allocated on a thread is sampled.  A sampled
+ * request carries a TSC stamp for each stage it passes through:
+ *
+ *   RECEIVE   the protocol received the call (or the request was allocated,
+ *             when no protocol stamped the thread -- e.g. internal requests)
+ *   DISPATCH  chimera_vfs_dispatch handed the request to its backend path
+ *   ENQUEUE   posted to a delegation thread
+ *   DEQUEUE   picked up by the delegation thread
+ *   COMPLETE  the backend completed the request
+ *   REPLY     the protocol callback returned (reply encoded and sent)
+ *
+ * When the request is freed the stamps are folded into the per-stage
+ * histograms and written to the owning thread's trace ring.  Each ring has a
+ * single writer (its VFS thread) and is read lock-free by the REST debug API
+ * using a per-slot sequence, so the hot path never takes a lock.  Unsampled
+ * requests pay one relaxed load and a branch.
+ *
+ * The slow-op flight recorder (chimera_vfs_set_slow_op_threshold) reuses the
+ * same stamps: while a threshold is set every request is stamped, and any
+ * whose RECEIVE-to-REPLY time exceeds it is written, with its full context
+ * (fh, mount, client, backend), to a second per-thread ring.  The client
+ * address is interned per thread when the call is received; requests hold a
+ * reference to it and it is only copied for the requests actually recorded.
+ */
+
+enum chimera_vfs_trace_stage {
+    CHIMERA_VFS_TRACE_RECEIVE = 0,
+    CHIMERA_VFS_TRACE_DISPATCH,
+    CHIMERA_VFS_TRACE_ENQUEUE,
+    CHIMERA_VFS_TRACE_DEQUEUE,
+    CHIMERA_VFS_TRACE_COMPLETE,
+    CHIMERA_VFS_TRACE_REPLY,
+    CHIMERA_VFS_TRACE_STAGE_NUM
+};
+
+#define CHIMERA_VFS_TRACE_PROTO_NONE 0
+#define CHIMERA_VFS_TRACE_PROTO_NFS3 1
+#define CHIMERA_VFS_TRACE_PROTO_NFS4 2
+#define CHIMERA_VFS_TRACE_PROTO_SMB  3
+#define CHIMERA_VFS_TRACE_PROTO_S3   4
+#define CHIMERA_VFS_TRACE_PROTO_NUM  5
+
+/* Per-thread ring capacities (records); must be powers of two. */
+#define CHIMERA_VFS_TRACE_RING_SIZE   1024
+#define CHIMERA_VFS_SLOW_OP_RING_SIZE 256
+
+#define CHIMERA_VFS_TRACE_CLIENT_MAX  48
+
+/*
+ * A client address interned by the VFS thread that received a call from it.
+ * Referenced by the requests of that call (and the thread, while it is the
+ * last client seen); the count is only touched on the owning thread.
+ */
+struct chimera_vfs_trace_client {
+    uint32_t                         refcnt;
+    uint32_t                         len;
+    uint64_t                         hash;
+    char                             name[CHIMERA_VFS_TRACE_CLIENT_MAX];
+    struct chimera_vfs_trace_client *next;    /* thread free list */
+};
+
+struct chimera_vfs;
+struct chimera_vfs_thread;
+struct chimera_vfs_request;
+struct chimera_vfs_trace_ring;
+
+struct chimera_vfs_trace_record {
+    uint64_t seq;          /* per-thread sequence number */
+    uint64_t wall_ns;      /* wall-clock time of the RECEIVE stage */
+    uint64_t fh_hash;
+    uint32_t opcode;
+    int32_t  status;       /* enum chimera_vfs_error */
+    uint32_t thread_id;    /* trace ring id (stable per VFS thread) */
+    uint8_t  proto;        /* CHIMERA_VFS_TRACE_PROTO_* */
+    uint8_t  stage_mask;   /* bit per stage actually reached */
+    /* Nanoseconds from RECEIVE to each stage; valid where stage_mask is set. */
+    uint64_t stage_ns[CHIMERA_VFS_TRACE_STAGE_NUM];
+};
+
+struct chimera_vfs_slow_op_record {
+    uint64_t seq;
+    uint64_t wall_ns;
+    uint64_t elapsed_ns;   /* RECEIVE to REPLY */
+    uint32_t opcode;
+    int32_t  status;
+    uint32_t thread_id;
+    uint8_t  proto;
+    uint8_t  stage_mask;
+    uint16_t fh_len;
+    uint64_t stage_ns[CHIMERA_VFS_TRACE_STAGE_NUM];
+    uint8_t  fh[CHIMERA_VFS_FH_SIZE];
+    char     client[CHIMERA_VFS_TRACE_CLIENT_MAX];
+    char     mount[64];
+    char     backend[32];
+};
+
+const char *
+chimera_vfs_trace_stage_name(
+    int stage);
+
+const char *
+chimera_vfs_trace_proto_name(
+    int proto);
+
+/* Sample one request in every `interval` per thread; 0 disables tracing. */
+void
+chimera_vfs_set_trace_sample_interval(
+    struct chimera_vfs *vfs,
+    uint32_t            interval);
+
+uint32_t
+chimera_vfs_get_trace_sample_interval(
+    struct chimera_vfs *vfs);
+
+/*
+ * Record ops slower than `threshold_ns` (RECEIVE to REPLY) in the slow-op
+ * flight recorder; 0 disables it.
+ */
+void
+chimera_vfs_set_slow_op_threshold(
+    struct chimera_vfs *vfs,
+    uint64_t            threshold_ns);
+
+uint64_t
+chimera_vfs_get_slow_op_threshold(
+    struct chimera_vfs *vfs);
+
+/* Nonzero if sampling, the slow-op recorder or heavy-hitter tracking is on;
+ * lets protocols skip formatting the client address when nothing will
+ * consume it. */
+int
+chimera_vfs_trace_enabled(
+    struct chimera_vfs *vfs);
+
+/*
+ * Mark the calling thread as handling a freshly received protocol call.
+ * Requests allocated on the thread until chimera_vfs_trace_receive_done()
+ * take `now` as their RECEIVE stamp and record `proto` and `client` (which
+ * may be NULL and need only stay valid for the duration of this call).
+ */
+void
+chimera_vfs_trace_receive(
+    struct chimera_vfs_thread *thread,
+    uint8_t                    proto,
+    const char                *client);
+
+void
+chimera_vfs_trace_receive_done(
+    struct chimera_vfs_thread *thread);
+
+/*
+ * Copy up to `max` of the most recent trace records from every thread ring
+ * into `out`.  Safe to call from any thread while tracing is active; records
+ * overwritten mid-copy are skipped.  Returns the number of records copied.
+ */
+int
+chimera_vfs_trace_snapshot(
+    struct chimera_vfs              *vfs,
+    struct chimera_vfs_trace_record *out,
+    int                              max);
+
+/* As chimera_vfs_trace_snapshot, for the slow-op flight recorder. */
+int
+chimera_vfs_slow_op_snapshot(
+    struct chimera_vfs                *vfs,
+    struct chimera_vfs_slow_op_record *out,
+    int                                max);
+
+/* Write every slow-op record to the log (used on SIGUSR2). */
+void
+chimera_vfs_slow_op_dump(
+    struct chimera_vfs *vfs);
+
+/* VFS-internal lifecycle, called from vfs.c. */
+void
+chimera_vfs_trace_init(
+    struct chimera_vfs *vfs);
+
+void
+chimera_vfs_trace_destroy(
+    struct chimera_vfs *vfs);
+
+void
+chimera_vfs_trace_thread_init(
+    struct chimera_vfs_thread *thread);
+
+void
+chimera_vfs_trace_thread_destroy(
+    struct chimera_vfs_thread *thread);
+
+/* Fold a stamped request into the histograms and the thread's rings. */
+void
+chimera_vfs_trace_finish(
+    struct chimera_vfs_thread  *thread,
+    struct chimera_vfs_request *request);